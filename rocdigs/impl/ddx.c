@@ -25,6 +25,7 @@
 #include "rocs/public/mem.h"
 #include "rocs/public/system.h"
 #include "rocs/public/trace.h"
+#include "rocs/public/str.h"
 
 #include "rocrail/wrapper/public/DigInt.h"
 #include "rocrail/wrapper/public/SysCmd.h"
@@ -34,6 +35,8 @@
 #include "rocrail/wrapper/public/Output.h"
 #include "rocrail/wrapper/public/Signal.h"
 #include "rocrail/wrapper/public/Feedback.h"
+#include "rocrail/wrapper/public/FbBatch.h"
+#include "rocrail/wrapper/public/FbDelta.h"
 #include "rocrail/wrapper/public/Response.h"
 #include "rocrail/wrapper/public/DDX.h"
 #include "rocrail/wrapper/public/Program.h"
@@ -589,6 +592,57 @@ void rocrail_ddxFbListener( obj inst, int addr, int state ) {
 }
 
 
+/* Changes of one s88 scan: mask and state hold one byte per port. */
+void rocrail_ddxFbBatchListener( obj inst, unsigned char* mask, unsigned char* state, int ports ) {
+  iODDXData data = Data(inst);
+  iONode batch = NULL;
+  int changes = 0;
+  int lastAddr = 0;
+  int lastState = 0;
+  int port = 0;
+
+  if( data->listenerObj == NULL || data->listenerFun == NULL )
+    return;
+
+  batch = NodeOp.inst( wFbBatch.name(), NULL, ELEMENT_NODE );
+  if( data->iid != NULL )
+    wFbBatch.setiid( batch, data->iid );
+
+  for( port = 0; port < ports; port++ ) {
+    if( mask[port] != 0 ) {
+      iONode delta = NodeOp.inst( wFbDelta.name(), batch, ELEMENT_NODE );
+      char* s = NULL;
+      int bit = 0;
+      for( bit = 0; bit < 8; bit++ ) {
+        if( mask[port] & ( 1 << bit ) ) {
+          lastAddr  = port * 8 + bit + 1;
+          lastState = ( state[port] & ( 1 << bit ) ) ? 1:0;
+          changes++;
+          TraceOp.trc( name, TRCLEVEL_MONITOR, __LINE__, 9999, "Sensor %d=%d", lastAddr, lastState );
+        }
+      }
+      wFbDelta.setaddr( delta, port * 8 + 1 );
+      s = StrOp.byteToStr( &mask[port], 1 );
+      wFbDelta.setmask( delta, s );
+      StrOp.free( s );
+      s = StrOp.byteToStr( &state[port], 1 );
+      wFbDelta.setstate( delta, s );
+      StrOp.free( s );
+      NodeOp.addChild( batch, delta );
+    }
+  }
+
+  if( changes == 1 ) {
+    NodeOp.base.del( batch );
+    rocrail_ddxFbListener( inst, lastAddr, lastState );
+  }
+  else if( changes > 1 )
+    data->listenerFun( data->listenerObj, batch, TRCLEVEL_INFO );
+  else
+    NodeOp.base.del( batch );
+}
+
+
 /**  */
 static Boolean _supportPT( obj inst ) {
   iODDXData data = Data((iODDX)inst);
@@ -670,6 +724,10 @@ static struct ODDX* _inst( const iONode ini ,const iOTrace trc ) {
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "ddx queuecheck=%d", data->queuecheck );
   data->fastcvget = wDDX.isfastcvget( ddx_ini );
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "ddx fastcvget=%d", data->fastcvget );
+  data->refreshprio = StrOp.equals( wDDX.priority, wDDX.getrefreshpolicy( ddx_ini ) );
+  data->refreshboost = wDDX.getrefreshboost( ddx_ini );
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "ddx refreshpolicy=%s boost=%d",
+      wDDX.getrefreshpolicy( ddx_ini ), data->refreshboost );
 
   data->s88port = (int)strtol( wDDX.gets88port( ddx_ini ), (char**)NULL, 16 );
   if( data->s88port > 0 ) {
@@ -70,17 +70,6 @@ static int end38K = 800;
 char idle_data[MAXDATA];
 char NMRA_idle_data[PKTSIZE];
 
-typedef struct _locorefreshdata {
-  int last_refreshed_loco;
-  int last_refreshed_fx;
-  int last_refreshed_nmra_loco;
-  int nmra_fx_refresh;
-  int maerklin_refresh;
-  int mm_locorefresh;
-  int dcc_locorefresh;
-}
-locorefreshdata ;
-
 void rocrail_ddxStateChanged(obj inst);
 
 /****** routines and data types for maerklin packet pool ******/
@@ -217,6 +206,19 @@ void update_MaerklinPacketPool(int adr, char *sd_packet, char *f1, char *f2,
 
 static iOMutex nmra_pktpool_mutex = NULL;
 static int isNMRAPackedPoolInitialized = False;
+static int nmra_refreshboost = 0;
+
+/* Changed packets with prioritized refreshes left, in order of change:
+   an entry is adr*2+fx, and a packet is in the queue once, while its boost is above zero. */
+#define NMRA_BOOSTQSIZE ((MAX_NMRA_ADDRESS+1)*2)
+static int nmra_boostq[NMRA_BOOSTQSIZE];
+static int nmra_boosthead = 0;
+static volatile int nmra_boostcnt = 0;
+
+static void __pushBoostNMRA(int entry) {
+  nmra_boostq[(nmra_boosthead + nmra_boostcnt) % NMRA_BOOSTQSIZE] = entry;
+  nmra_boostcnt++;
+}
 tNMRAPacketPool NMRAPacketPool;
 
 int monitor_NrOfNLocos() {
@@ -231,6 +233,7 @@ int init_NMRAPacketPool(obj inst) {
   char idle_pktstr[PKTSIZE];
 
   nmra_pktpool_mutex = MutexOp.inst( NULL, True );
+  nmra_refreshboost = data->refreshprio ? data->refreshboost : 0;
 
   MutexOp.wait(nmra_pktpool_mutex);
   for (i=0; i<=MAX_NMRA_ADDRESS; i++) {
@@ -245,10 +248,16 @@ int init_NMRAPacketPool(obj inst) {
     NMRAPacketPool.packets[i].info.direction=1;
     NMRAPacketPool.packets[i].info.func=0;
     NMRAPacketPool.packets[i].info.nro_f=0;
+    NMRAPacketPool.packets[i].dcc_size=0;
+    NMRAPacketPool.packets[i].fx_dcc_size=0;
+    NMRAPacketPool.packets[i].boost[0]=0;
+    NMRAPacketPool.packets[i].boost[1]=0;
     for (j=0; j<8; j++)
       NMRAPacketPool.packets[i].info.f[j]=0;
   }
   NMRAPacketPool.NrOfKnownAdresses = 0;
+  nmra_boosthead = 0;
+  nmra_boostcnt = 0;
   isNMRAPackedPoolInitialized=True;
   MutexOp.post(nmra_pktpool_mutex);
 
@@ -295,8 +304,11 @@ void update_NMRAPacketPool_LocoInfo(char *protocol, int addr, int direction,
 
 }
 
-void update_NMRAPacketPool(int adr, char *packet, int packet_size,
-                           char *fx_packet, int fx_packet_size) {
+static void __updateNMRAPacketPool(int adr,
+                                   const unsigned char *dcc, int dcc_size,
+                                   char *packet, int packet_size,
+                                   const unsigned char *fx_dcc, int fx_dcc_size,
+                                   char *fx_packet, int fx_packet_size) {
 
   int i, found;
 
@@ -307,12 +319,35 @@ void update_NMRAPacketPool(int adr, char *packet, int packet_size,
 
   MutexOp.wait(nmra_pktpool_mutex);
   if( packet_size > 0 ) {
+    if( packet_size != NMRAPacketPool.packets[adr].packet_size ||
+        memcmp(NMRAPacketPool.packets[adr].packet,packet,packet_size) != 0 ) {
+      if( nmra_refreshboost > 0 && NMRAPacketPool.packets[adr].boost[0] == 0 )
+        __pushBoostNMRA(adr*2+0);
+      NMRAPacketPool.packets[adr].boost[0]=nmra_refreshboost;
+    }
     memcpy(NMRAPacketPool.packets[adr].packet,packet,packet_size);
     NMRAPacketPool.packets[adr].packet_size=packet_size;
+    /* a packet without DCC bytes can not be looked up */
+    if( dcc_size > NMRA_MAXDCC )
+      dcc_size = 0;
+    if( dcc_size > 0 )
+      memcpy(NMRAPacketPool.packets[adr].dcc,dcc,dcc_size);
+    NMRAPacketPool.packets[adr].dcc_size=dcc_size;
   }
   if( fx_packet_size > 0 ) {
+    if( fx_packet_size != NMRAPacketPool.packets[adr].fx_packet_size ||
+        memcmp(NMRAPacketPool.packets[adr].fx_packet,fx_packet,fx_packet_size) != 0 ) {
+      if( nmra_refreshboost > 0 && NMRAPacketPool.packets[adr].boost[1] == 0 )
+        __pushBoostNMRA(adr*2+1);
+      NMRAPacketPool.packets[adr].boost[1]=nmra_refreshboost;
+    }
     memcpy(NMRAPacketPool.packets[adr].fx_packet,fx_packet,fx_packet_size);
     NMRAPacketPool.packets[adr].fx_packet_size=fx_packet_size;
+    if( fx_dcc_size > NMRA_MAXDCC )
+      fx_dcc_size = 0;
+    if( fx_dcc_size > 0 )
+      memcpy(NMRAPacketPool.packets[adr].fx_dcc,fx_dcc,fx_dcc_size);
+    NMRAPacketPool.packets[adr].fx_dcc_size=fx_dcc_size;
   }
   MutexOp.post(nmra_pktpool_mutex);
 
@@ -326,6 +361,55 @@ void update_NMRAPacketPool(int adr, char *packet, int packet_size,
   }
 }
 
+void update_NMRAPacketPool(int adr, char *packet, int packet_size,
+                           char *fx_packet, int fx_packet_size) {
+  __updateNMRAPacketPool(adr, NULL, 0, packet, packet_size, NULL, 0, fx_packet, fx_packet_size);
+}
+
+void update_NMRAPacketPool_Stream(int adr,
+                                  const unsigned char *dcc, int dcc_size,
+                                  char *packet, int packet_size,
+                                  const unsigned char *fx_dcc, int fx_dcc_size,
+                                  char *fx_packet, int fx_packet_size) {
+  __updateNMRAPacketPool(adr, dcc, dcc_size, packet, packet_size, fx_dcc, fx_dcc_size, fx_packet, fx_packet_size);
+}
+
+/**
+ * Copy the serial stream of the (fx_)packet into packet if it was encoded
+ * from the same DCC bytes; returns its size or 0 if it must be encoded again.
+ */
+int get_NMRAPacketPool_Stream(int adr, int fx, const unsigned char *dcc,
+                              int dcc_size, char *packet) {
+  tNMRAPacket *p = NULL;
+  int size = 0;
+
+  if( !isNMRAPackedPoolInitialized || adr < 0 || adr > MAX_NMRA_ADDRESS )
+    return 0;
+
+  p = &NMRAPacketPool.packets[adr];
+
+  MutexOp.wait(nmra_pktpool_mutex);
+  if( fx ) {
+    if( p->fx_dcc_size == dcc_size && dcc_size > 0 && memcmp(p->fx_dcc, dcc, dcc_size) == 0 ) {
+      memcpy(packet, p->fx_packet, p->fx_packet_size);
+      size = p->fx_packet_size;
+    }
+  }
+  else {
+    if( p->dcc_size == dcc_size && dcc_size > 0 && memcmp(p->dcc, dcc, dcc_size) == 0 ) {
+      memcpy(packet, p->packet, p->packet_size);
+      size = p->packet_size;
+    }
+  }
+  MutexOp.post(nmra_pktpool_mutex);
+
+  /* the service mode and refresh code rely on zero terminated streams */
+  if( size > 0 && size < PKTSIZE )
+    memset(packet+size, 0, PKTSIZE-size);
+
+  return size;
+}
+
 /**********************************************************/
 
 /**********************************************************/
@@ -483,10 +567,42 @@ Boolean send_packet(iOSerial serial, int addr, char *packet, int packet_size, in
   return True;
 }
 
+/**
+ * Take the oldest change from the boost queue; the packet goes to the back again
+ * while it has prioritized refreshes left.
+ */
+static int __nextBoostNMRA(char* packet, int* packet_size) {
+  tNMRAPacket* p;
+  int entry, fx;
+  int adr = -1;
+
+  if( nmra_boostcnt == 0 )
+    return -1;
+
+  MutexOp.wait(nmra_pktpool_mutex);
+  if( nmra_boostcnt > 0 ) {
+    entry = nmra_boostq[nmra_boosthead];
+    nmra_boosthead = (nmra_boosthead + 1) % NMRA_BOOSTQSIZE;
+    nmra_boostcnt--;
+    adr = entry / 2;
+    fx  = entry % 2;
+    p = &NMRAPacketPool.packets[adr];
+    if( --p->boost[fx] > 0 )
+      __pushBoostNMRA(entry);
+    *packet_size = fx ? p->fx_packet_size : p->packet_size;
+    memcpy(packet, fx ? p->fx_packet : p->packet, *packet_size);
+  }
+  MutexOp.post(nmra_pktpool_mutex);
+
+  return adr;
+}
+
 int refresh_loco(iOSerial serial, locorefreshdata* locorefresh) {
 
   int adr;
   int rc = 0;
+  char packet[PKTSIZE];
+  int packet_size = 0;
 
   if (locorefresh->mm_locorefresh && (locorefresh->maerklin_refresh || !locorefresh->dcc_locorefresh)) {
     adr = MaerklinPacketPool.knownAdresses[locorefresh->last_refreshed_loco];
@@ -507,7 +623,18 @@ int refresh_loco(iOSerial serial, locorefreshdata* locorefresh) {
       }
     }
   }
-  if (locorefresh->dcc_locorefresh && (!locorefresh->maerklin_refresh || !locorefresh->mm_locorefresh)) {
+  adr = -1;
+  if (locorefresh->dcc_locorefresh && locorefresh->nmra_refreshprio &&
+      (!locorefresh->maerklin_refresh || !locorefresh->mm_locorefresh)) {
+    /* every other slot refreshes a changed packet, the round robin keeps the rest */
+    if (!locorefresh->nmra_boosted)
+      adr = __nextBoostNMRA(packet, &packet_size);
+    locorefresh->nmra_boosted = (adr>=0);
+  }
+  if (adr>=0) {
+    rc = send_packet(serial, adr, packet, packet_size, QNBLOCOPKT, True);
+  }
+  else if (locorefresh->dcc_locorefresh && (!locorefresh->maerklin_refresh || !locorefresh->mm_locorefresh)) {
     adr = NMRAPacketPool.knownAdresses[locorefresh->last_refreshed_nmra_loco];
     if (adr>=0) {
       if (locorefresh->nmra_fx_refresh<0) {
@@ -568,6 +695,8 @@ void thr_refresh_cycle(void *threadinst) {
   locorefresh.maerklin_refresh         = 0;
   locorefresh.mm_locorefresh           = data->mm;
   locorefresh.dcc_locorefresh          = data->dcc;
+  locorefresh.nmra_refreshprio         = data->refreshprio;
+  locorefresh.nmra_boosted             = 0;
 
 
 
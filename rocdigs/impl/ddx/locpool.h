@@ -32,6 +32,8 @@
 #ifndef __LOCPOOL_H__
 #define __LOCPOOL_H__
 
+#include "rocs/public/serial.h"
+
 typedef struct tLocoInfo {
   char        protocol[3];    /* possible values: "M1", .. "PS"              */
   int         addr;           /* possible values: "0000" .. "9999"           */
@@ -48,6 +50,7 @@ tLocoInfo;
 #define MAX_NMRA_ADDRESS 10367 /* idle-addr + 127 basic addr's + 10239 long's */
 
 #define ADDR14BIT_OFFSET 128   /* internal offset of the long addresses       */
+#define NMRA_MAXDCC      6     /* DCC bytes of a packet incl. error detection */
 
 typedef struct _tMaerklinPacket {
   char      packet[18];
@@ -67,6 +70,11 @@ typedef struct _tNMRAPacket {
   int       packet_size;
   char      fx_packet[PKTSIZE];
   int       fx_packet_size;
+  unsigned char dcc[NMRA_MAXDCC];    /* DCC bytes the packet was encoded from */
+  int       dcc_size;
+  unsigned char fx_dcc[NMRA_MAXDCC]; /* DCC bytes the fx_packet was encoded from */
+  int       fx_dcc_size;
+  int       boost[2];         /* prioritized refreshes left after a change, queued while > 0 */
   tLocoInfo info;
 }
 tNMRAPacket;
@@ -91,12 +99,34 @@ tLocoInfo *get_MaerklinPacketPool_LocoInfo(int addr);
 int init_NMRAPacketPool(obj inst);
 void update_NMRAPacketPool(int adr, char *packet, int packet_size,
                            char *fx_packet, int fx_packet_size);
+int get_NMRAPacketPool_Stream(int adr, int fx, const unsigned char *dcc,
+                              int dcc_size, char *packet);
+void update_NMRAPacketPool_Stream(int adr,
+                                  const unsigned char *dcc, int dcc_size,
+                                  char *packet, int packet_size,
+                                  const unsigned char *fx_dcc, int fx_dcc_size,
+                                  char *fx_packet, int fx_packet_size);
 void update_NMRAPacketPool_LocoInfo(char *protocol, int addr, int direction,
                                     int speed, int speed_max, int func,
                                     int nro_f, int f1, int f2, int f3,
                                     int f4, int f5, int f6, int f7, int f8);
 tLocoInfo *get_NMRAPacketPool_LocoInfo(int addr);
 
+typedef struct _locorefreshdata {
+  int last_refreshed_loco;
+  int last_refreshed_fx;
+  int last_refreshed_nmra_loco;
+  int nmra_fx_refresh;
+  int maerklin_refresh;
+  int mm_locorefresh;
+  int dcc_locorefresh;
+  int nmra_refreshprio;
+  int nmra_boosted;
+}
+locorefreshdata ;
+
+Boolean send_packet(iOSerial serial, int addr, char *packet, int packet_size, int packet_type, int refresh);
+int refresh_loco(iOSerial serial, locorefreshdata* locorefresh);
 void thr_refresh_cycle(void *threadinst);
 void cancel_refresh_cycle(obj inst);
 
@@ -34,44 +34,18 @@
 #include "rocs/public/system.h"
 #include "rocs/public/thread.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 //extern iOSerial COM_DEVICE;
 extern char NMRA_idle_data[];
 
-typedef struct {
-   char *pattern;
-   int  patternlength;
-   int  value;
-} tTranslateData;
-
 typedef struct {
    int  value;
    int  patternlength;
 } tTranslateData_v3;
 
-static const tTranslateData TranslateData[] = {
-    { "0"    , 1, 0xF0 },
-    { "00"   , 2, 0xC6 },
-    { "01"   , 2, 0x78 },
-    { "10"   , 2, 0xE1 },
-    { "001"  , 3, 0x66 },
-    { "010"  , 3, 0x96 },
-    { "011"  , 3, 0x5C },
-    { "100"  , 3, 0x99 },
-    { "101"  , 3, 0x71 },
-    { "110"  , 3, 0xC5 },
-    { "0111" , 4, 0x56 },
-    { "1011" , 4, 0x59 },
-    { "1101" , 4, 0x65 },
-    { "1110" , 4, 0x95 },
-    { "11111", 5, 0x55 }
-};
-
-// number of translatable patterns
-static int DataCnt = sizeof (TranslateData) / sizeof (TranslateData[0]);
-
 static const tTranslateData_v3 TranslateData_v3[32][2] = {
     {{ lLl   , 2  },{ ll   , 1  }},
     {{ lLl   , 2  },{ ll   , 1  }},
@@ -107,86 +81,81 @@ static const tTranslateData_v3 TranslateData_v3[32][2] = {
     {{ hHHHHh, 5  },{ hHHHHh, 5 }}
 };
 
-static char *preamble = "111111111111111";
-static const int STACKSIZE  = 300;
-static const int BUFFERSIZE = 360;
-
-int translateabel(char *bs) {     /* the result is only an index, no warranty */
-   int  i,size;
-   char *pbs;
-   size=strlen(bs);
-   for (i=(DataCnt-1); i>=0; i--) {
-      pbs=bs+(size-TranslateData[i].patternlength);
-      if (strcmp(pbs, TranslateData[i].pattern)==0)
-         return 1;
-   }
-   return 0;
-}
+#define BUFFERSIZE        360
+#define NMRA_PREAMBLE     15
+#define NMRA_LONGPREAMBLE 30
 
-int read_next_six_bits (char *Bitstream) {
+/* two leading one bits and at most BUFFERSIZE-1 bits of the NMRA packet */
+#define NMRABITS_MAX      (BUFFERSIZE+1)
 
-   int i, bits = 0;
-   for (i = 0; i < 6; i++)
-      bits = (bits << 1) | (*Bitstream++ == '0' ? 0 : 1);
-   return bits;
-}
+/* NMRA bitstream packed MSB first; bits behind len are always one,
+   which serves the (at most six) trailing bits of the translation */
+typedef struct {
+   unsigned char bits[NMRABITS_MAX/8+2];
+   int  len;
+} tNMRABits;
 
 
-int translateBitstream2Packetstream(char *Bitstream, char *Packetstream) {
+static void __initBits(tNMRABits* b) {
+   memset(b->bits, 0xFF, sizeof(b->bits));
+   /* one bit, because we start with a half-bit, so we have to put in the left half */
+   /* one bit, to be able, to back up one bit, if we run into a 111110 pattern */
+   b->len = 2;
+}
 
-   /* this routine assumes, that any Bitstream starts with a 1 Bit. */
-   /* This could be changed, if necessary */
+static void __addBits(tNMRABits* b, int value, int n) {
+   /* append the n low order bits of value, most significant first */
+   while (n > 0 && b->len < NMRABITS_MAX) {
+      n--;
+      if (((value >> n) & 0x01) == 0)
+         b->bits[b->len >> 3] &= ~(0x80 >> (b->len & 0x07));
+      b->len++;
+   }
+}
+
+static int __nextSixBits(const tNMRABits* b, int pos) {
+   int window = (b->bits[pos >> 3] << 8) | b->bits[(pos >> 3) + 1];
+   return (window >> (10 - (pos & 0x07))) & 0x3F;
+}
 
-   char Buffer[BUFFERSIZE+20];  /* keep room for additional pre and postamble */
-   char *read_ptr = Buffer+1;   /* here the real sequence starts */
 
-   char *restart_read = Buffer; /* one more 1 in the beginning for successful restart */
-   char *last_restart = Buffer-1; /* this necessary, only to verify our assumptions */
+static int __translateBits(const tNMRABits* b, char *Packetstream) {
 
-   char *buf_end;
+   int  read_pos = 0;        /* here the real sequence starts */
+   int  restart_read = 0;    /* one more 1 in the beginning for successful restart */
+   int  last_restart = -1;   /* this necessary, only to verify our assumptions */
 
    int  restart_packet = 0;
    int  generate_packet = 0;
 
    int  second_try = False;
    int  act_six;
-
-   read_ptr = strcpy (Buffer, "11");
-
-   /* one bit, because we start with a half-bit, so we have to put in the left half */
-   /* one bit, to be able, to back up one bit, if we run into a 111110 pattern */
-
-   strncat (Buffer, Bitstream, BUFFERSIZE-1);
-
-   buf_end = Buffer + strlen (Buffer);  /* for simply testing, whether our job is done */
-
-   strcat (Buffer, "111111");
-
-   /* at most six trailing bits are possibly necessary */
+   const tTranslateData_v3* t;
 
    memset(Packetstream, 0, PKTSIZE);
 
-   while (generate_packet < PKTSIZE && read_ptr < buf_end) {
-      act_six = read_next_six_bits (read_ptr);
+   while (generate_packet < PKTSIZE && read_pos < b->len) {
+      act_six = __nextSixBits(b, read_pos);
       if (act_six == 0x3e /* 111110*/){/*did we reach an untranslateble value */
           /* try again from last position, where a shorter translation */
           /* could be choosen                                          */
           second_try = True;
           generate_packet = restart_packet;
           if (restart_read == last_restart)
-          TraceOp.trc( __FILE__, TRCLEVEL_MONITOR, __LINE__, 9999, "sorry, restart algorithm doesn't work as expected for NMRA-Packet %s", Bitstream);
+          TraceOp.trc( __FILE__, TRCLEVEL_MONITOR, __LINE__, 9999, "sorry, restart algorithm doesn't work as expected for NMRA-Packet at bit %d", read_pos);
           last_restart = restart_read;
-          read_ptr = restart_read;
-          act_six = read_next_six_bits (read_ptr);
+          read_pos = restart_read;
+          act_six = __nextSixBits(b, read_pos);
       }
 
-      Packetstream[generate_packet] = TranslateData_v3[act_six >> 1][second_try ? 1 : 0]. value;
+      t = &TranslateData_v3[act_six >> 1][second_try ? 1 : 0];
+      Packetstream[generate_packet] = t->value;
 
       if (act_six < 0x3e /* 111110*/) { /* is translation fixed upto here ? */
          restart_packet = generate_packet;
-         restart_read = read_ptr;
+         restart_read = read_pos;
       }
-      read_ptr += TranslateData_v3[act_six >> 1][second_try ? 1 : 0]. patternlength;
+      read_pos += t->patternlength;
       generate_packet ++;
       second_try = False;
    }
@@ -195,101 +164,99 @@ int translateBitstream2Packetstream(char *Bitstream, char *Packetstream) {
 }
 
 
-/*** some useful functions to calculate NMRA-DCC bytes (char arrays) ***/
+int translateBitstream2Packetstream(char *Bitstream, char *Packetstream) {
 
-void calc_7bit_address_byte(char *byte, int address) {
-   /* calculating address byte: 0AAAAAAA */
+   /* this routine assumes, that any Bitstream starts with a 1 Bit. */
+   /* This could be changed, if necessary */
 
-   int i,j;
+   tNMRABits b;
+   int i;
 
-   memset(byte, 0, 9);
-   byte[0]='0';
-   for (i=7; i>0; i--) {
-      j=address%2;
-      address=address/2;
-      switch (j) {
-         case 0: byte[i]='0'; break;
-         case 1: byte[i]='1'; break;
-      }
-   }
+   __initBits(&b);
+   for (i = 0; Bitstream[i] != '\0' && i < BUFFERSIZE-1; i++)
+      __addBits(&b, Bitstream[i] == '0' ? 0 : 1, 1);
+
+   return __translateBits(&b, Packetstream);
 }
 
-void calc_14bit_address_byte(char *byte1, char *byte2, int address) {
-   /* calculating address bytes: 11AAAAAA AAAAAAAA */
-
-   int i,j;
-
-   memset(byte1, 0, 9);
-   memset(byte2, 0, 9);
-   byte1[0]='1';
-   byte1[1]='1';
-   for (i=13; i>=0; i--) {
-      j=address%2;
-      address=address/2;
-      if (i>=6) {
-         switch (j) { // set bit 7 to bit 0 of addr-byte 2
-            case 0: byte2[i-6]='0'; break;
-            case 1: byte2[i-6]='1'; break;
-         }
-      }
-      else {
-         switch (j) { // set bit 7 to bit 2 of addr-byte 1
-            case 0: byte1[2+i]='0'; break;
-            case 1: byte1[2+i]='1'; break;
-         }
-      }
-   }
+
+/**
+ * Encode the DCC bytes, including the error detection byte, as
+ * preamble, start bits, data bytes and packet end bit into a serial packet stream.
+ */
+static int __encodeNMRA(const unsigned char* dcc, int size, int preamble, char* Packetstream) {
+   tNMRABits b;
+   int i;
+
+   __initBits(&b);
+   b.len += preamble; /* the bits are preset to one */
+   for (i = 0; i < size; i++)
+      __addBits(&b, dcc[i], 9); /* packet start bit 0 and data byte */
+   __addBits(&b, 1, 1);         /* packet end bit */
+
+   return __translateBits(&b, Packetstream);
 }
 
-void calc_baseline_speed_byte(char *byte, int direction, int speed) {
-   /* calculating speed byte2: 01DUSSSS  */
 
-   int i,j;
+/**
+ * Take the serial stream out of the packet pool if it was already encoded
+ * for the same DCC bytes, otherwise encode it.
+ */
+static int __streamNMRA(int adr, int fx, const unsigned char* dcc, int size, char* Packetstream) {
+   int j = get_NMRAPacketPool_Stream(adr, fx, dcc, size, Packetstream);
+   if (j == 0)
+      j = __encodeNMRA(dcc, size, NMRA_PREAMBLE, Packetstream);
+   return j;
+}
 
-   memset(byte, 0, 9);
-   byte[0]='0';  byte[1]='1';
-   byte[3]='1';
-   if (direction==1) byte[2]='1'; else byte[2]='0';
 
-   for (i=7; i>3; i--) {
-      j=speed%2;
-      speed=speed/2;
-      switch (j) {
-         case 0: byte[i]='0'; break;
-         case 1: byte[i]='1'; break;
-      }
+/*** some useful functions to calculate NMRA-DCC bytes ***/
+
+static int __dccAddress(unsigned char* dcc, int address, int longaddr) {
+   if (longaddr) {
+      /* calculating address bytes: 11AAAAAA AAAAAAAA */
+      dcc[0] = 0xC0 | ((address >> 8) & 0x3F);
+      dcc[1] = address & 0xFF;
+      return 2;
    }
+   /* calculating address byte: 0AAAAAAA */
+   dcc[0] = address & 0x7F;
+   return 1;
 }
 
-void calc_28spst_speed_byte(char *byte, int direction, int speed) {
-   /* calculating speed byte: 01DSSSSS */
-
-   int i,j;
+static unsigned char __dccBaselineSpeed(int direction, int speed) {
+   /* calculating speed byte2: 01DUSSSS  */
+   return 0x40 | (direction == 1 ? 0x20 : 0x00) | 0x10 | (speed & 0x0F);
+}
 
-   memset(byte, 0, 9);
-   byte[0]='0';  byte[1]='1';
-   if (direction == 1) byte[2]='1'; else byte[2]='0';
-   if (speed>1) {
-      if (speed % 2 == 1)  {
-         byte[3]='1';
+static unsigned char __dcc28Speed(int direction, int speed) {
+   /* calculating speed byte: 01DCSSSS */
+   int c = 0;
+   if (speed > 1) {
+      if (speed % 2 == 1) {
+         c = 1;
          speed = (speed+1) / 2;
       }
       else {
-         byte[3]='0';
          speed = (speed+2) / 2;
       }
    }
-   else {
-      byte[3]='0';
-   }
-   for (i=7; i>3; i--) {
-      j=speed%2;
-      speed=speed/2;
-      switch (j) {
-         case 0: byte[i]='0'; break;
-         case 1: byte[i]='1'; break;
-      }
-   }
+   return 0x40 | (direction == 1 ? 0x20 : 0x00) | (c << 4) | (speed & 0x0F);
+}
+
+static int __dcc128Speed(unsigned char* dcc, int direction, int speed) {
+   /* advanced operations instruction: 00111111 DSSSSSSS */
+   dcc[0] = 0x3F;
+   dcc[1] = (direction == 1 ? 0x80 : 0x00) | (speed & 0x7F);
+   return 2;
+}
+
+static int __dccFunctionBits(int* f, int hi, int lo) {
+   /* f[hi] ends up in the most significant bit */
+   int i, bits = 0;
+   for (i = hi; i >= lo; i--)
+      bits = (bits << 1) | (f[i] == 1 ? 1 : 0);
+   return bits;
 }
 
 /**
@@ -324,173 +291,62 @@ void calc_28spst_speed_byte(char *byte, int direction, int speed) {
  * CCCCC = 11111:  F21-F28 Function Control
  * The least significant bit (Bit 0) controlling F21, and the most significant bit (bit 7) controlling F28.
  */
-void calc_function_group(char* byte1, char* byte2, int group, int* f) {
-   /* calculating function byte:
+static int __dccFunctionGroup(unsigned char* dcc, int group, int* f) {
+   /* calculating function bytes:
     * group 0 = f0-f4, 1 = f5-f8, 2 = f9-12, 3 = f13-16, 4 = f17-20, 5 = f21-24, 6 = f25-28
+    * returns the number of bytes, 0 for an unknown group
     */
 
   if( group > 0 )
     group--; /* function group from Rocview starts with 1 */
   TraceOp.trc( "nmra", TRCLEVEL_MONITOR, __LINE__, 9999,"function group %d", group);
 
-  if( byte2 == NULL && group > 2 ) {
-    TraceOp.trc( "nmra", TRCLEVEL_WARNING, __LINE__, 9999,"no byte reserved for function group %d", group);
-    return;
+  switch( group ) {
+    case 0:
+      dcc[0] = 0x80 | (f[0] == 1 ? 0x10 : 0x00) | __dccFunctionBits(f, 4, 1);
+      return 1;
+    case 1:
+      dcc[0] = 0xB0 | __dccFunctionBits(f, 8, 5);
+      return 1;
+    case 2:
+      dcc[0] = 0xA0 | __dccFunctionBits(f, 12, 9);
+      return 1;
+    case 3:
+    case 4:
+      dcc[0] = 0xDE;
+      dcc[1] = __dccFunctionBits(f, 20, 13);
+      return 2;
+    case 5:
+    case 6:
+      dcc[0] = 0xDF;
+      dcc[1] = __dccFunctionBits(f, 28, 21);
+      return 2;
   }
 
-   if( group == 0 ) {
-     byte1[0] ='1';
-     byte1[1] ='0';
-     byte1[2] ='0';
-     byte1[3] = f[0]==1 ? '1':'0'; /* F0*/
-     byte1[4] = f[4]==1 ? '1':'0';
-     byte1[5] = f[3]==1 ? '1':'0';
-     byte1[6] = f[2]==1 ? '1':'0';
-     byte1[7] = f[1]==1 ? '1':'0';
-     byte1[8] = 0;
-   }
-   else if( group == 1 ) {
-     byte1[0] = '1';
-     byte1[1] = '0';
-     byte1[2] = '1';
-     byte1[3] = '1'; /* F5-F8*/
-     byte1[4] = f[8]==1 ? '1':'0';
-     byte1[5] = f[7]==1 ? '1':'0';
-     byte1[6] = f[6]==1 ? '1':'0';
-     byte1[7] = f[5]==1 ? '1':'0';
-     byte1[8] = 0;
-   }
-   else if( group == 2 ) {
-     byte1[0] = '1';
-     byte1[1] = '0';
-     byte1[2] = '1';
-     byte1[3] = '0'; /* F9-F12*/
-     byte1[4] = f[12]==1 ? '1':'0';
-     byte1[5] = f[11]==1 ? '1':'0';
-     byte1[6] = f[10]==1 ? '1':'0';
-     byte1[7] = f[ 9]==1 ? '1':'0';
-     byte1[8] = 0;
-   }
-   else if( group == 3 || group == 4 ) {
-     byte1[0] = '1';
-     byte1[1] = '1';
-     byte1[2] = '0';
-     byte1[3] = '1';
-     byte1[4] = '1';
-     byte1[5] = '1';
-     byte1[6] = '1';
-     byte1[7] = '0';
-     byte1[8] = 0;
-     byte2[0] = f[20]==1 ? '1':'0';
-     byte2[1] = f[19]==1 ? '1':'0';
-     byte2[2] = f[18]==1 ? '1':'0';
-     byte2[3] = f[17]==1 ? '1':'0';
-     byte2[4] = f[16]==1 ? '1':'0';
-     byte2[5] = f[15]==1 ? '1':'0';
-     byte2[6] = f[14]==1 ? '1':'0';
-     byte2[7] = f[13]==1 ? '1':'0';
-     byte2[8] = 0;
-   }
-   else if( group == 5 || group == 6 ) {
-     byte1[0] = '1';
-     byte1[1] = '1';
-     byte1[2] = '0';
-     byte1[3] = '1';
-     byte1[4] = '1';
-     byte1[5] = '1';
-     byte1[6] = '1';
-     byte1[7] = '1';
-     byte1[8] = 0;
-     byte2[0] = f[28]==1 ? '1':'0';
-     byte2[1] = f[27]==1 ? '1':'0';
-     byte2[2] = f[26]==1 ? '1':'0';
-     byte2[3] = f[25]==1 ? '1':'0';
-     byte2[4] = f[24]==1 ? '1':'0';
-     byte2[5] = f[23]==1 ? '1':'0';
-     byte2[6] = f[22]==1 ? '1':'0';
-     byte2[7] = f[21]==1 ? '1':'0';
-     byte2[8] = 0;
-   }
-   TraceOp.trc( "nmra", TRCLEVEL_BYTE, __LINE__, 9999,"function datagram %s %s", byte1, byte2!=NULL?byte2:"");
-}
-
-void calc_128spst_adv_op_bytes(char *byte1, char *byte2,
-                               int direction, int speed) {
-
-   int i,j;
-
-   memset(byte1, 0, 9);
-   memset(byte2, 0, 9);
-   strcpy(byte1, "00111111");
-   if (direction == 1) byte2[0]='1'; else byte2[0]='0';
-   for (i=7; i>0; i--) {
-      j=speed%2;
-      speed=speed/2;
-      switch (j) {
-         case 0: byte2[i]='0'; break;
-         case 1: byte2[i]='1'; break;
-      }
-   }
+  TraceOp.trc( "nmra", TRCLEVEL_WARNING, __LINE__, 9999,"unsupported function group %d", group);
+  return 0;
 }
 
-void calc_acc_address_byte(char *byte, char *rest, int address) {
-   /* calculating address byte: 10AAAAAA , returning rest */
-
-   int i,j;
-   char dummy[10];
-
-   memset(dummy,0,10);
-   for (i=8; i>=0; i--) {
-      j=address%2;
-      address=address/2;
-      switch (j) {
-         case 0: dummy[i]='0'; break;
-         case 1: dummy[i]='1'; break;
-      }
-   }
-   memset(byte, 0, 9);
-   byte[0]='1'; byte[1]='0';
-   for (i=8; i>2; i--) {
-      byte[i-1]=dummy[i];
-   }
-   memset(rest, 0, 3);
-   for (i=2; i>=0; i--) rest[i]=dummy[i];
-}
-
-void calc_acc_instr_byte(char *byte, char *rest, int activate, int pairnr, int output) {
-
+static int __dccErrorByte(unsigned char* dcc, int size) {
+   /* appending error detection byte: EEEEEEEE */
    int i;
-
-   memset(byte, 0, 9);
-   if (output)   byte[7]='1'; else byte[7]='0';
-   if (activate) byte[4]='1'; else byte[4]='0';
-   switch (pairnr) {
-      case  0: byte[6]='0'; byte[5]='0'; break;
-      case  1: byte[6]='1'; byte[5]='0'; break;
-      case  2: byte[6]='0'; byte[5]='1'; break;
-      case  3: byte[6]='1'; byte[5]='1'; break;
-      default: byte[6]='0'; byte[5]='0'; break;
-   }
-   for (i=3; i>0; i--) {
-      switch (rest[i-1]) {
-         case '0': byte[i]='1'; break;
-         case '1': byte[i]='0'; break;
-         default : byte[i]='1'; break;
-      }
-   }
-   byte[0]='1';
+   unsigned char err = 0;
+   for (i = 0; i < size; i++)
+      err ^= dcc[i];
+   dcc[size] = err;
+   return size + 1;
 }
 
-void xor_two_bytes(char *byte, char *byte1, char *byte2) {
-
+static void __traceDCC(const char* what, const unsigned char* dcc, int size) {
+   char hex[NMRA_MAXDCC*3+1];
    int i;
-
-   memset(byte, 0, 9);
-   for (i=0; i<8; i++) {
-      if (byte1[i]==byte2[i]) byte[i]='0'; else byte[i]='1';
-   }
+   for (i = 0; i < size && i < NMRA_MAXDCC; i++)
+      sprintf(hex + i*3, "%02X ", dcc[i]);
+   hex[i*3] = '\0';
+   TraceOp.trc( "nmra", TRCLEVEL_BYTE, __LINE__, 9999, "%s: %s", what, hex);
 }
 
+
 /*** functions to generate NMRA-DCC data packets ***/
 /**
  * address 1...1023
@@ -499,15 +355,10 @@ void xor_two_bytes(char *byte, char *byte1, char *byte2) {
  */
 int comp_nmra_accessory(int address, int pairnr, int gate, int activate) {
 
-   char byte1[9];
-   char byte2[9];
-   char byte3[9];
-   char bitstream[BUFFERSIZE];
+   unsigned char dcc[3];
    char packetstream[PKTSIZE];
    char *p_packetstream;
 
-   char rest[3];
-
    int j;
 
    if( address < 0 || pairnr < 1 || pairnr > 4 || gate < 0 || gate > 1 ) {
@@ -525,24 +376,13 @@ int comp_nmra_accessory(int address, int pairnr, int gate, int activate) {
       /* packet is not available */
       p_packetstream=packetstream;
 
-      calc_acc_address_byte(byte1, rest, address);
-
-      calc_acc_instr_byte(byte2, rest, activate, pairnr-1, gate);
+      /* 10AAAAAA 1AAACDDD: the upper three address bits are sent inverted */
+      dcc[0] = 0x80 | (address & 0x3F);
+      dcc[1] = 0x80 | (((~(address >> 6)) & 0x07) << 4) | (activate ? 0x08 : 0x00) |
+               (((pairnr-1) & 0x03) << 1) | (gate ? 0x01 : 0x00);
+      __dccErrorByte(dcc, 2);
 
-      xor_two_bytes(byte3, byte2, byte1);
-
-      /* putting all together in a 'bitstream' (char array) */
-      memset(bitstream, 0, 100);
-      strcat(bitstream, preamble);
-      strcat(bitstream, "0");
-      strcat(bitstream, byte1);
-      strcat(bitstream, "0");
-      strcat(bitstream, byte2);
-      strcat(bitstream, "0");
-      strcat(bitstream, byte3);
-      strcat(bitstream, "1");
-
-      j=translateBitstream2Packetstream(bitstream, packetstream);
+      j=__encodeNMRA(dcc, 3, NMRA_PREAMBLE, packetstream);
    }
 
    if (j>0) {
@@ -556,14 +396,11 @@ int comp_nmra_accessory(int address, int pairnr, int gate, int activate) {
 
 int comp_nmra_baseline(int address, int direction, int speed) {
 
-   char byte1[9];
-   char byte2[9];
-   char byte3[9];
-   char bitstream[BUFFERSIZE];
+   unsigned char dcc[NMRA_MAXDCC];
    char packetstream[PKTSIZE];
 
    int adr       = 0;
-   int j;
+   int n,j;
 
    adr=address;
 
@@ -572,25 +409,14 @@ int comp_nmra_baseline(int address, int direction, int speed) {
        speed<0 || speed>15)
       return 1;
 
-   calc_7bit_address_byte(byte1, address);
-   calc_baseline_speed_byte(byte2,direction,speed);
-   xor_two_bytes(byte3, byte2, byte1);
-
-   /* putting all together in a 'bitstream' (char array) */
-   memset(bitstream, 0, 100);
-   strcat(bitstream, preamble);
-   strcat(bitstream, "0");
-   strcat(bitstream, byte1);
-   strcat(bitstream, "0");
-   strcat(bitstream, byte2);
-   strcat(bitstream, "0");
-   strcat(bitstream, byte3);
-   strcat(bitstream, "1");
+   n = __dccAddress(dcc, address, False);
+   dcc[n++] = __dccBaselineSpeed(direction, speed);
+   n = __dccErrorByte(dcc, n);
 
-   j=translateBitstream2Packetstream(bitstream, packetstream);
+   j=__streamNMRA(adr, False, dcc, n, packetstream);
 
    if (j>0) {
-      update_NMRAPacketPool(adr,packetstream,j,packetstream,j);
+      update_NMRAPacketPool_Stream(adr,dcc,n,packetstream,j,dcc,n,packetstream,j);
       queue_add(adr, packetstream,QNBLOCOPKT,j);
 
       return 0;
@@ -600,187 +426,88 @@ int comp_nmra_baseline(int address, int direction, int speed) {
 }
 
 
-/* function-decoder with 7-bit address */
-int comp_nmra_fb7(int address, int group, int* f) {
+/* function-decoder with 7 or 14-bit address */
+static int __compNMRAFunction(int address, int longaddr, int group, int* f) {
 
-   char addrbyte[9] = {0};
-   char funcbyte[9] = {0};
-   char funcbyte2[9] = {0};
-   char errdbyte[9] = {0};
-   char bitstream[BUFFERSIZE];
+   unsigned char dcc[NMRA_MAXDCC];
    char packetstream[PKTSIZE];
 
-   int adr = 0;
-   int i,j;
+   int adr = longaddr ? address+ADDR14BIT_OFFSET : address;
+   int n,fn,j;
 
-   adr=address;
-   /* no special error handling, it's job of the clients */
-   if (address<1 || address>127 )
+   n = __dccAddress(dcc, address, longaddr);
+   fn = __dccFunctionGroup(dcc+n, group, f);
+   if (fn == 0)
       return 1;
+   n = __dccErrorByte(dcc, n+fn);
 
-   calc_7bit_address_byte(addrbyte, address);
-   calc_function_group(funcbyte, funcbyte2, group, f);
-
-   xor_two_bytes(errdbyte, addrbyte, funcbyte);
-
-
-   /* putting all together in a 'bitstream' (char array) (functions) */
-   memset(bitstream, 0, 100);
-   strcat(bitstream, preamble);
-   strcat(bitstream, "0");
-   strcat(bitstream, addrbyte);
-   strcat(bitstream, "0");
-   strcat(bitstream, funcbyte);
-   strcat(bitstream, "0");
-   if(funcbyte2[0] != 0 ) {
-     char tmp[9] = {0};
-     strcpy( tmp, errdbyte );
-     xor_two_bytes(errdbyte, tmp, funcbyte2);
-     strcat(bitstream, funcbyte2);
-     strcat(bitstream, "0");
-     TraceOp.trc( "nmra", TRCLEVEL_BYTE, __LINE__, 9999,
-         "extended function group %d, errdbyte=%s", group, errdbyte);
-   }
-   strcat(bitstream, errdbyte);
-   strcat(bitstream, "1");
-
-   TraceOp.trc( "nmra", TRCLEVEL_BYTE, __LINE__, 9999,
-       "7 bit addr bitstream: %s", bitstream);
+   __traceDCC(longaddr ? "14 bit addr function packet":"7 bit addr function packet", dcc, n);
 
-   j=translateBitstream2Packetstream(bitstream, packetstream);
+   j=__streamNMRA(adr, True, dcc, n, packetstream);
 
    if (j>0) {
-      update_NMRAPacketPool(adr,NULL,0,packetstream,j);
+      update_NMRAPacketPool_Stream(adr,NULL,0,NULL,0,dcc,n,packetstream,j);
       queue_add(adr,packetstream,QNBLOCOPKT,j);
       return 0;
    }
 
    return 1;
 }
-/* function-decoder with 14-bit address */
-int comp_nmra_fb14(int address, int group, int* f) {
-
-   char addrbyte1[9] = {0};
-   char addrbyte2[9] = {0};
-   char funcbyte[9] = {0};
-   char funcbyte2[9] = {0};
-   char errdbyte[9] = {0};
-   char dummy[9] = {0};
-   char bitstream[BUFFERSIZE];
-   char packetstream[PKTSIZE];
 
-   int adr       = 0;
-   int i,j;
-
-   adr=address;
+/* function-decoder with 7-bit address */
+int comp_nmra_fb7(int address, int group, int* f) {
+   /* no special error handling, it's job of the clients */
+   if (address<1 || address>127 )
+      return 1;
+   return __compNMRAFunction(address, False, group, f);
+}
 
+/* function-decoder with 14-bit address */
+int comp_nmra_fb14(int address, int group, int* f) {
    /* no special error handling, it's job of the clients */
    if (address<1 || address>10239)
       return 1;
-
-   calc_14bit_address_byte(addrbyte1, addrbyte2, address);
-   calc_function_group(funcbyte, funcbyte2, group, f);
-
-   xor_two_bytes(dummy, addrbyte1, addrbyte2);
-   xor_two_bytes(errdbyte, dummy, funcbyte);
-
-
-   /* putting all together in a 'bitstream' (char array) (functions) */
-   memset(bitstream, 0, 100);
-   strcat(bitstream, preamble);
-   strcat(bitstream, "0");
-   strcat(bitstream, addrbyte1);
-   strcat(bitstream, "0");
-   strcat(bitstream, addrbyte2);
-   strcat(bitstream, "0");
-   strcat(bitstream, funcbyte);
-   strcat(bitstream, "0");
-   if(funcbyte2[0] != 0 ) {
-     char tmp[9] = {0};
-     strcpy( tmp, errdbyte );
-     xor_two_bytes(errdbyte, tmp, funcbyte2);
-     strcat(bitstream, funcbyte2);
-     strcat(bitstream, "0");
-   }
-   strcat(bitstream, errdbyte);
-   strcat(bitstream, "1");
-
-   TraceOp.trc( "nmra", TRCLEVEL_BYTE, __LINE__, 9999,
-       "14 bit addr bitstream: %s", bitstream);
-
-   j=translateBitstream2Packetstream(bitstream, packetstream);
-
-   if (j>0) {
-      update_NMRAPacketPool(adr+ADDR14BIT_OFFSET,NULL,0,packetstream,j);
-      queue_add(adr+ADDR14BIT_OFFSET,packetstream,QNBLOCOPKT,j);
-      return 0;
-   }
-
-   return 1;
+   return __compNMRAFunction(address, True, group, f);
 }
 
 
+/* 4-function-decoder with 7 or 14-bit address and 28 or 128 speed steps */
+static int __compNMRALoco(int address, int longaddr, int direction, int speed, int steps128, int* f) {
 
-int comp_nmra_f4b7s28(int address, int direction, int speed, int *f) {
-     /* 4-function-decoder with 7-bit address and 28 speed steps */
-     /* N1 001 1 18 1 0 0 0 0                                    */
-
-   char addrbyte[9];
-   char spdrbyte[9];
-   char funcbyte[18];
-   char errdbyte[9];
-   char bitstream[BUFFERSIZE];
-   char bitstream2[BUFFERSIZE];
+   unsigned char dcc[NMRA_MAXDCC];
+   unsigned char fx_dcc[NMRA_MAXDCC];
    char packetstream[PKTSIZE];
    char packetstream2[PKTSIZE];
 
-   int adr       = 0;
-   int i,j,jj;
-
-   adr=address;
+   int adr = longaddr ? address+ADDR14BIT_OFFSET : address;
+   int i,n,fn,j,jj;
 
    /* no special error handling, it's job of the clients */
-   if (address<1 || address>127 || direction<0 || direction>1 ||
-       speed<0 || speed>28)
+   if (address<1 || address>(longaddr?10239:127) || direction<0 || direction>1 ||
+       speed<0 || speed>(steps128?128:28))
       return 1;
    for (i=0; i<5; i++)
       if (f[i]<0 || f[i]>1)
          return 1;
 
-   calc_7bit_address_byte(addrbyte, address);
-   calc_28spst_speed_byte(spdrbyte, direction, speed);
-   calc_function_group(funcbyte, NULL, 0, f);
-   xor_two_bytes(errdbyte, addrbyte, spdrbyte);
-
-   /* putting all together in a 'bitstream' (char array) (speed & direction) */
-   memset(bitstream, 0, 100);
-   strcat(bitstream, preamble);
-   strcat(bitstream, "0");
-   strcat(bitstream, addrbyte);
-   strcat(bitstream, "0");
-   strcat(bitstream, spdrbyte);
-   strcat(bitstream, "0");
-   strcat(bitstream, errdbyte);
-   strcat(bitstream, "1");
-
-   xor_two_bytes(errdbyte, addrbyte, funcbyte);
-
-   /* putting all together in a 'bitstream' (char array) (functions) */
-   memset(bitstream2, 0, 100);
-   strcat(bitstream2, preamble);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, addrbyte);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, funcbyte);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, errdbyte);
-   strcat(bitstream2, "1");
-
-   j=translateBitstream2Packetstream(bitstream, packetstream);
-   jj=translateBitstream2Packetstream(bitstream2, packetstream2);
+   /* speed & direction */
+   n = __dccAddress(dcc, address, longaddr);
+   if (steps128)
+      n += __dcc128Speed(dcc+n, direction, speed);
+   else
+      dcc[n++] = __dcc28Speed(direction, speed);
+   n = __dccErrorByte(dcc, n);
+
+   /* functions */
+   fn = __dccAddress(fx_dcc, address, longaddr);
+   fn += __dccFunctionGroup(fx_dcc+fn, 0, f);
+   fn = __dccErrorByte(fx_dcc, fn);
+
+   j=__streamNMRA(adr, False, dcc, n, packetstream);
+   jj=__streamNMRA(adr, True, fx_dcc, fn, packetstream2);
 
    if (j>0 && jj>0) {
-      update_NMRAPacketPool(adr,packetstream,j,packetstream2,jj);
+      update_NMRAPacketPool_Stream(adr,dcc,n,packetstream,j,fx_dcc,fn,packetstream2,jj);
       queue_add(adr,packetstream,QNBLOCOPKT,j);
       queue_add(adr,packetstream2,QNBLOCOPKT,jj);
 
@@ -790,237 +517,28 @@ int comp_nmra_f4b7s28(int address, int direction, int speed, int *f) {
    return 1;
 }
 
+int comp_nmra_f4b7s28(int address, int direction, int speed, int *f) {
+     /* 4-function-decoder with 7-bit address and 28 speed steps */
+     /* N1 001 1 18 1 0 0 0 0                                    */
+   return __compNMRALoco(address, False, direction, speed, False, f);
+}
+
 int comp_nmra_f4b7s128(int address, int direction, int speed, int* f) {
      /* 4-function-decoder with 7-bit address and 128 speed steps */
      /* N2 001 1 057 1 0 0 0 0                                    */
-
-   char addrbyte[9];
-   char spdrbyte1[9];
-   char spdrbyte2[9];
-   char funcbyte[18];
-   char errdbyte[9];
-   char dummy[9];
-   char bitstream[BUFFERSIZE];
-   char bitstream2[BUFFERSIZE];
-   char packetstream[PKTSIZE];
-   char packetstream2[PKTSIZE];
-
-   int adr       = 0;
-   int i,j,jj;
-
-   adr=address;
-
-   /* no special error handling, it's job of the clients */
-   if (address<1 || address>127 || direction<0 || direction>1 ||
-       speed<0 || speed>128)
-      return 1;
-   for (i=0; i<5; i++)
-      if (f[i]<0 || f[i]>1)
-         return 1;
-
-   calc_7bit_address_byte(addrbyte, address);
-   calc_128spst_adv_op_bytes(spdrbyte1, spdrbyte2, direction, speed);
-   calc_function_group(funcbyte, NULL, 0, f);
-   xor_two_bytes(dummy, addrbyte, spdrbyte1);
-   xor_two_bytes(errdbyte, dummy, spdrbyte2);
-
-   /* putting all together in a 'bitstream' (char array) (speed & direction) */
-   memset(bitstream, 0, 100);
-   strcat(bitstream, preamble);
-   strcat(bitstream, "0");
-   strcat(bitstream, addrbyte);
-   strcat(bitstream, "0");
-   strcat(bitstream, spdrbyte1);
-   strcat(bitstream, "0");
-   strcat(bitstream, spdrbyte2);
-   strcat(bitstream, "0");
-   strcat(bitstream, errdbyte);
-   strcat(bitstream, "1");
-
-   xor_two_bytes(errdbyte, addrbyte, funcbyte);
-
-   /* putting all together in a 'bitstream' (char array) (functions) */
-   memset(bitstream2, 0, 100);
-   strcat(bitstream2, preamble);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, addrbyte);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, funcbyte);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, errdbyte);
-   strcat(bitstream2, "1");
-
-   j=translateBitstream2Packetstream(bitstream, packetstream);
-   jj=translateBitstream2Packetstream(bitstream2, packetstream2);
-
-   if (j>0 && jj>0) {
-      update_NMRAPacketPool(adr,packetstream,j,packetstream2,jj);
-      queue_add(adr,packetstream,QNBLOCOPKT,j);
-      queue_add(adr,packetstream2,QNBLOCOPKT,jj);
-
-      return 0;
-   }
-
-   return 1;
+   return __compNMRALoco(address, False, direction, speed, True, f);
 }
 
 int comp_nmra_f4b14s28(int address, int direction, int speed, int* f) {
      /* 4-function-decoder with 14-bit address and 28 speed steps */
      /* N3 0001 1 18 1 0 0 0 0                                    */
-
-   char addrbyte1[9];
-   char addrbyte2[9];
-   char spdrbyte[9];
-   char funcbyte[18];
-   char errdbyte[9];
-   char dummy[9];
-   char bitstream[BUFFERSIZE];
-   char bitstream2[BUFFERSIZE];
-   char packetstream[PKTSIZE];
-   char packetstream2[PKTSIZE];
-
-   int adr       = 0;
-   int i,j,jj;
-
-   adr=address;
-
-   /* no special error handling, it's job of the clients */
-   if (address<1 || address>10239 || direction<0 || direction>1 ||
-       speed<0 || speed>28)
-      return 1;
-   for (i=0; i<5; i++)
-      if (f[i]<0 || f[i]>1)
-         return 1;
-
-   calc_14bit_address_byte(addrbyte1, addrbyte2, address);
-   calc_28spst_speed_byte(spdrbyte, direction, speed);
-   calc_function_group(funcbyte, NULL, 0, f);
-
-   xor_two_bytes(dummy, addrbyte1, addrbyte2);
-   xor_two_bytes(errdbyte, dummy, spdrbyte);
-
-   /* putting all together in a 'bitstream' (char array) (speed & direction) */
-   memset(bitstream, 0, 100);
-   strcat(bitstream, preamble);
-   strcat(bitstream, "0");
-   strcat(bitstream, addrbyte1);
-   strcat(bitstream, "0");
-   strcat(bitstream, addrbyte2);
-   strcat(bitstream, "0");
-   strcat(bitstream, spdrbyte);
-   strcat(bitstream, "0");
-   strcat(bitstream, errdbyte);
-   strcat(bitstream, "1");
-
-   xor_two_bytes(dummy, addrbyte1, addrbyte2);
-   xor_two_bytes(errdbyte, dummy, funcbyte);
-
-   /* putting all together in a 'bitstream' (char array) (functions) */
-   memset(bitstream2, 0, 100);
-   strcat(bitstream2, preamble);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, addrbyte1);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, addrbyte2);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, funcbyte);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, errdbyte);
-   strcat(bitstream2, "1");
-
-   j=translateBitstream2Packetstream(bitstream, packetstream);
-   jj=translateBitstream2Packetstream(bitstream2, packetstream2);
-
-   if (j>0 && jj>0) {
-      update_NMRAPacketPool(adr+ADDR14BIT_OFFSET,packetstream,j,packetstream2,jj);
-      queue_add(adr+ADDR14BIT_OFFSET,packetstream,QNBLOCOPKT,j);
-      queue_add(adr+ADDR14BIT_OFFSET,packetstream2,QNBLOCOPKT,jj);
-
-      return 0;
-   }
-
-   return 1;
+   return __compNMRALoco(address, True, direction, speed, False, f);
 }
 
 int comp_nmra_f4b14s128(int address, int direction, int speed, int* f) {
      /* 4-function-decoder with 14-bit address and 128 speed steps */
      /* N4 001 1 057 1 0 0 0 0                                    */
-
-   char addrbyte1[9];
-   char addrbyte2[9];
-   char spdrbyte1[9];
-   char spdrbyte2[9];
-   char funcbyte[18];
-   char errdbyte[9];
-   char dummy[9];
-   char bitstream[BUFFERSIZE];
-   char bitstream2[BUFFERSIZE];
-   char packetstream[PKTSIZE];
-   char packetstream2[PKTSIZE];
-
-   int adr       = 0;
-   int i,j,jj;
-
-   adr=address;
-
-   /* no special error handling, it's job of the clients */
-   if (address<1 || address>10239 || direction<0 || direction>1 ||
-       speed<0 || speed>128)
-      return 1;
-   for (i=0; i<5; i++)
-      if (f[i]<0 || f[i]>1)
-         return 1;
-
-   calc_14bit_address_byte(addrbyte1, addrbyte2, address);
-   calc_128spst_adv_op_bytes(spdrbyte1, spdrbyte2, direction, speed);
-   calc_function_group(funcbyte, NULL, 0, f);
-   xor_two_bytes(errdbyte, addrbyte1, addrbyte2);
-   xor_two_bytes(dummy, errdbyte, spdrbyte1);
-   xor_two_bytes(errdbyte, dummy, spdrbyte2);
-
-   /* putting all together in a 'bitstream' (char array) (speed & direction) */
-   memset(bitstream, 0, 100);
-   strcat(bitstream, preamble);
-   strcat(bitstream, "0");
-   strcat(bitstream, addrbyte1);
-   strcat(bitstream, "0");
-   strcat(bitstream, addrbyte2);
-   strcat(bitstream, "0");
-   strcat(bitstream, spdrbyte1);
-   strcat(bitstream, "0");
-   strcat(bitstream, spdrbyte2);
-   strcat(bitstream, "0");
-   strcat(bitstream, errdbyte);
-   strcat(bitstream, "1");
-
-   xor_two_bytes(dummy, addrbyte1, addrbyte2);
-   xor_two_bytes(errdbyte, dummy, funcbyte);
-
-   /* putting all together in a 'bitstream' (char array) (functions) */
-   memset(bitstream2, 0, 100);
-   strcat(bitstream2, preamble);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, addrbyte1);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, addrbyte2);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, funcbyte);
-   strcat(bitstream2, "0");
-   strcat(bitstream2, errdbyte);
-   strcat(bitstream2, "1");
-
-   j=translateBitstream2Packetstream(bitstream, packetstream);
-   jj=translateBitstream2Packetstream(bitstream2, packetstream2);
-
-   if (j>0 && jj>0) {
-      update_NMRAPacketPool(adr+ADDR14BIT_OFFSET,packetstream,j,packetstream2,jj);
-      queue_add(adr+ADDR14BIT_OFFSET,packetstream,QNBLOCOPKT,j);
-      queue_add(adr+ADDR14BIT_OFFSET,packetstream2,QNBLOCOPKT,jj);
-
-      return 0;
-   }
-
-   return 1;
+   return __compNMRALoco(address, True, direction, speed, True, f);
 }
 
 /*** the following function(s) supports the implementation of NMRA- ***
@@ -1038,7 +556,6 @@ static int  is_size = 0;
 static char pagepresetstream[PKTSIZE];
 static int  ps_size = 0;
 
-static char *longpreamble  = "111111111111111111111111111111";
 static char reset_packet[] = "11111111111111111111111111111100000000000000000000000000010";
 static char page_preset_packet[] = "11111111111111111111111111111100111110100000000100111110010";
 static char idle_packet[] = "11111111111111111111111111111101111111100000000001111111110";
@@ -1097,19 +614,26 @@ int handle2ACK(iOSerial serial, int ack1, int ack2) {
 }
 
 
+/* direct mode packet: 0111CCAA AAAAAAAA DDDDDDDD EEEEEEEE with long preamble */
+static int __smDirectPacket(int cv, int value, int verify, char* packetstream) {
+   unsigned char dcc[4];
+
+   dcc[0] = (verify ? 0x74 : 0x7C) | ((cv >> 8) & 0x03);
+   dcc[1] = cv & 0xFF;
+   dcc[2] = value & 0xFF;
+   __dccErrorByte(dcc, 3);
+
+   return __encodeNMRA(dcc, 4, NMRA_LONGPREAMBLE, packetstream);
+}
+
 int protocol_nmra_sm_direct_cvbyte(obj inst, int cv, int value, int verify, int pom) {
    /* direct cv access */
    iODDXData data = Data((iODDX)inst);
 
-   char byte2[9];
-   char byte3[9];
-   char byte4[9];
-   char byte5[9];
-   char bitstream[100];
    char packetstream[PKTSIZE];
    char SendStream[2048];
 
-   int i,j,l,ack1,ack2;
+   int j,l,ack1,ack2;
    int ack = 0;
 
    /* no special error handling, it's job of the clients */
@@ -1117,64 +641,7 @@ int protocol_nmra_sm_direct_cvbyte(obj inst, int cv, int value, int verify, int
 
    if (!sm_initialized) sm_init();
 
-   /* calculating byte3: AAAAAAAA (rest of CV#) */
-   memset(byte3, 0, 9);
-   for (i=7; i>=0; i--) {
-      j=cv%2;
-      cv=cv/2;
-      switch (j) {
-         case 0: byte3[i]='0'; break;
-         case 1: byte3[i]='1'; break;
-      }
-   }
-
-   /* calculating byte2: 011111AA (instruction byte1) */
-   memset(byte2, 0, 9);
-   if (verify)
-      strcpy(byte2, "01110100");
-   else
-      strcpy(byte2, "01111100");
-   for (i=7; i>=6; i--) {
-      j=cv%2;
-      cv=cv/2;
-      switch (j) {
-         case 0: byte2[i]='0'; break;
-         case 1: byte2[i]='1'; break;
-      }
-   }
-
-   /* calculating byte4: DDDDDDDD (data) */
-   memset(byte4, 0, 9);
-   for (i=7; i>=0; i--) {
-      j=value%2;
-      value=value/2;
-      switch (j) {
-         case 0: byte4[i]='0'; break;
-         case 1: byte4[i]='1'; break;
-      }
-   }
-
-   /* calculating byte5: EEEEEEEE (error detection byte) */
-   memset(byte5, 0, 9);
-   for (i=0; i<8; i++) {
-      if (byte2[i]==byte3[i]) byte5[i]='0'; else byte5[i]='1';
-      if (byte4[i]==byte5[i]) byte5[i]='0'; else byte5[i]='1';
-   }
-
-   /* putting all together in a 'bitstream' (char array) */
-   memset(bitstream, 0, 100);
-   strcat(bitstream, longpreamble);
-   strcat(bitstream, "0");
-   strcat(bitstream, byte2);
-   strcat(bitstream, "0");
-   strcat(bitstream, byte3);
-   strcat(bitstream, "0");
-   strcat(bitstream, byte4);
-   strcat(bitstream, "0");
-   strcat(bitstream, byte5);
-   strcat(bitstream, "1");
-
-   j=translateBitstream2Packetstream(bitstream, packetstream);
+   j=__smDirectPacket(cv, value, verify, packetstream);
 
    memset(SendStream,0,2048);
 
@@ -1236,71 +703,12 @@ int protocol_nmra_sm_verify_cvbyte(obj inst, int cv, int value) {
 int __createCVgetpacket(int cv, int value, char* SendStream, int start) {
    /* direct cv access */
 
-   char byte2[9];
-   char byte3[9];
-   char byte4[9];
-   char byte5[9];
-   char bitstream[100];
    char packetstream[PKTSIZE];
 
-   int i, j, l, packetsize, sendsize;
+   int l, packetsize, sendsize;
    int rc = 0;
 
-   /* calculating byte3: AAAAAAAA (rest of CV#) */
-   memset(byte3, 0, 9);
-   for (i=7; i>=0; i--) {
-      j=cv%2;
-      cv=cv/2;
-      switch (j) {
-         case 0: byte3[i]='0'; break;
-         case 1: byte3[i]='1'; break;
-      }
-   }
-
-   /* calculating byte2: 011111AA (instruction byte1) */
-   memset(byte2, 0, 9);
-   strcpy(byte2, "01110100");
-   for (i=7; i>=6; i--) {
-      j=cv%2;
-      cv=cv/2;
-      switch (j) {
-         case 0: byte2[i]='0'; break;
-         case 1: byte2[i]='1'; break;
-      }
-   }
-
-   /* calculating byte4: DDDDDDDD (data) */
-   memset(byte4, 0, 9);
-   for (i=7; i>=0; i--) {
-      j=value%2;
-      value=value/2;
-      switch (j) {
-         case 0: byte4[i]='0'; break;
-         case 1: byte4[i]='1'; break;
-      }
-   }
-
-   /* calculating byte5: EEEEEEEE (error detection byte) */
-   memset(byte5, 0, 9);
-   for (i=0; i<8; i++) {
-      if (byte2[i]==byte3[i]) byte5[i]='0'; else byte5[i]='1';
-      if (byte4[i]==byte5[i]) byte5[i]='0'; else byte5[i]='1';
-   }
-
-   /* putting all together in a 'bitstream' (char array) */
-   memset(bitstream, 0, 100);
-   strcat(bitstream, longpreamble);
-   strcat(bitstream, "0");
-   strcat(bitstream, byte2);
-   strcat(bitstream, "0");
-   strcat(bitstream, byte3);
-   strcat(bitstream, "0");
-   strcat(bitstream, byte4);
-   strcat(bitstream, "0");
-   strcat(bitstream, byte5);
-   strcat(bitstream, "1");
-
-   packetsize = translateBitstream2Packetstream(bitstream, packetstream);
+   packetsize = __smDirectPacket(cv, value, True, packetstream);
 
    memset(SendStream,0,2048);
 
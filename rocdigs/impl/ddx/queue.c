@@ -23,16 +23,28 @@
 
 #include "rocs/public/trace.h"
 #include "rocs/public/mutex.h"
+#include "rocs/public/thread.h"
 #include "rocs/public/mem.h"
 
 #include <stdlib.h>
 
 #define QSIZE 2000
+#define QFULLWAIT 100 /* ms a command waits for the refresh cycle to free a slot */
+
+/* Single producer, single consumer ring:
+   Only queue_add moves 'in' and only the refresh cycle moves 'out' with queue_get,
+   so the consumer needs no lock. The mutex only serializes concurrent command threads. */
+#if defined __GNUC__
+#define QBARRIER() __sync_synchronize()
+#else
+#define QBARRIER()
+#endif
 
 iOMutex queue_mutex;   /* mutex to synchronize queue inserts */
 
 static int queue_initialized = 0;
-static int out=0, in=0;
+static volatile int out=0, in=0;
+static int dropped=0;
 
 typedef struct _tQData {
    int  packet_type;
@@ -68,16 +80,40 @@ int queue_empty() {
 
 void queue_add(int addr, char *packet, int packet_type, int packet_size) {
 
+   int next;
+   int waited = 0;
+
    if (!queue_initialized) queue_init();
-	
+
+   if (packet_size > PKTSIZE) packet_size = PKTSIZE;
+
    MutexOp.wait(queue_mutex);
-   MemOp.set(QData[in].packet,0,PKTSIZE);
+   next = in + 1;
+   if (next==QSIZE) next=0;
+   while (next == out && waited < QFULLWAIT) {
+      /* back-pressure: let the refresh cycle send before giving up */
+      MutexOp.post(queue_mutex);
+      ThreadOp.sleep(1);
+      waited++;
+      MutexOp.wait(queue_mutex);
+      next = in + 1;
+      if (next==QSIZE) next=0;
+   }
+   if (next == out) {
+      /* do not overwrite packets the refresh cycle did not send yet */
+      dropped++;
+      MutexOp.post(queue_mutex);
+      TraceOp.trc( __FILE__, TRCLEVEL_WARNING, __LINE__, 9999,
+          "queue full for %dms; packet for address %d dropped (%d in total)", QFULLWAIT, addr, dropped );
+      return;
+   }
    MemOp.copy(QData[in].packet,packet,packet_size);
    QData[in].packet_type=packet_type;
    QData[in].packet_size=packet_size;
    QData[in].addr=addr;
-   in++;
-   if (in==QSIZE) in=0;
+   /* publish the slot after its content */
+   QBARRIER();
+   in = next;
    MutexOp.post(queue_mutex);
 }
 
@@ -87,12 +123,19 @@ int queue_get(int *addr, char *packet, int *packet_size) {
 
    if (!queue_initialized || queue_empty()) return QEMPTY;
 
-   MemOp.copy(packet,QData[out].packet,PKTSIZE);   
+   /* read the slot only after seeing the new 'in' */
+   QBARRIER();
+   MemOp.copy(packet,QData[out].packet,QData[out].packet_size);
    rtc=QData[out].packet_type;
    *packet_size=QData[out].packet_size;
    *addr=QData[out].addr;
    QData[out].packet_type=QNOVALIDPKT;
-   out++;
-   if (out==QSIZE) out=0;
+   /* release the slot after reading it */
+   QBARRIER();
+   out = (out+1 == QSIZE) ? 0 : out+1;
    return rtc;   
 }
+
+int queue_dropped() {
+   return dropped;
+}
@@ -40,5 +40,6 @@
 int  queue_init();
 void queue_add(int addr, char *packet, int packet_type, int packet_size);
 int  queue_get(int *addr, char *packet, int *packet_size);
+int  queue_dropped();
 
 #endif
@@ -44,6 +44,7 @@ static const char BIT_VALUES[] = {
 
 void rocrail_ddxStateChanged(obj inst);
 void rocrail_ddxFbListener( obj inst, int addr, int state );
+void rocrail_ddxFbBatchListener( obj inst, unsigned char* mask, unsigned char* state, int ports );
 
 void thr_dos88polling(void *v);
 
@@ -195,6 +196,7 @@ void thr_dos88polling(void* threadinst) {
 //  typedef char s88array[S88_MAXPORTSB*S88_MAXBUSSES];
   char* s88data = allocMem( S88_MAXPORTSB*S88_MAXBUSSES * sizeof( char ));
   char* s88old  = allocMem( S88_MAXPORTSB*S88_MAXBUSSES * sizeof( char ));
+  char* s88delta = allocMem( S88_MAXPORTSB*S88_MAXBUSSES * sizeof( char ));
 
 
   for( bus = 0; bus < 4; bus++ )
@@ -254,6 +256,7 @@ void thr_dos88polling(void* threadinst) {
     } else
       continue; // no busses to scan, quit!
 
+    MemOp.set( s88delta, 0, S88_MAXPORTSB*S88_MAXBUSSES );
     for( bus = 0; bus < data->s88buses; bus++ ) { // scan all busses
       int portidx;
 
@@ -262,21 +265,17 @@ void thr_dos88polling(void* threadinst) {
         delta = (s88data[port] ^ s88old[port]);
 
         if( delta ) { // something has changed
-          int bit;
-          for( bit = 0; bit < 8; bit++ ) { // check the delta bits
-            if( ( delta & BIT_VALUES[bit] ) ) { // Event happened
-              int fbport = port * 8 + bit + 1;
-              int fbstate = ( ( s88data[port] & BIT_VALUES[bit] ) != 0 );
-              rocrail_ddxFbListener( (obj)inst, fbport, fbstate );
-            }
-          }
+          s88delta[port] = delta;
           s88old[port] = s88data[port]; // set the triggers
         }
       }
     }
+    // all changes of this scan in one event
+    rocrail_ddxFbBatchListener( (obj)inst, (unsigned char*)s88delta, (unsigned char*)s88data, S88_MAXPORTSB*data->s88buses );
 
   }
   freeMem( s88data );
   freeMem( s88old );
+  freeMem( s88delta );
   TraceOp.trc( __FILE__, TRCLEVEL_INFO, __LINE__, 9999, "s88 polling stopped" );
 }
@@ -53,6 +53,8 @@ It looks like it helps a lot when bytes are sended separatly with an interval of
 #include "rocrail/wrapper/public/Loc.h"
 #include "rocrail/wrapper/public/Switch.h"
 #include "rocrail/wrapper/public/Feedback.h"
+#include "rocrail/wrapper/public/FbBatch.h"
+#include "rocrail/wrapper/public/FbDelta.h"
 #include "rocrail/wrapper/public/Response.h"
 #include "rocrail/wrapper/public/CustomCmd.h"
 
@@ -376,23 +378,21 @@ static Boolean _supportPT( obj inst ) {
 
 
 /** ------------------------------------------------------------
-  * __fbstatetrigger()
+  * __fbstatereport()
   * Checks if the the low state is for 100ms stable.
   *
   * @param  fbstate  FBState array.
   * @param  fbnode   The changed fbnode, maybe NULL.
-  * @return True on changed.
+  * @return True if the fbnode must be reported; else it is deleted.
   */
-static void __fbstatetrigger( iOHSI88 inst, iONode fbnode ) {
+static Boolean __fbstatereport( iOHSI88 inst, iONode fbnode ) {
   iOHSI88Data data = Data(inst);
   int addr = wFeedback.getaddr( fbnode );
   Boolean state = wFeedback.isstate( fbnode );
 
   if( !data->smooth && fbnode != NULL ) {
     TraceOp.trc( name, TRCLEVEL_MONITOR, __LINE__, 9999, "sensor %d is %s; report", addr, state?"ON":"OFF" );
-    if( data->listenerFun != NULL )
-      data->listenerFun( data->listenerObj, fbnode, TRCLEVEL_INFO );
-    return;
+    return True;
   }
 
   if( fbnode != NULL ) {
@@ -406,8 +406,7 @@ static void __fbstatetrigger( iOHSI88 inst, iONode fbnode ) {
       fb->hightime = SystemOp.getTick();
       fb->lowtime = SystemOp.getTick();
       fb->state = state;
-      if( data->listenerFun != NULL )
-        data->listenerFun( data->listenerObj, fbnode, TRCLEVEL_INFO );
+      return True;
     }
     else if( state && fb->state ) {
       TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "sensor %d is ON and was ON", addr );
@@ -424,6 +423,48 @@ static void __fbstatetrigger( iOHSI88 inst, iONode fbnode ) {
       NodeOp.base.del( fbnode );
     }
   }
+  return False;
+}
+
+
+static void __fbstatetrigger( iOHSI88 inst, iONode fbnode ) {
+  iOHSI88Data data = Data(inst);
+  if( __fbstatereport( inst, fbnode ) ) {
+    if( data->listenerFun != NULL )
+      data->listenerFun( data->listenerObj, fbnode, TRCLEVEL_INFO );
+    else
+      NodeOp.base.del( fbnode );
+  }
+}
+
+
+/* Collects the reported sensors of one info response; a single one is kept
+   as plain feedback event. */
+static void __fbbatchadd( iOHSI88 inst, iONode* single, int* reports, iONode fbnode, byte* mask, byte* state, int bit ) {
+  if( !__fbstatereport( inst, fbnode ) )
+    return;
+  mask[bit/8] |= 0x01 << (bit%8);
+  if( wFeedback.isstate( fbnode ) )
+    state[bit/8] |= 0x01 << (bit%8);
+  (*reports)++;
+  if( *single == NULL )
+    *single = fbnode;
+  else
+    NodeOp.base.del( fbnode );
+}
+
+
+static void __addFbDelta( iONode batch, int addr, byte* mask, byte* state, int len ) {
+  iONode delta = NodeOp.inst( wFbDelta.name(), batch, ELEMENT_NODE );
+  char* s = NULL;
+  wFbDelta.setaddr( delta, addr );
+  s = StrOp.byteToStr( mask, len );
+  wFbDelta.setmask( delta, s );
+  StrOp.free( s );
+  s = StrOp.byteToStr( state, len );
+  wFbDelta.setstate( delta, s );
+  StrOp.free( s );
+  NodeOp.addChild( batch, delta );
 }
 
 
@@ -630,6 +671,9 @@ static void __HSI88feedbackReader( void* threadinst ) {
   int avail = 0;
   Boolean l_dummy = True;
   int l_iLoop = 0;
+  iONode batch  = NULL;
+  iONode single = NULL;
+  int reports   = 0;
 
   memset(fb,0,256);
 
@@ -693,10 +737,15 @@ static void __HSI88feedbackReader( void* threadinst ) {
       buffer[1] = '\0';
       modcnt = buffer[0];
       TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "%d modules",modcnt);
+      batch = NodeOp.inst( wFbBatch.name(), NULL, ELEMENT_NODE );
+      if( o->iid != NULL )
+        wFbBatch.setiid( batch, o->iid );
       for( i = 0; i < modcnt; i++ ) {
         int modnr = 0;
         unsigned char highbyte = 0;
         unsigned char lowbyte = 0;
+        byte mask[2] = {0,0};
+        byte state[2] = {0,0};
         TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "reading module data %d...", i);
         ok = __readBytes( o, (char*)buffer, 3 );
         TraceOp.trc( name, TRCLEVEL_BYTE, __LINE__, 9999, "module data %d=0x%02X 0x%02X 0x%02X", i,
@@ -716,7 +765,7 @@ static void __HSI88feedbackReader( void* threadinst ) {
               wFeedback.setiid( nodeC, o->iid );
 
             TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "sensor %d %s",addr, wFeedback.isstate( nodeC )?"high":"low" );
-            __fbstatetrigger( pHSI88, nodeC );
+            __fbbatchadd( pHSI88, &single, &reports, nodeC, mask, state, j+8 );
           }
           if ( ( lowbyte & (0x01 << j)) != (fb[modnr*2 +1]&(0x01 << j)))
           {
@@ -728,15 +777,32 @@ static void __HSI88feedbackReader( void* threadinst ) {
               wFeedback.setiid( nodeC, o->iid );
 
             TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "sensor %d %s",addr, wFeedback.isstate( nodeC )?"high":"low" );
-            __fbstatetrigger( pHSI88, nodeC );
+            __fbbatchadd( pHSI88, &single, &reports, nodeC, mask, state, j );
           }
 
         }
+        if( mask[0] != 0 || mask[1] != 0 )
+          __addFbDelta( batch, (modnr-1) * 16 + 1, mask, state, 2 );
         fb[modnr*2] = highbyte;
         fb[modnr*2+1] = lowbyte;
 
       }
 
+      /* all reported changes of the response in one event */
+      if( reports == 1 ) {
+        NodeOp.base.del( batch );
+        batch = single;
+      }
+      else if( single != NULL )
+        NodeOp.base.del( single );
+      if( reports > 0 && o->listenerFun != NULL )
+        o->listenerFun( o->listenerObj, batch, TRCLEVEL_INFO );
+      else
+        NodeOp.base.del( batch );
+      batch   = NULL;
+      single  = NULL;
+      reports = 0;
+
       TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "Waiting for CR response...");
       ok = __readBytes( o, (char*)buffer, 1 );
       if (buffer[0] != '\r')
@@ -77,6 +77,7 @@
 #include "rocdigs/impl/loconet/locoio.h"
 #include "rocdigs/impl/loconet/ibcom-cv.h"
 #include "rocdigs/impl/loconet/lnutils.h"
+#include "rocdigs/impl/loconet/lnslots.h"
 
 #include "rocutils/public/addr.h"
 
@@ -103,6 +104,7 @@ static void __del( void* inst ) {
   if( inst != NULL ) {
     iOLocoNetData data = Data(inst);
     /* Cleanup data->xxx members...*/
+    lnSlotsDel( data->slottable );
 
     freeMem( data );
     freeMem( inst );
@@ -545,6 +547,9 @@ static void __handleLissy(iOLocoNet loconet, byte* msg) {
     wFeedback.setdirection( nodeC, dir );
   }
 
+  if( data->readts != 0 )
+    wFeedback.setspants( nodeC, data->readts );
+
   if( data->resetLissy )
     ThreadOp.post( data->lissyReset, NodeOp.base.clone(nodeC) );
 
@@ -568,6 +573,9 @@ static void __handleSensor(iOLocoNet loconet, int addr, int value) {
 
     wFeedback.setstate( nodeC, value?True:False );
 
+    if( data->readts != 0 )
+      wFeedback.setspants( nodeC, data->readts );
+
     data->listenerFun( data->listenerObj, nodeC, TRCLEVEL_INFO );
   }
 }
@@ -692,7 +700,7 @@ static void __handleLoco(iOLocoNet loconet, byte* rsp ) {
   int spd  = rsp[2];
   int dirf = rsp[2];
   int snd  = rsp[2];
-  int addr = data->locoslot[slot];
+  int addr = lnSlotsAddr(data->slottable, slot);
   int throttleid = data->locothrottle[slot];
   char* sthrottleid = StrOp.fmt("%d", throttleid);
 
@@ -765,29 +773,21 @@ static void __slotPing( void* threadinst ) {
 
   while( data->run ) {
     time_t currtime = time(NULL);
-    int i;
-
-    /* lookup slot for address: */
-    for( i = 0; i < 120 && data->run; i++ ) {
-      if( MutexOp.trywait( data->slotmux, 1000 ) ) {
-        if( data->locoslot[i] > 0 && ((currtime - data->slotaccessed[i]) >= (data->purgetime/2)) ) {
-          byte* cmd = allocMem( 32 );
-          TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "sending a ping for slot# %d", i );
+    int slot;
 
-          cmd[0] = 4;
-          cmd[1] = OPC_LOCO_SPD;
-          cmd[2] = i;
-          cmd[3] = data->slotV[i] & 0x7F;;
-          cmd[4] = LocoNetOp.checksum( cmd+1, 3 );
-          ThreadOp.post( data->loconetWriter, (obj)cmd );
+    /* only the slots which reached their ping deadline; the writer paces the posts */
+    while( data->run && (slot = lnSlotsDue( data->slottable, currtime )) > 0 ) {
+      byte* cmd = allocMem( 64 );
+      TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "sending a ping for slot# %d", slot );
 
-          data->slotaccessed[i] = currtime;
+      cmd[0] = 4;
+      cmd[1] = OPC_LOCO_SPD;
+      cmd[2] = slot;
+      cmd[3] = data->slotV[slot] & 0x7F;
+      cmd[4] = LocoNetOp.checksum( cmd+1, 3 );
+      ThreadOp.post( data->loconetWriter, (obj)cmd );
 
-        }
-        /* Release the mutex. */
-        MutexOp.post( data->slotmux );
-        ThreadOp.sleep(10);
-      }
+      lnSlotsTouch( data->slottable, slot, currtime );
     }
 
     if( data->run )
@@ -1371,7 +1371,7 @@ static void __evaluatePacket(iOLocoNet loconet, byte* rsp, int size ) {
         int addrL = rsp[4];     // loco address
         int addrH = rsp[9];     // loco address high
         int addr = lnLocoAddr(addrH, addrL);
-        data->locoslot[slot] = addr;
+        lnSlotsSet( data->slottable, slot, addr );
         data->locothrottle[slot] = idl + idh * 127;
         TraceOp.trc( name, TRCLEVEL_MONITOR, __LINE__, 9999, "slot=%d addr=%d throttleid=%d", slot, addr, data->locothrottle[slot] );
       }
@@ -1457,6 +1457,8 @@ static void __loconetReader( void* threadinst ) {
 
     size = 0;
     if( MutexOp.trywait( data->mux, 1000 ) ) {
+      /* read time of the sensor events in this message */
+      data->readts = data->spans ? MetricsOp.now():0;
       size = data->lnRead( (obj)loconet, rsp );
       MutexOp.post( data->mux );
     }
@@ -1627,24 +1629,15 @@ static int __getLocoSlot(iOLocoNet loconet, iONode node, int* status) {
   byte cmd[8];
   byte rsp[128];
   int insize = 0;
-  int i = 0;
   int addr = wLoc.getaddr(node);
-  int slot = 0;
+  int slot = lnSlotsGet( data->slottable, addr );
   time_t currtime = time(NULL);
 
-  /* lookup slot for address: */
-  for( i = 0; i < 120; i++ ) {
-    if( data->locoslot[i] == addr ) {
-      slot = i;
-      break;
-    }
-  }
-
-  /* check slot if it could be purged by the command station: */
-  if( slot != 0 && data->purgetime != 0 && ( currtime - data->slotaccessed[slot] ) >= data->purgetime ) {
-    data->locoslot[slot] = 0;
+  /* check slot if it could be purged by the command station; the slot server purges the table itself */
+  if( slot != 0 && data->purgetime != 0 && !data->activeSlotServer &&
+      ( currtime - lnSlotsAccessed( data->slottable, slot ) ) >= data->purgetime ) {
+    lnSlotsSet( data->slottable, slot, 0 );
     data->slotV[slot] = 0;
-    data->slotaccessed[slot] = 0;
     TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Slot#%d for loco addr=%d could be purged...", slot, addr );
     slot = 0;
   }
@@ -1661,8 +1654,8 @@ static int __getLocoSlot(iOLocoNet loconet, iONode node, int* status) {
       if( rsp[0] == OPC_SL_RD_DATA ) {
         slot = rsp[2];
         TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Slot#%d for loco addr=%d.", slot, addr );
-        data->locoslot[slot] = addr;
-        data->slotaccessed[slot] = currtime;
+        lnSlotsSet( data->slottable, slot, addr );
+        lnSlotsTouch( data->slottable, slot, currtime );
 
         *status = rsp[3];
 
@@ -1678,12 +1671,12 @@ static int __getLocoSlot(iOLocoNet loconet, iONode node, int* status) {
               TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Slot# %d move was accepted.", slot );
             }
             if( rsp[0] == OPC_LONG_ACK ) {
-              /* illegal move! */
-              slot = 0;
-              data->locoslot[slot] = 0;
+              /* illegal move! the slot server keeps its address in the table */
+              if( !data->activeSlotServer )
+                lnSlotsSet( data->slottable, slot, 0 );
               data->slotV[slot] = 0;
-              data->slotaccessed[slot] = 0;
               TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "Slot# %d move was illegal!", slot );
+              slot = 0;
             }
           }
         }
@@ -1718,7 +1711,7 @@ static int __getLocoSlot(iOLocoNet loconet, iONode node, int* status) {
     }
   }
   else {
-    data->slotaccessed[slot] = currtime;
+    lnSlotsTouch( data->slottable, slot, currtime );
   }
 
   return slot;
@@ -2126,9 +2119,9 @@ static int __translate( iOLocoNet loconet_inst, iONode node, byte* cmd, Boolean*
       }
 
       if( slot > 0 && StrOp.equals( wLoc.dispatch, wLoc.getcmd(node) ) ) {
-        /* set as purged: */
-        data->locoslot[slot] = 0;
-        data->slotaccessed[slot] = 0;
+        /* set as purged; the slot server keeps its address in the table */
+        if( !data->activeSlotServer )
+          lnSlotsSet( data->slottable, slot, 0 );
         size = makereqDispatch(data, cmd, slot, node, status, data->activeSlotServer );
       }
       else if( slot > 0 ) {
@@ -2605,12 +2598,19 @@ static int _version( obj inst ) {
 }
 
 
+/* One slot table for the client and the slot server: with the slot server active
+ * the slots are purged when idle longer than the purge time, otherwise a ping is
+ * due halfway the purge time of the command station. */
 static void __initLocoSlots( iOLocoNet loconet ) {
   iOLocoNetData data = Data(loconet);
-  int i = 0;
-  for( i = 0; i < 256; i++ ) {
-    data->locoslot[i] = 0;
+  int interval = 0;
+  if( data->activeSlotServer ) {
+    if( data->purgetime > 0 )
+      interval = data->purgetime + 1;
   }
+  else if( data->purgetime > 0 && wLocoNet.isslotping(data->loconet) )
+    interval = data->purgetime / 2;
+  data->slottable = lnSlotsInst( interval );
 }
 
 
@@ -2664,6 +2664,7 @@ static struct OLocoNet* _inst( const iONode ini ,const iOTrace trc ) {
   data->serveLConly = wLNSlotServer.islconly(data->slotserver);
   data->doSensorQuery = wLocoNet.issensorquery(data->loconet);
   data->stress = wDigInt.isstress(ini);
+  data->spans  = wDigInt.isspans(ini);
   data->swack = wLocoNet.isswack(data->loconet);
   data->swretry = wLocoNet.getswretry(data->loconet);
   data->swsleep = wLocoNet.getswsleep(data->loconet);
@@ -2767,7 +2768,8 @@ static struct OLocoNet* _inst( const iONode ini ,const iOTrace trc ) {
     data->lissyReset = ThreadOp.inst( "lissyreset", &__lissyReset, __LocoNet );
     ThreadOp.start( data->lissyReset );
 
-    if( data->purgetime > 0 && wLocoNet.isslotping(data->loconet) ) {
+    /* the slot server is the command station; its slots need no ping */
+    if( data->purgetime > 0 && wLocoNet.isslotping(data->loconet) && !data->activeSlotServer ) {
       data->slotPing = ThreadOp.inst( "slotping", &__slotPing, __LocoNet );
       ThreadOp.start( data->slotPing );
     }
@@ -27,6 +27,7 @@
 
 #include "rocdigs/impl/loconet/lnconst.h"
 #include "rocdigs/impl/loconet/lnmaster.h"
+#include "rocdigs/impl/loconet/lnslots.h"
 
 #include "rocrail/wrapper/public/Command.h"
 #include "rocrail/wrapper/public/Loc.h"
@@ -62,19 +63,18 @@ struct __lnslot {
   int minutes;
   int hours;
   int init;
-  time_t accessed;
 };
 
 
 /* prototyping handlers */
-static int __locoaddress(iOLocoNet loconet, byte* msg, struct __lnslot* slot);
+static int __locoaddress(iOLocoNet loconet, byte* msg, struct __lnslot* slot, iOLNSlots slots);
 static int __getslotdata(iOLocoNet loconet, byte* msg, struct __lnslot* slot);
 static int __moveslots  (iOLocoNet loconet, byte* msg, struct __lnslot* slot, int* dispatchedslot );
 static int __slotstatus1(iOLocoNet loconet, byte* msg, struct __lnslot* slot);
 static int __locodirf   (iOLocoNet loconet, byte* msg, struct __lnslot* slot);
 static int __locosound  (iOLocoNet loconet, byte* msg, struct __lnslot* slot);
 static int __locospeed  (iOLocoNet loconet, byte* msg, struct __lnslot* slot);
-static int __setslotdata(iOLocoNet loconet, byte* msg, struct __lnslot* slot);
+static int __setslotdata(iOLocoNet loconet, byte* msg, struct __lnslot* slot, iOLNSlots slots);
 static iONode __sysCmd(iOLocoNet loconet, const char* cmd);
 static iONode __locCmd(iOLocoNet loconet, int slotnr, struct __lnslot* slot, Boolean toLoco);
 static iONode __funCmd(iOLocoNet loconet, int slotnr, struct __lnslot* slot, int fgroup);
@@ -87,6 +87,8 @@ void lnmasterThread( void* threadinst ) {
   iOLocoNetData data = Data(loconet);
 
   struct __lnslot* slot = allocMem( 128 * sizeof(struct __lnslot) );
+  /* the slot table of the LocoNet instance; its deadlines are the purge times of the slot server */
+  iOLNSlots slots = data->slottable;
   int dispatchedslot = 0;
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "LocoNet SlotServer started." );
@@ -124,7 +126,7 @@ void lnmasterThread( void* threadinst ) {
             data->listenerFun( data->listenerObj, __swCmd(loconet, msg ), TRCLEVEL_INFO );
             break;
           case OPC_LOCO_ADR:
-            slotnr = __locoaddress(loconet,msg,slot);
+            slotnr = __locoaddress(loconet,msg,slot,slots);
             break;
           case OPC_RQ_SL_DATA:
             slotnr = __getslotdata(loconet,msg,slot);
@@ -145,12 +147,12 @@ void lnmasterThread( void* threadinst ) {
             slotnr = __locospeed(loconet,msg,slot);
             break;
           case OPC_WR_SL_DATA:
-            slotnr = __setslotdata(loconet,msg,slot);
+            slotnr = __setslotdata(loconet,msg,slot,slots);
             break;
         }
 
         if( slotnr != -1 ) {
-          slot[slotnr].accessed = currtime;
+          lnSlotsTouch( slots, slotnr, currtime );
         }
 
       }
@@ -162,17 +164,23 @@ void lnmasterThread( void* threadinst ) {
     /* check slots for setting to idle: purge */
     if( wLNSlotServer.ispurge(data->slotserver) && data->purgetime > 0 ) {
       int i = 0;
-      for( i = 1; i < 120; i++ ) {
-        if( slot[i].inuse && ((currtime - slot[i].accessed) > (data->purgetime)) ) {
-          slot[i].inuse = False;
-          slot[i].addr = 0;
-          TraceOp.trc( name, TRCLEVEL_MONITOR, __LINE__, 9999, "slot# %d is purged", i );
-          if( wLNSlotServer.isstopatpurge(data->slotserver) ) {
-            slot[i].speed = 0;
-            TraceOp.trc( name, TRCLEVEL_MONITOR, __LINE__, 9999, "loc %d speed is set to zero", slot[i].addr );
-            data->listenerFun( data->listenerObj, __locCmd( loconet, i, slot, False), TRCLEVEL_INFO );
-          }
+      while( (i = lnSlotsDue( slots, currtime )) > 0 ) {
+        if( i >= LNSLOT_LOCOS )
+          continue;
+        if( !slot[i].inuse ) {
+          /* keep watching; it could be set in use without a new access */
+          lnSlotsTouch( slots, i, currtime );
+          continue;
         }
+        slot[i].inuse = False;
+        TraceOp.trc( name, TRCLEVEL_MONITOR, __LINE__, 9999, "slot# %d is purged", i );
+        if( wLNSlotServer.isstopatpurge(data->slotserver) ) {
+          slot[i].speed = 0;
+          TraceOp.trc( name, TRCLEVEL_MONITOR, __LINE__, 9999, "loc %d speed is set to zero", slot[i].addr );
+          data->listenerFun( data->listenerObj, __locCmd( loconet, i, slot, False), TRCLEVEL_INFO );
+        }
+        slot[i].addr = 0;
+        lnSlotsSet( slots, i, 0 );
       }
     }
 
@@ -322,17 +330,19 @@ int lnLocoAddr(int addrH, int addrL) {
   return (((addrH & 0x7f) * 128) + (addrL & 0x7f));
 }
 
-static int __findSlot4Addr( int addr, struct __lnslot* slot, int* firstavail ) {
-  int i = 0;
+static int __findSlot4Addr( int addr, struct __lnslot* slot, iOLNSlots slots, int* firstavail ) {
+  int i = lnSlotsGet( slots, addr );
   *firstavail = -1;
-  for( i = 1; i < 120; i++ ) {
-    if( slot[i].addr == addr ) {
-      TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "slot# %d has address %d", i, addr );
-      return i;
-    }
-    if( *firstavail == -1 && !slot[i].inuse && slot[i].addr == 0)
-      *firstavail = i;
+  if( i > 0 && i < LNSLOT_LOCOS ) {
+    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "slot# %d has address %d", i, addr );
+    return i;
   }
+  /* first slot without address which is not in use */
+  i = lnSlotsFirstFree( slots, 1 );
+  while( i > 0 && slot[i].inuse )
+    i = lnSlotsFirstFree( slots, i + 1 );
+  if( i > 0 )
+    *firstavail = i;
   return -1; // send LACK back <B4> <3F> <0> <CHK>
 }
 
@@ -508,17 +518,18 @@ static void __GPBUSY( iOLocoNet loconet ) {
 
 
 
-static int __locoaddress(iOLocoNet loconet, byte* msg, struct __lnslot* slot) {
+static int __locoaddress(iOLocoNet loconet, byte* msg, struct __lnslot* slot, iOLNSlots slots) {
   iOLocoNetData data = Data(loconet);
   byte rsp[32];
   int addr = lnLocoAddr(msg[1], msg[2]);
   int avail = -1;
-  int slotnr = __findSlot4Addr( addr, slot, &avail );
+  int slotnr = __findSlot4Addr( addr, slot, slots, &avail );
 
   if( slotnr == -1 && avail != -1 ) {
     slotnr = avail;
     /* set the slot */
     slot[slotnr].addr = addr;
+    lnSlotsSet( slots, slotnr, addr );
     slot[slotnr].dir = True;
     /*slot[slotnr].inuse = True;*/
   }
@@ -656,7 +667,7 @@ static int __locospeed(iOLocoNet loconet, byte* msg, struct __lnslot* slot) {
 }
 
 
-static int __setslotdata(iOLocoNet loconet, byte* msg, struct __lnslot* slot) {
+static int __setslotdata(iOLocoNet loconet, byte* msg, struct __lnslot* slot, iOLNSlots slots) {
   iOLocoNetData data = Data(loconet);
   int slotnr = msg[2] & 0x7F;
   int addr = ((msg[9] & 0x7f) * 128) + (msg[4] & 0x7f);
@@ -694,7 +705,11 @@ static int __setslotdata(iOLocoNet loconet, byte* msg, struct __lnslot* slot) {
     slot[slotnr].hours   = msg[8];
   }
   else {
+    int prev = lnSlotsGet( slots, addr );
+    if( prev != 0 && prev != slotnr )
+      slot[prev].addr = 0;
     slot[slotnr].addr  = addr;
+    lnSlotsSet( slots, slotnr, addr );
     slot[slotnr].speed = msg[5];
     slot[slotnr].dir   = ((msg[6] & DIRF_DIR) != 0 ? False:True); /* True is fwd in Rocrail */
     slot[slotnr].f0    = ((msg[6] & DIRF_F0) != 0 ? True:False);
@@ -0,0 +1,238 @@
+/*
+ Rocrail - Model Railroad Software
+
+ Copyright (C) 2002-2014 Rob Versluis, Rocrail.net
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+#include "rocs/public/rocs.h"
+#include "rocs/public/objbase.h"
+#include "rocs/public/mem.h"
+#include "rocs/public/mutex.h"
+
+#include "rocdigs/impl/loconet/lnslots.h"
+
+
+/* deadline heap; caller holds the mutex */
+
+static void __heapSwap( iOLNSlots slots, int a, int b ) {
+  int slot = slots->heap[a];
+  slots->heap[a] = slots->heap[b];
+  slots->heap[b] = slot;
+  slots->heappos[slots->heap[a]] = a;
+  slots->heappos[slots->heap[b]] = b;
+}
+
+static void __heapUp( iOLNSlots slots, int i ) {
+  while( i > 0 ) {
+    int parent = (i - 1) / 2;
+    if( slots->deadline[slots->heap[parent]] <= slots->deadline[slots->heap[i]] )
+      break;
+    __heapSwap( slots, i, parent );
+    i = parent;
+  }
+}
+
+static void __heapDown( iOLNSlots slots, int i ) {
+  while( True ) {
+    int child = 2 * i + 1;
+    if( child >= slots->heapsize )
+      break;
+    if( child + 1 < slots->heapsize &&
+        slots->deadline[slots->heap[child+1]] < slots->deadline[slots->heap[child]] )
+      child++;
+    if( slots->deadline[slots->heap[i]] <= slots->deadline[slots->heap[child]] )
+      break;
+    __heapSwap( slots, i, child );
+    i = child;
+  }
+}
+
+static void __unschedule( iOLNSlots slots, int slot ) {
+  int i = slots->heappos[slot];
+  if( i == -1 )
+    return;
+  slots->heapsize--;
+  if( i != slots->heapsize ) {
+    __heapSwap( slots, i, slots->heapsize );
+    __heapDown( slots, i );
+    __heapUp( slots, i );
+  }
+  slots->heappos[slot] = -1;
+}
+
+static void __schedule( iOLNSlots slots, int slot, time_t deadline ) {
+  slots->deadline[slot] = deadline;
+  if( slots->heappos[slot] == -1 ) {
+    slots->heap[slots->heapsize] = slot;
+    slots->heappos[slot] = slots->heapsize;
+    slots->heapsize++;
+  }
+  __heapDown( slots, slots->heappos[slot] );
+  __heapUp( slots, slots->heappos[slot] );
+}
+
+static void __release( iOLNSlots slots, int slot ) {
+  int addr = slots->addr[slot];
+  if( addr > 0 && slots->slot4addr[addr] == slot )
+    slots->slot4addr[addr] = 0;
+  slots->addr[slot] = 0;
+  slots->used[slot/32] &= ~(1U << (slot%32));
+  __unschedule( slots, slot );
+}
+
+
+/**
+ * interval: seconds after the last access a slot is due for ping or purge; 0 disables the deadlines.
+ */
+iOLNSlots lnSlotsInst( int interval ) {
+  iOLNSlots slots = allocMem( sizeof( struct __lnslots ) );
+  int i = 0;
+  slots->mux = MutexOp.inst( NULL, True );
+  slots->interval = interval;
+  for( i = 0; i < LNSLOT_CNT; i++ )
+    slots->heappos[i] = -1;
+  return slots;
+}
+
+
+void lnSlotsDel( iOLNSlots slots ) {
+  if( slots != NULL ) {
+    MutexOp.base.del( slots->mux );
+    freeMem( slots );
+  }
+}
+
+
+/**
+ * Slot in use for the loco address, 0 if none.
+ */
+int lnSlotsGet( iOLNSlots slots, int addr ) {
+  int slot = 0;
+  if( addr <= 0 || addr >= LNSLOT_ADDRS )
+    return 0;
+  MutexOp.wait( slots->mux );
+  slot = slots->slot4addr[addr];
+  MutexOp.post( slots->mux );
+  return slot;
+}
+
+
+int lnSlotsAddr( iOLNSlots slots, int slot ) {
+  if( slot < 0 || slot >= LNSLOT_CNT )
+    return 0;
+  return slots->addr[slot];
+}
+
+
+/**
+ * Lowest loco slot, starting at from, without an address; 0 if all are taken.
+ */
+int lnSlotsFirstFree( iOLNSlots slots, int from ) {
+  int slot = 0;
+  int i = 0;
+  if( from < 1 )
+    from = 1;
+  MutexOp.wait( slots->mux );
+  for( i = from / 32; i < LNSLOT_CNT/32 && slot == 0; i++ ) {
+    unsigned int free = ~slots->used[i];
+    if( i == from / 32 )
+      free &= ~0U << (from % 32);
+    if( free != 0 ) {
+      int bit = 0;
+      while( !(free & (1U << bit)) )
+        bit++;
+      slot = i * 32 + bit;
+    }
+  }
+  MutexOp.post( slots->mux );
+  return slot < LNSLOT_LOCOS ? slot : 0;
+}
+
+
+/**
+ * Assign the address to the slot; addr 0 releases it.
+ * A slot which had the address before is released; the access time is reset
+ * so a new slot is due at once.
+ */
+void lnSlotsSet( iOLNSlots slots, int slot, int addr ) {
+  if( slot < 1 || slot >= LNSLOT_CNT || addr < 0 || addr >= LNSLOT_ADDRS )
+    return;
+  MutexOp.wait( slots->mux );
+  if( slots->addr[slot] != addr ) {
+    __release( slots, slot );
+    if( addr > 0 ) {
+      if( slots->slot4addr[addr] != 0 )
+        __release( slots, slots->slot4addr[addr] );
+      slots->addr[slot] = addr;
+      slots->slot4addr[addr] = slot;
+      slots->used[slot/32] |= 1U << (slot%32);
+      slots->accessed[slot] = 0;
+      if( slots->interval > 0 )
+        __schedule( slots, slot, slots->interval );
+    }
+    else {
+      slots->accessed[slot] = 0;
+    }
+  }
+  MutexOp.post( slots->mux );
+}
+
+
+time_t lnSlotsAccessed( iOLNSlots slots, int slot ) {
+  if( slot < 0 || slot >= LNSLOT_CNT )
+    return 0;
+  return slots->accessed[slot];
+}
+
+
+/**
+ * Record an access of the slot and move its deadline.
+ */
+void lnSlotsTouch( iOLNSlots slots, int slot, time_t now ) {
+  if( slot < 0 || slot >= LNSLOT_CNT )
+    return;
+  MutexOp.wait( slots->mux );
+  slots->accessed[slot] = now;
+  if( slots->interval > 0 )
+    __schedule( slots, slot, now + slots->interval );
+  MutexOp.post( slots->mux );
+}
+
+
+/**
+ * Take the slot with the earliest deadline if it has passed; 0 if none is due.
+ * The slot is rescheduled by the next lnSlotsTouch.
+ */
+int lnSlotsDue( iOLNSlots slots, time_t now ) {
+  int slot = 0;
+  MutexOp.wait( slots->mux );
+  if( slots->heapsize > 0 && slots->deadline[slots->heap[0]] <= now ) {
+    slot = slots->heap[0];
+    __unschedule( slots, slot );
+  }
+  MutexOp.post( slots->mux );
+  return slot;
+}
+
+
+time_t lnSlotsNextDue( iOLNSlots slots ) {
+  time_t deadline = 0;
+  MutexOp.wait( slots->mux );
+  if( slots->heapsize > 0 )
+    deadline = slots->deadline[slots->heap[0]];
+  MutexOp.post( slots->mux );
+  return deadline;
+}
@@ -0,0 +1,58 @@
+/*
+ Rocrail - Model Railroad Software
+
+ Copyright (C) 2002-2014 Rob Versluis, Rocrail.net
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+#ifndef LNSLOTS_H_
+#define LNSLOTS_H_
+
+#include "rocs/public/mutex.h"
+#include "rocdigs/public/loconet.h"
+
+/* Slot table shared by the LocoNet client (loconet.c) and the slot server (lnmaster.c):
+ * address to slot index and a deadline heap for ping and purge times. */
+
+#define LNSLOT_CNT   128   /* slot numbers 0...127 */
+#define LNSLOT_LOCOS 120   /* loco slots 1...119 */
+#define LNSLOT_ADDRS 16384 /* 14 bit loco address range */
+
+struct __lnslots {
+  iOMutex mux;
+  int     interval;                 /* seconds from the last access until the deadline, 0 = none */
+  int     addr[LNSLOT_CNT];         /* loco address per slot, 0 = free */
+  time_t  accessed[LNSLOT_CNT];
+  time_t  deadline[LNSLOT_CNT];
+  byte    slot4addr[LNSLOT_ADDRS];  /* 0 = no slot */
+  int     heap[LNSLOT_CNT];         /* scheduled slots, earliest deadline first */
+  int     heappos[LNSLOT_CNT];      /* index in heap, -1 = not scheduled */
+  int     heapsize;
+  unsigned int used[LNSLOT_CNT/32]; /* bit per slot with an address */
+};
+
+iOLNSlots lnSlotsInst( int interval );
+void   lnSlotsDel( iOLNSlots slots );
+int    lnSlotsGet( iOLNSlots slots, int addr );
+int    lnSlotsAddr( iOLNSlots slots, int slot );
+int    lnSlotsFirstFree( iOLNSlots slots, int from );
+void   lnSlotsSet( iOLNSlots slots, int slot, int addr );
+time_t lnSlotsAccessed( iOLNSlots slots, int slot );
+void   lnSlotsTouch( iOLNSlots slots, int slot, time_t now );
+int    lnSlotsDue( iOLNSlots slots, time_t now );
+time_t lnSlotsNextDue( iOLNSlots slots );
+
+#endif /*LNSLOTS_H_*/
@@ -56,6 +56,8 @@
 #include "rocrail/wrapper/public/FunCmd.h"
 #include "rocrail/wrapper/public/Loc.h"
 #include "rocrail/wrapper/public/Feedback.h"
+#include "rocrail/wrapper/public/FbBatch.h"
+#include "rocrail/wrapper/public/FbDelta.h"
 #include "rocrail/wrapper/public/Switch.h"
 #include "rocrail/wrapper/public/Output.h"
 #include "rocrail/wrapper/public/Signal.h"
@@ -654,12 +656,19 @@ static void __feedbackMCS2Reader( void* threadinst ) {
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "feedbackpoll ended." );
 }
 
+/* The changes of one module response go to the listener as one batch;
+   a single change as a plain feedback event. */
 static void __evaluateMCS2S88( iOMCS2Data mcs2, byte* in, unsigned char* prev ) {
   int s88base = in[9] * 16;
   int n = 0;
   int addr = 0;
   int state = 0;
   int t = 0;
+  int changes = 0;
+  int lastAddr = 0;
+  int lastState = 0;
+  byte mask[2] = {0,0};
+  byte bits[2] = {0,0};
   for( t = 0; t < 2; t++) {
     for( n = 0; n < 8; n++ ) {
       addr = s88base + n + 1 + (t * 8);
@@ -669,19 +678,42 @@ static void __evaluateMCS2S88( iOMCS2Data mcs2, byte* in, unsigned char* prev )
         /* this feedback changed state since previous poll */
         prev[addr - 1] = state;
         TraceOp.trc( name, TRCLEVEL_MONITOR, __LINE__, 9999, "fb %d = %d", addr, state );
-        {
-          /* inform listener: Node */
-          iONode nodeC = NodeOp.inst( wFeedback.name(), NULL, ELEMENT_NODE );
-          wFeedback.setaddr( nodeC, addr );
-          wFeedback.setstate( nodeC, state?True:False );
-          if( mcs2->iid != NULL )
-            wFeedback.setiid( nodeC, mcs2->iid );
-          mcs2->listenerFun( mcs2->listenerObj, nodeC, TRCLEVEL_INFO );
-        }
+        mask[t] |= 0x01 << n;
+        if( state )
+          bits[t] |= 0x01 << n;
+        lastAddr  = addr;
+        lastState = state;
+        changes++;
       }
     }
   }
 
+  if( changes == 1 ) {
+    /* inform listener: Node */
+    iONode nodeC = NodeOp.inst( wFeedback.name(), NULL, ELEMENT_NODE );
+    wFeedback.setaddr( nodeC, lastAddr );
+    wFeedback.setstate( nodeC, lastState?True:False );
+    if( mcs2->iid != NULL )
+      wFeedback.setiid( nodeC, mcs2->iid );
+    mcs2->listenerFun( mcs2->listenerObj, nodeC, TRCLEVEL_INFO );
+  }
+  else if( changes > 1 ) {
+    iONode batch = NodeOp.inst( wFbBatch.name(), NULL, ELEMENT_NODE );
+    iONode delta = NodeOp.inst( wFbDelta.name(), batch, ELEMENT_NODE );
+    char* s = NULL;
+    if( mcs2->iid != NULL )
+      wFbBatch.setiid( batch, mcs2->iid );
+    wFbDelta.setaddr( delta, s88base + 1 );
+    s = StrOp.byteToStr( mask, 2 );
+    wFbDelta.setmask( delta, s );
+    StrOp.free( s );
+    s = StrOp.byteToStr( bits, 2 );
+    wFbDelta.setstate( delta, s );
+    StrOp.free( s );
+    NodeOp.addChild( batch, delta );
+    mcs2->listenerFun( mcs2->listenerObj, batch, TRCLEVEL_INFO );
+  }
+
   if(!mcs2->sensor) {
     mcs2->sensor = True;
     __reportState(mcs2);
@@ -1169,6 +1201,10 @@ static void __reader( void* threadinst ) {
   int mod = 0;
   unsigned char store[1024];
   int retry = 0;
+  byte frames[MCS2_UDPBATCH * 13];
+  int  sizes[MCS2_UDPBATCH];
+  int  frameCnt = 0;
+  int  frameIdx = 0;
 
   for( mod = 0; mod < 1024; mod++) {
     store[mod] = 0;
@@ -1180,16 +1216,26 @@ static void __reader( void* threadinst ) {
   do {
     MemOp.set(in, 0, 32);
     if( data->udp ) {
-      if( SocketOp.recvfrom( data->readUDP, (char*)in, 13, NULL, NULL ) <= 0 ) {
-        SocketOp.base.del(data->readUDP);
-        ThreadOp.sleep(1000);
-        if( data->run ) {
-          data->readUDP = SocketOp.inst( wDigInt.gethost(data->ini), 15730, False, True, False );
-          SocketOp.bind(data->readUDP);
-          continue;
+      /* Refill the frame ring with all pending datagrams only after the previous batch is processed. */
+      if( frameIdx >= frameCnt ) {
+        frameIdx = 0;
+        frameCnt = SocketOp.recvBatch( data->readUDP, (char*)frames, 13, MCS2_UDPBATCH, sizes );
+        if( frameCnt <= 0 ) {
+          frameCnt = 0;
+          SocketOp.base.del(data->readUDP);
+          ThreadOp.sleep(1000);
+          if( data->run ) {
+            data->readUDP = SocketOp.inst( wDigInt.gethost(data->ini), 15730, False, True, False );
+            SocketOp.bind(data->readUDP);
+            continue;
+          }
+          else break;
         }
-        else break;
       }
+      /* a short datagram leaves the rest of in zeroed, not the bytes of an earlier frame in the ring */
+      if( sizes[frameIdx] > 0 )
+        MemOp.copy( in, frames + frameIdx * 13, sizes[frameIdx] < 13 ? sizes[frameIdx]:13 );
+      frameIdx++;
     }
     else {
       if( data->conOK ) {
@@ -1361,7 +1407,8 @@ static void __reader( void* threadinst ) {
     else if( in[1] == (ID_LOCO_BIND + BIT_RESPONSE) ) {
        __evaluateMCS2Bind( data, in );
     }
-    ThreadOp.sleep(0);
+    if( frameIdx >= frameCnt )
+      ThreadOp.sleep(0);
 
   } while( data->run );
 
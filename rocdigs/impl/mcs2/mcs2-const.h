@@ -38,6 +38,9 @@
 
 #define BIT_RESPONSE 0x01
 
+/* Number of 13 byte CAN frames fetched with one UDP receive call. */
+#define MCS2_UDPBATCH 32
+
 /* SYSTEM */
 #define CMD_SYSTEM            0x00
 #define ID_SYSTEM             0x00
@@ -48,6 +48,8 @@
 #include "rocrail/wrapper/public/Output.h"
 #include "rocrail/wrapper/public/Signal.h"
 #include "rocrail/wrapper/public/Feedback.h"
+#include "rocrail/wrapper/public/FbBatch.h"
+#include "rocrail/wrapper/public/FbDelta.h"
 #include "rocrail/wrapper/public/Response.h"
 #include "rocrail/wrapper/public/Program.h"
 #include "rocrail/wrapper/public/State.h"
@@ -938,13 +940,37 @@ static Boolean _supportPT( obj inst ) {
 }
 
 
+static void __addFbDelta( iONode batch, int addr, byte* mask, byte* state, int len ) {
+  iONode delta = NodeOp.inst( wFbDelta.name(), batch, ELEMENT_NODE );
+  char* s = NULL;
+  wFbDelta.setaddr( delta, addr );
+  s = StrOp.byteToStr( mask, len );
+  wFbDelta.setmask( delta, s );
+  StrOp.free( s );
+  s = StrOp.byteToStr( state, len );
+  wFbDelta.setstate( delta, s );
+  StrOp.free( s );
+  NodeOp.addChild( batch, delta );
+}
+
+
+/* All changes of one scan go to the listener as one batch; a single change
+   as a plain feedback event. */
 static void __evaluateState( iOP50xData o, unsigned char* fb1, unsigned char* fb2, int size ) {
+  iONode batch = NodeOp.inst( wFbBatch.name(), NULL, ELEMENT_NODE );
+  int changes = 0;
+  int addr = 0;
+  int state = 0;
   int i = 0;
+
+  if( o->iid != NULL )
+    wFbBatch.setiid( batch, o->iid );
+
   for( i = 0; i < size && i < MAX_FB; i++ ) {
     if( fb1[i] != fb2[i] ) {
+      byte mask = 0;
+      byte bits = 0;
       int n = 0;
-      int addr = 0;
-      int state = 0;
       for( n = 0; n < 8; n++ ) {
         if( (fb1[i] & (0x01 << n)) != (fb2[i] & (0x01 << n)) ) {
           addr = i * 8 + (7-n);
@@ -953,23 +979,34 @@ static void __evaluateState( iOP50xData o, unsigned char* fb1, unsigned char* fb
           TraceOp.trc( name, TRCLEVEL_BYTE, __LINE__, 9999, "fb2[%d] i=%d, n=%d", i - i%2, i, n );
           TraceOp.dump ( name, TRCLEVEL_BYTE, &fb2[i-i%2], 2 );
           */
+          /* the module reports the lowest address in the most significant bit */
+          mask |= 0x01 << (7-n);
+          if( state )
+            bits |= 0x01 << (7-n);
           addr++;
+          changes++;
           TraceOp.trc( name, TRCLEVEL_MONITOR, __LINE__, 9999, "fb %d = %d", addr, state );
-          {
-            /* inform listener: Node3 */
-            iONode nodeC = NodeOp.inst( wFeedback.name(), NULL, ELEMENT_NODE );
-            wFeedback.setaddr( nodeC, addr );
-            wFeedback.setstate( nodeC, state?True:False );
-            if( o->iid != NULL )
-              wFeedback.setiid( nodeC, o->iid );
-
-            if( o->listenerFun != NULL && o->listenerObj != NULL )
-              o->listenerFun( o->listenerObj, nodeC, TRCLEVEL_INFO );
-          }
         }
       }
+      __addFbDelta( batch, i * 8 + 1, &mask, &bits, 1 );
     }
   }
+
+  if( changes == 1 ) {
+    /* inform listener: Node3 */
+    iONode nodeC = NodeOp.inst( wFeedback.name(), NULL, ELEMENT_NODE );
+    wFeedback.setaddr( nodeC, addr );
+    wFeedback.setstate( nodeC, state?True:False );
+    if( o->iid != NULL )
+      wFeedback.setiid( nodeC, o->iid );
+    NodeOp.base.del( batch );
+    batch = nodeC;
+  }
+
+  if( changes > 0 && o->listenerFun != NULL && o->listenerObj != NULL )
+    o->listenerFun( o->listenerObj, batch, TRCLEVEL_INFO );
+  else
+    NodeOp.base.del( batch );
 }
 
 
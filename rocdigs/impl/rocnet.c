@@ -67,6 +67,11 @@ static void __del( void* inst ) {
   if( inst != NULL ) {
     iOrocNetData data = Data(inst);
     /* Cleanup data->xxx members...*/
+    /* not in rnUDPDisconnect: the reader may still wait in recvBatch on the ring */
+    if( data->udpframes != NULL )
+      freeMem( data->udpframes );
+    if( data->udpsizes != NULL )
+      freeMem( data->udpsizes );
 
     freeMem( data );
     freeMem( inst );
@@ -28,6 +28,12 @@ Boolean rnUDPConnect( obj inst ) {
 
   data->readUDP = SocketOp.inst( wRocNet.getaddr(data->rnini), wRocNet.getport(data->rnini), False, True, True );
   SocketOp.bind(data->readUDP);
+  if( data->udpframes == NULL ) {
+    data->udpframes = allocMem( RN_UDPBATCH * RN_UDPFRAMESIZE );
+    data->udpsizes  = allocMem( RN_UDPBATCH * sizeof(int) );
+  }
+  data->udpcnt = 0;
+  data->udpidx = 0;
   data->writeUDP = SocketOp.inst( wRocNet.getaddr(data->rnini), wRocNet.getport(data->rnini), False, True, True );
   return True;
 }
@@ -40,7 +46,23 @@ void rnUDPDisconnect( obj inst ) {
 
 int rnUDPRead ( obj inst, unsigned char *msg ) {
   iOrocNetData data = Data(inst);
-  SocketOp.recvfrom( data->readUDP, (char*)msg, 0x7F, NULL, NULL );
+  int size = 0;
+
+  /* Refill the ring only after all previously received frames are consumed. */
+  if( data->udpidx >= data->udpcnt ) {
+    data->udpidx = 0;
+    data->udpcnt = SocketOp.recvBatch( data->readUDP, (char*)data->udpframes, RN_UDPFRAMESIZE, RN_UDPBATCH, data->udpsizes );
+    if( data->udpcnt <= 0 ) {
+      data->udpcnt = 0;
+      return 0;
+    }
+  }
+
+  size = data->udpsizes[data->udpidx];
+  if( size > 0x7F )
+    size = 0x7F;
+  MemOp.copy( msg, data->udpframes + data->udpidx * RN_UDPFRAMESIZE, size );
+  data->udpidx++;
   return 0;
 }
 
@@ -24,6 +24,10 @@
 #ifndef RN_UDP_H_
 #define RN_UDP_H_
 
+/* Number of datagrams fetched with one receive call. */
+#define RN_UDPBATCH 16
+#define RN_UDPFRAMESIZE 0x80
+
 Boolean rnUDPConnect( obj inst );
 void  rnUDPDisconnect( obj inst );
 
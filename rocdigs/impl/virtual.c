@@ -320,6 +320,8 @@ static iONode __translate( iOVirtual virtual, iONode node ) {
     TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "simulate fb addr=%d state=%s ident=%s,%s,%s,%s",
         addr, state?"true":"false", wFeedback.getidentifier(node), wFeedback.getidentifier2(node), wFeedback.getidentifier3(node), wFeedback.getidentifier4(node) );
     rsp = (iONode)NodeOp.base.clone( node );
+    if( wDigInt.isspans( data->ini ) )
+      wFeedback.setspants( rsp, MetricsOp.now() );
 
     if( wDigInt.isfbreset( data->ini ) && state ) {
       iQCmd cmd = allocMem(sizeof(struct QCmd));
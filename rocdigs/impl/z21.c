@@ -1418,20 +1418,32 @@ static void __reader( void* threadinst ) {
   ThreadOp.sleep(100);
 
   do {
-    byte packet[256];
-    MemOp.set( packet, 0, 256);
+    byte packets[Z21_UDPBATCH * 256];
+    int  sizes[Z21_UDPBATCH];
+    int  i = 0;
 
-    int packetSize = SocketOp.recvfrom( data->rwUDP, (char*)packet, 256, NULL, NULL );
+    /* Fetch all pending datagrams with one call. */
+    int packetCnt = SocketOp.recvBatch( data->rwUDP, (char*)packets, 256, Z21_UDPBATCH, sizes );
 
-    if( packetSize > 0 && packetSize < 256 ) {
-      TraceOp.dump ( name, TRCLEVEL_BYTE, (char*)packet, packetSize );
-      __evaluatePacket(z21, packet, packetSize);
-    }
-    else {
-      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "unexpected packet size %d received", packetSize );
+    if( packetCnt <= 0 ) {
+      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "no packet received" );
       ThreadOp.sleep(10);
     }
 
+    for( i = 0; i < packetCnt; i++ ) {
+      byte* packet = packets + i * 256;
+      int packetSize = sizes[i];
+
+      if( packetSize > 0 && packetSize < 256 ) {
+        MemOp.set( packet + packetSize, 0, 256 - packetSize );
+        TraceOp.dump ( name, TRCLEVEL_BYTE, (char*)packet, packetSize );
+        __evaluatePacket(z21, packet, packetSize);
+      }
+      else {
+        TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "unexpected packet size %d received", packetSize );
+      }
+    }
+
   } while( data->run );
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Z21 UDP reader stopped." );
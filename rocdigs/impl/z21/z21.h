@@ -22,6 +22,9 @@
 
 
 
+/* Number of datagrams fetched with one UDP receive call. */
+#define Z21_UDPBATCH 8
+
 #define X_BUS_TUNNEL 0x40
 #define LAN_X_SET_TURNOUT 0x53
 #define LAN_X_SET_LOCO_DRIVE 0xE4
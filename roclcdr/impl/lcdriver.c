@@ -535,6 +535,7 @@ static void _reset( iILcDriverInt inst, Boolean saveCurBlock ) {
     TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "unlocking next3Route for %s...", data->loc->getId( data->loc ));
     data->next3Route->unLock( data->next3Route, data->loc->getId( data->loc ), NULL, True, False );
   }
+  data->model->reserveCancel( data->model, data->loc->getId( data->loc ) );
 
   if( data->curBlock == NULL ) {
     TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "getting curBlock for %s...", data->loc->getId( data->loc ));
@@ -49,52 +49,32 @@
  */
 Boolean initializeDestination( iOLcDriver inst, iIBlockBase block, iORoute street, iIBlockBase curBlock, Boolean reverse, int indelay ) {
   iOLcDriverData data = Data(inst);
-  Boolean grouplocked = initializeGroup(inst, block, curBlock);
+  const char* prevgroup = NULL;
+  Boolean grouplocked = False;
+  Boolean locked = False;
+
+  /* group, block and route are locked as one reservation; the route is set after it */
+  if( !data->model->reserveBegin( data->model, data->loc->getId( data->loc ), block->base.id( block ), street->base.id( street ) ) ) {
+    return False;
+  }
+
+  prevgroup = data->blockgroup;
+  grouplocked = initializeGroup(inst, block, curBlock);
 
   if( !grouplocked ) {
+    data->model->reserveEnd( data->model, data->loc->getId( data->loc ), False );
     return False;
   }
 
   if( street->isFree(street, data->loc->getId( data->loc )) ) {
     /* TODO: curBlock can be NULL in case of R2Rnet */
-    if( block->lock( block, data->loc->getId( data->loc ),
+    if( data->model->reserveBlock( data->model, data->loc->getId( data->loc ), block,
         curBlock->base.id( curBlock ), street->base.id(street), False, True, reverse, indelay ) )
     {
-      if( street->lock( street, data->loc->getId( data->loc ), reverse, True ) ) {
-        if( street->go( street ) ) {
-
-          if( data->gotoBlock != NULL && StrOp.equals( data->gotoBlock, block->base.id( block ) ) ) {
-            TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999,
-                           "GotoBlock %s found for \"%s\"",
-                           data->gotoBlock, data->loc->getId( data->loc ) );
-
-            data->gotoBlock = data->loc->getNextGotoBlock( data->loc, data->gotoBlock );
-            if( data->gotoBlock == NULL) {
-              /* stop after reaching the last gotoBlock */
-              TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "stop after reaching the last gotoBlock");
-              data->run = False;
-            }
-          }
-
-          data->slowdown4route = False;
-
-          return True;
-        }
-        else {
-          block->unLock( block, data->loc->getId( data->loc ), NULL );
-          street->unLock( street, data->loc->getId( data->loc ), NULL, True, False );
-          if(grouplocked) {
-            unlockBlockGroup(inst, data->blockgroup);
-          }
-          TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "Could not switch street \"%s\", for \"%s\"...",
-              street->getId( street ), data->loc->getId( data->loc ) );
-        }
+      if( data->model->reserveRoute( data->model, data->loc->getId( data->loc ), street, reverse, True ) ) {
+        locked = True;
       }
       else {
-        block->unLock( block, data->loc->getId( data->loc ), NULL );
-        if(grouplocked) {
-          unlockBlockGroup(inst, data->blockgroup);
-        }
         TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "Could not lock route \"%s\", for \"%s\"...",
             street->getId( street ), data->loc->getId( data->loc ) );
       }
@@ -103,16 +83,48 @@ Boolean initializeDestination( iOLcDriver inst, iIBlockBase block, iORoute stree
     else {
       TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "Could not lock block \"%s\", for \"%s\"...",
           block->base.id( block ), data->loc->getId( data->loc ) );
-      if(grouplocked) {
-        unlockBlockGroup(inst, data->blockgroup);
-      }
     }
   }
   else {
     TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "Could not lock route \"%s\", for \"%s\"...",
         street->base.id( street ), data->loc->getId( data->loc ) );
-    if(grouplocked) {
-      unlockBlockGroup(inst, data->blockgroup);
+  }
+
+  /* on failure the reservation releases the block group, block and route it took */
+  data->model->reserveEnd( data->model, data->loc->getId( data->loc ), locked );
+  if( !locked && data->blockgroup != prevgroup )
+    data->blockgroup = NULL;
+
+  if( locked ) {
+    if( street->go( street ) ) {
+
+      if( data->gotoBlock != NULL && StrOp.equals( data->gotoBlock, block->base.id( block ) ) ) {
+        TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999,
+                       "GotoBlock %s found for \"%s\"",
+                       data->gotoBlock, data->loc->getId( data->loc ) );
+
+        data->gotoBlock = data->loc->getNextGotoBlock( data->loc, data->gotoBlock );
+        if( data->gotoBlock == NULL) {
+          /* stop after reaching the last gotoBlock */
+          TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "stop after reaching the last gotoBlock");
+          data->run = False;
+        }
+      }
+
+      data->slowdown4route = False;
+
+      return True;
+    }
+    else {
+      block->unLock( block, data->loc->getId( data->loc ), NULL );
+      street->unLock( street, data->loc->getId( data->loc ), NULL, True, False );
+      /* a group which the train already held stays locked */
+      if( grouplocked && data->blockgroup != prevgroup ) {
+        unlockBlockGroup(inst, data->blockgroup);
+        data->blockgroup = NULL;
+      }
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "Could not switch street \"%s\", for \"%s\"...",
+          street->getId( street ), data->loc->getId( data->loc ) );
     }
   }
 
@@ -152,7 +164,8 @@ Boolean initializeGroup( iOLcDriver inst, iIBlockBase block, iIBlockBase curBloc
 
   /* FollowUp in critical sections will only partly work if the next destination belongs to another group. */
   if( group != NULL ) {
-    grouplocked = data->model->lockBlockGroup(data->model, group, block->base.id(block), data->loc->getId( data->loc ) );
+    /* a group taken in a reservation is released with it if the reservation fails */
+    grouplocked = data->model->reserveGroup(data->model, data->loc->getId( data->loc ), group, block->base.id(block) );
 
     if(!grouplocked) {
       TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "unlock blockgroup %s", group );
@@ -117,25 +117,43 @@ void reserveSecondNextBlock( iOLcDriver inst, const char* gotoBlock, iIBlockBase
 
       nextRoute->getDirection( nextRoute, fromBlock->base.id(fromBlock), &fromto );
       /* lock second next destination */
-      if( initializeGroup( inst, nextBlock, NULL ) &&
-          nextBlock->lock( nextBlock, data->loc->getId( data->loc ), fromBlock->base.id(fromBlock), nextRoute->base.id(nextRoute), False, True, !fromto, indelay ) )
-      {
-        if( nextRoute->lock( nextRoute, data->loc->getId( data->loc ), !fromto, True ) ) {
+      if( data->model->reserveBegin( data->model, data->loc->getId( data->loc ), nextBlock->base.id(nextBlock), nextRoute->base.id(nextRoute) ) ) {
+        /* the group of the next block may be the same one */
+        const char* prevgroup = data->blockgroup;
+        Boolean locked = False;
+        Boolean grouplocked = initializeGroup( inst, nextBlock, NULL );
+        if( grouplocked &&
+            data->model->reserveBlock( data->model, data->loc->getId( data->loc ), nextBlock, fromBlock->base.id(fromBlock), nextRoute->base.id(nextRoute), False, True, !fromto, indelay ) )
+        {
+          if( data->model->reserveRoute( data->model, data->loc->getId( data->loc ), nextRoute, !fromto, True ) ) {
+            locked = True;
+          }
+          else {
+            *toBlock = NULL;
+            *toRoute = NULL;
+            TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999,
+                         "could not lock [%s]/[%s] for [%s]",
+                         nextBlock->base.id(nextBlock), nextRoute->getId(nextRoute),
+                         data->loc->getId( data->loc ) );
+          }
+        }
+        else if( grouplocked ) {
+          TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999,
+                       "could not lock [%s] for [%s]",
+                       nextBlock->base.id(nextBlock), data->loc->getId( data->loc ) );
+        }
+        /* on failure only the group, block and route taken here are released */
+        data->model->reserveEnd( data->model, data->loc->getId( data->loc ), locked );
+        if( !locked && data->blockgroup != prevgroup )
+          data->blockgroup = NULL;
+
+        if( locked ) {
           *toBlock = nextBlock;
           *toRoute = nextRoute;
           /* TODO: test if this will not hold other actions... */
           /* TODO: check if the destination is the same before fire a go command for the street */
           nextRoute->go(nextRoute);
         }
-        else {
-          nextBlock->unLock( nextBlock, data->loc->getId( data->loc ), NULL );
-          *toBlock = NULL;
-          *toRoute = NULL;
-          TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999,
-                       "could not lock [%s]/[%s] for [%s]",
-                       nextBlock->base.id(nextBlock), nextRoute->getId(nextRoute),
-                       data->loc->getId( data->loc ) );
-        }
       }
 
     }
@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <time.h>
 
 #include "rocs/public/rocs.h"
 #include "rocs/public/objbase.h"
@@ -39,6 +40,7 @@
 #include "rocs/public/stats.h"
 #include "rocs/public/system.h"
 #include "rocs/public/lib.h"
+#include "rocs/public/event.h"
 
 #include "rocrail/wrapper/public/Cmdline.h"
 #include "rocrail/wrapper/public/ConCmd.h"
@@ -100,6 +102,13 @@ static void __errorReport( iORocNetNode inst, int rc, int rs, int addr);
 static iONode __findChannel(iORocNetNode inst, int channel);
 static int __checkI2C(iORocNetNode inst, int group);
 static void __initThreads(iORocNetNode inst);
+static void __indexIO(iORocNetNode inst);
+static void __activatePort(iORocNetNode inst, int port);
+static void __activateChannel(iORocNetNode inst, int channel);
+static void __deactivatePort(iORocNetNode inst, int port);
+static void __deactivateChannel(iORocNetNode inst, int channel);
+static Boolean __isPortTimed(iOPort port);
+static Boolean __isChannelIdle(iOChannel channel);
 
 
 /** ----- OBase ----- */
@@ -248,6 +257,7 @@ static byte* __handleMobile( iORocNetNode rocnetnode, byte* rn ) {
           data->channels[data->fchanged]->ready = False;
           data->channels[data->fchanged]->sleep = False;
           data->channels[data->fchanged]->idle  = 0;
+          __activateChannel(rocnetnode, data->fchanged);
         }
 
         /* always acknowledge */
@@ -506,6 +516,7 @@ static void __saveIni(iORocNetNode rocnetnode) {
         macro = NodeOp.inst(wMacro.name(), data->ini, ELEMENT_NODE);
         wMacro.setnr(macro, i);
         NodeOp.addChild(data->ini, macro);
+        data->macrosetup[i] = macro;
       }
       if( macro != NULL ) {
         int n = 0;
@@ -703,6 +714,8 @@ static byte* __handlePTStationary( iORocNetNode rocnetnode, byte* rn ) {
         portsetup = NodeOp.inst( wPortSetup.name(), rocnet, ELEMENT_NODE);
         wPortSetup.setport( portsetup, port);
         NodeOp.addChild( rocnet, portsetup );
+        if( port < 129 )
+          data->portsetup[port] = portsetup;
       }
       wPortSetup.settype( portsetup, type);
       wPortSetup.setdelay( portsetup, delay);
@@ -729,6 +742,7 @@ static byte* __handlePTStationary( iORocNetNode rocnetnode, byte* rn ) {
         data->channels[channel]->onpos = pos;
         data->channels[channel]->state  = 1;
       }
+      __activateChannel(rocnetnode, channel);
     }
   }
   break;
@@ -755,6 +769,8 @@ static byte* __handlePTStationary( iORocNetNode rocnetnode, byte* rn ) {
         channelsetup = NodeOp.inst( wChannelSetup.name(), rocnet, ELEMENT_NODE);
         wChannelSetup.setchannel( channelsetup, channel);
         NodeOp.addChild( rocnet, channelsetup );
+        if( channel < 129 )
+          data->channelsetup[channel] = channelsetup;
       }
       wChannelSetup.setoffpos( channelsetup, offpos);
       wChannelSetup.setonpos( channelsetup, onpos);
@@ -785,6 +801,8 @@ static byte* __handlePTStationary( iORocNetNode rocnetnode, byte* rn ) {
         TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "removing port %d", port);
         NodeOp.removeChild( rocnet, portsetup );
         NodeOp.base.del(portsetup);
+        if( port < 129 )
+          data->portsetup[port] = NULL;
 
         if( portdef != NULL ) {
           data->ports[port] = NULL;
@@ -815,6 +833,8 @@ static byte* __handlePTStationary( iORocNetNode rocnetnode, byte* rn ) {
         TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "removing channel %d", channel);
         NodeOp.removeChild( rocnet, channelsetup );
         NodeOp.base.del(channelsetup);
+        if( channel < 129 )
+          data->channelsetup[channel] = NULL;
 
         if( channeldef != NULL ) {
           data->channels[channel] = NULL;
@@ -846,6 +866,8 @@ static byte* __handlePTStationary( iORocNetNode rocnetnode, byte* rn ) {
         portsetup = NodeOp.inst( wPortSetup.name(), rocnet, ELEMENT_NODE);
         wPortSetup.setport( portsetup, port);
         NodeOp.addChild( rocnet, portsetup );
+        if( port < 129 )
+          data->portsetup[port] = portsetup;
       }
       wPortSetup.seteventid( portsetup, eventid);
       wPortSetup.seteventport( portsetup, eventport);
@@ -1143,6 +1165,7 @@ static void __macro(iORocNetNode rocnetnode, int macro, Boolean on, int offset)
         if( (data->macro[macro]->line[i].type&IO_TYPE) == 0 && data->ports[port] != NULL ) {
           __writePort( rocnetnode, port, data->macro[macro]->line[i].value, 2);
           data->ports[port]->state = (data->macro[macro]->line[i].value);
+          __activatePort(rocnetnode, port);
         }
         else if( (data->macro[macro]->line[i].type&IO_TYPE) == 2 && data->channels[port] != NULL) {
           int pos = (data->macro[macro]->line[i].value ? data->channels[port]->onpos:data->channels[port]->offpos);
@@ -1153,6 +1176,7 @@ static void __macro(iORocNetNode rocnetnode, int macro, Boolean on, int offset)
           data->channels[port]->sleep = False;
           data->channels[port]->idle  = 0;
           data->channels[port]->state = (data->macro[macro]->line[i].value?1:0);
+          __activateChannel(rocnetnode, port);
         }
       }
 
@@ -1306,6 +1330,7 @@ static byte* __handleOutput( iORocNetNode rocnetnode, byte* rn ) {
         data->channels[port]->ready = False;
         data->channels[port]->sleep = False;
         data->channels[port]->idle  = 0;
+        __activateChannel(rocnetnode, port);
       }
     }
     else {
@@ -1313,6 +1338,7 @@ static byte* __handleOutput( iORocNetNode rocnetnode, byte* rn ) {
         if( rn[RN_PACKET_DATA + 0] & RN_OUTPUT_ON ) {
           data->ports[port]->offtimer = SystemOp.getTick();
           data->ports[port]->state = 1;
+          __activatePort(rocnetnode, port);
         }
         else {
           data->ports[port]->offtimer = 0;
@@ -1687,11 +1713,28 @@ static void __pwm( void* threadinst ) {
   iORocNetNode     rocnetnode = (iORocNetNode)ThreadOp.getParm( th );
   iORocNetNodeData data       = Data(rocnetnode);
   int i = 0;
+  int n = 0;
+  int active[129];
+  int nractive = 0;
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "RocNet pwm started" );
 
   while( data->run ) {
-    for( i = 0; i < 129; i++ ) {
+    MutexOp.wait( data->activemux );
+    nractive = data->nractivechannels;
+    MemOp.copy( active, data->activechannels, nractive * sizeof(int) );
+    MutexOp.post( data->activemux );
+
+    if( nractive == 0 ) {
+      /* nothing in motion: sleep until a channel gets activated */
+      EventOp.trywait( data->pwmevt, 1000 );
+      EventOp.reset( data->pwmevt );
+      continue;
+    }
+
+    data->pwmcycles++;
+    for( n = 0; n < nractive; n++ ) {
+      i = active[n];
       if( data->channels[i] != NULL ) {
         int delay = (data->channels[i]->options & 0x0F);
         if( delay > 0 ) {
@@ -1807,6 +1850,9 @@ static void __pwm( void* threadinst ) {
         }
 
       }
+
+      if( __isChannelIdle(data->channels[i]) )
+        __deactivateChannel(rocnetnode, i);
     }
 
     ThreadOp.sleep(10);
@@ -1826,6 +1872,7 @@ static void __setLightFunction(iORocNetNode inst, int fnr, Boolean on) {
     data->channels[fnr]->ready = False;
     data->channels[fnr]->sleep = False;
     data->channels[fnr]->idle  = 0;
+    __activateChannel(inst, fnr);
   }
 }
 
@@ -2414,6 +2461,8 @@ static void __scanner( void* threadinst ) {
   iORocNetNode     rocnetnode = (iORocNetNode)ThreadOp.getParm( th );
   iORocNetNodeData data       = Data(rocnetnode);
   int inputVal[128];
+  int active[129];
+  int inputs[129];
   byte msg[256];
   int identwait = 0;
   Boolean LED1 = False;
@@ -2431,7 +2480,9 @@ static void __scanner( void* threadinst ) {
 
   while( data->run ) {
     int i;
-    int nrios = 128;
+    int n;
+    int nractive = 0;
+    int nrinputs = 0;
     Boolean startofday = data->startofday;
 
     data->LED1timer++;
@@ -2455,7 +2506,18 @@ static void __scanner( void* threadinst ) {
     if( data->iorc == 0 ) {
       __scanI2C(rocnetnode);
 
-      for( i = 0; i < nrios; i++ ) {
+      data->scancycles++;
+
+      MutexOp.wait( data->activemux );
+      nractive = data->nractiveports;
+      MemOp.copy( active, data->activeports, nractive * sizeof(int) );
+      nrinputs = data->nrinputports;
+      MemOp.copy( inputs, data->inputports, nrinputs * sizeof(int) );
+      MutexOp.post( data->activemux );
+
+      /* outputs with a running pulse or blink timer */
+      for( n = 0; n < nractive; n++ ) {
+        i = active[n];
         if( data->ports[i] != NULL && (data->ports[i]->type&IO_TYPE) == 0 ) {
           if( (data->ports[i]->type & IO_BLINK)  && data->ports[i]->state && data->ports[i]->delay > 0 ) {
             if( data->ports[i]->offtimer + data->ports[i]->delay <= SystemOp.getTick() ) {
@@ -2486,6 +2548,14 @@ static void __scanner( void* threadinst ) {
           }
         }
 
+        if( !__isPortTimed(data->ports[i]) )
+          __deactivatePort(rocnetnode, i);
+      }
+
+      /* inputs */
+      for( n = 0; n < nrinputs; n++ ) {
+        i = inputs[n];
+
         /* Check for pending Ack */
         if( data->sack && data->ports[i] != NULL && (data->ports[i]->type&IO_TYPE) == 1 && data->ports[i]->ackpending) {
           data->ports[i]->acktimer++;
@@ -2788,9 +2858,13 @@ static Boolean __initDigInt(iORocNetNode inst) {
 
 static iONode __findPort(iORocNetNode inst, int port) {
   iORocNetNodeData data = Data(inst);
-  iONode rocnet = NodeOp.findNode(data->ini, wRocNet.name());
+  iONode rocnet = NULL;
   iONode portsetup = NULL;
 
+  if( port >= 0 && port < 129 )
+    return data->portsetup[port];
+
+  rocnet = NodeOp.findNode(data->ini, wRocNet.name());
   if( rocnet != NULL ) {
     iONode portsetup = wRocNet.getportsetup(rocnet);
     while( portsetup != NULL ) {
@@ -2806,9 +2880,13 @@ static iONode __findPort(iORocNetNode inst, int port) {
 
 static iONode __findChannel(iORocNetNode inst, int channel) {
   iORocNetNodeData data = Data(inst);
-  iONode rocnet = NodeOp.findNode(data->ini, wRocNet.name());
+  iONode rocnet = NULL;
   iONode channelsetup = NULL;
 
+  if( channel >= 0 && channel < 129 )
+    return data->channelsetup[channel];
+
+  rocnet = NodeOp.findNode(data->ini, wRocNet.name());
   if( rocnet != NULL ) {
     iONode channelsetup = wRocNet.getchannelsetup(rocnet);
     while( channelsetup != NULL ) {
@@ -2824,8 +2902,12 @@ static iONode __findChannel(iORocNetNode inst, int channel) {
 
 static iONode __findMacro(iORocNetNode inst, int nr) {
   iORocNetNodeData data = Data(inst);
-  iONode macro = wRocNet.getmacro(data->ini);
+  iONode macro = NULL;
 
+  if( nr >= 0 && nr < 129 )
+    return data->macrosetup[nr];
+
+  macro = wRocNet.getmacro(data->ini);
   while( macro != NULL ) {
     if( wMacro.getnr(macro) == nr ) {
       return macro;
@@ -2836,6 +2918,155 @@ static iONode __findMacro(iORocNetNode inst, int nr) {
   return NULL;
 }
 
+
+/* Index the ini port, channel and macro nodes by number; the first node wins like the scan did. */
+static void __indexSetup(iORocNetNode inst) {
+  iORocNetNodeData data = Data(inst);
+  iONode rocnet = NodeOp.findNode(data->ini, wRocNet.name());
+  iONode macro = wRocNet.getmacro(data->ini);
+
+  MemOp.set( data->portsetup, 0, sizeof(data->portsetup) );
+  MemOp.set( data->channelsetup, 0, sizeof(data->channelsetup) );
+  MemOp.set( data->macrosetup, 0, sizeof(data->macrosetup) );
+
+  if( rocnet != NULL ) {
+    iONode portsetup = wRocNet.getportsetup(rocnet);
+    iONode channelsetup = wRocNet.getchannelsetup(rocnet);
+    while( portsetup != NULL ) {
+      int port = wPortSetup.getport(portsetup);
+      if( port >= 0 && port < 129 && data->portsetup[port] == NULL )
+        data->portsetup[port] = portsetup;
+      portsetup = wRocNet.nextportsetup(rocnet, portsetup);
+    }
+    while( channelsetup != NULL ) {
+      int channel = wChannelSetup.getchannel(channelsetup);
+      if( channel >= 0 && channel < 129 && data->channelsetup[channel] == NULL )
+        data->channelsetup[channel] = channelsetup;
+      channelsetup = wRocNet.nextchannelsetup(rocnet, channelsetup);
+    }
+  }
+
+  while( macro != NULL ) {
+    int nr = wMacro.getnr(macro);
+    if( nr >= 0 && nr < 129 && data->macrosetup[nr] == NULL )
+      data->macrosetup[nr] = macro;
+    macro = wRocNet.nextmacro(data->ini, macro);
+  }
+}
+
+
+/* An output needs the scanner as long as a pulse or blink timer is running. */
+static Boolean __isPortTimed(iOPort port) {
+  return (port != NULL && (port->type&IO_TYPE) == 0 && port->state && port->delay > 0) ? True:False;
+}
+
+
+/* A channel needs the pwm thread while moving, reporting or waiting for the servo sleep. */
+static Boolean __isChannelIdle(iOChannel channel) {
+  if( channel == NULL )
+    return True;
+  if( channel->curpos != (channel->state ? channel->onpos:channel->offpos) )
+    return False;
+  if( !channel->ready )
+    return False;
+  if( (channel->options & PWM_SERVO) && !channel->sleep )
+    return False;
+  return True;
+}
+
+
+static void __activatePort(iORocNetNode inst, int port) {
+  iORocNetNodeData data = Data(inst);
+  if( port < 0 || port > 128 || data->ports[port] == NULL )
+    return;
+  MutexOp.wait( data->activemux );
+  if( !data->portactive[port] ) {
+    data->portactive[port] = True;
+    data->activeports[data->nractiveports] = port;
+    data->nractiveports++;
+  }
+  MutexOp.post( data->activemux );
+}
+
+
+static void __deactivatePort(iORocNetNode inst, int port) {
+  iORocNetNodeData data = Data(inst);
+  int i = 0;
+  MutexOp.wait( data->activemux );
+  /* check again under the mutex: an activate could just have set a new timer */
+  if( data->portactive[port] && !__isPortTimed(data->ports[port]) ) {
+    for( i = 0; i < data->nractiveports; i++ ) {
+      if( data->activeports[i] == port ) {
+        data->nractiveports--;
+        data->activeports[i] = data->activeports[data->nractiveports];
+        break;
+      }
+    }
+    data->portactive[port] = False;
+  }
+  MutexOp.post( data->activemux );
+}
+
+
+static void __activateChannel(iORocNetNode inst, int channel) {
+  iORocNetNodeData data = Data(inst);
+  if( channel < 0 || channel > 128 || data->channels[channel] == NULL )
+    return;
+  MutexOp.wait( data->activemux );
+  if( !data->channelactive[channel] ) {
+    data->channelactive[channel] = True;
+    data->activechannels[data->nractivechannels] = channel;
+    data->nractivechannels++;
+  }
+  MutexOp.post( data->activemux );
+  EventOp.set( data->pwmevt );
+}
+
+
+static void __deactivateChannel(iORocNetNode inst, int channel) {
+  iORocNetNodeData data = Data(inst);
+  int i = 0;
+  MutexOp.wait( data->activemux );
+  if( data->channelactive[channel] && __isChannelIdle(data->channels[channel]) ) {
+    for( i = 0; i < data->nractivechannels; i++ ) {
+      if( data->activechannels[i] == channel ) {
+        data->nractivechannels--;
+        data->activechannels[i] = data->activechannels[data->nractivechannels];
+        break;
+      }
+    }
+    data->channelactive[channel] = False;
+  }
+  MutexOp.post( data->activemux );
+}
+
+
+/* Rebuild the lookup tables and active sets after the I/O setup changed. */
+static void __indexIO(iORocNetNode inst) {
+  iORocNetNodeData data = Data(inst);
+  int i = 0;
+
+  __indexSetup(inst);
+
+  MutexOp.wait( data->activemux );
+  data->nrinputports = 0;
+  for( i = 0; i < 128; i++ ) {
+    if( data->ports[i] != NULL && (data->ports[i]->type&IO_TYPE) == 1 ) {
+      data->inputports[data->nrinputports] = i;
+      data->nrinputports++;
+    }
+  }
+  MutexOp.post( data->activemux );
+
+  /* let the scanner and pwm thread drop what is idle */
+  for( i = 0; i < 129; i++ ) {
+    __activatePort(inst, i);
+    __activateChannel(inst, i);
+  }
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "%d input ports indexed", data->nrinputports );
+}
+
 static void __errorReport( iORocNetNode inst, int rc, int rs, int addr) {
   iORocNetNodeData data = Data(inst);
   byte msg[32];
@@ -3129,6 +3360,7 @@ static void __initIO(iORocNetNode inst) {
     __initControl(inst);
   }
 
+  __indexIO(inst);
 }
 
 static void __checkConsole( iORocNetNodeData data ) {
@@ -3187,6 +3419,91 @@ static void __initThreads(iORocNetNode inst) {
 
 }
 
+/* Dummy I/O benchmark setup: all ports, half of them inputs, and all channels as servo. Not saved. */
+static void __cpuBenchSetup(iORocNetNode inst) {
+  iORocNetNodeData data = Data(inst);
+  iONode rocnet = NodeOp.findNode(data->ini, wRocNet.name());
+  int i = 0;
+
+  if( rocnet == NULL ) {
+    rocnet = NodeOp.inst( wRocNet.name(), data->ini, ELEMENT_NODE);
+    NodeOp.addChild( data->ini, rocnet );
+  }
+
+  __indexSetup(inst);
+  for( i = 1; i < 129; i++ ) {
+    iONode portsetup = data->portsetup[i];
+    iONode channelsetup = data->channelsetup[i];
+    if( portsetup == NULL ) {
+      portsetup = NodeOp.inst( wPortSetup.name(), rocnet, ELEMENT_NODE);
+      wPortSetup.setport( portsetup, i);
+      wPortSetup.settype( portsetup, i % 2 );
+      wPortSetup.setdelay( portsetup, (i % 2) ? 0:5 );
+      NodeOp.addChild( rocnet, portsetup );
+    }
+    if( channelsetup == NULL ) {
+      channelsetup = NodeOp.inst( wChannelSetup.name(), rocnet, ELEMENT_NODE);
+      wChannelSetup.setchannel( channelsetup, i);
+      wChannelSetup.setoffpos( channelsetup, 200 );
+      wChannelSetup.setonpos( channelsetup, 400 );
+      wChannelSetup.setoffsteps( channelsetup, 10 );
+      wChannelSetup.setonsteps( channelsetup, 10 );
+      wChannelSetup.setoptions( channelsetup, PWM_SERVO );
+      NodeOp.addChild( rocnet, channelsetup );
+    }
+  }
+}
+
+
+/* Run the node for cpubench seconds; every second a few outputs pulse and a few servos move. */
+static void __cpuBench(iORocNetNode inst) {
+  iORocNetNodeData data = Data(inst);
+  clock_t cpu0 = 0;
+  clock_t cpu1 = 0;
+  unsigned long scan0 = 0;
+  unsigned long pwm0 = 0;
+  double cpums = 0.0;
+  int sec = 0;
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "CPU benchmark for %d seconds...", data->cpubench );
+  /* let the startup moves settle */
+  ThreadOp.sleep(3000);
+
+  cpu0  = clock();
+  scan0 = data->scancycles;
+  pwm0  = data->pwmcycles;
+
+  for( sec = 0; sec < data->cpubench && data->run; sec++ ) {
+    int i = 0;
+    for( i = 0; i < 4; i++ ) {
+      int port = 2 + ((sec * 4 + i) * 2) % 128;
+      int channel = 1 + (sec * 4 + i) % 128;
+      if( data->ports[port] != NULL ) {
+        data->ports[port]->offtimer = SystemOp.getTick();
+        data->ports[port]->state = 1;
+        __activatePort(inst, port);
+      }
+      if( data->channels[channel] != NULL ) {
+        data->channels[channel]->state = !data->channels[channel]->state;
+        data->channels[channel]->ready = False;
+        data->channels[channel]->sleep = False;
+        data->channels[channel]->idle  = 0;
+        __activateChannel(inst, channel);
+      }
+    }
+    ThreadOp.sleep(1000);
+  }
+
+  cpu1 = clock();
+  cpums = (double)(cpu1 - cpu0) * 1000.0 / CLOCKS_PER_SEC;
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999,
+      "CPU benchmark: %d s, cpu=%.1f ms (%.2f%%), scan cycles=%lu, pwm cycles=%lu, inputs=%d",
+      sec, cpums, sec > 0 ? cpums / (sec * 10.0):0.0, data->scancycles - scan0, data->pwmcycles - pwm0, data->nrinputports );
+
+  RocNetNodeOp.shutdown();
+}
+
+
 static int _Main( iORocNetNode inst, int argc, char** argv ) {
   iORocNetNodeData data = Data(inst);
   iOTrace trc = NULL;
@@ -3205,6 +3522,7 @@ static int _Main( iORocNetNode inst, int argc, char** argv ) {
   const char* nf     = CmdLnOp.getStr( arg, wCmdline.inifile );
   data->libpath       = CmdLnOp.getStr( arg, wCmdline.libpath );
   data->stress        = CmdLnOp.hasKey( arg, wCmdline.stress );
+  data->cpubench      = CmdLnOp.getIntDef( arg, wCmdline.cpubench, 0 );
 
   if( data->libpath == NULL ) {
     data->libpath = ".";
@@ -3384,6 +3702,8 @@ static int _Main( iORocNetNode inst, int argc, char** argv ) {
   TraceOp.setAppID( trc, "r" );
 
   data->i2cmux = MutexOp.inst( NULL, True );
+  data->activemux = MutexOp.inst( NULL, True );
+  data->pwmevt = EventOp.inst( NULL, True );
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "----------------------------------------" );
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "  revision [%d]", revisionnr );
@@ -3402,6 +3722,14 @@ static int _Main( iORocNetNode inst, int argc, char** argv ) {
 
   ThreadOp.sleep(500); /* startup sleep */
   data->class = 0;
+  if( data->cpubench > 0 ) {
+    if( raspiDummy() )
+      __cpuBenchSetup(inst);
+    else {
+      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "CPU benchmark is only available with dummy I/O" );
+      data->cpubench = 0;
+    }
+  }
   __initIO(inst);
 
   __initDigInt(inst);
@@ -3420,6 +3748,10 @@ static int _Main( iORocNetNode inst, int argc, char** argv ) {
 
   __initThreads(inst);
 
+  if( data->cpubench > 0 ) {
+    __cpuBench(inst);
+  }
+
   /* Memory watcher */
   while( !bShutdown ) {
     static int cnt1 = 0;
@@ -42,6 +42,7 @@
 #include "rocs/public/mem.h"
 #include "rocs/public/str.h"
 #include "rocs/public/strtok.h"
+#include "rocs/public/metrics.h"
 
 #include "rocrail/wrapper/public/Action.h"
 #include "rocrail/wrapper/public/ActionCtrl.h"
@@ -69,6 +70,7 @@
 #include "rocrail/wrapper/public/BinStateCmd.h"
 #include "rocrail/wrapper/public/Variable.h"
 #include "rocrail/wrapper/public/Location.h"
+#include "rocrail/wrapper/public/Item.h"
 
 static int instCnt = 0;
 static int levelCnt = 0;
@@ -371,246 +373,514 @@ static Boolean __checkLocoState(const char* locoid, const char* id, const char*
   return rc;
 }
 
-static Boolean __checkConditions(struct OAction* inst, iONode actionctrl) {
-  iOActionData data = Data(inst);
+/* Condition types, resolved once when an action control is compiled. */
+#define COND_NONE     0
+#define COND_BLOCK    1
+#define COND_TEXT     2
+#define COND_VARIABLE 3
+#define COND_SYSTEM   4
+#define COND_OUTPUT   5
+#define COND_SWITCH   6
+#define COND_SIGNAL   7
+#define COND_ROUTE    8
+#define COND_SENSOR   9
+#define COND_OPERATOR 10
+#define COND_LOCO     11
+
+#define ROUTE_ANY      0
+#define ROUTE_LOCKED   1
+#define ROUTE_UNLOCKED 2
+#define ROUTE_CLOSED   3
+#define ROUTE_OPEN     4
+
+/* Compiled condition sets by action control node, and the sets depending on each object ID. */
+static iOMap   __condSets = NULL;
+static iOMap   __condDeps = NULL;
+static iOList  __condRetired = NULL;
+static iOMutex __condMux = NULL;
+static int     __condActive = 0;
+static long    __condGen = 0;
+static int     __mCondEval = -1;
+static int     __mCondCompile = -1;
+
+
+static void __addCondDep( iOList deps, const char* id ) {
+  int i = 0;
+  if( id == NULL || StrOp.len(id) == 0 )
+    return;
+  for( i = 0; i < ListOp.size(deps); i++ ) {
+    if( StrOp.equals( id, (const char*)ListOp.get(deps, i) ) )
+      return;
+  }
+  ListOp.add( deps, (obj)StrOp.dup(id) );
+}
+
+static void __freeArgs( iOList args ) {
+  if( args != NULL ) {
+    int i = 0;
+    for( i = 0; i < ListOp.size(args); i++ )
+      StrOp.free( (char*)ListOp.get(args, i) );
+    ListOp.base.del(args);
+  }
+}
+
+static iONode __resolveVariable( iOModel model, iONode actionctrl, iONode actionCond ) {
+  const char* id = wActionCond.getid( actionCond );
+  const char* subid = wActionCond.getsubid( actionCond );
+  iONode var = NULL;
+  if( subid != NULL && StrOp.len(subid) > 0 ) {
+    char* key = StrOp.fmt( "%s-%s", id, subid );
+    iOMap map = MapOp.inst();
+    MapOp.put(map, "lcid", (obj)wActionCtrl.getlcid(actionctrl));
+    MapOp.put(map, "bkid", (obj)wActionCtrl.getbkid(actionctrl));
+    char* resolvedKey = TextOp.replaceAllSubstitutions(key, map);
+    StrOp.free(key);
+    var = ModelOp.getVariable( model, resolvedKey );
+    StrOp.free(resolvedKey);
+    MapOp.base.del(map);
+  }
+  else {
+    var = ModelOp.getVariable( model, id );
+  }
+  return var;
+}
+
+/* Look up the object of the condition; NULL if not (yet) in the model. */
+static obj __resolveCond( iOModel model, iOActionCond c, iONode actionctrl ) {
+  const char* id = wActionCond.getid( c->cond );
+  switch( c->type ) {
+    case COND_BLOCK:    return (obj)ModelOp.getBlock( model, id );
+    case COND_TEXT:     return (obj)ModelOp.getText( model, id );
+    case COND_VARIABLE: return (obj)__resolveVariable( model, actionctrl, c->cond );
+    case COND_OUTPUT:   return (obj)ModelOp.getOutput( model, id );
+    case COND_SWITCH:   return (obj)ModelOp.getSwitch( model, id );
+    case COND_SIGNAL:   return (obj)ModelOp.getSignal( model, id );
+    case COND_ROUTE:    return (obj)ModelOp.getRoute( model, id );
+    case COND_SENSOR:   return (obj)ModelOp.getFBack( model, id );
+    case COND_OPERATOR: return (obj)ModelOp.getOperator( model, id );
+  }
+  return NULL;
+}
+
+static void __compileCond( iOModel model, iOActionCond c, iONode actionctrl, iONode actionCond, iOList deps ) {
+  const char* type  = wActionCond.gettype(actionCond);
+  const char* id    = wActionCond.getid(actionCond);
+  const char* state = wActionCond.getstate(actionCond);
+
+  c->cond = actionCond;
+
+  if( StrOp.equals( wBlock.name(), type ) )
+    c->type = COND_BLOCK;
+  else if( StrOp.equals( wText.name(), type ) )
+    c->type = COND_TEXT;
+  else if( StrOp.equals( wVariable.name(), type ) ) {
+    const char* subid = wActionCond.getsubid( actionCond );
+    c->type = COND_VARIABLE;
+    c->dynamic = ( StrOp.find( subid, "%" ) != NULL );
+    if( StrOp.len(state) > 0 ) {
+      c->op = state[0];
+      /* numbers only; variables, texts and substitutions are evaluated each time */
+      c->subst = ( StrOp.find( state+1, "%" ) != NULL );
+      c->constval = ( !c->subst && StrOp.find( state+1, "#" ) == NULL && StrOp.find( state+1, "$" ) == NULL );
+      if( c->constval )
+        c->value = VarOp.getValue(state+1, NULL);
+    }
+  }
+  else if( StrOp.equals( wSysCmd.name(), type ) )
+    c->type = COND_SYSTEM;
+  else if( StrOp.equals( wOutput.name(), type ) )
+    c->type = COND_OUTPUT;
+  else if( StrOp.equals( wSwitch.name(), type ) )
+    c->type = COND_SWITCH;
+  else if( StrOp.equals( wSignal.name(), type ) ) {
+    iOStrTok tok = StrTokOp.inst(state, ',');
+    c->type = COND_SIGNAL;
+    c->args = ListOp.inst();
+    while( StrTokOp.hasMoreTokens(tok) )
+      ListOp.add( c->args, (obj)StrOp.dup(StrTokOp.nextToken(tok)) );
+    StrTokOp.base.del(tok);
+  }
+  else if( StrOp.equals( wRoute.name(), type ) ) {
+    c->type = COND_ROUTE;
+    if( StrOp.equals(state, "locked") )
+      c->op = ROUTE_LOCKED;
+    else if( StrOp.equals(state, "unlocked") )
+      c->op = ROUTE_UNLOCKED;
+    else if( StrOp.equals(state, "closed") )
+      c->op = ROUTE_CLOSED;
+    else if( StrOp.equals(state, "open") )
+      c->op = ROUTE_OPEN;
+  }
+  else if( StrOp.equals( wFeedback.name(), type ) ) {
+    iOStrTok tok = StrTokOp.inst(state, ',');
+    c->type = COND_SENSOR;
+    c->args = ListOp.inst();
+    ListOp.add( c->args, (obj)StrOp.dup(StrTokOp.hasMoreTokens(tok) ? StrTokOp.nextToken(tok):"") );
+    if( StrTokOp.hasMoreTokens(tok) )
+      ListOp.add( c->args, (obj)StrOp.dup(StrTokOp.nextToken(tok)) );
+    StrTokOp.base.del(tok);
+  }
+  else if( StrOp.equals( wOperator.name(), type ) )
+    c->type = COND_OPERATOR;
+  else if( StrOp.equals( wLoc.name(), type ) )
+    c->type = COND_LOCO;
+
+  if( !c->dynamic )
+    c->ref = __resolveCond( model, c, actionctrl );
+
+  __addCondDep( deps, id );
+  /* a variable with a sub ID has its own ID */
+  if( c->type == COND_VARIABLE && c->ref != NULL )
+    __addCondDep( deps, wVariable.getid( (iONode)c->ref ) );
+}
+
+static iOCondSet __compileConditions( iONode actionctrl ) {
   iOModel model = AppOp.getModel();
-  Boolean automode = ModelOp.isAuto(model);
-  Boolean rc = True;
+  iOCondSet set = allocMem( sizeof( struct CondSet ) );
+  iONode owner = NodeOp.getParent( actionctrl );
+  iONode actionCond = wActionCtrl.getactioncond(actionctrl);
+  unsigned long t0 = MetricsOp.now();
+  int i = 0;
+
+  set->actionctrl = actionctrl;
+  set->first  = NodeOp.getChild( actionctrl, 0 );
+  set->childs = NodeOp.getChildCnt( actionctrl );
+  set->deps   = ListOp.inst();
+
+  /* the owner may replace its action controls on modify */
+  if( owner != NULL )
+    __addCondDep( set->deps, wItem.getid(owner) );
+
+  while( actionCond != NULL ) {
+    set->cnt++;
+    actionCond = wActionCtrl.nextactioncond(actionctrl, actionCond);
+  }
 
-  if( actionctrl != NULL ) {
-    iONode actionCond = wActionCtrl.getactioncond(actionctrl);
-    if( (automode && wActionCtrl.isauto(actionctrl)) || (!automode && wActionCtrl.ismanual(actionctrl)) ) {
-      while( actionCond != NULL && rc ) {
-        TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Action condition: [%s-%s:%s] ",
-            wActionCond.gettype(actionCond),
-            wActionCond.getid(actionCond),
-            wActionCond.getstate(actionCond) );
+  if( set->cnt > 0 )
+    set->conds = allocMem( set->cnt * sizeof( struct ActionCond ) );
 
-        /* Block */
-        if( StrOp.equals( wBlock.name(), wActionCond.gettype(actionCond) ) ) {
-          const char* id = wActionCond.getid( actionCond );
-          iIBlockBase bk = ModelOp.getBlock( model, id );
-          if( bk != NULL ) {
-            rc = bk->isState(bk, wActionCond.getstate(actionCond) );
-          }
-          else
-            TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "block not found [%s]", id );
-        }
+  actionCond = wActionCtrl.getactioncond(actionctrl);
+  for( i = 0; i < set->cnt; i++ ) {
+    __compileCond( model, &set->conds[i], actionctrl, actionCond, set->deps );
+    actionCond = wActionCtrl.nextactioncond(actionctrl, actionCond);
+  }
 
-        /* Text */
-        else if( StrOp.equals( wText.name(), wActionCond.gettype(actionCond) ) ) {
-          const char* id = wActionCond.getid( actionCond );
-          iOText text = ModelOp.getText( model, id);
-          if( text != NULL ) {
-            rc = StrOp.equals(TextOp.getText(text), wActionCond.getstate(actionCond) );
-          }
-          else
-            TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "text not found [%s]", id );
-        }
+  MetricsOp.since( __mCondCompile, t0 );
+  return set;
+}
 
-        /* Variable */
-        else if( StrOp.equals( wVariable.name(), wActionCond.gettype(actionCond) ) ) {
-          const char* id = wActionCond.getid( actionCond );
-          const char* subid = wActionCond.getsubid( actionCond );
-          iONode var = NULL;
-          if( subid != NULL && StrOp.len(subid) > 0 ) {
-            char* key = StrOp.fmt( "%s-%s", id, subid );
-            iOMap map = MapOp.inst();
-            MapOp.put(map, "lcid", (obj)wActionCtrl.getlcid(actionctrl));
-            MapOp.put(map, "bkid", (obj)wActionCtrl.getbkid(actionctrl));
-            char* resolvedKey = TextOp.replaceAllSubstitutions(key, map);
-            StrOp.free(key);
-            var = ModelOp.getVariable( model, resolvedKey );
-            StrOp.free(resolvedKey);
-            MapOp.base.del(map);
-          }
-          else {
-            var = ModelOp.getVariable( model, id );
-          }
+static void __freeConditions( iOCondSet set ) {
+  int i = 0;
+  for( i = 0; i < set->cnt; i++ )
+    __freeArgs( set->conds[i].args );
+  if( set->conds != NULL )
+    freeMem( set->conds );
+  __freeArgs( set->deps );
+  freeMem( set );
+}
 
-          if( var != NULL ) {
-            const char* state = wActionCond.getstate(actionCond);
-            if( StrOp.len(state) > 0 ) {
-              iOMap map = MapOp.inst();
-              MapOp.put(map, "lcid", (obj)wActionCtrl.getlcid(actionctrl));
-              MapOp.put(map, "bkid", (obj)wActionCtrl.getbkid(actionctrl));
-              int stateVal = VarOp.getValue(state+1, map);
-              MapOp.base.del(map);
-
-              if( state[0] == '=' )
-                rc = wVariable.getvalue(var) == stateVal;
-              else if( state[0] == '>' )
-                rc = wVariable.getvalue(var) > stateVal;
-              else if( state[0] == '<' )
-                rc = wVariable.getvalue(var) < stateVal;
-              else if( state[0] == '!' )
-                rc = wVariable.getvalue(var) != stateVal;
-              /* Text compare */
-              else if( state[0] == '#' )
-                rc = StrOp.equals(wVariable.gettext(var), state+1);
-              else if( state[0] == '?' )
-                rc = !StrOp.equals(wVariable.gettext(var), state+1);
-            }
-          }
-          else
-            TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "variable not found [%s]", id );
-        }
+/* Unlink the set from the cache and the index; freed when no evaluation is running. Call with __condMux. */
+static void __retireConditions( iOCondSet set ) {
+  char key[32];
+  int i = 0;
 
+  StrOp.fmtb( key, "%p", set->actionctrl );
+  if( MapOp.get( __condSets, key ) == (obj)set )
+    MapOp.remove( __condSets, key );
 
-        /* System */
-        else if( StrOp.equals( wSysCmd.name(), wActionCond.gettype(actionCond) ) ) {
-          iONode state = ControlOp.getState(AppOp.getControl());
-          TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "check system: power=%s", wState.ispower(state)?"go":"stop" );
-          if( wState.ispower(state) && !StrOp.equalsi( wSysCmd.go, wActionCond.getstate(actionCond) ) )
-            rc = False;
-          else if( !wState.ispower(state) && !StrOp.equalsi( wSysCmd.stop, wActionCond.getstate(actionCond) ) )
-            rc = False;
-          /* clean up */
-          NodeOp.base.del(state);
+  for( i = 0; i < ListOp.size(set->deps); i++ ) {
+    const char* id = (const char*)ListOp.get(set->deps, i);
+    iOList list = (iOList)MapOp.get( __condDeps, id );
+    if( list != NULL ) {
+      ListOp.removeObj( list, (obj)set );
+      if( ListOp.size(list) == 0 ) {
+        MapOp.remove( __condDeps, id );
+        ListOp.base.del(list);
+      }
+    }
+  }
+  ListOp.add( __condRetired, (obj)set );
+}
+
+static iOCondSet __acquireConditions( iONode actionctrl, Boolean* cached ) {
+  iOCondSet set = NULL;
+  char key[32];
+  long gen = 0;
+
+  StrOp.fmtb( key, "%p", actionctrl );
+
+  MutexOp.wait( __condMux );
+  set = (iOCondSet)MapOp.get( __condSets, key );
+  /* a freed action control node may have been reused */
+  if( set != NULL && ( set->first != NodeOp.getChild( actionctrl, 0 ) || set->childs != NodeOp.getChildCnt( actionctrl ) ) ) {
+    __retireConditions( set );
+    set = NULL;
+  }
+  __condActive++;
+  gen = __condGen;
+  MutexOp.post( __condMux );
+
+  *cached = True;
+  if( set == NULL ) {
+    /* compile outside the lock; the model lookups must not wait for it */
+    set = __compileConditions( actionctrl );
+
+    MutexOp.wait( __condMux );
+    if( gen == __condGen && MapOp.get( __condSets, key ) == NULL ) {
+      int i = 0;
+      MapOp.put( __condSets, key, (obj)set );
+      for( i = 0; i < ListOp.size(set->deps); i++ ) {
+        const char* id = (const char*)ListOp.get(set->deps, i);
+        iOList list = (iOList)MapOp.get( __condDeps, id );
+        if( list == NULL ) {
+          list = ListOp.inst();
+          MapOp.put( __condDeps, id, (obj)list );
         }
+        ListOp.add( list, (obj)set );
+      }
+    }
+    else {
+      /* the plan changed while compiling; use it once */
+      *cached = False;
+    }
+    MutexOp.post( __condMux );
+  }
 
-        /* Output */
-        else if( StrOp.equals( wOutput.name(), wActionCond.gettype(actionCond) ) ) {
-          const char* id = wActionCond.getid( actionCond );
-          iOOutput co = ModelOp.getOutput( model, id );
-          if( co != NULL ) {
-            rc = OutputOp.isState(co, wActionCond.getstate(actionCond) );
-          }
-          else
-            TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "output not found [%s]", id );
+  return set;
+}
+
+static void __releaseConditions( iOCondSet set, Boolean cached ) {
+  if( !cached )
+    __freeConditions( set );
+
+  MutexOp.wait( __condMux );
+  __condActive--;
+  if( __condActive == 0 ) {
+    while( ListOp.size(__condRetired) > 0 ) {
+      iOCondSet retired = (iOCondSet)ListOp.remove( __condRetired, 0 );
+      __freeConditions( retired );
+    }
+  }
+  MutexOp.post( __condMux );
+}
+
+
+static Boolean __checkCondition( iOModel model, iOActionCond c, iONode actionctrl ) {
+  iONode actionCond = c->cond;
+  const char* id = wActionCond.getid( actionCond );
+  const char* state = wActionCond.getstate( actionCond );
+  obj ref = c->ref;
+  Boolean rc = True;
+
+  /* not found at compile time, or depends on the action control */
+  if( ref == NULL && c->type != COND_NONE )
+    ref = __resolveCond( model, c, actionctrl );
+
+  /* Block */
+  if( c->type == COND_BLOCK ) {
+    iIBlockBase bk = (iIBlockBase)ref;
+    if( bk != NULL )
+      rc = bk->isState(bk, state );
+    else
+      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "block not found [%s]", id );
+  }
+
+  /* Text */
+  else if( c->type == COND_TEXT ) {
+    if( ref != NULL )
+      rc = StrOp.equals(TextOp.getText((iOText)ref), state );
+    else
+      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "text not found [%s]", id );
+  }
+
+  /* Variable */
+  else if( c->type == COND_VARIABLE ) {
+    iONode var = (iONode)ref;
+    if( var != NULL ) {
+      if( StrOp.len(state) > 0 ) {
+        int stateVal = c->value;
+        if( c->subst ) {
+          iOMap map = MapOp.inst();
+          MapOp.put(map, "lcid", (obj)wActionCtrl.getlcid(actionctrl));
+          MapOp.put(map, "bkid", (obj)wActionCtrl.getbkid(actionctrl));
+          stateVal = VarOp.getValue(state+1, map);
+          MapOp.base.del(map);
         }
+        else if( !c->constval )
+          stateVal = VarOp.getValue(state+1, NULL);
+
+        if( c->op == '=' )
+          rc = wVariable.getvalue(var) == stateVal;
+        else if( c->op == '>' )
+          rc = wVariable.getvalue(var) > stateVal;
+        else if( c->op == '<' )
+          rc = wVariable.getvalue(var) < stateVal;
+        else if( c->op == '!' )
+          rc = wVariable.getvalue(var) != stateVal;
+        /* Text compare */
+        else if( c->op == '#' )
+          rc = StrOp.equals(wVariable.gettext(var), state+1);
+        else if( c->op == '?' )
+          rc = !StrOp.equals(wVariable.gettext(var), state+1);
+      }
+    }
+    else
+      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "variable not found [%s]", id );
+  }
 
-        /* Switch */
-        else if( StrOp.equals( wSwitch.name(), wActionCond.gettype(actionCond) ) ) {
-          const char* id = wActionCond.getid( actionCond );
-          iOSwitch sw = ModelOp.getSwitch( model, id );
-          if( sw != NULL ) {
-            rc = SwitchOp.isState(sw, wActionCond.getstate(actionCond) );
-          }
-          else
-            TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "object not found [%s]", id );
+  /* System */
+  else if( c->type == COND_SYSTEM ) {
+    iONode sysState = ControlOp.getState(AppOp.getControl());
+    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "check system: power=%s", wState.ispower(sysState)?"go":"stop" );
+    if( wState.ispower(sysState) && !StrOp.equalsi( wSysCmd.go, state ) )
+      rc = False;
+    else if( !wState.ispower(sysState) && !StrOp.equalsi( wSysCmd.stop, state ) )
+      rc = False;
+    /* clean up */
+    NodeOp.base.del(sysState);
+  }
+
+  /* Output */
+  else if( c->type == COND_OUTPUT ) {
+    if( ref != NULL )
+      rc = OutputOp.isState((iOOutput)ref, state );
+    else
+      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "output not found [%s]", id );
+  }
+
+  /* Switch */
+  else if( c->type == COND_SWITCH ) {
+    if( ref != NULL )
+      rc = SwitchOp.isState((iOSwitch)ref, state );
+    else
+      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "object not found [%s]", id );
+  }
+
+  /* Signal */
+  else if( c->type == COND_SIGNAL ) {
+    if( ref != NULL ) {
+      int i = 0;
+      for( i = 0; i < ListOp.size(c->args); i++ ) {
+        rc = SignalOp.isState((iOSignal)ref, (const char*)ListOp.get(c->args, i) );
+        if( rc )
+          break;
+      }
+    }
+    else
+      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "object not found [%s]", id );
+  }
+
+  /* Route */
+  else if( c->type == COND_ROUTE ) {
+    iORoute st = (iORoute)ref;
+    if( st != NULL ) {
+      if( RouteOp.isLocked(st) && c->op == ROUTE_UNLOCKED )
+        rc = False;
+      else if( !RouteOp.isLocked(st) && c->op == ROUTE_LOCKED )
+        rc = False;
+      else if( !RouteOp.isClosed(st) && c->op == ROUTE_CLOSED )
+        rc = False;
+      else if( RouteOp.isClosed(st) && c->op == ROUTE_OPEN )
+        rc = False;
+    }
+  }
+
+  /* Sensor */
+  else if( c->type == COND_SENSOR ) {
+    iOFBack fb = (iOFBack)ref;
+    const char* fbstate = (const char*)ListOp.get(c->args, 0);
+    const char* direction = ListOp.size(c->args) > 1 ? (const char*)ListOp.get(c->args, 1):NULL;
+
+    if( fb != NULL ) {
+      if( StrOp.len(fbstate) > 0 && StrOp.equals(fbstate, FBackOp.getIdentifier(fb)) )
+        rc = True;
+      else
+        rc = FBackOp.isState(fb, fbstate );
+
+      if( rc && direction != NULL ) {
+        iOLoc lc = ModelOp.getLoc(model, wActionCtrl.getlcid(actionctrl), NULL, False);
+        if( lc == NULL ) {
+          lc = ModelOp.getLocByIdent(model, wActionCtrl.getlcid(actionctrl), NULL, NULL, NULL, True);
         }
-        else if( StrOp.equals( wSignal.name(), wActionCond.gettype(actionCond) ) ) {
-          const char* id = wActionCond.getid( actionCond );
-          iOSignal sg = ModelOp.getSignal( model, id );
-          if( sg != NULL ) {
-            iOStrTok tok = StrTokOp.inst(wActionCond.getstate(actionCond), ',');
-            while( StrTokOp.hasMoreTokens(tok) ) {
-              rc = SignalOp.isState(sg, StrTokOp.nextToken(tok) );
-              if( rc )
-                break;
-            }
-            StrTokOp.base.del(tok);
+        if( lc != NULL ) {
+          Boolean dir = LocOp.getDir(lc);
+          Boolean placing = LocOp.getPlacing(lc);
+          if( !placing )
+            dir = !dir;
+          if( StrOp.equals( "forwards", direction ) && !dir ) {
+            rc = False;
+            TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999,
+                "loco %s direction %s does not match [%s] dir=%d(%d) placing=%d",
+                LocOp.getId(lc), dir?"forwards":"reverse", direction, dir, LocOp.getDir(lc), placing );
+          }
+          else if( StrOp.equals( "reverse", direction ) && dir ) {
+            rc = False;
+            TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999,
+                "loco %s direction %s does not match [%s] dir=%d(%d) placing=%d",
+                LocOp.getId(lc), dir?"forwards":"reverse", direction, dir, LocOp.getDir(lc), placing );
           }
-          else
-            TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "object not found [%s]", id );
         }
+      }
+    }
+    else
+      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "object not found [%s]", id );
+  }
 
-        /* Route */
-        else if( StrOp.equals( wRoute.name(), wActionCond.gettype(actionCond) ) ) {
-          const char* id = wActionCond.getid( actionCond );
-          iORoute st = ModelOp.getRoute( model, id );
-          if( st != NULL ) {
-            const char* state = wActionCond.getstate(actionCond);
-            if( RouteOp.isLocked(st) && StrOp.equals(state, "unlocked") ) {
-              rc = False;
-            }
-            else if( !RouteOp.isLocked(st) && StrOp.equals(state, "locked") ) {
-              rc = False;
-            }
-            else if( !RouteOp.isClosed(st) && StrOp.equals(state, "closed") ) {
-              rc = False;
-            }
-            else if( RouteOp.isClosed(st) && StrOp.equals(state, "open") ) {
-              rc = False;
-            }
-          }
+  /* train (operator) */
+  else if( c->type == COND_OPERATOR ) {
+    iOLoc lc = ModelOp.getLoc(model, wActionCtrl.getlcid(actionctrl), NULL, False);
+    rc = False;
+    if( lc != NULL && ref != NULL ) {
+      const char* train = wLoc.gettrain(LocOp.base.properties(lc));
+      if( train != NULL && StrOp.equals(train, id) ) {
+        TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "train ID [%s] match with loco [%s]", id, LocOp.getId(lc));
+        rc = True;
+        if( state != NULL && StrOp.len(state) > 0 ) {
+          rc = __checkLocoState(LocOp.getId(lc), LocOp.getId(lc), state, actionctrl, actionCond);
         }
+      }
+      else {
+        TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "train ID [%s] does not match with loco [%s]-[%s]", id, LocOp.getId(lc), train);
+      }
+    }
+  }
 
-        /* Sensor */
-        else if( StrOp.equals( wFeedback.name(), wActionCond.gettype(actionCond) ) ) {
-          const char* id = wActionCond.getid( actionCond );
-          iOLoc lc = ModelOp.getLoc(model, wActionCtrl.getlcid(actionctrl), NULL, False);
-          iOFBack fb = ModelOp.getFBack( model, id );
-          const char* state = "";
-          const char* direction = NULL;
+  /* loco */
+  else if( c->type == COND_LOCO ) {
+    rc = __checkLocoState(wActionCtrl.getlcid(actionctrl), id, state, actionctrl, actionCond);
+  }
 
-          if( lc == NULL ) {
-            lc = ModelOp.getLocByIdent(model, wActionCtrl.getlcid(actionctrl), NULL, NULL, NULL, True);
-          }
+  return rc;
+}
 
-          iOStrTok tok = StrTokOp.inst(wActionCond.getstate(actionCond), ',');
-          if(StrTokOp.hasMoreTokens(tok))
-            state = StrTokOp.nextToken(tok);
-          if(StrTokOp.hasMoreTokens(tok))
-            direction = StrTokOp.nextToken(tok);
-          StrTokOp.base.del(tok);
+static Boolean __checkConditions(struct OAction* inst, iONode actionctrl) {
+  iOActionData data = Data(inst);
+  iOModel model = AppOp.getModel();
+  Boolean automode = ModelOp.isAuto(model);
+  Boolean rc = True;
 
-          if( fb != NULL ) {
-            if( StrOp.len(state) > 0 && StrOp.equals(state, FBackOp.getIdentifier(fb)) )
-              rc = True;
-            else
-              rc = FBackOp.isState(fb, state );
-
-            if( rc && direction != NULL && lc != NULL ) {
-              /**/
-              Boolean dir = LocOp.getDir(lc);
-              Boolean placing = LocOp.getPlacing(lc);
-              if( !placing )
-                dir = !dir;
-              if( StrOp.equals( "forwards", direction ) && !dir ) {
-                rc = False;
-                TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999,
-                    "loco %s direction %s does not match [%s] dir=%d(%d) placing=%d",
-                    LocOp.getId(lc), dir?"forwards":"reverse", direction, dir, LocOp.getDir(lc), placing );
-              }
-              else if( StrOp.equals( "reverse", direction ) && dir ) {
-                rc = False;
-                TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999,
-                    "loco %s direction %s does not match [%s] dir=%d(%d) placing=%d",
-                    LocOp.getId(lc), dir?"forwards":"reverse", direction, dir, LocOp.getDir(lc), placing );
-              }
-            }
-          }
-          else
-            TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "object not found [%s]", id );
-        }
+  if( actionctrl != NULL ) {
+    if( (automode && wActionCtrl.isauto(actionctrl)) || (!automode && wActionCtrl.ismanual(actionctrl)) ) {
+      unsigned long t0 = MetricsOp.now();
+      Boolean cached = True;
+      iOCondSet set = __acquireConditions( actionctrl, &cached );
+      int i = 0;
 
-        /* train (operator) */
-        else if( StrOp.equals( wOperator.name(), wActionCond.gettype(actionCond) ) ) {
-          const char* id = wActionCond.getid( actionCond );
-          const char* state = wActionCond.getstate(actionCond);
-          iOLoc lc = ModelOp.getLoc(model, wActionCtrl.getlcid(actionctrl), NULL, False);
-          iOOperator opr = ModelOp.getOperator( model, id);
-          rc = False;
-          if( lc != NULL && opr != NULL ) {
-            const char* train = wLoc.gettrain(LocOp.base.properties(lc));
-            if( train != NULL && StrOp.equals(train, id) ) {
-              TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "train ID [%s] match with loco [%s]", id, LocOp.getId(lc));
-              rc = True;
-              if( state != NULL && StrOp.len(state) > 0 ) {
-                rc = __checkLocoState(LocOp.getId(lc), LocOp.getId(lc), state, actionctrl, actionCond);
-              }
-            }
-            else {
-              TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "train ID [%s] does not match with loco [%s]-[%s]", id, LocOp.getId(lc), train);
-            }
-          }
-        }
+      for( i = 0; i < set->cnt && rc; i++ ) {
+        iONode actionCond = set->conds[i].cond;
+        TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Action condition: [%s-%s:%s] ",
+            wActionCond.gettype(actionCond),
+            wActionCond.getid(actionCond),
+            wActionCond.getstate(actionCond) );
 
-        /* loco */
-        else if( StrOp.equals( wLoc.name(), wActionCond.gettype(actionCond) ) ) {
-          const char* id = wActionCond.getid( actionCond );
-          const char* state = wActionCond.getstate(actionCond);
-          rc = __checkLocoState(wActionCtrl.getlcid(actionctrl), id, state, actionctrl, actionCond);
-        }
+        rc = __checkCondition( model, &set->conds[i], actionctrl );
 
         /* */
         TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, rc?"Condition is true.":"Condition is not true; skip action." );
-
-
-        actionCond = wActionCtrl.nextactioncond(actionctrl, actionCond);
       }
+
+      __releaseConditions( set, cached );
+      MetricsOp.since( __mCondEval, t0 );
     }
     else {
       TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "%s%s%s mode action, running in %s mode, skip action %s",
@@ -783,11 +1053,13 @@ static void __executeAction( struct OAction* inst, iONode actionctrl ) {
         wVariable.settimer(var, True);
         if( startval != -1 )
           wVariable.setvalue(var, startval);
+        ControlOp.reschedule( AppOp.getControl(), var );
         TraceOp.trc( name, TRCLEVEL_CALC, __LINE__, 9999, "variable [%s] cmd=[%s] timer started with value %d",
             wVariable.getid(var), cmdStr, wVariable.getvalue(var) );
       }
       else if( StrOp.equals( wVariable.op_stop, wAction.getcmd( data->action ) ) ) {
         wVariable.settimer(var, False);
+        ControlOp.reschedule( AppOp.getControl(), var );
         TraceOp.trc( name, TRCLEVEL_CALC, __LINE__, 9999, "variable [%s] cmd=[%s] timer stopped with value %d",
             wVariable.getid(var), cmdStr, wVariable.getvalue(var) );
       }
@@ -1713,6 +1985,40 @@ static void _tick( iOAction inst, int seconds ) {
 
 
 
+static void _invalidate( const char* id ) {
+  if( __condMux == NULL )
+    return;
+
+  MutexOp.wait( __condMux );
+  __condGen++;
+  if( id == NULL ) {
+    iOList sets = ListOp.inst();
+    iOCondSet set = (iOCondSet)MapOp.first( __condSets );
+    while( set != NULL ) {
+      ListOp.add( sets, (obj)set );
+      set = (iOCondSet)MapOp.next( __condSets );
+    }
+    while( ListOp.size(sets) > 0 )
+      __retireConditions( (iOCondSet)ListOp.remove( sets, 0 ) );
+    ListOp.base.del(sets);
+  }
+  else {
+    iOList list = NULL;
+    /* retiring a set removes it from the list, and an empty list from the index */
+    while( (list = (iOList)MapOp.get( __condDeps, id )) != NULL ) {
+      TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "drop compiled conditions depending on [%s]", id );
+      __retireConditions( (iOCondSet)ListOp.get( list, 0 ) );
+    }
+  }
+  MutexOp.post( __condMux );
+}
+
+
+static Boolean _checkConditions( iOAction inst, iONode actionctrl ) {
+  return __checkConditions( inst, actionctrl );
+}
+
+
 static void _modify( iOAction inst, iONode props ) {
   iOActionData data = Data(inst);
   NodeOp.mergeNode( data->action, props, True, True, False );
@@ -1728,6 +2034,15 @@ static struct OAction* _inst( iONode ini ) {
   /* Initialize data->xxx members... */
   data->action = ini;
 
+  if( __condMux == NULL ) {
+    __condMux     = MutexOp.inst( NULL, True );
+    __condSets    = MapOp.inst();
+    __condDeps    = MapOp.inst();
+    __condRetired = ListOp.inst();
+    __mCondEval    = MetricsOp.histogram( "action_conditions_us", "Action condition evaluation in microseconds." );
+    __mCondCompile = MetricsOp.histogram( "action_conditions_compile_us", "Action condition compilation in microseconds." );
+  }
+
   if( wAction.israndom(data->action) ) {
     int secs = wAction.gethour(data->action) * 60 * 60 + wAction.getmin(data->action) * 60 + wAction.getsec(data->action);
     if( secs < 1 ) secs = 1;
@@ -38,6 +38,8 @@
 #include "rocs/public/cmdln.h"
 #include "rocs/public/stats.h"
 #include "rocs/public/system.h"
+#include "rocs/public/span.h"
+#include "rocs/public/metrics.h"
 
 #include "rocrail/impl/app_impl.h"
 #include "rocrail/public/clntcon.h"
@@ -51,6 +53,7 @@
 #include "rocrail/wrapper/public/Global.h"
 #include "rocrail/wrapper/public/RocRail.h"
 #include "rocrail/wrapper/public/Ctrl.h"
+#include "rocrail/wrapper/public/EventBatch.h"
 #include "rocrail/wrapper/public/Tcp.h"
 #include "rocrail/wrapper/public/Trace.h"
 #include "rocrail/wrapper/public/SysCmd.h"
@@ -312,6 +315,9 @@ static void _setIni( iONode ini ) {
       wTrace.setmonitor( curtrace, wTrace.ismonitor( trace ) );
       wTrace.setinfo( curtrace, wTrace.isinfo( trace ) );
       wTrace.setcalc( curtrace, wTrace.iscalc( trace ) );
+      wTrace.setspans( curtrace, wTrace.isspans( trace ) );
+      /* the digints only stamp the read time if spans were on at startup */
+      SpanOp.enable( wTrace.isspans( curtrace ) );
 
       tracelevel trcLvlOld = TraceOp.getLevel( NULL );
       tracelevel trcLvlNew = trcLvlOld ;
@@ -389,6 +395,14 @@ static iOControl _getControl( void ) {
   return NULL;
 }
 
+static iOSim _getSim( void ) {
+  if( __appinst != NULL ) {
+    iOAppData data = Data(__appinst);
+    return data->sim;
+  }
+  return NULL;
+}
+
 static iOClntCon _getClntCon( void ) {
   if( __appinst != NULL ) {
     iOAppData data = Data(__appinst);
@@ -498,6 +512,15 @@ static void __help( void ) {
   TraceOp.println( "-f                       | Init field." );
   TraceOp.println( "-nodevcheck              | Disable check for serial devices at startup." );
   TraceOp.println( "-stress                  | Enable the stress runner for testing communication." );
+  TraceOp.println( "-bench [script]          | Replay a recorded script headless, report and exit." );
+  TraceOp.println( "-benchspeed [n]          | Replay speed: 0=no pauses, 1=real time, n=n times faster. [0]" );
+  TraceOp.println( "-benchout [file]         | Write the bench result." );
+  TraceOp.println( "-baseline [file]         | Exit with 1 on a regression against this bench result." );
+  TraceOp.println( "-benchtol [percent]      | Allowed deviation from the baseline. [10]" );
+  TraceOp.println( "-benchscenario [name]    | Run a built-in bench scenario like fbdispatch, report and exit." );
+  TraceOp.println( "-genplan [file]          | Generate a plan and exit; sizes with:" );
+  TraceOp.println( "  -genblocks [n] -genswitches [n] -gensensors [n] -genlocos [n]" );
+  TraceOp.println( "  -genlevels [n] -genmodules [n] -genseed [n] -genscript [file]" );
   TraceOp.println( "-------------------------+--------------------------------------------"  );
   TraceOp.println( "-installservice          | Install Rocrail as Windows service." );
   TraceOp.println( "-deleteservice           | Uninstall Rocrail as Windows service." );
@@ -720,6 +743,9 @@ static int _Main( iOApp inst, int argc, char** argv ) {
 
   Boolean automode    = CmdLnOp.hasKey( arg, wCmdline.automode );
   Boolean resume      = CmdLnOp.hasKey( arg, wCmdline.resume );
+  const char* benchscript = CmdLnOp.getStr( arg, wCmdline.bench );
+  const char* benchscenario = CmdLnOp.getStr( arg, wCmdline.benchscenario );
+  iOBench     bench   = NULL;
   data->run           = CmdLnOp.hasKey( arg, wCmdline.run );
   data->stress        = CmdLnOp.hasKey( arg, wCmdline.stress );
   data->createmodplan = CmdLnOp.hasKey( arg, wCmdline.modplan );
@@ -731,6 +757,7 @@ static int _Main( iOApp inst, int argc, char** argv ) {
     cd = FileOp.cd( wd );
   }
 
+  MetricsOp.init();
   trc = TraceOp.inst( debug | dump | monitor | parse | info | TRCLEVEL_WARNING | TRCLEVEL_CALC | TRCLEVEL_STATUS, tf, True );
   TraceOp.setAppID( trc, "r" );
 
@@ -780,6 +807,20 @@ static int _Main( iOApp inst, int argc, char** argv ) {
     }
   }
 
+  /* Synthetic plan for scale tests */
+  if( CmdLnOp.getStr( arg, wCmdline.genplan ) != NULL ) {
+    int blocks = PlanGenOp.generate( CmdLnOp.getStr( arg, wCmdline.genplan ),
+        CmdLnOp.getIntDef( arg, wCmdline.genblocks, 100 ),
+        CmdLnOp.getIntDef( arg, wCmdline.genswitches, 40 ),
+        CmdLnOp.getIntDef( arg, wCmdline.gensensors, -1 ),
+        CmdLnOp.getIntDef( arg, wCmdline.genlocos, 20 ),
+        CmdLnOp.getIntDef( arg, wCmdline.genlevels, 1 ),
+        CmdLnOp.getIntDef( arg, wCmdline.genmodules, 0 ),
+        CmdLnOp.getIntDef( arg, wCmdline.genseed, 1 ),
+        CmdLnOp.getStr( arg, wCmdline.genscript ) );
+    return blocks > 0 ? 0:1;
+  }
+
 
   /* Read the Inifile: */
   {
@@ -873,6 +914,7 @@ static int _Main( iOApp inst, int argc, char** argv ) {
     TraceOp.setLevel( trc, TraceOp.getLevel( trc ) | TRCLEVEL_PARSE );
   if( wTrace.iscalc( wRocRail.gettrace( data->ini ) ) )
     TraceOp.setLevel( trc, TraceOp.getLevel( trc ) | TRCLEVEL_CALC );
+  SpanOp.enable( wTrace.isspans( wRocRail.gettrace( data->ini ) ) );
 
 
   /* Tracefile and listener */
@@ -977,6 +1019,11 @@ static int _Main( iOApp inst, int argc, char** argv ) {
 
   MemOp.setDebug( False );
 
+  /* Headless benchmark: only the virtual command station */
+  if( benchscript != NULL || benchscenario != NULL ) {
+    bench = BenchOp.inst( benchscript, CmdLnOp.getIntDef( arg, wCmdline.benchspeed, 0 ) );
+    BenchOp.virtualize( bench, data->ini );
+  }
 
   /* Control */
   data->control = ControlOp.inst( nocom );
@@ -988,6 +1035,9 @@ static int _Main( iOApp inst, int argc, char** argv ) {
   }
   data->weather = WeatherOp.inst( wPlan.getweather(ModelOp.getModel(data->model)) );
 
+  /* Simulation of virtual trains */
+  data->sim = SimOp.inst( wRocRail.getctrl( data->ini ) );
+
   /* Client connection */
   {
     iONode tcp = wRocRail.gettcp(data->ini);
@@ -1054,6 +1104,19 @@ static int _Main( iOApp inst, int argc, char** argv ) {
     }
   }
 
+  if( bench != NULL ) {
+    /* exit without shutdown: the workspace files are left untouched */
+    int rc = 0;
+    if( benchscenario != NULL )
+      rc = BenchOp.scenario( bench, data->control, benchscenario, CmdLnOp.getStr( arg, wCmdline.benchout ),
+          CmdLnOp.getStr( arg, wCmdline.baseline ), CmdLnOp.getIntDef( arg, wCmdline.benchtol, 10 ) );
+    else
+      rc = BenchOp.run( bench, data->control, CmdLnOp.getStr( arg, wCmdline.benchout ),
+          CmdLnOp.getStr( arg, wCmdline.baseline ), CmdLnOp.getIntDef( arg, wCmdline.benchtol, 10 ) );
+    BenchOp.base.del( bench );
+    return rc == 0 ? 0:( rc > 0 ? 1:2 );
+  }
+
   /* Memory watcher */
   while( !bShutdown ) {
     static int cnt1 = 0;
@@ -1220,6 +1283,7 @@ static Boolean _shutdown( int network, const char* signame ) {
 
     TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Informing controller..." );
     WeatherOp.halt( data->weather );
+    SimOp.halt( data->sim );
     ControlOp.halt( data->control );
 
     /* signal main loop */
@@ -1306,13 +1370,83 @@ static Boolean _isStress( void ) {
 }
 
 
+/* Events of a thread with an open batch are collected in its batch node. */
+static Boolean __addToBatch( iOAppData data, iONode event ) {
+  iONode batch = NULL;
+  char key[32];
+  StrOp.fmtb( key, "%lu", ThreadOp.id() );
+  MutexOp.wait( data->batchMux );
+  batch = (iONode)MapOp.get( data->batches, key );
+  if( batch != NULL )
+    NodeOp.addChild( batch, event );
+  MutexOp.post( data->batchMux );
+  return batch != NULL ? True:False;
+}
+
+static void _beginBroadcastBatch( void ) {
+  if( __appinst != NULL ) {
+    iOAppData data = Data(__appinst);
+    char key[32];
+    StrOp.fmtb( key, "%lu", ThreadOp.id() );
+    MutexOp.wait( data->batchMux );
+    if( !MapOp.haskey( data->batches, key ) ) {
+      MapOp.put( data->batches, key, (obj)NodeOp.inst( wEventBatch.name(), NULL, ELEMENT_NODE ) );
+      data->batchCnt++;
+    }
+    MutexOp.post( data->batchMux );
+  }
+}
+
+/* ClntCon writes the batch to each client in one go; the other
+   connections have their own write batching and get the events one by one. */
+static void _endBroadcastBatch( void ) {
+  if( __appinst != NULL ) {
+    iOAppData data = Data(__appinst);
+    iONode batch = NULL;
+    char key[32];
+    int i = 0;
+
+    StrOp.fmtb( key, "%lu", ThreadOp.id() );
+    MutexOp.wait( data->batchMux );
+    batch = (iONode)MapOp.remove( data->batches, key );
+    if( batch != NULL )
+      data->batchCnt--;
+    MutexOp.post( data->batchMux );
+
+    if( batch == NULL )
+      return;
+
+    if( NodeOp.getChildCnt( batch ) == 1 ) {
+      iONode event = NodeOp.getChild( batch, 0 );
+      NodeOp.removeChild( batch, event );
+      AppOp.broadcastEvent( event );
+    }
+    else if( NodeOp.getChildCnt( batch ) > 1 ) {
+      if( data->clntCon != NULL )
+        ClntConOp.broadcastEvent( data->clntCon, (iONode)NodeOp.base.clone( batch ) );
+      for( i = 0; i < NodeOp.getChildCnt( batch ); i++ ) {
+        iONode event = NodeOp.getChild( batch, i );
+        if( data->srcpCon != NULL )
+          SrcpConOp.broadcastEvent( data->srcpCon, (iONode)NodeOp.base.clone( event ) );
+        if( data->http != NULL )
+          HttpOp.broadcastEvent( data->http, event );
+      }
+    }
+    NodeOp.base.del( batch );
+  }
+}
+
 static void _broadcastEvent( iONode event ) {
   if( __appinst != NULL ) {
     iOAppData data = Data(__appinst);
+    if( data->batchCnt > 0 && __addToBatch( data, event ) )
+      return;
     if( data->clntCon != NULL )
       ClntConOp.broadcastEvent(data->clntCon, (iONode)NodeOp.base.clone(event));
     if( data->srcpCon != NULL )
       SrcpConOp.broadcastEvent(data->srcpCon, (iONode)NodeOp.base.clone(event));
+    if( data->http != NULL )
+      HttpOp.broadcastEvent(data->http, event);
 
     NodeOp.base.del(event);
   }
@@ -1361,6 +1495,8 @@ static iOApp _inst(void) {
     __appinst = app;
 
     __exceptionMutex = MutexOp.inst( NULL, True );
+    data->batchMux = MutexOp.inst( NULL, True );
+    data->batches  = MapOp.inst();
 
     data->appstartTime = time(NULL);
     data->szLibPath = NULL;
@@ -0,0 +1,4754 @@
+/*
+ Rocrail - Model Railroad Software
+
+ Copyright (C) 2002-2014 Rob Versluis, Rocrail.net
+
+
+
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+#if defined __linux__ && !defined _GNU_SOURCE
+  /* posix_openpt() */
+  #define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined _WIN32
+  #include <windows.h>
+#else
+  #include <sys/time.h>
+  #include <sys/resource.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/socket.h>
+#endif
+
+#include "rocrail/impl/bench_impl.h"
+
+#include "rocrail/public/app.h"
+#include "rocrail/public/model.h"
+#include "rocrail/public/script.h"
+#include "rocrail/public/block.h"
+#include "rocrail/public/action.h"
+#include "rocrail/public/route.h"
+#include "rocrail/public/fback.h"
+#include "rocrail/public/rcon.h"
+#include "rocrail/public/http.h"
+#include "rocrail/public/srcpcon.h"
+#include "rocrail/public/r2rnet.h"
+#include "rocrail/public/loc.h"
+
+#include "rocs/public/mem.h"
+#include "rocs/public/trace.h"
+#include "rocs/public/str.h"
+#include "rocs/public/strtok.h"
+#include "rocs/public/metrics.h"
+#include "rocs/public/lib.h"
+#include "rocs/public/system.h"
+#include "rocs/public/socket.h"
+#include "rocs/public/serial.h"
+
+#include "rocint/public/digint.h"
+#include "rocdigs/impl/ddx/queue.h"
+#include "rocdigs/impl/ddx/locpool.h"
+
+#include "rocrail/wrapper/public/RocRail.h"
+#include "rocrail/wrapper/public/Plan.h"
+#include "rocrail/wrapper/public/DigInt.h"
+#include "rocrail/wrapper/public/Block.h"
+#include "rocrail/wrapper/public/BlockList.h"
+#include "rocrail/wrapper/public/FeedbackEvent.h"
+#include "rocrail/wrapper/public/Feedback.h"
+#include "rocrail/wrapper/public/FeedbackList.h"
+#include "rocrail/wrapper/public/FbBatch.h"
+#include "rocrail/wrapper/public/FbDelta.h"
+#include "rocrail/wrapper/public/ModelCmd.h"
+#include "rocrail/wrapper/public/Route.h"
+#include "rocrail/wrapper/public/RouteList.h"
+#include "rocrail/wrapper/public/Output.h"
+#include "rocrail/wrapper/public/Action.h"
+#include "rocrail/wrapper/public/ActionCtrl.h"
+#include "rocrail/wrapper/public/ActionCond.h"
+#include "rocrail/wrapper/public/Item.h"
+#include "rocrail/wrapper/public/Tcp.h"
+#include "rocrail/wrapper/public/HttpService.h"
+#include "rocrail/wrapper/public/SrcpCon.h"
+#include "rocrail/wrapper/public/Switch.h"
+#include "rocrail/wrapper/public/Text.h"
+#include "rocrail/wrapper/public/Loc.h"
+#include "rocrail/wrapper/public/LocoNet.h"
+#include "rocrail/wrapper/public/LNSlotServer.h"
+#include "rocrail/wrapper/public/DDX.h"
+#include "rocrail/wrapper/public/SnmpService.h"
+#include "rocrail/wrapper/public/R2RnetIni.h"
+#include "rocrail/wrapper/public/Ctrl.h"
+#include "rocrail/wrapper/public/FunCmd.h"
+#include "rocrail/wrapper/public/Variable.h"
+#include "rocrail/wrapper/public/Clock.h"
+#include "rocrail/wrapper/public/SystemActions.h"
+
+static int instCnt = 0;
+
+/* Latency histograms reported and compared against the baseline. */
+static const char* __latency[] = {
+  "bench_replay_us",
+  "control_dispatch_us",
+  "digint_command_us",
+  "clntcon_broadcast_us",
+  "model_finddest_us",
+  "loc_runner_lag_us",
+  NULL
+};
+
+/** ----- OBase ----- */
+static void __del( void* inst ) {
+  if( inst != NULL ) {
+    iOBenchData data = Data(inst);
+    if( data->result != NULL )
+      NodeOp.base.del( data->result );
+    StrOp.free( (char*)data->script );
+    freeMem( data );
+    freeMem( inst );
+    instCnt--;
+  }
+  return;
+}
+
+static const char* __name( void ) {
+  return name;
+}
+
+static unsigned char* __serialize( void* inst, long* size ) {
+  return NULL;
+}
+
+static void __deserialize( void* inst,unsigned char* bytestream ) {
+  return;
+}
+
+static char* __toString( void* inst ) {
+  iOBenchData data = Data(inst);
+  return (char*)data->script;
+}
+
+static int __count( void ) {
+  return instCnt;
+}
+
+static struct OBase* __clone( void* inst ) {
+  return NULL;
+}
+
+static Boolean __equals( void* inst1, void* inst2 ) {
+  return False;
+}
+
+static void* __properties( void* inst ) {
+  iOBenchData data = Data(inst);
+  return data->result;
+}
+
+static const char* __id( void* inst ) {
+  return NULL;
+}
+
+static void* __event( void* inst, const void* evt ) {
+  return NULL;
+}
+
+/** ----- OBench ----- */
+
+
+static int __metricId( const char* metric ) {
+  int cnt = MetricsOp.getCount();
+  int id = 0;
+  for( id = 0; id < cnt; id++ ) {
+    if( StrOp.equals( metric, MetricsOp.getName(id) ) )
+      return id;
+  }
+  return -1;
+}
+
+
+static long __metricCount( const char* metric ) {
+  int id = __metricId( metric );
+  return id == -1 ? 0:MetricsOp.getValue( id, METRIC_VALUE );
+}
+
+
+/* Everything the replay can trigger; stable means the server has settled. */
+static long __activity( void ) {
+  return __metricCount( "control_dispatch_us" ) + __metricCount( "digint_command_us" ) +
+         __metricCount( "clntcon_broadcast_us" );
+}
+
+
+/* User plus system CPU time of the process in ms. */
+static long __cpuTime( void ) {
+#if defined _WIN32
+  FILETIME c, e, k, u;
+  if( GetProcessTimes( GetCurrentProcess(), &c, &e, &k, &u ) ) {
+    ULARGE_INTEGER kt, ut;
+    kt.LowPart = k.dwLowDateTime; kt.HighPart = k.dwHighDateTime;
+    ut.LowPart = u.dwLowDateTime; ut.HighPart = u.dwHighDateTime;
+    return (long)( ( kt.QuadPart + ut.QuadPart ) / 10000 );
+  }
+  return 0;
+#else
+  struct rusage ru;
+  getrusage( RUSAGE_SELF, &ru );
+  return ( ru.ru_utime.tv_sec + ru.ru_stime.tv_sec ) * 1000L +
+         ( ru.ru_utime.tv_usec + ru.ru_stime.tv_usec ) / 1000L;
+#endif
+}
+
+
+/* Peak resident set size in KB; not available on Windows without psapi. */
+static long __maxRSS( void ) {
+#if defined _WIN32
+  return 0;
+#else
+  struct rusage ru;
+  getrusage( RUSAGE_SELF, &ru );
+#if defined __APPLE__
+  return ru.ru_maxrss / 1024;
+#else
+  return ru.ru_maxrss;
+#endif
+#endif
+}
+
+
+static char* __readFile( const char* filename ) {
+  char* content = NULL;
+  if( filename != NULL && FileOp.exist(filename) ) {
+    int size = FileOp.fileSize(filename);
+    iOFile f = FileOp.inst( filename, OPEN_READONLY );
+    if( f != NULL ) {
+      content = allocMem( size + 1 );
+      FileOp.read( f, content, size );
+      FileOp.base.del( f );
+    }
+  }
+  return content;
+}
+
+
+static void __virtualizeDigInt( iONode digint ) {
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "bench: digint [%s] lib [%s] replaced by [%s]",
+      wDigInt.getiid(digint), wDigInt.getlib(digint), wDigInt.vcs );
+  wDigInt.setlib( digint, wDigInt.vcs );
+}
+
+
+static void _virtualize( iOBench inst, iONode ini ) {
+  iONode plan = AppOp.getModel() != NULL ? ModelOp.getModel( AppOp.getModel() ):NULL;
+  iONode digint = wRocRail.getdigint( ini );
+
+  while( digint != NULL ) {
+    __virtualizeDigInt( digint );
+    digint = wRocRail.nextdigint( ini, digint );
+  }
+
+  digint = plan != NULL ? wPlan.getdigint( plan ):NULL;
+  while( digint != NULL ) {
+    __virtualizeDigInt( digint );
+    digint = wPlan.nextdigint( plan, digint );
+  }
+}
+
+
+/* Feed the script lines to the control object like the script player does; returns the number of commands. */
+static int __replay( iOBench inst, iOControl control, char* record ) {
+  iOBenchData data = Data(inst);
+  int mReplay = MetricsOp.histogram( "bench_replay_us", "Dispatch time of a replayed script line." );
+  char* line = record;
+  int lines = 0;
+
+  while( line != NULL && *line != '\0' ) {
+    char* next = StrOp.findc( line, '\n' );
+    int len = 0;
+
+    if( next != NULL ) {
+      *next = '\0';
+      next++;
+    }
+    len = StrOp.len( line );
+    if( len > 0 && line[len-1] == '\r' )
+      line[len-1] = '\0';
+
+    if( line[0] == '\0' || line[0] == '#' ) {
+      /* empty or comment */
+    }
+    else if( StrOp.startsWithi( line, "pause," ) ) {
+      if( data->speed > 0 )
+        ThreadOp.sleep( atoi( line + 6 ) * 1000 / data->speed );
+    }
+    else {
+      iONode node = ScriptOp.parseLine( line, False );
+      if( node != NULL ) {
+        unsigned long t0 = MetricsOp.now();
+        control->base.event( control, node );
+        MetricsOp.since( mReplay, t0 );
+        lines++;
+      }
+      else {
+        TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "bench: skipping [%s]", line );
+      }
+    }
+
+    line = next;
+  }
+  return lines;
+}
+
+
+static void __settle( void ) {
+  long prev = __activity();
+  int quiet = 0;
+  int waited = 0;
+
+  while( quiet < BenchOp.settle && waited < BenchOp.settlemax ) {
+    long cur = 0;
+    ThreadOp.sleep( 100 );
+    waited += 100;
+    cur = __activity();
+    quiet = ( cur == prev ) ? quiet + 100:0;
+    prev = cur;
+  }
+  if( quiet < BenchOp.settle )
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "bench: still busy after %d ms", waited );
+}
+
+
+static iONode __findMetric( iONode result, const char* metric ) {
+  iONode child = NodeOp.findNode( result, "metric" );
+  while( child != NULL ) {
+    if( StrOp.equals( metric, NodeOp.getStr( child, "name", "" ) ) )
+      return child;
+    child = NodeOp.findNextNode( result, child );
+  }
+  return NULL;
+}
+
+
+/* Throughput, CPU and memory may deviate tolerance percent; p99 has power of two resolution and may go one bucket up. */
+static int __compare( iONode result, iONode base, int tolerance ) {
+  int regressions = 0;
+  long linesps  = NodeOp.getLong( result, "linesps", 0 );
+  long blinesps = NodeOp.getLong( base, "linesps", 0 );
+  long cpu      = NodeOp.getLong( result, "cpu", 0 );
+  long bcpu     = NodeOp.getLong( base, "cpu", 0 );
+  long rss      = NodeOp.getLong( result, "rss", 0 );
+  long brss     = NodeOp.getLong( base, "rss", 0 );
+  iONode bmetric = NULL;
+
+  if( NodeOp.getInt( result, "lines", 0 ) != NodeOp.getInt( base, "lines", 0 ) ) {
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "bench: baseline replayed %d lines, this run %d",
+        NodeOp.getInt( base, "lines", 0 ), NodeOp.getInt( result, "lines", 0 ) );
+  }
+
+  /* paced runs measure the pauses, not the throughput */
+  if( NodeOp.getInt( result, "speed", 0 ) == 0 && NodeOp.getInt( base, "speed", 0 ) == 0 &&
+      linesps * 100 < blinesps * ( 100 - tolerance ) )
+  {
+    TraceOp.println( "REGRESSION: linesps %ld < baseline %ld", linesps, blinesps );
+    regressions++;
+  }
+
+  /* 50 ms slack for the tick resolution of short runs */
+  if( cpu * 100 > bcpu * ( 100 + tolerance ) + 5000 ) {
+    TraceOp.println( "REGRESSION: cpu %ld ms > baseline %ld ms", cpu, bcpu );
+    regressions++;
+  }
+
+  if( brss > 0 && rss * 100 > brss * ( 100 + tolerance ) ) {
+    TraceOp.println( "REGRESSION: rss %ld KB > baseline %ld KB", rss, brss );
+    regressions++;
+  }
+
+  if( NodeOp.getLong( base, "opsps", 0 ) > 0 &&
+      NodeOp.getLong( result, "opsps", 0 ) * 100 < NodeOp.getLong( base, "opsps", 0 ) * ( 100 - tolerance ) )
+  {
+    TraceOp.println( "REGRESSION: opsps %ld < baseline %ld", NodeOp.getLong( result, "opsps", 0 ), NodeOp.getLong( base, "opsps", 0 ) );
+    regressions++;
+  }
+
+  bmetric = NodeOp.findNode( base, "metric" );
+  while( bmetric != NULL ) {
+    iONode metric = __findMetric( result, NodeOp.getStr( bmetric, "name", "" ) );
+    if( metric != NULL ) {
+      long p99  = NodeOp.getLong( metric, "p99", 0 );
+      long bp99 = NodeOp.getLong( bmetric, "p99", 0 );
+      if( p99 * 100 > ( 2 * bp99 + 1 ) * ( 100 + tolerance ) ) {
+        TraceOp.println( "REGRESSION: %s p99 %ld us > baseline %ld us", NodeOp.getStr( metric, "name", "" ), p99, bp99 );
+        regressions++;
+      }
+    }
+    bmetric = NodeOp.findNextNode( base, bmetric );
+  }
+
+  return regressions;
+}
+
+
+/* Keeps the result, prints and writes it and compares it with the baseline; 0=OK, 1=regression, -1=error. */
+static int __report( iOBench inst, iONode result, const char* outfile, const char* baseline, int tolerance ) {
+  iOBenchData data = Data(inst);
+
+  if( data->result != NULL )
+    NodeOp.base.del( data->result );
+  data->result = result;
+
+  {
+    char* s = NodeOp.toEscString( result );
+    TraceOp.println( "%s", s );
+    if( outfile != NULL ) {
+      iOFile f = FileOp.inst( outfile, OPEN_WRITE );
+      if( f != NULL ) {
+        FileOp.writeStr( f, s );
+        FileOp.base.del( f );
+      }
+    }
+    StrOp.free( s );
+  }
+
+  if( baseline != NULL ) {
+    char* xml = __readFile( baseline );
+    iODoc doc = xml != NULL ? DocOp.parse( xml ):NULL;
+    int regressions = -1;
+    if( doc != NULL && DocOp.getRootNode( doc ) != NULL ) {
+      iONode base = DocOp.getRootNode( doc );
+      regressions = __compare( result, base, tolerance );
+      NodeOp.base.del( base );
+      DocOp.base.del( doc );
+    }
+    freeMem( xml );
+
+    if( regressions == -1 ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: unable to read baseline [%s]", baseline );
+      return -1;
+    }
+    TraceOp.println( "bench: %d regression(s) against [%s], tolerance %d%%", regressions, baseline, tolerance );
+    return regressions > 0 ? 1:0;
+  }
+
+  return 0;
+}
+
+
+static int _run( iOBench inst, iOControl control, const char* outfile, const char* baseline, int tolerance ) {
+  iOBenchData data = Data(inst);
+  char* record = __readFile( data->script );
+  unsigned long t0 = 0;
+  unsigned long replayed = 0;
+  unsigned long settled = 0;
+  long cpu0 = 0;
+  long cmds0 = 0;
+  long bcast0 = 0;
+  int lines = 0;
+  int i = 0;
+  iONode result = NULL;
+
+  if( record == NULL ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: script [%s] not found", data->script );
+    return -1;
+  }
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "bench: replay [%s] speed=%d", data->script, data->speed );
+
+  /* startup work done before the replay is not counted */
+  __settle();
+
+  cpu0   = __cpuTime();
+  cmds0  = __metricCount( "digint_commands_total" );
+  bcast0 = __metricCount( "clntcon_broadcast_us" );
+  t0 = MetricsOp.now();
+
+  lines = __replay( inst, control, record );
+  replayed = MetricsOp.now();
+  __settle();
+  settled = MetricsOp.now();
+  freeMem( record );
+
+  result = NodeOp.inst( "bench", NULL, ELEMENT_NODE );
+  NodeOp.setStr( result, "script", data->script );
+  NodeOp.setInt( result, "speed", data->speed );
+  NodeOp.setInt( result, "lines", lines );
+  NodeOp.setLong( result, "replay", (long)( ( replayed - t0 ) / 1000 ) );
+  NodeOp.setLong( result, "wall", (long)( ( settled - t0 ) / 1000 ) );
+  NodeOp.setLong( result, "linesps", (long)( (double)lines * 1000000.0 / (double)( replayed - t0 + 1 ) ) );
+  NodeOp.setLong( result, "commands", __metricCount( "digint_commands_total" ) - cmds0 );
+  NodeOp.setLong( result, "broadcasts", __metricCount( "clntcon_broadcast_us" ) - bcast0 );
+  NodeOp.setLong( result, "cpu", __cpuTime() - cpu0 );
+  NodeOp.setLong( result, "rss", __maxRSS() );
+  NodeOp.setLong( result, "memsize", MemOp.getAllocSize() );
+  NodeOp.setLong( result, "memcount", MemOp.getAllocCount() );
+
+  for( i = 0; __latency[i] != NULL; i++ ) {
+    int id = __metricId( __latency[i] );
+    if( id != -1 ) {
+      iONode metric = NodeOp.inst( "metric", result, ELEMENT_NODE );
+      NodeOp.setStr( metric, "name", __latency[i] );
+      NodeOp.setLong( metric, "count", MetricsOp.getValue( id, METRIC_VALUE ) );
+      NodeOp.setLong( metric, "p50", MetricsOp.getValue( id, METRIC_P50 ) );
+      NodeOp.setLong( metric, "p99", MetricsOp.getValue( id, METRIC_P99 ) );
+      NodeOp.setLong( metric, "max", MetricsOp.getValue( id, METRIC_MAX ) );
+      NodeOp.addChild( result, metric );
+    }
+  }
+
+  return __report( inst, result, outfile, baseline, tolerance );
+}
+
+
+/* Reproducible pseudo random numbers for the scenarios. */
+static int __random( unsigned long* seed ) {
+  *seed = *seed * 1103515245UL + 12345UL;
+  return (int)( ( *seed >> 16 ) & 0x7FFF );
+}
+
+
+/* The fbevent of the former string keyed map: sensor[-ep]-from[-route], the last put wins. */
+static iONode __findFbEventByKey( iONode props, const char* key ) {
+  iOModel model = AppOp.getModel();
+  iONode found = NULL;
+  iONode fbevt = wBlock.getfbevent( props );
+  char evtkey[256];
+
+  while( fbevt != NULL ) {
+    const char* fbid = wFeedbackEvent.getid( fbevt );
+    const char* byroute = wFeedbackEvent.getbyroute( fbevt );
+    Boolean endpuls = wFeedbackEvent.isendpuls( fbevt );
+
+    if( StrOp.len( fbid ) > 0 && ModelOp.getFBack( model, fbid ) != NULL ) {
+      iOStrTok tok = StrTokOp.inst( wFeedbackEvent.getfrom( fbevt ), ',' );
+      while( StrTokOp.hasMoreTokens(tok) ) {
+        const char* fromblockid = StrTokOp.nextToken( tok );
+        if( byroute != NULL && StrOp.len( byroute ) > 0 && !StrOp.equals( wFeedbackEvent.from_all, byroute) && !StrOp.equals( wFeedbackEvent.from_all_reverse, byroute) )
+          StrOp.fmtb( evtkey, "%s%s-%s-%s", fbid, endpuls?"-ep":"", fromblockid, byroute );
+        else
+          StrOp.fmtb( evtkey, "%s%s-%s", fbid, endpuls?"-ep":"", fromblockid );
+        if( StrOp.equals( evtkey, key ) )
+          found = fbevt;
+      }
+      StrTokOp.base.del(tok);
+    }
+    fbevt = wBlock.nextfbevent( props, fbevt );
+  }
+  return found;
+}
+
+
+static void __addUnique( iOList list, const char* id ) {
+  int i = 0;
+  for( i = 0; i < ListOp.size( list ); i++ ) {
+    if( StrOp.equals( id, (const char*)ListOp.get( list, i ) ) )
+      return;
+  }
+  ListOp.add( list, (obj)StrOp.dup( id ) );
+}
+
+
+/* Same fbevent, or both none; the dispatch table returns copies. */
+static Boolean __sameFbEvent( iONode copy, iONode evt ) {
+  Boolean same = False;
+  if( copy == NULL || evt == NULL )
+    same = copy == evt;
+  else {
+    char* a = NodeOp.base.toString( copy );
+    char* b = NodeOp.base.toString( evt );
+    same = StrOp.equals( a, b );
+    StrOp.free( a );
+    StrOp.free( b );
+  }
+  if( copy != NULL )
+    NodeOp.base.del( copy );
+  return same;
+}
+
+
+/* Resolves every sensor, from block, route, puls and side combination through the
+ * dispatch table of the block and the former key lookup; returns the number of differences. */
+static int __verifyFbEvents( iOBlock block, int* cases ) {
+  iONode props = (iONode)BlockOp.base.properties( block );
+  iOList sensors = ListOp.inst();
+  iOList froms   = ListOp.inst();
+  iOList routes  = ListOp.inst();
+  iONode fbevt = wBlock.getfbevent( props );
+  int differences = 0;
+  int s = 0, f = 0, r = 0, p = 0;
+
+  /* every id the table knows, plus unknown and empty ones */
+  __addUnique( sensors, "?" );
+  __addUnique( froms, "" );
+  __addUnique( froms, "?" );
+  __addUnique( routes, "" );
+  __addUnique( routes, "?" );
+  while( fbevt != NULL ) {
+    iOStrTok tok = StrTokOp.inst( wFeedbackEvent.getfrom( fbevt ), ',' );
+    __addUnique( sensors, wFeedbackEvent.getid( fbevt ) );
+    while( StrTokOp.hasMoreTokens(tok) )
+      __addUnique( froms, StrTokOp.nextToken( tok ) );
+    StrTokOp.base.del(tok);
+    if( wFeedbackEvent.getbyroute( fbevt ) != NULL )
+      __addUnique( routes, wFeedbackEvent.getbyroute( fbevt ) );
+    fbevt = wBlock.nextfbevent( props, fbevt );
+  }
+
+  for( s = 0; s < ListOp.size( sensors ); s++ ) {
+    const char* fbid = (const char*)ListOp.get( sensors, s );
+    for( f = 0; f < ListOp.size( froms ); f++ ) {
+      const char* from = (const char*)ListOp.get( froms, f );
+      for( r = 0; r < ListOp.size( routes ); r++ ) {
+        const char* route = (const char*)ListOp.get( routes, r );
+        /* ids with a '-' could collide in the former keys */
+        if( StrOp.findc( fbid, '-' ) != NULL || StrOp.findc( from, '-' ) != NULL || StrOp.findc( route, '-' ) != NULL )
+          continue;
+        for( p = 0; p < 4; p++ ) {
+          Boolean puls = ( p & 1 ) ? True:False;
+          Boolean blockSide = ( p & 2 ) ? True:False;
+          iONode keyEvt = NULL;
+          iONode keyAll = NULL;
+          char key[256];
+
+          if( StrOp.len( route ) > 0 ) {
+            StrOp.fmtb( key, "%s%s-%s-%s", fbid, puls?"":"-ep", from, route );
+            keyEvt = __findFbEventByKey( props, key );
+          }
+          if( keyEvt == NULL ) {
+            StrOp.fmtb( key, "%s%s-%s", fbid, puls?"":"-ep", from );
+            keyEvt = __findFbEventByKey( props, key );
+          }
+          StrOp.fmtb( key, "%s%s-%s", fbid, puls?"":"-ep", blockSide ? wFeedbackEvent.from_all:wFeedbackEvent.from_all_reverse );
+          keyAll = __findFbEventByKey( props, key );
+
+          if( !__sameFbEvent( BlockOp.getFbEvent( block, fbid, puls, blockSide, from, route, False ), keyEvt ) ||
+              !__sameFbEvent( BlockOp.getFbEvent( block, fbid, puls, blockSide, from, route, True ), keyAll ) ) {
+            TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "block [%s] sensor [%s] from [%s] route [%s] puls=%d side=%d resolves differently",
+                BlockOp.base.id( block ), fbid, from, route, puls, blockSide );
+            differences++;
+          }
+          (*cases)++;
+        }
+      }
+    }
+  }
+
+  while( ListOp.size( sensors ) > 0 )
+    StrOp.free( (char*)ListOp.remove( sensors, 0 ) );
+  while( ListOp.size( froms ) > 0 )
+    StrOp.free( (char*)ListOp.remove( froms, 0 ) );
+  while( ListOp.size( routes ) > 0 )
+    StrOp.free( (char*)ListOp.remove( routes, 0 ) );
+  ListOp.base.del( sensors );
+  ListOp.base.del( froms );
+  ListOp.base.del( routes );
+  return differences;
+}
+
+
+/* Adds seeded random fbevents to all blocks and resolves every combination by the dispatch table and by the former key lookup. */
+static int __fbDispatch( iOBench inst, iOControl control, iONode result ) {
+  iOModel model = AppOp.getModel();
+  iONode bklist = wPlan.getbklist( ModelOp.getModel( model ) );
+  iONode fblist = wPlan.getfblist( ModelOp.getModel( model ) );
+  iOList blocks  = ListOp.inst();
+  iOList sensors = ListOp.inst();
+  iONode bk = bklist != NULL ? wBlockList.getbk( bklist ):NULL;
+  iONode fb = fblist != NULL ? wFeedbackList.getfb( fblist ):NULL;
+  unsigned long seed = 4711;
+  int fbevents = 0;
+  int cases = 0;
+  int differences = 0;
+  int i = 0;
+
+  while( bk != NULL ) {
+    iIBlockBase block = ModelOp.getBlock( model, wBlock.getid( bk ) );
+    if( block != NULL && StrOp.findc( wBlock.getid( bk ), '-' ) == NULL )
+      ListOp.add( blocks, (obj)block );
+    bk = wBlockList.nextbk( bklist, bk );
+  }
+  while( fb != NULL ) {
+    if( StrOp.findc( wFeedback.getid( fb ), '-' ) == NULL )
+      ListOp.add( sensors, (obj)wFeedback.getid( fb ) );
+    fb = wFeedbackList.nextfb( fblist, fb );
+  }
+
+  if( ListOp.size( blocks ) < 2 || ListOp.size( sensors ) < 1 ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: fbdispatch needs at least two blocks and a sensor" );
+    ListOp.base.del( blocks );
+    ListOp.base.del( sensors );
+    return -1;
+  }
+
+  for( i = 0; i < ListOp.size( blocks ); i++ ) {
+    iOBlock block = (iOBlock)ListOp.get( blocks, i );
+    iONode props = (iONode)NodeOp.base.clone( BlockOp.base.properties( block ) );
+    iONode prev = NULL;
+    int n = 4 + __random( &seed ) % 12;
+    int e = 0;
+
+    for( e = 0; e < n; e++ ) {
+      iONode fbevt = NodeOp.inst( wFeedbackEvent.name(), props, ELEMENT_NODE );
+      iOBlock other = (iOBlock)ListOp.get( blocks, __random( &seed ) % ListOp.size( blocks ) );
+      int r = __random( &seed );
+      char from[256];
+      char route[32];
+
+      if( prev != NULL && r % 8 == 0 ) {
+        /* duplicate: the last one wins */
+        wFeedbackEvent.setid( fbevt, wFeedbackEvent.getid( prev ) );
+        wFeedbackEvent.setfrom( fbevt, wFeedbackEvent.getfrom( prev ) );
+        wFeedbackEvent.setbyroute( fbevt, wFeedbackEvent.getbyroute( prev ) );
+        wFeedbackEvent.setendpuls( fbevt, wFeedbackEvent.isendpuls( prev ) );
+      }
+      else {
+        wFeedbackEvent.setid( fbevt, (const char*)ListOp.get( sensors, __random( &seed ) % ListOp.size( sensors ) ) );
+
+        if( r % 8 == 1 )
+          StrOp.copy( from, wFeedbackEvent.from_all );
+        else if( r % 8 == 2 )
+          StrOp.copy( from, wFeedbackEvent.from_all_reverse );
+        else if( r % 8 == 3 )
+          StrOp.fmtb( from, "%s,%s", BlockOp.base.id( other ), BlockOp.base.id( ListOp.get( blocks, __random( &seed ) % ListOp.size( blocks ) ) ) );
+        else
+          StrOp.copy( from, BlockOp.base.id( other ) );
+        wFeedbackEvent.setfrom( fbevt, from );
+
+        r = __random( &seed );
+        if( r % 4 == 0 ) {
+          StrOp.fmtb( route, "rt%d", r % 5 );
+          wFeedbackEvent.setbyroute( fbevt, route );
+        }
+        else if( r % 16 == 1 )
+          wFeedbackEvent.setbyroute( fbevt, wFeedbackEvent.from_all );
+        wFeedbackEvent.setendpuls( fbevt, __random( &seed ) % 4 == 0 ? True:False );
+      }
+      wFeedbackEvent.setaction( fbevt, __random( &seed ) % 2 == 0 ? wFeedbackEvent.enter_event:wFeedbackEvent.in_event );
+      NodeOp.addChild( props, fbevt );
+      prev = fbevt;
+      fbevents++;
+    }
+
+    ModelOp.modifyItem( model, props );
+    NodeOp.base.del( props );
+  }
+
+  for( i = 0; i < ListOp.size( blocks ); i++ )
+    differences += __verifyFbEvents( (iOBlock)ListOp.get( blocks, i ), &cases );
+
+  NodeOp.setInt( result, "blocks", ListOp.size( blocks ) );
+  NodeOp.setInt( result, "fbevents", fbevents );
+  NodeOp.setInt( result, "cases", cases );
+  NodeOp.setInt( result, "differences", differences );
+  ListOp.base.del( blocks );
+  ListOp.base.del( sensors );
+  return differences;
+}
+
+
+/* Collects the IDs of a plan list. */
+static void __listIds( iONode list, iOList ids ) {
+  iONode item = list != NULL ? NodeOp.getChild( list, 0 ):NULL;
+  while( item != NULL ) {
+    if( StrOp.len( wItem.getid( item ) ) > 0 )
+      ListOp.add( ids, (obj)wItem.getid( item ) );
+    item = NodeOp.findNextNode( list, item );
+  }
+}
+
+
+/* A large set of action controls with block, sensor and route conditions:
+ * a cold pass compiles and evaluates, the warm passes evaluate the compiled conditions. */
+static int __actions( iOBench inst, iOControl control, iONode result ) {
+  iOModel model = AppOp.getModel();
+  iONode plan = ModelOp.getModel( model );
+  iOList types = ListOp.inst();
+  iOList lists = ListOp.inst();
+  iOList blocks  = ListOp.inst();
+  iOList sensors = ListOp.inst();
+  iOList routes  = ListOp.inst();
+  iONode owner = NodeOp.inst( wOutput.name(), NULL, ELEMENT_NODE );
+  iONode actionNode = NodeOp.inst( wAction.name(), NULL, ELEMENT_NODE );
+  iOAction action = NULL;
+  Boolean* cold = NULL;
+  tracelevel level = 0;
+  unsigned long seed = 4711;
+  unsigned long t0 = 0;
+  unsigned long coldus = 0;
+  unsigned long warmus = 0;
+  int ctrls = 2000;
+  int passes = 20;
+  int conds = 0;
+  int failures = 0;
+  int i = 0;
+  int p = 0;
+
+  __listIds( wPlan.getbklist( plan ), blocks );
+  __listIds( wPlan.getfblist( plan ), sensors );
+  __listIds( wPlan.getstlist( plan ), routes );
+  if( ListOp.size( blocks ) > 0 ) {
+    ListOp.add( types, (obj)wBlock.name() );
+    ListOp.add( lists, (obj)blocks );
+  }
+  if( ListOp.size( sensors ) > 0 ) {
+    ListOp.add( types, (obj)wFeedback.name() );
+    ListOp.add( lists, (obj)sensors );
+  }
+  if( ListOp.size( routes ) > 0 ) {
+    ListOp.add( types, (obj)wRoute.name() );
+    ListOp.add( lists, (obj)routes );
+  }
+
+  if( ListOp.size( types ) == 0 ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: actions needs blocks, sensors or routes" );
+    failures = -1;
+  }
+  else {
+    wOutput.setid( owner, "benchactions" );
+    wAction.setid( actionNode, "benchaction" );
+    action = ActionOp.inst( actionNode );
+
+    for( i = 0; i < ctrls; i++ ) {
+      iONode actionctrl = NodeOp.inst( wActionCtrl.name(), owner, ELEMENT_NODE );
+      int n = 1 + __random( &seed ) % 12;
+      int c = 0;
+      wActionCtrl.setid( actionctrl, "benchaction" );
+      wActionCtrl.setauto( actionctrl, True );
+      wActionCtrl.setmanual( actionctrl, True );
+      for( c = 0; c < n; c++ ) {
+        iONode cond = NodeOp.inst( wActionCond.name(), actionctrl, ELEMENT_NODE );
+        int t = __random( &seed ) % ListOp.size( types );
+        iOList ids = (iOList)ListOp.get( lists, t );
+        const char* type = (const char*)ListOp.get( types, t );
+        wActionCond.settype( cond, type );
+        wActionCond.setid( cond, (const char*)ListOp.get( ids, __random( &seed ) % ListOp.size( ids ) ) );
+        if( StrOp.equals( wBlock.name(), type ) )
+          wActionCond.setstate( cond, __random( &seed ) % 2 == 0 ? "free":"occupied" );
+        else if( StrOp.equals( wFeedback.name(), type ) )
+          wActionCond.setstate( cond, __random( &seed ) % 2 == 0 ? "true":"false" );
+        else
+          wActionCond.setstate( cond, __random( &seed ) % 2 == 0 ? "unlocked":"locked" );
+        NodeOp.addChild( actionctrl, cond );
+      }
+      NodeOp.addChild( owner, actionctrl );
+      conds += n;
+    }
+
+    /* the info trace of each condition would be measured instead */
+    level = TraceOp.getLevel( NULL );
+    TraceOp.setLevel( NULL, level & ~TRCLEVEL_INFO );
+
+    /* cold: compile and evaluate */
+    cold = allocMem( ctrls * sizeof( Boolean ) );
+    ActionOp.invalidate( NULL );
+    t0 = MetricsOp.now();
+    for( i = 0; i < ctrls; i++ )
+      cold[i] = ActionOp.checkConditions( action, NodeOp.getChild( owner, i ) );
+    coldus = MetricsOp.now() - t0;
+
+    /* warm: evaluate the compiled conditions; the plan does not change meanwhile */
+    t0 = MetricsOp.now();
+    for( p = 0; p < passes; p++ ) {
+      for( i = 0; i < ctrls; i++ ) {
+        if( ActionOp.checkConditions( action, NodeOp.getChild( owner, i ) ) != cold[i] )
+          failures++;
+      }
+    }
+    warmus = MetricsOp.now() - t0;
+    TraceOp.setLevel( NULL, level );
+
+    ActionOp.invalidate( wOutput.getid( owner ) );
+    freeMem( cold );
+    ActionOp.base.del( action );
+
+    NodeOp.setInt( result, "actionctrls", ctrls );
+    NodeOp.setInt( result, "conditions", conds );
+    NodeOp.setLong( result, "coldus", (long)coldus );
+    NodeOp.setLong( result, "warmus", (long)( warmus / passes ) );
+    NodeOp.setLong( result, "opsps", (long)( (double)ctrls * passes * 1000000.0 / (double)( warmus + 1 ) ) );
+  }
+
+  NodeOp.base.del( owner );
+  NodeOp.base.del( actionNode );
+  ListOp.base.del( types );
+  ListOp.base.del( lists );
+  ListOp.base.del( blocks );
+  ListOp.base.del( sensors );
+  ListOp.base.del( routes );
+  return failures;
+}
+
+
+static Boolean __hasId( iOList ids, const char* id ) {
+  int i = 0;
+  for( i = 0; i < ListOp.size( ids ); i++ ) {
+    if( StrOp.equals( id, (const char*)ListOp.get( ids, i ) ) )
+      return True;
+  }
+  return False;
+}
+
+
+static int __routesTo( iONode stlist, const char* bkid ) {
+  int cnt = 0;
+  iONode st = wRouteList.getst( stlist );
+  while( st != NULL ) {
+    if( StrOp.equals( bkid, wRoute.getbkb( st ) ) )
+      cnt++;
+    st = wRouteList.nextst( stlist, st );
+  }
+  return cnt;
+}
+
+
+/* One train of the throat scenario; the routes, owners and mux are shared. */
+struct BenchTrain {
+  char          lcid[32];
+  iOList        routes;
+  iOMap         owners;
+  iOMutex       mux;
+  unsigned long seed;
+  int attempts;
+  int reserved;
+  int deferred;
+  int failed;
+  int rolledback;
+  int violations;
+  Boolean done;
+};
+
+/* Takes or releases a resource of a completed reservation; a second owner is a violation. */
+static int __own( struct BenchTrain* t, const char* id, Boolean take ) {
+  int violations = 0;
+  MutexOp.wait( t->mux );
+  if( take ) {
+    if( MapOp.get( t->owners, id ) != NULL ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: [%s] reserved by [%s] and [%s]",
+          id, (const char*)MapOp.get( t->owners, id ), t->lcid );
+      violations++;
+    }
+    MapOp.put( t->owners, id, (obj)t->lcid );
+  }
+  else if( MapOp.get( t->owners, id ) == (obj)t->lcid )
+    MapOp.remove( t->owners, id );
+  MutexOp.post( t->mux );
+  return violations;
+}
+
+
+/* Reserves destinations in the throat like reserveSecondNextBlock: block and route in one bracket. */
+static void __throatTrain( void* threadinst ) {
+  iOThread th = (iOThread)threadinst;
+  struct BenchTrain* t = (struct BenchTrain*)ThreadOp.getParm( th );
+  iOModel model = AppOp.getModel();
+  int i = 0;
+
+  for( i = 0; i < BenchOp.throatattempts; i++ ) {
+    iORoute route = (iORoute)ListOp.get( t->routes, __random( &t->seed ) % ListOp.size( t->routes ) );
+    iIBlockBase block = ModelOp.getBlock( model, RouteOp.getToBlock( route ) );
+    Boolean locked = False;
+    Boolean halfway = False;
+
+    t->attempts++;
+    if( !ModelOp.reserveBegin( model, t->lcid, block->base.id( block ), RouteOp.base.id( route ) ) ) {
+      t->deferred++;
+      ThreadOp.sleep( 1 );
+      continue;
+    }
+    /* a block locked without its route is released by reserveEnd */
+    if( ModelOp.reserveBlock( model, t->lcid, block, RouteOp.getFromBlock( route ), RouteOp.base.id( route ), False, True, False, 0 ) &&
+        ModelOp.reserveRoute( model, t->lcid, route, False, True ) )
+      locked = True;
+    else if( StrOp.equals( t->lcid, block->getLoc( block ) ) )
+      halfway = True;
+    ModelOp.reserveEnd( model, t->lcid, locked );
+
+    if( halfway ) {
+      t->rolledback++;
+      if( StrOp.equals( t->lcid, block->getLoc( block ) ) ) {
+        TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: [%s] not rolled back for [%s]", block->base.id( block ), t->lcid );
+        t->violations++;
+      }
+    }
+
+    if( !locked ) {
+      t->failed++;
+      ThreadOp.sleep( 1 );
+      continue;
+    }
+
+    t->reserved++;
+    t->violations += __own( t, block->base.id( block ), True );
+    t->violations += __own( t, RouteOp.base.id( route ), True );
+    ThreadOp.sleep( 2 );
+    __own( t, block->base.id( block ), False );
+    __own( t, RouteOp.base.id( route ), False );
+    RouteOp.unLock( route, t->lcid, NULL, True, False );
+    block->unLock( block, t->lcid, RouteOp.base.id( route ) );
+  }
+
+  ThreadOp.base.del( th );
+  MutexOp.wait( t->mux );
+  t->done = True;
+  MutexOp.post( t->mux );
+}
+
+
+static Boolean __trainsDone( struct BenchTrain* trains, int cnt ) {
+  Boolean done = True;
+  int i = 0;
+  MutexOp.wait( trains[0].mux );
+  for( i = 0; i < cnt; i++ ) {
+    if( !trains[i].done )
+      done = False;
+  }
+  MutexOp.post( trains[0].mux );
+  return done;
+}
+
+
+/* Trains reserve routes into the few blocks with the most routes, like in front of a station.
+ * Fails on a resource with two owners, on a block not rolled back with its route,
+ * or on a resource which is still locked afterwards. */
+static int __throat( iOBench inst, iOControl control, iONode result ) {
+  iOModel model = AppOp.getModel();
+  iONode plan = ModelOp.getModel( model );
+  iOList routes = ListOp.inst();
+  iOList dests  = ListOp.inst();
+  iONode stlist = wPlan.getstlist( plan );
+  iONode st = NULL;
+  struct BenchTrain* trains = NULL;
+  iOMutex mux = MutexOp.inst( NULL, True );
+  iOMap owners = MapOp.inst();
+  long deferred0 = __metricCount( "reservations_deferred_total" );
+  long deadlocks0 = __metricCount( "reservation_deadlocks_total" );
+  unsigned long t0 = 0;
+  unsigned long us = 0;
+  int ntrains = 0;
+  int failures = 0;
+  int reserved = 0;
+  int rolledback = 0;
+  int i = 0;
+  int d = 0;
+
+  /* the destinations with the most routes */
+  for( d = 0; d < BenchOp.throatdests && stlist != NULL; d++ ) {
+    const char* best = NULL;
+    int max = 0;
+    for( st = wRouteList.getst( stlist ); st != NULL; st = wRouteList.nextst( stlist, st ) ) {
+      const char* bkid = wRoute.getbkb( st );
+      iIBlockBase block = ModelOp.getBlock( model, bkid );
+      if( !__hasId( dests, bkid ) && block != NULL && StrOp.len( block->getLoc( block ) ) == 0 ) {
+        int cnt = __routesTo( stlist, bkid );
+        if( cnt > max ) {
+          best = bkid;
+          max = cnt;
+        }
+      }
+    }
+    if( best != NULL )
+      ListOp.add( dests, (obj)best );
+  }
+  for( st = stlist != NULL ? wRouteList.getst( stlist ):NULL; st != NULL; st = wRouteList.nextst( stlist, st ) ) {
+    iORoute route = ModelOp.getRoute( model, wRoute.getid( st ) );
+    if( route != NULL && __hasId( dests, wRoute.getbkb( st ) ) )
+      ListOp.add( routes, (obj)route );
+  }
+
+  ntrains = BenchOp.throattrains;
+  if( ListOp.size( routes ) == 0 ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: throat needs routes to free blocks" );
+    failures = -1;
+  }
+  else {
+    trains = allocMem( ntrains * sizeof( struct BenchTrain ) );
+    t0 = MetricsOp.now();
+    for( i = 0; i < ntrains; i++ ) {
+      /* no loco of the plan: their blocks and placing stay untouched */
+      StrOp.fmtb( trains[i].lcid, "throat%d", i );
+      trains[i].routes = routes;
+      trains[i].owners = owners;
+      trains[i].mux    = mux;
+      trains[i].seed   = 4711 + i;
+      ThreadOp.start( ThreadOp.inst( trains[i].lcid, &__throatTrain, &trains[i] ) );
+    }
+    /* the threads are detached */
+    while( !__trainsDone( trains, ntrains ) )
+      ThreadOp.sleep( 10 );
+    for( i = 0; i < ntrains; i++ ) {
+      reserved += trains[i].reserved;
+      rolledback += trains[i].rolledback;
+      failures += trains[i].violations;
+    }
+    us = MetricsOp.now() - t0;
+
+    /* a route taken by another train: the block is rolled back, unless it was held before */
+    {
+      iORoute route = (iORoute)ListOp.get( routes, 0 );
+      iIBlockBase block = ModelOp.getBlock( model, RouteOp.getToBlock( route ) );
+      int held = 0;
+      RouteOp.lock( route, trains[0].lcid, False, True );
+      for( held = 0; held < 2; held++ ) {
+        Boolean locked = False;
+        if( held )
+          block->lock( block, trains[1].lcid, RouteOp.getFromBlock( route ), NULL, False, True, False, 0 );
+        if( ModelOp.reserveBegin( model, trains[1].lcid, block->base.id( block ), RouteOp.base.id( route ) ) ) {
+          locked = ModelOp.reserveBlock( model, trains[1].lcid, block, RouteOp.getFromBlock( route ), RouteOp.base.id( route ), False, True, False, 0 ) &&
+                   ModelOp.reserveRoute( model, trains[1].lcid, route, False, True );
+          ModelOp.reserveEnd( model, trains[1].lcid, locked );
+          ModelOp.reserveCancel( model, trains[1].lcid );
+        }
+        if( locked || StrOp.equals( trains[1].lcid, block->getLoc( block ) ) != ( held ? True:False ) ) {
+          TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: rollback of [%s] wrong; held before: %d", block->base.id( block ), held );
+          failures++;
+        }
+        rolledback++;
+      }
+      block->unLock( block, trains[1].lcid, NULL );
+      RouteOp.unLock( route, trains[0].lcid, NULL, True, False );
+    }
+
+    /* every reservation has been rolled back or released */
+    for( i = 0; i < ListOp.size( routes ); i++ ) {
+      iORoute route = (iORoute)ListOp.get( routes, i );
+      iIBlockBase block = ModelOp.getBlock( model, RouteOp.getToBlock( route ) );
+      int t = 0;
+      for( t = 0; t < ntrains; t++ ) {
+        if( StrOp.equals( trains[t].lcid, RouteOp.getLockedId( route ) ) || StrOp.equals( trains[t].lcid, block->getLoc( block ) ) ) {
+          TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: [%s] or [%s] still locked by [%s]",
+              RouteOp.base.id( route ), block->base.id( block ), trains[t].lcid );
+          failures++;
+        }
+      }
+    }
+
+    NodeOp.setInt( result, "trains", ntrains );
+    NodeOp.setInt( result, "routes", ListOp.size( routes ) );
+    NodeOp.setInt( result, "destinations", ListOp.size( dests ) );
+    NodeOp.setInt( result, "attempts", ntrains * BenchOp.throatattempts );
+    NodeOp.setInt( result, "reserved", reserved );
+    NodeOp.setInt( result, "rolledback", rolledback );
+    NodeOp.setLong( result, "deferred", __metricCount( "reservations_deferred_total" ) - deferred0 );
+    NodeOp.setLong( result, "deadlocks", __metricCount( "reservation_deadlocks_total" ) - deadlocks0 );
+    NodeOp.setLong( result, "opsps", (long)( (double)reserved * 1000000.0 / (double)( us + 1 ) ) );
+    if( __metricId( "reservation_us" ) != -1 ) {
+      NodeOp.setLong( result, "holdp50", MetricsOp.getValue( __metricId( "reservation_us" ), METRIC_P50 ) );
+      NodeOp.setLong( result, "holdp99", MetricsOp.getValue( __metricId( "reservation_us" ), METRIC_P99 ) );
+    }
+    freeMem( trains );
+  }
+
+  MutexOp.base.del( mux );
+  MapOp.base.del( owners );
+  ListOp.base.del( routes );
+  ListOp.base.del( dests );
+  return failures;
+}
+
+
+/* Counts the burst sensors not in the expected state. */
+static int __burstStates( iOModel model, Boolean* states, int sensors ) {
+  int failures = 0;
+  int i = 0;
+  for( i = 0; i < sensors; i++ ) {
+    char id[32];
+    iOFBack fb = NULL;
+    StrOp.fmtb( id, "burst%d", i );
+    fb = ModelOp.getFBack( model, id );
+    if( fb == NULL || FBackOp.getState( fb ) != states[i] ) {
+      if( failures == 0 )
+        TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: sensor [%s] is not %s", id, states[i]?"on":"off" );
+      failures++;
+    }
+  }
+  return failures;
+}
+
+
+/* The same module scans go to the model as single sensor events and as
+ * batches; the odd modules are on another bus and only match by uidname. */
+static int __fbBurst( iOBench inst, iOControl control, iONode result ) {
+  iOModel model = AppOp.getModel();
+  iONode plan = ModelOp.getModel( model );
+  iONode fblist = wPlan.getfblist( plan );
+  iONode fb = fblist != NULL ? wFeedbackList.getfb( fblist ):NULL;
+  int sensors = BenchOp.burstmodules * 16;
+  Boolean* states = allocMem( sensors * sizeof( Boolean ) );
+  iONode cmd = NULL;
+  tracelevel level = 0;
+  unsigned long us[2] = {0, 0};
+  int changes = 0;
+  int failures = 0;
+  int bus = 0;
+  int i = 0;
+  int p = 0;
+
+  /* buses not used by the plan */
+  while( fb != NULL ) {
+    if( wFeedback.getbus( fb ) >= bus )
+      bus = wFeedback.getbus( fb ) + 1;
+    fb = wFeedbackList.nextfb( fblist, fb );
+  }
+
+  for( i = 0; i < sensors; i++ ) {
+    iONode props = NodeOp.inst( wFeedback.name(), NULL, ELEMENT_NODE );
+    char id[32];
+    StrOp.fmtb( id, "burst%d", i );
+    wFeedback.setid( props, id );
+    wFeedback.setaddr( props, i + 1 );
+    if( ( i / 16 ) % 2 == 1 ) {
+      wFeedback.setbus( props, bus + 1 );
+      wItem.setuidname( props, "benchburst" );
+    }
+    else
+      wFeedback.setbus( props, bus );
+    ModelOp.addItem( model, props );
+    NodeOp.base.del( props );
+  }
+
+  /* the sensor traces of each change would be measured instead */
+  level = TraceOp.getLevel( NULL );
+  TraceOp.setLevel( NULL, level & ~( TRCLEVEL_INFO | TRCLEVEL_USER1 ) );
+
+  /* pass 0: single events, pass 1: batches */
+  for( p = 0; p < 2; p++ ) {
+    unsigned long seed = 4711;
+    int s = 0;
+
+    for( s = 0; s < BenchOp.burstscans; s++ ) {
+      iONode batch = NodeOp.inst( wFbBatch.name(), NULL, ELEMENT_NODE );
+      iOList evts = ListOp.inst();
+      unsigned long t0 = 0;
+      int m = 0;
+
+      wFbBatch.setbus( batch, bus );
+      wFbBatch.setuidname( batch, "benchburst" );
+      for( m = 0; m < BenchOp.burstmodules; m++ ) {
+        byte mask[2] = {0, 0};
+        byte bits[2] = {0, 0};
+        int n = 0;
+        for( n = 0; n < 16; n++ ) {
+          int a = m * 16 + n;
+          if( __random( &seed ) % 4 == 0 ) {
+            iONode evt = NodeOp.inst( wFeedback.name(), NULL, ELEMENT_NODE );
+            states[a] = !states[a];
+            mask[n/8] |= 1 << ( n % 8 );
+            if( states[a] )
+              bits[n/8] |= 1 << ( n % 8 );
+            wFeedback.setbus( evt, bus );
+            wFeedback.setaddr( evt, a + 1 );
+            wFeedback.setstate( evt, states[a] );
+            wItem.setuidname( evt, "benchburst" );
+            ListOp.add( evts, (obj)evt );
+          }
+        }
+        if( mask[0] != 0 || mask[1] != 0 ) {
+          iONode delta = NodeOp.inst( wFbDelta.name(), batch, ELEMENT_NODE );
+          char* str = StrOp.byteToStr( mask, 2 );
+          wFbDelta.setaddr( delta, m * 16 + 1 );
+          wFbDelta.setmask( delta, str );
+          StrOp.free( str );
+          str = StrOp.byteToStr( bits, 2 );
+          wFbDelta.setstate( delta, str );
+          StrOp.free( str );
+          NodeOp.addChild( batch, delta );
+        }
+      }
+
+      /* the model takes over the event nodes */
+      t0 = MetricsOp.now();
+      if( p == 0 ) {
+        for( i = 0; i < ListOp.size( evts ); i++ )
+          ModelOp.event( model, (iONode)ListOp.get( evts, i ) );
+      }
+      else
+        ModelOp.event( model, batch );
+      us[p] += MetricsOp.now() - t0;
+
+      if( p == 0 ) {
+        changes += ListOp.size( evts );
+        NodeOp.base.del( batch );
+      }
+      else {
+        for( i = 0; i < ListOp.size( evts ); i++ )
+          NodeOp.base.del( (iONode)ListOp.get( evts, i ) );
+      }
+      ListOp.base.del( evts );
+      failures += __burstStates( model, states, sensors );
+    }
+  }
+  TraceOp.setLevel( NULL, level );
+
+  /* removed as a client would; the model deletes the command */
+  cmd = NodeOp.inst( wModelCmd.name(), NULL, ELEMENT_NODE );
+  wModelCmd.setcmd( cmd, wModelCmd.remove );
+  for( i = 0; i < sensors; i++ ) {
+    iONode props = NodeOp.inst( wFeedback.name(), cmd, ELEMENT_NODE );
+    char id[32];
+    StrOp.fmtb( id, "burst%d", i );
+    wFeedback.setid( props, id );
+    NodeOp.addChild( cmd, props );
+  }
+  ModelOp.cmd( model, cmd );
+  freeMem( states );
+
+  NodeOp.setInt( result, "sensors", sensors );
+  NodeOp.setInt( result, "scans", BenchOp.burstscans );
+  NodeOp.setInt( result, "changes", changes );
+  NodeOp.setLong( result, "singleus", (long)us[0] );
+  NodeOp.setLong( result, "batchus", (long)us[1] );
+  NodeOp.setLong( result, "speedup", (long)( us[0] * 100 / ( us[1] + 1 ) ) );
+  NodeOp.setLong( result, "opsps", (long)( (double)changes * 1000000.0 / (double)( us[1] + 1 ) ) );
+  return failures;
+}
+
+
+/* Plan copy of a client of the planresume and reconnect scenarios, kept like Rocview keeps it. */
+struct PlanClient {
+  iOMutex mux;
+  iORCon  rcon;
+  iONode  plan;
+  long    version;
+  long    resume;
+  Boolean online;
+  Boolean resumed;
+  int     frames;
+  int     plans;
+  int     replayed;
+  int     duplicates;
+  unsigned long planat;
+};
+
+static iONode __clientItem( iONode plan, iONode item, iONode* list ) {
+  char* listname = StrOp.fmt( "%slist", NodeOp.getName( item ) );
+  iONode child = NULL;
+  *list = NodeOp.findNode( plan, listname );
+  StrOp.free( listname );
+  if( *list != NULL ) {
+    child = NodeOp.getChild( *list, 0 );
+    while( child != NULL && !StrOp.equals( wItem.getid( child ), wItem.getid( item ) ) )
+      child = NodeOp.findNextNode( *list, child );
+  }
+  return child;
+}
+
+static void __clientApply( struct PlanClient* c, const char* cmd, iONode item ) {
+  iONode list = NULL;
+  iONode have = __clientItem( c->plan, item, &list );
+
+  if( StrOp.equals( wModelCmd.add, cmd ) ) {
+    if( have != NULL ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: client got [%s] twice", wItem.getid( item ) );
+      c->duplicates++;
+    }
+    if( list == NULL ) {
+      char* listname = StrOp.fmt( "%slist", NodeOp.getName( item ) );
+      list = NodeOp.inst( listname, c->plan, ELEMENT_NODE );
+      NodeOp.addChild( c->plan, list );
+      StrOp.free( listname );
+    }
+    NodeOp.addChild( list, (iONode)NodeOp.base.clone( item ) );
+  }
+  else if( StrOp.equals( wModelCmd.remove, cmd ) ) {
+    if( have != NULL )
+      NodeOp.base.del( NodeOp.removeChild( list, have ) );
+  }
+  else if( have != NULL )
+    NodeOp.mergeNode( have, item, True, False, False );
+}
+
+/* The skip rules of Rocview: broadcasts queued before a replay are in it,
+ * and changes up to the held version are already applied. */
+static void __planClient( obj cargo, iONode node ) {
+  struct PlanClient* c = (struct PlanClient*)cargo;
+  const char* cmd = wModelCmd.getcmd( node );
+  long version = wModelCmd.getplanversion( node );
+  int i = 0;
+
+  MutexOp.wait( c->mux );
+  c->frames++;
+  if( !c->online ) {
+    /* late frames of a closed connection */
+  }
+  else if( StrOp.equals( wPlan.name(), NodeOp.getName( node ) ) ) {
+    if( c->plan != NULL )
+      NodeOp.base.del( c->plan );
+    c->plan = (iONode)NodeOp.base.clone( node );
+    c->version = wPlan.getplanversion( node );
+    c->resume = 0;
+    c->plans++;
+    c->planat = MetricsOp.now();
+  }
+  else if( c->plan == NULL ) {
+    /* broadcasts before the plan */
+  }
+  else if( !StrOp.equals( wModelCmd.name(), NodeOp.getName( node ) ) ) {
+    /* item broadcasts of a modify */
+    if( StrOp.equals( wText.name(), NodeOp.getName( node ) ) && c->resume == 0 )
+      __clientApply( c, wModelCmd.modify, node );
+  }
+  else if( StrOp.equals( wModelCmd.resumed, cmd ) ) {
+    c->version = version;
+    c->resume = 0;
+    c->resumed = True;
+  }
+  else if( StrOp.equals( wModelCmd.version, cmd ) ) {
+    if( c->resume == 0 )
+      c->version = version;
+  }
+  else if( StrOp.equals( wModelCmd.add, cmd ) || StrOp.equals( wModelCmd.modify, cmd ) || StrOp.equals( wModelCmd.remove, cmd ) ) {
+    if( !( c->resume > 0 && version == 0 ) && !( version > 0 && version <= c->version ) ) {
+      if( version > 0 )
+        c->replayed++;
+      for( i = 0; i < NodeOp.getChildCnt( node ); i++ )
+        __clientApply( c, cmd, NodeOp.getChild( node, i ) );
+    }
+  }
+  MutexOp.post( c->mux );
+}
+
+static Boolean __clientConnect( struct PlanClient* c, int port ) {
+  iONode cmd = NULL;
+  char* str = NULL;
+
+  c->rcon = RConOp.inst( "localhost", port );
+  if( c->rcon == NULL )
+    return False;
+
+  cmd = NodeOp.inst( wModelCmd.name(), NULL, ELEMENT_NODE );
+  MutexOp.wait( c->mux );
+  c->online = True;
+  c->resume = c->plan != NULL ? c->version:0;
+  wModelCmd.setcmd( cmd, wModelCmd.plan );
+  wModelCmd.setplanversion( cmd, c->resume );
+  MutexOp.post( c->mux );
+  RConOp.setCallback( c->rcon, &__planClient, (obj)c );
+
+  str = NodeOp.base.toString( cmd );
+  RConOp.write( c->rcon, str );
+  StrOp.free( str );
+  NodeOp.base.del( cmd );
+  return True;
+}
+
+static void __clientClose( struct PlanClient* c ) {
+  MutexOp.wait( c->mux );
+  c->online = False;
+  MutexOp.post( c->mux );
+  RConOp.close( c->rcon );
+  /* let the reader leave its loop before it is killed */
+  ThreadOp.sleep( 100 );
+  RConOp.base.del( c->rcon );
+  c->rcon = NULL;
+}
+
+/* Adds, modifies or removes one of the bench text items as a client would. */
+static void __planChange( iOModel model, unsigned long* seed, Boolean* exists, int* seq ) {
+  iONode cmd = NodeOp.inst( wModelCmd.name(), NULL, ELEMENT_NODE );
+  iONode tx = NodeOp.inst( wText.name(), cmd, ELEMENT_NODE );
+  int k = __random( seed ) % BenchOp.resumeitems;
+  char id[32];
+  char text[32];
+
+  StrOp.fmtb( id, "benchtx%d", k );
+  StrOp.fmtb( text, "change %d", ++(*seq) );
+  wText.setid( tx, id );
+  NodeOp.addChild( cmd, tx );
+  if( !exists[k] ) {
+    wModelCmd.setcmd( cmd, wModelCmd.add );
+    wText.settext( tx, text );
+    wText.setx( tx, k );
+    wText.sety( tx, 1000 );
+    exists[k] = True;
+  }
+  else if( __random( seed ) % 3 == 0 ) {
+    wModelCmd.setcmd( cmd, wModelCmd.remove );
+    exists[k] = False;
+  }
+  else {
+    wModelCmd.setcmd( cmd, wModelCmd.modify );
+    wText.settext( tx, text );
+    wText.setx( tx, k );
+    wText.sety( tx, 1000 );
+  }
+  /* the model deletes the command */
+  ModelOp.cmd( model, cmd );
+}
+
+static Boolean __clientWait( struct PlanClient* c, Boolean resumed ) {
+  int waited = 0;
+  Boolean done = False;
+  while( !done && waited < 10000 ) {
+    MutexOp.wait( c->mux );
+    done = resumed ? ( c->resume == 0 ):( c->plan != NULL );
+    MutexOp.post( c->mux );
+    if( !done ) {
+      ThreadOp.sleep( 10 );
+      waited += 10;
+    }
+  }
+  return done;
+}
+
+/* The server queues the events of each client; waits until they are read. */
+static void __clientQuiet( struct PlanClient* c ) {
+  int prev = -1;
+  int quiet = 0;
+  int waited = 0;
+  while( quiet < BenchOp.settle && waited < 30000 ) {
+    int frames = 0;
+    MutexOp.wait( c->mux );
+    frames = c->frames;
+    MutexOp.post( c->mux );
+    quiet = ( frames == prev ) ? quiet + 100:0;
+    prev = frames;
+    ThreadOp.sleep( 100 );
+    waited += 100;
+  }
+}
+
+/* A client gets the plan, is disconnected in the middle of a stream of plan
+ * changes and resumes from its version while the changes go on. Fails on a
+ * duplicated item, on a full plan instead of a replay, or if the plan of the
+ * client differs from the plan of the server afterwards. */
+static int __planResume( iOBench inst, iOControl control, iONode result ) {
+  iOModel model = AppOp.getModel();
+  int port = wTcp.getport( wRocRail.gettcp( AppOp.getIni() ) );
+  Boolean* exists = allocMem( BenchOp.resumeitems * sizeof( Boolean ) );
+  struct PlanClient c;
+  unsigned long seed = 4711;
+  tracelevel level = 0;
+  iONode cmd = NULL;
+  iONode txlist = NULL;
+  int failures = 0;
+  int compared = 0;
+  int seq = 0;
+  int i = 0;
+
+  MemOp.set( &c, 0, sizeof( c ) );
+  c.mux = MutexOp.inst( NULL, True );
+
+  if( !__clientConnect( &c, port ) || !__clientWait( &c, False ) ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: no plan from the client port %d", port );
+    if( c.rcon != NULL )
+      __clientClose( &c );
+    MutexOp.base.del( c.mux );
+    freeMem( exists );
+    return -1;
+  }
+
+  level = TraceOp.getLevel( NULL );
+  TraceOp.setLevel( NULL, level & ~( TRCLEVEL_INFO | TRCLEVEL_USER1 ) );
+
+  /* connected, disconnected in the middle of the stream, resuming, resumed */
+  for( i = 0; i < BenchOp.resumechanges; i++ )
+    __planChange( model, &seed, exists, &seq );
+  __clientQuiet( &c );
+  for( i = 0; i < BenchOp.resumechanges; i++ )
+    __planChange( model, &seed, exists, &seq );
+  __clientClose( &c );
+  for( i = 0; i < BenchOp.resumechanges; i++ )
+    __planChange( model, &seed, exists, &seq );
+  __clientConnect( &c, port );
+  for( i = 0; i < BenchOp.resumechanges; i++ )
+    __planChange( model, &seed, exists, &seq );
+  if( !__clientWait( &c, True ) ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: client did not resume" );
+    failures++;
+  }
+  for( i = 0; i < BenchOp.resumechanges; i++ )
+    __planChange( model, &seed, exists, &seq );
+  __settle();
+  __clientQuiet( &c );
+  TraceOp.setLevel( NULL, level );
+
+  MutexOp.wait( c.mux );
+  if( c.plans != 1 || !c.resumed ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: client got %d plans; resumed=%d", c.plans, c.resumed );
+    failures++;
+  }
+  failures += c.duplicates;
+
+  /* the server plan is the reference */
+  txlist = wPlan.gettxlist( ModelOp.getModel( model ) );
+  for( i = 0; i < BenchOp.resumeitems; i++ ) {
+    iONode list = NULL;
+    iONode probe = NodeOp.inst( wText.name(), NULL, ELEMENT_NODE );
+    iONode server = NULL;
+    iONode client = NULL;
+    char id[32];
+
+    StrOp.fmtb( id, "benchtx%d", i );
+    wText.setid( probe, id );
+    server = txlist != NULL ? __clientItem( ModelOp.getModel( model ), probe, &list ):NULL;
+    client = __clientItem( c.plan, probe, &list );
+    NodeOp.base.del( probe );
+
+    if( ( server == NULL ) != ( client == NULL ) ||
+        ( server != NULL && !StrOp.equals( wText.gettext( server ), wText.gettext( client ) ) ) ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: client has [%s] as [%s], server as [%s]", id,
+          client != NULL ? wText.gettext( client ):"-", server != NULL ? wText.gettext( server ):"-" );
+      failures++;
+    }
+    compared++;
+  }
+  NodeOp.setInt( result, "replayed", c.replayed );
+  NodeOp.setInt( result, "duplicates", c.duplicates );
+  NodeOp.setLong( result, "planversion", c.version );
+  MutexOp.post( c.mux );
+
+  __clientClose( &c );
+  if( c.plan != NULL )
+    NodeOp.base.del( c.plan );
+  MutexOp.base.del( c.mux );
+
+  /* removed as a client would; the model deletes the command */
+  cmd = NodeOp.inst( wModelCmd.name(), NULL, ELEMENT_NODE );
+  wModelCmd.setcmd( cmd, wModelCmd.remove );
+  for( i = 0; i < BenchOp.resumeitems; i++ ) {
+    if( exists[i] ) {
+      iONode tx = NodeOp.inst( wText.name(), cmd, ELEMENT_NODE );
+      char id[32];
+      StrOp.fmtb( id, "benchtx%d", i );
+      wText.setid( tx, id );
+      NodeOp.addChild( cmd, tx );
+    }
+  }
+  ModelOp.cmd( model, cmd );
+  freeMem( exists );
+
+  NodeOp.setInt( result, "changes", seq );
+  NodeOp.setInt( result, "compared", compared );
+  return failures;
+}
+
+
+/* Runtime state changes of the blocks while the plan is serialized. */
+struct PlanWriter {
+  iOMutex mux;
+  iONode  bklist;
+  Boolean stop;
+  Boolean done;
+  long    writes;
+};
+
+static void __planWriter( void* threadinst ) {
+  iOThread th = (iOThread)threadinst;
+  struct PlanWriter* w = (struct PlanWriter*)ThreadOp.getParm( th );
+  Boolean stop = False;
+  long writes = 0;
+  iONode bk = NULL;
+
+  while( !stop ) {
+    /* adding and removing an attribute reallocates the attribute array of the node */
+    for( bk = NodeOp.getChild( w->bklist, 0 ); bk != NULL; bk = NodeOp.findNextNode( w->bklist, bk ) ) {
+      if( writes % 2 == 0 )
+        NodeOp.setInt( bk, "benchstate", (int)writes );
+      else
+        NodeOp.removeAttrByName( bk, "benchstate" );
+      NodeOp.setStr( bk, "benchtext", writes % 3 == 0 ? "short":"a longer value & more" );
+    }
+    writes++;
+    ThreadOp.sleep( 1 );
+    MutexOp.wait( w->mux );
+    stop = w->stop;
+    w->writes = writes;
+    MutexOp.post( w->mux );
+  }
+
+  for( bk = NodeOp.getChild( w->bklist, 0 ); bk != NULL; bk = NodeOp.findNextNode( w->bklist, bk ) ) {
+    NodeOp.removeAttrByName( bk, "benchstate" );
+    NodeOp.removeAttrByName( bk, "benchtext" );
+  }
+  ThreadOp.base.del( th );
+  MutexOp.wait( w->mux );
+  w->done = True;
+  MutexOp.post( w->mux );
+}
+
+static int __cmpLong( const void* a, const void* b ) {
+  long la = *(const long*)a;
+  long lb = *(const long*)b;
+  return la < lb ? -1:( la > lb ? 1:0 );
+}
+
+/* Rounds of clients connecting at once, like after a server or network restart,
+ * while the block states change. Fails on a client without a plan or with a plan
+ * missing blocks; reports the time to the plan and the snapshots serialized. */
+static int __reconnect( iOBench inst, iOControl control, iONode result ) {
+  iOModel model = AppOp.getModel();
+  iONode bklist = wPlan.getbklist( ModelOp.getModel( model ) );
+  int port = wTcp.getport( wRocRail.gettcp( AppOp.getIni() ) );
+  int cnt = BenchOp.reconnectclients;
+  int samples = cnt * BenchOp.reconnectrounds;
+  struct PlanClient* c = allocMem( cnt * sizeof( struct PlanClient ) );
+  long* latency = allocMem( samples * sizeof( long ) );
+  struct PlanWriter w;
+  long snapshots = __metricCount( "model_plansnapshot_us" );
+  tracelevel level = 0;
+  int blocks = 0;
+  int failures = 0;
+  int got = 0;
+  int round = 0;
+  int i = 0;
+
+  if( bklist == NULL ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: plan without blocks" );
+    freeMem( latency );
+    freeMem( c );
+    return -1;
+  }
+  blocks = NodeOp.getChildCnt( bklist );
+
+  MemOp.set( &w, 0, sizeof( w ) );
+  w.mux = MutexOp.inst( NULL, True );
+  w.bklist = bklist;
+
+  level = TraceOp.getLevel( NULL );
+  TraceOp.setLevel( NULL, level & ~( TRCLEVEL_INFO | TRCLEVEL_USER1 ) );
+  ThreadOp.start( ThreadOp.inst( "benchwriter", &__planWriter, &w ) );
+
+  for( round = 0; round < BenchOp.reconnectrounds; round++ ) {
+    unsigned long t0 = MetricsOp.now();
+    MemOp.set( c, 0, cnt * sizeof( struct PlanClient ) );
+    for( i = 0; i < cnt; i++ ) {
+      c[i].mux = MutexOp.inst( NULL, True );
+      if( !__clientConnect( &c[i], port ) ) {
+        TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: client %d could not connect to port %d", i, port );
+        failures++;
+      }
+    }
+
+    for( i = 0; i < cnt; i++ ) {
+      if( c[i].rcon == NULL )
+        continue;
+      if( !__clientWait( &c[i], False ) ) {
+        TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: client %d got no plan", i );
+        failures++;
+        continue;
+      }
+      MutexOp.wait( c[i].mux );
+      latency[got++] = (long)( c[i].planat - t0 ) / 1000;
+      if( NodeOp.getChildCnt( wPlan.getbklist( c[i].plan ) ) != blocks ) {
+        TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: client %d got %d of %d blocks",
+            i, NodeOp.getChildCnt( wPlan.getbklist( c[i].plan ) ), blocks );
+        failures++;
+      }
+      MutexOp.post( c[i].mux );
+    }
+
+    for( i = 0; i < cnt; i++ ) {
+      if( c[i].rcon != NULL )
+        __clientClose( &c[i] );
+      if( c[i].plan != NULL )
+        NodeOp.base.del( c[i].plan );
+      MutexOp.base.del( c[i].mux );
+    }
+  }
+
+  MutexOp.wait( w.mux );
+  w.stop = True;
+  while( !w.done ) {
+    MutexOp.post( w.mux );
+    ThreadOp.sleep( 10 );
+    MutexOp.wait( w.mux );
+  }
+  MutexOp.post( w.mux );
+  TraceOp.setLevel( NULL, level );
+
+  qsort( latency, got, sizeof( long ), &__cmpLong );
+  NodeOp.setInt( result, "clients", cnt );
+  NodeOp.setInt( result, "rounds", BenchOp.reconnectrounds );
+  NodeOp.setInt( result, "plans", got );
+  NodeOp.setInt( result, "blocks", blocks );
+  NodeOp.setLong( result, "planp50", got > 0 ? latency[got / 2]:0 );
+  NodeOp.setLong( result, "planmax", got > 0 ? latency[got - 1]:0 );
+  NodeOp.setLong( result, "snapshots", __metricCount( "model_plansnapshot_us" ) - snapshots );
+  NodeOp.setLong( result, "writes", w.writes );
+
+  MutexOp.base.del( w.mux );
+  freeMem( latency );
+  freeMem( c );
+  return failures;
+}
+
+
+#if defined __linux__
+/* Reads one response of a keep-alive connection; False if broken or not 200 OK. */
+static Boolean __httpResponse( iOSocket s ) {
+  char hdr[1024];
+  char body[512];
+  const char* p = NULL;
+  int len = 0;
+  int contlen = 0;
+
+  while( len < (int)sizeof( hdr ) - 1 ) {
+    if( !SocketOp.read( s, &hdr[len], 1 ) )
+      return False;
+    len++;
+    if( len >= 4 && StrOp.equalsn( hdr + len - 4, "\r\n\r\n", 4 ) )
+      break;
+  }
+  hdr[len] = '\0';
+  p = StrOp.findi( hdr, "Content-Length:" );
+  if( p != NULL )
+    contlen = atoi( p + 15 );
+  while( contlen > 0 ) {
+    int n = contlen > (int)sizeof( body ) ? (int)sizeof( body ):contlen;
+    if( !SocketOp.read( s, body, n ) )
+      return False;
+    contlen -= n;
+  }
+  return StrOp.startsWith( hdr, "HTTP/1.1 200" );
+}
+
+/* Reads what the event stream has sent so far and counts the token;
+ * carry holds the tail of the previous read for a token split over two reads. */
+static int __httpDrain( iOSocket s, char* carry, const char* token ) {
+  char buf[4096 + 32];
+  int tlen = StrOp.len( token );
+  int keep = StrOp.len( carry );
+  int cnt = 0;
+  int avail = 0;
+  char* p = NULL;
+
+  SocketOp.peek( s, buf, 4096 );
+  avail = SocketOp.getPeeked( s );
+  while( avail > 0 ) {
+    if( avail > 4096 )
+      avail = 4096;
+    MemOp.copy( buf, carry, keep );
+    if( !SocketOp.read( s, buf + keep, avail ) )
+      break;
+    buf[keep + avail] = '\0';
+    for( p = StrOp.find( buf, token ); p != NULL; p = StrOp.find( p + tlen, token ) )
+      cnt++;
+    keep = keep + avail < tlen - 1 ? keep + avail:tlen - 1;
+    MemOp.copy( carry, buf + StrOp.len( buf ) - keep, keep );
+    carry[keep] = '\0';
+    SocketOp.peek( s, buf, 4096 );
+    avail = SocketOp.getPeeked( s );
+  }
+  return cnt;
+}
+
+/* Connections to a bench HTTP service: keep-alive clients fetching a page in rounds,
+ * slow clients sending their request byte by byte, which must be closed after the
+ * request deadline, and event clients of which a third never reads. The reading event
+ * clients must get all events while the stalled ones hold up only their own writer. */
+static int __httpLoad( iOBench inst, iOControl control, iONode result ) {
+  int cnt = BenchOp.httpclients;
+  int slow = BenchOp.httpslow;
+  int streams = BenchOp.httpstreams;
+  int stalled = streams / 3;
+  iOSocket* s = allocMem( cnt * sizeof( iOSocket ) );
+  unsigned long* slowat = allocMem( slow * sizeof( unsigned long ) );
+  int* got = allocMem( streams * sizeof( int ) );
+  char (*carry)[16] = allocMem( streams * sizeof( *carry ) );
+  long* latency = NULL;
+  int samples = 0;
+  int maxsamples = 0;
+  iONode ini = NodeOp.inst( wHttpService.name(), NULL, ELEMENT_NODE );
+  iOHttp http = NULL;
+  iONode evt = NULL;
+  char payload[4097];
+  const char* get = "GET /favicon.ico HTTP/1.1\r\nConnection: keep-alive\r\n\r\n";
+  const char* events = "GET /events HTTP/1.1\r\nConnection: keep-alive\r\n\r\n";
+  tracelevel level = 0;
+  int port = 0;
+  unsigned long t0 = 0;
+  unsigned long tlast = 0;
+  unsigned long tdone = 0;
+  int sent = 0;
+  int requests = 0;
+  int slowclosed = 0;
+  long slowmax = 0;
+  int failures = 0;
+  int i = 0;
+
+  level = TraceOp.getLevel( NULL );
+  TraceOp.setLevel( NULL, level & ~( TRCLEVEL_INFO | TRCLEVEL_USER1 ) );
+
+  /* the connections the service closed keep the port of the previous run in TIME_WAIT */
+  port = BenchOp.httpport + SystemOp.getpid() % 100;
+  wHttpService.setport( ini, port );
+  wHttpService.setrefresh( ini, 0 );
+  http = HttpOp.inst( ini );
+  ThreadOp.sleep( 200 );
+
+  /* slow clients first, then the event clients, the rest fetch pages */
+  for( i = 0; i < cnt; i++ ) {
+    s[i] = SocketOp.inst( "localhost", port, False, False, False );
+    if( i >= slow && i < slow + stalled ) {
+      /* no receive window growing into megabytes: the stalled ones have to block the sender */
+      int rcvbuf = 4096;
+      setsockopt( SocketOp.getSh( s[i] ), SOL_SOCKET, SO_RCVBUF, (void*)&rcvbuf, sizeof( rcvbuf ) );
+    }
+    if( !SocketOp.connect( s[i] ) ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: connection %d refused", i );
+      SocketOp.base.del( s[i] );
+      s[i] = NULL;
+      failures++;
+      continue;
+    }
+    SocketOp.setRcvTimeout( s[i], 10 );
+    if( i < slow )
+      SocketOp.write( s[i], "GET / HTTP/1.1\r\n", 16 );
+    else if( i < slow + streams )
+      SocketOp.write( s[i], events, StrOp.len( events ) );
+  }
+  ThreadOp.sleep( 500 );
+
+  MemOp.set( payload, 'x', 4096 );
+  payload[4096] = '\0';
+  maxsamples = ( cnt - slow - streams ) * 1000;
+  latency = allocMem( maxsamples * sizeof( long ) );
+
+  t0 = SystemOp.getTick();
+  while( SystemOp.getTick() - t0 < (unsigned long)BenchOp.httpseconds * 100 ) {
+    unsigned long r0 = MetricsOp.now();
+
+    /* one request on every page client, then the responses */
+    for( i = slow + streams; i < cnt; i++ ) {
+      if( s[i] != NULL && !SocketOp.write( s[i], get, StrOp.len( get ) ) ) {
+        TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: request on connection %d failed", i );
+        failures++;
+        SocketOp.base.del( s[i] );
+        s[i] = NULL;
+      }
+    }
+    for( i = slow + streams; i < cnt; i++ ) {
+      if( s[i] == NULL )
+        continue;
+      if( !__httpResponse( s[i] ) ) {
+        TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: no response on connection %d", i );
+        failures++;
+        SocketOp.base.del( s[i] );
+        s[i] = NULL;
+        continue;
+      }
+      requests++;
+      if( samples < maxsamples )
+        latency[samples++] = (long)( MetricsOp.now() - r0 ) / 1000;
+    }
+
+    /* the slow clients add one byte each round */
+    for( i = 0; i < slow; i++ ) {
+      char c = 0;
+      if( slowat[i] != 0 || s[i] == NULL )
+        continue;
+      SocketOp.peek( s[i], &c, 1 );
+      if( SocketOp.isBroken( s[i] ) || !SocketOp.write( s[i], "X", 1 ) ) {
+        slowat[i] = SystemOp.getTick();
+        slowclosed++;
+        if( (long)( slowat[i] - t0 ) * 10 > slowmax )
+          slowmax = (long)( slowat[i] - t0 ) * 10;
+      }
+    }
+
+    /* a share of the events each round */
+    while( sent < BenchOp.httpevents && sent * BenchOp.httpseconds * 100 < BenchOp.httpevents * (long)( SystemOp.getTick() - t0 ) ) {
+      evt = NodeOp.inst( "benchevent", NULL, ELEMENT_NODE );
+      NodeOp.setInt( evt, "seq", ++sent );
+      NodeOp.setStr( evt, "payload", payload );
+      HttpOp.broadcastEvent( http, evt );
+      NodeOp.base.del( evt );
+    }
+    for( i = slow + stalled; i < slow + streams; i++ ) {
+      if( s[i] != NULL )
+        got[i - slow] += __httpDrain( s[i], carry[i - slow], "<benchevent" );
+    }
+    ThreadOp.sleep( 100 );
+  }
+
+  /* the rest of the events and the end marker */
+  while( sent < BenchOp.httpevents ) {
+    evt = NodeOp.inst( "benchevent", NULL, ELEMENT_NODE );
+    NodeOp.setInt( evt, "seq", ++sent );
+    NodeOp.setStr( evt, "payload", payload );
+    HttpOp.broadcastEvent( http, evt );
+    NodeOp.base.del( evt );
+  }
+  tlast = MetricsOp.now();
+  tdone = 0;
+  while( tdone == 0 && MetricsOp.now() - tlast < 5000000UL ) {
+    Boolean all = True;
+    for( i = slow + stalled; i < slow + streams; i++ ) {
+      if( s[i] != NULL )
+        got[i - slow] += __httpDrain( s[i], carry[i - slow], "<benchevent" );
+      if( got[i - slow] < BenchOp.httpevents )
+        all = False;
+    }
+    if( all )
+      tdone = MetricsOp.now();
+    else
+      ThreadOp.sleep( 10 );
+  }
+
+  for( i = slow + stalled; i < slow + streams; i++ ) {
+    if( got[i - slow] != BenchOp.httpevents ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: event client %d got %d of %d events",
+          i, got[i - slow], BenchOp.httpevents );
+      failures++;
+    }
+  }
+  if( slowclosed < slow ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: %d slow clients still connected after %ds",
+        slow - slowclosed, BenchOp.httpseconds );
+    failures++;
+  }
+
+  for( i = 0; i < cnt; i++ ) {
+    if( s[i] != NULL ) {
+      SocketOp.disConnect( s[i] );
+      SocketOp.base.del( s[i] );
+    }
+  }
+  HttpOp.shutdown( http );
+  ThreadOp.sleep( 500 );
+  TraceOp.setLevel( NULL, level );
+
+  qsort( latency, samples, sizeof( long ), &__cmpLong );
+  NodeOp.setInt( result, "clients", cnt );
+  NodeOp.setInt( result, "requests", requests );
+  NodeOp.setLong( result, "rspp50", samples > 0 ? latency[samples / 2]:0 );
+  NodeOp.setLong( result, "rspmax", samples > 0 ? latency[samples - 1]:0 );
+  NodeOp.setInt( result, "slowclosed", slowclosed );
+  NodeOp.setLong( result, "slowclosems", slowmax );
+  NodeOp.setInt( result, "streams", streams - stalled );
+  NodeOp.setInt( result, "stalled", stalled );
+  NodeOp.setInt( result, "events", BenchOp.httpevents );
+  NodeOp.setLong( result, "drainms", tdone > 0 ? (long)( tdone - tlast ) / 1000:-1 );
+
+  freeMem( latency );
+  freeMem( carry );
+  freeMem( got );
+  freeMem( slowat );
+  freeMem( s );
+  return failures;
+}
+/* One info session of the srcpload scenario. */
+struct SrcpInfo {
+  iOSocket      s;
+  unsigned long hash;
+  int           lines;
+  int           fb;
+  int           len;
+  char          line[256];
+};
+
+/* Reads what is available, hashing the bytes and counting lines and FB infos. */
+static void __srcpDrain( struct SrcpInfo* c ) {
+  char buf[4096];
+  int avail = 0;
+  int i = 0;
+
+  SocketOp.peek( c->s, buf, sizeof( buf ) );
+  avail = SocketOp.getPeeked( c->s );
+  while( avail > 0 ) {
+    if( avail > (int)sizeof( buf ) )
+      avail = sizeof( buf );
+    if( !SocketOp.read( c->s, buf, avail ) )
+      break;
+    for( i = 0; i < avail; i++ ) {
+      c->hash = ( ( c->hash ^ (byte)buf[i] ) * 16777619UL ) & 0xFFFFFFFFUL;
+      if( c->len < (int)sizeof( c->line ) - 1 )
+        c->line[c->len++] = buf[i];
+      if( buf[i] == '\n' ) {
+        c->line[c->len] = '\0';
+        c->lines++;
+        if( StrOp.find( c->line, " INFO " ) != NULL && StrOp.find( c->line, " FB " ) != NULL )
+          c->fb++;
+        c->len = 0;
+      }
+    }
+    SocketOp.peek( c->s, buf, sizeof( buf ) );
+    avail = SocketOp.getPeeked( c->s );
+  }
+}
+
+/* Feedback and switch events broadcasted to SRCP info sessions over loopback: one
+ * session never reads, one leaves halfway. The reading sessions must get every FB
+ * info and byte-identical streams, rendered once per event. */
+static int __srcpLoad( iOBench inst, iOControl control, iONode result ) {
+  iONode plan = ModelOp.getModel( AppOp.getModel() );
+  iONode fblist = wPlan.getfblist( plan );
+  iONode swlist = wPlan.getswlist( plan );
+  int cnt = BenchOp.srcpclients + 2;
+  int events = BenchOp.srcpevents;
+  int fbevents = ( events + 1 ) / 2;
+  struct SrcpInfo* c = allocMem( cnt * sizeof( struct SrcpInfo ) );
+  const char* hello = "SET PROTOCOL SRCP 0.8.3\nSET CONNECTIONMODE SRCP INFO\nGO\n";
+  iONode ini = NodeOp.inst( wSrcpCon.name(), NULL, ELEMENT_NODE );
+  iOSrcpCon srcp = NULL;
+  iONode evt = NULL;
+  tracelevel level = 0;
+  unsigned long t0 = 0;
+  unsigned long tdone = 0;
+  int fbcnt = 0;
+  int swcnt = 0;
+  int sent = 0;
+  int port = 0;
+  int failures = 0;
+  int i = 0;
+
+  fbcnt = fblist != NULL ? NodeOp.getChildCnt( fblist ):0;
+  swcnt = swlist != NULL ? NodeOp.getChildCnt( swlist ):0;
+  if( fbcnt == 0 || swcnt == 0 ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: plan without feedbacks or switches" );
+    NodeOp.base.del( ini );
+    freeMem( c );
+    return -1;
+  }
+
+  /* a switch renders an info only for the state it is in */
+  for( i = 0; i < swcnt; i++ ) {
+    iONode sw = NodeOp.getChild( swlist, i );
+    if( wSwitch.getstate( sw ) == NULL )
+      wSwitch.setstate( sw, wSwitch.straight );
+  }
+
+  level = TraceOp.getLevel( NULL );
+  TraceOp.setLevel( NULL, level & ~( TRCLEVEL_INFO | TRCLEVEL_USER1 ) );
+
+  port = BenchOp.srcpport + SystemOp.getpid() % 100;
+  wSrcpCon.setport( ini, port );
+  wSrcpCon.setactive( ini, True );
+  srcp = SrcpConOp.inst( ini, ControlOp.getCallback( control ), (obj)control );
+  ThreadOp.sleep( 200 );
+
+  /* session 0 never reads, session 1 leaves halfway */
+  for( i = 0; i < cnt; i++ ) {
+    c[i].s = SocketOp.inst( "localhost", port, False, False, False );
+    if( i == 0 ) {
+      int rcvbuf = 4096;
+      setsockopt( SocketOp.getSh( c[i].s ), SOL_SOCKET, SO_RCVBUF, (void*)&rcvbuf, sizeof( rcvbuf ) );
+    }
+    if( !SocketOp.connect( c[i].s ) ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: SRCP session %d refused", i );
+      SocketOp.base.del( c[i].s );
+      c[i].s = NULL;
+      failures++;
+      continue;
+    }
+    SocketOp.write( c[i].s, hello, StrOp.len( hello ) );
+  }
+  /* skip the handshake and the initial state */
+  ThreadOp.sleep( 1000 );
+  for( i = 1; i < cnt; i++ ) {
+    if( c[i].s == NULL )
+      continue;
+    __srcpDrain( &c[i] );
+    c[i].hash = 2166136261UL;
+    c[i].lines = 0;
+    c[i].fb = 0;
+  }
+
+  t0 = MetricsOp.now();
+  while( tdone == 0 && ( sent < events || MetricsOp.now() - t0 < 30000000UL ) ) {
+    Boolean all = True;
+    int least = fbevents;
+
+    for( i = 1; i < cnt; i++ ) {
+      if( c[i].s == NULL )
+        continue;
+      __srcpDrain( &c[i] );
+      if( i > 1 && c[i].fb < least )
+        least = c[i].fb;
+      if( i > 1 && c[i].fb < fbevents )
+        all = False;
+    }
+    if( all && sent == events ) {
+      tdone = MetricsOp.now();
+      break;
+    }
+
+    /* keep the broadcaster queue below its limit */
+    while( sent < events && ( sent + 1 ) / 2 - least < 200 ) {
+      if( sent % 2 == 0 ) {
+        evt = (iONode)NodeOp.base.clone( NodeOp.getChild( fblist, ( sent / 2 ) % fbcnt ) );
+        wFeedback.setstate( evt, ( sent / 2 / fbcnt ) % 2 == 0 );
+      }
+      else
+        evt = (iONode)NodeOp.base.clone( NodeOp.getChild( swlist, ( sent / 2 ) % swcnt ) );
+      SrcpConOp.broadcastEvent( srcp, evt );
+      sent++;
+    }
+    if( sent >= events / 2 && c[1].s != NULL ) {
+      SocketOp.disConnect( c[1].s );
+      SocketOp.base.del( c[1].s );
+      c[1].s = NULL;
+    }
+    ThreadOp.sleep( 1 );
+  }
+
+  for( i = 2; i < cnt; i++ ) {
+    if( c[i].s == NULL )
+      continue;
+    if( c[i].fb != fbevents ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: SRCP session %d got %d of %d feedbacks", i, c[i].fb, fbevents );
+      failures++;
+    }
+    else if( c[i].lines != c[2].lines || c[i].hash != c[2].hash ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: SRCP session %d got other infos than session 2 (%d/%d lines)",
+          i, c[i].lines, c[2].lines );
+      failures++;
+    }
+  }
+
+  for( i = 0; i < cnt; i++ ) {
+    if( c[i].s != NULL ) {
+      SocketOp.disConnect( c[i].s );
+      SocketOp.base.del( c[i].s );
+    }
+  }
+  ThreadOp.sleep( 500 );
+  TraceOp.setLevel( NULL, level );
+
+  NodeOp.setInt( result, "sessions", cnt - 2 );
+  NodeOp.setInt( result, "events", events );
+  NodeOp.setInt( result, "lines", c[2].lines );
+  NodeOp.setLong( result, "lastms", tdone > 0 ? (long)( tdone - t0 ) / 1000:-1 );
+
+  /* the service has no shutdown; it ends with the process */
+  freeMem( c );
+  return failures;
+}
+
+#endif
+
+
+#if !defined _WIN32
+#define LNBUS_ADDRS 16384
+
+/* LocoNet on the master side of a pty; echoes the frames of the interface like the bus does,
+ * except the address requests which the interface posts to its slot server itself. */
+struct LnBus {
+  iOMutex mux;
+  int     fd;
+  Boolean stop;
+  Boolean done;
+  int     locoadr;                  /* OPC_LOCO_ADR frames of the interface */
+  int     slot4addr[LNBUS_ADDRS];   /* slot of the last OPC_SL_RD_DATA per address */
+  int     seq4addr[LNBUS_ADDRS];
+  int     addr4slot[128];           /* address of the last OPC_SL_RD_DATA per slot */
+  int     seq4slot[128];
+};
+
+static int __lnLen( byte* frame, int have ) {
+  switch( frame[0] & 0xE0 ) {
+    case 0x80: return 2;
+    case 0xA0: return 4;
+    case 0xC0: return 6;
+  }
+  return have > 1 ? frame[1] & 0x7F:0;
+}
+
+static void __lnFrame( struct LnBus* bus, byte* frame, int len ) {
+  MutexOp.wait( bus->mux );
+  if( frame[0] == 0xBF )
+    bus->locoadr++;
+  else if( frame[0] == 0xE7 && len >= 14 ) {
+    int slot = frame[2] & 0x7F;
+    int addr = ( frame[9] & 0x7F ) * 128 + ( frame[4] & 0x7F );
+    bus->slot4addr[addr] = slot;
+    bus->seq4addr[addr]++;
+    bus->addr4slot[slot] = addr;
+    bus->seq4slot[slot]++;
+  }
+  MutexOp.post( bus->mux );
+}
+
+static void __lnBus( void* threadinst ) {
+  iOThread th = (iOThread)threadinst;
+  struct LnBus* bus = (struct LnBus*)ThreadOp.getParm( th );
+  byte frame[128];
+  int have = 0;
+  Boolean stop = False;
+
+  while( !stop ) {
+    int len = 0;
+    int rd = read( bus->fd, frame + have, 1 );
+    if( rd == 1 ) {
+      if( have == 0 && frame[0] < 0x80 )
+        continue;
+      have++;
+      len = __lnLen( frame, have );
+      if( len > 0 && have >= len ) {
+        if( frame[0] != 0xBF && write( bus->fd, frame, len ) != len )
+          TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: LocoNet echo failed" );
+        __lnFrame( bus, frame, len );
+        have = 0;
+      }
+      else if( have >= (int)sizeof( frame ) )
+        have = 0;
+      continue;
+    }
+    ThreadOp.sleep( 1 );
+    MutexOp.wait( bus->mux );
+    stop = bus->stop;
+    MutexOp.post( bus->mux );
+  }
+
+  ThreadOp.base.del( th );
+  MutexOp.wait( bus->mux );
+  bus->done = True;
+  MutexOp.post( bus->mux );
+}
+
+/* A 4 byte request of an other throttle on the bus. */
+static void __lnRequest( struct LnBus* bus, byte opc, int b1, int b2 ) {
+  byte frame[4];
+  frame[0] = opc;
+  frame[1] = b1 & 0x7F;
+  frame[2] = b2 & 0x7F;
+  frame[3] = 0xFF ^ frame[0] ^ frame[1] ^ frame[2];
+  if( write( bus->fd, frame, 4 ) != 4 )
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: LocoNet request 0x%02X failed", opc );
+}
+
+/* Waits for a slot read after seq; returns the slot for an address or the address for a slot. */
+static int __lnWaitRead( struct LnBus* bus, int* seqs, int* values, int key, int seq ) {
+  int waited = 0;
+  int value = -1;
+  while( value == -1 && waited < 3000 ) {
+    MutexOp.wait( bus->mux );
+    if( seqs[key] > seq )
+      value = values[key];
+    MutexOp.post( bus->mux );
+    if( value == -1 ) {
+      ThreadOp.sleep( 10 );
+      waited += 10;
+    }
+  }
+  return value;
+}
+
+static int __lnSeq( struct LnBus* bus, int* seqs, int key ) {
+  int seq = 0;
+  MutexOp.wait( bus->mux );
+  seq = seqs[key];
+  MutexOp.post( bus->mux );
+  return seq;
+}
+
+/* A speed command of the interface for an address; returns the slot it read for it, or -1 if it got none. */
+static int __lnLoco( iIDigInt pDi, struct LnBus* bus, int addr ) {
+  iONode lc = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
+  int seq = __lnSeq( bus, bus->seq4addr, addr );
+  int slot = 0;
+  wLoc.setaddr( lc, addr );
+  wLoc.setV( lc, 0 );
+  wLoc.setspcnt( lc, 128 );
+  wLoc.setdir( lc, True );
+  /* the interface deletes the command */
+  pDi->cmd( (obj)pDi, lc );
+  slot = __lnWaitRead( bus, bus->seq4addr, bus->slot4addr, addr, seq );
+  /* let the move to in use pass before the next request */
+  ThreadOp.sleep( 100 );
+  return slot;
+}
+
+static void __lnListener( obj inst, iONode node, int level ) {
+  NodeOp.base.del( node );
+}
+
+/* The LocoNet interface with its slot server on a pty: locos of the interface and of
+ * an other throttle get slots from the one slot table, idle slots are purged and the
+ * interface asks again for a purged slot. Fails on a slot given to two addresses,
+ * on a second slot for an address, or on a slot not released by the purge. */
+static int __lnSlots( iOBench inst, iOControl control, iONode result ) {
+  struct LnBus* bus = allocMem( sizeof( struct LnBus ) );
+  int* slots = allocMem( BenchOp.lnlocos * sizeof( int ) );
+  iONode digint = NULL;
+  iONode loconet = NULL;
+  iONode slotserver = NULL;
+  iOLib pLib = NULL;
+  iIDigInt pDi = NULL;
+  iIDigInt (*pInitFun)( const iONode, const iOTrace ) = NULL;
+  char* libpath = NULL;
+  const char* device = NULL;
+  int failures = 0;
+  int purged = 0;
+  int locoadr = 0;
+  int slot = 0;
+  int seq = 0;
+  int i = 0;
+  int n = 0;
+
+  bus->mux = MutexOp.inst( NULL, True );
+  bus->fd = posix_openpt( O_RDWR | O_NOCTTY );
+  if( bus->fd < 0 || grantpt( bus->fd ) != 0 || unlockpt( bus->fd ) != 0 || ( device = ptsname( bus->fd ) ) == NULL ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: no pty for the LocoNet" );
+    if( bus->fd >= 0 )
+      close( bus->fd );
+    MutexOp.base.del( bus->mux );
+    freeMem( slots );
+    freeMem( bus );
+    return -1;
+  }
+  fcntl( bus->fd, F_SETFL, fcntl( bus->fd, F_GETFL ) | O_NONBLOCK );
+
+  digint = NodeOp.inst( wDigInt.name(), NULL, ELEMENT_NODE );
+  wDigInt.setlib( digint, wDigInt.loconet );
+  wDigInt.setiid( digint, "lnbench" );
+  wDigInt.setdevice( digint, device );
+  wDigInt.setsublib( digint, wDigInt.sublib_serial );
+  wDigInt.setflow( digint, "no" );
+  loconet = NodeOp.inst( wLocoNet.name(), digint, ELEMENT_NODE );
+  NodeOp.addChild( digint, loconet );
+  wLocoNet.setpurgetime( loconet, BenchOp.lnpurgetime );
+  wLocoNet.setsensorquery( loconet, False );
+  slotserver = NodeOp.inst( wLNSlotServer.name(), loconet, ELEMENT_NODE );
+  NodeOp.addChild( loconet, slotserver );
+  wLNSlotServer.setactive( slotserver, True );
+  wLNSlotServer.setpurge( slotserver, True );
+
+  ThreadOp.start( ThreadOp.inst( "benchlnbus", &__lnBus, bus ) );
+
+  libpath = StrOp.fmt( "%s%c%s", AppOp.getLibPath(), SystemOp.getFileSeparator(), wDigInt.loconet );
+  pLib = LibOp.inst( libpath );
+  StrOp.free( libpath );
+  if( pLib != NULL )
+    pInitFun = (iIDigInt (*)( const iONode, const iOTrace ))LibOp.getProc( pLib, "rocGetDigInt" );
+  if( pInitFun != NULL )
+    pDi = pInitFun( digint, TraceOp.get() );
+
+  if( pDi == NULL ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: LocoNet library not loaded from [%s]", AppOp.getLibPath() );
+    failures = -1;
+  }
+  else {
+    pDi->setListener( (obj)pDi, (obj)inst, &__lnListener );
+    ThreadOp.sleep( 500 );
+
+    /* locos of the interface */
+    for( i = 0; i < BenchOp.lnlocos; i++ ) {
+      slots[i] = __lnLoco( pDi, bus, 3 + i * 997 );
+      if( slots[i] <= 0 ) {
+        TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: no slot for loco %d", 3 + i * 997 );
+        failures++;
+      }
+      for( n = 0; n < i; n++ ) {
+        if( slots[i] > 0 && slots[i] == slots[n] ) {
+          TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: slot %d for loco %d and %d", slots[i], 3 + n * 997, 3 + i * 997 );
+          failures++;
+        }
+      }
+    }
+
+    /* an other throttle on the bus asks for a loco of the interface and for a new one */
+    seq = __lnSeq( bus, bus->seq4addr, 3 );
+    __lnRequest( bus, 0xBF, 3 >> 7, 3 );
+    slot = __lnWaitRead( bus, bus->seq4addr, bus->slot4addr, 3, seq );
+    if( slot != slots[0] ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: loco 3 in slot %d for the throttle and %d for the interface", slot, slots[0] );
+      failures++;
+    }
+    seq = __lnSeq( bus, bus->seq4addr, 77 );
+    __lnRequest( bus, 0xBF, 77 >> 7, 77 );
+    slot = __lnWaitRead( bus, bus->seq4addr, bus->slot4addr, 77, seq );
+    for( i = 0; i < BenchOp.lnlocos; i++ ) {
+      if( slot <= 0 || slot == slots[i] ) {
+        TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: loco 77 in slot %d of loco %d", slot, 3 + i * 997 );
+        failures++;
+        break;
+      }
+    }
+
+    /* a known slot is not asked for again */
+    MutexOp.wait( bus->mux );
+    locoadr = bus->locoadr;
+    MutexOp.post( bus->mux );
+    __lnLoco( pDi, bus, 3 );
+    MutexOp.wait( bus->mux );
+    if( bus->locoadr != locoadr ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: slot of loco 3 asked for again" );
+      failures++;
+    }
+    locoadr = bus->locoadr;
+    MutexOp.post( bus->mux );
+
+    /* idle slots are released; the interface sees it in the table without bus traffic */
+    ThreadOp.sleep( ( BenchOp.lnpurgetime + 3 ) * 1000 );
+    slot = __lnLoco( pDi, bus, 3 );
+    MutexOp.wait( bus->mux );
+    if( slot <= 0 || bus->locoadr != locoadr + 1 ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: loco 3 got slot %d with %d requests after the purge", slot, bus->locoadr - locoadr );
+      failures++;
+    }
+    MutexOp.post( bus->mux );
+
+    for( i = 1; i < BenchOp.lnlocos; i++ ) {
+      if( slots[i] <= 0 || slots[i] == slot )
+        continue;
+      seq = __lnSeq( bus, bus->seq4slot, slots[i] );
+      __lnRequest( bus, 0xBB, slots[i], 0 );
+      if( __lnWaitRead( bus, bus->seq4slot, bus->addr4slot, slots[i], seq ) != 0 ) {
+        TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: slot %d of loco %d not purged", slots[i], 3 + i * 997 );
+        failures++;
+      }
+      else
+        purged++;
+    }
+
+    pDi->halt( (obj)pDi, False );
+  }
+
+  MutexOp.wait( bus->mux );
+  bus->stop = True;
+  while( !bus->done ) {
+    MutexOp.post( bus->mux );
+    ThreadOp.sleep( 10 );
+    MutexOp.wait( bus->mux );
+  }
+  MutexOp.post( bus->mux );
+  close( bus->fd );
+
+  if( failures >= 0 ) {
+    NodeOp.setInt( result, "locos", BenchOp.lnlocos );
+    NodeOp.setInt( result, "purged", purged );
+    NodeOp.setInt( result, "locoadr", bus->locoadr );
+  }
+  /* the halted interface keeps its ini */
+  MutexOp.base.del( bus->mux );
+  freeMem( slots );
+  freeMem( bus );
+  return failures;
+}
+#endif
+
+#if !defined _WIN32
+#define NMRA_PKTSIZE 60
+#define NMRA_BITSIZE 360
+
+/* The string based NMRA encoder of DDX up to the bit packed one; the reference of the nmraencode scenario. */
+static const struct {
+  int value;
+  int patternlength;
+} __nmraOldTable[32][2] = {
+  {{ 0xCC, 2 },{ 0xF0, 1 }}, {{ 0xCC, 2 },{ 0xF0, 1 }}, {{ 0xCC, 2 },{ 0xF0, 1 }}, {{ 0xCC, 2 },{ 0xF0, 1 }},
+  {{ 0xA6, 3 },{ 0x1C, 2 }}, {{ 0xA6, 3 },{ 0x1C, 2 }}, {{ 0x4C, 3 },{ 0x1C, 2 }}, {{ 0x4C, 3 },{ 0x1C, 2 }},
+  {{ 0x9A, 3 },{ 0xE8, 2 }}, {{ 0x9A, 3 },{ 0xE8, 2 }}, {{ 0x34, 3 },{ 0xE8, 2 }}, {{ 0x34, 3 },{ 0xE8, 2 }},
+  {{ 0xD4, 3 },{ 0x40, 2 }}, {{ 0xD4, 3 },{ 0x40, 2 }}, {{ 0x50, 3 },{ 0x40, 2 }}, {{ 0x54, 4 },{ 0x50, 3 }},
+  {{ 0xC7, 2 },{ 0xFF, 1 }}, {{ 0xC7, 2 },{ 0xFF, 1 }}, {{ 0xC7, 2 },{ 0xFF, 1 }}, {{ 0xC7, 2 },{ 0xFF, 1 }},
+  {{ 0xD3, 3 },{ 0x0F, 2 }}, {{ 0xD3, 3 },{ 0x0F, 2 }}, {{ 0x47, 3 },{ 0x0F, 2 }}, {{ 0x53, 4 },{ 0x47, 3 }},
+  {{ 0xCD, 3 },{ 0xFD, 2 }}, {{ 0xCD, 3 },{ 0xFD, 2 }}, {{ 0x1D, 3 },{ 0xFD, 2 }}, {{ 0x4D, 4 },{ 0x1D, 3 }},
+  {{ 0xF5, 3 },{ 0xF5, 3 }}, {{ 0x35, 4 },{ 0xF5, 3 }}, {{ 0xD5, 4 },{ 0xD5, 4 }}, {{ 0x55, 5 },{ 0x55, 5 }}
+};
+
+static int __nmraOldSix( const char* bits ) {
+  int i, six = 0;
+  for( i = 0; i < 6; i++ )
+    six = ( six << 1 ) | ( *bits++ == '0' ? 0:1 );
+  return six;
+}
+
+static int __nmraOldTranslate( const char* bitstream, char* packetstream ) {
+  char buffer[NMRA_BITSIZE+20];
+  char* read_ptr = NULL;
+  char* restart_read = buffer;
+  char* buf_end = NULL;
+  int restart_packet = 0;
+  int generate_packet = 0;
+  int second_try = False;
+  int act_six = 0;
+
+  read_ptr = strcpy( buffer, "11" );
+  strncat( buffer, bitstream, NMRA_BITSIZE-1 );
+  buf_end = buffer + strlen( buffer );
+  strcat( buffer, "111111" );
+  MemOp.set( packetstream, 0, NMRA_PKTSIZE );
+
+  while( generate_packet < NMRA_PKTSIZE && read_ptr < buf_end ) {
+    act_six = __nmraOldSix( read_ptr );
+    if( act_six == 0x3e ) {
+      second_try = True;
+      generate_packet = restart_packet;
+      read_ptr = restart_read;
+      act_six = __nmraOldSix( read_ptr );
+    }
+    packetstream[generate_packet] = __nmraOldTable[act_six >> 1][second_try ? 1:0].value;
+    if( act_six < 0x3e ) {
+      restart_packet = generate_packet;
+      restart_read = read_ptr;
+    }
+    read_ptr += __nmraOldTable[act_six >> 1][second_try ? 1:0].patternlength;
+    generate_packet++;
+    second_try = False;
+  }
+  return generate_packet;
+}
+
+/* The low order n bits of value as '0'/'1' characters behind the first "from" characters of byte. */
+static void __nmraOldBits( char* byte, int from, int value, int n ) {
+  int i;
+  for( i = from + n - 1; i >= from; i-- ) {
+    byte[i] = value % 2 == 1 ? '1':'0';
+    value = value / 2;
+  }
+}
+
+static void __nmraOldXor( char* byte, const char* byte1, const char* byte2 ) {
+  int i;
+  MemOp.set( byte, 0, 9 );
+  for( i = 0; i < 8; i++ )
+    byte[i] = byte1[i] == byte2[i] ? '0':'1';
+}
+
+static void __nmraOldAddress( char* byte1, char* byte2, int address, Boolean longaddr ) {
+  MemOp.set( byte1, 0, 9 );
+  MemOp.set( byte2, 0, 9 );
+  if( longaddr ) {
+    byte1[0] = '1';
+    byte1[1] = '1';
+    __nmraOldBits( byte1, 2, address >> 8, 6 );
+    __nmraOldBits( byte2, 0, address & 0xFF, 8 );
+  }
+  else {
+    byte1[0] = '0';
+    __nmraOldBits( byte1, 1, address, 7 );
+  }
+}
+
+static void __nmraOldFunction( char* byte1, char* byte2, int group, int* f ) {
+  static const char* instr[] = { "100", "1011", "1010", "11011110", "11011110", "11011111", "11011111" };
+  static const int hi[] = { 4, 8, 12, 20, 20, 28, 28 };
+  int i, pos = 0;
+
+  if( group > 0 )
+    group--;
+  MemOp.set( byte1, 0, 9 );
+  MemOp.set( byte2, 0, 9 );
+  if( group < 0 || group > 6 )
+    return;
+
+  /* the highest function first */
+  strcpy( byte1, instr[group] );
+  pos = strlen( byte1 );
+  if( group == 0 )
+    byte1[pos++] = f[0] == 1 ? '1':'0';
+  for( i = hi[group]; pos < 8; i-- )
+    byte1[pos++] = f[i] == 1 ? '1':'0';
+  for( i = 0; group > 2 && i < 8; i++ )
+    byte2[i] = f[hi[group] - i] == 1 ? '1':'0';
+}
+
+/* Preamble, the bytes each behind a start bit, the xor of them and the end bit. */
+static int __nmraOldPacket( char* packetstream, char bytes[][9], int n ) {
+  char bitstream[NMRA_BITSIZE];
+  char err[9];
+  char tmp[9];
+  int i;
+
+  MemOp.set( bitstream, 0, sizeof( bitstream ) );
+  strcat( bitstream, "111111111111111" );
+  MemOp.copy( err, bytes[0], 9 );
+  for( i = 0; i < n; i++ ) {
+    strcat( bitstream, "0" );
+    strcat( bitstream, bytes[i] );
+    if( i > 0 ) {
+      MemOp.copy( tmp, err, 9 );
+      __nmraOldXor( err, tmp, bytes[i] );
+    }
+  }
+  strcat( bitstream, "0" );
+  strcat( bitstream, err );
+  strcat( bitstream, "1" );
+  return __nmraOldTranslate( bitstream, packetstream );
+}
+
+/* Return code and serial streams of one command. */
+struct NmraOut {
+  int  rc;
+  int  n;
+  int  size[2];
+  char packet[2][NMRA_PKTSIZE];
+};
+
+static int __nmraOldSpeed( char bytes[][9], int n, int direction, int speed, Boolean steps128 ) {
+  MemOp.set( bytes[n], 0, 9 );
+  if( steps128 ) {
+    strcpy( bytes[n], "00111111" );
+    MemOp.set( bytes[n+1], 0, 9 );
+    bytes[n+1][0] = direction == 1 ? '1':'0';
+    __nmraOldBits( bytes[n+1], 1, speed, 7 );
+    return n + 2;
+  }
+  strcpy( bytes[n], "01" );
+  bytes[n][2] = direction == 1 ? '1':'0';
+  bytes[n][3] = '0';
+  if( speed > 1 ) {
+    if( speed % 2 == 1 ) {
+      bytes[n][3] = '1';
+      speed = ( speed + 1 ) / 2;
+    }
+    else
+      speed = ( speed + 2 ) / 2;
+  }
+  __nmraOldBits( bytes[n], 4, speed, 4 );
+  return n + 1;
+}
+
+static void __nmraOldLoco( struct NmraOut* o, Boolean longaddr, Boolean steps128, int address, int direction, int speed, int* f ) {
+  char bytes[4][9];
+  char fx[4][9];
+  int i, n;
+
+  o->rc = 1;
+  o->n  = 0;
+  if( address < 1 || address > ( longaddr ? 10239:127 ) || direction < 0 || direction > 1 ||
+      speed < 0 || speed > ( steps128 ? 128:28 ) )
+    return;
+  for( i = 0; i < 5; i++ )
+    if( f[i] < 0 || f[i] > 1 )
+      return;
+
+  __nmraOldAddress( bytes[0], bytes[1], address, longaddr );
+  n = longaddr ? 2:1;
+  MemOp.copy( fx, bytes, sizeof( bytes ) );
+  __nmraOldFunction( fx[n], fx[n+1], 0, f );
+  o->size[1] = __nmraOldPacket( o->packet[1], fx, n + 1 );
+  n = __nmraOldSpeed( bytes, n, direction, speed, steps128 );
+  o->size[0] = __nmraOldPacket( o->packet[0], bytes, n );
+  if( o->size[0] > 0 && o->size[1] > 0 ) {
+    o->rc = 0;
+    o->n  = 2;
+  }
+}
+
+/* Returns False for a function group the old encoder put out as a malformed packet. */
+static Boolean __nmraOldFunc( struct NmraOut* o, Boolean longaddr, int address, int group, int* f ) {
+  char bytes[4][9];
+  int n;
+
+  o->rc = 1;
+  o->n  = 0;
+  if( address < 1 || address > ( longaddr ? 10239:127 ) )
+    return True;
+  if( group < 0 || group > 7 )
+    return False;
+
+  __nmraOldAddress( bytes[0], bytes[1], address, longaddr );
+  n = longaddr ? 2:1;
+  __nmraOldFunction( bytes[n], bytes[n+1], group, f );
+  n += bytes[n+1][0] != 0 ? 2:1;
+  o->size[0] = __nmraOldPacket( o->packet[0], bytes, n );
+  if( o->size[0] > 0 ) {
+    o->rc = 0;
+    o->n  = 1;
+  }
+  return True;
+}
+
+static void __nmraOldBaseline( struct NmraOut* o, int address, int direction, int speed ) {
+  char bytes[2][9];
+
+  o->rc = 1;
+  o->n  = 0;
+  if( address < 1 || address > 127 || direction < 0 || direction > 1 || speed < 0 || speed > 15 )
+    return;
+
+  __nmraOldAddress( bytes[0], bytes[1], address, False );
+  MemOp.set( bytes[1], 0, 9 );
+  strcpy( bytes[1], "01" );
+  bytes[1][2] = direction == 1 ? '1':'0';
+  bytes[1][3] = '1';
+  __nmraOldBits( bytes[1], 4, speed, 4 );
+  o->size[0] = __nmraOldPacket( o->packet[0], bytes, 2 );
+  if( o->size[0] > 0 ) {
+    o->rc = 0;
+    o->n  = 1;
+  }
+}
+
+static void __nmraOldAccessory( struct NmraOut* o, int address, int pairnr, int gate, int activate ) {
+  char bytes[2][9];
+  char addr9[10];
+  int i;
+
+  /* out of range is not an error */
+  o->rc = 0;
+  o->n  = 0;
+  if( address < 0 || pairnr < 1 || pairnr > 4 || gate < 0 || gate > 1 )
+    return;
+
+  MemOp.set( addr9, 0, sizeof( addr9 ) );
+  __nmraOldBits( addr9, 0, address, 9 );
+  MemOp.set( bytes[0], 0, 9 );
+  bytes[0][0] = '1';
+  bytes[0][1] = '0';
+  for( i = 8; i > 2; i-- )
+    bytes[0][i-1] = addr9[i];
+  MemOp.set( bytes[1], 0, 9 );
+  bytes[1][0] = '1';
+  for( i = 3; i > 0; i-- )
+    bytes[1][i] = addr9[i-1] == '1' ? '0':'1';
+  bytes[1][4] = activate ? '1':'0';
+  bytes[1][5] = ( pairnr - 1 ) & 0x02 ? '1':'0';
+  bytes[1][6] = ( pairnr - 1 ) & 0x01 ? '1':'0';
+  bytes[1][7] = gate ? '1':'0';
+  o->size[0] = __nmraOldPacket( o->packet[0], bytes, 2 );
+  if( o->size[0] > 0 ) {
+    o->n = 1;
+  }
+}
+
+
+/* The exports of the DDX library used by the nmraencode scenario. */
+struct NmraLib {
+  int (*loco[4])( int, int, int, int* );
+  int (*func[2])( int, int, int* );
+  int (*baseline)( int, int, int );
+  int (*accessory)( int, int, int, int );
+  int (*get)( int*, char*, int* );
+  int compared;
+  int cached;
+  int mismatches;
+};
+
+/* Streams the command queued, in order. */
+static void __nmraNew( struct NmraLib* lib, struct NmraOut* o, int rc ) {
+  char packet[NMRA_PKTSIZE];
+  int addr = 0;
+  int size = 0;
+
+  o->rc = rc;
+  o->n  = 0;
+  while( lib->get( &addr, packet, &size ) != -1 ) {
+    if( o->n < 2 ) {
+      o->size[o->n] = size;
+      MemOp.copy( o->packet[o->n], packet, size );
+    }
+    o->n++;
+  }
+}
+
+static void __nmraCompare( struct NmraLib* lib, struct NmraOut* ref, struct NmraOut* o, Boolean cached, const char* what, int a, int b, int c ) {
+  int i;
+  Boolean same = ref->rc == o->rc && ref->n == o->n;
+
+  for( i = 0; same && i < ref->n; i++ )
+    same = ref->size[i] == o->size[i] && MemOp.cmp( ref->packet[i], o->packet[i], ref->size[i] );
+
+  lib->compared++;
+  if( cached )
+    lib->cached++;
+  if( !same ) {
+    if( lib->mismatches < 10 )
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: %s %d %d %d%s: rc %d/%d, %d/%d streams",
+          what, a, b, c, cached ? " again":"", ref->rc, o->rc, ref->n, o->n );
+    lib->mismatches++;
+  }
+}
+
+static void __nmraFunctions( int* f, int cnt, int pattern, unsigned long* seed ) {
+  int i;
+  for( i = 0; i < cnt; i++ ) {
+    if( pattern < 2 )
+      f[i] = pattern;
+    else
+      f[i] = __random( seed ) % 64 == 0 ? 2:__random( seed ) % 2;
+  }
+}
+
+static void __nmraLoco( struct NmraLib* lib, int v, int address, int direction, int speed, int* f ) {
+  struct NmraOut ref, o;
+  int k;
+  __nmraOldLoco( &ref, v & 1, v & 2, address, direction, speed, f );
+  /* the second time from the stream cache */
+  for( k = 0; k < 2; k++ ) {
+    int rc = lib->loco[v]( address, direction, speed, f );
+    __nmraNew( lib, &o, rc );
+    __nmraCompare( lib, &ref, &o, k == 1, "loco", address, direction, speed );
+  }
+}
+
+/* DDX on a pty without power, so the bench reads the queue instead of the refresh cycle.
+ * Every command runs through the exported encoder functions twice, the second time from
+ * the stream cache, and both streams must match the former string encoder bit for bit:
+ * all 7 bit and 14 bit addresses, every speed step and function combination of a few
+ * of them, function groups, baseline and accessory packets, including out of range values. */
+static int __nmraEncode( iOBench inst, iOControl control, iONode result ) {
+  static const char* locos[] = { "comp_nmra_f4b7s28", "comp_nmra_f4b14s28", "comp_nmra_f4b7s128", "comp_nmra_f4b14s128" };
+  static const int cross[2][4] = { { 1, 3, 100, 127 }, { 1, 128, 1000, 10239 } };
+  struct NmraLib* lib = allocMem( sizeof( struct NmraLib ) );
+  struct NmraOut ref, o;
+  iONode digint = NULL;
+  iONode ddx = NULL;
+  iOLib pLib = NULL;
+  iIDigInt pDi = NULL;
+  iIDigInt (*pInitFun)( const iONode, const iOTrace ) = NULL;
+  char* libpath = NULL;
+  const char* device = NULL;
+  unsigned long seed = 27;
+  tracelevel level = 0;
+  unsigned long t0 = 0;
+  int rejected = 0;
+  int failures = 0;
+  int fd = -1;
+  int f[29];
+  int v, a, d, s, g, k, p;
+
+  fd = posix_openpt( O_RDWR | O_NOCTTY );
+  if( fd < 0 || grantpt( fd ) != 0 || unlockpt( fd ) != 0 || ( device = ptsname( fd ) ) == NULL ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: no pty for the DDX" );
+    if( fd >= 0 )
+      close( fd );
+    freeMem( lib );
+    return -1;
+  }
+  fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+
+  digint = NodeOp.inst( wDigInt.name(), NULL, ELEMENT_NODE );
+  wDigInt.setlib( digint, wDigInt.ddx );
+  wDigInt.setiid( digint, "ddxbench" );
+  ddx = NodeOp.inst( wDDX.name(), digint, ELEMENT_NODE );
+  NodeOp.addChild( digint, ddx );
+  wDDX.setport( ddx, device );
+  wDDX.sets88port( ddx, "0" );
+
+  libpath = StrOp.fmt( "%s%c%s", AppOp.getLibPath(), SystemOp.getFileSeparator(), wDigInt.ddx );
+  pLib = LibOp.inst( libpath );
+  StrOp.free( libpath );
+  if( pLib != NULL ) {
+    pInitFun = (iIDigInt (*)( const iONode, const iOTrace ))LibOp.getProc( pLib, "rocGetDigInt" );
+    for( v = 0; v < 4; v++ )
+      lib->loco[v] = (int (*)( int, int, int, int* ))LibOp.getProc( pLib, locos[v] );
+    lib->func[0]   = (int (*)( int, int, int* ))LibOp.getProc( pLib, "comp_nmra_fb7" );
+    lib->func[1]   = (int (*)( int, int, int* ))LibOp.getProc( pLib, "comp_nmra_fb14" );
+    lib->baseline  = (int (*)( int, int, int ))LibOp.getProc( pLib, "comp_nmra_baseline" );
+    lib->accessory = (int (*)( int, int, int, int ))LibOp.getProc( pLib, "comp_nmra_accessory" );
+    lib->get       = (int (*)( int*, char*, int* ))LibOp.getProc( pLib, "queue_get" );
+  }
+  if( pInitFun != NULL && lib->loco[3] != NULL && lib->func[1] != NULL && lib->accessory != NULL && lib->get != NULL )
+    pDi = pInitFun( digint, TraceOp.get() );
+  if( pDi == NULL ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: DDX library not loaded from [%s]", AppOp.getLibPath() );
+    close( fd );
+    freeMem( lib );
+    return -1;
+  }
+
+  level = TraceOp.getLevel( NULL );
+  TraceOp.setLevel( NULL, level & ~( TRCLEVEL_INFO | TRCLEVEL_USER1 | TRCLEVEL_MONITOR ) );
+  t0 = MetricsOp.now();
+
+  /* 4 function locos: every address, out of range ones included */
+  for( v = 0; v < 4; v++ ) {
+    for( a = -1; a <= ( v & 1 ? 10240:128 ); a++ ) {
+      __nmraFunctions( f, 5, 2, &seed );
+      d = __random( &seed ) % 40 == 0 ? 2:__random( &seed ) % 2;
+      s = __random( &seed ) % ( v & 2 ? 130:30 );
+      __nmraLoco( lib, v, a, d, s, f );
+    }
+    for( k = 0; k < 4; k++ ) {
+      for( d = 0; d < 2; d++ ) {
+        for( s = 0; s <= ( v & 2 ? 128:28 ); s++ ) {
+          for( p = 0; p < 32; p++ ) {
+            for( g = 0; g < 5; g++ )
+              f[g] = ( p >> g ) & 1;
+            __nmraLoco( lib, v, cross[v & 1][k], d, s, f );
+          }
+        }
+      }
+    }
+  }
+
+  /* function decoders; unknown groups are traced as warning, so only for the cross addresses */
+  for( v = 0; v < 2; v++ ) {
+    for( a = -1; a <= ( v ? 10240:128 ); a += ( v && a > 130 && a < 10130 ) ? 97:1 ) {
+      Boolean unknown = a == cross[v][0] || a == cross[v][3];
+      for( g = unknown ? -1:0; g <= ( unknown ? 8:7 ); g++ ) {
+        for( p = 0; p < 4; p++ ) {
+          __nmraFunctions( f, 29, p, &seed );
+          if( !__nmraOldFunc( &ref, v, a, g, f ) ) {
+            /* the bit packed encoder rejects it */
+            rejected++;
+            ref.rc = 1;
+            ref.n  = 0;
+          }
+          for( k = 0; k < 2; k++ ) {
+            __nmraNew( lib, &o, lib->func[v]( a, g, f ) );
+            __nmraCompare( lib, &ref, &o, k == 1, "function", a, g, p );
+          }
+        }
+      }
+    }
+  }
+
+  /* baseline */
+  for( a = -1; a <= 128; a++ ) {
+    for( d = -1; d <= 2; d++ ) {
+      for( s = -1; s <= 16; s++ ) {
+        __nmraOldBaseline( &ref, a, d, s );
+        for( k = 0; k < 2; k++ ) {
+          __nmraNew( lib, &o, lib->baseline( a, d, s ) );
+          __nmraCompare( lib, &ref, &o, k == 1, "baseline", a, d, s );
+        }
+      }
+    }
+  }
+
+  /* accessories, the second one from the accessory pool; out of range values are traced as warning */
+  for( a = -1; a <= 1024; a++ ) {
+    Boolean range = a == 1 || a == 1023;
+    for( p = range ? 0:1; p <= ( range ? 5:4 ); p++ ) {
+      for( g = range ? -1:0; g <= ( range ? 2:1 ); g++ ) {
+        for( d = 0; d < 2; d++ ) {
+          __nmraOldAccessory( &ref, a, p, g, d );
+          for( k = 0; k < 2; k++ ) {
+            __nmraNew( lib, &o, lib->accessory( a, p, g, d ) );
+            __nmraCompare( lib, &ref, &o, k == 1, "accessory", a, p, g );
+          }
+        }
+      }
+    }
+  }
+
+  t0 = MetricsOp.now() - t0;
+  TraceOp.setLevel( NULL, level );
+  pDi->halt( (obj)pDi, False );
+  close( fd );
+
+  if( lib->mismatches > 0 ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: %d of %d NMRA streams differ", lib->mismatches, lib->compared );
+    failures++;
+  }
+  NodeOp.setInt( result, "compared", lib->compared );
+  NodeOp.setInt( result, "cached", lib->cached );
+  NodeOp.setInt( result, "mismatches", lib->mismatches );
+  NodeOp.setInt( result, "rejected", rejected );
+  NodeOp.setLong( result, "encodems", (long)( t0 / 1000 ) );
+
+  /* the halted interface keeps its ini */
+  freeMem( lib );
+  return failures;
+}
+
+
+/* The ddxrefresh simulator of the DDX refresh cycle: the track time of a byte is 10 bits at 19200 baud. */
+#define DDX_TRACKMS( bytes ) ( (long)( (bytes) * 25 / 48 ) )
+#define DDX_RING     64
+#define DDX_IDLE     13 /* idle packet bytes after each send of a packet */
+#define DDX_IDLEDATA 52 /* idle bytes after each refresh */
+#define DDX_QSIZE    2000 /* packets the queue holds */
+
+/* The exports of the DDX library used by the ddxrefresh scenario. */
+struct DdxSim {
+  int (*loco)( int, int, int, int* );
+  int (*get)( int*, char*, int* );
+  int (*dropped)( void );
+  Boolean (*send)( iOSerial, int, char*, int, int, int );
+  int (*refresh)( iOSerial, locorefreshdata* );
+  iIDigInt (*init)( const iONode, const iOTrace );
+  iOSerial serial;
+  locorefreshdata cycle;
+  int  fd;
+  unsigned long total;
+  char ring[DDX_RING];
+  /* the speed packet of the last command */
+  char pattern[NMRA_PKTSIZE];
+  int  size;
+  unsigned long sent;
+  unsigned long repeated;
+  unsigned long last;
+  /* the speed packet of a loco without commands */
+  char watch[NMRA_PKTSIZE];
+  int  watchsize;
+  unsigned long watchlast;
+  unsigned long watchgap;
+  int  watchseen;
+};
+
+static Boolean __ddxEndsWith( struct DdxSim* sim, const char* pattern, int size ) {
+  int i;
+  if( size == 0 || sim->total < (unsigned long)size )
+    return False;
+  for( i = 0; i < size; i++ ) {
+    if( sim->ring[( sim->total - 1 - i ) % DDX_RING] != pattern[size - 1 - i] )
+      return False;
+  }
+  return True;
+}
+
+/* Reads the track output; a packet goes out twice with idle bytes in between, which counts as one send. */
+static void __ddxTrack( struct DdxSim* sim ) {
+  char buf[1024];
+  int n, i;
+
+  while( ( n = read( sim->fd, buf, sizeof( buf ) ) ) > 0 ) {
+    for( i = 0; i < n; i++ ) {
+      sim->ring[sim->total % DDX_RING] = buf[i];
+      sim->total++;
+      if( __ddxEndsWith( sim, sim->pattern, sim->size ) ) {
+        if( sim->last == 0 || sim->total - sim->last > (unsigned long)( sim->size + DDX_IDLE ) ) {
+          if( sim->sent == 0 )
+            sim->sent = sim->total;
+          else if( sim->repeated == 0 )
+            sim->repeated = sim->total;
+        }
+        sim->last = sim->total;
+      }
+      if( __ddxEndsWith( sim, sim->watch, sim->watchsize ) ) {
+        if( sim->watchlast > 0 && sim->total - sim->watchlast > (unsigned long)( sim->watchsize + DDX_IDLE ) ) {
+          if( sim->total - sim->watchlast > sim->watchgap )
+            sim->watchgap = sim->total - sim->watchlast;
+          sim->watchseen++;
+        }
+        sim->watchlast = sim->total;
+      }
+    }
+  }
+}
+
+/* One turn of the refresh cycle: the queued commands, or else one refresh and the idle data. */
+static void __ddxSlot( struct DdxSim* sim ) {
+  char packet[NMRA_PKTSIZE];
+  int addr = 0;
+  int size = 0;
+  int type = sim->get( &addr, packet, &size );
+
+  if( type > 0 ) {
+    while( type > 0 ) {
+      sim->send( sim->serial, addr, packet, size, type, False );
+      __ddxTrack( sim );
+      type = sim->get( &addr, packet, &size );
+    }
+  }
+  else {
+    sim->refresh( sim->serial, &sim->cycle );
+    __ddxTrack( sim );
+    sim->total += DDX_IDLEDATA;
+  }
+}
+
+/* One DDX with the given refresh policy: ddxlocos locos with 128 speed steps, then ddxcommands
+ * speed commands, each one ddxpace slots or the repeat of the former one later. */
+static int __ddxPolicy( struct DdxSim* sim, const char* policy, iONode result ) {
+  struct NmraOut ref;
+  iONode digint = NULL;
+  iONode ddx = NULL;
+  iIDigInt pDi = NULL;
+  const char* device = NULL;
+  char key[64];
+  int* speed = allocMem( ( BenchOp.ddxlocos + 1 ) * sizeof( int ) );
+  unsigned long seed = 28;
+  unsigned long sentsum = 0, repeatsum = 0, repeatmax = 0;
+  int commands = 0;
+  int failures = 0;
+  int f[5] = { 0, 0, 0, 0, 0 };
+  int a, c, s, n;
+
+  sim->fd = posix_openpt( O_RDWR | O_NOCTTY );
+  if( sim->fd < 0 || grantpt( sim->fd ) != 0 || unlockpt( sim->fd ) != 0 || ( device = ptsname( sim->fd ) ) == NULL ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: no pty for the DDX" );
+    if( sim->fd >= 0 )
+      close( sim->fd );
+    freeMem( speed );
+    return -1;
+  }
+  fcntl( sim->fd, F_SETFL, fcntl( sim->fd, F_GETFL ) | O_NONBLOCK );
+
+  /* the interface initializes the pools for the policy; the bench runs the cycle on its own port */
+  digint = NodeOp.inst( wDigInt.name(), NULL, ELEMENT_NODE );
+  wDigInt.setlib( digint, wDigInt.ddx );
+  wDigInt.setiid( digint, policy );
+  ddx = NodeOp.inst( wDDX.name(), digint, ELEMENT_NODE );
+  NodeOp.addChild( digint, ddx );
+  wDDX.setport( ddx, device );
+  wDDX.sets88port( ddx, "0" );
+  wDDX.setmotorolarefresh( ddx, False );
+  wDDX.setrefreshpolicy( ddx, policy );
+  pDi = sim->init( digint, TraceOp.get() );
+  sim->serial = SerialOp.inst( device );
+  if( pDi == NULL || !SerialOp.open( sim->serial ) ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: DDX on [%s] not opened", device );
+    close( sim->fd );
+    freeMem( speed );
+    return -1;
+  }
+
+  MemOp.set( &sim->cycle, 0, sizeof( locorefreshdata ) );
+  sim->cycle.nmra_fx_refresh  = -1;
+  sim->cycle.last_refreshed_fx = -1;
+  sim->cycle.dcc_locorefresh  = True;
+  sim->cycle.nmra_refreshprio = StrOp.equals( wDDX.priority, policy );
+  sim->total = 0;
+  sim->size  = 0;
+  sim->watchlast = 0;
+  sim->watchseen = 0;
+
+  /* every loco gets a speed; the last one gets no commands */
+  for( a = 1; a <= BenchOp.ddxlocos; a++ ) {
+    speed[a] = 1 + a % 100;
+    sim->loco( a, 1, speed[a], f );
+  }
+  __nmraOldLoco( &ref, False, True, BenchOp.ddxlocos, 1, speed[BenchOp.ddxlocos], f );
+  MemOp.copy( sim->watch, ref.packet[0], ref.size[0] );
+  sim->watchsize = ref.size[0];
+  for( n = 0; sim->watchseen < 2 && n < 100 * BenchOp.ddxlocos; n++ )
+    __ddxSlot( sim );
+  sim->watchgap = 0;
+
+  for( c = 0; c < BenchOp.ddxcommands; c++ ) {
+    unsigned long issued = 0;
+    a = 1 + __random( &seed ) % ( BenchOp.ddxlocos - 1 );
+    s = 1 + __random( &seed ) % 126;
+    if( s == speed[a] )
+      s = s % 126 + 1;
+    speed[a] = s;
+    __nmraOldLoco( &ref, False, True, a, 1, s, f );
+    MemOp.copy( sim->pattern, ref.packet[0], ref.size[0] );
+    sim->size     = ref.size[0];
+    sim->sent     = 0;
+    sim->repeated = 0;
+    sim->last     = 0;
+    issued = sim->total;
+
+    sim->loco( a, 1, s, f );
+    for( n = 0; sim->repeated == 0 && n < 100 * BenchOp.ddxlocos; n++ )
+      __ddxSlot( sim );
+
+    if( sim->repeated > 0 ) {
+      commands++;
+      sentsum += sim->sent - issued;
+      repeatsum += sim->repeated - sim->sent;
+      if( sim->repeated - sim->sent > repeatmax )
+        repeatmax = sim->repeated - sim->sent;
+    }
+    else {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: %s: speed %d of loco %d %s", policy, s, a,
+          sim->sent > 0 ? "never repeated":"never sent" );
+      failures++;
+    }
+    /* the next command ddxpace slots after this one */
+    for( n = n + __random( &seed ) % 8; n < BenchOp.ddxpace; n++ )
+      __ddxSlot( sim );
+  }
+  sim->size = 0;
+
+  SerialOp.close( sim->serial );
+  SerialOp.base.del( sim->serial );
+  pDi->halt( (obj)pDi, False );
+  close( sim->fd );
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999,
+      "bench: %s: %d commands sent after %ldms and repeated after %ldms (max %ldms), refresh gap %ldms",
+      policy, commands, DDX_TRACKMS( commands > 0 ? sentsum / commands:0 ),
+      DDX_TRACKMS( commands > 0 ? repeatsum / commands:0 ), DDX_TRACKMS( repeatmax ), DDX_TRACKMS( sim->watchgap ) );
+  StrOp.fmtb( key, "%s_sent_ms", policy );
+  NodeOp.setLong( result, key, DDX_TRACKMS( commands > 0 ? sentsum / commands:0 ) );
+  StrOp.fmtb( key, "%s_repeat_ms", policy );
+  NodeOp.setLong( result, key, DDX_TRACKMS( commands > 0 ? repeatsum / commands:0 ) );
+  StrOp.fmtb( key, "%s_repeat_max_ms", policy );
+  NodeOp.setLong( result, key, DDX_TRACKMS( repeatmax ) );
+  StrOp.fmtb( key, "%s_refresh_gap_ms", policy );
+  NodeOp.setLong( result, key, DDX_TRACKMS( sim->watchgap ) );
+
+  /* the halted interface keeps its ini */
+  freeMem( speed );
+  return failures;
+}
+
+/* The refresh cycle of the DDX simulated on a pty, once round robin and once with priority:
+ * the bench runs the turns of the cycle itself, so the output is never faster than it is read.
+ * The latency of a speed command is the track time until it is sent and until its first repeat
+ * by the refresh, found by its bytes in the output; the refresh gap of an unchanged loco shows
+ * what the priority costs the others. At last a packet on a full queue has to wait, then drop. */
+static int __ddxRefresh( iOBench inst, iOControl control, iONode result ) {
+  struct DdxSim* sim = allocMem( sizeof( struct DdxSim ) );
+  iOLib pLib = NULL;
+  char* libpath = NULL;
+  tracelevel level = 0;
+  unsigned long t0 = 0;
+  int f[5] = { 0, 0, 0, 0, 0 };
+  int failures = 0;
+  int dropped = 0;
+  int rc = 0;
+  int i = 0;
+
+  libpath = StrOp.fmt( "%s%c%s", AppOp.getLibPath(), SystemOp.getFileSeparator(), wDigInt.ddx );
+  pLib = LibOp.inst( libpath );
+  StrOp.free( libpath );
+  if( pLib != NULL ) {
+    sim->loco    = (int (*)( int, int, int, int* ))LibOp.getProc( pLib, "comp_nmra_f4b7s128" );
+    sim->get     = (int (*)( int*, char*, int* ))LibOp.getProc( pLib, "queue_get" );
+    sim->dropped = (int (*)( void ))LibOp.getProc( pLib, "queue_dropped" );
+    sim->send    = (Boolean (*)( iOSerial, int, char*, int, int, int ))LibOp.getProc( pLib, "send_packet" );
+    sim->refresh = (int (*)( iOSerial, locorefreshdata* ))LibOp.getProc( pLib, "refresh_loco" );
+    sim->init    = (iIDigInt (*)( const iONode, const iOTrace ))LibOp.getProc( pLib, "rocGetDigInt" );
+  }
+  if( sim->loco == NULL || sim->get == NULL || sim->dropped == NULL || sim->send == NULL || sim->refresh == NULL || sim->init == NULL ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: DDX library not loaded from [%s]", AppOp.getLibPath() );
+    freeMem( sim );
+    return -1;
+  }
+
+  level = TraceOp.getLevel( NULL );
+  TraceOp.setLevel( NULL, level & ~( TRCLEVEL_INFO | TRCLEVEL_USER1 | TRCLEVEL_MONITOR ) );
+  rc = __ddxPolicy( sim, wDDX.roundrobin, result );
+  if( rc >= 0 ) {
+    failures += rc;
+    rc = __ddxPolicy( sim, wDDX.priority, result );
+  }
+  TraceOp.setLevel( NULL, level );
+  if( rc < 0 ) {
+    freeMem( sim );
+    return -1;
+  }
+  failures += rc;
+
+  if( NodeOp.getLong( result, "priority_repeat_ms", 0 ) >= NodeOp.getLong( result, "roundrobin_repeat_ms", 0 ) ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: the priority policy does not repeat a change sooner" );
+    failures++;
+  }
+
+  /* nobody sends the queue of the halted interface: the packet after the last free slot waits, then drops */
+  dropped = sim->dropped();
+  for( i = 0; i <= DDX_QSIZE / 2 && sim->dropped() == dropped; i++ ) {
+    t0 = MetricsOp.now();
+    sim->loco( 1 + i % 100, 1, 1 + i % 126, f );
+    t0 = MetricsOp.now() - t0;
+  }
+  dropped = sim->dropped() - dropped;
+  if( dropped == 0 || t0 < 100000 ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: full queue: %d packets dropped after %ldms", dropped, (long)( t0 / 1000 ) );
+    failures++;
+  }
+  NodeOp.setInt( result, "fullqueue_dropped", dropped );
+  NodeOp.setLong( result, "fullqueue_wait_ms", (long)( t0 / 1000 ) );
+  NodeOp.setInt( result, "locos", BenchOp.ddxlocos );
+  freeMem( sim );
+  return failures;
+}
+#endif
+
+
+/* Threads bumping one counter of the metrics scenario. */
+struct MetricBump {
+  iOMutex mux;
+  int     id;
+  Boolean done;
+};
+
+static void __metricBump( void* threadinst ) {
+  iOThread th = (iOThread)threadinst;
+  struct MetricBump* b = (struct MetricBump*)ThreadOp.getParm( th );
+  int i = 0;
+
+  for( i = 0; i < BenchOp.metricadds; i++ ) {
+    MetricsOp.add( b->id, 1 );
+    if( i % 1000 == 0 )
+      ThreadOp.sleep( 0 );
+  }
+  ThreadOp.base.del( th );
+  MutexOp.wait( b->mux );
+  b->done = True;
+  MutexOp.post( b->mux );
+}
+
+/* BER encoded OID without tag and length. */
+static int __berOid( byte* out, const char* oid ) {
+  long sub[32];
+  byte tmp[5];
+  const char* p = oid;
+  int cnt = 0;
+  int len = 0;
+  int n = 0;
+  int i = 0;
+
+  while( *p != '\0' && cnt < 32 ) {
+    sub[cnt++] = atol( p );
+    while( *p != '\0' && *p != '.' )
+      p++;
+    if( *p == '.' )
+      p++;
+  }
+  out[len++] = (byte)( sub[0] * 40 + sub[1] );
+  for( i = 2; i < cnt; i++ ) {
+    long v = sub[i];
+    n = 0;
+    do {
+      tmp[n++] = (byte)( v & 0x7F );
+      v >>= 7;
+    } while( v > 0 );
+    while( n > 0 ) {
+      n--;
+      out[len++] = (byte)( tmp[n] | ( n > 0 ? 0x80:0 ) );
+    }
+  }
+  return len;
+}
+
+/* SNMPv2c GetRequest for one OID; all lengths fit the short form. */
+static int __snmpGetRequest( byte* out, const char* community, int reqid, const char* oid ) {
+  byte o[64];
+  int olen = __berOid( o, oid );
+  int clen = StrOp.len( community );
+  int vb   = 2 + olen + 2;
+  int pdu  = 3 + 3 + 3 + 2 + 2 + vb;
+  int len  = 0;
+
+  out[len++] = 0x30;
+  out[len++] = (byte)( 3 + 2 + clen + 2 + pdu );
+  out[len++] = 0x02; out[len++] = 1; out[len++] = 1;
+  out[len++] = 0x04; out[len++] = (byte)clen;
+  MemOp.copy( out + len, community, clen );
+  len += clen;
+  out[len++] = 0xA0; out[len++] = (byte)pdu;
+  out[len++] = 0x02; out[len++] = 1; out[len++] = (byte)reqid;
+  out[len++] = 0x02; out[len++] = 1; out[len++] = 0;
+  out[len++] = 0x02; out[len++] = 1; out[len++] = 0;
+  out[len++] = 0x30; out[len++] = (byte)( 2 + vb );
+  out[len++] = 0x30; out[len++] = (byte)vb;
+  out[len++] = 0x06; out[len++] = (byte)olen;
+  MemOp.copy( out + len, o, olen );
+  len += olen;
+  out[len++] = 0x05; out[len++] = 0;
+  return len;
+}
+
+/* Steps into the TLV at *pos; returns its content length or -1. */
+static int __berNext( byte* in, int inlen, int* pos, int* type ) {
+  int len = 0;
+  int n = 0;
+
+  if( *pos + 2 > inlen )
+    return -1;
+  *type = in[(*pos)++];
+  len = in[(*pos)++];
+  if( len & 0x80 ) {
+    n = len & 0x7F;
+    len = 0;
+    while( n-- > 0 && *pos < inlen )
+      len = ( len << 8 ) | in[(*pos)++];
+  }
+  return *pos + len <= inlen ? len:-1;
+}
+
+static long __berInt( byte* in, int len ) {
+  long val = 0;
+  int i = 0;
+  for( i = 0; i < len; i++ )
+    val = ( val << 8 ) | in[i];
+  return val;
+}
+
+/* Value of the only variable in a GetResponse; False on an error status. */
+static Boolean __snmpValue( byte* in, int inlen, int reqid, long* value ) {
+  int pos = 0;
+  int type = 0;
+  int len = 0;
+  int i = 0;
+
+  /* message, version, community, pdu */
+  if( __berNext( in, inlen, &pos, &type ) < 0 || type != 0x30 )
+    return False;
+  for( i = 0; i < 2; i++ ) {
+    if( ( len = __berNext( in, inlen, &pos, &type ) ) < 0 )
+      return False;
+    pos += len;
+  }
+  if( __berNext( in, inlen, &pos, &type ) < 0 || type != 0xA2 )
+    return False;
+  /* request id, error status, error index */
+  if( ( len = __berNext( in, inlen, &pos, &type ) ) < 0 || __berInt( in + pos, len ) != reqid )
+    return False;
+  pos += len;
+  if( ( len = __berNext( in, inlen, &pos, &type ) ) < 0 || __berInt( in + pos, len ) != 0 )
+    return False;
+  pos += len;
+  if( ( len = __berNext( in, inlen, &pos, &type ) ) < 0 )
+    return False;
+  pos += len;
+  /* variable list, variable, oid, value */
+  if( __berNext( in, inlen, &pos, &type ) < 0 || __berNext( in, inlen, &pos, &type ) < 0 )
+    return False;
+  if( ( len = __berNext( in, inlen, &pos, &type ) ) < 0 )
+    return False;
+  pos += len;
+  if( ( len = __berNext( in, inlen, &pos, &type ) ) < 0 || ( type != 0x02 && type != 0x46 ) )
+    return False;
+  *value = __berInt( in + pos, len );
+  return True;
+}
+
+/* A counter bumped from several threads must read back the exact total through
+ * MetricsOp and, with an active SNMP service, the value column of privMetrics. */
+static int __metrics( iOBench inst, iOControl control, iONode result ) {
+  iONode snmp = wRocRail.getSnmpService( AppOp.getIni() );
+  int cnt = BenchOp.metricthreads;
+  struct MetricBump* b = allocMem( cnt * sizeof( struct MetricBump ) );
+  long expected = 0;
+  long value = 0;
+  int failures = 0;
+  int id = 0;
+  int i = 0;
+
+  id = MetricsOp.counter( "bench_readback_total", "Counter read back by the metrics scenario." );
+  if( id < 0 ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: metrics registry full" );
+    freeMem( b );
+    return -1;
+  }
+  expected = MetricsOp.getValue( id, METRIC_VALUE ) + (long)cnt * BenchOp.metricadds;
+
+  for( i = 0; i < cnt; i++ ) {
+    char tname[32];
+    b[i].mux = MutexOp.inst( NULL, True );
+    b[i].id  = id;
+    StrOp.fmtb( tname, "benchbump%d", i );
+    ThreadOp.start( ThreadOp.inst( tname, &__metricBump, &b[i] ) );
+  }
+  for( i = 0; i < cnt; i++ ) {
+    MutexOp.wait( b[i].mux );
+    while( !b[i].done ) {
+      MutexOp.post( b[i].mux );
+      ThreadOp.sleep( 10 );
+      MutexOp.wait( b[i].mux );
+    }
+    MutexOp.post( b[i].mux );
+    MutexOp.base.del( b[i].mux );
+  }
+  freeMem( b );
+
+  value = MetricsOp.getValue( id, METRIC_VALUE );
+  if( value != expected ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: counter reads %ld, expected %ld", value, expected );
+    failures++;
+  }
+  NodeOp.setInt( result, "threads", cnt );
+  NodeOp.setLong( result, "expected", expected );
+  NodeOp.setLong( result, "metrics", value );
+
+  if( snmp != NULL && wSnmpService.isactive( snmp ) ) {
+    iOSocket s = SocketOp.inst( "localhost", wSnmpService.getport( snmp ), False, True, False );
+    byte out[128];
+    byte in[256];
+    char oid[64];
+    int outlen = 0;
+    int inlen = 0;
+    int reqid = 0;
+    Boolean got = False;
+
+    StrOp.fmtb( oid, "%s.1.3.%d", wSnmpService.privMetrics, id + 1 );
+    SocketOp.setRcvTimeout( s, 2 );
+    /* the agent thread starts listening a second after start up */
+    for( reqid = 1; reqid <= 5 && !got; reqid++ ) {
+      outlen = __snmpGetRequest( out, wSnmpService.getcommunity( snmp ), reqid, oid );
+      if( !SocketOp.sendto( s, (char*)out, outlen, NULL, 0 ) )
+        continue;
+      inlen = SocketOp.recvfrom( s, (char*)in, sizeof( in ), NULL, NULL );
+      got = inlen > 0 && __snmpValue( in, inlen, reqid, &value );
+    }
+    SocketOp.base.del( s );
+
+    if( !got ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: no SNMP response for %s", oid );
+      failures++;
+    }
+    else if( value != expected ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: %s reads %ld, expected %ld", oid, value, expected );
+      failures++;
+    }
+    NodeOp.setStr( result, "oid", oid );
+    NodeOp.setLong( result, "snmp", got ? value:-1 );
+  }
+  else
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "bench: SNMP service not active; metrics read back only" );
+
+  return failures;
+}
+
+
+/* Feedback events of the MCS2 interface in the udpflood scenario. */
+struct UdpFlood {
+  iOMutex mux;
+  int     events;
+  int     shortset;
+};
+
+static void __udpListener( obj inst, iONode node, int level ) {
+  struct UdpFlood* f = (struct UdpFlood*)inst;
+  if( StrOp.equals( NodeOp.getName( node ), wFeedback.name() ) ) {
+    MutexOp.wait( f->mux );
+    f->events++;
+    /* the state byte is not in a short frame */
+    if( wFeedback.getaddr( node ) >= 30000 && wFeedback.isstate( node ) )
+      f->shortset++;
+    MutexOp.post( f->mux );
+  }
+  NodeOp.base.del( node );
+}
+
+static int __udpEvents( struct UdpFlood* f ) {
+  int events = 0;
+  MutexOp.wait( f->mux );
+  events = f->events;
+  MutexOp.post( f->mux );
+  return events;
+}
+
+/* A CS2 sensor event: 13 byte CAN frame. */
+static void __udpSensorFrame( byte* frame, int addr, int state ) {
+  MemOp.set( frame, 0, 13 );
+  frame[1]  = 0x23;
+  frame[4]  = 8;
+  frame[7]  = ( addr >> 8 ) & 0xFF;
+  frame[8]  = addr & 0xFF;
+  frame[9]  = !state;
+  frame[10] = state;
+}
+
+/* Sensor events flooding the UDP port of an MCS2 interface, as in a CS2 start up,
+ * followed by datagrams cut after the address. Reports the events read and lost;
+ * fails if a short datagram reads the state byte of an earlier frame. */
+static int __udpFlood( iOBench inst, iOControl control, iONode result ) {
+  struct UdpFlood* f = allocMem( sizeof( struct UdpFlood ) );
+  iONode digint = NodeOp.inst( wDigInt.name(), NULL, ELEMENT_NODE );
+  iOLib pLib = NULL;
+  iIDigInt pDi = NULL;
+  iIDigInt (*pInitFun)( const iONode, const iOTrace ) = NULL;
+  iOSocket s = NULL;
+  char* libpath = NULL;
+  byte frame[13];
+  tracelevel level = 0;
+  unsigned long t0 = 0;
+  unsigned long tlast = 0;
+  int frames = BenchOp.udpframes;
+  int shortframes = BenchOp.udpshortframes;
+  int port = 0;
+  int events = 0;
+  int seen = 0;
+  int failures = 0;
+  int i = 0;
+
+  f->mux = MutexOp.inst( NULL, True );
+
+  port = BenchOp.udpport + 2 * ( SystemOp.getpid() % 100 );
+  wDigInt.setlib( digint, wDigInt.mcs2 );
+  wDigInt.setiid( digint, "udpbench" );
+  wDigInt.setsublib( digint, wDigInt.sublib_udp );
+  wDigInt.sethost( digint, "127.0.0.1" );
+  wDigInt.setudpportRX( digint, port );
+  wDigInt.setudpportTX( digint, port + 1 );
+  wDigInt.setfbmod( digint, 0 );
+
+  libpath = StrOp.fmt( "%s%c%s", AppOp.getLibPath(), SystemOp.getFileSeparator(), wDigInt.mcs2 );
+  pLib = LibOp.inst( libpath );
+  StrOp.free( libpath );
+  if( pLib != NULL )
+    pInitFun = (iIDigInt (*)( const iONode, const iOTrace ))LibOp.getProc( pLib, "rocGetDigInt" );
+  if( pInitFun != NULL )
+    pDi = pInitFun( digint, TraceOp.get() );
+  if( pDi == NULL ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: MCS2 library not loaded from [%s]", AppOp.getLibPath() );
+    MutexOp.base.del( f->mux );
+    freeMem( f );
+    return -1;
+  }
+  pDi->setListener( (obj)pDi, (obj)f, &__udpListener );
+
+  level = TraceOp.getLevel( NULL );
+  TraceOp.setLevel( NULL, level & ~( TRCLEVEL_INFO | TRCLEVEL_USER1 | TRCLEVEL_MONITOR ) );
+  ThreadOp.sleep( 500 );
+
+  s = SocketOp.inst( "127.0.0.1", port, False, True, False );
+  t0 = MetricsOp.now();
+  for( i = 0; i < frames; i++ ) {
+    __udpSensorFrame( frame, 1 + i % 1000, 1 );
+    if( !SocketOp.sendto( s, (char*)frame, 13, NULL, 0 ) )
+      failures++;
+  }
+  /* all what made it through the socket buffer */
+  events = __udpEvents( f );
+  tlast = MetricsOp.now();
+  while( MetricsOp.now() - tlast < 500000UL ) {
+    ThreadOp.sleep( 10 );
+    if( __udpEvents( f ) != events ) {
+      events = __udpEvents( f );
+      tlast = MetricsOp.now();
+    }
+  }
+  tlast = tlast - t0;
+
+  for( i = 0; i < shortframes; i++ ) {
+    __udpSensorFrame( frame, 30000 + i, 1 );
+    if( !SocketOp.sendto( s, (char*)frame, 9, NULL, 0 ) )
+      failures++;
+    if( i % 16 == 15 )
+      ThreadOp.sleep( 1 );
+  }
+  for( i = 0; i < 100 && __udpEvents( f ) < events + shortframes; i++ )
+    ThreadOp.sleep( 10 );
+  SocketOp.base.del( s );
+
+  MutexOp.wait( f->mux );
+  seen = f->events - events;
+  if( f->shortset > 0 ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: %d of %d short frames read a state", f->shortset, seen );
+    failures++;
+  }
+  MutexOp.post( f->mux );
+  if( events == 0 ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: no sensor event read" );
+    failures++;
+  }
+
+  pDi->halt( (obj)pDi, False );
+  TraceOp.setLevel( NULL, level );
+
+  NodeOp.setInt( result, "frames", frames );
+  NodeOp.setInt( result, "events", events );
+  NodeOp.setInt( result, "lost", frames - events );
+  NodeOp.setLong( result, "readms", (long)tlast / 1000 );
+  NodeOp.setInt( result, "shortframes", shortframes );
+  NodeOp.setInt( result, "shortseen", seen );
+
+  /* the halted reader still waits on its socket; the interface and the listener state stay */
+  return failures;
+}
+
+
+/* R2Rnet instance requesting blocks of another one in the r2rloss scenario. */
+struct R2rClient {
+  iOMutex  mux;
+  iOR2Rnet net;
+  char     bkid[128];
+  int      answered;
+  Boolean  done;
+};
+
+static void __r2rClient( void* threadinst ) {
+  iOThread th = (iOThread)threadinst;
+  struct R2rClient* c = (struct R2rClient*)ThreadOp.getParm( th );
+  int i = 0;
+
+  for( i = 0; i < BenchOp.r2rrequests; i++ ) {
+    iONode bk = R2RnetOp.getBlock( c->net, c->bkid );
+    if( bk != NULL ) {
+      c->answered++;
+      NodeOp.base.del( bk );
+    }
+  }
+  ThreadOp.base.del( th );
+  MutexOp.wait( c->mux );
+  c->done = True;
+  MutexOp.post( c->mux );
+}
+
+static iOR2Rnet __r2rInst( const char* id, int port ) {
+  iONode ini = NodeOp.inst( wR2RnetIni.name(), NULL, ELEMENT_NODE );
+  wR2RnetIni.setid( ini, id );
+  wR2RnetIni.setport( ini, port );
+  wR2RnetIni.setbinary( ini, True );
+  wR2RnetIni.setdroprate( ini, BenchOp.r2rdroprate );
+  return R2RnetOp.inst( ini );
+}
+
+/* Three R2Rnet instances in one process on a lossy multicast group.
+ * A reserve which timed out while its peer was not yet started may not lock the block later;
+ * then two instances request blocks of the third at once and every sequenced
+ * message must be delivered exactly once. */
+static int __r2rLoss( iOBench inst, iOControl control, iONode result ) {
+  iOModel model = AppOp.getModel();
+  iONode plan = ModelOp.getModel( model );
+  iONode bklist = wPlan.getbklist( plan );
+  iONode bk = NULL;
+  iONode from = NULL;
+  iONode lc = NULL;
+  iIBlockBase block = NULL;
+  iOR2Rnet a = NULL;
+  iOR2Rnet b = NULL;
+  iOR2Rnet c = NULL;
+  struct R2rClient* clients = NULL;
+  tracelevel level = 0;
+  long delivered0 = 0;
+  long dropped0 = 0;
+  long retransmits0 = 0;
+  long duplicates0 = 0;
+  long delivered = 0;
+  long dropped = 0;
+  long expected = 0;
+  long settled = 0;
+  unsigned long tlast = 0;
+  int port = BenchOp.r2rport + SystemOp.getpid() % 100;
+  int answered = 0;
+  int failures = 0;
+  int i = 0;
+
+  /* a free block to reserve and the one the loco comes from */
+  for( from = bklist != NULL ? wBlockList.getbk( bklist ):NULL; from != NULL; from = wBlockList.nextbk( bklist, from ) ) {
+    iIBlockBase free = ModelOp.getBlock( model, wBlock.getid( from ) );
+    if( bk == NULL && free != NULL && StrOp.len( free->getLoc( free ) ) == 0 ) {
+      bk = from;
+      block = free;
+    }
+    else if( bk != NULL )
+      break;
+  }
+  if( bk == NULL || from == NULL ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: the plan needs a free block and a second one" );
+    return -1;
+  }
+
+  level = TraceOp.getLevel( NULL );
+  TraceOp.setLevel( NULL, level & ~( TRCLEVEL_INFO | TRCLEVEL_USER1 | TRCLEVEL_MONITOR ) );
+
+  a = __r2rInst( "r2ra", port );
+  c = __r2rInst( "r2rc", port );
+  ThreadOp.sleep( 200 );
+
+  /* reserve on a peer which starts after the local timeout */
+  lc = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
+  wLoc.setid( lc, "r2rbench" );
+  if( R2RnetOp.reserveBlock( a, "r2rb", wBlock.getid( bk ), NULL, lc, from, False ) ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: reserve answered without a peer" );
+    failures++;
+  }
+  ThreadOp.sleep( 300 );
+  b = __r2rInst( "r2rb", port );
+  ThreadOp.sleep( 3000 );
+  if( StrOp.len( block->getLoc( block ) ) > 0 ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: timed out reserve locked block %s for %s",
+        wBlock.getid( bk ), block->getLoc( block ) );
+    NodeOp.setStr( result, "phantom", block->getLoc( block ) );
+    block->unLock( block, block->getLoc( block ), NULL );
+    failures++;
+  }
+  NodeOp.base.del( lc );
+
+  delivered0 = __metricCount( "r2rnet_delivered_total" );
+  dropped0 = __metricCount( "r2rnet_dropped_total" );
+  retransmits0 = __metricCount( "r2rnet_retransmits_total" );
+  duplicates0 = __metricCount( "r2rnet_duplicates_total" );
+
+  clients = allocMem( 2 * sizeof( struct R2rClient ) );
+  clients[0].net = a;
+  clients[1].net = c;
+  StrOp.fmtb( clients[0].bkid, "r2rb::%s", wBlock.getid( bk ) );
+  StrOp.fmtb( clients[1].bkid, "r2rb::%s", wBlock.getid( from ) );
+  for( i = 0; i < 2; i++ ) {
+    clients[i].mux = MutexOp.inst( NULL, True );
+    ThreadOp.start( ThreadOp.inst( i == 0 ? "r2rbencha":"r2rbenchc", &__r2rClient, &clients[i] ) );
+  }
+  for( i = 0; i < 2; i++ ) {
+    MutexOp.wait( clients[i].mux );
+    while( !clients[i].done ) {
+      MutexOp.post( clients[i].mux );
+      ThreadOp.sleep( 10 );
+      MutexOp.wait( clients[i].mux );
+    }
+    MutexOp.post( clients[i].mux );
+    MutexOp.base.del( clients[i].mux );
+    answered += clients[i].answered;
+  }
+  freeMem( clients );
+
+  /* late responses and retransmissions */
+  tlast = MetricsOp.now();
+  while( MetricsOp.now() - tlast < 3000000UL ) {
+    ThreadOp.sleep( 100 );
+    if( __metricCount( "r2rnet_delivered_total" ) + __metricCount( "r2rnet_dropped_total" ) != settled ) {
+      settled = __metricCount( "r2rnet_delivered_total" ) + __metricCount( "r2rnet_dropped_total" );
+      tlast = MetricsOp.now();
+    }
+  }
+
+  R2RnetOp.quit( a );
+  R2RnetOp.quit( b );
+  R2RnetOp.quit( c );
+  TraceOp.setLevel( NULL, level );
+
+  /* each request and its response; a dropped request has no response */
+  delivered = __metricCount( "r2rnet_delivered_total" ) - delivered0;
+  dropped = __metricCount( "r2rnet_dropped_total" ) - dropped0;
+  expected = 4L * BenchOp.r2rrequests;
+  if( dropped == 0 ? delivered != expected:delivered > expected ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: %ld messages delivered, expected %ld with %ld dropped",
+        delivered, expected, dropped );
+    failures++;
+  }
+
+  NodeOp.setInt( result, "droprate", BenchOp.r2rdroprate );
+  NodeOp.setInt( result, "requests", 2 * BenchOp.r2rrequests );
+  NodeOp.setInt( result, "answered", answered );
+  NodeOp.setLong( result, "delivered", delivered );
+  NodeOp.setLong( result, "expected", expected );
+  NodeOp.setLong( result, "dropped", dropped );
+  NodeOp.setLong( result, "retransmits", __metricCount( "r2rnet_retransmits_total" ) - retransmits0 );
+  NodeOp.setLong( result, "duplicates", __metricCount( "r2rnet_duplicates_total" ) - duplicates0 );
+
+  /* the readers still wait on the group; the instances stay */
+  return failures;
+}
+
+
+/* A client merging the loco events as Rocview does; RCon decodes the binary frames to complete events. */
+struct LcClient {
+  iOMutex mux;
+  iORCon  rcon;
+  iOMap   state;
+  long    events;
+  int     incomplete;
+};
+
+/* Attributes of the merged state the event lacks or has otherwise. */
+static int __lcDiffers( iONode state, iONode evt ) {
+  int differs = 0;
+  int i = 0;
+  for( i = 0; i < NodeOp.getAttrCnt( state ); i++ ) {
+    iOAttr attr = NodeOp.getAttr( state, i );
+    if( !StrOp.equals( "delta", AttrOp.getName( attr ) ) &&
+        !StrOp.equals( AttrOp.getVal( attr ), NodeOp.getStr( evt, AttrOp.getName( attr ), NULL ) ) )
+      differs++;
+  }
+  return differs;
+}
+
+static void __lcClient( obj cargo, iONode node ) {
+  struct LcClient* c = (struct LcClient*)cargo;
+  const char* id = wLoc.getid( node );
+  iONode have = NULL;
+
+  if( !StrOp.equals( wLoc.name(), NodeOp.getName( node ) ) || !StrOp.startsWith( id, "lcbench" ) )
+    return;
+
+  MutexOp.wait( c->mux );
+  c->events++;
+  /* a delta event changes the attributes it holds, a full one replaces the state */
+  have = (iONode)MapOp.get( c->state, id );
+  if( have != NULL && wLoc.isdelta( node ) ) {
+    NodeOp.mergeNode( have, node, True, False, False );
+    if( __lcDiffers( have, node ) > 0 ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: decoded event of %s lacks %d attributes",
+          id, __lcDiffers( have, node ) );
+      c->incomplete++;
+    }
+  }
+  else {
+    if( have != NULL )
+      NodeOp.base.del( have );
+    MapOp.put( c->state, id, (obj)NodeOp.base.clone( node ) );
+  }
+  MutexOp.post( c->mux );
+}
+
+static void __lcSpeed( iOLoc loc, int v, Boolean dir ) {
+  iONode cmd = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
+  wLoc.setid( cmd, LocOp.getId( loc ) );
+  wLoc.setcmd( cmd, wLoc.velocity );
+  wLoc.setV( cmd, v );
+  wLoc.setdir( cmd, dir );
+  wLoc.setfn( cmd, False );
+  LocOp.cmd( loc, cmd );
+}
+
+/* Ramps in steps of two ticks, cruising, a stop and a direction change per loco every 200 ticks of lcbenchtick ms. */
+static int __lcPhase( struct LcClient* c, iOLoc* locos, Boolean* dirs, int window, Boolean delta, iONode result, const char* phase ) {
+  iONode ini = AppOp.getIniNode( wCtrl.name() );
+  int ticks = BenchOp.lcbenchseconds * 1000 / BenchOp.lcbenchtick;
+  unsigned long t0 = 0;
+  unsigned long tlast = 0;
+  long events = 0;
+  long broadcasts0 = __metricCount( "loc_broadcasts" );
+  long attrs0 = __metricCount( "loc_broadcast_attrs" );
+  long bytes0 = 0;
+  long events0 = 0;
+  int failures = 0;
+  int t = 0;
+  int i = 0;
+  char key[64];
+
+  wCtrl.setlcbroadcastwindow( ini, window );
+  wCtrl.setlcbroadcastdelta( ini, delta );
+
+  MutexOp.wait( c->mux );
+  events0 = c->events;
+  MutexOp.post( c->mux );
+  bytes0 = __metricCount( "clntcon_sent_bytes" );
+
+  t0 = MetricsOp.now();
+  for( t = 0; t < ticks; t++ ) {
+    for( i = 0; i < BenchOp.lcbenchlocos; i++ ) {
+      int p = ( t + i * 5 ) % 200;
+      if( p < 20 && p % 2 == 0 )
+        __lcSpeed( locos[i], p * 4, dirs[i] );
+      else if( p >= 100 && p < 120 && p % 2 == 0 )
+        __lcSpeed( locos[i], ( 120 - p ) * 4, dirs[i] );
+      else if( p == 120 )
+        __lcSpeed( locos[i], 0, dirs[i] );
+      else if( p == 150 ) {
+        dirs[i] = !dirs[i];
+        __lcSpeed( locos[i], 0, dirs[i] );
+      }
+    }
+    while( MetricsOp.now() - t0 < (unsigned long)( t + 1 ) * BenchOp.lcbenchtick * 1000UL )
+      ThreadOp.sleep( 1 );
+  }
+  for( i = 0; i < BenchOp.lcbenchlocos; i++ )
+    __lcSpeed( locos[i], 0, dirs[i] );
+
+  /* the writer of a client sends about 100 events a second; wait until it has caught up */
+  events = events0;
+  tlast = MetricsOp.now();
+  while( MetricsOp.now() - tlast < 1000000UL && MetricsOp.now() - t0 < 30000000UL ) {
+    ThreadOp.sleep( 100 );
+    MutexOp.wait( c->mux );
+    if( c->events != events ) {
+      events = c->events;
+      tlast = MetricsOp.now();
+    }
+    MutexOp.post( c->mux );
+  }
+
+  /* the last state of each loco must have reached the client */
+  MutexOp.wait( c->mux );
+  for( i = 0; i < BenchOp.lcbenchlocos; i++ ) {
+    iONode state = (iONode)MapOp.get( c->state, LocOp.getId( locos[i] ) );
+    if( state == NULL || wLoc.getV( state ) != 0 || wLoc.isdir( state ) != dirs[i] ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: %s: client has V=%d dir=%d for %s, expected V=0 dir=%d",
+          phase, state != NULL ? wLoc.getV( state ):-1, state != NULL ? wLoc.isdir( state ):-1, LocOp.getId( locos[i] ), dirs[i] );
+      failures++;
+    }
+  }
+  events -= events0;
+
+  StrOp.fmtb( key, "%s_events", phase );
+  NodeOp.setLong( result, key, events );
+  StrOp.fmtb( key, "%s_broadcasts", phase );
+  NodeOp.setLong( result, key, __metricCount( "loc_broadcasts" ) - broadcasts0 );
+  StrOp.fmtb( key, "%s_attrs", phase );
+  NodeOp.setLong( result, key, __metricCount( "loc_broadcast_attrs" ) - attrs0 );
+  StrOp.fmtb( key, "%s_bytes", phase );
+  NodeOp.setLong( result, key, __metricCount( "clntcon_sent_bytes" ) - bytes0 );
+  TraceOp.println( "bench: %-6s %5ld events %6ld attributes %7ld bytes to the client, drained after %ld ms",
+      phase, events, __metricCount( "loc_broadcast_attrs" ) - attrs0, __metricCount( "clntcon_sent_bytes" ) - bytes0,
+      (long)( ( MetricsOp.now() - t0 ) / 1000 ) );
+  MutexOp.post( c->mux );
+  return failures;
+}
+
+static int __lcBroadcast( iOBench inst, iOControl control, iONode result ) {
+  iOModel model = AppOp.getModel();
+  iONode ini = AppOp.getIniNode( wCtrl.name() );
+  int window = wCtrl.getlcbroadcastwindow( ini );
+  Boolean delta = wCtrl.islcbroadcastdelta( ini );
+  int port = wTcp.getport( wRocRail.gettcp( AppOp.getIni() ) );
+  iOLoc* locos = allocMem( BenchOp.lcbenchlocos * sizeof( iOLoc ) );
+  Boolean* dirs = allocMem( BenchOp.lcbenchlocos * sizeof( Boolean ) );
+  struct LcClient c;
+  iONode cmd = NULL;
+  iONode node = NULL;
+  char* str = NULL;
+  tracelevel level = 0;
+  int failures = 0;
+  int i = 0;
+
+  for( i = 0; i < BenchOp.lcbenchlocos; i++ ) {
+    iONode props = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
+    char id[32];
+    StrOp.fmtb( id, "lcbench%02d", i );
+    wLoc.setid( props, id );
+    wLoc.setaddr( props, 3000 + i );
+    wLoc.setshow( props, True );
+    ModelOp.addItem( model, props );
+    NodeOp.base.del( props );
+    locos[i] = ModelOp.getLoc( model, id, NULL, False );
+    dirs[i] = True;
+    if( locos[i] == NULL ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: loco %s not added", id );
+      freeMem( locos );
+      freeMem( dirs );
+      return -1;
+    }
+  }
+
+  MemOp.set( &c, 0, sizeof( struct LcClient ) );
+  c.mux = MutexOp.inst( NULL, True );
+  c.state = MapOp.inst();
+  c.rcon = RConOp.inst( "localhost", port );
+  if( c.rcon == NULL ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: no client connection on port %d", port );
+    freeMem( locos );
+    freeMem( dirs );
+    return -1;
+  }
+  RConOp.setCallback( c.rcon, &__lcClient, (obj)&c );
+  cmd = NodeOp.inst( wModelCmd.name(), NULL, ELEMENT_NODE );
+  wModelCmd.setcmd( cmd, wModelCmd.plan );
+  str = NodeOp.base.toString( cmd );
+  RConOp.write( c.rcon, str );
+  StrOp.free( str );
+  NodeOp.base.del( cmd );
+  ThreadOp.sleep( 1000 );
+
+  level = TraceOp.getLevel( NULL );
+  TraceOp.setLevel( NULL, level & ~( TRCLEVEL_INFO | TRCLEVEL_USER1 | TRCLEVEL_MONITOR ) );
+
+  failures += __lcPhase( &c, locos, dirs, 0, False, result, "direct" );
+  failures += __lcPhase( &c, locos, dirs, BenchOp.lcbenchwindow, False, result, "window" );
+  failures += __lcPhase( &c, locos, dirs, BenchOp.lcbenchwindow, True, result, "delta" );
+
+  TraceOp.setLevel( NULL, level );
+  wCtrl.setlcbroadcastwindow( ini, window );
+  wCtrl.setlcbroadcastdelta( ini, delta );
+
+  if( NodeOp.getLong( result, "window_events", 0 ) >= NodeOp.getLong( result, "direct_events", 0 ) ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: coalescing sent %ld events, without %ld",
+        NodeOp.getLong( result, "window_events", 0 ), NodeOp.getLong( result, "direct_events", 0 ) );
+    failures++;
+  }
+  /* binary frames are delta encoded anyway; the attributes are what an XML client gets */
+  if( NodeOp.getLong( result, "delta_attrs", 0 ) >= NodeOp.getLong( result, "window_attrs", 0 ) ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: delta events held %ld attributes, full ones %ld",
+        NodeOp.getLong( result, "delta_attrs", 0 ), NodeOp.getLong( result, "window_attrs", 0 ) );
+    failures++;
+  }
+  NodeOp.setInt( result, "locos", BenchOp.lcbenchlocos );
+  NodeOp.setInt( result, "window", BenchOp.lcbenchwindow );
+  NodeOp.setInt( result, "incomplete", c.incomplete );
+  failures += c.incomplete;
+
+  RConOp.close( c.rcon );
+  /* let the reader leave its loop before it is killed */
+  ThreadOp.sleep( 100 );
+  RConOp.base.del( c.rcon );
+  for( node = (iONode)MapOp.first( c.state ); node != NULL; node = (iONode)MapOp.next( c.state ) )
+    NodeOp.base.del( node );
+  MapOp.base.del( c.state );
+  MutexOp.base.del( c.mux );
+  freeMem( locos );
+  freeMem( dirs );
+  /* the bench locos stay in the plan */
+  return failures;
+}
+
+
+/* Runner cost of idle locos: process CPU over lcidleseconds. loc_runner_tick_us
+ * is observed once per 100 ms cycle, also with BBT, so it counts the same cycles. */
+static void __lcIdlePhase( iOLoc* locos, Boolean bbt, iONode result, const char* phase ) {
+  int id = __metricId( "loc_runner_tick_us" );
+  long ticks0 = 0;
+  long us0 = 0;
+  long cpu0 = 0;
+  long cpu = 0;
+  long ticks = 0;
+  long us = 0;
+  int i = 0;
+  char key[64];
+
+  for( i = 0; i < BenchOp.lcidlelocos; i++ ) {
+    iONode props = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
+    wLoc.setusebbt( props, bbt );
+    LocOp.modify( locos[i], props );
+  }
+  ThreadOp.sleep( 1000 );
+
+  ticks0 = id == -1 ? 0:MetricsOp.getValue( id, METRIC_VALUE );
+  us0 = id == -1 ? 0:MetricsOp.getValue( id, METRIC_SUM );
+  cpu0 = __cpuTime();
+  ThreadOp.sleep( BenchOp.lcidleseconds * 1000 );
+  cpu = __cpuTime() - cpu0;
+  ticks = ( id == -1 ? 0:MetricsOp.getValue( id, METRIC_VALUE ) ) - ticks0;
+  us = ( id == -1 ? 0:MetricsOp.getValue( id, METRIC_SUM ) ) - us0;
+
+  StrOp.fmtb( key, "%s_cpu", phase );
+  NodeOp.setLong( result, key, cpu );
+  StrOp.fmtb( key, "%s_ticks", phase );
+  NodeOp.setLong( result, key, ticks );
+  StrOp.fmtb( key, "%s_tick_us", phase );
+  NodeOp.setLong( result, key, ticks > 0 ? us / ticks:0 );
+  TraceOp.println( "bench: %-7s %ld ms CPU in %d s, %ld 100 ms cycles of %ld us",
+      phase, cpu, BenchOp.lcidleseconds, ticks, ticks > 0 ? us / ticks:0 );
+}
+
+static int __lcIdle( iOBench inst, iOControl control, iONode result ) {
+  iOModel model = AppOp.getModel();
+  iOLoc* locos = allocMem( BenchOp.lcidlelocos * sizeof( iOLoc ) );
+  tracelevel level = 0;
+  int i = 0;
+
+  for( i = 0; i < BenchOp.lcidlelocos; i++ ) {
+    iONode props = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
+    char id[32];
+    StrOp.fmtb( id, "lcidle%03d", i );
+    wLoc.setid( props, id );
+    wLoc.setaddr( props, 4000 + i );
+    wLoc.setshow( props, True );
+    ModelOp.addItem( model, props );
+    NodeOp.base.del( props );
+    locos[i] = ModelOp.getLoc( model, id, NULL, False );
+    if( locos[i] == NULL ) {
+      TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: loco %s not added", id );
+      freeMem( locos );
+      return -1;
+    }
+  }
+
+  level = TraceOp.getLevel( NULL );
+  TraceOp.setLevel( NULL, level & ~( TRCLEVEL_INFO | TRCLEVEL_USER1 | TRCLEVEL_MONITOR ) );
+  /* 100 ms cycles, then the 10 ms cycles of BBT */
+  __lcIdlePhase( locos, False, result, "runner" );
+  __lcIdlePhase( locos, True, result, "bbt" );
+  __lcIdlePhase( locos, False, result, "reset" );
+  TraceOp.setLevel( NULL, level );
+
+  NodeOp.setInt( result, "locos", BenchOp.lcidlelocos );
+  NodeOp.setInt( result, "seconds", BenchOp.lcidleseconds );
+  freeMem( locos );
+  /* the bench locos stay in the plan */
+  return 0;
+}
+
+
+/* Same name, attributes and values. */
+static Boolean __codecSame( iONode a, iONode b ) {
+  int i = 0;
+  if( b == NULL || !StrOp.equals( NodeOp.getName( a ), NodeOp.getName( b ) ) ||
+      NodeOp.getAttrCnt( a ) != NodeOp.getAttrCnt( b ) )
+    return False;
+  for( i = 0; i < NodeOp.getAttrCnt( a ); i++ ) {
+    iOAttr attr = NodeOp.getAttr( a, i );
+    if( !StrOp.equals( AttrOp.getVal( attr ), NodeOp.getStr( b, AttrOp.getName( attr ), NULL ) ) )
+      return False;
+  }
+  return True;
+}
+
+/* Broadcast events: loco ticks, sensor flips and function toggles with the attributes the server sends. */
+static iONode __codecEvent( unsigned long* seed, int* V, Boolean* dir, long* runtime, Boolean* fb, int* fx ) {
+  int r = __random( seed ) % 100;
+  iONode evt = NULL;
+  char id[32];
+
+  if( r < 60 ) {
+    int k = __random( seed ) % BenchOp.codeclocos;
+    V[k] = ( V[k] + 1 + __random( seed ) % 5 ) % 101;
+    if( __random( seed ) % 20 == 0 )
+      dir[k] = !dir[k];
+    runtime[k] += __random( seed ) % 2;
+    StrOp.fmtb( id, "codec%02d", k );
+    evt = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
+    wLoc.setid( evt, id );
+    wLoc.setdir( evt, dir[k] );
+    wLoc.setaddr( evt, 100 + k );
+    wLoc.setV( evt, V[k] );
+    wLoc.setplacing( evt, True );
+    wLoc.setmode( evt, wLoc.mode_auto );
+    wLoc.setmanual( evt, False );
+    wLoc.setdestblockid( evt, "bk12" );
+    wLoc.setblockid( evt, "bk11" );
+    wLoc.setfn( evt, fx[k] & 1 );
+    wLoc.setruntime( evt, runtime[k] );
+    wLoc.setthrottleid( evt, "" );
+    wLoc.setactive( evt, True );
+    wLoc.setV_realkmh( evt, V[k] * 2 );
+  }
+  else if( r < 85 ) {
+    int k = __random( seed ) % BenchOp.codecsensors;
+    fb[k] = !fb[k];
+    StrOp.fmtb( id, "codecfb%02d", k );
+    evt = NodeOp.inst( wFeedback.name(), NULL, ELEMENT_NODE );
+    wFeedback.setid( evt, id );
+    wFeedback.setbus( evt, 0 );
+    wFeedback.setaddr( evt, k + 1 );
+    wFeedback.setstate( evt, fb[k] );
+    wFeedback.setidentifier( evt, "" );
+  }
+  else {
+    int k = __random( seed ) % BenchOp.codeclocos;
+    int f = __random( seed ) % 8;
+    int i = 0;
+    fx[k] ^= 1 << f;
+    StrOp.fmtb( id, "codec%02d", k );
+    evt = NodeOp.inst( wFunCmd.name(), NULL, ELEMENT_NODE );
+    wFunCmd.setid( evt, id );
+    wFunCmd.setaddr( evt, 100 + k );
+    wFunCmd.setfnchanged( evt, f );
+    wFunCmd.setgroup( evt, f / 4 + 1 );
+    for( i = 0; i < 8; i++ ) {
+      char fname[8];
+      StrOp.fmtb( fname, "f%d", i );
+      NodeOp.setBool( evt, fname, fx[k] & ( 1 << i ) ? True:False );
+    }
+  }
+  return evt;
+}
+
+static int __evtCodec( iOBench inst, iOControl control, iONode result ) {
+  iOEvtCodec enc = EvtCodecOp.inst();
+  iOEvtCodec dec = EvtCodecOp.inst();
+  iOEvtCodec full = EvtCodecOp.inst();
+  int* V = allocMem( BenchOp.codeclocos * sizeof( int ) );
+  Boolean* dir = allocMem( BenchOp.codeclocos * sizeof( Boolean ) );
+  long* runtime = allocMem( BenchOp.codeclocos * sizeof( long ) );
+  int* fx = allocMem( BenchOp.codeclocos * sizeof( int ) );
+  Boolean* fb = allocMem( BenchOp.codecsensors * sizeof( Boolean ) );
+  unsigned long seed = 4711;
+  unsigned long usXml = 0;
+  unsigned long usParse = 0;
+  unsigned long usEncode = 0;
+  unsigned long usDecode = 0;
+  long xmlBytes = 0;
+  long binBytes = 0;
+  long fullBytes = 0;
+  long deltas = 0;
+  int mismatches = 0;
+  int i = 0;
+
+  for( i = 0; i < BenchOp.codecevents; i++ ) {
+    iONode evt = __codecEvent( &seed, V, dir, runtime, fb, fx );
+    iONode decoded = NULL;
+    iODoc doc = NULL;
+    byte* frame = NULL;
+    char* xml = NULL;
+    int size = 0;
+    unsigned long t0 = MetricsOp.now();
+
+    xml = NodeOp.base.toString( evt );
+    usXml += MetricsOp.now() - t0;
+    xmlBytes += StrOp.len( xml );
+    t0 = MetricsOp.now();
+    doc = DocOp.parse( xml );
+    usParse += MetricsOp.now() - t0;
+    if( doc != NULL ) {
+      /* the root node outlives its document */
+      iONode root = DocOp.getRootNode( doc );
+      DocOp.base.del( doc );
+      if( root != NULL )
+        NodeOp.base.del( root );
+    }
+    StrOp.free( xml );
+
+    t0 = MetricsOp.now();
+    frame = EvtCodecOp.encode( enc, evt, True, &size );
+    usEncode += MetricsOp.now() - t0;
+    if( frame != NULL ) {
+      binBytes += size;
+      if( EvtCodecOp.isDelta( frame ) )
+        deltas++;
+      t0 = MetricsOp.now();
+      decoded = EvtCodecOp.decode( dec, frame, size );
+      usDecode += MetricsOp.now() - t0;
+      freeMem( frame );
+    }
+    if( !__codecSame( evt, decoded ) ) {
+      if( mismatches == 0 ) {
+        char* have = decoded != NULL ? NodeOp.base.toString( decoded ):StrOp.dup( "-" );
+        xml = NodeOp.base.toString( evt );
+        TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: event %d decoded as %s, sent %s", i, have, xml );
+        StrOp.free( have );
+        StrOp.free( xml );
+      }
+      mismatches++;
+    }
+    if( decoded != NULL )
+      NodeOp.base.del( decoded );
+
+    frame = EvtCodecOp.encode( full, evt, False, &size );
+    if( frame != NULL ) {
+      fullBytes += size;
+      freeMem( frame );
+    }
+    NodeOp.base.del( evt );
+  }
+
+  NodeOp.setInt( result, "events", BenchOp.codecevents );
+  NodeOp.setInt( result, "mismatches", mismatches );
+  NodeOp.setLong( result, "xml_bytes", xmlBytes / BenchOp.codecevents );
+  NodeOp.setLong( result, "bin_bytes", binBytes / BenchOp.codecevents );
+  NodeOp.setLong( result, "full_bytes", fullBytes / BenchOp.codecevents );
+  NodeOp.setLong( result, "deltas", deltas );
+  NodeOp.setLong( result, "xml_ns", (long)( usXml * 1000 / BenchOp.codecevents ) );
+  NodeOp.setLong( result, "parse_ns", (long)( usParse * 1000 / BenchOp.codecevents ) );
+  NodeOp.setLong( result, "encode_ns", (long)( usEncode * 1000 / BenchOp.codecevents ) );
+  NodeOp.setLong( result, "decode_ns", (long)( usDecode * 1000 / BenchOp.codecevents ) );
+  TraceOp.println( "bench: xml  %ld bytes/event, toString %lu ns, parse %lu ns",
+      xmlBytes / BenchOp.codecevents, usXml * 1000 / BenchOp.codecevents, usParse * 1000 / BenchOp.codecevents );
+  TraceOp.println( "bench: bin1 %ld bytes/event (%ld full), encode %lu ns, decode %lu ns, %ld deltas",
+      binBytes / BenchOp.codecevents, fullBytes / BenchOp.codecevents,
+      usEncode * 1000 / BenchOp.codecevents, usDecode * 1000 / BenchOp.codecevents, deltas );
+
+  EvtCodecOp.base.del( enc );
+  EvtCodecOp.base.del( dec );
+  EvtCodecOp.base.del( full );
+  freeMem( V );
+  freeMem( dir );
+  freeMem( runtime );
+  freeMem( fx );
+  freeMem( fb );
+  return mismatches;
+}
+
+
+/* Sets the model clock like a client does; the callback deletes the node. */
+static void __clockSet( iOControl control, int divider, long t ) {
+  clntcon_callback pfun = ControlOp.getCallback( control );
+  iONode clock = NodeOp.inst( wClock.name(), NULL, ELEMENT_NODE );
+  wClock.setcmd( clock, wClock.set );
+  wClock.setdivider( clock, divider );
+  wClock.settime( clock, t );
+  pfun( (obj)control, clock );
+}
+
+static void __clockAction( iOModel model, const char* id, const char* oid, Boolean timed, int minute, int sec ) {
+  iONode props = NodeOp.inst( wAction.name(), NULL, ELEMENT_NODE );
+  wAction.setid( props, id );
+  wAction.settype( props, wVariable.name() );
+  wAction.setoid( props, oid );
+  wAction.setcmd( props, wVariable.op_add );
+  wAction.setparam( props, "1" );
+  wAction.settimed( props, timed );
+  wAction.sethour( props, 10 + minute / 60 );
+  wAction.setmin( props, minute % 60 );
+  wAction.setsec( props, sec );
+  ModelOp.addItem( model, props );
+  NodeOp.base.del( props );
+}
+
+static void __clockVariable( iOModel model, const char* id, Boolean timer ) {
+  iONode props = NodeOp.inst( wVariable.name(), NULL, ELEMENT_NODE );
+  wVariable.setid( props, id );
+  wVariable.settimer( props, timer );
+  ModelOp.addItem( model, props );
+  NodeOp.base.del( props );
+}
+
+static void __clockRemove( iOModel model, const char* type, const char* id ) {
+  iONode props = NodeOp.inst( type, NULL, ELEMENT_NODE );
+  wItem.setid( props, id );
+  ModelOp.removeItem( model, props );
+  NodeOp.base.del( props );
+}
+
+/* Runs of the counting action id; -1 if its variable is gone. */
+static int __clockRuns( iOModel model, const char* id ) {
+  iONode var = ModelOp.getVariable( model, id );
+  return var != NULL ? wVariable.getvalue( var ):-1;
+}
+
+/* Model seconds after the start: an action can run from its time on and must have run once its
+ * time is over, give or take 2 s of parking the clock. It never runs twice. */
+static int __clockCheck( int runs, int from, int due, int elapsed, const char* id ) {
+  if( runs > 1 || ( runs == 0 && due <= elapsed - 2 ) || ( runs == 1 && from > elapsed + 2 ) ) {
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "bench: action %s due at %d s ran %d times in %d s", id, due, runs, elapsed );
+    return 1;
+  }
+  return 0;
+}
+
+static int __clockPhase( iOControl control, Boolean timer60, long t0, iONode result, const char* phase ) {
+  iOModel model = AppOp.getModel();
+  iONode ctrl = wRocRail.getctrl( AppOp.getIni() );
+  int id = __metricId( "clock_actions_us" );
+  long ticks0 = 0;
+  long us0 = 0;
+  long ticks = 0;
+  long us = 0;
+  int elapsed = 0;
+  int fired = 0;
+  int failures = 0;
+  int i = 0;
+  char key[64];
+  char vid[32];
+
+  for( i = 0; i < BenchOp.clockactions; i++ ) {
+    StrOp.fmtb( vid, "clockfix%03d", i );
+    wVariable.setvalue( ModelOp.getVariable( model, vid ), 0 );
+  }
+  for( i = 0; i < BenchOp.clocksystem; i++ ) {
+    StrOp.fmtb( vid, "clocksys%d", i );
+    wVariable.setvalue( ModelOp.getVariable( model, vid ), 0 );
+  }
+  wVariable.setvalue( ModelOp.getVariable( model, "clockrandom" ), 0 );
+
+  wCtrl.setactiontimer60( ctrl, timer60 );
+  __clockSet( control, BenchOp.clockdivider, t0 );
+  ThreadOp.sleep( 100 );
+
+  ticks0 = id == -1 ? 0:MetricsOp.getValue( id, METRIC_VALUE );
+  us0 = id == -1 ? 0:MetricsOp.getValue( id, METRIC_SUM );
+  ThreadOp.sleep( BenchOp.clockseconds * 1000 );
+  ticks = ( id == -1 ? 0:MetricsOp.getValue( id, METRIC_VALUE ) ) - ticks0;
+  us = ( id == -1 ? 0:MetricsOp.getValue( id, METRIC_SUM ) ) - us0;
+
+  /* park the clock before the first action; a frozen clock would repeat its second */
+  elapsed = (int)( ControlOp.getTime( control ) - t0 );
+  __clockSet( control, BenchOp.clockdivider, t0 - 3600 );
+  ThreadOp.sleep( 100 );
+
+  for( i = 0; i < BenchOp.clockactions; i++ ) {
+    int minute = 1 + i % BenchOp.clockminutes;
+    int runs = 0;
+    StrOp.fmtb( vid, "clockfix%03d", i );
+    runs = __clockRuns( model, vid );
+    fired += runs;
+    /* minute ticks visit each minute once, at some second of it */
+    if( timer60 )
+      failures += __clockCheck( runs, minute * 60, minute * 60 + 60, elapsed, vid );
+    else
+      failures += __clockCheck( runs, minute * 60 + ( i * 7 ) % 60, minute * 60 + ( i * 7 ) % 60, elapsed, vid );
+  }
+  for( i = 0; i < BenchOp.clocksystem; i++ ) {
+    int minute = 3 * i + 3;
+    int runs = 0;
+    StrOp.fmtb( vid, "clocksys%d", i );
+    runs = __clockRuns( model, vid );
+    fired += runs;
+    /* system action controls only run on minute ticks */
+    if( timer60 )
+      failures += __clockCheck( runs, minute * 60, minute * 60 + 60, elapsed, vid );
+    else
+      failures += __clockCheck( runs, 86400, 86400, elapsed, vid );
+  }
+
+  StrOp.fmtb( key, "%s_ticks", phase );
+  NodeOp.setLong( result, key, ticks );
+  StrOp.fmtb( key, "%s_tick_us", phase );
+  NodeOp.setLong( result, key, ticks > 0 ? us / ticks:0 );
+  StrOp.fmtb( key, "%s_model_s", phase );
+  NodeOp.setInt( result, key, elapsed );
+  StrOp.fmtb( key, "%s_fired", phase );
+  NodeOp.setInt( result, key, fired );
+  StrOp.fmtb( key, "%s_random", phase );
+  NodeOp.setInt( result, key, __clockRuns( model, "clockrandom" ) );
+  TraceOp.println( "bench: %-6s %ld ticks of %ld us over %d model s, %d timed and %d random actions run",
+      phase, ticks, ticks > 0 ? us / ticks:0, elapsed, fired, __clockRuns( model, "clockrandom" ) );
+  return failures;
+}
+
+/* Timed actions on a fast model clock: clockactions fixed time actions each count their runs in
+ * a variable of their own, beside as many actions without a time, random actions, running timers
+ * and system action controls with a time. Per second and per minute ticks are measured. */
+static int __clockActions( iOBench inst, iOControl control, iONode result ) {
+  iOModel model = AppOp.getModel();
+  iONode plan = ModelOp.getModel( model );
+  iONode ini = AppOp.getIni();
+  iONode ctrl = wRocRail.getctrl( ini );
+  iONode clockini = wRocRail.getclock( ini );
+  iONode system = NULL;
+  iONode sysprops = NULL;
+  Boolean timer60 = wCtrl.isactiontimer60( ctrl );
+  int divider = clockini != NULL ? wClock.getdivider( clockini ):1;
+  tracelevel level = 0;
+  struct tm start;
+  time_t now = time( NULL );
+  long t0 = 0;
+  int failures = 0;
+  int i = 0;
+  char id[32];
+
+  start = *localtime( &now );
+  start.tm_hour = 10;
+  start.tm_min  = 0;
+  start.tm_sec  = 0;
+  t0 = (long)mktime( &start );
+
+  level = TraceOp.getLevel( NULL );
+  TraceOp.setLevel( NULL, level & ~( TRCLEVEL_INFO | TRCLEVEL_USER1 | TRCLEVEL_MONITOR | TRCLEVEL_CALC ) );
+
+  __clockVariable( model, "clockrandom", False );
+  for( i = 0; i < BenchOp.clockactions; i++ ) {
+    StrOp.fmtb( id, "clockfix%03d", i );
+    __clockVariable( model, id, False );
+    __clockAction( model, id, id, True, 1 + i % BenchOp.clockminutes, ( i * 7 ) % 60 );
+    StrOp.fmtb( id, "clockidle%03d", i );
+    __clockAction( model, id, "clockidle", False, 0, 0 );
+  }
+  for( i = 0; i < BenchOp.clockrandom; i++ ) {
+    iONode props = NodeOp.inst( wAction.name(), NULL, ELEMENT_NODE );
+    StrOp.fmtb( id, "clockrnd%d", i );
+    wAction.setid( props, id );
+    wAction.settype( props, wVariable.name() );
+    wAction.setoid( props, "clockrandom" );
+    wAction.setcmd( props, wVariable.op_add );
+    wAction.setparam( props, "1" );
+    wAction.settimed( props, True );
+    wAction.setrandom( props, True );
+    wAction.setsec( props, 30 );
+    ModelOp.addItem( model, props );
+    NodeOp.base.del( props );
+  }
+  for( i = 0; i < BenchOp.clocktimers; i++ ) {
+    StrOp.fmtb( id, "clocktimer%d", i );
+    __clockVariable( model, id, True );
+  }
+
+  /* system action controls with a time; the plan's own are restored at the end */
+  system = wPlan.getsystem( plan );
+  if( system != NULL )
+    system = (iONode)NodeOp.base.clone( system );
+  sysprops = system != NULL ? (iONode)NodeOp.base.clone( system ):NodeOp.inst( wSystemActions.name(), NULL, ELEMENT_NODE );
+  for( i = 0; i < BenchOp.clocksystem; i++ ) {
+    iONode actionctrl = NodeOp.inst( wActionCtrl.name(), sysprops, ELEMENT_NODE );
+    char state[8];
+    StrOp.fmtb( id, "clocksys%d", i );
+    __clockVariable( model, id, False );
+    __clockAction( model, id, id, False, 0, 0 );
+    StrOp.fmtb( state, "10:%02d", 3 * i + 3 );
+    wActionCtrl.setid( actionctrl, id );
+    wActionCtrl.setstate( actionctrl, state );
+    NodeOp.addChild( sysprops, actionctrl );
+  }
+  ModelOp.modifyItem( model, sysprops );
+  NodeOp.base.del( sysprops );
+
+  failures += __clockPhase( control, False, t0, result, "second" );
+  failures += __clockPhase( control, True, t0, result, "minute" );
+
+  /* back to the plan and clock of before */
+  wCtrl.setactiontimer60( ctrl, timer60 );
+  __clockSet( control, divider > 0 ? divider:1, (long)time( NULL ) );
+  if( system == NULL )
+    system = NodeOp.inst( wSystemActions.name(), NULL, ELEMENT_NODE );
+  ModelOp.modifyItem( model, system );
+  NodeOp.base.del( system );
+  for( i = 0; i < BenchOp.clockactions; i++ ) {
+    StrOp.fmtb( id, "clockfix%03d", i );
+    __clockRemove( model, wAction.name(), id );
+    __clockRemove( model, wVariable.name(), id );
+    StrOp.fmtb( id, "clockidle%03d", i );
+    __clockRemove( model, wAction.name(), id );
+  }
+  for( i = 0; i < BenchOp.clockrandom; i++ ) {
+    StrOp.fmtb( id, "clockrnd%d", i );
+    __clockRemove( model, wAction.name(), id );
+  }
+  for( i = 0; i < BenchOp.clocktimers; i++ ) {
+    StrOp.fmtb( id, "clocktimer%d", i );
+    __clockRemove( model, wVariable.name(), id );
+  }
+  for( i = 0; i < BenchOp.clocksystem; i++ ) {
+    StrOp.fmtb( id, "clocksys%d", i );
+    __clockRemove( model, wAction.name(), id );
+    __clockRemove( model, wVariable.name(), id );
+  }
+  __clockRemove( model, wVariable.name(), "clockrandom" );
+  TraceOp.setLevel( NULL, level );
+
+  NodeOp.setInt( result, "actions", BenchOp.clockactions );
+  NodeOp.setInt( result, "divider", BenchOp.clockdivider );
+  NodeOp.setInt( result, "seconds", BenchOp.clockseconds );
+  return failures;
+}
+
+
+typedef int (*bench_scenario)( iOBench inst, iOControl control, iONode result );
+
+static struct {
+  const char*    name;
+  bench_scenario run;
+} __scenarios[] = {
+  { "fbdispatch", &__fbDispatch },
+  { "actions", &__actions },
+  { "throat", &__throat },
+  { "fbburst", &__fbBurst },
+  { "planresume", &__planResume },
+  { "reconnect", &__reconnect },
+  { "metrics", &__metrics },
+  { "udpflood", &__udpFlood },
+  { "r2rloss", &__r2rLoss },
+  { "lcbroadcast", &__lcBroadcast },
+  { "lcidle", &__lcIdle },
+  { "evtcodec", &__evtCodec },
+  { "clockactions", &__clockActions },
+#if defined __linux__
+  { "httpload", &__httpLoad },
+  { "srcpload", &__srcpLoad },
+#endif
+#if !defined _WIN32
+  { "lnslots", &__lnSlots },
+  { "nmraencode", &__nmraEncode },
+  { "ddxrefresh", &__ddxRefresh },
+#endif
+  { NULL, NULL }
+};
+
+
+static int _scenario( iOBench inst, iOControl control, const char* scenario, const char* outfile, const char* baseline, int tolerance ) {
+  bench_scenario run = NULL;
+  iONode result = NULL;
+  unsigned long t0 = 0;
+  long cpu0 = 0;
+  int failures = 0;
+  int rc = 0;
+  int i = 0;
+
+  for( i = 0; __scenarios[i].name != NULL; i++ ) {
+    if( StrOp.equals( scenario, __scenarios[i].name ) )
+      run = __scenarios[i].run;
+  }
+  if( run == NULL ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "bench: unknown scenario [%s]", scenario );
+    for( i = 0; __scenarios[i].name != NULL; i++ )
+      TraceOp.println( "scenario: %s", __scenarios[i].name );
+    return -1;
+  }
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "bench: scenario [%s]", scenario );
+  __settle();
+
+  result = NodeOp.inst( "bench", NULL, ELEMENT_NODE );
+  NodeOp.setStr( result, "scenario", scenario );
+  cpu0 = __cpuTime();
+  t0 = MetricsOp.now();
+
+  failures = run( inst, control, result );
+  if( failures < 0 ) {
+    NodeOp.base.del( result );
+    return -1;
+  }
+
+  NodeOp.setLong( result, "wall", (long)( ( MetricsOp.now() - t0 ) / 1000 ) );
+  NodeOp.setLong( result, "cpu", __cpuTime() - cpu0 );
+  NodeOp.setLong( result, "rss", __maxRSS() );
+  NodeOp.setInt( result, "failures", failures );
+
+  rc = __report( inst, result, outfile, baseline, tolerance );
+  if( rc == 0 && failures > 0 ) {
+    TraceOp.println( "bench: scenario [%s] failed %d time(s)", scenario, failures );
+    rc = 1;
+  }
+  return rc;
+}
+
+
+static struct OBench* _inst( const char* script, int speed ) {
+  iOBench __Bench = allocMem( sizeof( struct OBench ) );
+  iOBenchData data = allocMem( sizeof( struct OBenchData ) );
+  MemOp.basecpy( __Bench, &BenchOp, 0, sizeof( struct OBench ), data );
+
+  /* Initialize data->xxx members... */
+  data->script = StrOp.dup( script );
+  data->speed  = speed < 0 ? 0:speed;
+
+  instCnt++;
+  return __Bench;
+}
+
+
+
+
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
+#include "rocrail/impl/bench.fm"
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
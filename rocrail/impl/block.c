@@ -41,6 +41,8 @@
 #include "rocs/public/str.h"
 #include "rocs/public/strtok.h"
 #include "rocs/public/system.h"
+#include "rocs/public/span.h"
+#include "rocs/public/rcumap.h"
 
 #include "rocrail/wrapper/public/Block.h"
 #include "rocrail/wrapper/public/Signal.h"
@@ -59,10 +61,48 @@
 
 
 static int instCnt = 0;
+static int __sBlock = -1;
 
 static Boolean __isElectricallyFree(iOBlock inst);
 static void __dumpFiFo(iIBlockBase inst);
 
+/* Sensor, block and route ids interned to small integers for the fbevent dispatch;
+   lookups are wait-free, new atoms are added under the mutex. */
+static iORcuMap __atoms = NULL;
+static iOMutex  __atomMux = NULL;
+static int     __atomCnt = 0;
+static int     __atomAll = 0;
+static int     __atomAllReverse = 0;
+
+/* Only the reader epoch of this map is used: sensor threads scan a dispatch
+   table in a read section, a replaced table is freed after synchronize. */
+static iORcuMap __fbEpoch = NULL;
+
+/* Atom of id; unknown ids are added or return -1, which matches no entry. */
+static int __atom( const char* id, Boolean add ) {
+  int atom = 0;
+
+  if( __atomMux == NULL ) {
+    __atomMux = MutexOp.inst( NULL, True );
+    __atoms = RcuMapOp.inst();
+  }
+  if( id == NULL )
+    id = "";
+
+  atom = (int)(long)RcuMapOp.get( __atoms, id );
+  if( atom == 0 && add ) {
+    MutexOp.wait( __atomMux );
+    atom = (int)(long)RcuMapOp.get( __atoms, id );
+    if( atom == 0 ) {
+      atom = ++__atomCnt;
+      RcuMapOp.put( __atoms, id, (obj)(long)atom );
+    }
+    MutexOp.post( __atomMux );
+  }
+
+  return atom == 0 ? -1:atom;
+}
+
 
 /*
  ***** OBase functions.
@@ -111,6 +151,10 @@ static char* __toString(void* inst) {
 }
 static void __del(void* inst) {
   iOBlockData data = Data(inst);
+  if( data->fbTable != NULL ) {
+    RcuMapOp.synchronize( __fbEpoch );
+    freeMem( data->fbTable );
+  }
   freeMem( data );
   freeMem( inst );
   instCnt--;
@@ -401,6 +445,88 @@ static void _setGhostDetected(iIBlockBase inst, const char* key, const char* ide
 }
 
 
+/**
+ * Scan the dispatch table once for the sensor; called in a read section.
+ * An entry for the current route and from block ranks before one for the from block only.
+ * The entry for all or all-reverse, depending on the block side, is returned in evtAll.
+ * The last matching entry of each kind wins.
+ */
+static iONode __matchFbEvent( iOBlockData data, int fb, Boolean puls, int all, int from, int route, iONode* evtAll ) {
+  iONode evtRoute = NULL;
+  iONode evtFrom  = NULL;
+  iOFbDispatch d  = data->fbTable;
+
+  *evtAll = NULL;
+  while( d != NULL && d->evt != NULL && fb != -1 ) {
+    if( d->fb == fb && d->endpuls != puls ) {
+      if( d->route != 0 ) {
+        if( d->route == route && d->from == from )
+          evtRoute = d->evt;
+      }
+      else {
+        if( d->from == from )
+          evtFrom = d->evt;
+        if( d->from == all )
+          *evtAll = d->evt;
+      }
+    }
+    d++;
+  }
+  return evtRoute != NULL ? evtRoute:evtFrom;
+}
+
+
+/**
+ * The fbevent for the sensor, or in evtAll the one for all if there is no other.
+ * Returns copies made in the read section, because a modify frees the table nodes
+ * after it; the caller deletes them.
+ */
+static iONode __findFbEvent( iOBlockData data, const char* id, Boolean puls, Boolean blockSide,
+                             const char* fromBlockId, const char* byRouteId, iONode* evtAll ) {
+  Boolean byroute = byRouteId != NULL && StrOp.len(byRouteId) > 0;
+  iONode evt = NULL;
+  iONode any = NULL;
+  int token = 0;
+
+  *evtAll = NULL;
+  if( __fbEpoch == NULL )
+    return NULL;
+
+  token = RcuMapOp.enter( __fbEpoch );
+  evt = __matchFbEvent( data, __atom( id, False ), puls, blockSide ? __atomAll:__atomAllReverse,
+                        __atom( fromBlockId, False ), byroute ? __atom( byRouteId, False ):-1, &any );
+  if( evt != NULL )
+    evt = (iONode)NodeOp.base.clone( evt );
+  else if( any != NULL )
+    *evtAll = (iONode)NodeOp.base.clone( any );
+  RcuMapOp.leave( __fbEpoch, token );
+
+  return evt;
+}
+
+
+static iONode _getFbEvent( iOBlock inst, const char* fbid, Boolean puls, Boolean blockSide, const char* from, const char* route, Boolean all ) {
+  iOBlockData data = Data(inst);
+  Boolean byroute = route != NULL && StrOp.len(route) > 0;
+  iONode evt = NULL;
+  iONode any = NULL;
+  int token = 0;
+
+  if( __fbEpoch == NULL )
+    return NULL;
+
+  token = RcuMapOp.enter( __fbEpoch );
+  evt = __matchFbEvent( data, __atom( fbid, False ), puls, blockSide ? __atomAll:__atomAllReverse,
+                        __atom( from, False ), byroute ? __atom( route, False ):-1, &any );
+  evt = all ? any:evt;
+  if( evt != NULL )
+    evt = (iONode)NodeOp.base.clone( evt );
+  RcuMapOp.leave( __fbEpoch, token );
+
+  return evt;
+}
+
+
 /**
  * event listener callback for all fbevents
  */
@@ -413,46 +539,51 @@ static Boolean _event( iIBlockBase inst, Boolean puls, const char* id, const cha
   Boolean convertEnter2In = False;
   /* The use blockside option works only with one way type, so both directions will fail. */
   char    key[256] = {'\0'};
+  /* copies of the dispatch table */
+  iONode ownEvt = NULL;
+  iONode ownAll = NULL;
+  const char* evtid = NULL;
 
   if( StrOp.equals( wBlock.closed, wBlock.getstate( data->props ) ) && wBlock.issleeponclosed( data->props ) ) {
     TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "ignore event in sleep on closed block %s", data->id );
     return 0;
   }
 
-  if( fbevt == NULL && data->byRouteId != NULL && StrOp.len(data->byRouteId) > 0 ) {
-    iORoute byRoute = ModelOp.getRoute( AppOp.getModel(), data->byRouteId );
-    blockSide = RouteOp.getToBlockSide(byRoute);
-
-    StrOp.fmtb( key, "%s%s-%s-%s", id, puls?"":"-ep", data->fromBlockId != NULL ? data->fromBlockId:"", data->byRouteId );
-    fbevt = (iONode)MapOp.get( data->fbEvents, key );
-    TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "%sfbevent found by key %s", fbevt != NULL ? "":"no ", key);
-  }
+  StrOp.fmtb( key, "%s%s", id, puls?"":"-ep" );
 
   if( fbevt == NULL ) {
-    StrOp.fmtb( key, "%s%s-%s", id, puls?"":"-ep", data->fromBlockId != NULL ? data->fromBlockId:"" );
-    /* event without description; look up in map */
-    fbevt = (iONode)MapOp.get( data->fbEvents, key );
-    TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "%sfbevent found by key %s", fbevt != NULL ? "":"no ", key);
-  }
+    Boolean byroute = data->byRouteId != NULL && StrOp.len(data->byRouteId) > 0;
+    iONode evtAll = NULL;
 
+    if( byroute ) {
+      iORoute byRoute = ModelOp.getRoute( AppOp.getModel(), data->byRouteId );
+      blockSide = RouteOp.getToBlockSide(byRoute);
+    }
 
-  if( fbevt == NULL ) {
-    /* event without description; look up in map */
-    if( ident != NULL && StrOp.len(ident) > 0 )
-      TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "%s reports ident = %s", id, ident!=NULL?ident:"-");
-    fbevt = ModPlanOp.getEvent4Block( NULL, NULL , data->props, data->fromBlockId, id);
-  }
+    fbevt = __findFbEvent( data, id, puls, blockSide, data->fromBlockId, data->byRouteId, &evtAll );
+    ownEvt = fbevt;
+    ownAll = evtAll;
+    TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "%sfbevent found for %s from %s by route %s",
+        fbevt != NULL ? "":"no ", key, data->fromBlockId != NULL ? data->fromBlockId:"", byroute ? data->byRouteId:"-" );
 
-  if( fbevt == NULL ) {
-    if ( blockSide )
-      StrOp.fmtb( key, "%s%s-%s", id, puls?"":"-ep", wFeedbackEvent.from_all );
-    else
-      StrOp.fmtb( key, "%s%s-%s", id, puls?"":"-ep", wFeedbackEvent.from_all_reverse );
-    TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "Block [%s] no event found for fromBlockId [%s], try to find one for all with key [%s]...",
-        data->id, data->fromBlockId?data->fromBlockId:"?", key );
-    fbevt = (iONode)MapOp.get( data->fbEvents, key );
+    if( fbevt == NULL ) {
+      /* event without description; look up in the modules */
+      if( ident != NULL && StrOp.len(ident) > 0 )
+        TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "%s reports ident = %s", id, ident!=NULL?ident:"-");
+      fbevt = ModPlanOp.getEvent4Block( NULL, NULL , data->props, data->fromBlockId, id);
+    }
+
+    if( fbevt == NULL ) {
+      TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "Block [%s] no event found for fromBlockId [%s], try to find one for %s...",
+          data->id, data->fromBlockId?data->fromBlockId:"?", blockSide ? wFeedbackEvent.from_all:wFeedbackEvent.from_all_reverse );
+      fbevt = evtAll;
+    }
   }
 
+  /* the loco keeps the sensor id; a copy of the dispatch table has the id of the reporting sensor */
+  if( fbevt != NULL )
+    evtid = ( fbevt == ownEvt || fbevt == ownAll ) ? id:wFeedbackEvent.getid(fbevt);
+
   TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "Block[%s] id=%s fbid=%s state=%s ident=%s fbfrom=%s fbaction=%s from=%s byroute=%s",
       data->id, id, key, puls?"true":"false", ident != NULL ? ident:"-",
                  fbevt != NULL ? wFeedbackEvent.getfrom(fbevt):"NULL",
@@ -463,6 +594,8 @@ static Boolean _event( iIBlockBase inst, Boolean puls, const char* id, const cha
   if( data->crossing ) {
     /* ignore all events */
     TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "ignore events for crossing block %s", data->id );
+    if( ownEvt != NULL ) NodeOp.base.del( ownEvt );
+    if( ownAll != NULL ) NodeOp.base.del( ownAll );
     return False;
   }
 
@@ -625,41 +758,41 @@ static Boolean _event( iIBlockBase inst, Boolean puls, const char* id, const cha
 
     if( evt == enter2in_event ) {
       int timing = wFeedbackEvent.isuse_timer2( fbevt ) ? data->timer2:data->timer;
-      LocOp.event( loc, manager, enter_event, 0, data->forceblocktimer, wFeedbackEvent.getid(fbevt) );
+      LocOp.event( loc, manager, enter_event, 0, data->forceblocktimer, evtid );
       if( data->indelay > 0 )
-        LocOp.event( loc, manager, in_event, data->indelay, data->forceblocktimer, wFeedbackEvent.getid(fbevt) );
+        LocOp.event( loc, manager, in_event, data->indelay, data->forceblocktimer, evtid );
       else
-        LocOp.event( loc, manager, in_event, timing > 0 ? timing:1, data->forceblocktimer, wFeedbackEvent.getid(fbevt) );
+        LocOp.event( loc, manager, in_event, timing > 0 ? timing:1, data->forceblocktimer, evtid );
     }
     if( evt == enter2shortin_event ) {
       int timing = wFeedbackEvent.isuse_timer2( fbevt ) ? data->timer2:data->timer;
-      LocOp.event( loc, manager, enter_event, 0, data->forceblocktimer, wFeedbackEvent.getid(fbevt) );
+      LocOp.event( loc, manager, enter_event, 0, data->forceblocktimer, evtid );
       if( data->indelay > 0 )
-        LocOp.event( loc, manager, shortin_event, data->indelay, data->forceblocktimer, wFeedbackEvent.getid(fbevt) );
+        LocOp.event( loc, manager, shortin_event, data->indelay, data->forceblocktimer, evtid );
       else
-        LocOp.event( loc, manager, shortin_event, timing > 0 ? timing:1, data->forceblocktimer, wFeedbackEvent.getid(fbevt) );
+        LocOp.event( loc, manager, shortin_event, timing > 0 ? timing:1, data->forceblocktimer, evtid );
     }
     else if(evt == enter2pre_event ) {
       int timing = wFeedbackEvent.isuse_timer2( fbevt ) ? data->timer2:data->timer;
-      LocOp.event( loc, manager, enter_event, 0, data->forceblocktimer, wFeedbackEvent.getid(fbevt) );
+      LocOp.event( loc, manager, enter_event, 0, data->forceblocktimer, evtid );
       if( data->indelay > 0 )
-        LocOp.event( loc, manager, pre2in_event, data->indelay, data->forceblocktimer, wFeedbackEvent.getid(fbevt) );
+        LocOp.event( loc, manager, pre2in_event, data->indelay, data->forceblocktimer, evtid );
       else
-        LocOp.event( loc, manager, pre2in_event, timing > 0 ? timing:1, data->forceblocktimer, wFeedbackEvent.getid(fbevt) );
+        LocOp.event( loc, manager, pre2in_event, timing > 0 ? timing:1, data->forceblocktimer, evtid );
     }
     else if( evt == pre2in_event ) {
       int timing = wFeedbackEvent.isuse_timer2( fbevt ) ? data->timer2:data->timer;
-      LocOp.event( loc, manager, pre2in_event, timing, data->forceblocktimer, wFeedbackEvent.getid(fbevt) );
+      LocOp.event( loc, manager, pre2in_event, timing, data->forceblocktimer, evtid );
     }
     else if( evt == in_event ) {
       int timing = wFeedbackEvent.isuse_timer2( fbevt ) ? data->timer2:data->timer;
       if( data->indelay > 0 ){
         /* an in event delay can be set with lock for a schedule entry */
-        LocOp.event( loc, manager, in_event, data->indelay, data->forceblocktimer, wFeedbackEvent.getid(fbevt) );
+        LocOp.event( loc, manager, in_event, data->indelay, data->forceblocktimer, evtid );
         data->indelay = 0;
       }
       else {
-        LocOp.event( loc, manager, in_event, timing, data->forceblocktimer, wFeedbackEvent.getid(fbevt) );
+        LocOp.event( loc, manager, in_event, timing, data->forceblocktimer, evtid );
       }
       /* reset wheel counter */
       {
@@ -671,7 +804,7 @@ static Boolean _event( iIBlockBase inst, Boolean puls, const char* id, const cha
       countwheels = False;
     }
     else
-      LocOp.event( loc, manager, evt, 0, data->forceblocktimer, wFeedbackEvent.getid(fbevt) );
+      LocOp.event( loc, manager, evt, 0, data->forceblocktimer, evtid );
 
     if( evt == enter2shortin_event || evt == enter2in_event || evt == in_event ) {
       /* TODO: check if the shortin_event does not ruin the auto mode */
@@ -732,12 +865,16 @@ static Boolean _event( iIBlockBase inst, Boolean puls, const char* id, const cha
                    (data->fromBlockId == NULL ? "NULL":data->fromBlockId) );
     countwheels = False;
   }
+  if( ownEvt != NULL ) NodeOp.base.del( ownEvt );
+  if( ownAll != NULL ) NodeOp.base.del( ownAll );
   return countwheels;
 }
 
 static void _fbEvent( obj inst, Boolean puls, const char* id, const char* ident, const char* ident2, const char* ident3, const char* ident4, int val, int wheelcount, Boolean dir ) {
   iOBlockData data = Data(inst);
 
+  SpanOp.mark( SpanOp.getCurrent(), __sBlock );
+
   if( _event( (iIBlockBase)inst, puls, id, ident, ident2, ident3, ident4, val, wheelcount, NULL, dir ) ) {
     if( wheelcount > 0 ) {
       data->wheelcount = wheelcount;
@@ -777,15 +914,22 @@ static void _setCarCount( iIBlockBase inst, int count ) {
 
 
 /**
- * map all fbevent's and set the listener to the common __fbEvent
+ * compile all fbevent's into the dispatch table and set the listener to the common __fbEvent
  */
 static void __initFeedbackEvents( iOBlock inst ) {
   iOBlockData data = Data(inst);
   iOModel model = AppOp.getModel();
-  char key[256] = {'\0'};
   iONode fbevt = wBlock.getfbevent( data->props );
+  iOFbDispatch table = NULL;
+  iOFbDispatch old = NULL;
+  int size = 0;
+  int cnt  = 0;
 
-  MapOp.clear( data->fbEvents );
+  if( __atomAll == 0 ) {
+    __atomAll = __atom( wFeedbackEvent.from_all, True );
+    __atomAllReverse = __atom( wFeedbackEvent.from_all_reverse, True );
+    __fbEpoch = RcuMapOp.inst();
+  }
 
   while( fbevt != NULL ) {
     const char* fbid = wFeedbackEvent.getid( fbevt );
@@ -795,16 +939,35 @@ static void __initFeedbackEvents( iOBlock inst ) {
 
     if( StrOp.len( fbid ) > 0 && fb != NULL ) {
       iOStrTok tok = StrTokOp.inst( wFeedbackEvent.getfrom( fbevt ), ',' );
+      int route = 0;
 
-      /* put all blockid's in the map */
+      if( byroute != NULL && StrOp.len( byroute ) > 0 && !StrOp.equals( wFeedbackEvent.from_all, byroute) && !StrOp.equals( wFeedbackEvent.from_all_reverse, byroute) )
+        route = __atom( byroute, True );
+
+      /* one entry for each from block */
       while( StrTokOp.hasMoreTokens(tok) ) {
         const char* fromblockid = StrTokOp.nextToken( tok );
-        if( byroute != NULL && StrOp.len( byroute ) > 0 && !StrOp.equals( wFeedbackEvent.from_all, byroute) && !StrOp.equals( wFeedbackEvent.from_all_reverse, byroute) )
-          StrOp.fmtb( key, "%s%s-%s-%s", fbid, endpuls?"-ep":"", fromblockid, byroute );
-        else
-          StrOp.fmtb( key, "%s%s-%s", fbid, endpuls?"-ep":"", fromblockid );
-        TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "fbevent added by key [%s]", key);
-        MapOp.put( data->fbEvents, key, (obj)fbevt );
+        iOFbDispatch d = NULL;
+
+        /* keep one free entry as terminator */
+        if( cnt + 1 >= size ) {
+          iOFbDispatch grown = allocMem( ( size + 16 ) * sizeof( struct FbDispatch ) );
+          if( table != NULL ) {
+            MemOp.copy( grown, table, cnt * sizeof( struct FbDispatch ) );
+            freeMem( table );
+          }
+          table = grown;
+          size += 16;
+        }
+
+        d = &table[cnt++];
+        d->fb      = __atom( fbid, True );
+        d->endpuls = endpuls;
+        d->from    = __atom( fromblockid, True );
+        d->route   = route;
+        d->evt     = fbevt;
+        TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "fbevent added for [%s%s] from [%s] by route [%s]",
+            fbid, endpuls?"-ep":"", fromblockid, route != 0 ? byroute:"-" );
       };
       StrTokOp.base.del(tok);
 
@@ -813,6 +976,14 @@ static void __initFeedbackEvents( iOBlock inst ) {
     fbevt = wBlock.nextfbevent( data->props, fbevt );
   };
 
+  /* Sensor threads may still scan the current table; it is freed after they left. */
+  old = data->fbTable;
+  data->fbTable = table;
+  if( old != NULL ) {
+    RcuMapOp.synchronize( __fbEpoch );
+    freeMem( old );
+  }
+
   if( wBlock.getttid(data->props) != NULL && StrOp.len(wBlock.getttid(data->props)) > 0 ) {
     iOTT tt = ModelOp.getTurntable( model, wBlock.getttid(data->props) );
     if( tt != NULL )
@@ -2596,12 +2767,14 @@ static void _modify( iOBlock inst, iONode props ) {
   data->id = wBlock.getid( data->props );
 
   if( !move ) {
+    /* the fbevents are referenced by the current dispatch table; delete them after its grace period */
+    iOList removed = ListOp.inst();
     cnt = NodeOp.getChildCnt( data->props );
     while( cnt > 0 ) {
       iONode child = NodeOp.getChild( data->props, 0 );
       iONode removedChild = NodeOp.removeChild( data->props, child );
       if( removedChild != NULL) {
-        NodeOp.base.del(removedChild);
+        ListOp.add( removed, (obj)removedChild );
       }
       cnt = NodeOp.getChildCnt( data->props );
     }
@@ -2613,6 +2786,9 @@ static void _modify( iOBlock inst, iONode props ) {
 
     /* re-init callback for all feedbacks: */
     __initFeedbackEvents( inst );
+    while( ListOp.size( removed ) > 0 )
+      NodeOp.base.del( (iONode)ListOp.remove( removed, 0 ) );
+    ListOp.base.del( removed );
 
     /* re-init timer */
     data->timer  = wBlock.getevttimer( data->props );
@@ -2763,8 +2939,9 @@ static iOBlock _inst( iONode props ) {
 
   data->props = props;
   data->locId = NodeOp.getStr( props, "locid", NULL );
+  if( __sBlock == -1 )
+    __sBlock = SpanOp.stage( "block" );
   data->minbklc = wCtrl.getminbklc( AppOp.getIniNode( wCtrl.name() ) );
-  data->fbEvents = MapOp.inst();
 
   data->timer  = wBlock.getevttimer( props );
   data->timer2 = wBlock.getevttimer2( props );
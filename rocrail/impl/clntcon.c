@@ -27,6 +27,8 @@
 #include "rocrail/impl/clntcon_impl.h"
 #include "rocrail/public/app.h"
 #include "rocrail/public/model.h"
+#include "rocrail/public/loc.h"
+#include "rocrail/public/rcon.h"
 
 #include "rocs/public/doc.h"
 #include "rocs/public/node.h"
@@ -34,6 +36,8 @@
 #include "rocs/public/mem.h"
 #include "rocs/public/str.h"
 #include "rocs/public/xmlh.h"
+#include "rocs/public/gzip.h"
+#include "rocs/public/metrics.h"
 
 #include "rocrail/wrapper/public/Command.h"
 #include "rocrail/wrapper/public/AutoCmd.h"
@@ -44,8 +48,12 @@
 #include "rocrail/wrapper/public/DataReq.h"
 #include "rocrail/wrapper/public/Exception.h"
 #include "rocrail/wrapper/public/Loc.h"
+#include "rocrail/wrapper/public/EventBatch.h"
 
 static int instCnt = 0;
+static int __mFanOut  = -1;
+static int __mClients = -1;
+static int __mSent    = -1;
 
 /*
  ***** OBase functions.
@@ -97,10 +105,140 @@ struct __OClntService {
   Boolean       slave;
   Boolean       quit;
   Boolean       disablemonitor;
+  Boolean       deflate;
+  iOGZip        gzip;
+  Boolean       binary;
+  iOMap         binKeys;
 };
 typedef struct __OClntService* __iOClntService;
 
 
+/* An event encoded once by the broadcaster and shared by all binary clients;
+   the delta frame is only valid for clients which already got a full one. */
+struct __OBinFrame {
+  byte* full;
+  int   fullLen;
+  byte* delta;
+  int   deltaLen;
+  int   refs;
+};
+typedef struct __OBinFrame* __iOBinFrame;
+
+static const char* binFrameName = "binframe";
+
+
+static void __freeBinFrame( __iOBinFrame bin ) {
+  if( bin->full != bin->delta )
+    freeMem( bin->full );
+  freeMem( bin->delta );
+  freeMem( bin );
+}
+
+
+static void __releaseBinFrame( iOClntConData data, const char* seq ) {
+  MutexOp.wait( data->muxMap );
+  {
+    __iOBinFrame bin = (__iOBinFrame)MapOp.get( data->binFrames, seq );
+    if( bin != NULL && --bin->refs <= 0 ) {
+      MapOp.remove( data->binFrames, seq );
+      __freeBinFrame( bin );
+    }
+  }
+  MutexOp.post( data->muxMap );
+}
+
+
+/* Serializes a posted node into its xmlh header followed by the frame;
+   the node itself is left to the caller. */
+static char* __frameEvent( __iOClntService o, iONode node, int* len ) {
+  iOXmlh   xmlh = XmlhOp.inst( True, NULL, NULL );
+  long   ticket = 0;
+  __iOBinFrame bin = NULL;
+  char*    info = NULL;
+  int   infoLen = 0;
+  iONode    xml = NodeOp.inst( XmlhOp.xml_tagname, NULL, ELEMENT_NODE );
+  long  xmlhLen = 0;
+  char* xmlhStr = NULL;
+  byte*  zipped = NULL;
+  char*   frame = NULL;
+  int  frameLen = 0;
+  char*  buffer = NULL;
+
+  /* a plan ticket is answered with the shared plan snapshot */
+  if( StrOp.equals( wPlan.name(), NodeOp.getName( node ) ) )
+    ticket = NodeOp.getLong( node, "snapshot", 0 );
+
+  /* a binframe ticket refers to the event encoded by the broadcaster */
+  if( StrOp.equals( binFrameName, NodeOp.getName( node ) ) ) {
+    MutexOp.wait( Data(o->ClntCon)->muxMap );
+    bin = (__iOBinFrame)MapOp.get( Data(o->ClntCon)->binFrames, NodeOp.getStr( node, "seq", "" ) );
+    MutexOp.post( Data(o->ClntCon)->muxMap );
+  }
+
+  if( bin != NULL ) {
+    Boolean full = NodeOp.getBool( node, "full", True );
+    frame    = (char*)(full ? bin->full:bin->delta);
+    frameLen = full ? bin->fullLen:bin->deltaLen;
+    NodeOp.setStr( xml, "encoding", EvtCodecOp.getEncoding() );
+  }
+  else if( ticket > 0 ) {
+    info = (char*)ModelOp.getPlanSnapshot( AppOp.getModel(), ticket, &infoLen );
+    infoLen++;
+  }
+  else {
+    info = NodeOp.base.toString( node );
+    infoLen = StrOp.len( info ) + 1;
+    if( StrOp.equals( wPlan.name(), NodeOp.getName( node ) ) )
+      LocOp.resyncBroadcasts();
+  }
+  if( bin == NULL )
+    frame = info;
+
+  /* deflate if the client accepts it and it pays off against the longer header */
+  if( bin == NULL && o->deflate && infoLen >= 128 ) {
+    if( o->gzip == NULL )
+      o->gzip = GZipOp.inst( RConOp.getDictionary(), 6 );
+    zipped = GZipOp.compress( o->gzip, (byte*)info, infoLen, &frameLen );
+    if( zipped != NULL && frameLen + 32 < infoLen ) {
+      frame = (char*)zipped;
+      NodeOp.setStr( xml, "encoding", RConOp.getEncoding() );
+      NodeOp.setInt( xml, "rawsize", infoLen );
+    }
+  }
+  if( bin == NULL && frame == info )
+    frameLen = infoLen;
+
+  NodeOp.setInt( xml, "size", frameLen );
+  XmlhOp.addNode( xmlh, xml );
+  xmlhStr = (char*)XmlhOp.base.serialize( xmlh, &xmlhLen );
+  XmlhOp.base.del( xmlh );
+
+  TraceOp.trc( name, TRCLEVEL_XMLH, __LINE__, 9999, "%s", xmlhStr );
+
+  if( info != NULL )
+    TraceOp.trc( name, TRCLEVEL_XMLH, __LINE__, 9999, "%.320s...", info );
+
+  *len = xmlhLen + frameLen;
+  buffer = allocMem( *len );
+  MemOp.copy( buffer, xmlhStr, xmlhLen );
+  MemOp.copy( buffer + xmlhLen, frame, frameLen );
+
+  if( bin != NULL )
+    __releaseBinFrame( Data(o->ClntCon), NodeOp.getStr( node, "seq", "" ) );
+
+  /* free the serialized info and xmlh: */
+  StrOp.free( xmlhStr );
+  if( zipped != NULL )
+    freeMem( zipped );
+  if( ticket > 0 )
+    ModelOp.releasePlanSnapshot( AppOp.getModel(), info );
+  else if( info != NULL )
+    StrOp.free( info );
+
+  return buffer;
+}
+
+
 static void __infoWriter( void* threadinst ) {
   iOThread       th = (iOThread)threadinst;
   __iOClntService o = (__iOClntService)ThreadOp.getParm(th);
@@ -118,37 +256,39 @@ static void __infoWriter( void* threadinst ) {
         break;
       }
 
-      {
-        iOXmlh   xmlh = XmlhOp.inst( True, NULL, NULL );
-        char*    info = NodeOp.base.toString( node );
-        int   infoLen = StrOp.len( info ) + 1;
-        iONode    xml = NodeOp.inst( XmlhOp.xml_tagname, NULL, ELEMENT_NODE );
-        long  xmlhLen = 0;
-        char* xmlhStr = NULL;
-
-        NodeOp.setInt( xml, "size", infoLen );
-        XmlhOp.addNode( xmlh, xml );
-        xmlhStr = (char*)XmlhOp.base.serialize( xmlh, &xmlhLen );
-        XmlhOp.base.del( xmlh );
-
-        TraceOp.trc( name, TRCLEVEL_XMLH, __LINE__, 9999, "%s", xmlhStr );
-
-        TraceOp.trc( name, TRCLEVEL_XMLH, __LINE__, 9999, "%.320s...", info );
-
-        if( SocketOp.write( o->clntSocket, xmlhStr, xmlhLen ) )
-          ok = SocketOp.write( o->clntSocket, info, infoLen );
-        else
-          ok = False;
+      if( StrOp.equals( wEventBatch.name(), NodeOp.getName( node ) ) ) {
+        /* the events of a batch go out in one write */
+        char* buffer = NULL;
+        int   total  = 0;
+        int i = 0;
+        for( i = 0; i < NodeOp.getChildCnt( node ); i++ ) {
+          int len = 0;
+          char* frame = __frameEvent( o, NodeOp.getChild( node, i ), &len );
+          buffer = buffer == NULL ? allocMem( len ):reallocMem( buffer, total + len );
+          MemOp.copy( buffer + total, frame, len );
+          total += len;
+          freeMem( frame );
+        }
+        if( total > 0 ) {
+          ok = SocketOp.write( o->clntSocket, buffer, total );
+          MetricsOp.add( __mSent, total );
+        }
+        if( buffer != NULL )
+          freeMem( buffer );
+        node->base.del( node );
+      }
+      else {
+        int len = 0;
+        char* frame = __frameEvent( o, node, &len );
+        ok = SocketOp.write( o->clntSocket, frame, len );
+        MetricsOp.add( __mSent, len );
+        freeMem( frame );
 
         /* plan node will not be cloned! */
-        if( !StrOp.equals( wPlan.name(), NodeOp.getName( node ) ) ) {
+        if( NodeOp.getLong( node, "snapshot", 0 ) > 0 || !StrOp.equals( wPlan.name(), NodeOp.getName( node ) ) ) {
           /* Cleanup: endstation for all nodes. */
           node->base.del( node );
         }
-
-        /* free the serialized info and xmlh: */
-        StrOp.free( xmlhStr );
-        StrOp.free( info );
       }
     }
     else {
@@ -164,6 +304,10 @@ static void __infoWriter( void* threadinst ) {
     obj me = MapOp.remove( Data(o->ClntCon)->infoWriters, ThreadOp.getName( th ) );
     if( me != NULL )
       TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "InfoService() Removed from Map." );
+    if( o->binKeys != NULL ) {
+      MapOp.base.del( o->binKeys );
+      o->binKeys = NULL;
+    }
   }
   /* Unlock the semaphore: */
   MutexOp.post( Data(o->ClntCon)->muxMap );
@@ -176,6 +320,8 @@ static void __infoWriter( void* threadinst ) {
     SocketOp.base.del( s );
     TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "InfoService ended." );
     ThreadOp.base.del( th );
+    if( o->gzip != NULL )
+      GZipOp.base.del( o->gzip );
     freeMem(o);
   }
 }
@@ -247,7 +393,23 @@ static void __cmdReader( void* threadinst ) {
     XmlhOp.reset( xmlh );
     if( (ok = __readXmlh( o->clntSocket, xmlh )) ) {
       long size = XmlhOp.getSizeByTagName( xmlh, XmlhOp.xml_tagname, 0 );
+      iONode hdr = XmlhOp.getNodeByTagName( xmlh, XmlhOp.xml_tagname, 0 );
       int len = 0;
+      if( !o->deflate && hdr != NULL && RConOp.getEncoding() != NULL &&
+          StrOp.equals( RConOp.getEncoding(), NodeOp.getStr( hdr, "accept", "" ) ) )
+      {
+        TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "client accepts %s frames", RConOp.getEncoding() );
+        o->deflate = True;
+      }
+      /* binary events only if both sides are generated from the same wrapper.xml */
+      if( !o->binary && hdr != NULL && StrOp.equals( EvtCodecOp.getSchemaId(), NodeOp.getStr( hdr, "binschema", "" ) ) ) {
+        TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "client accepts %s frames, schema %s",
+            EvtCodecOp.getEncoding(), EvtCodecOp.getSchemaId() );
+        MutexOp.wait( data->muxMap );
+        o->binKeys = MapOp.inst();
+        o->binary = True;
+        MutexOp.post( data->muxMap );
+      }
       freeMem( cmd );
       cmd = allocMem( size + 1 );
       TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "cmdReader: reading %d bytes...", size );
@@ -449,34 +611,159 @@ static void __stress( void* threadinst ) {
 /*
  ***** _Public functions.
  */
+/* Encode the event once for all binary clients; NULL if it has no binary form. */
+static __iOBinFrame __encodeBinFrame( iOClntConData data, iONode nodeDF ) {
+  __iOBinFrame bin = NULL;
+  Boolean binClient = False;
+  iOThread iw = (iOThread)MapOp.first( data->infoWriters );
+  while( iw != NULL && !binClient ) {
+    binClient = ((__iOClntService)ThreadOp.getParm(iw))->binary;
+    iw = (iOThread)MapOp.next( data->infoWriters );
+  }
+
+  if( binClient ) {
+    int size = 0;
+    byte* delta = EvtCodecOp.encode( data->codec, nodeDF, True, &size );
+    if( delta != NULL ) {
+      bin = allocMem( sizeof( struct __OBinFrame ) );
+      bin->delta    = delta;
+      bin->deltaLen = size;
+      /* the full frame is only encoded if a client still needs one */
+      if( !EvtCodecOp.isDelta( delta ) ) {
+        bin->full    = delta;
+        bin->fullLen = size;
+      }
+    }
+  }
+  return bin;
+}
+
+
+/* What one client gets for an event: NULL if skipped, a binframe ticket or a clone. */
+static iONode __clientItem( iOClntConData data, __iOClntService param, iONode nodeDF,
+                            __iOBinFrame bin, const char* binKey, const char* binSeq ) {
+  if( param->disablemonitor && StrOp.equals( NodeOp.getName(nodeDF), wException.name() ) ) {
+    /* skipping this broadcast for the client */
+    TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "Skipping exception broadcast." );
+    return NULL;
+  }
+  if( param->disablemonitor && StrOp.equals( NodeOp.getName(nodeDF), wLoc.name() ) && wLoc.isbbtevent(nodeDF) ) {
+    /* skipping this broadcast for the client */
+    TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "Skipping bbt event broadcast." );
+    /* the next delta would miss this one; start over with a full frame */
+    if( param->binary && binKey != NULL )
+      MapOp.remove( param->binKeys, binKey );
+    return NULL;
+  }
+  if( param->binary && bin != NULL ) {
+    iONode ticket = NodeOp.inst( binFrameName, NULL, ELEMENT_NODE );
+    Boolean  full = binKey == NULL || !MapOp.haskey( param->binKeys, binKey );
+    if( full && bin->full == NULL )
+      bin->full = EvtCodecOp.encode( data->codec, nodeDF, False, &bin->fullLen );
+    NodeOp.setStr( ticket, "seq", binSeq );
+    NodeOp.setBool( ticket, "full", full );
+    bin->refs++;
+    /* a full frame of a partial loco event is no base for the next delta */
+    if( binKey != NULL && !( full && StrOp.equals( wLoc.name(), NodeOp.getName(nodeDF) ) && wLoc.isdelta(nodeDF) ) )
+      MapOp.put( param->binKeys, binKey, (obj)param );
+    return ticket;
+  }
+  TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "broadcasting %s...", NodeOp.getName(nodeDF) );
+  return (iONode)nodeDF->base.clone( nodeDF );
+}
+
+
+/* Give back the binframe references of an item which could not be posted. */
+static void __unrefItem( iONode item, __iOBinFrame* bins, char** seqs, int cnt ) {
+  if( StrOp.equals( binFrameName, NodeOp.getName( item ) ) ) {
+    int i = 0;
+    for( i = 0; i < cnt; i++ ) {
+      if( bins[i] != NULL && StrOp.equals( seqs[i], NodeOp.getStr( item, "seq", "" ) ) ) {
+        bins[i]->refs--;
+        break;
+      }
+    }
+  }
+}
+
+
+/* An event batch is handed to each client as one post, so the client gets
+   all its events in one write. */
 static void __doBroadcast( iOClntCon inst, iONode nodeDF ) {
   if( inst != NULL && MutexOp.trywait( Data(inst)->muxMap, 1000 ) ) {
     iOClntConData data = Data(inst);
-    iOThread iw = (iOThread)MapOp.first( data->infoWriters );
+    unsigned long t0 = MetricsOp.now();
+    Boolean isBatch = StrOp.equals( wEventBatch.name(), NodeOp.getName( nodeDF ) );
+    int cnt = isBatch ? NodeOp.getChildCnt( nodeDF ):1;
+    iONode*       events = allocMem( cnt * sizeof( iONode ) );
+    __iOBinFrame* bins   = allocMem( cnt * sizeof( __iOBinFrame ) );
+    char**        keys   = allocMem( cnt * sizeof( char* ) );
+    char**        seqs   = allocMem( cnt * sizeof( char* ) );
+    iOThread iw = NULL;
+    int i = 0;
+
+    for( i = 0; i < cnt; i++ ) {
+      events[i] = isBatch ? NodeOp.getChild( nodeDF, i ):nodeDF;
+      bins[i]   = __encodeBinFrame( data, events[i] );
+      if( bins[i] != NULL ) {
+        keys[i] = EvtCodecOp.getKey( events[i] );
+        seqs[i] = StrOp.fmt( "%ld", ++data->binSeq );
+      }
+    }
+
+    iw = (iOThread)MapOp.first( data->infoWriters );
     while( iw != NULL ) {
       __iOClntService param = (__iOClntService)ThreadOp.getParm(iw);
-      if( param->disablemonitor && StrOp.equals( NodeOp.getName(nodeDF), wException.name() ) ) {
-        /* skipping this broadcast for the client */
-        TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "Skipping exception broadcast for %s.", ThreadOp.getName(iw) );
-      }
-      else if( param->disablemonitor && StrOp.equals( NodeOp.getName(nodeDF), wLoc.name() ) && wLoc.isbbtevent(nodeDF) ) {
-        /* skipping this broadcast for the client */
-        TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "Skipping bbt event broadcast for %s.", ThreadOp.getName(iw) );
-      }
+      iONode post = NULL;
+
+      if( !isBatch )
+        post = __clientItem( data, param, nodeDF, bins[0], keys[0], seqs[0] );
       else {
-        iONode clone = (iONode)nodeDF->base.clone( nodeDF );
-        TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "broadcasting %s...", NodeOp.getName(clone) );
-        if( !ThreadOp.post( iw, (obj)clone ) ) {
-          NodeOp.base.del(clone);
-          TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "Unable to broadcast event to %s; removing from list.", ThreadOp.getName(iw) );
-          MapOp.remove( data->infoWriters, ThreadOp.getName(iw) );
-          iw = (iOThread)MapOp.first( data->infoWriters );
+        post = NodeOp.inst( wEventBatch.name(), NULL, ELEMENT_NODE );
+        for( i = 0; i < cnt; i++ ) {
+          iONode item = __clientItem( data, param, events[i], bins[i], keys[i], seqs[i] );
+          if( item != NULL )
+            NodeOp.addChild( post, item );
+        }
+        if( NodeOp.getChildCnt( post ) == 0 ) {
+          NodeOp.base.del( post );
+          post = NULL;
+        }
+      }
+
+      if( post != NULL && !ThreadOp.post( iw, (obj)post ) ) {
+        if( isBatch ) {
+          for( i = 0; i < NodeOp.getChildCnt( post ); i++ )
+            __unrefItem( NodeOp.getChild( post, i ), bins, seqs, cnt );
         }
+        else
+          __unrefItem( post, bins, seqs, cnt );
+        NodeOp.base.del( post );
+        TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "Unable to broadcast event to %s; removing from list.", ThreadOp.getName(iw) );
+        MapOp.remove( data->infoWriters, ThreadOp.getName(iw) );
+        iw = (iOThread)MapOp.first( data->infoWriters );
       }
       if( iw != NULL )
         iw = (iOThread)MapOp.next( data->infoWriters );
       ThreadOp.sleep( 0 );
     }
+
+    for( i = 0; i < cnt; i++ ) {
+      if( bins[i] != NULL && bins[i]->refs > 0 )
+        MapOp.put( data->binFrames, seqs[i], (obj)bins[i] );
+      else if( bins[i] != NULL )
+        __freeBinFrame( bins[i] );
+      StrOp.free( keys[i] );
+      StrOp.free( seqs[i] );
+    }
+    freeMem( events );
+    freeMem( bins );
+    freeMem( keys );
+    freeMem( seqs );
+
+    MetricsOp.set( __mClients, MapOp.size( data->infoWriters ) );
+    MetricsOp.since( __mFanOut, t0 );
+
     /* Unlock the semaphore: */
     MutexOp.post( data->muxMap );
   }
@@ -518,6 +805,11 @@ static void _broadcastEvent( iOClntCon inst, iONode nodeDF ) {
 }
 
 
+static Boolean __isLivePlan( iONode node ) {
+  iOModel model = AppOp.getModel();
+  return model != NULL && node == ModelOp.getModel( model ) ? True:False;
+}
+
 /* nodeDF is already cloned! */
 static void _postEvent( iOClntCon inst, iONode nodeDF, const char* iwname )
 {
@@ -532,18 +824,27 @@ static void _postEvent( iOClntCon inst, iONode nodeDF, const char* iwname )
   if( inst != NULL && MutexOp.trywait( data->muxMap, 1000 ) ) {
     iOThread iw = (iOThread)MapOp.get( data->infoWriters, iwname );
     if( iw != NULL ) {
+      if( __isLivePlan( nodeDF ) ) {
+        /* Post a ticket instead of the live plan; taken under muxMap so every
+           event queued before it is also reflected in the snapshot. */
+        iONode ticket = NodeOp.inst( wPlan.name(), NULL, ELEMENT_NODE );
+        NodeOp.setLong( ticket, "snapshot", ModelOp.getPlanTicket( AppOp.getModel() ) );
+        nodeDF = ticket;
+      }
       ThreadOp.post( iw, (obj)nodeDF );
     }
     else {
       TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "InfoWriter %s not found!", iwname );
-      nodeDF->base.del(nodeDF);
+      if( !__isLivePlan( nodeDF ) )
+        nodeDF->base.del(nodeDF);
     }
     /* Unlock the semaphore: */
     MutexOp.post( data->muxMap );
   }
   else {
     TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "ClntCon not initialized! (%s)", iwname );
-    nodeDF->base.del(nodeDF);
+    if( !__isLivePlan( nodeDF ) )
+      nodeDF->base.del(nodeDF);
   }
 }
 
@@ -588,10 +889,15 @@ static iOClntCon _inst( iONode ini, int port, clntcon_callback pfun, obj callbac
 
   data->infoWriters = MapOp.inst();
   data->muxMap      = MutexOp.inst( NULL, True );
+  data->codec       = EvtCodecOp.inst();
+  data->binFrames   = MapOp.inst();
 
   instCnt++;
 
   data->manager = ThreadOp.inst( "cconmngr", __manager, clntcon );
+  __mFanOut  = MetricsOp.histogram( "clntcon_broadcast_us", "Event fan-out to the clients in microseconds." );
+  __mClients = MetricsOp.gauge( "clntcon_clients", "Connected clients." );
+  __mSent    = MetricsOp.counter( "clntcon_sent_bytes", "Event bytes written to the clients, headers included." );
   data->broadcaster = ThreadOp.inst( "broadcast", __broadcaster, clntcon );
   ThreadOp.start( data->manager );
   ThreadOp.start( data->broadcaster );
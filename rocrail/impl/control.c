@@ -43,8 +43,12 @@
 #include "rocs/public/str.h"
 #include "rocs/public/strtok.h"
 #include "rocs/public/map.h"
+#include "rocs/public/list.h"
+#include "rocs/public/mutex.h"
 #include "rocs/public/lib.h"
 #include "rocs/public/system.h"
+#include "rocs/public/metrics.h"
+#include "rocs/public/span.h"
 
 #include "rocrail/wrapper/public/Global.h"
 #include "rocrail/wrapper/public/RocRail.h"
@@ -56,6 +60,7 @@
 #include "rocrail/wrapper/public/Output.h"
 #include "rocrail/wrapper/public/Link.h"
 #include "rocrail/wrapper/public/Feedback.h"
+#include "rocrail/wrapper/public/FbBatch.h"
 #include "rocrail/wrapper/public/Route.h"
 #include "rocrail/wrapper/public/Turntable.h"
 #include "rocrail/wrapper/public/SelTab.h"
@@ -84,6 +89,7 @@
 #include "rocrail/wrapper/public/Devices.h"
 #include "rocrail/wrapper/public/Operator.h"
 #include "rocrail/wrapper/public/Variable.h"
+#include "rocrail/wrapper/public/Item.h"
 #include "rocrail/wrapper/public/VariableList.h"
 
 #include "rocutils/public/devices.h"
@@ -98,6 +104,15 @@ static void __callback( obj inst, iONode nodeA );
 
 static int instCnt = 0;
 
+/* metric ids */
+static int __mDispatch = -1;
+static int __mDiEvents = -1;
+static int __mDiCmds   = -1;
+static int __mDiCmdUs  = -1;
+static int __mClockActions = -1;
+static int __sControl = -1;
+static int __sDigInt  = -1;
+
 /*
  ***** OBase functions.
  */
@@ -199,7 +214,13 @@ static Boolean __informDigInt( iOControl inst, iIDigInt pDi, iONode node, int* e
 
   /* inform digitalInterface */
   if( pDi != NULL ) {
-    iONode rsp = pDi->cmd( (obj)pDi, node );
+    unsigned long t0 = MetricsOp.now();
+    iONode rsp = NULL;
+    /* command caused by a traced sensor event */
+    SpanOp.mark( SpanOp.getCurrent(), __sDigInt );
+    rsp = pDi->cmd( (obj)pDi, node );
+    MetricsOp.since( __mDiCmdUs, t0 );
+    MetricsOp.add( __mDiCmds, 1 );
     if( rsp != NULL ) {
 
       if( StrOp.equals( NodeOp.getName( rsp ), wProgram.name() ) ) {
@@ -1102,6 +1123,7 @@ static void __listener( obj inst, iONode nodeC, int level ) {
   /* event from digitalInterface */
   /* inform model */
   iOModel model = AppOp.getModel(  );
+  unsigned long t0 = MetricsOp.now();
 
   if( level == TRCLEVEL_EXCEPTION ) {
     TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, NodeOp.getStr( nodeC, "msg", "" ) );
@@ -1111,6 +1133,20 @@ static void __listener( obj inst, iONode nodeC, int level ) {
   if( nodeC == NULL )
     return;
 
+  MetricsOp.add( __mDiEvents, 1 );
+
+  /* a sensor event starts a latency span at the read time stamped by the digint */
+  if( SpanOp.isEnabled() ) {
+    if( StrOp.equals( wFeedback.name(), NodeOp.getName( nodeC ) ) ) {
+      wFeedback.setspan( nodeC, SpanOp.begin( wFeedback.getspants( nodeC ) ) );
+      SpanOp.mark( wFeedback.getspan( nodeC ), __sControl );
+    }
+    else if( StrOp.equals( wFbBatch.name(), NodeOp.getName( nodeC ) ) ) {
+      wFbBatch.setspan( nodeC, SpanOp.begin( wFbBatch.getspants( nodeC ) ) );
+      SpanOp.mark( wFbBatch.getspan( nodeC ), __sControl );
+    }
+  }
+
   if( StrOp.equals( wResponse.name(), NodeOp.getName( nodeC ) ) ) {
     TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, NodeOp.getStr( nodeC, "msg", "--empty message--" ) );
   }
@@ -1190,6 +1226,8 @@ static void __listener( obj inst, iONode nodeC, int level ) {
   }
   else
     ModelOp.event( model, nodeC );
+
+  MetricsOp.since( __mDispatch, t0 );
 }
 
 
@@ -1292,6 +1330,7 @@ static Boolean __initDigInts( iOControl inst ) {
     TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "initDigInts lib=\"%s\" idd=\"%s\"", lib, iid!=NULL ? iid:"?" );
 
     wDigInt.setstress( digint, AppOp.isStress());
+    wDigInt.setspans( digint, SpanOp.isEnabled() );
 
     wDigInt.setlibpath( digint, AppOp.getLibPath() );
     {
@@ -1405,10 +1444,212 @@ static void _setTime( iOControl inst, long p_Time ) {
   data->time = p_Time;
 }
 
+/*
+ * Model clock schedule: fixed time actions are bucketed by their HH:MM, random and every actions
+ * and running timer variables are visited on each tick and system actions are bucketed by state.
+ * Model time wraps daily and can be set by the clients; a bucket keeps the exact minute and
+ * second matching of ActionOp.tick.
+ */
+static int __childCnt( iONode node ) {
+  return node != NULL ? NodeOp.getChildCnt( node ):0;
+}
+
+static void __freeIds( iOList list ) {
+  int i = 0;
+  for( i = 0; i < ListOp.size( list ); i++ )
+    StrOp.free( (char*)ListOp.get( list, i ) );
+  ListOp.clear( list );
+}
+
+static void __unscheduleAction( iOControlData data, const char* id ) {
+  char* key = NULL;
+
+  if( id == NULL || StrOp.len( id ) == 0 )
+    return;
+
+  key = (char*)MapOp.remove( data->schedKey, id );
+  if( key != NULL ) {
+    iOList list = StrOp.len( key ) > 0 ? (iOList)MapOp.get( data->schedAt, key ):data->schedTick;
+    if( list != NULL ) {
+      int i = 0;
+      for( i = 0; i < ListOp.size( list ); i++ ) {
+        char* listid = (char*)ListOp.get( list, i );
+        if( StrOp.equals( id, listid ) ) {
+          ListOp.remove( list, i );
+          StrOp.free( listid );
+          break;
+        }
+      }
+      if( list != data->schedTick && ListOp.size( list ) == 0 ) {
+        MapOp.remove( data->schedAt, key );
+        ListOp.base.del( list );
+      }
+    }
+    StrOp.free( key );
+  }
+}
+
+static void __scheduleAction( iOControlData data, iONode action ) {
+  const char* id = wAction.getid( action );
+  char key[32] = {'\0'};
+  iOList list = data->schedTick;
+
+  __unscheduleAction( data, id );
+  if( id == NULL || StrOp.len( id ) == 0 || !wAction.istimed( action ) )
+    return;
+
+  /* an every action which is not enabled falls back to the fixed time in ActionOp.tick */
+  if( !wAction.israndom( action ) && !wAction.isevery( action ) ) {
+    StrOp.fmtb( key, "%02d:%02d", wAction.gethour( action ), wAction.getmin( action ) );
+    list = (iOList)MapOp.get( data->schedAt, key );
+    if( list == NULL ) {
+      list = ListOp.inst();
+      MapOp.put( data->schedAt, key, (obj)list );
+    }
+  }
+  ListOp.add( list, (obj)StrOp.dup( id ) );
+  MapOp.put( data->schedKey, id, (obj)StrOp.dup( key ) );
+}
+
+static void __scheduleVariable( iOControlData data, iOModel model, const char* id ) {
+  iONode var = NULL;
+
+  if( id == NULL || StrOp.len( id ) == 0 )
+    return;
+
+  MapOp.remove( data->schedVars, id );
+  var = ModelOp.getVariable( model, id );
+  if( var != NULL && wVariable.istimer( var ) )
+    MapOp.put( data->schedVars, id, (obj)var );
+}
+
+static void __scheduleSystem( iOControlData data, iONode plan ) {
+  iONode system = wPlan.getsystem( plan );
+  iOList list = (iOList)MapOp.first( data->schedSys );
+
+  while( list != NULL ) {
+    ListOp.base.del( list );
+    list = (iOList)MapOp.next( data->schedSys );
+  }
+  MapOp.clear( data->schedSys );
+
+  if( system != NULL ) {
+    iONode actionctrl = wSystemActions.getactionctrl( system );
+    while( actionctrl != NULL ) {
+      const char* state = wActionCtrl.getstate( actionctrl );
+      if( state != NULL && StrOp.len( state ) > 0 ) {
+        list = (iOList)MapOp.get( data->schedSys, state );
+        if( list == NULL ) {
+          list = ListOp.inst();
+          MapOp.put( data->schedSys, state, (obj)list );
+        }
+        ListOp.add( list, (obj)actionctrl );
+      }
+      actionctrl = wSystemActions.nextactionctrl( system, actionctrl );
+    }
+  }
+}
+
+static void __scheduleCounts( iOControlData data, iONode plan ) {
+  data->schedAcCnt  = __childCnt( wPlan.getaclist( plan ) );
+  data->schedVrCnt  = __childCnt( wPlan.getvrlist( plan ) );
+  data->schedSysCnt = __childCnt( wPlan.getsystem( plan ) );
+}
+
+/* Items added to the plan without ModelOp.addItem/removeItem are caught by the list sizes. */
+static Boolean __scheduleStale( iOControlData data, iONode plan ) {
+  return plan != data->schedPlan ||
+         data->schedAcCnt  != __childCnt( wPlan.getaclist( plan ) ) ||
+         data->schedVrCnt  != __childCnt( wPlan.getvrlist( plan ) ) ||
+         data->schedSysCnt != __childCnt( wPlan.getsystem( plan ) );
+}
+
+static void __buildSchedule( iOControlData data, iOModel model, iONode plan ) {
+  iONode aclist  = wPlan.getaclist( plan );
+  iONode varlist = wPlan.getvrlist( plan );
+  iOList list = (iOList)MapOp.first( data->schedAt );
+  char* key = NULL;
+
+  while( list != NULL ) {
+    __freeIds( list );
+    ListOp.base.del( list );
+    list = (iOList)MapOp.next( data->schedAt );
+  }
+  MapOp.clear( data->schedAt );
+  __freeIds( data->schedTick );
+  key = (char*)MapOp.first( data->schedKey );
+  while( key != NULL ) {
+    StrOp.free( key );
+    key = (char*)MapOp.next( data->schedKey );
+  }
+  MapOp.clear( data->schedKey );
+  MapOp.clear( data->schedVars );
+
+  if( aclist != NULL ) {
+    iONode action = wActionList.getac( aclist );
+    while( action != NULL ) {
+      iOAction act = ModelOp.getAction( model, wAction.getid( action ) );
+      if( act != NULL )
+        __scheduleAction( data, (iONode)ActionOp.base.properties( act ) );
+      action = wActionList.nextac( aclist, action );
+    }
+  }
+
+  if( varlist != NULL ) {
+    iONode var = wVariableList.getvr( varlist );
+    while( var != NULL ) {
+      if( wVariable.istimer( var ) && wVariable.getid( var ) != NULL )
+        MapOp.put( data->schedVars, wVariable.getid( var ), (obj)var );
+      var = wVariableList.nextvr( varlist, var );
+    }
+  }
+
+  __scheduleSystem( data, plan );
+  __scheduleCounts( data, plan );
+  data->schedPlan = plan;
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "clock schedule: %d minutes, %d tick actions, %d timers, %d system states",
+      MapOp.size( data->schedAt ), ListOp.size( data->schedTick ), MapOp.size( data->schedVars ), MapOp.size( data->schedSys ) );
+}
+
+static void _reschedule( iOControl inst, iONode item ) {
+  iOControlData data = Data(inst);
+  iOModel model = AppOp.getModel();
+  iONode  plan  = model != NULL ? ModelOp.getModel( model ):NULL;
+
+  if( plan == NULL )
+    return;
+
+  MutexOp.wait( data->schedMux );
+  if( item == NULL || plan != data->schedPlan ) {
+    __buildSchedule( data, model, plan );
+  }
+  else if( StrOp.equals( wAction.name(), NodeOp.getName( item ) ) ) {
+    iOAction act = ModelOp.getAction( model, wAction.getid( item ) );
+    __unscheduleAction( data, wItem.getprev_id( item ) );
+    if( act != NULL )
+      __scheduleAction( data, (iONode)ActionOp.base.properties( act ) );
+    else
+      __unscheduleAction( data, wAction.getid( item ) );
+    __scheduleCounts( data, plan );
+  }
+  else if( StrOp.equals( wVariable.name(), NodeOp.getName( item ) ) ) {
+    __scheduleVariable( data, model, wVariable.getid( item ) );
+    __scheduleCounts( data, plan );
+  }
+  else if( StrOp.equals( wSystemActions.name(), NodeOp.getName( item ) ) ) {
+    __scheduleSystem( data, plan );
+    __scheduleCounts( data, plan );
+  }
+  MutexOp.post( data->schedMux );
+}
+
+
 /* Model seconds */
 static void __checkActions( iOControl control, int seconds ) {
   iOModel model = AppOp.getModel();
   iOControlData data = Data(control);
+  unsigned long t0 = MetricsOp.now();
 
   char state[64] = {'\0'};
   struct tm* ltm = localtime( &data->time );
@@ -1417,53 +1658,70 @@ static void __checkActions( iOControl control, int seconds ) {
   if( model != NULL ) {
     iONode plan   = ModelOp.getModel( model );
     if( plan != NULL ) {
-      iONode aclist = wPlan.getaclist(plan);
-      iONode varlist = wPlan.getvrlist(plan);
-      if( aclist != NULL ) {
-        iONode action = wActionList.getac( aclist );
-        while( action != NULL ) {
-          iOAction act = ModelOp.getAction(model, wAction.getid(action));
-          if( act != NULL )
-            ActionOp.tick(act, seconds);
-          action = wActionList.nextac( aclist, action );
-        };
+      iOList acts  = ListOp.inst();
+      iOList vars  = ListOp.inst();
+      iOList ctrls = ListOp.inst();
+      iOList list  = NULL;
+      iONode var   = NULL;
+      int i = 0;
+
+      /* Only collect the due items under the lock: running them may modify the plan. */
+      MutexOp.wait( data->schedMux );
+      if( __scheduleStale( data, plan ) )
+        __buildSchedule( data, model, plan );
+
+      list = (iOList)MapOp.get( data->schedAt, state );
+      for( i = 0; list != NULL && i < ListOp.size( list ); i++ ) {
+        iOAction act = ModelOp.getAction( model, (const char*)ListOp.get( list, i ) );
+        if( act != NULL )
+          ListOp.add( acts, (obj)act );
       }
-      if( varlist != NULL ) {
-        iONode var = wVariableList.getvr( varlist );
-        while( var != NULL ) {
-          if( wVariable.istimer(var) ) {
-            wVariable.setvalue(var, wVariable.getvalue(var) + 1);
-            VarOp.checkActions(var);
-          }
-          var = wVariableList.nextvr( varlist, var );
-        };
+      for( i = 0; i < ListOp.size( data->schedTick ); i++ ) {
+        iOAction act = ModelOp.getAction( model, (const char*)ListOp.get( data->schedTick, i ) );
+        if( act != NULL )
+          ListOp.add( acts, (obj)act );
+      }
+
+      var = (iONode)MapOp.first( data->schedVars );
+      while( var != NULL ) {
+        ListOp.add( vars, (obj)var );
+        var = (iONode)MapOp.next( data->schedVars );
       }
 
       if( seconds == 60 ) {
-        iONode system = wPlan.getsystem(plan);
-        if( system != NULL ) {
-          iONode action = wSystemActions.getactionctrl(system);
-          /* loop over all actions */
-          while( action != NULL ) {
-            if( StrOp.equals(state, wActionCtrl.getstate( action )) )
-            {
-              iOAction Action = ModelOp.getAction(model, wActionCtrl.getid( action ));
-              if( Action != NULL ) {
-                ActionOp.exec(Action, action);
-              }
-            }
-            else {
-              TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "action state does not match: [%s-%s]",
-                  wActionCtrl.getstate( action ), state );
-            }
-            action = wSystemActions.nextactionctrl( system, action );
-          }
+        list = (iOList)MapOp.get( data->schedSys, state );
+        for( i = 0; list != NULL && i < ListOp.size( list ); i++ )
+          ListOp.add( ctrls, ListOp.get( list, i ) );
+      }
+      MutexOp.post( data->schedMux );
+
+      for( i = 0; i < ListOp.size( acts ); i++ )
+        ActionOp.tick( (iOAction)ListOp.get( acts, i ), seconds );
+
+      for( i = 0; i < ListOp.size( vars ); i++ ) {
+        var = (iONode)ListOp.get( vars, i );
+        /* an action of this tick may have stopped it */
+        if( wVariable.istimer(var) ) {
+          wVariable.setvalue(var, wVariable.getvalue(var) + 1);
+          VarOp.checkActions(var);
         }
       }
 
+      for( i = 0; i < ListOp.size( ctrls ); i++ ) {
+        iONode action = (iONode)ListOp.get( ctrls, i );
+        iOAction Action = ModelOp.getAction(model, wActionCtrl.getid( action ));
+        if( Action != NULL ) {
+          ActionOp.exec(Action, action);
+        }
+      }
+
+      ListOp.base.del( acts );
+      ListOp.base.del( vars );
+      ListOp.base.del( ctrls );
     }
   }
 
+  MetricsOp.since( __mClockActions, t0 );
 }
 
 
@@ -1707,6 +1965,21 @@ static iOControl _inst( Boolean nocom ) {
     data->diMap = MapOp.inst();
     data->enablecom = True;
 
+    data->schedMux  = MutexOp.inst( NULL, True );
+    data->schedAt   = MapOp.inst();
+    data->schedTick = ListOp.inst();
+    data->schedKey  = MapOp.inst();
+    data->schedVars = MapOp.inst();
+    data->schedSys  = MapOp.inst();
+
+    __mDispatch = MetricsOp.histogram( "control_dispatch_us", "Digint event handling in microseconds." );
+    __mDiEvents = MetricsOp.counter( "digint_events_total", "Events read from the digints." );
+    __mDiCmds   = MetricsOp.counter( "digint_commands_total", "Commands written to the digints." );
+    __mDiCmdUs  = MetricsOp.histogram( "digint_command_us", "Digint command call in microseconds." );
+    __mClockActions = MetricsOp.histogram( "clock_actions_us", "Model clock tick of actions and timers in microseconds." );
+    __sControl = SpanOp.stage( "control" );
+    __sDigInt  = SpanOp.stage( "digint" );
+
     if( !wRocRail.isnodevcheck(ini) )
       data->devlist = DevicesOp.getDevicesStr();
 
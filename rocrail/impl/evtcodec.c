@@ -0,0 +1,677 @@
+/*
+ Rocrail - Model Railroad Software
+
+ Copyright (C) 2002-2014 Rob Versluis, Rocrail.net
+
+
+
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rocrail/impl/evtcodec_impl.h"
+
+#include "rocs/public/trace.h"
+#include "rocs/public/node.h"
+#include "rocs/public/attr.h"
+#include "rocs/public/mem.h"
+#include "rocs/public/str.h"
+
+#include "rocrail/wrapper/public/Loc.h"
+#include "rocrail/wrapper/public/FunCmd.h"
+#include "rocrail/wrapper/public/Feedback.h"
+#include "rocrail/wrapper/public/Switch.h"
+#include "rocrail/wrapper/public/Signal.h"
+#include "rocrail/wrapper/public/Output.h"
+#include "rocrail/wrapper/public/Block.h"
+#include "rocrail/wrapper/public/Text.h"
+
+static int instCnt = 0;
+
+/* Frame layout:
+     byte    0x10 | delta flag
+     varint  event type (index in the type table + 1)
+     varint  field count
+     fields  varint (field id << 3 | kind) followed by the value
+   The field id is the index in the sorted attribute table generated by wgen
+   from wrapper.xml; attributes unknown to the schema travel by name.
+   A delta frame holds the id and the changed and removed attributes only.
+   A loco event flagged delta holds the changed attributes only: absent ones
+   are unchanged, so it neither clears nor removes anything from the base. */
+static const char* encoding = "bin1";
+
+#define FRAME_MAGIC  0x10
+#define FRAME_DELTA  0x01
+
+#define KIND_STR   0
+#define KIND_INT   1
+#define KIND_TRUE  2
+#define KIND_FALSE 3
+#define KIND_DEL   4
+#define KIND_XSTR  5
+#define KIND_XDEL  6
+
+#define MAXTYPES 8
+
+struct __evttype {
+  const char* name;
+  struct __attrdef** attrs;
+  int cnt;
+};
+
+/* The last event per key is kept by field id, so a delta costs no node copies. */
+struct __evtbase {
+  struct __evttype* type;
+  char**  val;    /* one per schema field, NULL if absent */
+  byte*   seen;   /* scratch for the delta */
+  iONode  extra;  /* attributes unknown to the schema */
+};
+typedef struct __evtbase* __iOEvtBase;
+
+static void __delBase( struct __evttype* type, __iOEvtBase base );
+
+#ifdef __GNUC__
+  #define CODEC_CAS(p,o,n) __sync_bool_compare_and_swap( (p), (o), (n) )
+  #define CODEC_SYNC()     __sync_synchronize()
+#else
+  #define CODEC_CAS(p,o,n) ( *(p) = (n), 1 )
+  #define CODEC_SYNC()
+#endif
+
+static struct __evttype evtTypes[MAXTYPES];
+static int evtTypeCnt = 0;
+static char schemaId[16] = {'\0'};
+static iOMutex typesMux = NULL;
+static volatile Boolean typesReady = False;
+
+/*
+ ***** OBase functions.
+ */
+static const char* __id( void* inst ) {
+  return NULL;
+}
+
+static void* __event( void* inst, const void* evt ) {
+  return NULL;
+}
+
+static const char* __name(void) {
+  return name;
+}
+static unsigned char* __serialize(void* inst, long* size) {
+  return NULL;
+}
+static void __deserialize(void* inst, unsigned char* a) {
+}
+static char* __toString(void* inst) {
+  return "";
+}
+static void __del(void* inst) {
+  iOEvtCodecData data = Data(inst);
+  __iOEvtBase base = (__iOEvtBase)MapOp.first( data->base );
+  while( base != NULL ) {
+    __delBase( base->type, base );
+    base = (__iOEvtBase)MapOp.next( data->base );
+  }
+  MapOp.base.del( data->base );
+  freeMem( data );
+  freeMem( inst );
+  instCnt--;
+}
+static void* __properties(void* inst) {
+  return NULL;
+}
+static struct OBase* __clone( void* inst ) {
+  return NULL;
+}
+static Boolean __equals( void* inst1, void* inst2 ) {
+  return False;
+}
+static int __count(void) {
+  return instCnt;
+}
+
+
+/*
+ ***** _Private functions.
+ */
+static void __addType( const char* typeName, struct __attrdef** attrs ) {
+  struct __evttype* type = &evtTypes[evtTypeCnt++];
+  type->name  = typeName;
+  type->attrs = attrs;
+  type->cnt   = 0;
+  while( attrs[type->cnt] != NULL )
+    type->cnt++;
+}
+
+
+/* The type table and schema id are built once from the generated wrappers;
+   the first caller builds them under the lock, the others wait for it. */
+static void __initTypes( void ) {
+  unsigned long hash = 2166136261UL;
+  int i = 0;
+
+  if( typesReady )
+    return;
+
+  if( typesMux == NULL ) {
+    iOMutex mux = MutexOp.inst( NULL, True );
+    /* a racing second caller drops its lock */
+    if( !CODEC_CAS( &typesMux, NULL, mux ) )
+      MutexOp.base.del( mux );
+  }
+  MutexOp.wait( typesMux );
+  if( typesReady ) {
+    MutexOp.post( typesMux );
+    return;
+  }
+
+  __addType( wLoc.name(), wLoc.schema() );
+  __addType( wFunCmd.name(), wFunCmd.schema() );
+  __addType( wFeedback.name(), wFeedback.schema() );
+  __addType( wSwitch.name(), wSwitch.schema() );
+  __addType( wSignal.name(), wSignal.schema() );
+  __addType( wOutput.name(), wOutput.schema() );
+  __addType( wBlock.name(), wBlock.schema() );
+  __addType( wText.name(), wText.schema() );
+
+  /* FNV-1a over type names, attribute names and value types */
+  for( i = 0; i < evtTypeCnt; i++ ) {
+    int n = 0;
+    const char* s = evtTypes[i].name;
+    while( *s != '\0' ) { hash = ((hash ^ (byte)*s++) * 16777619UL) & 0xFFFFFFFFUL; }
+    for( n = 0; n < evtTypes[i].cnt; n++ ) {
+      s = evtTypes[i].attrs[n]->name;
+      while( *s != '\0' ) { hash = ((hash ^ (byte)*s++) * 16777619UL) & 0xFFFFFFFFUL; }
+      s = evtTypes[i].attrs[n]->vtype;
+      while( *s != '\0' ) { hash = ((hash ^ (byte)*s++) * 16777619UL) & 0xFFFFFFFFUL; }
+    }
+  }
+  StrOp.fmtb( schemaId, "%08lX", hash );
+
+  /* the table is complete before a caller skips the lock */
+  CODEC_SYNC();
+  typesReady = True;
+  MutexOp.post( typesMux );
+}
+
+
+static int __getType( const char* typeName ) {
+  int i = 0;
+  for( i = 0; i < evtTypeCnt; i++ ) {
+    if( StrOp.equals( evtTypes[i].name, typeName ) )
+      return i;
+  }
+  return -1;
+}
+
+
+/* wgen sorts the attributes with strcmp; binary search with the same order */
+static int __getField( struct __evttype* type, const char* attrName ) {
+  int lo = 0;
+  int hi = type->cnt - 1;
+  while( lo <= hi ) {
+    int mid = (lo + hi) / 2;
+    int c = strcmp( type->attrs[mid]->name, attrName );
+    if( c == 0 )
+      return mid;
+    if( c < 0 )
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
+  return -1;
+}
+
+
+/* Canonical decimal integers only, so the decoder gives back the same text. */
+static Boolean __isInt( const char* val, long* lval ) {
+  const char* p = val;
+  int digits = 0;
+  if( *p == '-' )
+    p++;
+  if( *p == '0' && (p[1] != '\0' || p != val) )
+    return False;
+  while( *p >= '0' && *p <= '9' ) {
+    p++;
+    digits++;
+  }
+  if( *p != '\0' || digits == 0 || digits > 9 )
+    return False;
+  *lval = atol( val );
+  return True;
+}
+
+
+typedef struct {
+  byte* buf;
+  int   len;
+  int   size;
+} __frame;
+
+static void __put( __frame* f, const byte* b, int len ) {
+  if( f->len + len > f->size ) {
+    while( f->len + len > f->size )
+      f->size *= 2;
+    f->buf = reallocMem( f->buf, f->size );
+  }
+  MemOp.copy( f->buf + f->len, b, len );
+  f->len += len;
+}
+
+static void __putVarint( __frame* f, unsigned long val ) {
+  byte b[10];
+  int n = 0;
+  do {
+    b[n] = (byte)(val & 0x7F);
+    val >>= 7;
+    if( val != 0 )
+      b[n] |= 0x80;
+    n++;
+  } while( val != 0 );
+  __put( f, b, n );
+}
+
+static void __putStr( __frame* f, const char* s ) {
+  int len = StrOp.len( s );
+  __putVarint( f, len );
+  __put( f, (const byte*)s, len );
+}
+
+static void __putAttr( __frame* f, struct __evttype* type, const char* attrName, const char* val ) {
+  int field = __getField( type, attrName );
+  long lval = 0;
+
+  if( field < 0 ) {
+    __putVarint( f, val == NULL ? KIND_XDEL:KIND_XSTR );
+    __putStr( f, attrName );
+    if( val != NULL )
+      __putStr( f, val );
+  }
+  else if( val == NULL ) {
+    __putVarint( f, ((unsigned long)field << 3) | KIND_DEL );
+  }
+  else if( StrOp.equals( "bool", type->attrs[field]->vtype ) && StrOp.equals( "true", val ) ) {
+    __putVarint( f, ((unsigned long)field << 3) | KIND_TRUE );
+  }
+  else if( StrOp.equals( "bool", type->attrs[field]->vtype ) && StrOp.equals( "false", val ) ) {
+    __putVarint( f, ((unsigned long)field << 3) | KIND_FALSE );
+  }
+  else if( (StrOp.equals( "int", type->attrs[field]->vtype ) || StrOp.equals( "long", type->attrs[field]->vtype ))
+           && __isInt( val, &lval ) )
+  {
+    __putVarint( f, ((unsigned long)field << 3) | KIND_INT );
+    /* zigzag */
+    __putVarint( f, lval < 0 ? ((unsigned long)(-(lval + 1)) << 1) | 1:(unsigned long)lval << 1 );
+  }
+  else {
+    __putVarint( f, ((unsigned long)field << 3) | KIND_STR );
+    __putStr( f, val );
+  }
+}
+
+
+static Boolean __getVarint( const byte* frame, int size, int* pos, unsigned long* val ) {
+  int shift = 0;
+  *val = 0;
+  while( *pos < size && shift < 35 ) {
+    byte b = frame[(*pos)++];
+    *val |= (unsigned long)(b & 0x7F) << shift;
+    if( (b & 0x80) == 0 )
+      return True;
+    shift += 7;
+  }
+  return False;
+}
+
+/* returns an allocated string */
+static char* __getStr( const byte* frame, int size, int* pos ) {
+  unsigned long len = 0;
+  char* s = NULL;
+  if( !__getVarint( frame, size, pos, &len ) || len > (unsigned long)(size - *pos) )
+    return NULL;
+  s = allocMem( len + 1 );
+  MemOp.copy( s, frame + *pos, len );
+  *pos += len;
+  return s;
+}
+
+
+static __iOEvtBase __newBase( struct __evttype* type ) {
+  __iOEvtBase base = allocMem( sizeof( struct __evtbase ) );
+  base->type = type;
+  base->val  = allocMem( (type->cnt + 1) * sizeof( char* ) );
+  base->seen = allocMem( type->cnt + 1 );
+  return base;
+}
+
+static void __clearBase( struct __evttype* type, __iOEvtBase base ) {
+  int i = 0;
+  for( i = 0; i < type->cnt; i++ ) {
+    StrOp.free( base->val[i] );
+    base->val[i] = NULL;
+  }
+  if( base->extra != NULL ) {
+    NodeOp.base.del( base->extra );
+    base->extra = NULL;
+  }
+}
+
+static void __delBase( struct __evttype* type, __iOEvtBase base ) {
+  __clearBase( type, base );
+  freeMem( base->val );
+  freeMem( base->seen );
+  freeMem( base );
+}
+
+static void __setVal( __iOEvtBase base, int field, const char* val ) {
+  if( StrOp.equals( val, base->val[field] ) )
+    return;
+  StrOp.free( base->val[field] );
+  base->val[field] = val != NULL ? StrOp.dup( val ):NULL;
+}
+
+static void __setExtra( __iOEvtBase base, const char* attrName, const char* val ) {
+  if( base->extra == NULL )
+    base->extra = NodeOp.inst( "extra", NULL, ELEMENT_NODE );
+  if( val != NULL )
+    NodeOp.setStr( base->extra, attrName, val );
+  else
+    NodeOp.removeAttrByName( base->extra, attrName );
+}
+
+/*
+ ***** _Public functions.
+ */
+static const char* _getEncoding( void ) {
+  return encoding;
+}
+
+
+static const char* _getSchemaId( void ) {
+  __initTypes();
+  return schemaId;
+}
+
+
+static char* _getKey( iONode evt ) {
+  const char* id = NodeOp.getStr( evt, "id", NULL );
+  if( id == NULL )
+    return NULL;
+  return StrOp.fmt( "%s:%s", NodeOp.getName( evt ), id );
+}
+
+
+static byte* _encode( iOEvtCodec inst, iONode evt, Boolean delta, int* size ) {
+  iOEvtCodecData data = Data(inst);
+  int      typeIdx = __getType( NodeOp.getName( evt ) );
+  struct __evttype* type = NULL;
+  const char*   id = NULL;
+  char*        key = NULL;
+  __iOEvtBase base = NULL;
+  Boolean  partial = False;
+  int          cnt = 0;
+  int       cntPos = 0;
+  __frame f;
+  int i = 0;
+
+  if( typeIdx < 0 || NodeOp.getChildCnt( evt ) > 0 )
+    return NULL;
+  type = &evtTypes[typeIdx];
+  partial = StrOp.equals( wLoc.name(), type->name ) && wLoc.isdelta( evt );
+
+  id  = NodeOp.getStr( evt, "id", NULL );
+  key = _getKey( evt );
+  if( key != NULL ) {
+    base = (__iOEvtBase)MapOp.get( data->base, key );
+    if( base == NULL ) {
+      base = __newBase( type );
+      MapOp.put( data->base, key, (obj)base );
+      delta = False;
+    }
+    StrOp.free( key );
+  }
+  else
+    delta = False;
+
+  f.size = 128;
+  f.len  = 0;
+  f.buf  = allocMem( f.size );
+  f.buf[f.len++] = FRAME_MAGIC | (delta ? FRAME_DELTA:0);
+  __putVarint( &f, typeIdx + 1 );
+
+  /* the count is patched in below; reserve a two byte varint for it */
+  cntPos = f.len;
+  f.len += 2;
+
+  /* the id always goes first; the decoder finds the base with it */
+  if( id != NULL ) {
+    __putAttr( &f, type, "id", id );
+    cnt++;
+  }
+
+  if( base != NULL && !delta && !partial )
+    __clearBase( type, base );
+  if( base != NULL )
+    MemOp.set( base->seen, 0, type->cnt );
+
+  for( i = 0; i < NodeOp.getAttrCnt( evt ); i++ ) {
+    iOAttr attr = NodeOp.getAttr( evt, i );
+    const char* attrName = AttrOp.getName( attr );
+    const char* val = AttrOp.getVal( attr );
+    int field = __getField( type, attrName );
+
+    if( field >= 0 && base != NULL )
+      base->seen[field] = 1;
+
+    if( StrOp.equals( "id", attrName ) ) {
+      if( base != NULL && field >= 0 )
+        __setVal( base, field, val );
+      else if( base != NULL )
+        __setExtra( base, attrName, val );
+      continue;
+    }
+
+    if( base != NULL && field >= 0 ) {
+      if( delta && StrOp.equals( val, base->val[field] ) )
+        continue;
+      __setVal( base, field, val );
+    }
+    else if( base != NULL ) {
+      if( delta && base->extra != NULL && StrOp.equals( val, NodeOp.getStr( base->extra, attrName, NULL ) ) )
+        continue;
+      __setExtra( base, attrName, val );
+    }
+    __putAttr( &f, type, attrName, val );
+    cnt++;
+  }
+
+  if( base != NULL && !partial ) {
+    /* attributes which are gone since the last event */
+    for( i = 0; i < type->cnt; i++ ) {
+      if( base->val[i] != NULL && !base->seen[i] ) {
+        __putAttr( &f, type, type->attrs[i]->name, NULL );
+        __setVal( base, i, NULL );
+        cnt++;
+      }
+    }
+    if( base->extra != NULL ) {
+      for( i = NodeOp.getAttrCnt( base->extra ) - 1; i >= 0; i-- ) {
+        iOAttr attr = NodeOp.getAttr( base->extra, i );
+        if( NodeOp.findAttr( evt, AttrOp.getName( attr ) ) == NULL ) {
+          __putAttr( &f, type, AttrOp.getName( attr ), NULL );
+          NodeOp.removeAttr( base->extra, attr );
+          cnt++;
+        }
+      }
+    }
+  }
+
+  if( cnt > 0x3FFF ) {
+    freeMem( f.buf );
+    return NULL;
+  }
+  f.buf[cntPos]   = (byte)((cnt & 0x7F) | 0x80);
+  f.buf[cntPos+1] = (byte)(cnt >> 7);
+
+  *size = f.len;
+  return f.buf;
+}
+
+
+static Boolean _isDelta( const byte* frame ) {
+  return (frame[0] & FRAME_DELTA) ? True:False;
+}
+
+
+static iONode _decode( iOEvtCodec inst, const byte* frame, int size ) {
+  iOEvtCodecData data = Data(inst);
+  struct __evttype* type = NULL;
+  __iOEvtBase base = NULL;
+  Boolean   temp = False;
+  iONode     evt = NULL;
+  unsigned long typeIdx = 0;
+  unsigned long cnt = 0;
+  Boolean  delta = False;
+  Boolean     ok = True;
+  int        pos = 1;
+  unsigned long i = 0;
+
+  if( size < 1 || (frame[0] & 0xF0) != FRAME_MAGIC ) {
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "unknown frame" );
+    return NULL;
+  }
+  __initTypes();
+  delta = _isDelta( frame );
+
+  if( !__getVarint( frame, size, &pos, &typeIdx ) || typeIdx < 1 || typeIdx > (unsigned long)evtTypeCnt ||
+      !__getVarint( frame, size, &pos, &cnt ) )
+  {
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "invalid frame header" );
+    return NULL;
+  }
+  type = &evtTypes[typeIdx-1];
+
+  for( i = 0; ok && i < cnt; i++ ) {
+    unsigned long fkey = 0;
+    int    field = -1;
+    int     kind = 0;
+    char* xname = NULL;
+    char*   val = NULL;
+    char  ival[32];
+
+    ok = __getVarint( frame, size, &pos, &fkey );
+    kind = (int)(fkey & 0x07);
+    if( ok && kind < KIND_XSTR ) {
+      field = (int)(fkey >> 3);
+      ok = field < type->cnt ? True:False;
+    }
+    else if( ok && (kind == KIND_XSTR || kind == KIND_XDEL) ) {
+      xname = __getStr( frame, size, &pos );
+      ok = xname != NULL ? True:False;
+    }
+    else
+      ok = False;
+
+    if( ok && (kind == KIND_STR || kind == KIND_XSTR) ) {
+      val = __getStr( frame, size, &pos );
+      ok = val != NULL ? True:False;
+    }
+    else if( ok && kind == KIND_INT ) {
+      unsigned long zz = 0;
+      ok = __getVarint( frame, size, &pos, &zz );
+      StrOp.fmtb( ival, "%ld", (zz & 1) ? -(long)(zz >> 1) - 1:(long)(zz >> 1) );
+    }
+
+    /* the first field is the id if the event has one */
+    if( ok && i == 0 ) {
+      const char* attrName = field >= 0 ? type->attrs[field]->name:xname;
+      if( StrOp.equals( "id", attrName ) && (kind == KIND_STR || kind == KIND_XSTR || kind == KIND_INT) ) {
+        char* key = StrOp.fmt( "%s:%s", type->name, kind == KIND_INT ? ival:val );
+        base = (__iOEvtBase)MapOp.get( data->base, key );
+        if( base == NULL && !delta ) {
+          base = __newBase( type );
+          MapOp.put( data->base, key, (obj)base );
+        }
+        StrOp.free( key );
+      }
+      else if( !delta ) {
+        base = __newBase( type );
+        temp = True;
+      }
+      if( base == NULL ) {
+        TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "no base event for %s delta", type->name );
+        ok = False;
+      }
+      else if( !delta )
+        __clearBase( type, base );
+    }
+
+    if( ok ) {
+      const char* v = kind == KIND_INT ? ival:(kind == KIND_TRUE ? "true":(kind == KIND_FALSE ? "false":val));
+      if( field >= 0 )
+        __setVal( base, field, kind == KIND_DEL ? NULL:v );
+      else
+        __setExtra( base, xname, kind == KIND_XDEL ? NULL:v );
+    }
+    freeMem( xname );
+    freeMem( val );
+  }
+
+  if( ok && base != NULL ) {
+    evt = NodeOp.inst( type->name, NULL, ELEMENT_NODE );
+    for( i = 0; i < (unsigned long)type->cnt; i++ ) {
+      if( base->val[i] != NULL )
+        NodeOp.setStr( evt, type->attrs[i]->name, base->val[i] );
+    }
+    if( base->extra != NULL ) {
+      for( i = 0; i < (unsigned long)NodeOp.getAttrCnt( base->extra ); i++ ) {
+        iOAttr attr = NodeOp.getAttr( base->extra, i );
+        NodeOp.setStr( evt, AttrOp.getName( attr ), AttrOp.getVal( attr ) );
+      }
+    }
+  }
+  else if( !ok ) {
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "invalid %s frame of %d bytes", type->name, size );
+  }
+
+  if( temp )
+    __delBase( type, base );
+  return evt;
+}
+
+
+static iOEvtCodec _inst( void ) {
+  iOEvtCodec     codec = allocMem( sizeof( struct OEvtCodec ) );
+  iOEvtCodecData data  = allocMem( sizeof( struct OEvtCodecData ) );
+
+  /* OBase operations */
+  MemOp.basecpy( codec, &EvtCodecOp, 0, sizeof( struct OEvtCodec ), data );
+
+  __initTypes();
+  data->base = MapOp.inst();
+
+  instCnt++;
+
+  return codec;
+}
+
+
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
+#include "rocrail/impl/evtcodec.fm"
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
@@ -41,6 +41,7 @@
 #include "rocs/public/mem.h"
 #include "rocs/public/str.h"
 #include "rocs/public/system.h"
+#include "rocs/public/span.h"
 
 #include "rocrail/wrapper/public/Feedback.h"
 #include "rocrail/wrapper/public/ActionCtrl.h"
@@ -60,6 +61,7 @@
 
 
 static int instCnt = 0;
+static int __sFBack = -1;
 
 /*
  ***** OBase functions.
@@ -384,6 +386,9 @@ static void _event( iOFBack inst, iONode nodeC ) {
   iOFBackData data = Data(inst);
   Boolean hasListener = False;
   Boolean state = wFeedback.isstate( nodeC );
+  long span = SpanOp.isEnabled() ? wFeedback.getspan( nodeC ):0;
+
+  SpanOp.mark( span, __sFBack );
 
   if( TraceOp.getLevel(NULL) & TRCLEVEL_DEBUG ) {
     char* strNode = (char*)NodeOp.base.toString( nodeC );
@@ -484,6 +489,10 @@ static void _event( iOFBack inst, iONode nodeC ) {
                FBackOp.getId(inst), data->state?"ON":"OFF", wFeedback.getidentifier( nodeC ), wFeedback.isdirection( nodeC )?"fwd":"rev",
                wFeedback.getval( nodeC ), data->counter );
 
+  /* the blocks and locos reacting in this thread continue the span */
+  if( span != 0 )
+    SpanOp.setCurrent( span );
+
   /* Call listener. */
   if( data->listenerFun != NULL ) {
     data->listenerFun( data->listenerObj, data->state, FBackOp.getId( inst ),
@@ -507,6 +516,9 @@ static void _event( iOFBack inst, iONode nodeC ) {
   __ctcAction( inst );
   __checkAction( inst );
 
+  if( span != 0 )
+    SpanOp.setCurrent( 0 );
+
   if(!hasListener) {
     TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "fb[%s] (%s) ident=%s val=%d count=%d has no listener...",
                  FBackOp.getId(inst), data->state?"ON":"OFF",
@@ -682,6 +694,9 @@ static iOFBack _inst( iONode props ) {
 
   data->listeners = ListOp.inst();
 
+  if( __sFBack == -1 )
+    __sFBack = SpanOp.stage( "fback" );
+
   data->addrKey = _createAddrKey(
     wFeedback.getbus( props ),
     wFeedback.getaddr( props ),
@@ -20,6 +20,11 @@
  along with this program; if not, write to the Free Software
  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
+#if defined __linux__ && !defined _ISOC99_SOURCE
+  /* vsnprintf() under -ansi */
+  #define _ISOC99_SOURCE
+#endif
+
 #include "rocrail/public/model.h"
 #include "rocrail/public/clntcon.h"
 #include "rocrail/public/loc.h"
@@ -36,8 +41,15 @@
 #include "rocs/public/file.h"
 #include "rocs/public/thread.h"
 #include "rocs/public/map.h"
+#include "rocs/public/mutex.h"
 #include "rocs/public/strtok.h"
 #include "rocs/public/dir.h"
+#include "rocs/public/metrics.h"
+#include "rocs/public/span.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
 
 static int instCnt = 0;
 
@@ -50,7 +62,7 @@ static void* __event( void* inst, const void* evt ) {
   return NULL;
 }
 
-static void __del( void* inst ) {
+static void __free( void* inst ) {
   if( inst != NULL ) {
     iOHClientData data = Data(inst);
     /* Cleanup data->xxx members...*/
@@ -60,6 +72,8 @@ static void __del( void* inst ) {
       SocketOp.base.del( data->socket );
     }
     StrOp.free( data->cid );
+    freeMem( data->rcptBuffer );
+    freeMem( data->rsp );
 
     freeMem( data );
     freeMem( inst );
@@ -68,6 +82,21 @@ static void __del( void* inst ) {
   return;
 }
 
+/* An event client is freed by its writer after the queued frames are gone. */
+static void __del( void* inst ) {
+  if( inst != NULL ) {
+    iOHClientData data = Data(inst);
+    if( data->writer != NULL ) {
+      ThreadOp.requestQuit( data->writer );
+      /* wake it up */
+      ThreadOp.post( data->writer, (obj)allocMem( 1 ) );
+    }
+    else
+      __free( inst );
+  }
+  return;
+}
+
 static const char* __name( void ) {
   return name;
 }
@@ -131,26 +160,118 @@ unsigned char rocrail_gif[] = {
 
 int rocrail_gif_len = sizeof(rocrail_gif);
 
-static void __httpHeader( iOSocket s ) {
-  SocketOp.fmt( s, "HTTP/1.0 200 OK\r\n" );
-  SocketOp.fmt( s, "Content-type: text/html\r\n\r\n" );
+/* Room in front of the response body for the status line and headers. */
+#define HTTP_HEADROOM  256
+#define HTTP_RSPSIZE   8192
+#define HTTP_RCPTSIZE  4096
+#define HTTP_POSTSIZE  1024
+/* Static file cache limits. */
+#define HTTP_MAXCACHED (1024*1024)
+#define HTTP_MAXFILES  256
+/* Seconds to receive a complete request, header and body. */
+#define HTTP_REQTIMEOUT 5
+/* Seconds a blocked event stream write may take before the client is dropped. */
+#define HTTP_SSE_SNDTIMEOUT 5
+
+struct __HttpFile {
+  char* buf;
+  long  size;
+  long  mtime;
+};
+
+static iOMap   fileCache = NULL;
+static iOMutex fileMux   = NULL;
+
+
+/* Make room for len more body bytes plus a terminating zero. */
+static void __reserve( iOHClientData data, int len ) {
+  int need = HTTP_HEADROOM + data->rspLen + len + 1;
+  if( need > data->rspSize ) {
+    int size = data->rspSize;
+    while( size < need )
+      size *= 2;
+    data->rsp = reallocMem( data->rsp, size );
+    data->rspSize = size;
+  }
+}
+
+static void __out( iOHClientData data, const char* buf, int len ) {
+  __reserve( data, len );
+  MemOp.copy( data->rsp + HTTP_HEADROOM + data->rspLen, buf, len );
+  data->rspLen += len;
+}
+
+static void __fmt( iOHClientData data, const char* fmt, ... ) {
+  va_list args;
+  int room = 0;
+  int len  = 0;
+
+  __reserve( data, 1024 );
+  room = data->rspSize - HTTP_HEADROOM - data->rspLen;
+  va_start( args, fmt );
+  len = vsnprintf( data->rsp + HTTP_HEADROOM + data->rspLen, room, fmt, args );
+  va_end( args );
+
+  if( len >= room ) {
+    __reserve( data, len );
+    va_start( args, fmt );
+    vsnprintf( data->rsp + HTTP_HEADROOM + data->rspLen, len + 1, fmt, args );
+    va_end( args );
+  }
+  if( len > 0 )
+    data->rspLen += len;
+}
+
+/* Append text with the markup characters escaped. */
+static void __escape( iOHClientData data, const char* str, int len ) {
+  int i = 0;
+  int start = 0;
+  for( i = 0; i < len; i++ ) {
+    if( str[i] == '<' || str[i] == '>' ) {
+      __out( data, str + start, i - start );
+      __out( data, str[i] == '<' ? "&lt;":"&gt;", 4 );
+      start = i + 1;
+    }
+  }
+  __out( data, str + start, len - start );
+}
+
+/* Prepend the status line and headers and send the response with one write. */
+static Boolean __flush( iOHClientData data, Boolean keepalive ) {
+  char hdr[HTTP_HEADROOM];
+  int hlen = 0;
+  Boolean ok = False;
+
+  StrOp.fmtb( hdr, "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\nConnection: %s\r\n\r\n",
+      data->status, data->ctype, data->rspLen, keepalive ? "keep-alive":"close" );
+  hlen = StrOp.len( hdr );
+  MemOp.copy( data->rsp + HTTP_HEADROOM - hlen, hdr, hlen );
+  ok = SocketOp.write( data->socket, data->rsp + HTTP_HEADROOM - hlen, hlen + data->rspLen );
+
+  data->rspLen = 0;
+  data->status = "200 OK";
+  data->ctype  = "text/html";
+  return ok;
+}
+
+static void __httpHeader( iOHClientData data ) {
+  data->ctype = "text/html";
 }
 
 
-static void __header( iOSocket s, int refresh ) {
-  SocketOp.fmt( s, "HTTP/1.0 200 OK\r\n" );
-  SocketOp.fmt( s, "Content-type: text/html\r\n\r\n" );
-  SocketOp.fmt( s, "<html><head><title>Rocrail HTTP Service </title>\n" );
-  SocketOp.fmt( s, "<link href=\"rocrail.gif\" rel=\"short circuit icon\">\n" );
+static void __header( iOHClientData data, int refresh ) {
+  __httpHeader( data );
+  __fmt( data, "<html><head><title>Rocrail HTTP Service </title>\n" );
+  __fmt( data, "<link href=\"rocrail.gif\" rel=\"short circuit icon\">\n" );
   if( refresh > 0 )
-    SocketOp.fmt( s, "<META CONTENT=\"%d\" HTTP-EQUIV=\"refresh\">\n", refresh );
-  SocketOp.fmt( s, "</head><body>\n" );
+    __fmt( data, "<META CONTENT=\"%d\" HTTP-EQUIV=\"refresh\">\n", refresh );
+  __fmt( data, "</head><body>\n" );
 }
 
-static void __footer( iOSocket s ) {
-  SocketOp.fmt( s, "<br><a href=\"/\">Rocrail</a><br>\n" );
-  SocketOp.fmt( s, "<a href=\"mailto:support@rocrail.net\">support@rocrail.net</a>\n" );
-  SocketOp.fmt( s, "</body></html>\n" );
+static void __footer( iOHClientData data ) {
+  __fmt( data, "<br><a href=\"/\">Rocrail</a><br>\n" );
+  __fmt( data, "<a href=\"mailto:support@rocrail.net\">support@rocrail.net</a>\n" );
+  __fmt( data, "</body></html>\n" );
 }
 
 /** ------------------------------------------------------------
@@ -170,7 +291,7 @@ static void __scan4Html( iOHClient inst ) {
     /* Get the first directory entry. */
     fileName = DirOp.read( dir );
 
-    SocketOp.fmt( data->socket, "<table cellpadding=\"4\" cellspacing=\"0\">" );
+    __fmt( data, "<table cellpadding=\"4\" cellspacing=\"0\">" );
 
     /* Iterate all directory entries. */
     while( fileName != NULL ) {
@@ -179,7 +300,7 @@ static void __scan4Html( iOHClient inst ) {
         long size  = FileOp.fileSize( path );
         long ftime = FileOp.fileTime( path );
         StrOp.replaceAll( path, '\\', '/' );
-        SocketOp.fmt( data->socket, "<tr><td><a href=\"%s\">%s</a></td><td align=\"right\">%ld</td><td align=\"right\">%s</td></tr>\n",
+        __fmt( data, "<tr><td><a href=\"%s\">%s</a></td><td align=\"right\">%ld</td><td align=\"right\">%s</td></tr>\n",
                       path, path, size, ctime(&ftime) );
         StrOp.free(path);
       }
@@ -187,7 +308,7 @@ static void __scan4Html( iOHClient inst ) {
       fileName = DirOp.read( dir );
     };
 
-    SocketOp.fmt( data->socket, "</table>\n" );
+    __fmt( data, "</table>\n" );
     /* Close and cleanup. */
     DirOp.close( dir );
     dir->base.del( dir );
@@ -220,7 +341,7 @@ static void __scan4Trc( iOHClient inst ) {
     /* Get the first directory entry. */
     fileName = DirOp.read( dir );
 
-    SocketOp.fmt( data->socket, "<table cellpadding=\"4\" cellspacing=\"0\">" );
+    __fmt( data, "<table cellpadding=\"4\" cellspacing=\"0\">" );
 
     /* Iterate all directory entries. */
     while( fileName != NULL ) {
@@ -231,7 +352,7 @@ static void __scan4Trc( iOHClient inst ) {
         long size  = FileOp.fileSize( realpath );
         long ftime = FileOp.fileTime( realpath );
         StrOp.replaceAll( path, '\\', '/' );
-        SocketOp.fmt( data->socket, "<tr><td><a type=\"text/plain\" href=\"%s\">%s</a></td><td align=\"right\">%ld</td><td align=\"right\">%s</td></tr>\n",
+        __fmt( data, "<tr><td><a type=\"text/plain\" href=\"%s\">%s</a></td><td align=\"right\">%ld</td><td align=\"right\">%s</td></tr>\n",
                       path, path, size, ctime(&ftime) );
         StrOp.free( path );
         StrOp.free( realpath );
@@ -240,7 +361,7 @@ static void __scan4Trc( iOHClient inst ) {
       fileName = DirOp.read( dir );
     };
 
-    SocketOp.fmt( data->socket, "</table>" );
+    __fmt( data, "</table>" );
     /* Close and cleanup. */
     DirOp.close( dir );
     dir->base.del( dir );
@@ -253,9 +374,9 @@ static void __getHome( iOHClient inst ) {
   TraceOp.trc( name, TRCLEVEL_METHOD, __LINE__, 9999, "__getHome( inst=0x%08X )", inst );
   if( inst != NULL ) {
     iOHClientData data = Data(inst);
-    __header( data->socket, data->refresh );
+    __header( data, data->refresh );
 
-    SocketOp.fmt( data->socket, "<h2><a href=\"http://www.rocrail.net\">%s</a> %d.%d.%d-%d %s (%s)</h2>",
+    __fmt( data, "<h2><a href=\"http://www.rocrail.net\">%s</a> %d.%d.%d-%d %s (%s)</h2>",
              wGlobal.productname,
              wGlobal.vmajor,
              wGlobal.vminor,
@@ -264,116 +385,116 @@ static void __getHome( iOHClient inst ) {
              wGlobal.releasename,
              TraceOp.getOS() );
 
-    SocketOp.fmt( data->socket, "<table cellpadding=\"4\">\n" );
-    SocketOp.fmt( data->socket, "<tr><td>\n" );
+    __fmt( data, "<table cellpadding=\"4\">\n" );
+    __fmt( data, "<tr><td>\n" );
 
-    SocketOp.fmt( data->socket, "<table border=\"1\" cellpadding=\"4\" cellspacing= \"0\">\n" );
-    SocketOp.fmt( data->socket, "<tr><td>process id       </td><td>%d    </td></tr>\n", SystemOp.getpid() );
+    __fmt( data, "<table border=\"1\" cellpadding=\"4\" cellspacing= \"0\">\n" );
+    __fmt( data, "<tr><td>process id       </td><td>%d    </td></tr>\n", SystemOp.getpid() );
     {
       long t = AppOp.getStartTime();
-      SocketOp.fmt( data->socket, "<tr><td>started at</td><td>%s</td></tr>\n", ctime( &t ) );
+      __fmt( data, "<tr><td>started at</td><td>%s</td></tr>\n", ctime( &t ) );
     }
 
     char* pwd = FileOp.pwd();
-    SocketOp.fmt( data->socket, "<tr><td>console mode     </td><td>%s   </td></tr>\n", AppOp.isConsoleMode()?"yes":"no" );
-    SocketOp.fmt( data->socket, "<tr><td>working directory</td><td>%s   </td></tr>\n", pwd );
-    SocketOp.fmt( data->socket, "<tr><td>allocation count </td><td>%u   </td></tr>\n", MemOp.getAllocCount() );
-    SocketOp.fmt( data->socket, "<tr><td>allocated memory </td><td>%d MB</td></tr>\n", MemOp.getAllocSize() / (1024*1024) );
-    SocketOp.fmt( data->socket, "<tr><td>clients          </td><td>%d   </td></tr>\n", ClntConOp.getClientCount( AppOp.getClntCon() ) );
-    SocketOp.fmt( data->socket, "<tr><td>connections      </td><td>%d   </td></tr>\n", ClntConOp.getConCount( AppOp.getClntCon() ) );
-    SocketOp.fmt( data->socket, "<tr><td>locos            </td><td>%d   </td></tr>\n", LocOp.base.count() );
+    __fmt( data, "<tr><td>console mode     </td><td>%s   </td></tr>\n", AppOp.isConsoleMode()?"yes":"no" );
+    __fmt( data, "<tr><td>working directory</td><td>%s   </td></tr>\n", pwd );
+    __fmt( data, "<tr><td>allocation count </td><td>%u   </td></tr>\n", MemOp.getAllocCount() );
+    __fmt( data, "<tr><td>allocated memory </td><td>%d MB</td></tr>\n", MemOp.getAllocSize() / (1024*1024) );
+    __fmt( data, "<tr><td>clients          </td><td>%d   </td></tr>\n", ClntConOp.getClientCount( AppOp.getClntCon() ) );
+    __fmt( data, "<tr><td>connections      </td><td>%d   </td></tr>\n", ClntConOp.getConCount( AppOp.getClntCon() ) );
+    __fmt( data, "<tr><td>locos            </td><td>%d   </td></tr>\n", LocOp.base.count() );
     StrOp.free(pwd);
     {
       iOList thList = ThreadOp.getAll();
       int i = 0;
       int cnt = ListOp.size( thList );
-      SocketOp.fmt( data->socket, "<tr><td valign=\"top\">%d threads</td><td>\n", cnt );
-      SocketOp.fmt( data->socket, "<table>\n", cnt );
+      __fmt( data, "<tr><td valign=\"top\">%d threads</td><td>\n", cnt );
+      __fmt( data, "<table>\n", cnt );
       for( i = 0; i < cnt; i++ ) {
         char* bgcolor = i%2==0 ? "bgcolor=\"#DDFFDD\"":"";
         iOThread th = (iOThread)ListOp.get( thList, i );
         const char* tname = ThreadOp.getName( th );
         char* tdesc = ThreadOp.base.toString( th );
-        SocketOp.fmt( data->socket, "<tr %s><td>%s</td><td><small>%s</small></td></tr>\n", bgcolor, tname, tdesc );
+        __fmt( data, "<tr %s><td>%s</td><td><small>%s</small></td></tr>\n", bgcolor, tname, tdesc );
         StrOp.free( tdesc );
       }
-      SocketOp.fmt( data->socket, "</table>\n", cnt );
-      SocketOp.fmt( data->socket, "</td></tr>\n", cnt );
+      __fmt( data, "</table>\n", cnt );
+      __fmt( data, "</td></tr>\n", cnt );
       /* Cleanup. */
       thList->base.del( thList );
     }
 
-    SocketOp.fmt( data->socket, "</table><br>\n" );
+    __fmt( data, "</table><br>\n" );
 
-    SocketOp.fmt( data->socket, "</td><td valign=\"top\">\n" );
+    __fmt( data, "</td><td valign=\"top\">\n" );
 
 
-    SocketOp.fmt( data->socket, "<form action=\"trace\">\n" );
-    SocketOp.fmt( data->socket, "<h3>TraceLevel:</h3>\n" );
+    __fmt( data, "<form action=\"trace\">\n" );
+    __fmt( data, "<h3>TraceLevel:</h3>\n" );
     {
       Boolean debug = TraceOp.getLevel( NULL ) & TRCLEVEL_USER2 ? True:False;
       Boolean dbyte = TraceOp.getLevel( NULL ) & TRCLEVEL_BYTE ? True:False;
-      SocketOp.fmt( data->socket, "Debug<input type=\"checkbox\" name=\"debug\" value=\"%s\" %s>\n",
+      __fmt( data, "Debug<input type=\"checkbox\" name=\"debug\" value=\"%s\" %s>\n",
                debug?"false":"true",
                debug?"checked":"" );
-      SocketOp.fmt( data->socket, "Byte<input type=\"checkbox\" name=\"byte\" value=\"%s\" %s>\n",
+      __fmt( data, "Byte<input type=\"checkbox\" name=\"byte\" value=\"%s\" %s>\n",
                dbyte?"false":"true",
                dbyte?"checked":"" );
     }
-    SocketOp.fmt( data->socket, "<input type=\"submit\" value=\"Submit\"><br>\n" );
-    SocketOp.fmt( data->socket, "</form>\n" );
-
-    SocketOp.fmt( data->socket, "<h3>Commands:</h3>\n" );
-    SocketOp.fmt( data->socket, "<ul>\n" );
-    SocketOp.fmt( data->socket, "<li><a href=\"shutdown\">Shutdown</a></li>\n" );
-    SocketOp.fmt( data->socket, "</ul>\n" );
-
-    SocketOp.fmt( data->socket, "<h3>Listings:</h3>\n" );
-    SocketOp.fmt( data->socket, "<ul>\n" );
-    SocketOp.fmt( data->socket, "<li><a href=\"locs\"    >Locs    </a></li>\n" );
-    SocketOp.fmt( data->socket, "<li><a href=\"streets\" >Streets </a></li>\n" );
-    /*SocketOp.fmt( data->socket, "<li><a href=\"blocks\"  >Block   </a></li>\n" );*/
-    SocketOp.fmt( data->socket, "<li><a href=\"fbacks\"  >FBacks  </a></li>\n" );
-    SocketOp.fmt( data->socket, "<li><a href=\"switches\">Switches</a></li>\n" );
-    SocketOp.fmt( data->socket, "</ul>\n" );
-
-    SocketOp.fmt( data->socket, "<h3>Documentation:</h3>\n" );
-    SocketOp.fmt( data->socket, "<ul>\n" );
-    SocketOp.fmt( data->socket, "<li><a title=\"Shows parsed ini as XML string.\" href=\"ini\">%s</a></li>\n",
+    __fmt( data, "<input type=\"submit\" value=\"Submit\"><br>\n" );
+    __fmt( data, "</form>\n" );
+
+    __fmt( data, "<h3>Commands:</h3>\n" );
+    __fmt( data, "<ul>\n" );
+    __fmt( data, "<li><a href=\"shutdown\">Shutdown</a></li>\n" );
+    __fmt( data, "</ul>\n" );
+
+    __fmt( data, "<h3>Listings:</h3>\n" );
+    __fmt( data, "<ul>\n" );
+    __fmt( data, "<li><a href=\"locs\"    >Locs    </a></li>\n" );
+    __fmt( data, "<li><a href=\"streets\" >Streets </a></li>\n" );
+    /*__fmt( data, "<li><a href=\"blocks\"  >Block   </a></li>\n" );*/
+    __fmt( data, "<li><a href=\"fbacks\"  >FBacks  </a></li>\n" );
+    __fmt( data, "<li><a href=\"switches\">Switches</a></li>\n" );
+    __fmt( data, "</ul>\n" );
+
+    __fmt( data, "<h3>Documentation:</h3>\n" );
+    __fmt( data, "<ul>\n" );
+    __fmt( data, "<li><a title=\"Shows parsed ini as XML string.\" href=\"ini\">%s</a></li>\n",
                                 AppOp.getIniFile() );
-    SocketOp.fmt( data->socket, "<li><a href=\"rocrail_doc\">Rocrail</a></li>\n" );
-    SocketOp.fmt( data->socket, "</ul>\n" );
+    __fmt( data, "<li><a href=\"rocrail_doc\">Rocrail</a></li>\n" );
+    __fmt( data, "</ul>\n" );
 
-    SocketOp.fmt( data->socket, "</td></tr>\n" );
-    SocketOp.fmt( data->socket, "<tr><td colspan=\"2\">\n" );
+    __fmt( data, "</td></tr>\n" );
+    __fmt( data, "<tr><td colspan=\"2\">\n" );
 
-    SocketOp.fmt( data->socket, "<h3>Trace files:</h3>\n" );
+    __fmt( data, "<h3>Trace files:</h3>\n" );
     __scan4Trc( inst );
 
-    SocketOp.fmt( data->socket, "<h3>External documents:</h3>\n" );
+    __fmt( data, "<h3>External documents:</h3>\n" );
     __scan4Html( inst );
 
-    SocketOp.fmt( data->socket, "</td></tr>\n" );
-    SocketOp.fmt( data->socket, "<tr><td colspan=\"2\">\n" );
+    __fmt( data, "</td></tr>\n" );
+    __fmt( data, "<tr><td colspan=\"2\">\n" );
 
     {
       int i = 0;
       const char** ex = AppOp.getBackTrace();
-      SocketOp.fmt( data->socket, "<h3>BackTrace:</h3>(last 10 exceptions and warnings)\n" );
-      SocketOp.fmt( data->socket, "<table cellspacing= \"0\">\n" );
+      __fmt( data, "<h3>BackTrace:</h3>(last 10 exceptions and warnings)\n" );
+      __fmt( data, "<table cellspacing= \"0\">\n" );
       for( i = 9; i >= 0; i-- ) {
         char* bgcolor = i%2==1 ? "bgcolor=\"#DDFFDD\"":"";
         if( ex[i] != NULL ) {
-          SocketOp.fmt( data->socket, "<tr %s><td><pre width=\"132\" style=\"display: inline\">%s</pre></td></tr>\n", bgcolor, ex[i] );
+          __fmt( data, "<tr %s><td><pre width=\"132\" style=\"display: inline\">%s</pre></td></tr>\n", bgcolor, ex[i] );
         }
       }
-      SocketOp.fmt( data->socket, "</table>\n" );
+      __fmt( data, "</table>\n" );
     }
 
-    SocketOp.fmt( data->socket, "</td></tr>\n" );
-    SocketOp.fmt( data->socket, "</table>\n" );
+    __fmt( data, "</td></tr>\n" );
+    __fmt( data, "</table>\n" );
 
-    __footer( data->socket );
+    __footer( data );
 
 
   }
@@ -388,13 +509,14 @@ static void __getList( iOHClient inst, int list ) {
   TraceOp.trc( name, TRCLEVEL_METHOD, __LINE__, 9999, "__getList( inst=0x%08X )", inst );
   if( inst != NULL ) {
     iOHClientData data = Data(inst);
-    FILE* f = fopen( "list.html", "w+" );
+    /* Anonymous file: requests are handled concurrently by the worker pool. */
+    FILE* f = tmpfile();
+    long len = 0;
     if( f == NULL ) {
       TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "unable to open outputfile." );
       return;
     }
-    SocketOp.fmt( data->socket, "HTTP/1.0 200 OK\r\n" );
-    SocketOp.fmt( data->socket, "Content-type: text/html\r\n\r\n" );
+    __httpHeader( data );
 
 
     if( list == 1 ) {
@@ -413,18 +535,14 @@ static void __getList( iOHClient inst, int list ) {
       ModelOp.printSwitches( AppOp.getModel(), f );
     }
 
-    fclose( f );
-
-    if(FileOp.exist( "list.html" ) ) {
-      iOFile f = FileOp.inst( "list.html", OPEN_READONLY );
-      long len = FileOp.size( f );
-      char* buff = allocMem( len );
-      FileOp.read( f, buff, len );
-      SocketOp.write( data->socket, buff, len );
-      FileOp.base.del( f );
-      freeMem( buff );
-      FileOp.remove( "list.html" );
+    len = ftell( f );
+    if( len > 0 ) {
+      __reserve( data, len );
+      rewind( f );
+      len = fread( data->rsp + HTTP_HEADROOM + data->rspLen, 1, len, f );
+      data->rspLen += len;
     }
+    fclose( f );
 
 
   }
@@ -439,26 +557,18 @@ static void __getIni( iOHClient inst ) {
   TraceOp.trc( name, TRCLEVEL_METHOD, __LINE__, 9999, "__getIni( inst=0x%08X )", inst );
   if( inst != NULL ) {
     iOHClientData data = Data(inst);
-    __header( data->socket, data->refresh );
+    __header( data, data->refresh );
 
     {
       char* str = AppOp.base.toString( NULL );
-      int i = 0;
-      SocketOp.fmt( data->socket, "<pre>\n" );
-      for( i = 0; i < StrOp.len( str ); i++ ) {
-        if( str[i] == '<' )
-          SocketOp.fmt( data->socket, "&lt;" );
-        else if( str[i] == '>' )
-          SocketOp.fmt( data->socket, "&gt;" );
-        else
-          SocketOp.fmt( data->socket, "%c", str[i] );
-      }
-      SocketOp.fmt( data->socket, "</pre>\n" );
+      __fmt( data, "<pre>\n" );
+      __escape( data, str, StrOp.len( str ) );
+      __fmt( data, "</pre>\n" );
       StrOp.free( str );
     }
 
 
-    __footer( data->socket );
+    __footer( data );
 
   }
   else { /* NULL */
@@ -479,9 +589,9 @@ static void __getTracefile( iOHClient inst, const char* currentTrace ) {
   TraceOp.trc( name, TRCLEVEL_METHOD, __LINE__, 9999, "__getTracefile( inst=0x%08X )", inst );
   if( inst != NULL ) {
     iOHClientData data = Data(inst);
-    __header( data->socket, data->refresh );
+    __header( data, data->refresh );
 
-    SocketOp.fmt( data->socket, "<table cellspacing= \"0\">\n" );
+    __fmt( data, "<table cellspacing= \"0\">\n" );
     if( FileOp.exist( currentTrace ) ) {
       long size = FileOp.fileSize( currentTrace );
       char* str = allocMem( size + 1 );
@@ -503,34 +613,26 @@ static void __getTracefile( iOHClient inst, const char* currentTrace ) {
             else if( p[25] == 'W' )
               bgcolor = "bgcolor=\"#CCCCFF\"";
           }
-          SocketOp.fmt( data->socket, "<tr %s><td><pre width=\"132\" style=\"display: inline\">", bgcolor );
+          __fmt( data, "<tr %s><td><pre width=\"132\" style=\"display: inline\">", bgcolor );
           i++;
           *plf = '\0';
           plf++;
           if( StrOp.findc( p, '<' ) != NULL ) {
-            int i = 0;
-            for( i = 0; i < StrOp.len( p ); i++ ) {
-              if( p[i] == '<' )
-                SocketOp.fmt( data->socket, "&lt;" );
-              else if( p[i] == '>' )
-                SocketOp.fmt( data->socket, "&gt;" );
-              else
-                SocketOp.fmt( data->socket, "%c", p[i] );
-            }
+            __escape( data, p, StrOp.len( p ) );
           }
           else
-            SocketOp.fmt( data->socket, "%s\n", p );
+            __fmt( data, "%s\n", p );
           p = plf;
           plf = StrOp.findc( p, '\n' );
-          SocketOp.fmt( data->socket, "</pre></td></tr>\n" );
+          __fmt( data, "</pre></td></tr>\n" );
         };
         StrOp.free( str );
       }
     }
 
-    SocketOp.fmt( data->socket, "</table>\n" );
+    __fmt( data, "</table>\n" );
 
-    __footer( data->socket );
+    __footer( data );
 
   }
   else { /* NULL */
@@ -566,7 +668,8 @@ static void __getFavicon( iOHClient inst ) {
   TraceOp.trc( name, TRCLEVEL_METHOD, __LINE__, 9999, "__getFavicon( inst=0x%08X )", inst );
   if( inst != NULL ) {
     iOHClientData data = Data(inst);
-    SocketOp.write( data->socket, (char*)rocrail_gif, sizeof( rocrail_gif ) );
+    data->ctype = "image/gif";
+    __out( data, (char*)rocrail_gif, sizeof( rocrail_gif ) );
   }
   else { /* NULL */
     TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "inst == NULL!" );
@@ -575,6 +678,92 @@ static void __getFavicon( iOHClient inst ) {
 }
 
 
+static const char* __contentType( const char* path ) {
+  if( StrOp.endsWithi( path, ".html" ) || StrOp.endsWithi( path, ".htm" ) )
+    return "text/html";
+  if( StrOp.endsWithi( path, ".png" ) )
+    return "image/png";
+  if( StrOp.endsWithi( path, ".gif" ) )
+    return "image/gif";
+  if( StrOp.endsWithi( path, ".jpg" ) || StrOp.endsWithi( path, ".jpeg" ) )
+    return "image/jpeg";
+  if( StrOp.endsWithi( path, ".css" ) )
+    return "text/css";
+  if( StrOp.endsWithi( path, ".js" ) )
+    return "application/javascript";
+  if( StrOp.endsWithi( path, ".xml" ) )
+    return "text/xml";
+  if( StrOp.endsWithi( path, ".txt" ) || StrOp.endsWithi( path, ".trc" ) )
+    return "text/plain";
+  return "application/octet-stream";
+}
+
+
+/** ------------------------------------------------------------
+  * __cachedFile()
+  * Appends a static file to the response; files up to HTTP_MAXCACHED
+  * are kept in memory as long as their time and size are unchanged.
+  *
+  * @param data     HClient data.
+  * @param path     Relative file path.
+  * @return False if the file could not be read.
+  */
+static Boolean __cachedFile( iOHClientData data, const char* path ) {
+  struct __HttpFile* hf = NULL;
+  Boolean hit = False;
+  long size  = 0;
+  long mtime = 0;
+  iOFile f = NULL;
+
+  if( !FileOp.exist( path ) )
+    return False;
+
+  size  = FileOp.fileSize( path );
+  mtime = FileOp.fileTime( path );
+  data->ctype = __contentType( path );
+
+  MutexOp.wait( fileMux );
+  hf = (struct __HttpFile*)MapOp.get( fileCache, path );
+  if( hf != NULL && hf->mtime == mtime && hf->size == size ) {
+    __out( data, hf->buf, hf->size );
+    hit = True;
+  }
+  MutexOp.post( fileMux );
+
+  if( hit )
+    return True;
+
+  f = FileOp.inst( path, OPEN_READONLY );
+  if( f == NULL )
+    return False;
+
+  __reserve( data, size );
+  FileOp.read( f, data->rsp + HTTP_HEADROOM + data->rspLen, size );
+  FileOp.base.del( f );
+
+  if( size <= HTTP_MAXCACHED ) {
+    MutexOp.wait( fileMux );
+    hf = (struct __HttpFile*)MapOp.get( fileCache, path );
+    if( hf == NULL && MapOp.size( fileCache ) < HTTP_MAXFILES ) {
+      hf = allocMem( sizeof( struct __HttpFile ) );
+      MapOp.put( fileCache, path, (obj)hf );
+    }
+    if( hf != NULL ) {
+      freeMem( hf->buf );
+      hf->buf = allocMem( size + 1 );
+      MemOp.copy( hf->buf, data->rsp + HTTP_HEADROOM + data->rspLen, size );
+      hf->size  = size;
+      hf->mtime = mtime;
+      TraceOp.trc( name, TRCLEVEL_USER2, __LINE__, 9999, "cached %s (%ld bytes)", path, size );
+    }
+    MutexOp.post( fileMux );
+  }
+
+  data->rspLen += size;
+  return True;
+}
+
+
 /** ------------------------------------------------------------
   * __getFile()
   *
@@ -593,28 +782,22 @@ static void __getFile( iOHClient inst, const char* getstr ) {
       p--;
       *p = '\0';
       if( !FileOp.isAbsolute( htmlfile ) ) {
-        long size = FileOp.fileSize( htmlfile );
-        char* str = allocMem( size + 1 );
-        iOFile f = FileOp.inst( htmlfile, OPEN_READONLY );
-        if( f != NULL ) {
-          FileOp.read( f, str, size );
-          FileOp.base.del( f );
-          SocketOp.write( data->socket, str, size );
-        }
-        else {
-          __header( data->socket, data->refresh );
-          SocketOp.fmt( data->socket, "<big>Sorry, but file \"%s\" does not exist on this server!</big><br>\n", htmlfile );
-          __footer( data->socket );
+        if( !__cachedFile( data, htmlfile ) ) {
+          __header( data, data->refresh );
+          data->status = "404 Not Found";
+          __fmt( data, "<big>Sorry, but file \"%s\" does not exist on this server!</big><br>\n", htmlfile );
+          __footer( data );
         }
-        freeMem( str );
       }
       else {
-        __header( data->socket, data->refresh );
-        SocketOp.fmt( data->socket, "<big>Sorry, no access to file \"%s\" on this server.</big><br>\n", htmlfile );
-        __footer( data->socket );
+        __header( data, data->refresh );
+        data->status = "403 Forbidden";
+        __fmt( data, "<big>Sorry, no access to file \"%s\" on this server.</big><br>\n", htmlfile );
+        __footer( data );
       }
 
     }
+    StrOp.free( htmlfile );
 
   }
   else { /* NULL */
@@ -629,27 +812,27 @@ static void __getShutdown( iOHClient inst ) {
   if( inst != NULL ) {
     iOHClientData data = Data(inst);
     const char* consolemode = AppOp.isConsoleMode() ? "disabled":"";
-    __header( data->socket, data->refresh );
+    __header( data, data->refresh );
 
-    SocketOp.fmt( data->socket, "<table border=\"1\" cellspacing=\"0\" cellpadding=\"10\"><tr><td>\n" );
-    SocketOp.fmt( data->socket, "<b>Are you sure you want to shutdown Rocrail?</b>\n" );
-    SocketOp.fmt( data->socket, "<br><small>(Does not work in console mode!)</small>\n" );
-    SocketOp.fmt( data->socket, "</td></tr></table>\n" );
+    __fmt( data, "<table border=\"1\" cellspacing=\"0\" cellpadding=\"10\"><tr><td>\n" );
+    __fmt( data, "<b>Are you sure you want to shutdown Rocrail?</b>\n" );
+    __fmt( data, "<br><small>(Does not work in console mode!)</small>\n" );
+    __fmt( data, "</td></tr></table>\n" );
 
-    SocketOp.fmt( data->socket, "<table>\n" );
-    SocketOp.fmt( data->socket, "<tr><td><form action=\"shutdown\">\n" );
-    SocketOp.fmt( data->socket, "<input type=\"hidden\" name=\"ok\" value=\"true\"><br>\n" );
-    SocketOp.fmt( data->socket, "<input type=\"submit\" value=\"Shutdown\" %s><br>\n", consolemode );
-    SocketOp.fmt( data->socket, "</form></td>\n" );
+    __fmt( data, "<table>\n" );
+    __fmt( data, "<tr><td><form action=\"shutdown\">\n" );
+    __fmt( data, "<input type=\"hidden\" name=\"ok\" value=\"true\"><br>\n" );
+    __fmt( data, "<input type=\"submit\" value=\"Shutdown\" %s><br>\n", consolemode );
+    __fmt( data, "</form></td>\n" );
 
-    SocketOp.fmt( data->socket, "<td><form action=\"shutdown\">\n" );
-    SocketOp.fmt( data->socket, "<input type=\"hidden\" name=\"ok\" value=\"false\"><br>\n" );
-    SocketOp.fmt( data->socket, "<input type=\"submit\" value=\"Cancel\"><br>\n" );
-    SocketOp.fmt( data->socket, "</form></td></tr>\n" );
+    __fmt( data, "<td><form action=\"shutdown\">\n" );
+    __fmt( data, "<input type=\"hidden\" name=\"ok\" value=\"false\"><br>\n" );
+    __fmt( data, "<input type=\"submit\" value=\"Cancel\"><br>\n" );
+    __fmt( data, "</form></td></tr>\n" );
 
-    SocketOp.fmt( data->socket, "</table><br>\n" );
+    __fmt( data, "</table><br>\n" );
 
-    __footer( data->socket );
+    __footer( data );
 
   }
   else { /* NULL */
@@ -663,9 +846,9 @@ static void __getBlank( iOHClient inst ) {
   TraceOp.trc( name, TRCLEVEL_METHOD, __LINE__, 9999, "__getBlank( inst=0x%08X )", inst );
   if( inst != NULL ) {
     iOHClientData data = Data(inst);
-    __header( data->socket, data->refresh );
-    SocketOp.fmt( data->socket, "<a href=\"/\">Rocrail</a><br>\n" );
-    __footer( data->socket );
+    __header( data, data->refresh );
+    __fmt( data, "<a href=\"/\">Rocrail</a><br>\n" );
+    __footer( data );
   }
   else { /* NULL */
     TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "inst == NULL!" );
@@ -701,9 +884,9 @@ static void __getLoc( iOHClient inst, const char* str ) {
       printf( "%s\n", xml );
       StrOp.free( xml );
 
-      __header( data->socket, data->refresh );
-      SocketOp.fmt( data->socket, form );
-      __footer( data->socket );
+      __header( data, data->refresh );
+      __out( data, form, StrOp.len( form ) );
+      __footer( data );
       StrOp.free( form );
     }
   }
@@ -718,133 +901,383 @@ static void __postLoc( iOHClient inst, const char* postid, const char* postdata
     iIHtmlInt html = (iIHtmlInt)loc;
     char* reply = html->postForm( loc, postdata );
 
-    __header( data->socket, data->refresh );
-    SocketOp.fmt( data->socket, reply );
-    __footer( data->socket );
+    __header( data, data->refresh );
+    __out( data, reply, StrOp.len( reply ) );
+    __footer( data );
     StrOp.free( reply );
   }
 }
 
 
+/** ------------------------------------------------------------
+  * __getMetrics()
+  * Writes the runtime metrics in the Prometheus text format.
+  *
+  * @param inst     HClient instance.
+  * @return
+  */
+static void __getMetrics( iOHClient inst ) {
+  iOHClientData data = Data(inst);
+  char* text = MetricsOp.toText( "rocrail_" );
+  data->ctype = "text/plain; version=0.0.4";
+  __out( data, text, StrOp.len( text ) );
+  StrOp.free( text );
+}
+
+
+/** ------------------------------------------------------------
+  * __getSpans()
+  * Writes the recorded sensor event spans as a Chrome trace.
+  *
+  * @param inst     HClient instance.
+  * @return
+  */
+static void __getSpans( iOHClient inst ) {
+  iOHClientData data = Data(inst);
+  char* json = SpanOp.toJson();
+  data->ctype = "application/json";
+  __out( data, json, StrOp.len( json ) );
+  freeMem( json );
+}
+
+
+/* Writes the queued event frames of one client; a failed write marks the client broken
+   and the frames are dropped until the streamer deletes it. */
+static void __writer( void* threadinst ) {
+  iOThread       th = (iOThread)threadinst;
+  iOHClient    inst = (iOHClient)ThreadOp.getParm( th );
+  iOHClientData data = Data(inst);
+  char* frame = NULL;
+
+  do {
+    frame = (char*)ThreadOp.waitPost( th );
+    if( frame == NULL )
+      continue;
+    if( !data->broken && frame[0] != '\0' ) {
+      if( !SocketOp.write( data->socket, frame, StrOp.len( frame ) ) || SocketOp.isBroken( data->socket ) )
+        data->broken = True;
+    }
+    freeMem( frame );
+  } while( !ThreadOp.isQuit( th ) );
+
+  while( (frame = (char*)ThreadOp.getPost( th )) != NULL )
+    freeMem( frame );
+
+  data->writer = NULL;
+  __free( inst );
+  ThreadOp.base.del( th );
+}
+
+
+/** ------------------------------------------------------------
+  * __getEvents()
+  * Switches the connection to a server-sent events channel;
+  * the Http streamer writes the live state events from now on.
+  *
+  * @param inst     HClient instance.
+  * @return
+  */
+static void __getEvents( iOHClient inst ) {
+  iOHClientData data = Data(inst);
+  const char* hdr = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                    "Connection: keep-alive\r\n\r\nretry: 2000\n\n";
+  /* the page state may hold loco values the other clients never got */
+  LocOp.resyncBroadcasts();
+  SocketOp.setSndTimeout( data->socket, HTTP_SSE_SNDTIMEOUT );
+  data->stream = SocketOp.write( data->socket, hdr, StrOp.len( hdr ) );
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "event stream %s for %s",
+      data->stream?"opened":"failed", SocketOp.getPeername( data->socket ) );
+
+  /* A stalled browser must not hold up the other event clients. */
+  if( data->stream ) {
+    char* wname = StrOp.fmt( "ssew%s", data->cid );
+    data->writer = ThreadOp.inst( wname, __writer, inst );
+    ThreadOp.start( data->writer );
+    StrOp.free( wname );
+  }
+}
+
+
+/* Append what is already queued on the socket to the receipt buffer;
+   only if nothing is waiting block for one byte, but not past the request deadline. */
+static Boolean __fill( iOHClientData data ) {
+  char* p  = data->rcptBuffer + data->rcptSize;
+  int room = HTTP_RCPTSIZE - data->rcptSize;
+  int avail = 0;
+  long left = 0;
+
+  if( room <= 0 )
+    return False;
+
+  SocketOp.peek( data->socket, p, room );
+  if( SocketOp.isBroken( data->socket ) )
+    return False;
+
+  avail = SocketOp.getPeeked( data->socket );
+  if( avail <= 0 ) {
+    left = (long)( data->deadline - SystemOp.getTick() );
+    if( left <= 0 ) {
+      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "request of %s not complete within %ds",
+          data->cid, HTTP_REQTIMEOUT );
+      return False;
+    }
+    /* timeout in seconds, ticks are 10ms */
+    SocketOp.setRcvTimeout( data->socket, (left + 99) / 100 );
+    avail = 1;
+  }
+  else if( avail > room )
+    avail = room;
+
+  if( !SocketOp.read( data->socket, p, avail ) || SocketOp.isBroken( data->socket ) )
+    return False;
+
+  data->rcptSize += avail;
+  return True;
+}
+
+
+/* Length of the request header including the empty line; 0 if not complete yet. */
+static int __headerLen( iOHClientData data ) {
+  const char* b = data->rcptBuffer;
+  int i = 0;
+  for( i = 0; i < data->rcptSize; i++ ) {
+    if( b[i] != '\n' )
+      continue;
+    if( i + 1 < data->rcptSize && b[i+1] == '\n' )
+      return i + 2;
+    if( i + 2 < data->rcptSize && b[i+1] == '\r' && b[i+2] == '\n' )
+      return i + 3;
+  }
+  return 0;
+}
+
+
 typedef void(*postcall)(iOHClient,const char*,const char*);
 /** Work slice. */
 static Boolean _work( struct OHClient* inst ) {
   if( inst != NULL ) {
     iOHClientData data = Data(inst);
-    char str[1025] = {'\0'};
-    char postdata[1025] = {'\0'};
-    int contlen = 0;
-    Boolean readPost = False;
-    char *p = postdata;
-    postcall pc = NULL;
-    char* postid = NULL;
     const char* tracefile = FileOp.ripPath( wTrace.getrfile( wRocRail.gettrace( AppOp.getIni() ) ) );
 
-    SocketOp.setRcvTimeout( data->socket, 1000 );
-    /* Read first HTTP header line: */
-    SocketOp.readln( data->socket, str );
-    TraceOp.trc( name, TRCLEVEL_USER2, __LINE__, 9999, str );
+    /* Serve all requests already received; a browser may pipeline them. */
+    do {
+      char str[1025] = {'\0'};
+      char postdata[HTTP_POSTSIZE+1] = {'\0'};
+      int hdrlen  = 0;
+      int contlen = 0;
+      int i = 0;
+      Boolean keepalive = False;
+      Boolean readPost = False;
+      postcall pc = NULL;
+      char* postid = NULL;
+
+      data->deadline = SystemOp.getTick() + HTTP_REQTIMEOUT * 100;
+
+      /* Read the complete HTTP header: */
+      while( (hdrlen = __headerLen( data )) == 0 ) {
+        if( !__fill( data ) ) {
+          SocketOp.disConnect( data->socket );
+          return True;
+        }
+      }
+
+      /* First HTTP header line: */
+      for( i = 0; i < hdrlen && i < 1024; i++ ) {
+        str[i] = data->rcptBuffer[i];
+        if( str[i] == '\n' ) {
+          i++;
+          break;
+        }
+      }
+      str[i] = '\0';
+      TraceOp.trc( name, TRCLEVEL_USER2, __LINE__, 9999, "%s", str );
+
+      /* HTTP/1.1 connections are persistent unless the browser says otherwise. */
+      keepalive = data->keepalive && StrOp.find( str, "HTTP/1.1" ) ? True:False;
+
+      /* Rest of the HTTP header: */
+      {
+        char* hdrs = allocMem( hdrlen + 1 );
+        char* line = NULL;
+        MemOp.copy( hdrs, data->rcptBuffer, hdrlen );
+        line = StrOp.findc( hdrs, '\n' );
+        while( line != NULL && *(++line) != '\0' ) {
+          char* next = StrOp.findc( line, '\n' );
+          if( next != NULL )
+            *next = '\0';
+          if( StrOp.startsWithi( line, "Content-Length:" ) ) {
+            contlen = atoi( line + 15 );
+            TraceOp.trc( name, TRCLEVEL_USER2, __LINE__, 9999, "contlen = %d\n", contlen );
+          }
+          else if( StrOp.startsWithi( line, "Connection:" ) ) {
+            if( StrOp.findi( line, "close" ) )
+              keepalive = False;
+            else if( data->keepalive && StrOp.findi( line, "keep-alive" ) )
+              keepalive = True;
+          }
+          TraceOp.trc( name, TRCLEVEL_USER2, __LINE__, 9999, "%s", line );
+          line = next;
+        };
+        freeMem( hdrs );
+      }
 
-    /* Flag if post data is comming: */
-    if( StrOp.find( str, "POST" ) )
-      readPost = True;
+      /* Flag if post data is comming: */
+      if( StrOp.find( str, "POST" ) )
+        readPost = True;
 
-    if( StrOp.find( str, "GET" ) && StrOp.find( str, " /locs " ) )
-      __getList( inst, 1 );
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /loc?" ) ) {
-      __getLoc( inst, str );
-    }
-    else if( StrOp.find( str, "POST" ) && StrOp.find( str, " /loc?id=" ) ) {
-      postid = __getID( str );
-      pc = &__postLoc;
-    }
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /streets " ) )
-      __getList( inst, 2 );
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /blocks " ) )
-      __getList( inst, 3 );
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /fbacks " ) )
-      __getList( inst, 4 );
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /switches " ) )
-      __getList( inst, 5 );
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /trace?" ) )
-      __formTrace( str );
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /ini " ) )
-      __getIni( inst );
-    else if( StrOp.find( str, tracefile ) && StrOp.find( str, ".trc" ) ) {
-      char* tracefile = StrOp.dup( StrOp.find( str, " /" ) + 2 ) ;
-      char* p = StrOp.find( tracefile, "HTTP" );
-
-      if( p != NULL ) {
-        p--;
-        *p = '\0';
-        __getTracefile( inst, tracefile );
+      /* Wait for the request body: */
+      if( contlen < 0 )
+        contlen = 0;
+      if( hdrlen + contlen > HTTP_RCPTSIZE ) {
+        contlen   = HTTP_RCPTSIZE - hdrlen;
+        keepalive = False;
       }
-      StrOp.free( tracefile );
-    }
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /tracefile" ) ) {
-      /* href to xspooler.ini */
-      __getTracefile( inst, TraceOp.getCurrentFilename( NULL ) );
-    }
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /shutdown " ) ) {
-      __getShutdown( inst );
-    }
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /shutdown?ok=true" ) ) {
-      __getBlank( inst );
-      SocketOp.disConnect( data->socket );
-      AppOp.shutdown(0, "WEB Client command");
-      return True;
-    }
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /shutdown?ok=false" ) ) {
-      __getHome( inst );
-    }
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, " / " ) ) {
-      __getHome( inst );
-    }
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, "/rocrail_doc" ) ) {
-      extern const char rocrail_doc[];
-      __httpHeader( data->socket );
-      SocketOp.write( data->socket, rocrail_doc, StrOp.len( rocrail_doc ) );
-    }
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, "/rocrail.gif" ) ) {
-      __getFavicon( inst );
-    }
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, "/favicon.ico" ) ) {
-      __getFavicon( inst );
-    }
-    else if( StrOp.find( str, "GET" ) && StrOp.find( str, "/" ) ) {
-      __getFile( inst, str );
-    }
+      while( data->rcptSize < hdrlen + contlen ) {
+        if( !__fill( data ) ) {
+          SocketOp.disConnect( data->socket );
+          return True;
+        }
+      }
+      MemOp.copy( postdata, data->rcptBuffer + hdrlen, contlen < HTTP_POSTSIZE ? contlen:HTTP_POSTSIZE );
 
-    /* Reading rest of HTTP header: */
-    while( SocketOp.readln( data->socket, str ) && !SocketOp.isBroken( data->socket ) ) {
-      if( str[0] == '\r' || str[0] == '\n' ) {
-        break;
+      /* Consume the request. */
+      data->rcptSize -= hdrlen + contlen;
+      memmove( data->rcptBuffer, data->rcptBuffer + hdrlen + contlen, data->rcptSize );
+
+      if( StrOp.find( str, "GET" ) && StrOp.find( str, " /locs " ) )
+        __getList( inst, 1 );
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /loc?" ) ) {
+        __getLoc( inst, str );
       }
-      if( StrOp.find( str, "Content-Length:" ) ) {
-        char* p = StrOp.find( str, ": " ) + 2;
-        contlen = atoi( p );
-        TraceOp.trc( name, TRCLEVEL_USER2, __LINE__, 9999, "contlen = %d\n", contlen );
+      else if( StrOp.find( str, "POST" ) && StrOp.find( str, " /loc?id=" ) ) {
+        postid = __getID( str );
+        pc = &__postLoc;
+      }
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /streets " ) )
+        __getList( inst, 2 );
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /blocks " ) )
+        __getList( inst, 3 );
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /fbacks " ) )
+        __getList( inst, 4 );
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /switches " ) )
+        __getList( inst, 5 );
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /trace?" ) )
+        __formTrace( str );
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /ini " ) )
+        __getIni( inst );
+      else if( StrOp.find( str, tracefile ) && StrOp.find( str, ".trc" ) ) {
+        char* tracefile = StrOp.dup( StrOp.find( str, " /" ) + 2 ) ;
+        char* p = StrOp.find( tracefile, "HTTP" );
+
+        if( p != NULL ) {
+          p--;
+          *p = '\0';
+          __getTracefile( inst, tracefile );
+        }
+        StrOp.free( tracefile );
+      }
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /tracefile" ) ) {
+        /* href to xspooler.ini */
+        __getTracefile( inst, TraceOp.getCurrentFilename( NULL ) );
+      }
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /shutdown " ) ) {
+        __getShutdown( inst );
+      }
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /shutdown?ok=true" ) ) {
+        __getBlank( inst );
+        __flush( data, False );
+        SocketOp.disConnect( data->socket );
+        AppOp.shutdown(0, "WEB Client command");
+        return True;
+      }
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /shutdown?ok=false" ) ) {
+        __getHome( inst );
+      }
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " / " ) ) {
+        __getHome( inst );
+      }
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /metrics " ) ) {
+        __getMetrics( inst );
+      }
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, " /spans " ) ) {
+        __getSpans( inst );
+      }
+      else if( data->keepalive && StrOp.find( str, "GET" ) && StrOp.find( str, " /events " ) ) {
+        __getEvents( inst );
+        return data->stream ? False:True;
+      }
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, "/rocrail_doc" ) ) {
+        extern const char rocrail_doc[];
+        __httpHeader( data );
+        __out( data, rocrail_doc, StrOp.len( rocrail_doc ) );
+      }
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, "/rocrail.gif" ) ) {
+        __getFavicon( inst );
+      }
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, "/favicon.ico" ) ) {
+        __getFavicon( inst );
+      }
+      else if( StrOp.find( str, "GET" ) && StrOp.find( str, "/" ) ) {
+        __getFile( inst, str );
       }
-      TraceOp.trc( name, TRCLEVEL_USER2, __LINE__, 9999, str );
-    };
 
-    if( readPost ) {
-      /* Read the post data: */
-      while( SocketOp.peek( data->socket, p, 1 ) && !SocketOp.isBroken( data->socket ) ) {
-        if( !SocketOp.read( data->socket, p, 1 ) )
-          break;
-        /*printf( "%c", *p );*/
-        p++;
-        *p = '\0';
-      };
-      TraceOp.trc( name, TRCLEVEL_USER2, __LINE__, 9999, "postdata=\"%s\"\n", postdata );
-      /* Call the post data handler: */
-      if( pc != NULL )
-        pc( inst, postid, postdata );
-    }
+      if( readPost ) {
+        TraceOp.trc( name, TRCLEVEL_USER2, __LINE__, 9999, "postdata=\"%s\"\n", postdata );
+        /* Call the post data handler: */
+        if( pc != NULL )
+          pc( inst, postid, postdata );
+      }
+      StrOp.free( postid );
+
+      /* Send the buffered response in one write: */
+      if( !__flush( data, keepalive ) || !keepalive ) {
+        SocketOp.disConnect( data->socket );
+        return True;
+      }
+    } while( data->rcptSize > 0 );
 
-    StrOp.free( postid );
-    SocketOp.disConnect( data->socket );
+    /* Keep the connection for the next request. */
+    return False;
+  }
+  return True;
+}
+
+
+/** HClient socket. */
+static iOSocket _getSocket( struct OHClient* inst ) {
+  iOHClientData data = Data(inst);
+  return data->socket;
+}
+
+
+/** Allow persistent connections; only if the caller polls the socket for the next request. */
+static void _setKeepAlive( struct OHClient* inst, Boolean keepalive ) {
+  iOHClientData data = Data(inst);
+  data->keepalive = keepalive;
+}
+
+
+/** Client is a server-sent events channel. */
+static Boolean _isStream( struct OHClient* inst ) {
+  iOHClientData data = Data(inst);
+  return data->stream;
+}
+
+
+/** Queue one server-sent events frame for the client writer. */
+static Boolean _stream( struct OHClient* inst, const char* frame, int len ) {
+  iOHClientData data = Data(inst);
+  char* copy = NULL;
+
+  if( data->broken || data->writer == NULL )
+    return False;
+
+  copy = allocMem( len + 1 );
+  MemOp.copy( copy, frame, len );
+  if( !ThreadOp.post( data->writer, (obj)copy ) ) {
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "event stream of %s lags behind; closing", data->cid );
+    freeMem( copy );
+    return False;
   }
   return True;
 }
@@ -856,11 +1289,22 @@ static struct OHClient* _inst( iOSocket socket, const char* path, int refresh )
   iOHClientData data = allocMem( sizeof( struct OHClientData ) );
   MemOp.basecpy( __HClient, &HClientOp, 0, sizeof( struct OHClient ), data );
 
+  /* The static file cache is shared by all clients. */
+  if( fileCache == NULL ) {
+    fileCache = MapOp.inst();
+    fileMux   = MutexOp.inst( NULL, True );
+  }
+
   /* Initialize data->xxx members... */
   data->socket        = socket;
   data->cid           = StrOp.fmt( "%08X", __HClient );
   data->path          = path;
   data->refresh       = refresh;
+  data->rcptBuffer    = allocMem( HTTP_RCPTSIZE + 1 );
+  data->rspSize       = HTTP_RSPSIZE;
+  data->rsp           = allocMem( data->rspSize );
+  data->status        = "200 OK";
+  data->ctype         = "text/html";
 
   instCnt++;
   return __HClient;
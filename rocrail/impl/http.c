@@ -29,8 +29,19 @@
 #include "rocs/public/mem.h"
 #include "rocs/public/trace.h"
 #include "rocs/public/map.h"
+#include "rocs/public/list.h"
 #include "rocs/public/strtok.h"
 
+#if defined __linux__
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <errno.h>
+#define HTTP_EPOLL
+#endif
+
+/* Seconds between comment frames keeping idle event streams open. */
+#define HTTP_SSE_HEARTBEAT 15
+
 
 static int instCnt = 0;
 
@@ -90,6 +101,130 @@ static void* __properties( void* inst ) {
 /** ----- OHttp ----- */
 
 
+/* The client socket is closed on return of HClientOp.work, or is closed by the delete;
+   this also takes it out of the poll set. */
+static void __removeClient( iOHttpData data, iOHClient client ) {
+  TraceOp.trc( name, TRCLEVEL_USER2, __LINE__, 9999, "Removing HClient [%s].", HClientOp.getId( client ) );
+  MutexOp.wait( data->clientmux );
+  MapOp.remove( data->clientMap, HClientOp.getId( client ) );
+  MutexOp.post( data->clientmux );
+
+  /* Cleanup. */
+  HClientOp.base.del( client );
+}
+
+
+static void __addClient( iOHttpData data, iOHClient client ) {
+  MutexOp.wait( data->clientmux );
+  MapOp.put( data->clientMap, HClientOp.getId( client ), (obj)client );
+  MutexOp.post( data->clientmux );
+
+#ifdef HTTP_EPOLL
+  if( data->epfd >= 0 ) {
+    iOSocket sock = HClientOp.getSocket( client );
+    struct epoll_event ev;
+    HClientOp.setKeepAlive( client, True );
+    SocketOp.setNodelay( sock, True );
+    ev.events   = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.ptr = client;
+    if( epoll_ctl( data->epfd, EPOLL_CTL_ADD, SocketOp.getSh( sock ), &ev ) != 0 ) {
+      TraceOp.terrno( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, errno, "epoll_ctl(ADD) failed for %s", HClientOp.getId( client ) );
+      __removeClient( data, client );
+    }
+  }
+#endif
+}
+
+
+#ifdef HTTP_EPOLL
+/* Poll the client socket again for its next request. */
+static void __rearm( iOHttpData data, iOHClient client ) {
+  struct epoll_event ev;
+  ev.events   = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+  ev.data.ptr = client;
+  if( epoll_ctl( data->epfd, EPOLL_CTL_MOD, SocketOp.getSh( HClientOp.getSocket( client ) ), &ev ) != 0 ) {
+    TraceOp.terrno( name, TRCLEVEL_WARNING, __LINE__, 9999, errno, "epoll_ctl(MOD) failed for %s", HClientOp.getId( client ) );
+    __removeClient( data, client );
+  }
+}
+
+
+/* Hand the client over to the event streamer. */
+static void __addStream( iOHttpData data, iOHClient client ) {
+  epoll_ctl( data->epfd, EPOLL_CTL_DEL, SocketOp.getSh( HClientOp.getSocket( client ) ), NULL );
+
+  MutexOp.wait( data->clientmux );
+  MapOp.remove( data->clientMap, HClientOp.getId( client ) );
+  MutexOp.post( data->clientmux );
+
+  MutexOp.wait( data->streammux );
+  ListOp.add( data->streamList, (obj)client );
+  MutexOp.post( data->streammux );
+}
+
+
+/* A hangup without pending request bytes: the browser closed the persistent connection. */
+static Boolean __isClosed( iOHClient client, unsigned int events ) {
+  char c = 0;
+  if( events & (EPOLLHUP|EPOLLERR) )
+    return True;
+  return recv( SocketOp.getSh( HClientOp.getSocket( client ) ), &c, 1, MSG_PEEK|MSG_DONTWAIT ) == 0 ? True:False;
+}
+
+
+/**----------------------------------------------------------------------
+ * PMonOp __serve()
+ * ----------------------------------------------------------------------
+ * Request loop shared by the port server and the worker threads: all wait
+ * on the same poll set and a one shot registration makes sure a client is
+ * served by only one of them until it is armed again. Each wait takes one
+ * ready client so a slow page does not hold up requests queued behind it.
+ * @param  th   Calling thread.
+ * @param  data Http data.
+ */
+static void __serve( iOThread th, iOHttpData data ) {
+  do {
+    struct epoll_event ev;
+    int n = epoll_wait( data->epfd, &ev, 1, 100 );
+
+    if( n < 0 && errno != EINTR ) {
+      TraceOp.terrno( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, errno, "epoll_wait failed" );
+      ThreadOp.sleep( 100 );
+    }
+
+    if( n == 1 ) {
+      iOHClient client = (iOHClient)ev.data.ptr;
+
+      if( (ev.events & (EPOLLRDHUP|EPOLLHUP|EPOLLERR)) && __isClosed( client, ev.events ) )
+        __removeClient( data, client );
+      else if( HClientOp.work( client ) )
+        __removeClient( data, client );
+      else if( HClientOp.isStream( client ) )
+        __addStream( data, client );
+      else
+        __rearm( data, client );
+    }
+  } while( !ThreadOp.isQuit( th ) );
+}
+
+
+/**----------------------------------------------------------------------
+ * PMonOp __worker()
+ * ----------------------------------------------------------------------
+ * @param  inst Thread instance.
+ */
+static void __worker( void* threadinst ) {
+  iOThread     th = (iOThread)threadinst;
+  iOHttp     http = (iOHttp)ThreadOp.getParm(th);
+  iOHttpData data = Data( http );
+
+  TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "HttpService worker %s started.", ThreadOp.getName( th ) );
+  __serve( th, data );
+  TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "HttpService worker %s ended.", ThreadOp.getName( th ) );
+}
+#endif
+
+
 /**----------------------------------------------------------------------
  * PMonOp __portserver()
  * ----------------------------------------------------------------------
@@ -106,8 +241,19 @@ static void __portserver( void* threadinst ) {
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "HttpService started on %d.", data->port );
 
+#ifdef HTTP_EPOLL
+  if( data->epfd >= 0 ) {
+    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "HttpService polls for requests with %d threads.",
+        ListOp.size( data->workers ) + 1 );
+    __serve( th, data );
+  }
+  else
+#endif
   do {
-    iOHClient client = (iOHClient)MapOp.first( data->clientMap );
+    iOHClient client = NULL;
+    MutexOp.wait( data->clientmux );
+    client = (iOHClient)MapOp.first( data->clientMap );
+    MutexOp.post( data->clientmux );
     /* Iterate the list of connected clients. */
     while( client != NULL ) {
 
@@ -115,17 +261,14 @@ static void __portserver( void* threadinst ) {
       Boolean remove = HClientOp.work( client );
 
       if( remove ) {
-        TraceOp.trc( name, TRCLEVEL_USER2, __LINE__, 9999, "Removing HClient [%s].", HClientOp.getId( client ) );
-        MapOp.remove( data->clientMap, HClientOp.getId( client ) );
-
-        /* Cleanup. */
-        HClientOp.base.del( client );
-
+        __removeClient( data, client );
         break; /* We better do not call MapOp.next() after a remove. */
       }
 
       ThreadOp.sleep( 5 );
+      MutexOp.wait( data->clientmux );
       client = (iOHClient)MapOp.next( data->clientMap );
+      MutexOp.post( data->clientmux );
     };
 
     ThreadOp.sleep( 5 );
@@ -137,6 +280,100 @@ static void __portserver( void* threadinst ) {
 }
 
 
+/* Write to all event clients and drop the broken ones. */
+static void __streamAll( iOHttpData data, const char* frame, int len ) {
+  int i = 0;
+  MutexOp.wait( data->streammux );
+  while( i < ListOp.size( data->streamList ) ) {
+    iOHClient client = (iOHClient)ListOp.get( data->streamList, i );
+    if( HClientOp.stream( client, frame, len ) )
+      i++;
+    else {
+      TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "event stream closed for %s", HClientOp.getId( client ) );
+      ListOp.remove( data->streamList, i );
+      HClientOp.base.del( client );
+    }
+  }
+  MutexOp.post( data->streammux );
+}
+
+
+/* Render one event as an SSE frame; every line of the XML gets its own data field. */
+static char* __sseFrame( iONode evt ) {
+  char* xml  = NodeOp.base.toString( evt );
+  char* line = xml;
+  char* frames = StrOp.dup( "event: " );
+  frames = StrOp.cat( frames, NodeOp.getName( evt ) );
+  frames = StrOp.cat( frames, "\n" );
+  while( line != NULL && *line != '\0' ) {
+    char* next = StrOp.findc( line, '\n' );
+    if( next != NULL )
+      *next++ = '\0';
+    frames = StrOp.cat( frames, "data: " );
+    frames = StrOp.cat( frames, line );
+    frames = StrOp.cat( frames, "\n" );
+    line = next;
+  }
+  frames = StrOp.cat( frames, "\n" );
+  StrOp.free( xml );
+  return frames;
+}
+
+
+/**----------------------------------------------------------------------
+ * PMonOp __streamer()
+ * ----------------------------------------------------------------------
+ * Writes the broadcasted events to the server-sent events clients;
+ * all events pending are rendered once and written with one call per client.
+ * @param  inst Thread instance.
+ */
+static void __streamer( void* threadinst ) {
+  iOThread     th = (iOThread)threadinst;
+  iOHttp     http = (iOHttp)ThreadOp.getParm(th);
+  iOHttpData data = Data( http );
+  int idle = 0;
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "HttpService event streamer started." );
+
+  do {
+    char* frames = NULL;
+    int len  = 0;
+    int size = 0;
+    iONode evt = (iONode)ThreadOp.getPost( th );
+
+    while( evt != NULL ) {
+      char* frame = __sseFrame( evt );
+      int flen = StrOp.len( frame );
+      if( len + flen > size ) {
+        size = (len + flen) * 2;
+        frames = frames == NULL ? allocMem( size ):reallocMem( frames, size );
+      }
+      MemOp.copy( frames + len, frame, flen );
+      len += flen;
+      StrOp.free( frame );
+      NodeOp.base.del( evt );
+      evt = (iONode)ThreadOp.getPost( th );
+    }
+
+    if( frames != NULL ) {
+      __streamAll( data, frames, len );
+      freeMem( frames );
+      idle = 0;
+    }
+    else {
+      ThreadOp.sleep( 10 );
+      idle++;
+      if( idle >= HTTP_SSE_HEARTBEAT * 100 ) {
+        __streamAll( data, ": heartbeat\n\n", 13 );
+        idle = 0;
+      }
+    }
+  } while( !ThreadOp.isQuit( th ) );
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "HttpService event streamer ended." );
+}
+
+
 /**----------------------------------------------------------------------
  * PMonOp __portmanager()
  * ----------------------------------------------------------------------
@@ -162,7 +399,7 @@ static void __portmanager( void* threadinst ) {
       TraceOp.trc( name, TRCLEVEL_USER2, __LINE__, 9999, "HTTPManager accept for %s:%d. (id=%s)",
                      SocketOp.getPeername( clientSocket ), data->port, HClientOp.getId( client ) );
 
-      MapOp.put( data->clientMap, HClientOp.getId( client ), (obj)client );
+      __addClient( data, client );
 
     }
     else {
@@ -172,7 +409,6 @@ static void __portmanager( void* threadinst ) {
       break;
     }
 
-    ThreadOp.sleep( 100 );
   } while( !ThreadOp.isQuit( th ) );
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Manager ended for %d.", data->port );
@@ -303,6 +539,38 @@ static struct OHttp* _inst( iONode ini ) {
       char*  htsName = StrOp.fmt( "hts%08X", __Http );
 
       data->clientMap = MapOp.inst();
+      data->clientmux = MutexOp.inst( NULL, True );
+      data->epfd      = -1;
+
+#ifdef HTTP_EPOLL
+      data->epfd = epoll_create( 64 );
+      if( data->epfd < 0 )
+        TraceOp.terrno( name, TRCLEVEL_WARNING, __LINE__, 9999, errno, "epoll_create failed; serving clients one by one" );
+#endif
+
+      /* Request handlers and event streamer for the readiness poll. */
+      if( data->epfd >= 0 ) {
+        int i = 0;
+        int workers = wHttpService.getworkers( ini );
+        data->workers = ListOp.inst();
+        /* The port server is the first one. */
+        for( i = 1; i < workers; i++ ) {
+          char* htwName = StrOp.fmt( "htw%d%08X", i, __Http );
+          iOThread worker = ThreadOp.inst( htwName, __worker, __Http );
+          ListOp.add( data->workers, (obj)worker );
+          ThreadOp.start( worker );
+          StrOp.free( htwName );
+        }
+
+        {
+          char* sseName = StrOp.fmt( "htse%08X", __Http );
+          data->streamList = ListOp.inst();
+          data->streammux  = MutexOp.inst( NULL, True );
+          data->streamer   = ThreadOp.inst( sseName, __streamer, __Http );
+          ThreadOp.start( data->streamer );
+          StrOp.free( sseName );
+        }
+      }
   
       data->srvrsocket  = SocketOp.inst( "localhost", data->port, False, False, False );
       data->portmanager = ThreadOp.inst( htmName, __portmanager, __Http );
@@ -356,6 +624,13 @@ static void _shutdown( struct OHttp* inst ) {
     ThreadOp.requestQuit( data->portserver );
   if( data->srvrsocket != NULL )
     SocketOp.disConnect( data->srvrsocket );
+  if( data->workers != NULL ) {
+    int i = 0;
+    for( i = 0; i < ListOp.size( data->workers ); i++ )
+      ThreadOp.requestQuit( (iOThread)ListOp.get( data->workers, i ) );
+  }
+  if( data->streamer != NULL )
+    ThreadOp.requestQuit( data->streamer );
   
   if( data->webclient != NULL ) {
     if( data->pportmanager != NULL )
@@ -386,6 +661,18 @@ static iOMap _createPostDataMap( const char* postdata ) {
   return map;
 }
 
+/** Forward an event to the server-sent events clients. */
+static void _broadcastEvent( struct OHttp* inst, iONode evt ) {
+  iOHttpData data = Data(inst);
+  /* Only clone if someone listens. */
+  if( data->streamer != NULL && ListOp.size( data->streamList ) > 0 ) {
+    iONode clone = (iONode)NodeOp.base.clone( evt );
+    if( !ThreadOp.post( data->streamer, (obj)clone ) )
+      NodeOp.base.del( clone );
+  }
+}
+
+
 static void _deletePostDataMap( iOMap map ) {
   char* attrvalue = (char*)MapOp.first( map );
   do {
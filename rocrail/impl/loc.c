@@ -31,6 +31,7 @@
 #include "rocrail/public/control.h"
 #include "rocrail/public/http.h"
 #include "rocrail/public/operator.h"
+#include "rocrail/public/sim.h"
 
 #include "rocint/public/lcdriverint.h"
 
@@ -43,6 +44,8 @@
 #include "rocs/public/msg.h"
 #include "rocs/public/lib.h"
 #include "rocs/public/system.h"
+#include "rocs/public/metrics.h"
+#include "rocs/public/span.h"
 
 #include "rocrail/wrapper/public/RocRail.h"
 #include "rocrail/wrapper/public/ModelCmd.h"
@@ -64,6 +67,21 @@
 #include "rocrail/wrapper/public/BinStateCmd.h"
 
 static int instCnt = 0;
+static int __mRunnerLag = -1;
+static int __mRunnerTick = -1;
+static int __mBroadcast = -1;
+static int __mBroadcastAttrs = -1;
+static int __mBroadcastMerged = -1;
+static int __bcGen = 0;
+static int __sLoc = -1;
+static int __sLcDriver = -1;
+static int __sLocCmd = -1;
+
+/* Loco mode as kept in the hot state; the props node holds the string. */
+#define LCMODE_IDLE     0
+#define LCMODE_WAIT     1
+#define LCMODE_HALFAUTO 2
+#define LCMODE_AUTO     3
 
 static iONode __resetTimedFunction(iOLoc loc, iONode cmd, int function);
 static void __checkConsist( iOLoc inst, iONode nodeA, Boolean byEvent );
@@ -74,6 +92,7 @@ static void __doSound(iOLoc inst, iONode cmd);
 static void __initBBTmap( iOLoc loc );
 static void __initCVmap( iOLoc loc );
 static Boolean __loadDriver( iOLoc inst );
+static void __sendBroadcast( iOLoc inst, iONode node, Boolean delta );
 
 /*
  ***** OBase functions.
@@ -83,6 +102,59 @@ static const char* __id( void* inst ) {
   return wLoc.getid( data->props );
 }
 
+static int __modeNr( const char* mode ) {
+  if( StrOp.equals( wLoc.mode_auto, mode ) )
+    return LCMODE_AUTO;
+  if( StrOp.equals( wLoc.mode_wait, mode ) )
+    return LCMODE_WAIT;
+  if( StrOp.equals( wLoc.mode_halfauto, mode ) )
+    return LCMODE_HALFAUTO;
+  return LCMODE_IDLE;
+}
+
+/**
+ * Hot state: the runner reads these every tick instead of looking up the props attributes.
+ * Settings are taken over at inst, modify and postForm; speed, direction, functions and mode are
+ * written through on change, the runtime counter only on flush.
+ */
+static void __initHot( iOLoc inst ) {
+  iOLocData data = Data(inst);
+
+  data->hotV    = wLoc.getV( data->props );
+  data->hotDir  = wLoc.isdir( data->props );
+  data->hotFx   = wLoc.getfx( data->props );
+  data->hotMode = __modeNr( wLoc.getmode( data->props ) );
+  data->hotInfo = wLoc.isinfo4throttle( data->props );
+
+  data->hotVstep   = wLoc.getV_step( data->props );
+  data->hotVmin    = wLoc.getV_min( data->props );
+  data->hotPercent = StrOp.equals( wLoc.V_mode_percent, wLoc.getV_mode( data->props ) ) &&
+                     data->hotVstep > 0 && !wLoc.isregulated( data->props );
+
+  data->hotBBT              = wLoc.isusebbt( data->props );
+  data->hotBBTfromblock     = wLoc.isbbtusefromblock( data->props );
+  data->hotBBTsteps         = wLoc.getbbtsteps( data->props );
+  data->hotBBTmaxdiff       = wLoc.getbbtmaxdiff( data->props );
+  data->hotBBTcorrection    = wLoc.getbbtcorrection( data->props );
+  data->hotBBTstartinterval = wLoc.getbbtstartinterval( data->props );
+  if( data->hotBBTsteps < 4 || data->hotBBTsteps > 16 )
+    data->hotBBTsteps = 10;
+  if( data->hotBBTmaxdiff < 100 || data->hotBBTmaxdiff > 500 )
+    data->hotBBTmaxdiff = 250;
+  if( data->hotBBTcorrection < 10 || data->hotBBTcorrection > 100 )
+    data->hotBBTcorrection = 25;
+}
+
+static void __setV( iOLocData data, int V ) {
+  data->hotV = V;
+  wLoc.setV( data->props, V );
+}
+
+static void __setDir( iOLocData data, Boolean dir ) {
+  data->hotDir = dir;
+  wLoc.setdir( data->props, dir );
+}
+
 static void __checkAction( iOLoc inst, const char* state ) {
 
   iOLocData data     = Data(inst);
@@ -251,6 +323,7 @@ static void __saveFxState(iOLoc inst) {
   fx |= data->fn26 ? 0x2000000:0;
   fx |= data->fn27 ? 0x4000000:0;
   fx |= data->fn28 ? 0x8000000:0;
+  data->hotFx = fx;
   wLoc.setfx( data->props, fx );
 }
 
@@ -437,7 +510,7 @@ static void __resetFx( void* threadinst ) {
   LocOp.cmd(loc, (iONode)NodeOp.base.clone(fcmd) );
 
   wLoc.setfx( fcmd, wLoc.getfx( data->props ) );
-  AppOp.broadcastEvent( fcmd );
+  __sendBroadcast( loc, fcmd, False );
 
   data->fxresetpending = False;
   ThreadOp.base.del(th);
@@ -637,15 +710,133 @@ static void _depart(iOLoc inst) {
 }
 
 
+/**
+ * Broadcast a loco event and remember what the clients know about the loco.
+ * With delta only the attributes which differ from the last sent state are passed on.
+ */
+static void __sendBroadcast( iOLoc inst, iONode node, Boolean delta ) {
+  iOLocData data = Data(inst);
+  Boolean isLoc = StrOp.equals( wLoc.name(), NodeOp.getName(node) ) && !wLoc.isbbtevent(node);
+
+  MutexOp.wait( data->muxBroadcast );
+  if( data->bcSent == NULL )
+    data->bcSent = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
+
+  /* a client took over the plan since the last broadcast; it may hold a state the others never got */
+  if( isLoc && data->bcGen != __bcGen ) {
+    data->bcGen = __bcGen;
+    delta = False;
+  }
+
+  if( isLoc && data->bcPending != NULL ) {
+    /* this event supersedes the pending state */
+    NodeOp.mergeNode( node, data->bcPending, False, False, False );
+    NodeOp.base.del( data->bcPending );
+    data->bcPending = NULL;
+    MetricsOp.add( __mBroadcastMerged, 1 );
+  }
+
+  if( isLoc && delta && NodeOp.getChildCnt( node ) == 0 &&
+      wCtrl.islcbroadcastdelta( AppOp.getIniNode( wCtrl.name() ) ) )
+  {
+    iONode changed = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
+    int cnt = NodeOp.getAttrCnt( node );
+    int i = 0;
+    for( i = 0; i < cnt; i++ ) {
+      iOAttr attr = NodeOp.getAttr( node, i );
+      const char* attrname = AttrOp.getName( attr );
+      const char* sent = NodeOp.getStr( data->bcSent, attrname, NULL );
+      if( StrOp.equals( "id", attrname ) || StrOp.equals( "cmd", attrname ) ||
+          sent == NULL || !StrOp.equals( sent, AttrOp.getVal( attr ) ) )
+        NodeOp.setStr( changed, attrname, AttrOp.getVal( attr ) );
+    }
+    NodeOp.mergeNode( data->bcSent, node, True, False, False );
+    NodeOp.base.del( node );
+    node = changed;
+
+    if( NodeOp.getAttrCnt( node ) == 1 ) {
+      /* nothing new for the clients */
+      MutexOp.post( data->muxBroadcast );
+      NodeOp.base.del( node );
+      return;
+    }
+    wLoc.setdelta( node, True );
+  }
+  else if( isLoc ) {
+    NodeOp.mergeNode( data->bcSent, node, True, False, False );
+  }
+  data->bcLast = SystemOp.getTick();
+  MutexOp.post( data->muxBroadcast );
+
+  MetricsOp.add( __mBroadcast, 1 );
+  MetricsOp.add( __mBroadcastAttrs, NodeOp.getAttrCnt( node ) );
+  AppOp.broadcastEvent( node );
+}
+
+
+static void _resyncBroadcasts( void ) {
+  __bcGen++;
+}
+
+
+/* Stop, direction change and commands are passed on at once; plain state updates are coalesced. */
+static Boolean __isUrgent( iOLocData data, const char* cmd, iONode node ) {
+  const char* sentDir = NULL;
+  const char* nodeCmd = wLoc.getcmd( node );
+
+  if( cmd != NULL || data->runner == NULL || NodeOp.getChildCnt( node ) > 0 )
+    return True;
+  if( !StrOp.equals( wLoc.name(), NodeOp.getName(node) ) )
+    return True;
+  if( nodeCmd != NULL && !StrOp.equals( wLoc.velocity, nodeCmd ) )
+    return True;
+
+  if( data->bcSent == NULL )
+    return True;
+  sentDir = NodeOp.getStr( data->bcSent, "dir", NULL );
+  if( sentDir == NULL || wLoc.isdir( node ) != wLoc.isdir( data->bcSent ) )
+    return True;
+  if( wLoc.getV( node ) == 0 && wLoc.getV( data->bcSent ) != 0 )
+    return True;
+
+  return False;
+}
+
+
+/* Called by the runner: send the pending state after the coalescing window has expired. */
+static void __flushBroadcast( iOLoc inst ) {
+  iOLocData data = Data(inst);
+  iONode pending = NULL;
+
+  if( data->bcPending == NULL )
+    return;
+
+  MutexOp.wait( data->muxBroadcast );
+  if( data->bcPending != NULL ) {
+    int window = wCtrl.getlcbroadcastwindow( AppOp.getIniNode( wCtrl.name() ) ) / 10;
+    if( SystemOp.getTick() - data->bcLast >= window ) {
+      pending = data->bcPending;
+      data->bcPending = NULL;
+    }
+  }
+  MutexOp.post( data->muxBroadcast );
+
+  if( pending != NULL )
+    __sendBroadcast( inst, pending, True );
+}
+
+
 static void __broadcastLocoProps( iOLoc inst, const char* cmd, iONode node, const char* blockId ) {
   iOLocData data = Data(inst);
+  int window = wCtrl.getlcbroadcastwindow( AppOp.getIniNode( wCtrl.name() ) ) / 10;
+  LocOp.flush( inst );
   if( node == NULL )
     node = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
   wLoc.setid( node, wLoc.getid( data->props ) );
-  wLoc.setdir( node, wLoc.isdir( data->props ) );
+  wLoc.setdir( node, data->hotDir );
   wLoc.setaddr( node, wLoc.getaddr( data->props ) );
   wLoc.setsecaddr( node, wLoc.getsecaddr( data->props ) );
-  wLoc.setV( node, wLoc.getV( data->props ) );
+  wLoc.setV( node, data->hotV );
   wLoc.setplacing( node, wLoc.isplacing( data->props ) );
   wLoc.setblockenterside( node, wLoc.isblockenterside( data->props ) );
   wLoc.setmode( node, wLoc.getmode( data->props ) );
@@ -674,7 +865,24 @@ static void __broadcastLocoProps( iOLoc inst, const char* cmd, iONode node, cons
   if( cmd != NULL )
     wLoc.setcmd( node, cmd );
   wLoc.setfifotop( node, wLoc.isfifotop( data->props ) );
-  AppOp.broadcastEvent( node );
+
+  MutexOp.wait( data->muxBroadcast );
+  if( window > 0 && !__isUrgent( data, cmd, node ) ) {
+    if( data->bcPending != NULL ) {
+      NodeOp.mergeNode( data->bcPending, node, True, False, False );
+      NodeOp.base.del( node );
+      MetricsOp.add( __mBroadcastMerged, 1 );
+      node = NULL;
+    }
+    else if( SystemOp.getTick() - data->bcLast < window ) {
+      data->bcPending = node;
+      node = NULL;
+    }
+  }
+  MutexOp.post( data->muxBroadcast );
+
+  if( node != NULL )
+    __sendBroadcast( inst, node, True );
 }
 
 static void* __event( void* inst, const void* evt ) {
@@ -747,7 +955,7 @@ static void* __event( void* inst, const void* evt ) {
       TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "lc=%s dir=%d fn=%d",
           wLoc.getid(data->props), wLoc.isdir(evtNode), wLoc.isfn(evtNode) );
       if( !data->go ) {
-        wLoc.setdir( data->props, wLoc.isplacing(data->props) ? wLoc.isdir(evtNode):!wLoc.isdir(evtNode) );
+        __setDir( data, wLoc.isplacing(data->props) ? wLoc.isdir(evtNode):!wLoc.isdir(evtNode) );
         if( StrOp.equals( wLoc.dirfun, wLoc.getcmd(evtNode) ) ) {
           wLoc.setfn( data->props, wLoc.isfn(evtNode) );
           data->fn0 = wLoc.isfn(evtNode);
@@ -757,8 +965,8 @@ static void* __event( void* inst, const void* evt ) {
 
     if( !data->go ) {
       TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "lc=%s V=%d(%d)",
-          wLoc.getid(data->props), V, wLoc.getV(data->props) );
-      wLoc.setV( data->props, V);
+          wLoc.getid(data->props), V, data->hotV );
+      __setV( data, V );
       data->drvSpeed = V;
     }
     else {
@@ -830,7 +1038,7 @@ static void* __event( void* inst, const void* evt ) {
       __cpFn2Node(inst, node, -1, 0);
       wFunCmd.setf0( node, wLoc.isfn(data->props) );
       TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "broadcasting function command %d...", wFunCmd.isf0( node));
-      AppOp.broadcastEvent( node );
+      __sendBroadcast( (iOLoc)inst, node, False );
     }
   }
   else if( StrOp.equals( wSysCmd.name(), NodeOp.getName(evtNode) ) ) {
@@ -867,6 +1075,10 @@ static void __del(void* inst) {
   };
   if( data->runner != NULL )
     ThreadOp.base.del(data->runner);
+  if( data->bcPending != NULL )
+    NodeOp.base.del(data->bcPending);
+  if( data->bcSent != NULL )
+    NodeOp.base.del(data->bcSent);
   freeMem( data );
   freeMem( inst );
   instCnt--;
@@ -1080,7 +1292,7 @@ static void __doSound(iOLoc inst, iONode cmd) {
   iOLocData    data = Data(inst);
 
   if( wFunCmd.getfnchanged(cmd) != -1 ) {
-    int fx = wLoc.getfx( data->props );
+    int fx = data->hotFx;
     if( fx & 1 << (wFunCmd.getfnchanged(cmd)-1) ) {
       int addr = 0;
       const char* sound = __getFnSound(inst, wFunCmd.getfnchanged(cmd), &addr );
@@ -1131,7 +1343,7 @@ static Boolean __engine( iOLoc inst, iONode cmd ) {
   const char* V_hint   = NULL;
   int         V_maxkmh = 0;
   int         V_new    = -1;
-  int         V_old    = wLoc.getV(data->props);
+  int         V_old    = data->hotV;
   iONode      cmdTD    = NULL;
   iONode      cmdFn    = NULL;
   int     fnchanged   = -1;
@@ -1152,16 +1364,16 @@ static Boolean __engine( iOLoc inst, iONode cmd ) {
     }
 
     /* Workarounds for the P50 interface. */
-    if( NodeOp.findAttr(cmd,"dir") && wLoc.isdir(cmd) != wLoc.isdir( data->props ) ) {
+    if( NodeOp.findAttr(cmd,"dir") && wLoc.isdir(cmd) != data->hotDir ) {
       /* Informing the P50 interface. */
       wLoc.setsw( cmd, True );
-      wLoc.setdir( data->props, wLoc.isdir(cmd) );
+      __setDir( data, wLoc.isdir(cmd) );
       __checkAction(inst, "dirchange");
     }
     else if( wLoc.issw( cmd ) ) {
       /* Could be generated by the switch button of the locdlg. */
-      wLoc.setdir( cmd, !wLoc.isdir( data->props ) );
-      wLoc.setdir( data->props, wLoc.isdir(cmd) );
+      wLoc.setdir( cmd, !data->hotDir );
+      __setDir( data, wLoc.isdir(cmd) );
       __checkAction(inst, "dirchange");
     }
 
@@ -1297,7 +1509,7 @@ static Boolean __engine( iOLoc inst, iONode cmd ) {
   }
 
   else if( !LocOp.isAutomode(inst) || data->gomanual ) {
-    if( wLoc.isinfo4throttle(data->props ) ) {
+    if( data->hotInfo ) {
       data->infocheck++;
       if( data->infocheck > 10 ) {
         if( cmd == NULL ) {
@@ -1320,7 +1532,7 @@ static Boolean __engine( iOLoc inst, iONode cmd ) {
     if( data->drvSpeed != V_new || StrOp.equals( wFunCmd.name(), NodeOp.getName(cmd )) ) {
       TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "V_hint: [%s][%d maxkmh] = %d", V_hint, V_maxkmh, V_new );
       data->drvSpeed = V_new;
-      wLoc.setV( data->props, V_new);
+      __setV( data, V_new );
       wLoc.setV_hint( data->props, V_hint );
       if( cmd == NULL )
         cmd = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
@@ -1336,7 +1548,7 @@ static Boolean __engine( iOLoc inst, iONode cmd ) {
   }
   else if( V_new != -1 ) {
     data->drvSpeed = V_new;
-    wLoc.setV( data->props, V_new);
+    __setV( data, V_new );
     if( cmd == NULL )
       cmd = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
     wLoc.setV( cmd, V_new );
@@ -1355,15 +1567,13 @@ static Boolean __engine( iOLoc inst, iONode cmd ) {
         __funEvent(inst, NULL, stall_event, 0);
         __checkAction(inst, "stall");
       }
-      wLoc.setV(data->props, data->drvSpeed);
+      __setV( data, data->drvSpeed );
     }
   }
 
   /* Check for simple decoders like "Maerklin Delta": */
-  if( StrOp.equals( wLoc.V_mode_percent, wLoc.getV_mode( data->props ) ) &&
-      wLoc.getV_step( data->props ) > 0 && !wLoc.isregulated( data->props ) )
-  {
-    if( data->step >= wLoc.getV_step( data->props ) ) {
+  if( data->hotPercent ) {
+    if( data->step >= data->hotVstep ) {
       data->step = 0;
       if( data->curSpeed != data->drvSpeed ) {
         if( data->curSpeed < data->drvSpeed ) {
@@ -1409,7 +1619,7 @@ static Boolean __engine( iOLoc inst, iONode cmd ) {
     wLoc.setprotver( cmd, wLoc.getprotver( data->props ) );
     wLoc.setspcnt( cmd, wLoc.getspcnt( data->props ) );
     wLoc.setfncnt( cmd, wLoc.getfncnt( data->props ) );
-    wLoc.setdir( cmd, wLoc.isdir( data->props ) );
+    wLoc.setdir( cmd, data->hotDir );
     wLoc.setfn( cmd, data->fn0 );
     wLoc.setoid( cmd, wLoc.getoid(data->props) );
     wLoc.setid( cmd, wLoc.getid(data->props) );
@@ -1499,7 +1709,7 @@ static Boolean __engine( iOLoc inst, iONode cmd ) {
   }
 
   if( wCtrl.isreleaseonidle( AppOp.getIniNode( wCtrl.name() )) ) {
-    if( cmd == NULL && wLoc.getV(data->props) == 0 && !data->go && !data->released ) {
+    if( cmd == NULL && data->hotV == 0 && !data->go && !data->released ) {
       /* Release loco? */
       cmd = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
       wLoc.setaddr(cmd, wLoc.getaddr(data->props));
@@ -1693,17 +1903,9 @@ static void _resetBBT(iOLoc loc) {
  */
 static void __BBT(iOLoc loc) {
   iOLocData data = Data(loc);
-  int bbtsteps      = wLoc.getbbtsteps(data->props);
-  int bbtmaxdiff    = wLoc.getbbtmaxdiff(data->props);
-  int bbtcorrection = wLoc.getbbtcorrection(data->props);
-  if( bbtsteps < 4 || bbtsteps > 16 )
-    bbtsteps = 10;
-  if( bbtmaxdiff < 100 || bbtmaxdiff > 500 )
-    bbtmaxdiff = 250;
-  if( bbtcorrection < 10 || bbtcorrection > 100 )
-    bbtcorrection = 25;
-
-  bbtcorrection = 100 / bbtcorrection;
+  int bbtsteps      = data->hotBBTsteps;
+  int bbtmaxdiff    = data->hotBBTmaxdiff;
+  int bbtcorrection = 100 / data->hotBBTcorrection;
 
   if( data->bbtEnter != 0 && data->bbtIn == 0  && data->bbtEnterBlock != NULL ) {
     if( data->bbtInTimer > 0 ) {
@@ -1720,7 +1922,7 @@ static void __BBT(iOLoc loc) {
       char* key = NULL;
       iONode bbt = NULL;
       data->bbtPrevBlock = data->driver->getCurblock(data->driver);
-      if( wLoc.isbbtusefromblock( data->props ) )
+      if( data->hotBBTfromblock )
         key = StrOp.fmt("%s-%s", data->bbtEnterBlock, data->bbtPrevBlock);
       else
         key = StrOp.fmt("%s", data->bbtEnterBlock);
@@ -1737,7 +1939,7 @@ static void __BBT(iOLoc loc) {
       }
       else {
         TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "BBT-Record **not** found: [%s]", key);
-        data->bbtInterval = wLoc.getbbtstartinterval(data->props);
+        data->bbtInterval = data->hotBBTstartinterval;
       }
       StrOp.free(key);
       data->bbtSpeed = data->drvSpeed;
@@ -1750,7 +1952,7 @@ static void __BBT(iOLoc loc) {
 
     if( data->drvSpeed > 0 && !data->bbtAtMinSpeed && data->bbtCycleSpeed >= 0 && (data->bbtCycleSpeed % data->bbtInterval) == 0 ) {
       iONode cmd = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
-      int V_min = wLoc.getV_min( data->props );
+      int V_min = data->hotVmin;
       int speed = 0;
       data->bbtCycleNr++;
       /* Subtract the Min. speed from the calculation. */
@@ -1764,7 +1966,7 @@ static void __BBT(iOLoc loc) {
       TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "BBT-SPEED V=%d id=%s mode=%s", speed, wLoc.getid(data->props), wLoc.getmode(data->props)  );
 
       wLoc.setV( cmd, speed );
-      wLoc.setdir( cmd, wLoc.isdir( data->props ) );
+      wLoc.setdir( cmd, data->hotDir );
       LocOp.cmd( loc, cmd );
       data->bbtStepCount++;
     }
@@ -1781,7 +1983,7 @@ static void __BBT(iOLoc loc) {
   if( data->bbtEnter != 0 && data->bbtIn != 0 && data->bbtEnterBlock != NULL && data->bbtInBlock != NULL ) {
     /*data->prevBlock*/
     char* key = NULL;
-    if( wLoc.isbbtusefromblock( data->props ) )
+    if( data->hotBBTfromblock )
       key = StrOp.fmt("%s-%s", data->bbtInBlock, data->bbtPrevBlock);
     else
       key = StrOp.fmt("%s", data->bbtInBlock);
@@ -1840,7 +2042,7 @@ static void __BBT(iOLoc loc) {
         wLoc.setbbtevent(broadcast, True);
         TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "BBT-IN interval=%d block=%s bbtcorrection=%d count=%d (broadcast)",
             interval, data->bbtInBlock, bbtcorrection, wBBT.getcount(bbt) );
-        AppOp.broadcastEvent( broadcast );
+        __sendBroadcast( loc, broadcast, False );
       }
 
     }
@@ -1875,6 +2077,17 @@ static void __BBT(iOLoc loc) {
 }
 
 
+/* With coalescing the idle tick is slept in BBT ticks, so a pending broadcast leaves with its window. */
+static void __runnerSleep( iOLoc inst, int ms ) {
+  if( wCtrl.getlcbroadcastwindow( AppOp.getIniNode( wCtrl.name() ) ) > 0 ) {
+    for( ; ms > RUNNERBBTTICK; ms -= RUNNERBBTTICK ) {
+      ThreadOp.sleep( RUNNERBBTTICK );
+      __flushBroadcast( inst );
+    }
+  }
+  ThreadOp.sleep( ms );
+}
+
 static void __runner( void* threadinst ) {
   iOThread th = (iOThread)threadinst;
   iOLoc loc = (iOLoc)ThreadOp.getParm( th );
@@ -1884,6 +2097,8 @@ static void __runner( void* threadinst ) {
   int   virtualtick = 0;
   Boolean cnfgsend = False;
   Boolean loccnfg = wCtrl.isloccnfg( AppOp.getIniNode( wCtrl.name() ) );
+  unsigned long lastCycle = 0;
+  unsigned long cycleStart = 0;
 
   ThreadOp.sleep(500);
   ThreadOp.setDescription( th, wLoc.getdesc( data->props ) );
@@ -1917,9 +2132,11 @@ static void __runner( void* threadinst ) {
     int   fx    = 0;
     obj   udata = NULL;
 
+    __flushBroadcast( loc );
+
     /* BBT 10ms cycle */
-    if( !data->gomanual && wLoc.isusebbt(data->props) ) {
-      if( StrOp.equals( wLoc.mode_wait, wLoc.getmode(data->props) )  && !data->bbtExternalStop ) {
+    if( !data->gomanual && data->hotBBT ) {
+      if( data->hotMode == LCMODE_WAIT && !data->bbtExternalStop ) {
         __BBT(loc);
       }
       ThreadOp.sleep( RUNNERBBTTICK );
@@ -1931,6 +2148,16 @@ static void __runner( void* threadinst ) {
     }
 
     /* Normal 100ms cycle */
+    {
+      /* lag: how much later than RUNNERTICK this cycle starts */
+      unsigned long now = MetricsOp.now();
+      if( lastCycle != 0 ) {
+        long lag = (long)( now - lastCycle ) - RUNNERTICK * 1000;
+        MetricsOp.observe( __mRunnerLag, lag > 0 ? lag:0 );
+      }
+      lastCycle = now;
+      cycleStart = now;
+    }
     msg = __getQueueMsg(data, queueList, (iOMsg)ThreadOp.getPost( th ) );
 
     data->nrruns++;
@@ -1956,7 +2183,14 @@ static void __runner( void* threadinst ) {
         if( event != -1 ) {
           TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "inform the driver of event=%d nrruns=%d", event, data->nrruns );
         }
+        /* the event cargo is the span of the sensor event which caused it */
+        if( udata != NULL ) {
+          SpanOp.mark( (long)udata, __sLcDriver );
+          SpanOp.setCurrent( (long)udata );
+        }
         data->driver->drive( data->driver, emitter, event );
+        if( udata != NULL )
+          SpanOp.setCurrent( 0 );
       }
     }
 
@@ -1989,16 +2223,16 @@ static void __runner( void* threadinst ) {
 
     /* this is approximately a second */
     if( tick % 10 == 0 && tick != 0 ) {
-      if( data->drvSpeed > 0 || (!data->go && wLoc.getV(data->props) > 0) ) {
+      if( data->drvSpeed > 0 || (!data->go && data->hotV > 0) ) {
         if( !data->govirtual ) {
           data->runtime++;
-          wLoc.setruntime( data->props, data->runtime );
+          data->runtimeDirty = True;
         }
       }
       tick = 0;
 
-      if( StrOp.equals( wLoc.mode_auto, wLoc.getmode(data->props) ) ) {
-        if( data->govirtual && data->driver != NULL ) {
+      if( data->hotMode == LCMODE_AUTO ) {
+        if( data->govirtual && data->driver != NULL && !SimOp.isActive( AppOp.getSim() ) ) {
           virtualtick++;
           if( virtualtick >= wCtrl.getvirtualtimer( AppOp.getIniNode( wCtrl.name() ) ) ) {
             virtualtick = 0;
@@ -2015,7 +2249,7 @@ static void __runner( void* threadinst ) {
     }
 
 
-    fx = wLoc.getfx( data->props );
+    fx = data->hotFx;
     for( i = 0; i < 28; i++ ) {
       if( ( i == 0 && data->fn0 && data->fxtimer[i] > 0 ) || ( i > 0 && (fx & (1 << (i-1))) && data->fxtimer[i] > 0 ) ) {
         data->fxtimer[i]--;
@@ -2062,8 +2296,10 @@ static void __runner( void* threadinst ) {
       }
     }
 
-    if( data->gomanual || !wLoc.isusebbt(data->props) ) {
-      ThreadOp.sleep( RUNNERTICK );
+    MetricsOp.since( __mRunnerTick, cycleStart );
+
+    if( data->gomanual || !data->hotBBT ) {
+      __runnerSleep( loc, RUNNERTICK );
     }
     tick++;
 
@@ -2177,6 +2413,9 @@ static void _event( iOLoc inst, obj emitter, int evt, int timer, Boolean forcewa
   iOMsg msg = MsgOp.inst( emitter, evt );
   iIBlockBase block = (iIBlockBase)MsgOp.getSender(msg);
   const char* blockid = block!=NULL ? block->base.id( block ):"?";
+  long span = SpanOp.getCurrent();
+
+  SpanOp.mark( span, __sLoc );
 
   data->curSensor = id;
 
@@ -2228,7 +2467,7 @@ static void _event( iOLoc inst, obj emitter, int evt, int timer, Boolean forcewa
     TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999,
         "event %d from [%s], timer=%d, forcewait=%d nrruns=%d", evt, blockid, timer, forcewait, data->nrruns );
     MsgOp.setTimer( msg, timer );
-    MsgOp.setUsrData( msg, NULL, forcewait ? 1000:0 );
+    MsgOp.setUsrData( msg, (void*)span, forcewait ? 1000:0 );
     ThreadOp.post( data->runner, (obj)msg );
     TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "event posted");
     __funEvent(inst, blockid, evt, timer);
@@ -2611,6 +2850,7 @@ static void _setMode( iOLoc inst, const char* mode ) {
 
     TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "Loco [%s] mode=%s prevmode=%s", LocOp.getId(inst), mode, wLoc.getmode(data->props) );
     wLoc.setmode(data->props, mode);
+    data->hotMode = __modeNr( mode );
 
     __broadcastLocoProps( inst, NULL, NULL, NULL );
   }
@@ -2705,7 +2945,7 @@ static void _stopNet( iOLoc inst ) {
     /* Broadcast to clients. */
     broadcast = (iONode)NodeOp.base.clone(data->props);
     wLoc.setV( broadcast, data->drvSpeed );
-    AppOp.broadcastEvent( broadcast );
+    __sendBroadcast( inst, broadcast, False );
   }
 }
 
@@ -2768,7 +3008,7 @@ static void _reset( iOLoc inst, Boolean saveCurBlock ) {
     data->driver->reset( data->driver, saveCurBlock );
 
   /* Broadcast to clients. */
-  AppOp.broadcastEvent( (iONode)NodeOp.base.clone( data->props ) );
+  __sendBroadcast( inst, (iONode)NodeOp.base.clone( data->props ), False );
 
 }
 
@@ -2817,6 +3057,7 @@ static Boolean _govirtual( iOLoc inst ) {
       data->gomanual = (data->manual?True:False);
       data->govirtual = True;
       data->released = False;
+      SimOp.add( AppOp.getSim(), LocOp.getId(inst) );
       if( data->driver != NULL )
         data->driver->go( data->driver, data->gomanual );
       return True;
@@ -2952,6 +3193,8 @@ static Boolean _cmd( iOLoc inst, iONode nodeA ) {
   const char* nodename = NodeOp.getName( nodeA );
   const char* cmd  = wLoc.getcmd( nodeA );
 
+  SpanOp.mark( SpanOp.getCurrent(), __sLocCmd );
+
   if( !data->run ) {
     NodeOp.base.del(nodeA);
     return False;
@@ -3358,6 +3601,9 @@ static void _modify( iOLoc inst, iONode props ) {
 
   data->secondnextblock = wLoc.issecondnextblock( data->props );
 
+  __initHot(inst);
+  LocOp.flush(inst);
+
   __initBBTmap(inst);
 
   __initCVmap(inst);
@@ -3375,7 +3621,7 @@ static void _modify( iOLoc inst, iONode props ) {
     iONode clone = (iONode)props->base.clone( props );
     wLoc.setid(clone, wLoc.getid( data->props ) );
     wLoc.setcmd(clone, wModelCmd.modify );
-    AppOp.broadcastEvent( clone );
+    __sendBroadcast( inst, clone, False );
   }
   props->base.del(props);
 }
@@ -3498,6 +3744,9 @@ static char* _postForm( void* inst, const char* postdata ) {
       wLoc.setV_step( data->props, ival );
   }
 
+  /* the runner reads V_min and V_step from the hot state */
+  __initHot( (iOLoc)inst );
+
   /* Cleanup map: */
   HttpOp.deletePostDataMap( map );
   return reply;
@@ -3562,7 +3811,7 @@ static void __initBBTmap( iOLoc loc ) {
   MapOp.clear(data->bbtMap);
   while( bbt != NULL ) {
     char* key = NULL;
-    if( wLoc.isbbtusefromblock( data->props ) )
+    if( data->hotBBTfromblock )
       key = StrOp.fmt("%s-%s", wBBT.getbk(bbt), wBBT.getfrombk(bbt));
     else
       key = StrOp.fmt("%s", wBBT.getbk(bbt));
@@ -3626,7 +3875,7 @@ static void _setCV( iOLoc loc, int nr, int value ) {
   {
     iONode clone = (iONode)data->props->base.clone( data->props );
     wLoc.setcmd( clone, wModelCmd.modify );
-    AppOp.broadcastEvent( clone );
+    __sendBroadcast( loc, clone, False );
   }
 }
 
@@ -3671,7 +3920,7 @@ static void _swapPlacing( iOLoc loc, iONode cmd, Boolean consist, Boolean direct
  */
 static Boolean _getDir( iOLoc loc ) {
   iOLocData data = Data(loc);
-  Boolean dir     = wLoc.isdir( data->props );
+  Boolean dir     = data->hotDir;
   Boolean placing = wLoc.isplacing( data->props );
 
   if( !placing ) {
@@ -3760,6 +4009,12 @@ static Boolean _isManually( iOLoc loc ) {
 }
 
 
+static Boolean _isVirtual( iOLoc loc ) {
+  iOLocData data = Data(loc);
+  return data->govirtual;
+}
+
+
 static Boolean _matchIdent( iOLoc loc, const char* ident, const char* ident2, const char* ident3, const char* ident4 ) {
   iOLocData data = Data(loc);
   Boolean match = False;
@@ -3867,9 +4122,18 @@ static void _setClass( iOLoc inst, const char* p_Class ) {
   iOLocData data = Data(inst);
   wLoc.setclass(data->props, p_Class);
   /* Broadcast to clients. */
-  AppOp.broadcastEvent( (iONode)NodeOp.base.clone( data->props ) );
+  __sendBroadcast( inst, (iONode)NodeOp.base.clone( data->props ), False );
 }
 
+static void _flush( iOLoc inst ) {
+  iOLocData data = Data(inst);
+  if( data->runtimeDirty ) {
+    data->runtimeDirty = False;
+    wLoc.setruntime( data->props, data->runtime );
+  }
+}
+
+
 static void _setMaxKmh( iOLoc inst, int maxkmh ) {
   iOLocData data = Data(inst);
   TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "loco [%s] maxkmh=%d", wLoc.getid(data->props), maxkmh);
@@ -3893,6 +4157,21 @@ static iOLoc _inst( iONode props ) {
   data->bbtMap = MapOp.inst();
   data->muxEngine = MutexOp.inst( NULL, True );
   data->muxCmd = MutexOp.inst( NULL, True );
+  data->muxBroadcast = MutexOp.inst( NULL, True );
+  if( __mRunnerLag == -1 )
+    __mRunnerLag = MetricsOp.histogram( "loc_runner_lag_us", "Loco runner cycle delay in microseconds." );
+  if( __mRunnerTick == -1 )
+    __mRunnerTick = MetricsOp.histogram( "loc_runner_tick_us", "Loco runner cycle work in microseconds." );
+  if( __mBroadcast == -1 ) {
+    __mBroadcast       = MetricsOp.counter( "loc_broadcasts", "Loco state events sent to the clients." );
+    __mBroadcastAttrs  = MetricsOp.counter( "loc_broadcast_attrs", "Attributes in the loco state events sent." );
+    __mBroadcastMerged = MetricsOp.counter( "loc_broadcasts_coalesced", "Loco state events merged into a pending one." );
+  }
+  if( __sLoc == -1 ) {
+    __sLoc      = SpanOp.stage( "loc" );
+    __sLcDriver = SpanOp.stage( "lcdriver" );
+    __sLocCmd   = SpanOp.stage( "loccmd" );
+  }
 
   wLoc.setmode(data->props, wLoc.mode_idle);
 
@@ -3919,6 +4198,7 @@ static iOLoc _inst( iONode props ) {
   data->fn0 = wLoc.isfn(data->props);
   wLoc.setthrottleid( data->props, "" );
 
+  __initHot( loc );
   __initCVmap( loc );
   __initBBTmap( loc );
 
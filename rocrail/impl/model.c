@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include "rocrail/impl/model_impl.h"
 #include "rocrail/public/modelutils.h"
@@ -45,6 +46,7 @@
 #include "rocrail/public/r2rnet.h"
 #include "rocrail/public/location.h"
 #include "rocrail/public/analyse.h"
+#include "rocrail/public/reservation.h"
 
 #include "rocs/public/doc.h"
 #include "rocs/public/trace.h"
@@ -56,6 +58,8 @@
 #include "rocs/public/thread.h"
 #include "rocs/public/lib.h"
 #include "rocs/public/system.h"
+#include "rocs/public/metrics.h"
+#include "rocs/public/span.h"
 
 #include "rocrail/wrapper/public/Global.h"
 #include "rocrail/wrapper/public/Plan.h"
@@ -107,6 +111,7 @@
 #include "rocrail/wrapper/public/ScheduleList.h"
 #include "rocrail/wrapper/public/Ctrl.h"
 #include "rocrail/wrapper/public/RocRail.h"
+#include "rocrail/wrapper/public/Tcp.h"
 #include "rocrail/wrapper/public/State.h"
 #include "rocrail/wrapper/public/ModOcc.h"
 #include "rocrail/wrapper/public/Occupancy.h"
@@ -131,8 +136,15 @@
 #include "rocrail/wrapper/public/Variable.h"
 #include "rocrail/wrapper/public/VariableList.h"
 #include "rocrail/wrapper/public/Weather.h"
+#include "rocrail/wrapper/public/FbBatch.h"
+#include "rocrail/wrapper/public/FbDelta.h"
 
 static int instCnt = 0;
+static int __mFindDest = -1;
+static int __mFbBatch = -1;
+static int __mFbBatchSensors = -1;
+static int __mPlanSnapshot = -1;
+static int __sModel = -1;
 
 
 static Boolean __removeLoco(iOModel data, iONode item );
@@ -227,6 +239,77 @@ static int __sortLocation(obj* _a, obj* _b)
 }
 
 
+/* Object registries: the loco, block, route and switch maps are mirrored
+   in an RcuMap, so the get functions never take a lock and never see a
+   map in the middle of a change. Changes go through __put/__remove, which
+   serialize the writers of one registry. The registry only guards its
+   maps, not the objects in them: there is no per-object lock or reference
+   count, so an object a thread already holds can still be removed and
+   deleted by another. Iterations in this file walk a __snapshot; the
+   maps handed out by getLocoMap/getSwitchMap are iterated unguarded. */
+static iORegistry __registry( iOModelData o, iOMap map ) {
+  iORegistry reg = o->registry;
+  while( reg->map != NULL ) {
+    if( reg->map == map )
+      return reg;
+    reg++;
+  }
+  return NULL;
+}
+
+/* The registry array is terminated by an entry without map. */
+static iORcuMap __addRegistry( iOModelData o, iOMap map ) {
+  iORegistry reg = o->registry;
+  while( reg->map != NULL )
+    reg++;
+  reg->map = map;
+  reg->idx = RcuMapOp.inst();
+  reg->mux = MutexOp.inst( NULL, True );
+  return reg->idx;
+}
+
+static void __put( iOModelData o, iOMap map, const char* key, obj item ) {
+  iORegistry reg = __registry( o, map );
+  if( reg == NULL ) {
+    MapOp.put( map, key, item );
+    return;
+  }
+  MutexOp.wait( reg->mux );
+  MapOp.put( map, key, item );
+  RcuMapOp.put( reg->idx, key, item );
+  MutexOp.post( reg->mux );
+}
+
+/* On return no new lookup can hand out the removed object; a thread that
+   got it before is not waited for. */
+static obj __remove( iOModelData o, iOMap map, const char* key ) {
+  iORegistry reg = __registry( o, map );
+  obj item = NULL;
+  if( reg == NULL )
+    return MapOp.remove( map, key );
+  MutexOp.wait( reg->mux );
+  item = MapOp.remove( map, key );
+  RcuMapOp.remove( reg->idx, key );
+  RcuMapOp.synchronize( reg->idx );
+  MutexOp.post( reg->mux );
+  return item;
+}
+
+/* The objects of a map, copied under the registry lock; MapOp.first/next
+   share one cursor per map, so they must not run beside a writer or
+   another iteration. The caller deletes the list. */
+static iOList __snapshot( iOModelData o, iOMap map ) {
+  iORegistry reg = __registry( o, map );
+  iOList list = NULL;
+  if( reg != NULL )
+    MutexOp.wait( reg->mux );
+  list = MapOp.getList( map );
+  if( reg != NULL )
+    MutexOp.post( reg->mux );
+  return list;
+}
+
+
 
 /*
  ***** _Public functions.
@@ -242,6 +325,174 @@ static const iONode _getModel( iOModel inst ) {
   return data->model;
 }
 
+/* A connecting client gets a ticket when its plan is posted; any snapshot
+   serialized after that ticket was issued is recent enough for it, so the
+   plan is serialized once for a burst of reconnects instead of per client. */
+static long _getPlanTicket( iOModel inst ) {
+  iOModelData data = Data(inst);
+  long ticket = 0;
+  MutexOp.wait( data->ticketMux );
+  data->planTicket++;
+  ticket = data->planTicket;
+  MutexOp.post( data->ticketMux );
+  return ticket;
+}
+
+static void __unrefPlanSnapshot( iOModelData data, iOPlanSnapshot snapshot ) {
+  snapshot->refs--;
+  if( snapshot->refs <= 0 ) {
+    ListOp.removeObj( data->snapshots, (obj)snapshot );
+    StrOp.free( snapshot->text );
+    freeMem( snapshot );
+  }
+}
+
+static const char* _getPlanSnapshot( iOModel inst, long ticket, int* size ) {
+  iOModelData data = Data(inst);
+  iOPlanSnapshot snapshot = NULL;
+
+  MutexOp.wait( data->snapMux );
+  if( data->snapshot == NULL || data->snapshot->ticket < ticket ) {
+    unsigned long t0 = SystemOp.getTick();
+    unsigned long us0 = MetricsOp.now();
+    snapshot = allocMem( sizeof( struct PlanSnapshot ) );
+    MutexOp.wait( data->ticketMux );
+    snapshot->ticket = data->planTicket;
+    MutexOp.post( data->ticketMux );
+    wPlan.setplanversion( data->model, data->planVersion );
+    /* runtime attribute changes wait until the plan is serialized */
+    MutexOp.wait( NodeOp.getGuard() );
+    snapshot->text = NodeOp.base.toString( data->model );
+    MutexOp.post( NodeOp.getGuard() );
+    MetricsOp.since( __mPlanSnapshot, us0 );
+    /* loco deltas must not build on a state older than this snapshot */
+    LocOp.resyncBroadcasts();
+    snapshot->size = StrOp.len( snapshot->text );
+    /* the cache holds one reference until the snapshot is replaced */
+    snapshot->refs = 1;
+    ListOp.add( data->snapshots, (obj)snapshot );
+    if( data->snapshot != NULL )
+      __unrefPlanSnapshot( data, data->snapshot );
+    data->snapshot = snapshot;
+    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "plan snapshot %ld serialized: %d bytes in %lums",
+        snapshot->ticket, snapshot->size, (SystemOp.getTick() - t0) * 10 );
+  }
+  snapshot = data->snapshot;
+  snapshot->refs++;
+  if( size != NULL )
+    *size = snapshot->size;
+  MutexOp.post( data->snapMux );
+
+  return snapshot->text;
+}
+
+static void _releasePlanSnapshot( iOModel inst, const char* text ) {
+  iOModelData data = Data(inst);
+  int i = 0;
+
+  MutexOp.wait( data->snapMux );
+  for( i = 0; i < ListOp.size( data->snapshots ); i++ ) {
+    iOPlanSnapshot snapshot = (iOPlanSnapshot)ListOp.get( data->snapshots, i );
+    if( snapshot->text == text ) {
+      __unrefPlanSnapshot( data, snapshot );
+      break;
+    }
+  }
+  MutexOp.post( data->snapMux );
+}
+
+/* Plan changes are numbered and kept in a bounded log, so a reconnecting
+   client which still has the plan of a known version only needs the
+   changes made since. Called with snapMux locked. */
+static void __logPlanChange( iOModelData data, iONode cmd ) {
+  iONode marker = NodeOp.inst( wModelCmd.name(), NULL, ELEMENT_NODE );
+
+  data->planVersion++;
+
+  if( data->planLogSize > 0 ) {
+    iONode change = (iONode)NodeOp.base.clone( cmd );
+    wModelCmd.setplanversion( change, data->planVersion );
+    ListOp.add( data->planLog, (obj)change );
+    while( ListOp.size( data->planLog ) > data->planLogSize ) {
+      iONode old = (iONode)ListOp.remove( data->planLog, 0 );
+      NodeOp.base.del( old );
+    }
+  }
+
+  /* clients take over the version after all broadcasts of the change */
+  wModelCmd.setcmd( marker, wModelCmd.version );
+  wModelCmd.setplanversion( marker, data->planVersion );
+  AppOp.broadcastEvent( marker );
+}
+
+/* Changes which do not come from a logged add/modify/remove command, like the
+   plan title, modules and items generated by the server, cannot be replayed:
+   the version is bumped and the log dropped, so resuming clients get the full
+   plan. Items of the command being logged by this thread are skipped. */
+static void __unloggedPlanChange( iOModelData data, iONode item ) {
+  Boolean locked = data->planCmdThread == ThreadOp.id() ? True:False;
+
+  if( locked && item != NULL && NodeOp.getParent( item ) == data->planCmd )
+    return;
+
+  if( !locked )
+    MutexOp.wait( data->snapMux );
+  data->planVersion++;
+  while( ListOp.size( data->planLog ) > 0 ) {
+    iONode old = (iONode)ListOp.remove( data->planLog, 0 );
+    NodeOp.base.del( old );
+  }
+  if( !locked )
+    MutexOp.post( data->snapMux );
+}
+
+/* The model command of which the items are logged; called with snapMux locked. */
+static void __setPlanCmd( iOModelData data, iONode cmd ) {
+  data->planCmd = cmd;
+  data->planCmdThread = cmd != NULL ? ThreadOp.id():0;
+}
+
+/* Post the changes made strictly after the given version to a client,
+   ended by a resumed marker; returns False if the log does not reach back
+   that far. Broadcasts queued for the client before the replay are also in
+   the replay, so the client skips them until the resumed marker. */
+static Boolean __replayPlanChanges( iOModelData data, long since, const char* server ) {
+  Boolean replayed = False;
+  long first = 0;
+  int i = 0;
+
+  MutexOp.wait( data->snapMux );
+  if( ListOp.size( data->planLog ) > 0 )
+    first = wModelCmd.getplanversion( (iONode)ListOp.get( data->planLog, 0 ) );
+  else
+    first = data->planVersion + 1;
+
+  if( since <= data->planVersion && since >= first - 1 ) {
+    iONode marker = NodeOp.inst( wModelCmd.name(), NULL, ELEMENT_NODE );
+    int cnt = 0;
+    for( i = 0; i < ListOp.size( data->planLog ); i++ ) {
+      iONode change = (iONode)ListOp.get( data->planLog, i );
+      if( wModelCmd.getplanversion( change ) > since ) {
+        ClntConOp.postEvent( AppOp.getClntCon(), (iONode)NodeOp.base.clone( change ), server );
+        cnt++;
+      }
+    }
+    wModelCmd.setcmd( marker, wModelCmd.resumed );
+    wModelCmd.setplanversion( marker, data->planVersion );
+    ClntConOp.postEvent( AppOp.getClntCon(), marker, server );
+    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "resume %s from plan version %ld: %d changes up to %ld",
+        server, since, cnt, data->planVersion );
+    replayed = True;
+  }
+  else {
+    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "plan version %ld of %s not in change log [%ld-%ld]; sending full plan",
+        since, server, first, data->planVersion );
+  }
+  MutexOp.post( data->snapMux );
+
+  return replayed;
+}
+
 static const iONode _getModPlan( iOModel inst ) {
   iOModelData data = Data(inst);
   if(data->moduleplan != NULL )
@@ -277,6 +528,7 @@ static void _setModule( iOModel inst, iONode module ) {
   }
 
   item = ModPlanOp.setModule(data->moduleplan, module);
+  __unloggedPlanChange( data, NULL );
   if( item != NULL )
     ModelOp.modifyItem( inst, item );
 
@@ -655,11 +907,34 @@ static void _updateFB( iOModel inst ) {
   __updateDigInt( inst );
 }
 
+/* Compiled action conditions may refer to the item, or live in its action controls. */
+static void __invalidateConditions( iONode item ) {
+  const char* id = wItem.getid( item );
+  if( id == NULL || StrOp.len(id) == 0 || StrOp.equals(wSystemActions.name(), NodeOp.getName(item)) )
+    ActionOp.invalidate( NULL );
+  else {
+    ActionOp.invalidate( id );
+    if( wItem.getprev_id( item ) != NULL && StrOp.len( wItem.getprev_id( item ) ) > 0 )
+      ActionOp.invalidate( wItem.getprev_id( item ) );
+  }
+}
+
+/* Timed actions, timer variables and system actions are scheduled by the model clock. */
+static void __reschedule( iONode item ) {
+  iOControl control = AppOp.getControl();
+  const char* itemName = NodeOp.getName( item );
+  if( control != NULL && ( StrOp.equals( wAction.name(), itemName ) || StrOp.equals( wVariable.name(), itemName ) ||
+      StrOp.equals( wSystemActions.name(), itemName ) ) )
+    ControlOp.reschedule( control, item );
+}
+
 static Boolean _addItem( iOModel inst, iONode item ) {
   iOModelData data = Data(inst);
   const char* itemName = NodeOp.getName( item );
   Boolean added = False;
 
+  __unloggedPlanChange( data, item );
+
   if(  !StrOp.equals(wZLevel.name(), NodeOp.getName(item) ) && (wItem.getid(item) == NULL || StrOp.len(wItem.getid(item)) == 0 ||
       StrOp.equals("(null)", wItem.getid(item)) ) ) {
     TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "invalid id for new [%s]", itemName );
@@ -672,7 +947,7 @@ static Boolean _addItem( iOModel inst, iONode item ) {
     iONode clone = (iONode)item->base.clone( item );
     if( __addItemInList( data, wBlockList.name(), clone ) ) {
       iOBlock bk = BlockOp.inst( clone );
-      MapOp.put( data->blockMap, wBlock.getid( item ), (obj)bk );
+      __put( data, data->blockMap, wBlock.getid( item ), (obj)bk );
       added = True;
     }
     else {
@@ -712,7 +987,7 @@ static Boolean _addItem( iOModel inst, iONode item ) {
     iONode clone = (iONode)item->base.clone( item );
     if( __addItemInList( data, wTurntableList.name(), clone ) ) {
       iOTT tt = TTOp.inst( clone );
-      MapOp.put( data->ttMap, wTurntable.getid( item ), (obj)tt );
+      __put( data, data->ttMap, wTurntable.getid( item ), (obj)tt );
       added = True;
     }
     else {
@@ -723,7 +998,7 @@ static Boolean _addItem( iOModel inst, iONode item ) {
     iONode clone = (iONode)item->base.clone( item );
     if( __addItemInList( data, wSelTabList.name(), clone ) ) {
       iOSelTab seltab = SelTabOp.inst( clone );
-      MapOp.put( data->seltabMap, wSelTab.getid( item ), (obj)seltab );
+      __put( data, data->seltabMap, wSelTab.getid( item ), (obj)seltab );
       added = True;
     }
     else {
@@ -734,7 +1009,7 @@ static Boolean _addItem( iOModel inst, iONode item ) {
     iONode clone = (iONode)item->base.clone( item );
     if( __addItemInList( data, wStageList.name(), clone ) ) {
       iOStage stage = StageOp.inst( clone );
-      MapOp.put( data->stageMap, wStage.getid( item ), (obj)stage );
+      __put( data, data->stageMap, wStage.getid( item ), (obj)stage );
       added = True;
     }
     else {
@@ -784,7 +1059,7 @@ static Boolean _addItem( iOModel inst, iONode item ) {
     iONode clone = (iONode)item->base.clone( item );
     if( __addItemInList( data, wLocList.name(), clone ) ) {
       iOLoc lc = LocOp.inst( clone );
-      MapOp.put( data->locMap, wLoc.getid( item ), (obj)lc );
+      __put( data, data->locMap, wLoc.getid( item ), (obj)lc );
       ListOp.add( data->locList, (obj)lc );
       added = True;
     }
@@ -818,7 +1093,7 @@ static Boolean _addItem( iOModel inst, iONode item ) {
     iONode clone = (iONode)item->base.clone( item );
     if( __addItemInList( data, wRouteList.name(), clone ) ) {
       iORoute st = RouteOp.inst( clone );
-      MapOp.put( data->routeMap, wRoute.getid( clone ), (obj)st );
+      __put( data, data->routeMap, wRoute.getid( clone ), (obj)st );
       ListOp.add( data->routeList, (obj)st);
       added = True;
     }
@@ -830,7 +1105,7 @@ static Boolean _addItem( iOModel inst, iONode item ) {
     iONode clone = (iONode)item->base.clone( item );
     if( __addItemInList( data, wSwitchList.name(), clone ) ) {
       iOSwitch sw = SwitchOp.inst( clone );
-      MapOp.put( data->switchMap, wSwitch.getid( item ), (obj)sw );
+      __put( data, data->switchMap, wSwitch.getid( item ), (obj)sw );
       ListOp.add( data->switchList, (obj)sw );
       added = True;
     }
@@ -948,6 +1223,8 @@ static Boolean _addItem( iOModel inst, iONode item ) {
     TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "new item added %s %s", itemName, wItem.getid(item) );
     /* Broadcast to clients. */
     AppOp.broadcastEvent( cmd );
+    __invalidateConditions( item );
+    __reschedule( item );
   }
 
   return added;
@@ -961,6 +1238,8 @@ static Boolean _modifyItem( iOModel inst, iONode item ) {
   const char* prev_id = wItem.getprev_id( item );
   Boolean modified = False;
 
+  __unloggedPlanChange( data, item );
+
   if( !StrOp.equals(wMVTrack.name(), NodeOp.getName(item) ) &&
       !StrOp.equals(wSystemActions.name(), NodeOp.getName(item) ) &&
       !StrOp.equals(wWeather.name(), NodeOp.getName(item) ) &&
@@ -970,20 +1249,22 @@ static Boolean _modifyItem( iOModel inst, iONode item ) {
     return False;
   }
 
+  /* before: no compiled condition may keep the old objects; after: none may keep the old nodes */
+  __invalidateConditions( item );
 
   if( StrOp.equals( wModule.name(), name ) ) {
     modified = ModPlanOp.modify(data->moduleplan, item);
   }
   else if( StrOp.equals( wBlock.name(), name ) ) {
-    iOBlock bk = (iOBlock)MapOp.get( data->blockMap, id );
+    iOBlock bk = (iOBlock)RcuMapOp.get( data->blockIdx, id );
     if( bk != NULL ) {
       BlockOp.modify( bk, (iONode)NodeOp.base.clone( item ) );
       modified = True;
     }
-    else if( StrOp.len(prev_id) > 0 && (bk = (iOBlock)MapOp.get( data->blockMap, prev_id ) ) ) {
+    else if( StrOp.len(prev_id) > 0 && (bk = (iOBlock)RcuMapOp.get( data->blockIdx, prev_id ) ) ) {
       BlockOp.modify( bk, (iONode)NodeOp.base.clone( item ) );
-      MapOp.remove( data->blockMap, prev_id );
-      MapOp.put( data->blockMap, id, (obj)bk );
+      __remove( data, data->blockMap, prev_id );
+      __put( data, data->blockMap, id, (obj)bk );
       ModelUtilsOp.renameItemDependencies(data->model, id, prev_id, BlockOp.base.properties(bk) );
       modified = True;
     }
@@ -1042,15 +1323,15 @@ static Boolean _modifyItem( iOModel inst, iONode item ) {
     }
   }
   else if( StrOp.equals( wLoc.name(), name ) ) {
-    iOLoc lc = (iOLoc)MapOp.get( data->locMap, wLoc.getid( item ) );
+    iOLoc lc = (iOLoc)RcuMapOp.get( data->locIdx, wLoc.getid( item ) );
     if( lc != NULL ) {
       LocOp.modify( lc, (iONode)NodeOp.base.clone( item ) );
       modified = True;
     }
-    else if( StrOp.len(prev_id) > 0 && (lc = (iOLoc)MapOp.get( data->locMap, prev_id ) ) ) {
+    else if( StrOp.len(prev_id) > 0 && (lc = (iOLoc)RcuMapOp.get( data->locIdx, prev_id ) ) ) {
       LocOp.modify( lc, (iONode)NodeOp.base.clone( item ) );
-      MapOp.remove( data->locMap, prev_id );
-      MapOp.put( data->locMap, id, (obj)lc );
+      __remove( data, data->locMap, prev_id );
+      __put( data, data->locMap, id, (obj)lc );
       ModelUtilsOp.renameItemDependencies(data->model, id, prev_id, LocOp.base.properties(lc) );
       modified = True;
     }
@@ -1096,15 +1377,15 @@ static Boolean _modifyItem( iOModel inst, iONode item ) {
     }
   }
   else if( StrOp.equals( wRoute.name(), name ) ) {
-    iORoute st = (iORoute)MapOp.get( data->routeMap, wRoute.getid( item ) );
+    iORoute st = (iORoute)RcuMapOp.get( data->routeIdx, wRoute.getid( item ) );
     if( st != NULL ) {
       RouteOp.modify( st, (iONode)NodeOp.base.clone( item ) );
       modified = True;
     }
-    else if( StrOp.len(prev_id) > 0 && (st = (iORoute)MapOp.get( data->routeMap, prev_id ) ) ) {
+    else if( StrOp.len(prev_id) > 0 && (st = (iORoute)RcuMapOp.get( data->routeIdx, prev_id ) ) ) {
       RouteOp.modify( st, (iONode)NodeOp.base.clone( item ) );
-      MapOp.remove( data->routeMap, prev_id );
-      MapOp.put( data->routeMap, id, (obj)st );
+      __remove( data, data->routeMap, prev_id );
+      __put( data, data->routeMap, id, (obj)st );
       ModelUtilsOp.renameItemDependencies(data->model, id, prev_id, RouteOp.base.properties(st) );
       modified = True;
     }
@@ -1113,15 +1394,15 @@ static Boolean _modifyItem( iOModel inst, iONode item ) {
     }
   }
   else if( StrOp.equals( wSwitch.name(), name ) ) {
-    iOSwitch sw = (iOSwitch)MapOp.get( data->switchMap, wSwitch.getid( item ) );
+    iOSwitch sw = (iOSwitch)RcuMapOp.get( data->switchIdx, wSwitch.getid( item ) );
     if( sw != NULL ) {
       SwitchOp.modify( sw, (iONode)NodeOp.base.clone( item ) );
       modified = True;
     }
-    else if( StrOp.len(prev_id) > 0 && (sw = (iOSwitch)MapOp.get( data->switchMap, prev_id ) ) ) {
+    else if( StrOp.len(prev_id) > 0 && (sw = (iOSwitch)RcuMapOp.get( data->switchIdx, prev_id ) ) ) {
       SwitchOp.modify( sw, (iONode)NodeOp.base.clone( item ) );
-      MapOp.remove( data->switchMap, prev_id );
-      MapOp.put( data->switchMap, id, (obj)sw );
+      __remove( data, data->switchMap, prev_id );
+      __put( data, data->switchMap, id, (obj)sw );
       ModelUtilsOp.renameItemDependencies(data->model, id, prev_id, SwitchOp.base.properties(sw) );
       modified = True;
     }
@@ -1181,15 +1462,15 @@ static Boolean _modifyItem( iOModel inst, iONode item ) {
     }
   }
   else if( StrOp.equals( wTurntable.name(), name ) ) {
-    iOTT tt = (iOTT)MapOp.get( data->ttMap, wTurntable.getid( item ) );
+    iOTT tt = (iOTT)RcuMapOp.get( data->ttIdx, wTurntable.getid( item ) );
     if( tt != NULL ) {
       TTOp.modify( tt, (iONode)NodeOp.base.clone( item ) );
       modified = True;
     }
-    else if( StrOp.len(prev_id) > 0 && (tt = (iOTT)MapOp.get( data->ttMap, prev_id ) ) ) {
+    else if( StrOp.len(prev_id) > 0 && (tt = (iOTT)RcuMapOp.get( data->ttIdx, prev_id ) ) ) {
       TTOp.modify( tt, (iONode)NodeOp.base.clone( item ) );
-      MapOp.remove( data->ttMap, prev_id );
-      MapOp.put( data->ttMap, id, (obj)tt );
+      __remove( data, data->ttMap, prev_id );
+      __put( data, data->ttMap, id, (obj)tt );
       ModelUtilsOp.renameItemDependencies(data->model, id, prev_id, TTOp.base.properties(tt) );
       modified = True;
     }
@@ -1198,15 +1479,15 @@ static Boolean _modifyItem( iOModel inst, iONode item ) {
     }
   }
   else if( StrOp.equals( wSelTab.name(), name ) ) {
-    iOSelTab seltab = (iOSelTab)MapOp.get( data->seltabMap, wSelTab.getid( item ) );
+    iOSelTab seltab = (iOSelTab)RcuMapOp.get( data->seltabIdx, wSelTab.getid( item ) );
     if( seltab != NULL ) {
       SelTabOp.modify( seltab, (iONode)NodeOp.base.clone( item ) );
       modified = True;
     }
-    else if( StrOp.len(prev_id) > 0 && (seltab = (iOSelTab)MapOp.get( data->seltabMap, prev_id ) ) ) {
+    else if( StrOp.len(prev_id) > 0 && (seltab = (iOSelTab)RcuMapOp.get( data->seltabIdx, prev_id ) ) ) {
       SelTabOp.modify( seltab, (iONode)NodeOp.base.clone( item ) );
-      MapOp.remove( data->seltabMap, prev_id );
-      MapOp.put( data->seltabMap, id, (obj)seltab );
+      __remove( data, data->seltabMap, prev_id );
+      __put( data, data->seltabMap, id, (obj)seltab );
       ModelUtilsOp.renameItemDependencies(data->model, id, prev_id, SelTabOp.base.properties(seltab) );
       modified = True;
     }
@@ -1215,15 +1496,15 @@ static Boolean _modifyItem( iOModel inst, iONode item ) {
     }
   }
   else if( StrOp.equals( wStage.name(), name ) ) {
-    iOStage stage = (iOStage)MapOp.get( data->stageMap, wStage.getid( item ) );
+    iOStage stage = (iOStage)RcuMapOp.get( data->stageIdx, wStage.getid( item ) );
     if( stage != NULL ) {
       StageOp.modify( stage, (iONode)NodeOp.base.clone( item ) );
       modified = True;
     }
-    else if( StrOp.len(prev_id) > 0 && (stage = (iOStage)MapOp.get( data->stageMap, prev_id ) ) ) {
+    else if( StrOp.len(prev_id) > 0 && (stage = (iOStage)RcuMapOp.get( data->stageIdx, prev_id ) ) ) {
       StageOp.modify( stage, (iONode)NodeOp.base.clone( item ) );
-      MapOp.remove( data->stageMap, prev_id );
-      MapOp.put( data->stageMap, id, (obj)stage );
+      __remove( data, data->stageMap, prev_id );
+      __put( data, data->stageMap, id, (obj)stage );
       ModelUtilsOp.renameItemDependencies(data->model, id, prev_id, StageOp.base.properties(stage) );
       modified = True;
     }
@@ -1518,6 +1799,8 @@ static Boolean _modifyItem( iOModel inst, iONode item ) {
     }
   }
 
+  __invalidateConditions( item );
+  __reschedule( item );
   return modified;
 }
 
@@ -1526,11 +1809,14 @@ static Boolean _removeItem( iOModel inst, iONode item ) {
   const char* name = NodeOp.getName( item );
   Boolean removed = False;
 
+  __unloggedPlanChange( o, item );
+  __invalidateConditions( item );
+
   if( StrOp.equals( wBlock.name(), name ) ) {
-    iIBlockBase bk = (iIBlockBase)MapOp.get( o->blockMap, wBlock.getid( item ) );
+    iIBlockBase bk = (iIBlockBase)RcuMapOp.get( o->blockIdx, wBlock.getid( item ) );
     if( bk != NULL ) {
       iONode props = bk->base.properties( bk );
-      MapOp.remove( o->blockMap, wBlock.getid( item ) );
+      __remove( o, o->blockMap, wBlock.getid( item ) );
       /* Remove item from list: */
       __removeItemFromList( o, wBlockList.name(), props );
       bk->base.del( bk );
@@ -1563,11 +1849,11 @@ static Boolean _removeItem( iOModel inst, iONode item ) {
     }
   }
   else if( StrOp.equals( wTurntable.name(), name ) ) {
-    iOTT tt = (iOTT)MapOp.get( o->ttMap, wTurntable.getid( item ) );
+    iOTT tt = (iOTT)RcuMapOp.get( o->ttIdx, wTurntable.getid( item ) );
     if( tt != NULL ) {
       iONode props = TTOp.base.properties( tt );
-      MapOp.remove( o->ttMap, wTurntable.getid( item ) );
-      MapOp.remove( o->blockMap, wTurntable.getid( item ) );
+      __remove( o, o->ttMap, wTurntable.getid( item ) );
+      __remove( o, o->blockMap, wTurntable.getid( item ) );
       /* Remove item from list: */
       __removeItemFromList( o, wTurntableList.name(), props );
       tt->base.del( tt );
@@ -1576,11 +1862,11 @@ static Boolean _removeItem( iOModel inst, iONode item ) {
     }
   }
   else if( StrOp.equals( wSelTab.name(), name ) ) {
-    iOSelTab seltab = (iOSelTab)MapOp.get( o->seltabMap, wSelTab.getid( item ) );
+    iOSelTab seltab = (iOSelTab)RcuMapOp.get( o->seltabIdx, wSelTab.getid( item ) );
     if( seltab != NULL ) {
       iONode props = SelTabOp.base.properties( seltab );
-      MapOp.remove( o->seltabMap, wSelTab.getid( item ) );
-      MapOp.remove( o->blockMap, wSelTab.getid( item ) );
+      __remove( o, o->seltabMap, wSelTab.getid( item ) );
+      __remove( o, o->blockMap, wSelTab.getid( item ) );
       /* Remove item from list: */
       __removeItemFromList( o, wSelTabList.name(), props );
       seltab->base.del( seltab );
@@ -1589,11 +1875,11 @@ static Boolean _removeItem( iOModel inst, iONode item ) {
     }
   }
   else if( StrOp.equals( wStage.name(), name ) ) {
-    iOStage stage = (iOStage)MapOp.get( o->stageMap, wStage.getid( item ) );
+    iOStage stage = (iOStage)RcuMapOp.get( o->stageIdx, wStage.getid( item ) );
     if( stage != NULL ) {
       iONode props = StageOp.base.properties( stage );
-      MapOp.remove( o->stageMap, wStage.getid( item ) );
-      MapOp.remove( o->blockMap, wStage.getid( item ) );
+      __remove( o, o->stageMap, wStage.getid( item ) );
+      __remove( o, o->blockMap, wStage.getid( item ) );
       /* Remove item from list: */
       __removeItemFromList( o, wStageList.name(), props );
       stage->base.del( stage );
@@ -1654,10 +1940,10 @@ static Boolean _removeItem( iOModel inst, iONode item ) {
     }
   }
   else if( StrOp.equals( wRoute.name(), name ) ) {
-    iORoute st = (iORoute)MapOp.get( o->routeMap, wRoute.getid( item ) );
+    iORoute st = (iORoute)RcuMapOp.get( o->routeIdx, wRoute.getid( item ) );
     if( st != NULL ) {
       iONode props = RouteOp.base.properties( st );
-      MapOp.remove( o->routeMap, wRoute.getid( item ) );
+      __remove( o, o->routeMap, wRoute.getid( item ) );
       /* Remove item from list: */
       __removeItemFromList( o, wRouteList.name(), props );
       ListOp.removeObj( o->routeList, (obj)st);
@@ -1668,10 +1954,10 @@ static Boolean _removeItem( iOModel inst, iONode item ) {
     }
   }
   else if( StrOp.equals( wSwitch.name(), name ) ) {
-    iOSwitch sw = (iOSwitch)MapOp.get( o->switchMap, wSwitch.getid( item ) );
+    iOSwitch sw = (iOSwitch)RcuMapOp.get( o->switchIdx, wSwitch.getid( item ) );
     if( sw != NULL ) {
       iONode props = SwitchOp.base.properties( sw );
-      MapOp.remove( o->switchMap, wSwitch.getid( item ) );
+      __remove( o, o->switchMap, wSwitch.getid( item ) );
       /* Remove item from list: */
       __removeItemFromList( o, wSwitchList.name(), props );
       ListOp.removeObj( o->switchList, (obj)sw);
@@ -1841,6 +2127,8 @@ static Boolean _removeItem( iOModel inst, iONode item ) {
       };
     }
   }
+  __invalidateConditions( item );
+  __reschedule( item );
   return removed;
 }
 
@@ -1866,15 +2154,17 @@ static void __reset( iOModel inst, Boolean saveCurBlock ) {
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "reset blocks..." );
   {
-    iIBlockBase block = (iIBlockBase)MapOp.first( data->blockMap );
-    while( block != NULL ) {
+    iOList list = __snapshot( data, data->blockMap );
+    int i = 0;
+    for( i = 0; i < ListOp.size( list ); i++ ) {
+      iIBlockBase block = (iIBlockBase)ListOp.get( list, i );
       block->reset( block, saveCurBlock );
       if( block->getLoc( block ) != NULL && StrOp.len(block->getLoc( block )) > 0 ) {
         TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999,
             "Block [%s] is occupied by [%d] after reset.", block->base.id(block), block->getLoc( block ) );
       }
-      block = (iIBlockBase)MapOp.next( data->blockMap );
     }
+    ListOp.base.del( list );
   }
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "reset block groups..." );
@@ -1888,29 +2178,31 @@ static void __reset( iOModel inst, Boolean saveCurBlock ) {
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "reset routes..." );
   {
-    iORoute route = (iORoute)MapOp.first( data->routeMap );
-    while( route != NULL ) {
-      RouteOp.reset( route );
-      route = (iORoute)MapOp.next( data->routeMap );
-    }
+    iOList list = __snapshot( data, data->routeMap );
+    int i = 0;
+    for( i = 0; i < ListOp.size( list ); i++ )
+      RouteOp.reset( (iORoute)ListOp.get( list, i ) );
+    ListOp.base.del( list );
   }
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "reset turntables..." );
   {
-    iIBlockBase tt = (iIBlockBase)MapOp.first( data->ttMap );
-    while( tt != NULL ) {
+    iOList list = __snapshot( data, data->ttMap );
+    int i = 0;
+    for( i = 0; i < ListOp.size( list ); i++ ) {
+      iIBlockBase tt = (iIBlockBase)ListOp.get( list, i );
       tt->reset( tt, saveCurBlock );
-      tt = (iIBlockBase)MapOp.next( data->ttMap );
     }
+    ListOp.base.del( list );
   }
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "reset switches..." );
   {
-    iOSwitch sw = (iOSwitch)MapOp.first( data->switchMap );
-    while( sw != NULL ) {
-      SwitchOp.reset( sw );
-      sw = (iOSwitch)MapOp.next( data->switchMap );
-    }
+    iOList list = __snapshot( data, data->switchMap );
+    int i = 0;
+    for( i = 0; i < ListOp.size( list ); i++ )
+      SwitchOp.reset( (iOSwitch)ListOp.get( list, i ) );
+    ListOp.base.del( list );
   }
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "reset locations..." );
@@ -2068,14 +2360,14 @@ static void __startAllLocosRunner( void* threadinst ) {
 
   if( MapOp.size(data->stageMap) > 0 && data->pendingstartall) {
     TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "%s stages...", ThreadOp.getName(th) );
-    iOStage stage = (iOStage)MapOp.first( data->stageMap );
-    while( stage != NULL ) {
+    iOList list = __snapshot( data, data->stageMap );
+    for( i = 0; i < ListOp.size( list ); i++ ) {
       iONode cmd = NodeOp.inst( wStage.name(), NULL, ELEMENT_NODE );
       wStage.setcmd( cmd, wStage.compress );
-      StageOp.cmd((iIBlockBase)stage, cmd);
+      StageOp.cmd((iIBlockBase)ListOp.get( list, i ), cmd);
       ThreadOp.sleep( 10 + gap * 1000 );
-      stage = (iOStage)MapOp.next( data->stageMap );
     }
+    ListOp.base.del( list );
   }
 
   data->pendingstartall = False;
@@ -2169,12 +2461,14 @@ static Boolean _cmd( iOModel inst, iONode cmd ) {
       }
       if( autoMode && !data->autoMode ) {
         /* TODO: signal to all blocks */
-        iIBlockBase block = (iIBlockBase)MapOp.first( data->blockMap );
-        while( block != NULL ) {
+        iOList list = __snapshot( data, data->blockMap );
+        int i = 0;
+        for( i = 0; i < ListOp.size( list ); i++ ) {
+          iIBlockBase block = (iIBlockBase)ListOp.get( list, i );
           block->init( block );
           ThreadOp.sleep( wCtrl.getblockinitpause( wRocRail.getctrl( AppOp.getIni() ) ) );
-          block = (iIBlockBase)MapOp.next( data->blockMap );
         }
+        ListOp.base.del( list );
         TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Block init ready" );
       }
       data->autoMode = autoMode;
@@ -2211,6 +2505,7 @@ static Boolean _cmd( iOModel inst, iONode cmd ) {
     if( data->moduleplan != NULL ) {
       iONode module = NodeOp.getChild(cmd,0);
       ModPlanOp.addModule( data->moduleplan, module);
+      __unloggedPlanChange( data, NULL );
     }
     else {
       TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "can not add module: no active module plan..." );
@@ -2218,6 +2513,7 @@ static Boolean _cmd( iOModel inst, iONode cmd ) {
   }
   else if( StrOp.equals( wModelCmd.plantitle, cmdVal ) ) {
     wPlan.settitle(data->model, wModelCmd.getval(cmd) );
+    __unloggedPlanChange( data, NULL );
   }
   else if( StrOp.equals( wModelCmd.themes, cmdVal ) ) {
     /* TODO: Send the preferred themes to the Rocview.*/
@@ -2236,28 +2532,44 @@ static Boolean _cmd( iOModel inst, iONode cmd ) {
   else if( StrOp.equals( wModelCmd.add, cmdVal ) ) {
     int childCnt = NodeOp.getChildCnt( cmd );
     int i = 0;
+    /* structural changes must not run while a plan snapshot is serialized */
+    MutexOp.wait( data->snapMux );
+    __setPlanCmd( data, cmd );
     for( i = 0; i < childCnt; i++ ) {
       iONode child = NodeOp.getChild( cmd, i );
       _addItem( inst, child );
     }
+    __setPlanCmd( data, NULL );
+    __logPlanChange( data, cmd );
+    MutexOp.post( data->snapMux );
   }
   else if( StrOp.equals( wModelCmd.modify, cmdVal ) ) {
     int childCnt = NodeOp.getChildCnt( cmd );
     int i = 0;
+    MutexOp.wait( data->snapMux );
+    __setPlanCmd( data, cmd );
     for( i = 0; i < childCnt; i++ ) {
       iONode child = NodeOp.getChild( cmd, i );
       _modifyItem( inst, child );
     }
+    __setPlanCmd( data, NULL );
+    __logPlanChange( data, cmd );
+    MutexOp.post( data->snapMux );
   }
   else if( StrOp.equals( wModelCmd.remove, cmdVal ) ) {
     int childCnt = NodeOp.getChildCnt( cmd );
     int i = 0;
+    MutexOp.wait( data->snapMux );
+    __setPlanCmd( data, cmd );
     for( i = 0; i < childCnt; i++ ) {
       iONode child = NodeOp.getChild( cmd, i );
       _removeItem( inst, child );
     }
+    __setPlanCmd( data, NULL );
     /* Broadcast to clients. */
     AppOp.broadcastEvent( (iONode)NodeOp.base.clone( cmd ) );
+    __logPlanChange( data, cmd );
+    MutexOp.post( data->snapMux );
   }
   else if( StrOp.equals( wModelCmd.plan, cmdVal ) ) {
     /* Post AutoState and Model to client. */
@@ -2289,7 +2601,9 @@ static Boolean _cmd( iOModel inst, iONode cmd ) {
     wPlan.sethealthy( data->model, ModelOp.isHealthy(inst) );
     ClntConOp.postEvent( AppOp.getClntCon(), autoevent, wCommand.getserver( cmd ) );
     ClntConOp.postEvent( AppOp.getClntCon(), stateevent, wCommand.getserver( cmd ) );
-    ClntConOp.postEvent( AppOp.getClntCon(), data->model, wCommand.getserver( cmd ) );
+    /* a client which already has the plan of a known version only gets the changes since */
+    if( wModelCmd.getplanversion( cmd ) == 0 || !__replayPlanChanges( data, wModelCmd.getplanversion( cmd ), wCommand.getserver( cmd ) ) )
+      ClntConOp.postEvent( AppOp.getClntCon(), data->model, wCommand.getserver( cmd ) );
   }
   else if( StrOp.equals( wModelCmd.lclist, cmdVal ) ) {
     if( wPlan.getlclist(data->model) == NULL ) {
@@ -2368,7 +2682,7 @@ static void _createMap( iOModelData o, iOMap map, const char* dbKey, const char*
         if( instFn != NULL ) {
           if( !MapOp.haskey(map, key ) ) {
             obj l_instFn = (obj)instFn(item);
-            MapOp.put( map, key, l_instFn );
+            __put( o, map, key, l_instFn );
             if( list != NULL ) {
               ListOp.add( list, l_instFn );
             }
@@ -2381,7 +2695,7 @@ static void _createMap( iOModelData o, iOMap map, const char* dbKey, const char*
         }
         else {
           if( !MapOp.haskey(map, key ) ) {
-            MapOp.put( map, key, (obj)item );
+            __put( o, map, key, (obj)item );
             if( list != NULL ) {
               ListOp.add( list, (obj)item );
             }
@@ -2405,12 +2719,12 @@ static void _createMap( iOModelData o, iOMap map, const char* dbKey, const char*
 
 static Boolean __removeLoco(iOModel inst, iONode item ) {
   iOModelData data = Data(inst);
-  iOLoc lc = (iOLoc)MapOp.get( data->locMap, wLoc.getid( item ) );
+  iOLoc lc = (iOLoc)RcuMapOp.get( data->locIdx, wLoc.getid( item ) );
   if( lc != NULL ) {
     iONode props = LocOp.base.properties( lc );
     ListOp.removeObj( data->locList, (obj)lc);
     ModelOp.removeSysEventListener( AppOp.getModel(), (obj)lc );
-    MapOp.remove( data->locMap, wLoc.getid( item ) );
+    __remove( data, data->locMap, wLoc.getid( item ) );
     /* Remove item from list: */
     __removeItemFromList( data, wLocList.name(), props );
     lc->base.del( lc );
@@ -2423,11 +2737,11 @@ static Boolean __removeLoco(iOModel inst, iONode item ) {
 
 
 static Boolean __removeRoute(iOModelData o, iONode item ) {
-  iORoute st = (iORoute)MapOp.get( o->routeMap, wRoute.getid( item ) );
+  iORoute st = (iORoute)RcuMapOp.get( o->routeIdx, wRoute.getid( item ) );
   if( st != NULL ) {
     iONode props = RouteOp.base.properties( st );
     TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "removing route %s", wRoute.getid( item ) );
-    MapOp.remove( o->routeMap, wRoute.getid( item ) );
+    __remove( o, o->routeMap, wRoute.getid( item ) );
     ListOp.removeObj(o->routeList, (obj)st);
     /* Remove item from list: */
     __removeItemFromList( o, wRouteList.name(), props );
@@ -2448,6 +2762,8 @@ static void _removeGenerated( iOModelData o, const char* dbKey, const char* item
       iONode nextitem = NodeOp.findNextNode( db, item );
       if( wItem.isgenerated(item) ) {
         TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "removing: %s %s", NodeOp.getName(item), wItem.getid(item) );
+        __unloggedPlanChange( o, NULL );
+        __invalidateConditions( item );
         if(StrOp.equals( wLoc.name(), NodeOp.getName(item) ) ) {
           __removeLoco(AppOp.getModel(), item);
         }
@@ -2511,14 +2827,16 @@ static void _addSwKey(iOModel inst, const char* key, iOSwitch sw) {
 }
 
 static void _createSwAddrMap( iOModelData o ) {
-  iOSwitch sw = (iOSwitch)MapOp.first( o->switchMap );
+  iOList list = __snapshot( o, o->switchMap );
+  int i = 0;
   MapOp.clear(o->swAddrMap);
-  while( sw != NULL ) {
+  for( i = 0; i < ListOp.size( list ); i++ ) {
+    iOSwitch sw = (iOSwitch)ListOp.get( list, i );
     MapOp.put( o->swAddrMap, SwitchOp.getAddrKey(sw), (obj)sw );
     if( SwitchOp.getAddrKey2(sw) != NULL )
       MapOp.put( o->swAddrMap, SwitchOp.getAddrKey2(sw), (obj)sw );
-    sw = (iOSwitch)MapOp.next( o->switchMap );
   };
+  ListOp.base.del( list );
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "createSwAddrMap: size=%d.", MapOp.size(o->swAddrMap) );
 }
 
@@ -2547,6 +2865,13 @@ static void _save( iOModel inst, Boolean removeGen ) {
   iOModelData o = Data(inst);
   TraceOp.trc( name, TRCLEVEL_STATUS, __LINE__, 9999, "Saving plan [%s]...", o->fileName );
 
+  /* the loco runtime counters are only written back on request */
+  if( o->locList != NULL ) {
+    int i = 0;
+    for( i = 0; i < ListOp.size( o->locList ); i++ )
+      LocOp.flush( (iOLoc)ListOp.get( o->locList, i ) );
+  }
+
   if( removeGen && o->model != NULL ) {
     _removeGenerated(o, wLocList.name(), wLoc.name());
     _removeGenerated(o, wRouteList.name(), wRoute.name());
@@ -2603,11 +2928,11 @@ static void _saveAs( iOModel inst, const char* fileName ) {
 
 static iOLoc _addNetLoc(iOModel inst, iONode lcprops) {
   iOModelData data = Data(inst);
-  iOLoc loc = (iOLoc)MapOp.get( data->locMap, wLoc.getid(lcprops) );
+  iOLoc loc = (iOLoc)RcuMapOp.get( data->locIdx, wLoc.getid(lcprops) );
   if( loc == NULL ) {
     iONode cmd = NULL;
     loc = LocOp.inst( (iONode)NodeOp.base.clone(lcprops) );
-    MapOp.put( data->locMap, wLoc.getid(lcprops), (obj)loc );
+    __put( data, data->locMap, wLoc.getid(lcprops), (obj)loc );
 
     cmd = NodeOp.inst( wModelCmd.name(), NULL, ELEMENT_NODE );
     wModelCmd.setcmd( cmd, wModelCmd.add );
@@ -2621,10 +2946,10 @@ static iOLoc _addNetLoc(iOModel inst, iONode lcprops) {
 
 static iIBlockBase _addNetBlock(iOModel inst, iONode bkprops) {
   iOModelData data = Data(inst);
-  iIBlockBase block = (iIBlockBase)MapOp.get( data->blockMap, wBlock.getid(bkprops) );
+  iIBlockBase block = (iIBlockBase)RcuMapOp.get( data->blockIdx, wBlock.getid(bkprops) );
   if( block == NULL ) {
     block = (iIBlockBase)BlockOp.inst((iONode)NodeOp.base.clone(bkprops));
-    MapOp.put( data->blockMap, wBlock.getid(bkprops), (obj)block);
+    __put( data, data->blockMap, wBlock.getid(bkprops), (obj)block);
   }
   return block;
 }
@@ -2632,7 +2957,7 @@ static iIBlockBase _addNetBlock(iOModel inst, iONode bkprops) {
 
 static iOLoc _getLoc( iOModel inst, const char* id, iONode props, Boolean generate ) {
   iOModelData o = Data(inst);
-  iOLoc loc = (iOLoc)MapOp.get( o->locMap, id );
+  iOLoc loc = (iOLoc)RcuMapOp.get( o->locIdx, id );
   char identifier[64] = {'\0'};
   if( loc == NULL && id != NULL && StrOp.len(id) > 0 ) {
     int addr = atoi(id);
@@ -2681,7 +3006,7 @@ static iOLoc _getLoc( iOModel inst, const char* id, iONode props, Boolean genera
         wLoc.setshow( lc, True );
         wItem.setgenerated( lc, True );
         _addItem(inst, lc);
-        loc = (iOLoc)MapOp.get( o->locMap, id );
+        loc = (iOLoc)RcuMapOp.get( o->locIdx, id );
       }
     }
     else {
@@ -3177,13 +3502,13 @@ static iOList _getLevelItems( iOModel inst, int level, int* cx, int* cy, Boolean
 
 static iIBlockBase _getBlock( iOModel inst, const char* id ) {
   iOModelData o = Data(inst);
-  iIBlockBase bk = (iIBlockBase)MapOp.get( o->blockMap, id );
+  iIBlockBase bk = (iIBlockBase)RcuMapOp.get( o->blockIdx, id );
   if( bk == NULL )
-    bk = (iIBlockBase)MapOp.get( o->stageMap, id );
+    bk = (iIBlockBase)RcuMapOp.get( o->stageIdx, id );
   if( bk == NULL )
-    bk = (iIBlockBase)MapOp.get( o->ttMap, id );
+    bk = (iIBlockBase)RcuMapOp.get( o->ttIdx, id );
   if( bk == NULL )
-    bk = (iIBlockBase)MapOp.get( o->seltabMap, id );
+    bk = (iIBlockBase)RcuMapOp.get( o->seltabIdx, id );
   return bk;
 }
 
@@ -3191,34 +3516,39 @@ static iIBlockBase _getBlockByAddr( iOModel inst, const char* iid, int addr ) {
   iOModelData o = Data(inst);
   iIBlockBase bk = NULL;
   if( addr >= 0 ) {
-    iIBlockBase b = (iIBlockBase)MapOp.first(o->blockMap);
-    while( b != NULL ) {
+    iOList list = __snapshot( o, o->blockMap );
+    int i = 0;
+    for( i = 0; i < ListOp.size( list ); i++ ) {
+      iIBlockBase b = (iIBlockBase)ListOp.get( list, i );
       if( wBlock.istd(b->base.properties(b)) && b->getTDport(b) == addr ) {
         bk = b;
         break;
       }
-      b = (iIBlockBase)MapOp.next(o->blockMap);
     }
+    ListOp.base.del( list );
   }
   return bk;
 }
 
 static iIBlockBase _getBlock4Signal( iOModel inst, const char* id ) {
   iOModelData o = Data(inst);
-  iIBlockBase block = (iIBlockBase)MapOp.first( o->blockMap );
-  while( block != NULL ) {
+  iOList list = __snapshot( o, o->blockMap );
+  iIBlockBase found = NULL;
+  int i = 0;
+  for( i = 0; i < ListOp.size( list ) && found == NULL; i++ ) {
+    iIBlockBase block = (iIBlockBase)ListOp.get( list, i );
     iONode props = block->base.properties(block);
     if( wBlock.getsignal(props) != NULL && StrOp.equals(wBlock.getsignal(props), id))
-      return (iIBlockBase)block;
-    if( wBlock.getwsignal(props) != NULL && StrOp.equals(wBlock.getwsignal(props), id))
-      return (iIBlockBase)block;
-    if( wBlock.getsignalR(props) != NULL && StrOp.equals(wBlock.getsignalR(props), id))
-      return (iIBlockBase)block;
-    if( wBlock.getwsignalR(props) != NULL && StrOp.equals(wBlock.getwsignalR(props), id))
-      return (iIBlockBase)block;
-    block = (iIBlockBase)MapOp.next( o->blockMap );
+      found = block;
+    else if( wBlock.getwsignal(props) != NULL && StrOp.equals(wBlock.getwsignal(props), id))
+      found = block;
+    else if( wBlock.getsignalR(props) != NULL && StrOp.equals(wBlock.getsignalR(props), id))
+      found = block;
+    else if( wBlock.getwsignalR(props) != NULL && StrOp.equals(wBlock.getwsignalR(props), id))
+      found = block;
   };
-  return NULL;
+  ListOp.base.del( list );
+  return found;
 }
 
 static iOFBack _getFBack( iOModel inst, const char* id ) {
@@ -3259,7 +3589,7 @@ static iOFBack _getGPSSensor( iOModel inst, int sid, int x, int y, int z, Boolea
 
 static iOSwitch _getSwitch( iOModel inst, const char* id ) {
   iOModelData o = Data(inst);
-  return (iOSwitch)MapOp.get( o->switchMap, id );
+  return (iOSwitch)RcuMapOp.get( o->switchIdx, id );
 }
 
 static iOMap _getSwitchMap( iOModel inst ) {
@@ -3294,12 +3624,12 @@ static iOOutput _getOutput( iOModel inst, const char* id ) {
 
 static iORoute _getRoute( iOModel inst, const char* id ) {
   iOModelData o = Data(inst);
-  iORoute route = (iORoute)MapOp.get( o->routeMap, id );
+  iORoute route = (iORoute)RcuMapOp.get( o->routeIdx, id );
   if( route == NULL && o->moduleplan != NULL ) {
     const char* routeID = ModPlanOp.getResolvedRouteID( o->moduleplan, id );
     if( routeID != NULL ) {
       TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "use resolved route [%s]", routeID );
-      route = (iORoute)MapOp.get( o->routeMap, routeID );
+      route = (iORoute)RcuMapOp.get( o->routeIdx, routeID );
     }
     else {
       TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "route [%s] undefined", id );
@@ -3314,7 +3644,7 @@ static iORoute _getRoute( iOModel inst, const char* id ) {
 
 static const char* _getResolvedRouteID( iOModel inst, const char* id ) {
   iOModelData o = Data(inst);
-  iORoute route = (iORoute)MapOp.get( o->routeMap, id );
+  iORoute route = (iORoute)RcuMapOp.get( o->routeIdx, id );
   if( route == NULL && o->moduleplan != NULL ) {
     const char* routeID = ModPlanOp.getResolvedRouteID( o->moduleplan, id );
     if( routeID != NULL ) {
@@ -3328,25 +3658,25 @@ static void _addNetRoute(iOModel inst, iONode netroute) {
   iOModelData data = Data(inst);
   iORoute route = RouteOp.inst(netroute);
   ListOp.add( data->routeList, (obj)route );
-  MapOp.put( data->routeMap, RouteOp.getId(route), (obj)route );
+  __put( data, data->routeMap, RouteOp.getId(route), (obj)route );
 }
 
 
 static iOTT _getTurntable( iOModel inst, const char* id ) {
   iOModelData o = Data(inst);
-  return (iOTT)MapOp.get( o->ttMap, id );
+  return (iOTT)RcuMapOp.get( o->ttIdx, id );
 }
 
 
 static iOStage _getStage( iOModel inst, const char* id ) {
   iOModelData o = Data(inst);
-  return (iOStage)MapOp.get( o->stageMap, id );
+  return (iOStage)RcuMapOp.get( o->stageIdx, id );
 }
 
 
 static iOSelTab _getSelectiontable( iOModel inst, const char* id ) {
   iOModelData o = Data(inst);
-  return (iOSelTab)MapOp.get( o->seltabMap, id );
+  return (iOSelTab)RcuMapOp.get( o->seltabIdx, id );
 }
 
 
@@ -3392,28 +3722,38 @@ static long _getTime( iOModel inst ) {
 }
 
 
-static void __clearMap( iOMap map ) {
-  obj item = MapOp.first( map );
+static void __clearMap( iOModelData o, iOMap map ) {
+  iORegistry reg = __registry( o, map );
+  obj item = NULL;
+  if( reg != NULL ) {
+    MutexOp.wait( reg->mux );
+    RcuMapOp.clear( reg->idx );
+  }
+  item = MapOp.first( map );
   while( item != NULL ) {
     item->del( item );
     item = MapOp.next( map );
   }
   MapOp.clear( map );
+  if( reg != NULL )
+    MutexOp.post( reg->mux );
 }
 
 
 static void __initTDBlocks(iOModel inst) {
   iOModelData o = Data(inst);
   int pause = wCtrl.getinitfieldpause( wRocRail.getctrl( AppOp.getIni(  ) ) );
-  iIBlockBase bk = (iIBlockBase)MapOp.first(o->blockMap);
+  iOList list = __snapshot( o, o->blockMap );
+  int i = 0;
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "init Track Driver blocks..." );
-  while( bk != NULL ) {
+  for( i = 0; i < ListOp.size( list ); i++ ) {
+    iIBlockBase bk = (iIBlockBase)ListOp.get( list, i );
     if( bk->isTD(bk) ) {
       bk->resetTD(bk);
       ThreadOp.sleep( pause );
     }
-    bk = (iIBlockBase)MapOp.next( o->blockMap );
   };
+  ListOp.base.del( list );
 }
 
 /** ----------------------------------------------------------------------
@@ -3427,6 +3767,8 @@ static void __initFieldRunner( void* threadinst ) {
   iOSwitch sw = NULL;
   iOSignal sg = NULL;
   iOFBack fb = NULL;
+  iOList swList = NULL;
+  int swIdx = 0;
   int error = 0;
   int pause = wCtrl.getinitfieldpause( wRocRail.getctrl( AppOp.getIni(  ) ) );
   Boolean gpON = wCtrl.isinitfieldpower( wRocRail.getctrl( AppOp.getIni(  ) ) );
@@ -3458,11 +3800,12 @@ static void __initFieldRunner( void* threadinst ) {
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Init [%d] switches", MapOp.size( o->switchMap ) );
 
-  sw = (iOSwitch)MapOp.first( o->switchMap );
-  while( sw != NULL && !ThreadOp.isQuit(th) ) {
+  swList = __snapshot( o, o->switchMap );
+  for( swIdx = 0; swIdx < ListOp.size( swList ) && !ThreadOp.isQuit(th); swIdx++ ) {
     iONode cmd = NodeOp.inst( wSwitch.name(), NULL, ELEMENT_NODE );
     const char* cmdStr = NULL;
 
+    sw = (iOSwitch)ListOp.get( swList, swIdx );
     TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Init sw [%s]", SwitchOp.getId( sw ) );
 
     /* Flip the switch. */
@@ -3497,8 +3840,8 @@ static void __initFieldRunner( void* threadinst ) {
 
     }
 
-    sw = (iOSwitch)MapOp.next( o->switchMap );
   }
+  ListOp.base.del( swList );
 
   ThreadOp.sleep( pause );
 
@@ -3578,7 +3921,7 @@ static void _initField( iOModel inst, Boolean full ) {
 static void __reinitRoutes( iOModel inst ) {
   iOModelData o = Data(inst);
 
-  __clearMap( o->routeMap );
+  __clearMap( o, o->routeMap );
   ListOp.clear( o->routeList);
   _createMap( o, o->routeMap   , wRouteList.name(), wRoute.name(), (item_inst)RouteOp.inst, o->routeList );
 
@@ -3636,25 +3979,25 @@ static Boolean _init( iOModel inst ) {
   }
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "init clearingMaps..." );
-  __clearMap( o->blockMap );
-  __clearMap( o->blockGroupMap );
-  __clearMap( o->feedbackMap );
-  __clearMap( o->locMap );
-  __clearMap( o->carMap );
-  __clearMap( o->operatorMap );
-  __clearMap( o->routeMap );
-  __clearMap( o->switchMap );
-  __clearMap( o->signalMap );
-  __clearMap( o->outputMap );
-  __clearMap( o->ttMap );
-  __clearMap( o->seltabMap );
-  __clearMap( o->stageMap );
-  __clearMap( o->actionMap );
-  __clearMap( o->textMap );
-  __clearMap( o->trackMap );
-  __clearMap( o->locationMap );
-  __clearMap( o->scheduleMap );
-  __clearMap( o->tourMap );
+  __clearMap( o, o->blockMap );
+  __clearMap( o, o->blockGroupMap );
+  __clearMap( o, o->feedbackMap );
+  __clearMap( o, o->locMap );
+  __clearMap( o, o->carMap );
+  __clearMap( o, o->operatorMap );
+  __clearMap( o, o->routeMap );
+  __clearMap( o, o->switchMap );
+  __clearMap( o, o->signalMap );
+  __clearMap( o, o->outputMap );
+  __clearMap( o, o->ttMap );
+  __clearMap( o, o->seltabMap );
+  __clearMap( o, o->stageMap );
+  __clearMap( o, o->actionMap );
+  __clearMap( o, o->textMap );
+  __clearMap( o, o->trackMap );
+  __clearMap( o, o->locationMap );
+  __clearMap( o, o->scheduleMap );
+  __clearMap( o, o->tourMap );
 
   ListOp.clear( o->routeList);
   ListOp.clear( o->switchList);
@@ -3694,38 +4037,43 @@ static Boolean _init( iOModel inst ) {
   ModelOp.loadBlockOccupancy(inst);
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "init blocks..." );
   {
-    iIBlockBase block = (iIBlockBase)MapOp.first( o->blockMap );
-    while( block != NULL ) {
+    iOList list = __snapshot( o, o->blockMap );
+    int i = 0;
+    for( i = 0; i < ListOp.size( list ); i++ ) {
+      iIBlockBase block = (iIBlockBase)ListOp.get( list, i );
       block->init( block );
-      block = (iIBlockBase)MapOp.next( o->blockMap );
     };
+    ListOp.base.del( list );
 
     /* adding the selection tables to the block map: */
-    block = (iIBlockBase)MapOp.first( o->seltabMap );
-    while( block != NULL ) {
+    list = __snapshot( o, o->seltabMap );
+    for( i = 0; i < ListOp.size( list ); i++ ) {
+      iIBlockBase block = (iIBlockBase)ListOp.get( list, i );
       block->init( block );
-      MapOp.put( o->blockMap, block->base.id( block ), (obj)block );
-      block = (iIBlockBase)MapOp.next( o->seltabMap );
+      __put( o, o->blockMap, block->base.id( block ), (obj)block );
     };
+    ListOp.base.del( list );
 
     /* adding the stageblocks to the block map: */
-    block = (iIBlockBase)MapOp.first( o->stageMap );
-    while( block != NULL ) {
+    list = __snapshot( o, o->stageMap );
+    for( i = 0; i < ListOp.size( list ); i++ ) {
+      iIBlockBase block = (iIBlockBase)ListOp.get( list, i );
       block->init( block );
-      MapOp.put( o->blockMap, block->base.id( block ), (obj)block );
-      block = (iIBlockBase)MapOp.next( o->stageMap );
+      __put( o, o->blockMap, block->base.id( block ), (obj)block );
     };
+    ListOp.base.del( list );
 
     /* adding the turntables to the block map: */
-    block = (iIBlockBase)MapOp.first( o->ttMap );
-    while( block != NULL ) {
+    list = __snapshot( o, o->ttMap );
+    for( i = 0; i < ListOp.size( list ); i++ ) {
+      iIBlockBase block = (iIBlockBase)ListOp.get( list, i );
       block->init( block );
       if( wTurntable.isembeddedblock(block->base.properties(block) ) ) {
         TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "adding TT %s as block",  block->base.id(block));
-        MapOp.put( o->blockMap, block->base.id(block), (obj)block );
+        __put( o, o->blockMap, block->base.id(block), (obj)block );
       }
-      block = (iIBlockBase)MapOp.next( o->ttMap );
     };
+    ListOp.base.del( list );
   }
 
   if( o->moduleplan != NULL ) {
@@ -3748,6 +4096,173 @@ static Boolean _init( iOModel inst ) {
   return True;
 }
 
+/* A changed sensor of a batch and the sensor objects matching it. */
+struct FbChange {
+  int addr;
+  Boolean state;
+  Boolean matched;
+};
+
+static int __cmpFbChange( const void* a, const void* b ) {
+  return ((struct FbChange*)a)->addr - ((struct FbChange*)b)->addr;
+}
+
+static struct FbChange* __findFbChange( struct FbChange* changes, int cnt, int addr ) {
+  struct FbChange key;
+  key.addr = addr;
+  return (struct FbChange*)bsearch( &key, changes, cnt, sizeof( struct FbChange ), __cmpFbChange );
+}
+
+static iONode __fbChangeNode( const char* iid, int bus, const char* uidname, long span, struct FbChange* change ) {
+  iONode node = NodeOp.inst( wFeedback.name(), NULL, ELEMENT_NODE );
+  if( iid != NULL )
+    wFeedback.setiid( node, iid );
+  if( StrOp.len( uidname ) > 0 )
+    wItem.setuidname( node, uidname );
+  if( span != 0 )
+    wFeedback.setspan( node, span );
+  wFeedback.setbus( node, bus );
+  wFeedback.setaddr( node, change->addr );
+  wFeedback.setstate( node, change->state );
+  return node;
+}
+
+/* The sensor changes of one module scan are matched against the sensors in
+   one pass instead of one search per change; the resulting client events go
+   out as one batch. */
+static void __fbBatch( iOModel inst, iONode nodeC ) {
+  iOModelData o = Data(inst);
+  unsigned long t0 = MetricsOp.now();
+  const char* iid = wFbBatch.getiid( nodeC );
+  int bus = wFbBatch.getbus( nodeC );
+  const char* uidname = wFbBatch.getuidname( nodeC );
+  long span = SpanOp.isEnabled() ? wFbBatch.getspan( nodeC ):0;
+  struct FbChange* changes = NULL;
+  obj* matches = NULL;
+  int* matchIdx = NULL;
+  obj* sorted = NULL;
+  int* first = NULL;
+  int* fill = NULL;
+  int cnt = 0;
+  int matchCnt = 0;
+  int size = 0;
+  int i = 0;
+  iONode delta = NULL;
+  obj fb = NULL;
+
+  AppOp.beginBroadcastBatch();
+
+  delta = wFbBatch.getfbdelta( nodeC );
+  while( delta != NULL ) {
+    const char* mask = wFbDelta.getmask( delta );
+    int len = StrOp.len( mask ) / 2;
+    byte* bmask  = StrOp.strToByte( mask );
+    byte* bstate = StrOp.strToByte( wFbDelta.getstate( delta ) );
+    int n = 0;
+    for( n = 0; n < len * 8; n++ ) {
+      if( bmask[n/8] & ( 1 << (n%8) ) ) {
+        if( cnt == size ) {
+          size = size == 0 ? 16:size * 2;
+          changes = changes == NULL ? allocMem( size * sizeof( struct FbChange ) ):reallocMem( changes, size * sizeof( struct FbChange ) );
+        }
+        changes[cnt].addr    = wFbDelta.getaddr( delta ) + n;
+        changes[cnt].state   = ( StrOp.len( wFbDelta.getstate( delta ) ) / 2 > n/8 && ( bstate[n/8] & ( 1 << (n%8) ) ) ) ? True:False;
+        changes[cnt].matched = False;
+        cnt++;
+      }
+    }
+    freeMem( bmask );
+    freeMem( bstate );
+    delta = wFbBatch.nextfbdelta( nodeC, delta );
+  }
+
+  SpanOp.mark( span, __sModel );
+
+  if( cnt > 0 ) {
+    qsort( changes, cnt, sizeof( struct FbChange ), __cmpFbChange );
+
+    /* same criteria as getSensorsByAddress */
+    size = 0;
+    fb = MapOp.first( o->feedbackMap );
+    while( fb != NULL ) {
+      iONode props = fb->properties(fb);
+      struct FbChange* change = NULL;
+      if( iid != NULL && wItem.getiid(props) != NULL && StrOp.len(wItem.getiid(props)) > 0 && !StrOp.equals(iid, wItem.getiid(props)) )
+        change = NULL;
+      else if( bus == wItem.getbus(props) || (StrOp.len(uidname) > 0 && StrOp.equals(uidname, wItem.getuidname(props))) )
+        change = __findFbChange( changes, cnt, wFeedback.getaddr(props) );
+      if( change != NULL ) {
+        if( matchCnt == size ) {
+          size = size == 0 ? 16:size * 2;
+          matches  = matches  == NULL ? allocMem( size * sizeof( obj ) ):reallocMem( matches, size * sizeof( obj ) );
+          matchIdx = matchIdx == NULL ? allocMem( size * sizeof( int ) ):reallocMem( matchIdx, size * sizeof( int ) );
+        }
+        matches[matchCnt]  = fb;
+        matchIdx[matchCnt] = change - changes;
+        matchCnt++;
+        change->matched = True;
+      }
+      fb = MapOp.next( o->feedbackMap );
+    }
+  }
+
+  /* dispatch in address order; the matches keep their map order per address */
+  first  = allocMem( ( cnt + 1 ) * sizeof( int ) );
+  fill   = allocMem( ( cnt + 1 ) * sizeof( int ) );
+  sorted = allocMem( ( matchCnt + 1 ) * sizeof( obj ) );
+  for( i = 0; i < matchCnt; i++ )
+    first[matchIdx[i]+1]++;
+  for( i = 0; i < cnt; i++ )
+    first[i+1] += first[i];
+  for( i = 0; i < matchCnt; i++ )
+    sorted[first[matchIdx[i]] + fill[matchIdx[i]]++] = matches[i];
+
+  for( i = 0; i < cnt; i++ ) {
+    struct FbChange* change = &changes[i];
+    int m = 0;
+
+    TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "batched sensor event: [%s] %d:%d uidname=[%s] %s", iid!=NULL?iid:"", bus, change->addr, uidname, change->state?"on":"off" );
+
+    if( change->matched ) {
+      for( m = first[i]; m < first[i+1]; m++ )
+        sorted[m]->event( sorted[m], __fbChangeNode( iid, bus, uidname, span, change ) );
+    }
+    else {
+      char* key = FBackOp.createAddrKey( bus, change->addr, iid );
+      iOList list = (iOList)MapOp.get( o->fbAddrMap, key );
+      StrOp.free( key );
+      if( list != NULL ) {
+        fb = ListOp.first( list );
+        while( fb != NULL ) {
+          fb->event( fb, __fbChangeNode( iid, bus, uidname, span, change ) );
+          fb = ListOp.next( list );
+        }
+      }
+      else {
+        TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "unregistered sensor event: [%s] %d:%d", iid!=NULL?iid:"", bus, change->addr );
+        AppOp.broadcastEvent( __fbChangeNode( iid, bus, uidname, span, change ) ); /* Send to clients to visualize all sensors. */
+      }
+    }
+  }
+
+  AppOp.endBroadcastBatch();
+
+  MetricsOp.add( __mFbBatchSensors, cnt );
+  MetricsOp.since( __mFbBatch, t0 );
+
+  freeMem( first );
+  freeMem( fill );
+  freeMem( sorted );
+  if( changes != NULL )
+    freeMem( changes );
+  if( matches != NULL ) {
+    freeMem( matches );
+    freeMem( matchIdx );
+  }
+  NodeOp.base.del( nodeC );
+}
+
+
 static void _event( iOModel inst, iONode nodeC ) {
   iOModelData o = Data(inst);
   const char* uidname = wItem.getuidname(nodeC);
@@ -3759,6 +4274,13 @@ static void _event( iOModel inst, iONode nodeC ) {
   }
 
 
+  /* Sensor changes of one module scan. */
+  if( StrOp.equals( wFbBatch.name(), NodeOp.getName( nodeC ) ) ) {
+    __fbBatch( inst, nodeC );
+    return;
+  }
+
+
   /* Block track driver event. */
   if( StrOp.equals( wBlock.name(), NodeOp.getName( nodeC ) ) ) {
     iIBlockBase block = ModelOp.getBlock(inst, wBlock.getid(nodeC));
@@ -3803,6 +4325,9 @@ static void _event( iOModel inst, iONode nodeC ) {
 
     TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "trying to match sensor event: [%s] %d:%d uidname=[%s]", iid!=NULL?iid:"", bus, addr, uidname );
 
+    if( SpanOp.isEnabled() )
+      SpanOp.mark( wFeedback.getspan( nodeC ), __sModel );
+
     if( wFeedback.getfbtype(nodeC) == wFeedback.fbtype_gps ) {
       Boolean state = wFeedback.isstate(nodeC);
       /* Find the matching sensor location. */
@@ -4241,7 +4766,7 @@ static iORoute __lookup( iOModel inst, iOLoc loc, iOList stlist, const char* fro
 
   if( cnt == 0 ) {
     /* get the street list */
-    list = MapOp.getList( data->routeMap );
+    list = __snapshot( data, data->routeMap );
     searchlist = list;
     foundlevel = &flevel;
   }
@@ -4647,7 +5172,7 @@ static iORoute _calcRoute( iOModel inst, iOList stlist, const char* currBlockId,
           continue;
         }
         TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Got a route to block \"%s\".", id );
-        block = (iIBlockBase)MapOp.get( data->blockMap, id );
+        block = (iIBlockBase)RcuMapOp.get( data->blockIdx, id );
         if( block->isFree( block, LocOp.getId( loc ) ) && block->isSuited(block, loc, NULL, False) != suits_not ) {
           /* OK, first free block. */
           TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Block \"%s\" is free.", id );
@@ -4762,6 +5287,34 @@ static Boolean _unlockBlockGroup(iOModel inst, const char* group, const char* Lo
 
 
 
+static Boolean _reserveBegin(iOModel inst, const char* LocoId, const char* BlockId, const char* RouteId) {
+  iOLoc lc = ModelOp.getLoc( inst, LocoId, NULL, False );
+  int prio = lc != NULL ? wLoc.getpriority( LocOp.base.properties( lc ) ):10;
+  return ReservationOp.begin( LocoId, prio, BlockId, RouteId );
+}
+
+static void _reserveEnd(iOModel inst, const char* LocoId, Boolean ok) {
+  ReservationOp.end( LocoId, ok );
+}
+
+static Boolean _reserveGroup(iOModel inst, const char* LocoId, const char* Group, const char* BlockId) {
+  return ReservationOp.lockGroup( LocoId, Group, BlockId );
+}
+
+static Boolean _reserveBlock(iOModel inst, const char* LocoId, iIBlockBase block, const char* FromBlockId, const char* RouteId,
+    Boolean crossing, Boolean reset, Boolean reverse, int indelay) {
+  return ReservationOp.lockBlock( LocoId, block, FromBlockId, RouteId, crossing, reset, reverse, indelay );
+}
+
+static Boolean _reserveRoute(iOModel inst, const char* LocoId, iORoute route, Boolean reverse, Boolean lockswitches) {
+  return ReservationOp.lockRoute( LocoId, route, reverse, lockswitches );
+}
+
+static void _reserveCancel(iOModel inst, const char* LocoId) {
+  ReservationOp.cancel( LocoId );
+}
+
+
 static const char* _getManagedID(iOModel inst, const char* fromBlockId) {
   /* check if the block is managed by a selectioin table */
   iIBlockBase block = ModelOp.getBlock(inst, fromBlockId);
@@ -4844,6 +5397,7 @@ static iIBlockBase __selectRandomBlock(iOLoc loc, int cnt, iOList fitBlocks, iOL
 static iIBlockBase _findDest( iOModel inst, const char* fromBlockId, const char* fromRouteId, iOLoc loc, iORoute* routeref, const char* gotoBlockId,
                           Boolean swapPlacingInPrevRoute, Boolean forceOppDir, Boolean schedule, Boolean secondnextblock) {
   iOModelData o = Data(inst);
+  unsigned long t0 = MetricsOp.now();
 
   int size = ListOp.size( o->routeList );
 
@@ -4997,7 +5551,7 @@ static iIBlockBase _findDest( iOModel inst, const char* fromBlockId, const char*
             samedir = False;
           }
 
-          block = (iIBlockBase)MapOp.get( o->blockMap, stTo );
+          block = (iIBlockBase)RcuMapOp.get( o->blockIdx, stTo );
           TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "Evaluating route [%s].", RouteOp.getId(route));
 
           /* check if it is a net block */
@@ -5007,7 +5561,7 @@ static iIBlockBase _findDest( iOModel inst, const char* fromBlockId, const char*
               iONode bk = R2RnetOp.getBlock( r2rnet, stTo );
               if( bk != NULL ) {
                 block = (iIBlockBase)BlockOp.inst(bk);
-                MapOp.put( o->blockMap, stTo, (obj)block);
+                __put( o, o->blockMap, stTo, (obj)block);
               }
             }
           }
@@ -5017,15 +5571,15 @@ static iIBlockBase _findDest( iOModel inst, const char* fromBlockId, const char*
            */
           if( block == NULL ) {
             /* id could be a seltab: */
-            block = (iIBlockBase)MapOp.get( o->seltabMap, stTo );
+            block = (iIBlockBase)RcuMapOp.get( o->seltabIdx, stTo );
           }
           if( block == NULL ) {
             /* id could be a tt: */
-            block = (iIBlockBase)MapOp.get( o->ttMap, stTo );
+            block = (iIBlockBase)RcuMapOp.get( o->ttIdx, stTo );
           }
           if( block == NULL ) {
             /* id could be a stage block: */
-            block = (iIBlockBase)MapOp.get( o->stageMap, stTo );
+            block = (iIBlockBase)RcuMapOp.get( o->stageIdx, stTo );
           }
 
           if( block != NULL ) {
@@ -5248,6 +5802,7 @@ static iIBlockBase _findDest( iOModel inst, const char* fromBlockId, const char*
 
   TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "blockBest=0x%X gotoinwrongdir=%d",blockBest , gotoinwrongdir );
 
+  MetricsOp.since( __mFindDest, t0 );
   return gotoinwrongdir ? NULL:blockBest;
 }
 
@@ -5754,9 +6309,24 @@ static iOModel _inst( const char* fileName, const char* locoFileName ) {
 
   data->levelItemsMap = MapOp.inst();
 
+  /* lookup indexes of the object registries; 7 and the terminator */
+  data->registry  = allocMem( 8 * sizeof( struct Registry ) );
+  data->locIdx    = __addRegistry( data, data->locMap );
+  data->blockIdx  = __addRegistry( data, data->blockMap );
+  data->stageIdx  = __addRegistry( data, data->stageMap );
+  data->ttIdx     = __addRegistry( data, data->ttMap );
+  data->seltabIdx = __addRegistry( data, data->seltabMap );
+  data->routeIdx  = __addRegistry( data, data->routeMap );
+  data->switchIdx = __addRegistry( data, data->switchMap );
+
   data->sysEventListeners = ListOp.inst();
 
   data->muxFindDest = MutexOp.inst( "muxFindDest", True );
+  __mFindDest = MetricsOp.histogram( "model_finddest_us", "Destination search in microseconds." );
+  __mFbBatch  = MetricsOp.histogram( "model_fbbatch_us", "Sensor batch processing in microseconds." );
+  __mPlanSnapshot = MetricsOp.histogram( "model_plansnapshot_us", "Plan snapshot serialization in microseconds." );
+  __mFbBatchSensors = MetricsOp.counter( "model_fbbatch_sensors_total", "Sensor changes received in batches." );
+  __sModel = SpanOp.stage( "model" );
 
   data->muxSysEvent = MutexOp.inst( "muxSysEvent", True );
 
@@ -5765,6 +6335,20 @@ static iOModel _inst( const char* fileName, const char* locoFileName ) {
   data->occMux      = MutexOp.inst( NULL, True );
   data->locationMux = MutexOp.inst( NULL, True );
 
+  /* plan snapshot cache; the node guard is set before any other thread
+     changes the plan so a snapshot never reads a node being changed */
+  if( NodeOp.getGuard() == NULL )
+    NodeOp.setGuard( MutexOp.inst( NULL, True ) );
+  data->snapMux   = MutexOp.inst( NULL, True );
+  data->ticketMux = MutexOp.inst( NULL, True );
+  data->snapshots = ListOp.inst();
+
+  /* Plan change log; the version starts at the current time so a version
+     seen by a client of a previous server run does not match this log. */
+  data->planLog     = ListOp.inst();
+  data->planLogSize = wTcp.getplanlog( wRocRail.gettcp( AppOp.getIni() ) );
+  data->planVersion = (long)time( NULL );
+
   data->enableswfb = wCtrl.isenableswfb( wRocRail.getctrl( AppOp.getIni(  ) ) );
 
   /* Initialize random seed. */
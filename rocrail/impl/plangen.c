@@ -0,0 +1,567 @@
+/*
+ Rocrail - Model Railroad Software
+
+ Copyright (C) 2002-2014 Rob Versluis, Rocrail.net
+
+
+
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+/*
+ The plan is made of ovals, one above the other on each level or module:
+
+   /--[sw]-fb-[ block ]-fb-[sw]--tk-fb-[ block ]-fb-tk--...--\
+   |     \-fb-[ block ]-fb-/                                 |
+   |                                                         |
+   \--[sw]-fb-[ block ]-fb-[sw]--...                       --/
+         \-fb-[ block ]-fb-/
+
+ Each line is a row of units of PlanGenOp.unitwidth cells: a passing loop
+ (2 blocks, 2 turnouts, 4 sensors), a line block (1 block, 2 sensors) or
+ plain track. All items touch, so the analyser finds the routes.
+ Sensor addresses run from 1, turnouts use addr/port pairs in the same
+ order and locomotives get address 1..n; all ids are unique over modules.
+*/
+
+#include <stdlib.h>
+
+#include "rocrail/impl/plangen_impl.h"
+
+#include "rocs/public/mem.h"
+#include "rocs/public/trace.h"
+#include "rocs/public/str.h"
+
+#include "rocrail/wrapper/public/Plan.h"
+#include "rocrail/wrapper/public/ZLevel.h"
+#include "rocrail/wrapper/public/ModPlan.h"
+#include "rocrail/wrapper/public/Module.h"
+#include "rocrail/wrapper/public/Item.h"
+#include "rocrail/wrapper/public/Track.h"
+#include "rocrail/wrapper/public/TrackList.h"
+#include "rocrail/wrapper/public/Block.h"
+#include "rocrail/wrapper/public/BlockList.h"
+#include "rocrail/wrapper/public/Switch.h"
+#include "rocrail/wrapper/public/SwitchList.h"
+#include "rocrail/wrapper/public/Feedback.h"
+#include "rocrail/wrapper/public/FeedbackList.h"
+#include "rocrail/wrapper/public/FeedbackEvent.h"
+#include "rocrail/wrapper/public/Loc.h"
+#include "rocrail/wrapper/public/LocList.h"
+#include "rocrail/wrapper/public/RouteList.h"
+
+static int instCnt = 0;
+
+typedef enum {UNIT_PLAIN=0, UNIT_LINE, UNIT_STATION} unitType;
+
+/* generator state; the lists point into the plan or module being filled */
+typedef struct {
+  unsigned long rnd;
+  int tk, bk, sw, fb;
+  int sensors;
+  iONode tklist, bklist, swlist, fblist;
+  iOList blocks;
+  iOList switches;
+  iOList fbs;
+} __gen;
+
+/** ----- OBase ----- */
+static void __del( void* inst ) {
+}
+
+static const char* __name( void ) {
+  return name;
+}
+
+static unsigned char* __serialize( void* inst, long* size ) {
+  return NULL;
+}
+
+static void __deserialize( void* inst,unsigned char* bytestream ) {
+}
+
+static char* __toString( void* inst ) {
+  return NULL;
+}
+
+static int __count( void ) {
+  return instCnt;
+}
+
+static struct OBase* __clone( void* inst ) {
+  return NULL;
+}
+
+static Boolean __equals( void* inst1, void* inst2 ) {
+  return False;
+}
+
+static void* __properties( void* inst ) {
+  return NULL;
+}
+
+static const char* __id( void* inst ) {
+  return NULL;
+}
+
+static void* __event( void* inst, const void* evt ) {
+  return NULL;
+}
+
+/** ----- OPlanGen ----- */
+
+
+/* xorshift; the C library rand() differs per platform */
+static int __rand( __gen* g, int range ) {
+  unsigned long x = g->rnd;
+  x ^= ( x << 13 ) & 0xFFFFFFFFUL;
+  x ^= x >> 17;
+  x ^= ( x << 5 ) & 0xFFFFFFFFUL;
+  g->rnd = x & 0xFFFFFFFFUL;
+  return range > 0 ? (int)( g->rnd % range ):0;
+}
+
+
+static iONode __item( iONode list, const char* type, const char* id, int x, int y, int z, const char* ori ) {
+  iONode item = NodeOp.inst( type, list, ELEMENT_NODE );
+  wItem.setid( item, id );
+  wItem.setx( item, x );
+  wItem.sety( item, y );
+  wItem.setz( item, z );
+  wItem.setori( item, ori );
+  NodeOp.addChild( list, item );
+  return item;
+}
+
+
+static void __track( __gen* g, int x, int y, int z, const char* type, const char* ori ) {
+  char id[32];
+  iONode tk = NULL;
+  StrOp.fmtb( id, "tk%d", g->tk++ );
+  tk = __item( g->tklist, wTrack.name(), id, x, y, z, ori );
+  wTrack.settype( tk, type );
+}
+
+
+/* A sensor while the budget lasts, else straight track. */
+static iONode __sensor( __gen* g, int x, int y, int z ) {
+  if( g->sensors > 0 ) {
+    char id[32];
+    iONode fb = NULL;
+    StrOp.fmtb( id, "fb%d", g->fb );
+    fb = __item( g->fblist, wFeedback.name(), id, x, y, z, wItem.west );
+    wFeedback.setaddr( fb, g->fb + 1 );
+    ListOp.add( g->fbs, (obj)fb );
+    g->fb++;
+    g->sensors--;
+    return fb;
+  }
+  __track( g, x, y, z, wTrack.straight, wItem.west );
+  return NULL;
+}
+
+
+static iONode __block( __gen* g, int x, int y, int z ) {
+  char id[32];
+  iONode bk = NULL;
+  StrOp.fmtb( id, "bk%d", g->bk );
+  bk = __item( g->bklist, wBlock.name(), id, x, y, z, wItem.west );
+  wBlock.setdesc( bk, id );
+  /* longer than any generated loco; not drawn from the seed to keep older plans */
+  wBlock.setlen( bk, 300 + ( g->bk * 37 ) % 200 );
+  ListOp.add( g->blocks, (obj)bk );
+  g->bk++;
+  return bk;
+}
+
+
+static void __fbevent( iONode bk, iONode fb, const char* action, const char* from ) {
+  iONode evt = NodeOp.inst( wFeedbackEvent.name(), bk, ELEMENT_NODE );
+  wFeedbackEvent.setid( evt, wFeedback.getid( fb ) );
+  wFeedbackEvent.setaction( evt, action );
+  wFeedbackEvent.setfrom( evt, from );
+  NodeOp.addChild( bk, evt );
+}
+
+
+static void __switch( __gen* g, int x, int y, int z, const char* type ) {
+  char id[32];
+  iONode sw = NULL;
+  StrOp.fmtb( id, "sw%d", g->sw );
+  sw = __item( g->swlist, wSwitch.name(), id, x, y, z, wItem.west );
+  wSwitch.settype( sw, type );
+  wSwitch.setaddr1( sw, g->sw / 4 + 1 );
+  wSwitch.setport1( sw, g->sw % 4 + 1 );
+  ListOp.add( g->switches, (obj)sw );
+  g->sw++;
+}
+
+
+/*
+ Line body between x+1 and x+6: sensor, 4 cell block, sensor.
+ The + side of a west oriented block is its west end, so a route to the +
+ side (all) enters at the west sensor and one to the - side at the east.
+*/
+static void __body( __gen* g, int x, int y, int z ) {
+  iONode w  = __sensor( g, x + 1, y, z );
+  iONode bk = __block( g, x + 2, y, z );
+  iONode e  = __sensor( g, x + 6, y, z );
+  if( w != NULL && e != NULL ) {
+    __fbevent( bk, w, wFeedbackEvent.enter_event, wFeedbackEvent.from_all );
+    __fbevent( bk, e, wFeedbackEvent.in_event, wFeedbackEvent.from_all );
+    __fbevent( bk, e, wFeedbackEvent.enter_event, wFeedbackEvent.from_all_reverse );
+    __fbevent( bk, w, wFeedbackEvent.in_event, wFeedbackEvent.from_all_reverse );
+  }
+}
+
+
+static void __unit( __gen* g, int type, int x, int y, int z ) {
+  int i = 0;
+  switch( type ) {
+    case UNIT_STATION:
+      /* west turnout diverges south travelling east, the east one travelling west */
+      __switch( g, x, y, z, wSwitch.right );
+      __body( g, x, y, z );
+      __switch( g, x + 7, y, z, wSwitch.left );
+      __track( g, x, y + 1, z, wTrack.curve, wItem.east );
+      __body( g, x, y + 1, z );
+      __track( g, x + 7, y + 1, z, wTrack.curve, wItem.south );
+      break;
+    case UNIT_LINE:
+      __track( g, x, y, z, wTrack.straight, wItem.west );
+      __body( g, x, y, z );
+      __track( g, x + 7, y, z, wTrack.straight, wItem.west );
+      break;
+    default:
+      for( i = 0; i < PlanGenOp.unitwidth; i++ )
+        __track( g, x + i, y, z, wTrack.straight, wItem.west );
+      break;
+  }
+}
+
+
+/* Two lines closed by curves at both ends; the bottom line is 3 rows below the top. */
+static void __oval( __gen* g, int* units, int perline, int y, int z ) {
+  int xr = 1 + perline * PlanGenOp.unitwidth;
+  int i = 0;
+
+  __track( g, 0,  y,     z, wTrack.curve,    wItem.north );
+  __track( g, xr, y,     z, wTrack.curve,    wItem.west );
+  __track( g, 0,  y + 1, z, wTrack.straight, wItem.north );
+  __track( g, xr, y + 1, z, wTrack.straight, wItem.north );
+  __track( g, 0,  y + 2, z, wTrack.straight, wItem.north );
+  __track( g, xr, y + 2, z, wTrack.straight, wItem.north );
+  __track( g, 0,  y + 3, z, wTrack.curve,    wItem.east );
+  __track( g, xr, y + 3, z, wTrack.curve,    wItem.south );
+
+  for( i = 0; i < perline; i++ ) {
+    __unit( g, units[i], 1 + i * PlanGenOp.unitwidth, y, z );
+    __unit( g, units[perline + i], 1 + i * PlanGenOp.unitwidth, y + 3, z );
+  }
+}
+
+
+static iONode __list( iONode parent, const char* listname ) {
+  iONode list = NodeOp.inst( listname, parent, ELEMENT_NODE );
+  NodeOp.addChild( parent, list );
+  return list;
+}
+
+
+static iONode __newPlan( __gen* g, const char* title ) {
+  iONode plan = NodeOp.inst( wPlan.name(), NULL, ELEMENT_NODE );
+  wPlan.settitle( plan, title );
+  g->tklist = __list( plan, wTrackList.name() );
+  g->bklist = __list( plan, wBlockList.name() );
+  g->swlist = __list( plan, wSwitchList.name() );
+  g->fblist = __list( plan, wFeedbackList.name() );
+  return plan;
+}
+
+
+static Boolean __write( const char* filename, iONode node ) {
+  Boolean ok = False;
+  iOFile f = FileOp.inst( filename, OPEN_WRITE );
+  if( f != NULL ) {
+    char* xml = NodeOp.toEscString( node );
+    ok = FileOp.writeStr( f, xml );
+    StrOp.free( xml );
+    FileOp.base.del( f );
+  }
+  if( !ok )
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "unable to write [%s]", filename );
+  return ok;
+}
+
+
+/* Locomotives in line blocks first, one per block, seeded order. */
+static void __locos( __gen* g, iONode lclist, int locos ) {
+  int cnt = ListOp.size( g->blocks );
+  int* order = allocMem( ( cnt + 1 ) * sizeof( int ) );
+  int i = 0;
+
+  for( i = 0; i < cnt; i++ )
+    order[i] = i;
+  for( i = cnt - 1; i > 0; i-- ) {
+    int j = __rand( g, i + 1 );
+    int t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+  }
+
+  for( i = 0; i < locos; i++ ) {
+    char id[32];
+    iONode lc = NodeOp.inst( wLoc.name(), lclist, ELEMENT_NODE );
+    StrOp.fmtb( id, "lc%d", i );
+    wLoc.setid( lc, id );
+    wLoc.setaddr( lc, i % 9999 + 1 );
+    wLoc.setV_min( lc, 10 );
+    wLoc.setV_mid( lc, 40 + __rand( g, 20 ) );
+    wLoc.setV_max( lc, 80 + __rand( g, 80 ) );
+    wLoc.setlen( lc, 50 + __rand( g, 200 ) );
+    if( i < cnt ) {
+      iONode bk = (iONode)ListOp.get( g->blocks, order[i] );
+      wBlock.setlocid( bk, id );
+      wLoc.setblockid( lc, wBlock.getid( bk ) );
+    }
+    NodeOp.addChild( lclist, lc );
+  }
+  freeMem( order );
+}
+
+
+/* Session for rocrail -bench using the generated ids. */
+static void __script( __gen* g, iONode lclist, const char* scriptfile ) {
+  int locos = NodeOp.getChildCnt( lclist );
+  int nrfb  = ListOp.size( g->fbs );
+  int nrsw  = ListOp.size( g->switches );
+  int nrbk  = ListOp.size( g->blocks );
+  int lines = 10 * nrbk < 1000 ? 1000:10 * nrbk;
+  iOFile f = FileOp.inst( scriptfile, OPEN_WRITE );
+  int i = 0;
+
+  if( f == NULL ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "unable to write [%s]", scriptfile );
+    return;
+  }
+
+  FileOp.fmt( f, "# generated session: %d lines, seed based\n", lines );
+  for( i = 0; i < lines; i++ ) {
+    int kind = __rand( g, 10 );
+    if( kind < 3 && locos > 0 ) {
+      iONode lc = NodeOp.getChild( lclist, __rand( g, locos ) );
+      FileOp.fmt( f, "lc,%s,V%d,%s\n", wLoc.getid(lc), __rand( g, 100 ), __rand( g, 2 ) ? "true":"false" );
+    }
+    else if( kind < 4 && locos > 0 ) {
+      iONode lc = NodeOp.getChild( lclist, __rand( g, locos ) );
+      FileOp.fmt( f, "fn,%s,%d,%s\n", wLoc.getid(lc), 1 + __rand( g, 8 ), __rand( g, 2 ) ? "true":"false" );
+    }
+    else if( kind < 6 && nrsw > 0 ) {
+      iONode sw = (iONode)ListOp.get( g->switches, __rand( g, nrsw ) );
+      FileOp.fmt( f, "sw,%s,%s\n", wSwitch.getid(sw), __rand( g, 2 ) ? wSwitch.straight:wSwitch.turnout );
+    }
+    else if( kind < 9 && nrfb > 0 ) {
+      iONode fb = (iONode)ListOp.get( g->fbs, __rand( g, nrfb ) );
+      FileOp.fmt( f, "fb,%s,true\nfb,%s,false\n", wFeedback.getid(fb), wFeedback.getid(fb) );
+    }
+    else if( nrbk > 0 ) {
+      iONode bk = (iONode)ListOp.get( g->blocks, __rand( g, nrbk ) );
+      FileOp.fmt( f, "bk,%s,%s\n", wBlock.getid(bk), __rand( g, 2 ) ? wBlock.closed:wBlock.open );
+    }
+  }
+  FileOp.base.del( f );
+}
+
+
+static int _generate( const char* filename, int blocks, int switches, int sensors, int locos, int levels, int modules, long seed, const char* scriptfile ) {
+  __gen g;
+  int stations = 0;
+  int lines = 0;
+  int perline = 0;
+  int slots = 0;
+  int areas = modules > 0 ? modules:( levels > 0 ? levels:1 );
+  int* units = NULL;
+  int* ybase = NULL;
+  iONode* plans = NULL;
+  iONode lclist = NULL;
+  iONode lcroot = NULL;
+  char* base = NULL;
+  Boolean ok = True;
+  int i = 0;
+
+  if( filename == NULL || blocks < 1 ) {
+    TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "generator needs a file name and at least one block" );
+    return -1;
+  }
+
+  MemOp.set( &g, 0, sizeof( g ) );
+  g.rnd = ( (unsigned long)seed * 2654435761UL + 1 ) & 0xFFFFFFFFUL;
+  if( g.rnd == 0 )
+    g.rnd = 1;
+  g.sensors  = sensors < 0 ? 2 * blocks:sensors;
+  g.blocks   = ListOp.inst();
+  g.switches = ListOp.inst();
+  g.fbs      = ListOp.inst();
+
+  /* a passing loop takes two blocks and two turnouts */
+  stations = switches / 2;
+  if( stations * 2 > blocks )
+    stations = blocks / 2;
+
+  slots = stations + ( blocks - 2 * stations );
+  lines = ( slots + PlanGenOp.maxunits - 1 ) / PlanGenOp.maxunits;
+  if( lines < 2 * areas )
+    lines = 2 * areas;
+  if( lines % 2 )
+    lines++;
+  perline = ( slots + lines - 1 ) / lines;
+  slots = lines * perline;
+
+  units = allocMem( slots * sizeof( int ) );
+  for( i = 0; i < slots; i++ ) {
+    if( i < stations )
+      units[i] = UNIT_STATION;
+    else if( i < stations + blocks - 2 * stations )
+      units[i] = UNIT_LINE;
+    else
+      units[i] = UNIT_PLAIN;
+  }
+  for( i = slots - 1; i > 0; i-- ) {
+    int j = __rand( &g, i + 1 );
+    int t = units[i];
+    units[i] = units[j];
+    units[j] = t;
+  }
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999,
+      "generating %d blocks (%d passing loops), %d lines of %d units on %d %s, seed %ld",
+      blocks, stations, lines, perline, areas, modules > 0 ? "modules":"levels", seed );
+
+  /* one plan per module, or a single plan with all levels */
+  plans = allocMem( areas * sizeof( iONode ) );
+  ybase = allocMem( areas * sizeof( int ) );
+  for( i = 0; i < areas; i++ ) {
+    if( modules > 0 || i == 0 ) {
+      char title[64];
+      StrOp.fmtb( title, modules > 0 ? "module %d":"generated plan, seed %ld", modules > 0 ? (long)(i + 1):seed );
+      plans[i] = __newPlan( &g, title );
+    }
+    else {
+      plans[i] = plans[0];
+    }
+  }
+
+  for( i = 0; i < lines / 2; i++ ) {
+    int area = i % areas;
+    iONode plan = plans[area];
+    g.tklist = wPlan.gettklist( plan );
+    g.bklist = wPlan.getbklist( plan );
+    g.swlist = wPlan.getswlist( plan );
+    g.fblist = wPlan.getfblist( plan );
+    __oval( &g, units + i * 2 * perline, perline, ybase[area], modules > 0 ? 0:area );
+    ybase[area] += 6;
+  }
+
+  /* sensors not used on the track; off-track, still addressed */
+  g.tklist = wPlan.gettklist( plans[0] );
+  g.fblist = wPlan.getfblist( plans[0] );
+  for( i = 0; g.sensors > 0; i++ ) {
+    __sensor( &g, 2 * ( i % PlanGenOp.sensorrow ), ybase[0] + 1 + 2 * ( i / PlanGenOp.sensorrow ), 0 );
+  }
+
+  /* locomotives */
+  lcroot = modules > 0 ? NodeOp.inst( wPlan.name(), NULL, ELEMENT_NODE ):plans[0];
+  lclist = __list( lcroot, wLocList.name() );
+  __locos( &g, lclist, locos );
+
+  base = StrOp.dup( filename );
+  if( StrOp.endsWithi( base, ".xml" ) )
+    base[StrOp.len( base ) - 4] = '\0';
+
+  if( modules > 0 ) {
+    iONode modplan = NodeOp.inst( wModPlan.name(), NULL, ELEMENT_NODE );
+    iONode rtroot = NodeOp.inst( wPlan.name(), NULL, ELEMENT_NODE );
+    char* lcfile = StrOp.fmt( "%s-lc.xml", base );
+    char* rtfile = StrOp.fmt( "%s-rt.xml", base );
+
+    wModPlan.settitle( modplan, "generated modular plan" );
+    wModPlan.setlocs( modplan, FileOp.ripPath( lcfile ) );
+    wModPlan.setroutes( modplan, FileOp.ripPath( rtfile ) );
+    __list( rtroot, wRouteList.name() );
+
+    for( i = 0; i < modules && ok; i++ ) {
+      iONode module = NodeOp.inst( wModule.name(), modplan, ELEMENT_NODE );
+      char* modfile = StrOp.fmt( "%s-m%d.xml", base, i + 1 );
+      char modid[32];
+      StrOp.fmtb( modid, "m%d", i + 1 );
+      wModule.setid( module, modid );
+      wModule.settitle( module, wPlan.gettitle( plans[i] ) );
+      wModule.setnr( module, i + 1 );
+      wModule.setfilename( module, FileOp.ripPath( modfile ) );
+      wModule.setx( module, 0 );
+      wModule.sety( module, ybase[0] * i );
+      NodeOp.addChild( modplan, module );
+      ok = __write( modfile, plans[i] );
+      StrOp.free( modfile );
+    }
+
+    ok = ok && __write( lcfile, lcroot ) && __write( rtfile, rtroot ) && __write( filename, modplan );
+
+    NodeOp.base.del( rtroot );
+    NodeOp.base.del( modplan );
+    StrOp.free( lcfile );
+    StrOp.free( rtfile );
+  }
+  else {
+    for( i = 0; i < areas; i++ ) {
+      char title[32];
+      iONode zlevel = NodeOp.inst( wZLevel.name(), plans[0], ELEMENT_NODE );
+      StrOp.fmtb( title, "level %d", i );
+      wZLevel.setz( zlevel, i );
+      wZLevel.settitle( zlevel, title );
+      NodeOp.addChild( plans[0], zlevel );
+    }
+    ok = __write( filename, plans[0] );
+  }
+
+  if( ok && scriptfile != NULL )
+    __script( &g, lclist, scriptfile );
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999,
+      "generated [%s]: %d blocks, %d turnouts, %d sensors, %d tracks, %d locos",
+      filename, g.bk, g.sw, g.fb, g.tk, locos );
+
+  for( i = 0; i < areas; i++ ) {
+    if( modules > 0 || i == 0 )
+      NodeOp.base.del( plans[i] );
+  }
+  if( modules > 0 )
+    NodeOp.base.del( lcroot );
+  freeMem( plans );
+  freeMem( ybase );
+  freeMem( units );
+  StrOp.free( base );
+  ListOp.base.del( g.blocks );
+  ListOp.base.del( g.switches );
+  ListOp.base.del( g.fbs );
+
+  return ok ? g.bk:-1;
+}
+
+
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
+#include "rocrail/impl/plangen.fm"
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
@@ -54,10 +54,20 @@
 
 #include "rocs/public/mem.h"
 #include "rocs/public/doc.h"
+#include "rocs/public/system.h"
+#include "rocs/public/metrics.h"
+
+#include <time.h>
 
 static int instCnt = 0;
 
+static int __mRetransmits = -1;
+static int __mDuplicates  = -1;
+static int __mDropped     = -1;
+static int __mDelivered   = -1;
+
 static const char* __getBlockID( const char* bkid, char* rrid );
+static unsigned long __post( iOR2Rnet inst, const char* dest, iONode msg );
 
 
 /** ----- OBase ----- */
@@ -171,9 +181,8 @@ static void __handleNetReq(iOR2Rnet inst, iONode req) {
 
   /* netroutes request */
   if( StrOp.equals( wNetReq.req_netroutes, wNetReq.getreq(req) ) && data->netroutesprovider ) {
-    char* s = NodeOp.base.toString(data->netroutes);
     TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "providing netroutes..." );
-    ThreadOp.post(data->writer, (obj)s);
+    __post(inst, NULL, data->netroutes);
   }
 
   /* getblock request */
@@ -188,9 +197,8 @@ static void __handleNetReq(iOR2Rnet inst, iONode req) {
       wNetRsp.setremoteid( rsp, wNetReq.getlocalid(req) );
       wNetRsp.setrsp( rsp, wNetRsp.rsp_block );
       NodeOp.addChild( rsp, (iONode)NodeOp.base.clone(block->base.properties(block)) );
-      char* s = NodeOp.base.toString(rsp);
       TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "block %s response to %s", wNetReq.getremotebk(req), wNetReq.getlocalid(req) );
-      ThreadOp.post(data->writer, (obj)s);
+      __post(inst, wNetReq.getlocalid(req), rsp);
       NodeOp.base.del(rsp);
     }
   }
@@ -208,9 +216,8 @@ static void __handleNetReq(iOR2Rnet inst, iONode req) {
       wNetRsp.setlocalbk( rsp, wNetReq.getremotebk(req) );
       wNetRsp.setremoteid( rsp, wNetReq.getlocalid(req) );
       wNetRsp.setrsp( rsp, block->isFree(block, wLoc.getid(lc)) ? wNetRsp.rsp_isfree:wNetRsp.rsp_occupied );
-      char* s = NodeOp.base.toString(rsp);
       TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "block %s response to %s", wNetReq.getremotebk(req), wNetReq.getlocalid(req) );
-      ThreadOp.post(data->writer, (obj)s);
+      __post(inst, wNetReq.getlocalid(req), rsp);
       NodeOp.base.del(rsp);
     }
   }
@@ -248,9 +255,8 @@ static void __handleNetReq(iOR2Rnet inst, iONode req) {
         wNetRsp.setlocalid( rsp, wR2RnetIni.getid(data->props) );
         wNetRsp.setremoteid( rsp, wNetReq.getlocalid(req) );
         wNetRsp.setrsp( rsp, reserved ? wNetRsp.rsp_reserved:wNetRsp.rsp_occupied );
-        char* s = NodeOp.base.toString(rsp);
         TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "block %s response to %s", wNetReq.getremotebk(req), wNetReq.getlocalid(req) );
-        ThreadOp.post(data->writer, (obj)s);
+        __post(inst, wNetReq.getlocalid(req), rsp);
         NodeOp.base.del(rsp);
       }
       else {
@@ -287,9 +293,8 @@ static void __handleNetReq(iOR2Rnet inst, iONode req) {
         wNetRsp.setlocalid( rsp, wR2RnetIni.getid(data->props) );
         wNetRsp.setremoteid( rsp, wNetReq.getlocalid(req) );
         wNetRsp.setrsp( rsp, wNetRsp.rsp_unlocked );
-        char* s = NodeOp.base.toString(rsp);
         TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "block %s response to %s", wNetReq.getremotebk(req), wNetReq.getlocalid(req) );
-        ThreadOp.post(data->writer, (obj)s);
+        __post(inst, wNetReq.getlocalid(req), rsp);
         NodeOp.base.del(rsp);
         LocOp.stopNet(loc);
       }
@@ -326,9 +331,10 @@ static void __handleNetReq(iOR2Rnet inst, iONode req) {
     wNetRsp.setport( rsp, ClntConOp.getClientPort(clntcon) );
     wNetRsp.setplan( rsp, ModelOp.getTitle(AppOp.getModel()));
     wNetRsp.setrsp( rsp, wNetRsp.rsp_clientconn );
-    char* s = NodeOp.base.toString(rsp);
-    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "client connection response: %s", s );
-    ThreadOp.post(data->writer, (obj)s);
+    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "client connection response: %s:%d",
+        wNetRsp.gethost(rsp), wNetRsp.getport(rsp) );
+    __post(inst, NULL, rsp);
+    NodeOp.base.del(rsp);
   }
 
 }
@@ -442,31 +448,478 @@ static void __evaluateMessage(iOR2Rnet inst, const char* s) {
 }
 
 
-#define MSGSIZE 10*1024
+/* ------------------------------------------------------------
+ Binary transport:
+   Every datagram starts with a header followed by a batch of records:
+     'R' '2' 'R' version, idlen id, session(4)
+   Records:
+     DATA: type seq(4) base(4) destlen dest len(4) payload
+     ACK:  type destlen dest session(4) seq(4)
+   All numbers are big endian.
+   A DATA record with a destination carries a per destination sequence
+   number; base is the oldest sequence the sender still retransmits.
+   The receiver delivers in order, suppresses duplicates and returns a
+   cumulative ACK. Records without destination (seq 0) are not acknowledged.
+   ------------------------------------------------------------ */
+
+#define R2R_VERSION   1
+#define R2R_DATA      1
+#define R2R_ACK       2
+#define R2R_DGRAMSIZE (60*1024)
+#define R2R_BATCHSIZE (8*1024)
+#define R2R_RXBATCH   8
+#define R2R_REORDER   64
+#define R2R_RTO       5     /* initial retransmit timeout in 10ms ticks */
+#define R2R_RTOMAX    40
+
+struct __r2rmsg {
+  unsigned long id;
+  unsigned long cancel;
+  unsigned long seq;
+  char* dest;
+  char* payload;
+  int   len;
+  unsigned long sent;
+  int   tries;
+};
+
+struct __r2rpeer {
+  unsigned long txseq;
+  iOList unacked;
+  unsigned long rxsession;
+  unsigned long rxseq;
+  iOList reorder;
+  Boolean ackdue;
+  char id[64];
+};
+
+
+static void __freeMsg( struct __r2rmsg* msg ) {
+  if( msg->dest != NULL )
+    StrOp.free( msg->dest );
+  if( msg->payload != NULL )
+    StrOp.free( msg->payload );
+  freeMem( msg );
+}
+
+static struct __r2rmsg* __newRxMsg( unsigned long seq, const byte* payload, int len ) {
+  struct __r2rmsg* msg = allocMem( sizeof( struct __r2rmsg ) );
+  msg->seq = seq;
+  msg->len = len;
+  msg->payload = allocMem( len + 1 );
+  MemOp.copy( msg->payload, payload, len );
+  return msg;
+}
+
+static void __freeRxMsg( struct __r2rmsg* msg ) {
+  freeMem( msg->payload );
+  freeMem( msg );
+}
+
+
+/* Caller must own the peerMux. */
+static struct __r2rpeer* __getPeer( iOR2RnetData data, const char* id ) {
+  struct __r2rpeer* peer = (struct __r2rpeer*)MapOp.get( data->peers, id );
+  if( peer == NULL ) {
+    peer = allocMem( sizeof( struct __r2rpeer ) );
+    StrOp.copy( peer->id, id );
+    peer->unacked = ListOp.inst();
+    peer->reorder = ListOp.inst();
+    MapOp.put( data->peers, id, (obj)peer );
+  }
+  return peer;
+}
+
+
+/* Returns an id for __cancel. */
+static unsigned long __post( iOR2Rnet inst, const char* dest, iONode msg ) {
+  iOR2RnetData data = Data(inst);
+  struct __r2rmsg* r2rmsg = allocMem( sizeof( struct __r2rmsg ) );
+  unsigned long id = 0;
+  r2rmsg->payload = NodeOp.base.toString(msg);
+  r2rmsg->len = StrOp.len(r2rmsg->payload);
+  if( dest != NULL && StrOp.len(dest) > 0 && StrOp.len(dest) < 64 && !StrOp.equals( "*", dest ) )
+    r2rmsg->dest = StrOp.dup(dest);
+  MutexOp.wait( data->peerMux );
+  id = r2rmsg->id = ++data->postid;
+  MutexOp.post( data->peerMux );
+  ThreadOp.post( data->writer, (obj)r2rmsg );
+  return id;
+}
+
+
+/* Stop retransmitting a posted message; the writer handles it after the message itself. */
+static void __cancel( iOR2Rnet inst, const char* dest, unsigned long id ) {
+  iOR2RnetData data = Data(inst);
+  struct __r2rmsg* r2rmsg = NULL;
+  if( dest == NULL || StrOp.len(dest) == 0 || StrOp.len(dest) >= 64 || StrOp.equals( "*", dest ) )
+    return;
+  r2rmsg = allocMem( sizeof( struct __r2rmsg ) );
+  r2rmsg->dest = StrOp.dup(dest);
+  r2rmsg->cancel = id;
+  ThreadOp.post( data->writer, (obj)r2rmsg );
+}
+
+
+/* xorshift for the droprate; rand() would shift the seeded sequence of the model. */
+static int __rand( iOR2RnetData data, int range ) {
+  unsigned long x = data->rnd;
+  x ^= ( x << 13 ) & 0xFFFFFFFFUL;
+  x ^= x >> 17;
+  x ^= ( x << 5 ) & 0xFFFFFFFFUL;
+  data->rnd = x & 0xFFFFFFFFUL;
+  return (int)( data->rnd % range );
+}
+
+
+static int __putLong( byte* buf, int pos, unsigned long val ) {
+  buf[pos++] = (byte)((val >> 24) & 0xFF);
+  buf[pos++] = (byte)((val >> 16) & 0xFF);
+  buf[pos++] = (byte)((val >>  8) & 0xFF);
+  buf[pos++] = (byte)( val        & 0xFF);
+  return pos;
+}
+
+static unsigned long __getLong( const byte* buf ) {
+  return ((unsigned long)buf[0] << 24) | ((unsigned long)buf[1] << 16) | ((unsigned long)buf[2] << 8) | (unsigned long)buf[3];
+}
+
+static int __putStr( byte* buf, int pos, const char* str ) {
+  int len = str != NULL ? StrOp.len(str):0;
+  buf[pos++] = (byte)len;
+  MemOp.copy( buf + pos, str, len );
+  return pos + len;
+}
+
+
+static int __putHeader( iOR2RnetData data, byte* buf ) {
+  int pos = 0;
+  buf[pos++] = 'R';
+  buf[pos++] = '2';
+  buf[pos++] = 'R';
+  buf[pos++] = R2R_VERSION;
+  pos = __putStr( buf, pos, wR2RnetIni.getid(data->props) );
+  return __putLong( buf, pos, data->session );
+}
+
+
+static int __flush( iOR2RnetData data, byte* buf, int pos, int hdrlen ) {
+  if( pos > hdrlen ) {
+    TraceOp.trc( name, TRCLEVEL_BYTE, __LINE__, 9999, "send datagram of %d bytes", pos );
+    SocketOp.sendto( data->writeUDP, (char*)buf, pos, NULL, 0 );
+  }
+  return hdrlen;
+}
+
+
+static int __putData( iOR2RnetData data, byte* buf, int pos, int hdrlen, struct __r2rmsg* msg, unsigned long base ) {
+  int reclen = 1 + 4 + 4 + 1 + (msg->dest != NULL ? StrOp.len(msg->dest):0) + 4 + msg->len;
+
+  if( reclen > R2R_DGRAMSIZE - hdrlen ) {
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "message of %d bytes exceeds the datagram size", msg->len );
+    return pos;
+  }
+  if( pos + reclen > R2R_BATCHSIZE )
+    pos = __flush( data, buf, pos, hdrlen );
+
+  buf[pos++] = R2R_DATA;
+  pos = __putLong( buf, pos, msg->seq );
+  pos = __putLong( buf, pos, base );
+  pos = __putStr( buf, pos, msg->dest );
+  pos = __putLong( buf, pos, msg->len );
+  MemOp.copy( buf + pos, msg->payload, msg->len );
+  return pos + msg->len;
+}
+
+
+/* Resend unacknowledged messages with a doubling timeout; caller must own the peerMux. */
+static int __retransmit( iOR2RnetData data, byte* buf, int pos, int hdrlen ) {
+  unsigned long now = SystemOp.getTick();
+  struct __r2rpeer* peer = (struct __r2rpeer*)MapOp.first( data->peers );
+
+  while( peer != NULL ) {
+    int i = 0;
+    while( i < ListOp.size( peer->unacked ) ) {
+      struct __r2rmsg* msg = (struct __r2rmsg*)ListOp.get( peer->unacked, i );
+      int rto = R2R_RTO << (msg->tries < 4 ? msg->tries:3);
+      if( rto > R2R_RTOMAX )
+        rto = R2R_RTOMAX;
+
+      if( now - msg->sent >= (unsigned long)rto ) {
+        if( msg->tries >= wR2RnetIni.getretries(data->props) ) {
+          /* the peer skips it on the next base; reported as exception for the SNMP trap */
+          TraceOp.trc( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, "message %lu to %s dropped: not acknowledged after %d retries",
+              msg->seq, peer->id, msg->tries );
+          data->dropped++;
+          MetricsOp.add( __mDropped, 1 );
+          ListOp.remove( peer->unacked, i );
+          __freeMsg( msg );
+          continue;
+        }
+        msg->tries++;
+        msg->sent = now;
+        data->retransmits++;
+        MetricsOp.add( __mRetransmits, 1 );
+        TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "retransmit message %lu to %s (%d)", msg->seq, peer->id, msg->tries );
+        pos = __putData( data, buf, pos, hdrlen,
+            msg, ((struct __r2rmsg*)ListOp.get( peer->unacked, 0 ))->seq );
+      }
+      i++;
+    }
+    peer = (struct __r2rpeer*)MapOp.next( data->peers );
+  }
+
+  return pos;
+}
+
+
+/* Send one cumulative ACK per peer which delivered new or duplicate messages. */
+static void __sendAcks( iOR2RnetData data ) {
+  byte buf[R2R_BATCHSIZE];
+  int hdrlen = __putHeader( data, buf );
+  int pos = hdrlen;
+  struct __r2rpeer* peer = NULL;
+
+  MutexOp.wait( data->peerMux );
+  peer = (struct __r2rpeer*)MapOp.first( data->peers );
+  while( peer != NULL ) {
+    if( peer->ackdue ) {
+      if( pos + 1 + 1 + 64 + 4 + 4 > R2R_BATCHSIZE )
+        pos = __flush( data, buf, pos, hdrlen );
+      buf[pos++] = R2R_ACK;
+      pos = __putStr( buf, pos, peer->id );
+      pos = __putLong( buf, pos, peer->rxsession );
+      pos = __putLong( buf, pos, peer->rxseq );
+      peer->ackdue = False;
+    }
+    peer = (struct __r2rpeer*)MapOp.next( data->peers );
+  }
+  MutexOp.post( data->peerMux );
+
+  __flush( data, buf, pos, hdrlen );
+}
+
+
+/* Move the in order received messages to the deliver list; caller must own the peerMux. */
+static void __deliverInOrder( struct __r2rpeer* peer, iOList deliver ) {
+  Boolean found = True;
+  while( found ) {
+    int i = 0;
+    found = False;
+    for( i = 0; i < ListOp.size( peer->reorder ); i++ ) {
+      struct __r2rmsg* msg = (struct __r2rmsg*)ListOp.get( peer->reorder, i );
+      if( msg->seq <= peer->rxseq ) {
+        ListOp.remove( peer->reorder, i );
+        __freeRxMsg( msg );
+        found = True;
+        break;
+      }
+      if( msg->seq == peer->rxseq + 1 ) {
+        ListOp.remove( peer->reorder, i );
+        ListOp.add( deliver, (obj)msg );
+        peer->rxseq = msg->seq;
+        found = True;
+        break;
+      }
+    }
+  }
+}
+
+
+static void __evaluateData( iOR2Rnet inst, const char* sender, unsigned long session,
+                            unsigned long seq, unsigned long base, const byte* payload, int len, iOList deliver )
+{
+  iOR2RnetData data = Data(inst);
+  struct __r2rpeer* peer = NULL;
+
+  MutexOp.wait( data->peerMux );
+  peer = __getPeer( data, sender );
+
+  if( peer->rxsession != session ) {
+    /* new or restarted sender */
+    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "R2Rnet session %08lX of %s", session, sender );
+    peer->rxsession = session;
+    peer->rxseq = base > 0 ? base - 1:0;
+    while( ListOp.size( peer->reorder ) > 0 )
+      __freeRxMsg( (struct __r2rmsg*)ListOp.remove( peer->reorder, 0 ) );
+  }
+  else if( base > 0 && base - 1 > peer->rxseq ) {
+    /* the sender gave up on older messages */
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "R2Rnet messages %lu-%lu of %s lost", peer->rxseq + 1, base - 1, sender );
+    peer->rxseq = base - 1;
+  }
+
+  peer->ackdue = True;
+
+  if( seq <= peer->rxseq ) {
+    data->duplicates++;
+    MetricsOp.add( __mDuplicates, 1 );
+    TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "duplicate message %lu from %s", seq, sender );
+  }
+  else if( ListOp.size( peer->reorder ) < R2R_REORDER ) {
+    ListOp.add( peer->reorder, (obj)__newRxMsg( seq, payload, len ) );
+  }
+
+  __deliverInOrder( peer, deliver );
+  MutexOp.post( data->peerMux );
+}
+
+
+static void __evaluateAck( iOR2Rnet inst, const char* sender, unsigned long session, unsigned long seq ) {
+  iOR2RnetData data = Data(inst);
+  struct __r2rpeer* peer = NULL;
+
+  if( session != data->session )
+    return;
+
+  MutexOp.wait( data->peerMux );
+  peer = __getPeer( data, sender );
+  while( ListOp.size( peer->unacked ) > 0 ) {
+    struct __r2rmsg* msg = (struct __r2rmsg*)ListOp.get( peer->unacked, 0 );
+    if( msg->seq > seq )
+      break;
+    ListOp.remove( peer->unacked, 0 );
+    __freeMsg( msg );
+  }
+  MutexOp.post( data->peerMux );
+}
+
+
+static Boolean __getStr( const byte* buf, int size, int* pos, char* str ) {
+  int len = 0;
+  if( *pos >= size )
+    return False;
+  len = buf[(*pos)++];
+  if( *pos + len > size )
+    return False;
+  MemOp.copy( str, buf + *pos, len );
+  str[len] = '\0';
+  *pos += len;
+  return True;
+}
+
+
+/* Returns True if the datagram contained records which must be acknowledged. */
+static Boolean __evaluateDatagram( iOR2Rnet inst, byte* buf, int size ) {
+  iOR2RnetData data = Data(inst);
+  const char* id = wR2RnetIni.getid(data->props);
+  Boolean ackdue = False;
+  char sender[256];
+  char dest[256];
+  unsigned long session = 0;
+  iOList deliver = NULL;
+  int pos = 4;
+
+  if( size < 4 || buf[0] != 'R' || buf[1] != '2' || buf[2] != 'R' ) {
+    /* plain XML datagram */
+    buf[size] = '\0';
+    TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "msg:\n%s", buf );
+    __evaluateMessage( inst, (const char*)buf );
+    return False;
+  }
+
+  if( buf[3] != R2R_VERSION || !__getStr( buf, size, &pos, sender ) || pos + 4 > size ) {
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "unsupported R2Rnet datagram version %d", buf[3] );
+    return False;
+  }
+  session = __getLong( buf + pos );
+  pos += 4;
+
+  /* own multicast echo */
+  if( StrOp.equals( sender, id ) )
+    return False;
+
+  deliver = ListOp.inst();
+
+  while( pos < size ) {
+    byte type = buf[pos++];
+
+    if( type == R2R_DATA && pos + 8 <= size ) {
+      unsigned long seq  = __getLong( buf + pos );
+      unsigned long base = __getLong( buf + pos + 4 );
+      int len = 0;
+      pos += 8;
+      if( !__getStr( buf, size, &pos, dest ) || pos + 4 > size )
+        break;
+      len = (int)__getLong( buf + pos );
+      pos += 4;
+      if( len < 0 || pos + len > size )
+        break;
+
+      if( seq == 0 )
+        ListOp.add( deliver, (obj)__newRxMsg( 0, buf + pos, len ) );
+      else if( StrOp.equals( dest, id ) ) {
+        __evaluateData( inst, sender, session, seq, base, buf + pos, len, deliver );
+        ackdue = True;
+      }
+      pos += len;
+    }
+    else if( type == R2R_ACK ) {
+      if( !__getStr( buf, size, &pos, dest ) || pos + 8 > size )
+        break;
+      if( StrOp.equals( dest, id ) )
+        __evaluateAck( inst, sender, __getLong( buf + pos ), __getLong( buf + pos + 4 ) );
+      pos += 8;
+    }
+    else
+      break;
+  }
+
+  if( pos < size )
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "truncated R2Rnet datagram from %s", sender );
+
+  /* evaluate outside the peerMux: handlers post responses */
+  while( ListOp.size( deliver ) > 0 ) {
+    struct __r2rmsg* msg = (struct __r2rmsg*)ListOp.remove( deliver, 0 );
+    TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "msg %lu from %s:\n%s", msg->seq, sender, msg->payload );
+    if( msg->seq > 0 )
+      MetricsOp.add( __mDelivered, 1 );
+    __evaluateMessage( inst, msg->payload );
+    __freeRxMsg( msg );
+  }
+  ListOp.base.del( deliver );
+
+  return ackdue;
+}
+
 
 static void __reader( void* threadinst ) {
   iOThread th = (iOThread)threadinst;
   iOR2Rnet r2rnet = (iOR2Rnet)ThreadOp.getParm( th );
   iOR2RnetData data = Data(r2rnet);
-  char* msg = allocMem(MSGSIZE);
+  int framesize = R2R_DGRAMSIZE + 1;
+  byte* frames = allocMem( R2R_RXBATCH * framesize );
+  int sizes[R2R_RXBATCH];
+  int droprate = wR2RnetIni.getdroprate(data->props);
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "R2Rnet reader started." );
+  if( droprate > 0 )
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "R2Rnet discards %d%% of the received datagrams", droprate );
 
   data->gotnetroutes = __readNetRoutes(r2rnet);
 
   do {
-    int extended = False;
-    int event   = False;
-
-    MemOp.set( msg, 0, MSGSIZE );
+    Boolean ackdue = False;
+    int cnt = SocketOp.recvBatch( data->readUDP, (char*)frames, framesize, R2R_RXBATCH, sizes );
+    int i = 0;
+
+    for( i = 0; i < cnt; i++ ) {
+      if( sizes[i] <= 0 || sizes[i] > R2R_DGRAMSIZE )
+        continue;
+      if( droprate > 0 && __rand( data, 100 ) < droprate ) {
+        TraceOp.trc( name, TRCLEVEL_BYTE, __LINE__, 9999, "discard datagram of %d bytes", sizes[i] );
+        continue;
+      }
+      if( __evaluateDatagram( r2rnet, frames + i * framesize, sizes[i] ) )
+        ackdue = True;
+    }
 
-    SocketOp.recvfrom( data->readUDP, msg, MSGSIZE, NULL, NULL );
-    TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "msg:\n%s", msg );
-    __evaluateMessage(r2rnet, msg);
+    if( ackdue )
+      __sendAcks( data );
 
   } while( data->run && !ThreadOp.isQuit(th) );
 
-  freeMem(msg);
+  freeMem(frames);
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "R2Rnet reader stopped." );
 }
@@ -476,30 +929,75 @@ static void __writer( void* threadinst ) {
   iOThread th = (iOThread)threadinst;
   iOR2Rnet r2rnet = (iOR2Rnet)ThreadOp.getParm( th );
   iOR2RnetData data = Data(r2rnet);
+  Boolean binary = wR2RnetIni.isbinary(data->props);
+  byte* buf = allocMem( R2R_DGRAMSIZE );
+  int hdrlen = __putHeader( data, buf );
+  int pos = hdrlen;
   int retryGetNetRoutes = 0;
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "R2Rnet writer started." );
 
   do {
-    char* req = (char*)ThreadOp.getPost( th );
-    if (req != NULL) {
-      int plen     = 0;
+    /* batch all queued messages */
+    struct __r2rmsg* msg = (struct __r2rmsg*)ThreadOp.getPost( th );
+    while( msg != NULL ) {
+      TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "write request from queue:\n%s", msg->payload != NULL ? msg->payload:"(cancel)" );
+
+      if( msg->cancel != 0 ) {
+        if( binary ) {
+          struct __r2rpeer* peer = NULL;
+          int i = 0;
+          MutexOp.wait( data->peerMux );
+          peer = __getPeer( data, msg->dest );
+          for( i = 0; i < ListOp.size( peer->unacked ); i++ ) {
+            struct __r2rmsg* sent = (struct __r2rmsg*)ListOp.get( peer->unacked, i );
+            if( sent->id == msg->cancel ) {
+              TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "message %lu to %s cancelled", sent->seq, peer->id );
+              ListOp.remove( peer->unacked, i );
+              __freeMsg( sent );
+              break;
+            }
+          }
+          MutexOp.post( data->peerMux );
+        }
+        __freeMsg( msg );
+      }
+      else if( !binary ) {
+        SocketOp.sendto( data->writeUDP, msg->payload, msg->len, NULL, 0 );
+        __freeMsg( msg );
+      }
+      else if( msg->dest == NULL ) {
+        pos = __putData( data, buf, pos, hdrlen, msg, 0 );
+        __freeMsg( msg );
+      }
+      else {
+        struct __r2rpeer* peer = NULL;
+        MutexOp.wait( data->peerMux );
+        peer = __getPeer( data, msg->dest );
+        msg->seq = ++peer->txseq;
+        msg->sent = SystemOp.getTick();
+        ListOp.add( peer->unacked, (obj)msg );
+        pos = __putData( data, buf, pos, hdrlen, msg, ((struct __r2rmsg*)ListOp.get( peer->unacked, 0 ))->seq );
+        MutexOp.post( data->peerMux );
+      }
+
+      msg = (struct __r2rmsg*)ThreadOp.getPost( th );
+    }
 
-      TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "write request from queue:\n%s", req );
-      SocketOp.sendto( data->writeUDP, req, StrOp.len(req), NULL, 0 );
-      StrOp.free(req);
+    if( binary ) {
+      MutexOp.wait( data->peerMux );
+      pos = __retransmit( data, buf, pos, hdrlen );
+      MutexOp.post( data->peerMux );
+      pos = __flush( data, buf, pos, hdrlen );
     }
 
     if( !data->gotnetroutes ) {
       if( retryGetNetRoutes > 100 ) {
-        char* s = NULL;
         iONode req = NodeOp.inst( wNetReq.name(), NULL, ELEMENT_NODE );
         wNetReq.setreq( req, wNetReq.req_netroutes );
         wNetReq.setlocalid( req, wR2RnetIni.getid(data->props) );
         wNetReq.setremoteid( req, "*" );
-        s = NodeOp.base.toString(req);
-        SocketOp.sendto( data->writeUDP, s, StrOp.len(s), NULL, 0 );
-        StrOp.free(s);
+        __post( r2rnet, NULL, req );
         NodeOp.base.del(req);
         retryGetNetRoutes = 0;
       }
@@ -511,12 +1009,16 @@ static void __writer( void* threadinst ) {
     ThreadOp.sleep(10);
   } while( data->run && !ThreadOp.isQuit(th) );
 
+  freeMem(buf);
+
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "R2Rnet writer stopped." );
 }
 
 
 static void _quit( iOR2Rnet inst ) {
   iOR2RnetData data = Data(inst);
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "R2Rnet %ld retransmits, %ld duplicates, %ld dropped",
+      data->retransmits, data->duplicates, data->dropped );
   data->run = False;
 }
 
@@ -543,6 +1045,7 @@ static Boolean _reserveBlock( iOR2Rnet inst, const char* rrid, const char* bkid,
   iONode bkprops = check ? NULL:(iONode)NodeOp.base.clone(bk);
 
   Boolean isReserved = False;
+  unsigned long reqid = 0;
 
   if( !MutexOp.trywait( data->reqMux, 1000 ) ) {
     TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "timeout on request mutex" );
@@ -564,7 +1067,6 @@ static Boolean _reserveBlock( iOR2Rnet inst, const char* rrid, const char* bkid,
   }
 
   {
-    char* s = NULL;
     iONode req   = NodeOp.inst( wNetReq.name(), NULL, ELEMENT_NODE );
     wNetReq.setreq( req, check ? wNetReq.req_isfree:wNetReq.req_reserve );
     wNetReq.setlocalid( req, wR2RnetIni.getid(data->props) );
@@ -576,11 +1078,10 @@ static Boolean _reserveBlock( iOR2Rnet inst, const char* rrid, const char* bkid,
     NodeOp.addChild(req, lcprops);
     if( !check )
       NodeOp.addChild(req, bkprops);
-    s = NodeOp.base.toString(req);
     data->openreq = req;
 
     EventOp.reset(data->rspEvt);
-    ThreadOp.post( data->writer, (obj)s);
+    reqid = __post( inst, rrid, req );
 
     if( EventOp.trywait(data->rspEvt, 1000) ) {
       data->openreq = NULL;
@@ -596,7 +1097,25 @@ static Boolean _reserveBlock( iOR2Rnet inst, const char* rrid, const char* bkid,
       }
     }
     else {
+      data->openreq = NULL;
       TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "timeout on response event" );
+      if( !check ) {
+        /* the caller takes this as occupied: a retransmitted reserve may not lock the remote block later */
+        iONode unlock = NodeOp.inst( wNetReq.name(), NULL, ELEMENT_NODE );
+        char tmp[256];
+        if( StrOp.find(bkid, "::") == NULL )
+          StrOp.fmtb( tmp, "%s::%s", rrid, bkid );
+        else
+          StrOp.fmtb( tmp, "%s", bkid );
+        __cancel( inst, rrid, reqid );
+        wNetReq.setreq( unlock, wNetReq.req_unlock );
+        wNetReq.setlocalid( unlock, wR2RnetIni.getid(data->props) );
+        wNetReq.setremoteid( unlock, rrid );
+        wNetReq.setremotebk( unlock, tmp );
+        wNetReq.setlcid( unlock, wLoc.getid(lcprops) );
+        __post( inst, rrid, unlock );
+        NodeOp.base.del(unlock);
+      }
     }
 
     NodeOp.base.del(req);
@@ -618,18 +1137,16 @@ static Boolean _unlockBlock( iOR2Rnet inst, const char* rrid, const char* bkid,
   }
 
   {
-    char* s = NULL;
     iONode req   = NodeOp.inst( wNetReq.name(), NULL, ELEMENT_NODE );
     wNetReq.setreq( req, wNetReq.req_unlock );
     wNetReq.setlocalid( req, wR2RnetIni.getid(data->props) );
     wNetReq.setremoteid( req, rrid );
     wNetReq.setremotebk( req, bkid );
     wNetReq.setlcid( req, lcid );
-    s = NodeOp.base.toString(req);
     data->openreq = req;
 
     EventOp.reset(data->rspEvt);
-    ThreadOp.post( data->writer, (obj)s);
+    __post( inst, rrid, req );
 
     if( EventOp.trywait(data->rspEvt, 1000) ) {
       data->openreq = NULL;
@@ -642,6 +1159,7 @@ static Boolean _unlockBlock( iOR2Rnet inst, const char* rrid, const char* bkid,
       }
     }
     else {
+      data->openreq = NULL;
       TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "timeout on response event" );
     }
 
@@ -668,15 +1186,12 @@ static void _locoIsIn( iOR2Rnet inst, const char* rrid, const char* lcid, const
     return;
   }
   else {
-    char* s = NULL;
     iONode req   = NodeOp.inst( wNetReq.name(), NULL, ELEMENT_NODE );
     wNetReq.setreq( req, wNetReq.req_locoisin );
     wNetReq.setlocalid( req, wR2RnetIni.getid(data->props) );
     wNetReq.setremoteid( req, rrid );
     wNetReq.setlocalbk( req, bkid );
-    s = NodeOp.base.toString(req);
-
-    ThreadOp.post( data->writer, (obj)s);
+    __post( inst, rrid, req );
 
     NodeOp.base.del(req);
   }
@@ -702,17 +1217,15 @@ static iONode _getBlock( iOR2Rnet inst, const char* bkid ) {
     return NULL;
   }
   else {
-    char* s = NULL;
     iONode req   = NodeOp.inst( wNetReq.name(), NULL, ELEMENT_NODE );
     wNetReq.setreq( req, wNetReq.req_getblock );
     wNetReq.setlocalid( req, wR2RnetIni.getid(data->props) );
     wNetReq.setremoteid( req, rrid );
     wNetReq.setremotebk( req, blockid );
-    s = NodeOp.base.toString(req);
     data->openreq = req;
 
     EventOp.reset(data->rspEvt);
-    ThreadOp.post( data->writer, (obj)s);
+    __post( inst, rrid, req );
 
     if( EventOp.trywait(data->rspEvt, 1000) ) {
       TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "got response event" );
@@ -727,6 +1240,7 @@ static iONode _getBlock( iOR2Rnet inst, const char* bkid ) {
       }
     }
     else {
+      data->openreq = NULL;
       TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "timeout on response event" );
     }
 
@@ -786,8 +1300,20 @@ static struct OR2Rnet* _inst( iONode ini ) {
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "R2Rnet multicast address [%s]", wR2RnetIni.getaddr(ini) );
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "R2Rnet multicast port    [%d]", wR2RnetIni.getport(ini) );
 
-  data->reqMux = MutexOp.inst( "r2rnetmux", True );
-  data->rspEvt = EventOp.inst( "r2rnetevt", True );
+  /* unnamed: named mutexes and events are process wide, and the bench runs several instances */
+  data->reqMux = MutexOp.inst( NULL, True );
+  data->peerMux = MutexOp.inst( NULL, True );
+  data->peers = MapOp.inst();
+  data->session = ((unsigned long)time(NULL) * 1000 + SystemOp.getMillis()) & 0xFFFFFFFFUL;
+  if( data->session == 0 )
+    data->session = 1;
+  data->rnd = data->session;
+  data->rspEvt = EventOp.inst( NULL, True );
+
+  __mRetransmits = MetricsOp.counter( "r2rnet_retransmits_total", "R2Rnet messages sent again." );
+  __mDuplicates  = MetricsOp.counter( "r2rnet_duplicates_total", "R2Rnet messages received twice." );
+  __mDropped     = MetricsOp.counter( "r2rnet_dropped_total", "R2Rnet messages given up after the retries." );
+  __mDelivered   = MetricsOp.counter( "r2rnet_delivered_total", "R2Rnet sequenced messages delivered in order." );
 
   data->readUDP = SocketOp.inst( wR2RnetIni.getaddr(ini), wR2RnetIni.getport(ini), False, True, True );
   SocketOp.bind(data->readUDP);
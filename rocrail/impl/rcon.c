@@ -33,10 +33,34 @@
 #include "rocs/public/mem.h"
 #include "rocs/public/str.h"
 #include "rocs/public/xmlh.h"
+#include "rocs/public/gzip.h"
+
+#include "rocrail/wrapper/public/ModelCmd.h"
 
 
 static int instCnt = 0;
 
+/* Compressed frames carry encoding and rawsize in the xmlh header. The
+   dictionary holds the node and attribute names seen most in the event
+   stream, the most frequent at the end; a new dictionary needs a new
+   encoding name so older peers fall back to plain frames. */
+static const char* encoding = "deflate1";
+static const char* dictionary =
+  " programming=\" sensorbus=\" accessorybus=\" needkey4loconet=\" iid=\""
+  " uid=\" volt=\" temp=\"<tk id=\"<sg id=\"<co id=\"<st id=\"<tx id=\""
+  "<model cmd=\"<exception text=\"<clock <sys cmd=\" x=\" y=\" z=\""
+  " ori=\" type=\" desc=\" text=\" level=\" divider=\" hour=\" minute=\""
+  " time=\" planversion=\" power=\" enablecom=\" trackbus=\" healthy=\""
+  " consolemode=\" val=\" bus=\" fbtype=\" identifier=\" counter=\""
+  " carcount=\" countedcars=\" wheelcount=\" maxload=\" addr1=\" port1=\""
+  " testing=\" fnchanged=\" f1=\" acceptident=\" load=\" cmd=\" V=\""
+  " dir=\" secaddr=\" placing=\" blockenterside=\" mode=\" resumeauto=\""
+  " manual=\" fn=\" runtime=\" mtime=\" mint=\" throttleid=\" active=\""
+  " scidx=\" scheduleid=\" tourid=\" train=\" trainlen=\" trainweight=\""
+  " V_realkmh=\" fifotop=\" switched=\" server=\" addr=\"<fn id=\""
+  "<lc id=\"<fb id=\"<bk id=\" state=\" id=\"<sw id=\"\"/>\n=\"false\""
+  "=\"true\"=\"0\"";
+
 /*
  ***** OBase functions.
  */
@@ -75,6 +99,8 @@ static void __del(void* inst) {
     ThreadOp.kill(data->infoReader);
   }
   ThreadOp.sleep(10);
+  GZipOp.base.del( data->gzip );
+  EvtCodecOp.base.del( data->codec );
   StrOp.free( data->host );
   freeMem( data );
   freeMem( inst );
@@ -118,6 +144,25 @@ static Boolean __readXmlh( iOSocket sh, iOXmlh xmlh ) {
 
 
 
+/**----------------------------------------------------------------------
+ * __reconnect()
+ * Events sent by the server while the connection was down are lost; the
+ * callback gets a reconnected model command to request the plan again.
+ * ----------------------------------------------------------------------
+ */
+static void __reconnect( iORConData o ) {
+  SocketOp.disConnect( o->sh );
+  ThreadOp.sleep( 1000 );
+  if( o->run && SocketOp.connect( o->sh ) && o->callback != NULL ) {
+    iONode cmd = NodeOp.inst( wModelCmd.name(), NULL, ELEMENT_NODE );
+    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "reconnected to %s:%d", o->host, o->port );
+    wModelCmd.setcmd( cmd, wModelCmd.reconnected );
+    o->callback( o->cbCargo, cmd );
+    cmd->base.del( cmd );
+  }
+}
+
+
 static void _infoReader( void* threadinst ) {
   iOThread th = (iOThread)threadinst;
   iORCon rcon = (iORCon)ThreadOp.getParm(th);
@@ -132,7 +177,10 @@ static void _infoReader( void* threadinst ) {
       if( SocketOp.isBroken( sock ) ) {
         TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999,
                     "__readSiHdr Socket errno=%d", SocketOp.getRc( sock ) );
-        break;
+        if( !o->run )
+          break;
+        __reconnect( o );
+        continue;
       }
       ThreadOp.sleep( 10 );
       continue;
@@ -143,12 +191,31 @@ static void _infoReader( void* threadinst ) {
       Boolean ok = False;
       /* Allocate read buffer: */
       long size = XmlhOp.getSizeByTagName( xmlh, XmlhOp.xml_tagname, 0 );
+      iONode hdr = XmlhOp.getNodeByTagName( xmlh, XmlhOp.xml_tagname, 0 );
       info = allocMem( size + 1 );
       info[0] = '\0';
       ok = SocketOp.read( sock, info, size );
 
+      if( ok && hdr != NULL && StrOp.equals( encoding, NodeOp.getStr( hdr, "encoding", "" ) ) ) {
+        char* raw = (char*)GZipOp.deCompress( o->gzip, (byte*)info, size, NodeOp.getInt( hdr, "rawsize", 0 ) );
+        freeMem( info );
+        info = raw;
+        if( info == NULL ) {
+          TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "could not inflate frame: rc=%d", GZipOp.getRc( o->gzip ) );
+          continue;
+        }
+      }
+
+      /* Binary events are decoded without the XML parser: */
+      if( ok && hdr != NULL && StrOp.equals( EvtCodecOp.getEncoding(), NodeOp.getStr( hdr, "encoding", "" ) ) ) {
+        iONode root = EvtCodecOp.decode( o->codec, (byte*)info, size );
+        if( root != NULL && o->callback != NULL )
+          o->callback( o->cbCargo, root );
+        if( root != NULL )
+          root->base.del( root );
+      }
       /* Call clallback: */
-      if( ok && o->callback != NULL ) {
+      else if( ok && o->callback != NULL ) {
         /* Try to parse the XML string: */
         iODoc infoDoc = DocOp.parse( info );
         iONode root = NULL;
@@ -187,9 +254,7 @@ static void _infoReader( void* threadinst ) {
     }
     else {
       TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "Close connection!" );
-      SocketOp.disConnect( o->sh );
-      ThreadOp.sleep( 1000 );
-      SocketOp.connect( o->sh );
+      __reconnect( o );
     }
 
     ThreadOp.sleep( 10 );
@@ -229,6 +294,10 @@ static Boolean _write( iORCon inst, char* cmdStr ) {
     /* Write string incl. terminating zero. */
     len = strlen( cmdStr ) + 1;
     NodeOp.setInt( node, "size", len );
+    /* offer compressed frames; an older server just ignores it */
+    if( RConOp.getEncoding() != NULL )
+      NodeOp.setStr( node, "accept", RConOp.getEncoding() );
+    NodeOp.setStr( node, "binschema", EvtCodecOp.getSchemaId() );
     XmlhOp.addNode( xmlh, node );
     xmlhStr = (char*)XmlhOp.base.serialize( xmlh, &hdrLen );
     XmlhOp.base.del( xmlh );
@@ -248,6 +317,14 @@ static Boolean _write( iORCon inst, char* cmdStr ) {
   }
 }
 
+static const char* _getEncoding( void ) {
+  return GZipOp.isAvailable() ? encoding:NULL;
+}
+
+static const char* _getDictionary( void ) {
+  return dictionary;
+}
+
 static iORCon _inst( const char* host, int port ) {
   iORCon     rcon = allocMem( sizeof( struct ORCon ) );
   iORConData data = allocMem( sizeof( struct ORConData ) );
@@ -258,6 +335,8 @@ static iORCon _inst( const char* host, int port ) {
   data->host = StrOp.dup(host);
   data->port = port;
   data->run = True;
+  data->gzip = GZipOp.inst( dictionary, 6 );
+  data->codec = EvtCodecOp.inst();
 
   data->sh = SocketOp.inst( host, port, False, False, False );
   if( !SocketOp.connect( data->sh ) ) {
@@ -0,0 +1,467 @@
+/*
+ Rocrail - Model Railroad Software
+
+ Copyright (C) 2002-2014 Rob Versluis, Rocrail.net
+
+
+
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+/*
+ A driver reserves its destination in several steps: block group, block, route
+ switches and crossing blocks. Between begin and end the manager lock is held,
+ so no other driver can take a part of the set while one driver is half way.
+ The parts locked through lockGroup, lockBlock and lockRoute in the bracket are
+ recorded, and a failed end releases them in reverse order: a set is taken by
+ one driver or rolled back before the next driver starts. Parts which the
+ train already held before begin are not recorded, so they are kept.
+
+ A train which fails waits for the resources of its set. Until the wait expires
+ another train with a lower priority, or with the same priority which started
+ waiting later, is deferred if its set overlaps. The trains holding a resource
+ are the blockers of a wait; a cycle of blockers is a deadlock, which is traced
+ and lifts the precedence of the trains in it.
+
+ Resource keys are "bk:" blocks, turntables, selection tables and crossing
+ blocks, "gp:" block groups, "rt:" routes and "sw:" locked switches.
+*/
+
+#include "rocrail/impl/reservation_impl.h"
+
+#include "rocrail/public/app.h"
+#include "rocrail/public/model.h"
+
+#include "rocs/public/mem.h"
+#include "rocs/public/str.h"
+#include "rocs/public/trace.h"
+#include "rocs/public/metrics.h"
+
+#include "rocrail/wrapper/public/Route.h"
+#include "rocrail/wrapper/public/SwitchCmd.h"
+
+static int instCnt = 0;
+
+static iOMutex __mux   = NULL;   /* held from a successful begin until its end */
+static iOMap   __waits = NULL;   /* lcid -> iOResWait */
+static iOList  __cur   = NULL;   /* resource keys of the reservation in progress */
+static iOList  __taken = NULL;   /* keys locked by the reservation in progress, to roll back */
+static unsigned long __curThread = 0;
+static int     __curPrio = 0;
+static unsigned long __curT0 = 0;
+
+/* metric ids */
+static int __mHold      = -1;
+static int __mDeferred  = -1;
+static int __mFailed    = -1;
+static int __mDeadlocks = -1;
+
+
+/** ----- OBase ----- */
+static void __del( void* inst ) {
+}
+
+static const char* __name( void ) {
+  return name;
+}
+
+static unsigned char* __serialize( void* inst, long* size ) {
+  return NULL;
+}
+
+static void __deserialize( void* inst,unsigned char* bytestream ) {
+}
+
+static char* __toString( void* inst ) {
+  return NULL;
+}
+
+static int __count( void ) {
+  return instCnt;
+}
+
+static struct OBase* __clone( void* inst ) {
+  return NULL;
+}
+
+static Boolean __equals( void* inst1, void* inst2 ) {
+  return False;
+}
+
+static void* __properties( void* inst ) {
+  return NULL;
+}
+
+static const char* __id( void* inst ) {
+  return NULL;
+}
+
+static void* __event( void* inst, const void* evt ) {
+  return NULL;
+}
+
+/** ----- OReservation ----- */
+
+static void __init( void ) {
+  if( __mux == NULL ) {
+    __mux   = MutexOp.inst( NULL, True );
+    __waits = MapOp.inst();
+    __mHold      = MetricsOp.histogram( "reservation_us", "Driver reservation, from begin to end, in microseconds." );
+    __mDeferred  = MetricsOp.counter( "reservations_deferred_total", "Reservations deferred to a waiting train with precedence." );
+    __mFailed    = MetricsOp.counter( "reservations_failed_total", "Reservations rolled back because a resource was taken." );
+    __mDeadlocks = MetricsOp.counter( "reservation_deadlocks_total", "Detected cycles of waiting trains." );
+  }
+}
+
+static unsigned long __now( void ) {
+  return MetricsOp.now() / 1000;
+}
+
+static void __freeList( iOList list ) {
+  int i = 0;
+  if( list == NULL )
+    return;
+  for( i = 0; i < ListOp.size( list ); i++ )
+    StrOp.free( (char*)ListOp.get( list, i ) );
+  ListOp.base.del( list );
+}
+
+static void __addKey( iOList list, const char* type, const char* id ) {
+  if( id != NULL && StrOp.len( id ) > 0 )
+    ListOp.add( list, (obj)StrOp.fmt( "%s:%s", type, id ) );
+}
+
+static Boolean __contains( iOList list, const char* str ) {
+  int i = 0;
+  for( i = 0; i < ListOp.size( list ); i++ ) {
+    if( StrOp.equals( str, (const char*)ListOp.get( list, i ) ) )
+      return True;
+  }
+  return False;
+}
+
+static Boolean __overlaps( iOList a, iOList b ) {
+  int i = 0;
+  for( i = 0; i < ListOp.size( a ); i++ ) {
+    if( __contains( b, (const char*)ListOp.get( a, i ) ) )
+      return True;
+  }
+  return False;
+}
+
+static iOList __resources( iOModel model, const char* bkid, const char* routeid ) {
+  iOList  res   = ListOp.inst();
+  iORoute route = routeid != NULL ? ModelOp.getRoute( model, routeid ):NULL;
+
+  __addKey( res, "bk", bkid );
+  __addKey( res, "gp", ModelOp.checkForBlockGroup( model, bkid ) );
+
+  if( route != NULL ) {
+    iONode props = (iONode)RouteOp.base.properties( route );
+    iONode sw = wRoute.getswcmd( props );
+    const char* bkc = wRoute.getbkc( props );
+
+    __addKey( res, "rt", routeid );
+    while( sw != NULL ) {
+      if( StrOp.equals( wSwitchCmd.cmd_track, wSwitchCmd.getcmd( sw ) ) )
+        __addKey( res, "bk", wSwitchCmd.getid( sw ) );
+      else if( wSwitchCmd.islock( sw ) )
+        __addKey( res, "sw", wSwitchCmd.getid( sw ) );
+      sw = wRoute.nextswcmd( props, sw );
+    }
+
+    if( bkc != NULL && StrOp.len( bkc ) > 0 ) {
+      iOStrTok tok = StrTokOp.inst( bkc, ',' );
+      while( StrTokOp.hasMoreTokens( tok ) )
+        __addKey( res, "bk", StrTokOp.nextToken( tok ) );
+      StrTokOp.base.del( tok );
+    }
+  }
+
+  return res;
+}
+
+/* Train which holds the resource; block groups are held through their blocks. */
+static const char* __owner( iOModel model, const char* key ) {
+  const char* id = key + 3;
+
+  if( StrOp.startsWith( key, "bk:" ) ) {
+    iIBlockBase bk = ModelOp.getBlock( model, id );
+    return bk != NULL ? bk->getLoc( bk ):NULL;
+  }
+  if( StrOp.startsWith( key, "rt:" ) ) {
+    iORoute route = ModelOp.getRoute( model, id );
+    return route != NULL ? RouteOp.getLockedId( route ):NULL;
+  }
+  if( StrOp.startsWith( key, "sw:" ) ) {
+    iOSwitch sw = ModelOp.getSwitch( model, id );
+    return sw != NULL ? SwitchOp.getLockedId( sw ):NULL;
+  }
+  return NULL;
+}
+
+static void __freeWait( iOResWait w ) {
+  StrOp.free( w->lcid );
+  __freeList( w->resources );
+  __freeList( w->blockers );
+  freeMem( w );
+}
+
+static void __dropWait( const char* lcid ) {
+  iOResWait w = (iOResWait)MapOp.remove( __waits, lcid );
+  if( w != NULL )
+    __freeWait( w );
+}
+
+/* Takes over the resources and blockers lists. */
+static iOResWait __wait( const char* lcid, int prio, iOList resources, iOList blockers, unsigned long now ) {
+  iOResWait w = (iOResWait)MapOp.get( __waits, lcid );
+
+  if( w == NULL ) {
+    w = allocMem( sizeof( struct ResWait ) );
+    w->lcid  = StrOp.dup( lcid );
+    w->since = now;
+    MapOp.put( __waits, lcid, (obj)w );
+  }
+  __freeList( w->resources );
+  __freeList( w->blockers );
+  w->prio      = prio;
+  w->renewed   = now;
+  w->resources = resources;
+  w->blockers  = blockers;
+  return w;
+}
+
+static void __expire( unsigned long now ) {
+  iOList waits = MapOp.getList( __waits );
+  int i = 0;
+  for( i = 0; i < ListOp.size( waits ); i++ ) {
+    iOResWait w = (iOResWait)ListOp.get( waits, i );
+    if( now - w->renewed > ReservationOp.waitttl ) {
+      TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "wait of [%s] expired", w->lcid );
+      __dropWait( w->lcid );
+    }
+  }
+  ListOp.base.del( waits );
+}
+
+/* True if train from waits for target, directly or through other waiting trains; path gets " -> id" per step. */
+static Boolean __reaches( const char* from, const char* target, iOMap visited, char** path ) {
+  iOResWait w = (iOResWait)MapOp.get( __waits, from );
+  int i = 0;
+
+  if( w == NULL || MapOp.haskey( visited, from ) )
+    return False;
+  MapOp.put( visited, from, (obj)w );
+
+  for( i = 0; i < ListOp.size( w->blockers ); i++ ) {
+    const char* blocker = (const char*)ListOp.get( w->blockers, i );
+    if( StrOp.equals( blocker, target ) || __reaches( blocker, target, visited, path ) ) {
+      if( path != NULL ) {
+        char* p = StrOp.fmt( " -> %s%s", blocker, *path );
+        StrOp.free( *path );
+        *path = p;
+      }
+      return True;
+    }
+  }
+  return False;
+}
+
+/* Precedence: a lower priority value first, then the longest waiting. */
+static Boolean __precedes( iOResWait w, int prio, unsigned long since ) {
+  if( w->prio != prio )
+    return w->prio < prio;
+  return w->since < since;
+}
+
+
+static Boolean _begin( const char* lcid, int prio, const char* bkid, const char* routeid ) {
+  iOModel model = AppOp.getModel();
+  unsigned long now = __now();
+  iOList res = NULL;
+  iOList waits = NULL;
+  iOResWait mine = NULL;
+  iOResWait first = NULL;
+  int i = 0;
+
+  if( model == NULL || lcid == NULL )
+    return True;
+
+  __init();
+  res = __resources( model, bkid, routeid );
+
+  MutexOp.wait( __mux );
+  __expire( now );
+  mine = (iOResWait)MapOp.get( __waits, lcid );
+
+  waits = MapOp.getList( __waits );
+  for( i = 0; i < ListOp.size( waits ) && first == NULL; i++ ) {
+    iOResWait w = (iOResWait)ListOp.get( waits, i );
+    if( w != mine && !w->deadlock && now - w->since < ReservationOp.precedence &&
+        __precedes( w, prio, mine != NULL ? mine->since:now ) && __overlaps( w->resources, res ) )
+    {
+      /* deferring to a train which waits for this one would close a cycle */
+      iOMap visited = MapOp.inst();
+      if( !__reaches( w->lcid, lcid, visited, NULL ) )
+        first = w;
+      MapOp.base.del( visited );
+    }
+  }
+  ListOp.base.del( waits );
+
+  if( first != NULL ) {
+    iOList blockers = ListOp.inst();
+    TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "reservation of [%s] for [%s] deferred to waiting [%s]",
+        bkid, lcid, first->lcid );
+    ListOp.add( blockers, (obj)StrOp.dup( first->lcid ) );
+    __wait( lcid, prio, res, blockers, now );
+    MutexOp.post( __mux );
+    MetricsOp.add( __mDeferred, 1 );
+    return False;
+  }
+
+  __cur       = res;
+  __taken     = ListOp.inst();
+  __curThread = ThreadOp.id();
+  __curPrio   = prio;
+  __curT0     = MetricsOp.now();
+  return True;
+}
+
+
+/* Records a part newly locked in the bracket of the calling thread. */
+static void __take( const char* type, const char* id ) {
+  if( __taken != NULL && __curThread == ThreadOp.id() )
+    __addKey( __taken, type, id );
+}
+
+/* Releases the recorded parts, the last locked first. */
+static void __rollback( iOModel model, const char* lcid ) {
+  int i = 0;
+  for( i = ListOp.size( __taken ) - 1; i >= 0; i-- ) {
+    const char* key = (const char*)ListOp.get( __taken, i );
+    const char* id  = key + 3;
+    TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "rollback [%s] of [%s]", key, lcid );
+    if( StrOp.startsWith( key, "rt:" ) ) {
+      iORoute route = ModelOp.getRoute( model, id );
+      if( route != NULL )
+        RouteOp.unLock( route, lcid, NULL, True, False );
+    }
+    else if( StrOp.startsWith( key, "bk:" ) ) {
+      iIBlockBase bk = ModelOp.getBlock( model, id );
+      if( bk != NULL )
+        bk->unLock( bk, lcid, NULL );
+    }
+    else if( StrOp.startsWith( key, "gp:" ) )
+      ModelOp.unlockBlockGroup( model, id, lcid );
+  }
+}
+
+
+static Boolean _lockGroup( const char* lcid, const char* group, const char* bkid ) {
+  iOModel model = AppOp.getModel();
+  Boolean held = ModelOp.isBlockGroupLockedForLoco( model, bkid, lcid );
+  if( !ModelOp.lockBlockGroup( model, group, bkid, lcid ) )
+    return False;
+  if( !held )
+    __take( "gp", group );
+  return True;
+}
+
+
+static Boolean _lockBlock( const char* lcid, iIBlockBase block, const char* from, const char* routeid,
+    Boolean crossing, Boolean reset, Boolean reverse, int indelay ) {
+  Boolean held = StrOp.equals( lcid, block->getLoc( block ) );
+  if( !block->lock( block, lcid, from, routeid, crossing, reset, reverse, indelay ) )
+    return False;
+  if( !held )
+    __take( "bk", block->base.id( block ) );
+  return True;
+}
+
+
+static Boolean _lockRoute( const char* lcid, iORoute route, Boolean reverse, Boolean lockswitches ) {
+  Boolean held = StrOp.equals( lcid, RouteOp.getLockedId( route ) );
+  if( !RouteOp.lock( route, lcid, reverse, lockswitches ) )
+    return False;
+  if( !held )
+    __take( "rt", RouteOp.base.id( route ) );
+  return True;
+}
+
+
+static void _end( const char* lcid, Boolean ok ) {
+  iOModel model = AppOp.getModel();
+
+  if( model == NULL || lcid == NULL || __cur == NULL )
+    return;
+
+  if( ok ) {
+    __dropWait( lcid );
+    __freeList( __cur );
+  }
+  else {
+    iOList blockers = ListOp.inst();
+    iOResWait w = NULL;
+    iOMap visited = MapOp.inst();
+    char* path = StrOp.dup( "" );
+    Boolean deadlock = False;
+    int i = 0;
+
+    __rollback( model, lcid );
+
+    for( i = 0; i < ListOp.size( __cur ); i++ ) {
+      const char* owner = __owner( model, (const char*)ListOp.get( __cur, i ) );
+      if( owner != NULL && StrOp.len( owner ) > 0 && !StrOp.equals( owner, lcid ) && !__contains( blockers, owner ) )
+        ListOp.add( blockers, (obj)StrOp.dup( owner ) );
+    }
+
+    w = __wait( lcid, __curPrio, __cur, blockers, __now() );
+    deadlock = __reaches( lcid, lcid, visited, &path );
+    MapOp.base.del( visited );
+
+    if( deadlock && !w->deadlock ) {
+      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "deadlock: %s%s", lcid, path );
+      MetricsOp.add( __mDeadlocks, 1 );
+    }
+    w->deadlock = deadlock;
+    StrOp.free( path );
+    MetricsOp.add( __mFailed, 1 );
+  }
+
+  __freeList( __taken );
+  __taken = NULL;
+  __curThread = 0;
+  __cur = NULL;
+  MetricsOp.since( __mHold, __curT0 );
+  MutexOp.post( __mux );
+}
+
+
+static void _cancel( const char* lcid ) {
+  if( __mux == NULL || lcid == NULL )
+    return;
+
+  MutexOp.wait( __mux );
+  __dropWait( lcid );
+  MutexOp.post( __mux );
+}
+
+
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
+#include "rocrail/impl/reservation.fm"
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
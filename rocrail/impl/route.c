@@ -1221,6 +1221,12 @@ static Boolean _isLocked( iORoute inst ) {
 }
 
 
+static const char* _getLockedId( iORoute inst ) {
+  iORouteData data = Data(inst);
+  return data->lockedId;
+}
+
+
 static Boolean _isClosed( iORoute inst ) {
   iORouteData data = Data(inst);
 
@@ -0,0 +1,656 @@
+/*
+ Rocrail - Model Railroad Software
+
+ Copyright (C) 2002-2014 Rob Versluis, Rocrail.net
+
+
+
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+
+/*
+ Virtual trains are moved along their routes by one engine thread instead of
+ the per loco virtual step timer.
+
+ A run starts when a virtual loco has speed and a destination: the head
+ travels ctrl simroutelen to the destination block and then the block length
+ to its end. The sensors of the block, chosen as the block itself chooses its
+ fbevents (by route and from block, from block, all or all-reverse), go on as
+ the head passes them and off as the tail clears them. Enter type sensors lie
+ at the start of the block, in sensors at its end and others half way. A block
+ without sensors gets the enter2in event of the virtual step at its end.
+
+ The sensor states are given to the model as sensor events, like the
+ command station listener does; nothing is sent to the command station.
+
+ The speed is the loco speed of its driver: km/h, or percent of the loco
+ V_max at its V_maxkmh (ctrl simmaxkmh if it has none). Percent mode locos
+ with a V_step change it by 10% every V_step tenths of a second like the
+ loco runner. It is scaled by ctrl simscale and varied per run by ctrl
+ simjitter from a xorshift seeded with ctrl simseed and the loco id. Model time runs
+ ctrl simaccel times faster than real time in fixed steps, so a seed gives
+ the same movement for the same driver commands.
+*/
+
+#include <string.h>
+
+#include "rocrail/impl/sim_impl.h"
+
+#include "rocrail/public/app.h"
+#include "rocrail/public/model.h"
+#include "rocrail/public/loc.h"
+#include "rocrail/public/fback.h"
+#include "rocrail/public/route.h"
+
+#include "rocs/public/mem.h"
+#include "rocs/public/str.h"
+#include "rocs/public/trace.h"
+#include "rocs/public/metrics.h"
+
+#include "rocrail/wrapper/public/Ctrl.h"
+#include "rocrail/wrapper/public/Plan.h"
+#include "rocrail/wrapper/public/Loc.h"
+#include "rocrail/wrapper/public/Block.h"
+#include "rocrail/wrapper/public/SelTab.h"
+#include "rocrail/wrapper/public/Route.h"
+#include "rocrail/wrapper/public/RouteList.h"
+#include "rocrail/wrapper/public/Feedback.h"
+#include "rocrail/wrapper/public/FeedbackEvent.h"
+
+static int instCnt = 0;
+
+/* metric ids */
+static int __mRun    = -1;
+static int __mEvents = -1;
+static int __mTrains = -1;
+
+
+/** ----- OBase ----- */
+static void __del( void* inst ) {
+  if( inst != NULL ) {
+    iOSimData data = Data(inst);
+    MutexOp.base.del( data->mux );
+    ListOp.base.del( data->trains );
+    freeMem( data );
+    freeMem( inst );
+    instCnt--;
+  }
+  return;
+}
+
+static const char* __name( void ) {
+  return name;
+}
+
+static unsigned char* __serialize( void* inst, long* size ) {
+  return NULL;
+}
+
+static void __deserialize( void* inst,unsigned char* bytestream ) {
+}
+
+static char* __toString( void* inst ) {
+  return NULL;
+}
+
+static int __count( void ) {
+  return instCnt;
+}
+
+static struct OBase* __clone( void* inst ) {
+  return NULL;
+}
+
+static Boolean __equals( void* inst1, void* inst2 ) {
+  return False;
+}
+
+static void* __properties( void* inst ) {
+  iOSimData data = Data(inst);
+  return data->props;
+}
+
+static const char* __id( void* inst ) {
+  return NULL;
+}
+
+static void* __event( void* inst, const void* evt ) {
+  return NULL;
+}
+
+/** ----- OSim ----- */
+
+
+/* xorshift; the C library rand() differs per platform */
+static int __rand( iOSimTrain t, int range ) {
+  unsigned long x = t->rnd;
+  x ^= ( x << 13 ) & 0xFFFFFFFFUL;
+  x ^= x >> 17;
+  x ^= ( x << 5 ) & 0xFFFFFFFFUL;
+  t->rnd = x & 0xFFFFFFFFUL;
+  return range > 0 ? (int)( t->rnd % range ):0;
+}
+
+
+static void __freeMark( iOSimMark m ) {
+  StrOp.free( m->fbid );
+  StrOp.free( m->bkid );
+  freeMem( m );
+}
+
+
+static void __freeTrain( iOSimTrain t ) {
+  while( ListOp.size( t->marks ) > 0 )
+    __freeMark( (iOSimMark)ListOp.remove( t->marks, 0 ) );
+  ListOp.base.del( t->marks );
+  StrOp.free( t->segbk );
+  StrOp.free( t->lcid );
+  freeMem( t );
+}
+
+
+static void __addEvent( iOList due, const char* fbid, const char* bkid, const char* lcid, Boolean state, Boolean stop ) {
+  iOSimEvent e = allocMem( sizeof( struct SimEvent ) );
+  e->fbid  = fbid != NULL ? StrOp.dup( fbid ):NULL;
+  e->bkid  = bkid != NULL ? StrOp.dup( bkid ):NULL;
+  e->lcid  = StrOp.dup( lcid );
+  e->state = state;
+  e->stop  = stop;
+  ListOp.add( due, (obj)e );
+}
+
+
+/* Keep the marks in head position order. */
+static void __addMark( iOSimTrain t, const char* fbid, const char* bkid, long on, long off ) {
+  iOSimMark m = allocMem( sizeof( struct SimMark ) );
+  int i = 0;
+  m->fbid = fbid != NULL ? StrOp.dup( fbid ):NULL;
+  m->bkid = StrOp.dup( bkid );
+  m->on   = on;
+  m->off  = off;
+  for( i = 0; i < ListOp.size( t->marks ); i++ ) {
+    if( ((iOSimMark)ListOp.get( t->marks, i ))->on > on )
+      break;
+  }
+  ListOp.insert( t->marks, i, (obj)m );
+}
+
+
+/* The route from -> to locked for the loco, if any. */
+static iORoute __route( iOModel model, const char* lcid, const char* from, const char* to ) {
+  iONode stlist = wPlan.getstlist( ModelOp.getModel( model ) );
+  iONode st = stlist != NULL ? wRouteList.getst( stlist ):NULL;
+  while( st != NULL ) {
+    if( ( StrOp.equals( from, wRoute.getbka( st ) ) && StrOp.equals( to, wRoute.getbkb( st ) ) ) ||
+        ( StrOp.equals( to, wRoute.getbka( st ) ) && StrOp.equals( from, wRoute.getbkb( st ) ) ) )
+    {
+      iORoute route = ModelOp.getRoute( model, wRoute.getid( st ) );
+      if( route != NULL && StrOp.equals( lcid, RouteOp.getLockedId( route ) ) )
+        return route;
+    }
+    st = wRouteList.nextst( stlist, st );
+  }
+  return NULL;
+}
+
+
+static Boolean __isEnter( const char* action ) {
+  return StrOp.startsWith( action, wFeedbackEvent.enter_event ) || StrOp.equals( action, wFeedbackEvent.occupied_event );
+}
+
+
+/* Position of a sensor in a block of len mm; -1 for events the head does not cause. */
+static long __position( const char* action, long len ) {
+  if( __isEnter( action ) )
+    return 0;
+  if( StrOp.equals( action, wFeedbackEvent.in_event ) )
+    return len;
+  if( StrOp.equals( action, wFeedbackEvent.exit_event ) || StrOp.equals( action, wFeedbackEvent.free_event ) )
+    return -1;
+  return len / 2;
+}
+
+
+/**
+ * Rank the fbevents of the block for one run like the block dispatch table:
+ * by route and from block before from block before all or all-reverse.
+ * Returns the number of marks added.
+ */
+static int __sensors( iOSimTrain t, iONode props, const char* bkid, const char* from, iORoute route, long start, long len, long trainlen ) {
+  const char* routeid = route != NULL ? RouteOp.getId( route ):NULL;
+  const char* all = ( route != NULL && RouteOp.getToBlockSide( route ) ) ? wFeedbackEvent.from_all:wFeedbackEvent.from_all_reverse;
+  iOMap best = MapOp.inst();
+  iOMap rank = MapOp.inst();
+  iONode fbevt = NodeOp.findNode( props, wFeedbackEvent.name() );
+  iOList ids = NULL;
+  int cnt = 0;
+  int i = 0;
+
+  while( fbevt != NULL ) {
+    const char* fbid = wFeedbackEvent.getid( fbevt );
+    const char* byroute = wFeedbackEvent.getbyroute( fbevt );
+    Boolean hasroute = byroute != NULL && StrOp.len( byroute ) > 0 &&
+        !StrOp.equals( wFeedbackEvent.from_all, byroute ) && !StrOp.equals( wFeedbackEvent.from_all_reverse, byroute );
+    iOStrTok tok = StrTokOp.inst( wFeedbackEvent.getfrom( fbevt ), ',' );
+    int r = 0;
+
+    while( StrTokOp.hasMoreTokens( tok ) ) {
+      const char* fromblockid = StrTokOp.nextToken( tok );
+      if( hasroute ) {
+        if( StrOp.equals( byroute, routeid ) && StrOp.equals( fromblockid, from ) && r < 3 )
+          r = 3;
+      }
+      else if( StrOp.equals( fromblockid, from ) && r < 2 )
+        r = 2;
+      else if( StrOp.equals( fromblockid, all ) && r < 1 )
+        r = 1;
+    }
+    StrTokOp.base.del( tok );
+
+    if( r > 0 && StrOp.len( fbid ) > 0 && r > (int)(long)MapOp.get( rank, fbid ) ) {
+      MapOp.put( rank, fbid, (obj)(long)r );
+      MapOp.put( best, fbid, (obj)fbevt );
+    }
+    fbevt = NodeOp.findNextNode( props, fbevt );
+  }
+
+  ids = MapOp.getList( best );
+  for( i = 0; i < ListOp.size( ids ); i++ ) {
+    iONode evt = (iONode)ListOp.get( ids, i );
+    long pos = __position( wFeedbackEvent.getaction( evt ), len );
+    if( pos >= 0 ) {
+      __addMark( t, wFeedbackEvent.getid( evt ), bkid, start + pos, start + pos + trainlen );
+      cnt++;
+    }
+  }
+  ListOp.base.del( ids );
+  MapOp.base.del( rank );
+  MapOp.base.del( best );
+  return cnt;
+}
+
+
+/* Start a run of the head from the end of block from to the end of block to. */
+static void __segment( iOSim inst, iOSimTrain t, iOLoc loc, const char* from, const char* to, iOList due ) {
+  iOSimData data = Data(inst);
+  iOModel model = AppOp.getModel();
+  iIBlockBase block = ModelOp.getBlock( model, to );
+  iONode props = block != NULL ? block->base.properties( block ):NULL;
+  int jitter = wCtrl.getsimjitter( data->props );
+  long base = t->segbk != NULL ? t->segend:t->head;
+  long start = base + wCtrl.getsimroutelen( data->props ) * 10;
+  long len = props != NULL ? wBlock.getlen( props ) * 10:0;
+  long trainlen = LocOp.getLen( loc ) * 10;
+  int sensors = 0;
+
+  if( len <= 0 )
+    len = wCtrl.getsimblocklen( data->props ) * 10;
+  if( trainlen <= 0 )
+    trainlen = 10;
+
+  StrOp.free( t->segbk );
+  t->segbk  = StrOp.dup( to );
+  t->segend = start + len;
+  t->factor = 100;
+  if( jitter > 0 )
+    t->factor = 100 - jitter + __rand( t, 2 * jitter + 1 );
+
+  if( props != NULL )
+    sensors = __sensors( t, props, to, from, __route( model, t->lcid, from, to ), start, len, trainlen );
+
+  if( sensors == 0 ) {
+    if( props != NULL && ( StrOp.equals( wBlock.name(), NodeOp.getName( props ) ) || StrOp.equals( wSelTab.name(), NodeOp.getName( props ) ) ) ) {
+      __addMark( t, NULL, to, t->segend, t->segend );
+    }
+    else {
+      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "block [%s] cannot be simulated for loco [%s]", to, t->lcid );
+      __addEvent( due, NULL, to, t->lcid, False, True );
+    }
+  }
+
+  TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "sim [%s] runs from [%s] to [%s]: %ld mm at %d%%, %d sensors",
+      t->lcid, from, to, t->segend - t->head, t->factor, sensors );
+}
+
+
+/* Track speed in um per ms, which is mm/s, of the loco speed V. */
+static long __speed( iOSim inst, iONode props, int V ) {
+  iOSimData data = Data(inst);
+  long kmh = V;
+  int scale = wCtrl.getsimscale( data->props );
+
+  if( kmh <= 0 )
+    return 0;
+  if( !StrOp.equals( wLoc.V_mode_kmh, wLoc.getV_mode( props ) ) ) {
+    if( wLoc.getV_maxkmh( props ) > 0 && wLoc.getV_max( props ) > 0 )
+      kmh = kmh * wLoc.getV_maxkmh( props ) / wLoc.getV_max( props );
+    else
+      kmh = kmh * wCtrl.getsimmaxkmh( data->props ) / 100;
+  }
+  return kmh * 1000000L / 3600L / ( scale > 0 ? scale:87 );
+}
+
+
+/* The loco speed after one step towards the driver speed V; see the percent mode steps of the loco runner. */
+static int __ramp( iOSimTrain t, iONode props, int V ) {
+  int vstep = wLoc.getV_step( props ) * 100;
+
+  if( vstep <= 0 || wLoc.isregulated( props ) || !StrOp.equals( wLoc.V_mode_percent, wLoc.getV_mode( props ) ) ) {
+    t->v = V;
+    t->ramp = 0;
+    return t->v;
+  }
+
+  t->ramp += SimOp.step;
+  while( t->ramp >= vstep && t->v != V ) {
+    int dif = V - t->v;
+    t->v += dif > 10 ? 10:( dif < -10 ? -10:dif );
+    t->ramp -= vstep;
+  }
+  if( t->v == V )
+    t->ramp = 0;
+  return t->v;
+}
+
+
+/* Move the train one step; due gets the sensor events it causes. */
+static void __step( iOSim inst, iOSimTrain t, iOLoc loc, int V, const char* dest, iOList due ) {
+  iONode props = LocOp.base.properties( loc );
+  long speed = __speed( inst, props, __ramp( t, props, V ) );
+  int i = 0;
+
+  if( t->segbk == NULL || t->head >= t->segend ) {
+    const char* from = t->segbk != NULL ? t->segbk:LocOp.getCurBlock( loc );
+    if( speed > 0 && dest != NULL && from != NULL && StrOp.len( dest ) > 0 && !StrOp.equals( dest, from ) ) {
+      char* fromid = StrOp.dup( from );
+      __segment( inst, t, loc, fromid, dest, due );
+      StrOp.free( fromid );
+    }
+    else if( speed == 0 && t->segbk != NULL ) {
+      /* stopped in its destination */
+      StrOp.free( t->segbk );
+      t->segbk = NULL;
+    }
+  }
+
+  if( t->segbk == NULL || speed == 0 )
+    return;
+
+  t->um += speed * t->factor / 100 * SimOp.step;
+  t->head += t->um / 1000;
+  t->um %= 1000;
+
+  /* wait at the end of the block until the driver stops or has a next destination */
+  if( t->head > t->segend && ( dest == NULL || StrOp.equals( dest, t->segbk ) ) ) {
+    t->head = t->segend;
+    t->um = 0;
+  }
+
+  while( i < ListOp.size( t->marks ) ) {
+    iOSimMark m = (iOSimMark)ListOp.get( t->marks, i );
+    if( !m->sent && t->head >= m->on ) {
+      __addEvent( due, m->fbid, m->bkid, t->lcid, True, False );
+      m->sent = True;
+    }
+    if( m->sent && ( m->fbid == NULL || t->head >= m->off ) ) {
+      if( m->fbid != NULL )
+        __addEvent( due, m->fbid, m->bkid, t->lcid, False, False );
+      ListOp.remove( t->marks, i );
+      __freeMark( m );
+    }
+    else if( !m->sent )
+      break;
+    else
+      i++;
+  }
+}
+
+
+static void __emit( iOSimEvent e ) {
+  iOModel model = AppOp.getModel();
+
+  if( e->stop ) {
+    iOLoc loc = ModelOp.getLoc( model, e->lcid, NULL, False );
+    if( loc != NULL ) {
+      iONode cmd = NodeOp.inst( wLoc.name(), NULL, ELEMENT_NODE );
+      wLoc.setid( cmd, e->lcid );
+      wLoc.setcmd( cmd, wLoc.stop );
+      LocOp.cmd( loc, cmd );
+    }
+  }
+  else if( e->fbid != NULL ) {
+    iOFBack fb = ModelOp.getFBack( model, e->fbid );
+    if( fb != NULL ) {
+      /* as from the listener of the command station; the model deletes it */
+      iONode props = FBackOp.base.properties( fb );
+      iONode evt = NodeOp.inst( wFeedback.name(), NULL, ELEMENT_NODE );
+      wFeedback.setid( evt, e->fbid );
+      wFeedback.setbus( evt, wFeedback.getbus( props ) );
+      wFeedback.setaddr( evt, wFeedback.getaddr( props ) );
+      if( wFeedback.getiid( props ) != NULL )
+        wFeedback.setiid( evt, wFeedback.getiid( props ) );
+      wFeedback.setstate( evt, e->state );
+      TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "sim [%s] sensor [%s] %s", e->lcid, e->fbid, e->state?"on":"off" );
+      ModelOp.event( model, evt );
+      MetricsOp.add( __mEvents, 1 );
+    }
+  }
+  else {
+    iIBlockBase block = ModelOp.getBlock( model, e->bkid );
+    if( block != NULL ) {
+      iONode fbevt = NodeOp.inst( wFeedbackEvent.name(), NULL, ELEMENT_NODE );
+      wFeedbackEvent.setid( fbevt, e->lcid );
+      wFeedbackEvent.setaction( fbevt, wFeedbackEvent.enter2in_event );
+      TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "sim [%s] virtual event to [%s]", e->lcid, e->bkid );
+      block->event( block, True, "enter", NULL, NULL, NULL, NULL, 0, 0, fbevt, True );
+      NodeOp.base.del( fbevt );
+      MetricsOp.add( __mEvents, 1 );
+    }
+  }
+
+  StrOp.free( e->fbid );
+  StrOp.free( e->bkid );
+  StrOp.free( e->lcid );
+  freeMem( e );
+}
+
+
+/* Run steps for all trains in loco id order; the events are sent after the lock. */
+static void __run( iOSim inst, int steps ) {
+  iOSimData data = Data(inst);
+  iOModel model = AppOp.getModel();
+  unsigned long t0 = MetricsOp.now();
+  iOList due = ListOp.inst();
+  int cnt = 0;
+  iOLoc* locs = NULL;
+  int* speeds = NULL;
+  const char** dests = NULL;
+  int i = 0;
+  int s = 0;
+
+  MutexOp.wait( data->mux );
+
+  /* drop the trains which left virtual mode */
+  while( i < ListOp.size( data->trains ) ) {
+    iOSimTrain t = (iOSimTrain)ListOp.get( data->trains, i );
+    iOLoc loc = ModelOp.getLoc( model, t->lcid, NULL, False );
+    if( loc == NULL || !LocOp.isVirtual( loc ) ) {
+      TraceOp.trc( name, TRCLEVEL_USER1, __LINE__, 9999, "sim [%s] ended", t->lcid );
+      ListOp.remove( data->trains, i );
+      __freeTrain( t );
+    }
+    else
+      i++;
+  }
+
+  cnt = ListOp.size( data->trains );
+  if( cnt > 0 ) {
+    locs   = allocMem( cnt * sizeof( iOLoc ) );
+    speeds = allocMem( cnt * sizeof( int ) );
+    dests  = allocMem( cnt * sizeof( const char* ) );
+    for( i = 0; i < cnt; i++ ) {
+      iOSimTrain t = (iOSimTrain)ListOp.get( data->trains, i );
+      locs[i]   = ModelOp.getLoc( model, t->lcid, NULL, False );
+      speeds[i] = LocOp.getV( locs[i] );
+      dests[i]  = LocOp.getDestination( locs[i] );
+    }
+
+    for( s = 0; s < steps; s++ ) {
+      for( i = 0; i < cnt; i++ )
+        __step( inst, (iOSimTrain)ListOp.get( data->trains, i ), locs[i], speeds[i], dests[i], due );
+    }
+
+    freeMem( locs );
+    freeMem( speeds );
+    freeMem( dests );
+  }
+
+  MutexOp.post( data->mux );
+
+  for( i = 0; i < ListOp.size( due ); i++ )
+    __emit( (iOSimEvent)ListOp.get( due, i ) );
+  ListOp.base.del( due );
+
+  MetricsOp.set( __mTrains, cnt );
+  MetricsOp.since( __mRun, t0 );
+}
+
+
+static void __engine( void* threadinst ) {
+  iOThread th = (iOThread)threadinst;
+  iOSim    sim = (iOSim)ThreadOp.getParm( th );
+  iOSimData data = Data(sim);
+  unsigned long last = MetricsOp.now();
+  long owed = 0; /* model time in us */
+  long maxowed = 1000L * 1000L;
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "simulation started at %dx real time", data->accel );
+
+  while( data->run ) {
+    unsigned long now = 0;
+    int steps = 0;
+
+    ThreadOp.sleep( SimOp.cycle );
+
+    now = MetricsOp.now();
+    owed += (long)( now - last ) * data->accel;
+    last = now;
+
+    /* never catch up more than a second of model time */
+    if( owed > maxowed ) {
+      TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "simulation is %ld ms behind", ( owed - maxowed ) / 1000 );
+      owed = maxowed;
+    }
+
+    steps = (int)( owed / ( SimOp.step * 1000 ) );
+    owed -= (long)steps * SimOp.step * 1000;
+
+    if( steps > 0 && AppOp.getModel() != NULL )
+      __run( sim, steps );
+  }
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "simulation ended" );
+}
+
+
+static Boolean _isActive( iOSim inst ) {
+  return inst != NULL && Data(inst)->accel > 0;
+}
+
+
+static Boolean _add( iOSim inst, const char* lcid ) {
+  iOSimData data = NULL;
+  iOSimTrain t = NULL;
+  unsigned long h = 2166136261UL;
+  const char* p = lcid;
+  int i = 0;
+
+  if( !SimOp.isActive( inst ) || lcid == NULL )
+    return False;
+  data = Data(inst);
+
+  MutexOp.wait( data->mux );
+  for( i = 0; i < ListOp.size( data->trains ); i++ ) {
+    iOSimTrain o = (iOSimTrain)ListOp.get( data->trains, i );
+    int c = strcmp( o->lcid, lcid );
+    if( c == 0 ) {
+      MutexOp.post( data->mux );
+      return True;
+    }
+    if( c > 0 )
+      break;
+  }
+
+  t = allocMem( sizeof( struct SimTrain ) );
+  t->lcid = StrOp.dup( lcid );
+  t->marks = ListOp.inst();
+  while( *p != '\0' ) {
+    h = ( ( h ^ (unsigned char)*p++ ) * 16777619UL ) & 0xFFFFFFFFUL;
+  }
+  t->rnd = ( ( (unsigned long)data->seed * 2654435761UL ) ^ h ) & 0xFFFFFFFFUL;
+  if( t->rnd == 0 )
+    t->rnd = 1;
+  ListOp.insert( data->trains, i, (obj)t );
+  MutexOp.post( data->mux );
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "sim [%s] added", lcid );
+  return True;
+}
+
+
+static void _halt( iOSim inst ) {
+  iOSimData data = NULL;
+  if( inst == NULL )
+    return;
+  data = Data(inst);
+  if( data->engine != NULL ) {
+    data->run = False;
+    ThreadOp.sleep( 2 * SimOp.cycle );
+  }
+}
+
+
+static struct OSim* _inst( iONode ini ) {
+  iOSim __Sim = allocMem( sizeof( struct OSim ) );
+  iOSimData data = allocMem( sizeof( struct OSimData ) );
+  MemOp.basecpy( __Sim, &SimOp, 0, sizeof( struct OSim ), data );
+
+  data->props  = ini;
+  data->accel  = ini != NULL ? wCtrl.getsimaccel( ini ):0;
+  data->seed   = ini != NULL ? wCtrl.getsimseed( ini ):1;
+  data->mux    = MutexOp.inst( NULL, True );
+  data->trains = ListOp.inst();
+
+  if( __mRun == -1 ) {
+    __mRun    = MetricsOp.histogram( "sim_run_us", "Simulation engine run over all trains in microseconds." );
+    __mEvents = MetricsOp.counter( "sim_events_total", "Sensor events caused by simulated trains." );
+    __mTrains = MetricsOp.gauge( "sim_trains", "Simulated trains." );
+  }
+
+  if( data->accel > 0 ) {
+    data->run = True;
+    data->engine = ThreadOp.inst( "simulation", __engine, __Sim );
+    ThreadOp.start( data->engine );
+  }
+
+  instCnt++;
+  return __Sim;
+}
+
+
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
+#include "rocrail/impl/sim.fm"
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
@@ -21,6 +21,9 @@
  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "rocrail/impl/snmp_impl.h"
 #include "rocrail/public/app.h"
 
@@ -29,6 +32,7 @@
 #include "rocs/public/str.h"
 #include "rocs/public/strtok.h"
 #include "rocs/public/system.h"
+#include "rocs/public/metrics.h"
 
 #include "rocrail/wrapper/public/Global.h"
 #include "rocrail/wrapper/public/SnmpService.h"
@@ -36,6 +40,9 @@
 
 static int instCnt = 0;
 
+/* Reply size after which a bulk response is cut off; the send buffer is 1024. */
+#define SNMP_BULKLIMIT 768
+
 /** ----- Declarations ----- */
 static int __setSeqInt(byte* b, int val);
 static int __setSignedInt(byte* b, int val);
@@ -131,40 +138,29 @@ static int __getInt(byte* in, int* offset) {
 
 /* --------------------------------------------------------------------------------
  * Convert a value from integer into a byte sequence. Max. 32 bit.
+ * BER integers are signed: leading bytes which only repeat the sign are dropped,
+ * a positive value with the high bit set keeps a leading zero.
  */
 static int __setInt(byte* out, int val) {
-  int len = 0;
+  int len = 4;
+  int i = 0;
 
   out[0] = SNMPOp.var_INT;
 
-  if( val <= 0xFF ) {
-    out[1] = 1;
-    out[2] = val;
-    len = 3;
-  }
-  else if( val <= 0xFFFF ) {
-    out[1] = 2;
-    out[2] = (val >> 8) & 0xFF;
-    out[3] = val & 0xFF;
-    len = 4;
-  }
-  else if( val <= 0xFFFFFF ) {
-    out[1] = 3;
-    out[2] = (val >> 16) & 0xFF;
-    out[3] = (val >> 8) & 0xFF;
-    out[4] = val & 0xFF;
-    len = 5;
-  }
-  else if( val <= 0xFFFFFFFF ) {
-    out[1] = 4;
-    out[2] = (val >> 24) & 0xFF;
-    out[3] = (val >> 16) & 0xFF;
-    out[4] = (val >> 8) & 0xFF;
-    out[5] = val & 0xFF;
-    len = 6;
+  while( len > 1 ) {
+    int top  = (val >> ((len-1) * 8)) & 0xFF;
+    int next = (val >> ((len-2) * 8)) & 0x80;
+    if( (top == 0x00 && next == 0) || (top == 0xFF && next != 0) )
+      len--;
+    else
+      break;
   }
 
-  return len;
+  out[1] = len;
+  for( i = 0; i < len; i++ )
+    out[2+i] = (val >> ((len-1-i) * 8)) & 0xFF;
+
+  return len + 2;
 }
 
 
@@ -642,6 +638,190 @@ static int __getSignedInt(byte* b, int* offset) {
 }
 
 
+/* --------------------------------------------------------------------------------
+ * Convert a 64 bit unsigned value into a Counter64.
+ */
+static int __setCounter64(byte* out, unsigned long long val) {
+  byte b[9];
+  int len = 0;
+  int i = 0;
+
+  do {
+    b[len++] = val & 0xFF;
+    val >>= 8;
+  } while( val > 0 );
+  /* keep it positive */
+  if( b[len-1] & 0x80 )
+    b[len++] = 0;
+
+  out[0] = SNMPOp.var_COUNTER64;
+  out[1] = len;
+  for( i = 0; i < len; i++ )
+    out[2+i] = b[len-1-i];
+
+  return len + 2;
+}
+
+
+/* --------------------------------------------------------------------------------
+ * Compare two OIDs numerically: 1.3.6.1.10 comes after 1.3.6.1.9.
+ */
+static int __oidCmp(const char* a, const char* b) {
+  while( *a != '\0' && *b != '\0' ) {
+    char* enda = NULL;
+    char* endb = NULL;
+    long x = strtol( a, &enda, 10 );
+    long y = strtol( b, &endb, 10 );
+    if( enda == a || endb == b )
+      return strcmp( a, b );
+    if( x != y )
+      return x < y ? -1:1;
+    a = enda;
+    b = endb;
+    if( *a == '.' ) a++;
+    if( *b == '.' ) b++;
+  }
+  if( *a == *b )
+    return 0;
+  return *a == '\0' ? -1:1;
+}
+
+static int __oidListCmp(obj* o1, obj* o2) {
+  return __oidCmp( (const char*)*o1, (const char*)*o2 );
+}
+
+
+/* --------------------------------------------------------------------------------
+ * The metrics table is not stored; its OIDs are derived from the registry.
+ * privMetrics.1.column.row with row = metric id + 1.
+ */
+#define METRIC_COLUMNS 7
+
+static Boolean __getMetricCell(const char* oid, int* col, int* row) {
+  int len = StrOp.len( wSnmpService.privMetrics );
+  int entry = 0;
+  char extra = 0;
+
+  if( !StrOp.startsWith( oid, wSnmpService.privMetrics ) || oid[len] != '.' )
+    return False;
+  if( sscanf( oid+len, ".%d.%d.%d%c", &entry, col, row, &extra ) != 3 )
+    return False;
+  return entry == 1 && *col >= 1 && *col <= METRIC_COLUMNS && *row >= 1 && *row <= MetricsOp.getCount();
+}
+
+static Boolean __nextMetricOID(const char* oid, char* next) {
+  int len   = StrOp.len( wSnmpService.privMetrics );
+  int cnt   = MetricsOp.getCount();
+  int entry = 0;
+  int col   = 1;
+  int row   = 1;
+
+  if( cnt == 0 )
+    return False;
+
+  if( StrOp.startsWith( oid, wSnmpService.privMetrics ) && oid[len] == '.' ) {
+    int c = 0;
+    int r = 0;
+    int n = sscanf( oid+len, ".%d.%d.%d", &entry, &c, &r );
+    if( n >= 1 && entry > 1 )
+      return False;
+    if( n >= 2 && entry == 1 && c >= 1 ) {
+      col = c;
+      row = r + 1;
+      if( row > cnt ) {
+        col++;
+        row = 1;
+      }
+      if( col > METRIC_COLUMNS )
+        return False;
+    }
+  }
+  else if( __oidCmp( oid, wSnmpService.privMetrics ) > 0 )
+    return False;
+
+  StrOp.fmtb( next, "%s.1.%d.%d", wSnmpService.privMetrics, col, row );
+  return True;
+}
+
+/* First OID after the given one in the static list or the metrics table; False at the end of the MIB. */
+static Boolean __nextOID(iOSNMP snmp, const char* oid, char* next) {
+  iOSNMPData data = Data(snmp);
+  char metric[128];
+  int lo = 0;
+  int hi = ListOp.size(data->oidList);
+  Boolean hasMetric = __nextMetricOID( oid, metric );
+
+  /* the list is sorted */
+  while( lo < hi ) {
+    int mid = (lo + hi) / 2;
+    if( __oidCmp( (const char*)ListOp.get(data->oidList, mid), oid ) <= 0 )
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if( lo < ListOp.size(data->oidList) ) {
+    const char* listed = (const char*)ListOp.get(data->oidList, lo);
+    StrOp.copy( next, hasMetric && __oidCmp( metric, listed ) < 0 ? metric:listed );
+    return True;
+  }
+  if( hasMetric ) {
+    StrOp.copy( next, metric );
+    return True;
+  }
+  return False;
+}
+
+/* --------------------------------------------------------------------------------
+ * Create a sequence with OID and value; 0 if the OID is unknown.
+ */
+static int __makeVariable(iOSNMP snmp, iOSnmpHdr hdr, byte* out, const char* oid) {
+  iOSNMPData data = Data(snmp);
+  const char* val = (const char*)MapOp.get( data->mibDB, oid );
+  int col = 0;
+  int row = 0;
+
+  if( val != NULL ) {
+    if( StrOp.equals(wSnmpService.sysUpTime, oid ) )
+      return __makeTimetickVariable(out, oid, atoi(val));
+    else if( StrOp.equals(wSnmpService.sysObjectID, oid ) )
+      return __makeOIDVariable(out, oid, val);
+    else if( StrOp.equals(wSnmpService.sysServices, oid ) )
+      return __makeIntegerVariable(out, oid, atoi(val));
+    else
+      return __makeStringVariable(out, oid, val);
+  }
+
+  if( __getMetricCell( oid, &col, &row ) ) {
+    int id = row - 1;
+    if( col == 1 )
+      return __makeStringVariable(out, oid, MetricsOp.getName(id));
+    else if( col == 2 )
+      return __makeIntegerVariable(out, oid, MetricsOp.getType(id) + 1);
+    else {
+      long value = MetricsOp.getValue(id, METRIC_VALUE + col - 3);
+      int offset = 0;
+      byte* VarLen = NULL;
+
+      /* SNMPv1 has no Counter64 */
+      if( hdr->version == 0 )
+        return __makeIntegerVariable(out, oid, value > 0x7FFFFFFF ? 0x7FFFFFFF:(int)value);
+
+      out[offset] = SNMPOp.pdu_SEQUENCE;
+      offset++;
+      VarLen = out + offset;
+      offset++;
+      offset += __setOID(out+offset, oid);
+      offset += __setCounter64(out+offset, value > 0 ? value:0);
+      *VarLen = offset - (VarLen - out) - 1;
+      return offset;
+    }
+  }
+
+  return 0;
+}
+
+
 /* --------------------------------------------------------------------------------
  * GetRequest handler: Create a sequence for every wanted OID.
  */
@@ -680,7 +860,6 @@ static int __handleSetRequest(iOSNMP snmp, iOSnmpHdr hdr, byte* in, byte* out) {
  * GetRequest handler: Create a sequence for every wanted OID.
  */
 static int __handleGetRequest(iOSNMP snmp, iOSnmpHdr hdr, byte* in, byte* out, int status, int index) {
-  iOSNMPData data = Data(snmp);
   int outlen = 0;
   int offset = 0;
 
@@ -720,48 +899,20 @@ static int __handleGetRequest(iOSNMP snmp, iOSnmpHdr hdr, byte* in, byte* out, i
   offset++;
 
   if( hdr->request == SNMPOp.pdu_BULKREQ ) {
+    char oid[128];
     int max = 0;
 
-    int startIdx = 0;
-    int n = 0;
-    for( n = 0; n < ListOp.size(data->oidList); n++) {
-      if( StrOp.equals(hdr->oid[0].oid, (const char*)ListOp.get(data->oidList, n) )) {
-        startIdx = n+1;
-        break;
-      }
-    }
-
-    if( n == ListOp.size(data->oidList) ) {
-      /* SNMPOp.var_EOFMIB */
-      startIdx = n;
+    StrOp.copy( oid, hdr->oid[0].oid );
+    if( !__nextOID(snmp, oid, oid) ) {
       offset += __makeEofMibVariable(out+offset, hdr->oid[0].oid);
     }
-
-    for( n = startIdx; n < ListOp.size(data->oidList) && max < hdr->errindex; n++) {
-      const char* oid = (const char*)ListOp.get(data->oidList, n);
-      const char* val = (const char*)MapOp.get(data->mibDB, oid);
-      if( val != NULL ) {
+    else {
+      /* stop before the reply outgrows the send buffer */
+      do {
         TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "getbulk[%d] oid=%s", max, oid );
-        if( StrOp.equals(wSnmpService.sysUpTime, oid ) ) {
-          offset += __makeTimetickVariable(out+offset, oid, atoi(val));
-          max++;
-        }
-        else if( StrOp.equals(wSnmpService.sysObjectID, oid ) ) {
-          offset += __makeOIDVariable(out+offset, oid, val);
-          max++;
-        }
-        else if( StrOp.equals(wSnmpService.sysServices, oid ) ) {
-          offset += __makeIntegerVariable(out+offset, oid, atoi(val));
-          max++;
-        }
-        else {
-          offset += __makeStringVariable(out+offset, oid, val);
-          max++;
-        }
-      }
-      else {
-        TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "oid[%s] not in DB", oid );
-      }
+        offset += __makeVariable(snmp, hdr, out+offset, oid);
+        max++;
+      } while( max < hdr->errindex && offset < SNMP_BULKLIMIT && __nextOID(snmp, oid, oid) );
     }
   }
 
@@ -769,36 +920,29 @@ static int __handleGetRequest(iOSNMP snmp, iOSnmpHdr hdr, byte* in, byte* out, i
     /* Loop over all requested OID's. */
     int i = 0;
     for( i = 0; i < hdr->oids; i++ ) {
-      const char* oid = hdr->oid[i].oid;
-      const char* val = (const char*)MapOp.get( data->mibDB, oid );
+      char oid[128];
+      int len = 0;
 
+      StrOp.copy( oid, hdr->oid[i].oid );
       if( hdr->request == SNMPOp.pdu_GETNEXTREQ ) {
         TraceOp.trc( name, TRCLEVEL_BYTE, __LINE__, 9999, "try to handle next request for %s...", oid );
-        int n = 0;
-        for( n = 0; n < ListOp.size(data->oidList); n++) {
-          if( StrOp.equals(hdr->oid[i].oid, (const char*)ListOp.get(data->oidList, n) )) {
-            if( n+1 < ListOp.size(data->oidList) ) {
-              oid = (const char*)ListOp.get(data->oidList, n+1);
-              val = (const char*)MapOp.get( data->mibDB, oid );
-              TraceOp.trc( name, TRCLEVEL_BYTE, __LINE__, 9999, "next request for %s=%s", oid, val );
-            }
-            else {
-              val = NULL;
-              break;
-            }
+        if( !__nextOID(snmp, oid, oid) ) {
+          if( hdr->version > 0 ) {
+            offset += __makeEofMibVariable(out+offset, hdr->oid[i].oid);
           }
+          else {
+            __setInt( errorStatus, SNMPOp.err_noSuchName);
+            __setInt( errorIndex , i+1);
+            offset += __makeNullVariable(out+offset, hdr->oid[i].oid);
+          }
+          continue;
         }
+        TraceOp.trc( name, TRCLEVEL_BYTE, __LINE__, 9999, "next request for %s", oid );
       }
 
-      if( val != NULL ) {
-        if( StrOp.equals(wSnmpService.sysUpTime, oid ) )
-          offset += __makeTimetickVariable(out+offset, oid, atoi(val));
-        else if( StrOp.equals(wSnmpService.sysObjectID, oid ) )
-          offset += __makeOIDVariable(out+offset, oid, val);
-        else if( StrOp.equals(wSnmpService.sysServices, oid ) )
-          offset += __makeIntegerVariable(out+offset, oid, atoi(val));
-        else
-          offset += __makeStringVariable(out+offset, oid, val);
+      len = __makeVariable(snmp, hdr, out+offset, oid);
+      if( len > 0 ) {
+        offset += len;
       }
       else {
         __setInt( errorStatus, SNMPOp.err_noSuchName);
@@ -989,7 +1133,7 @@ static int __handleRequest(iOSNMP snmp, byte* in, int inlen, byte* out) {
       return __handleGetRequest(snmp, &hdr, in, out, SNMPOp.err_OK, 0);
     }
     if( hdr.request == SNMPOp.pdu_GETNEXTREQ ) {
-      TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "GetNextRequest (not supported)" );
+      TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "GetNextRequest" );
       return __handleGetRequest(snmp, &hdr, in, out, SNMPOp.err_OK, 0);
     }
     if( hdr.request == SNMPOp.pdu_GETRSP ) {
@@ -1092,8 +1236,12 @@ static void __initMibDB(iOSNMP snmp) {
 
   ListOp.add( data->oidList, (obj) wSnmpService.privBuildTime ); /* build time */
   ListOp.add( data->oidList, (obj) wSnmpService.privThreadCnt ); /* thread count */
+  ListOp.add( data->oidList, (obj) wSnmpService.privConnectionCnt ); /* connection count */
   ListOp.add( data->oidList, (obj) wSnmpService.privMemStats  ); /* memory statistics */
   ListOp.add( data->oidList, (obj) wSnmpService.privLastExc   ); /* last logged exception */
+
+  /* GetNext and GetBulk walk in lexicographic order */
+  ListOp.sort( data->oidList, &__oidListCmp );
 }
 
 
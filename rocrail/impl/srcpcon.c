@@ -78,9 +78,28 @@ struct __OSrcpService {
   int           id;
   Boolean       infomode;
   Boolean       handshake;
+  int           pending;
+  Boolean       overflow;
 };
 typedef struct __OSrcpService* __iOSrcpService;
 
+/* SRCP info text rendered once and shared by all info sessions. */
+struct __OSrcpFrame {
+  char* text;
+  int   len;
+  int   refs;
+};
+typedef struct __OSrcpFrame* __iOSrcpFrame;
+
+typedef char* (*rr2srcp_fun)( iOSrcpConData data, iONode evt, char* str, struct timeval time );
+struct __rr2srcpdef {
+  rr2srcp_fun fun;
+};
+
+
+#define SRCP_MAXPENDING 1000
+#define SRCP_WRITEBUF   8192
+
 static const char* SRCPVERSION="Rocrail 2.0r%d; SRCP 0.8.4; SRCPOTHER 0.8.3%s";
 
 static volatile Boolean srcpPwCmdInProgress = False;
@@ -186,6 +205,13 @@ static void __writeRsp(__iOSrcpService o, const char* rsp) {
     SerialOp.fmt(o->clntSerial, rsp);
 }
 
+static void __writeInfo(__iOSrcpService o, char* buf, int len) {
+  if( o->clntSocket != NULL )
+    SocketOp.write( o->clntSocket, buf, len );
+  else
+    SerialOp.write( o->clntSerial, buf, len );
+}
+
 
 /* trim SRCP request -> remove useless "blanks" */
 static char* trimSrcpRequest( char *req ) {
@@ -608,34 +634,66 @@ static char *creaRspAllPwSts(iOSrcpConData data ) {
 }
 
 
-/* send infoStr to all srcp info connections */
-static int sendRsp2AllInfoChannels(iOSrcpConData data, const char* infoStr) {
-  iOList thList = ThreadOp.getAll();
-  int cnt = ListOp.size( thList );
-  int j;
+/* Post a shared info frame to all srcp info connections; the caller must own muxMap. */
+static int __postInfoFrame( iOSrcpConData data, const char* infoStr ) {
+  __iOSrcpFrame frame = NULL;
   int num = 0;
+  iOThread iw = (iOThread)MapOp.first( data->infoWriters );
 
-  /* go through all threads, search the SRCP server connections ("cmdrSRCP") and send the data to the info channel */
+  while( iw != NULL ) {
+    __iOSrcpService o = (__iOSrcpService)ThreadOp.getParm( iw );
+    if( o->infomode ) {
+      if( o->pending >= SRCP_MAXPENDING ) {
+        /* never block the broadcaster on a stalled client */
+        if( !o->overflow )
+          TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "SRCP session %d does not read; info dropped", o->id );
+        o->overflow = True;
+      }
+      else {
+        if( frame == NULL ) {
+          frame = allocMem( sizeof( struct __OSrcpFrame ) );
+          frame->text = StrOp.dup( infoStr );
+          frame->len  = StrOp.len( infoStr );
+        }
+        if( ThreadOp.post( iw, (obj)frame ) ) {
+          frame->refs++;
+          o->pending++;
+          num++;
+        }
+        else if( !o->overflow ) {
+          TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "SRCP session %d queue full; info dropped", o->id );
+          o->overflow = True;
+        }
+      }
+    }
+    iw = (iOThread)MapOp.next( data->infoWriters );
+  }
+  /* no session took it */
+  if( frame != NULL && frame->refs == 0 ) {
+    StrOp.free( frame->text );
+    freeMem( frame );
+  }
+  return num;
+}
 
-  TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "sendRsp2AllInfoChannels: %d active threads.", cnt );
 
-  for( j = 0; j < cnt; j++ ) {
-    iOThread th = (iOThread)ListOp.get( thList, j );
-    const char* tname = ThreadOp.getName( th );
+/* Caller must own muxMap. */
+static void __releaseInfoFrame( __iOSrcpFrame frame ) {
+  frame->refs--;
+  if( frame->refs <= 0 ) {
+    StrOp.free( frame->text );
+    freeMem( frame );
+  }
+}
 
-    iOSrcpCon srcpcon = (iOSrcpCon)ThreadOp.getParm(th);
-    iOSrcpConData data = Data(srcpcon);
-    __iOSrcpService   oI = (__iOSrcpService)ThreadOp.getParm(th);
 
-    if( StrOp.startsWithi( tname, "cmdrSRCP" ) ) {
-      if ( oI->infomode ) {
-        __writeRsp(oI, infoStr);
-        TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "sendRsp2AllInfoChannels: SRCP SEND: %p [%p] %d : %s", oI, oI->clntSocket, oI->id, infoStr ) ;
-        num++;
-        ThreadOp.sleep( 10 );
-      }
-    }
-  }
+/* send infoStr to all srcp info connections */
+static int sendRsp2AllInfoChannels(iOSrcpConData data, const char* infoStr) {
+  int num = 0;
+  /* posting does not block on the sessions, so wait for the lock instead of dropping the info */
+  MutexOp.wait( data->muxMap );
+  num = __postInfoFrame( data, infoStr );
+  MutexOp.post( data->muxMap );
   return num;
 }
 
@@ -652,9 +710,8 @@ static void sendAllPWstates2AllInfoChannels(iOSrcpConData data) {
 }
 
 /* Send sessionState to all srcp info connections */
-static void sendSessionstate2InfoChannels( int busId, int sessId, int srcpCode, Boolean mode ) {
+static void sendSessionstate2InfoChannels( iOSrcpConData data, int busId, int sessId, int srcpCode, Boolean mode ) {
   char str[1025] = {'\0'};
-  int j;
   struct timeval time;
   gettimeofday(&time, NULL);
 
@@ -677,419 +734,407 @@ static void sendSessionstate2InfoChannels( int busId, int sessId, int srcpCode,
 
   TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "%s", str);
 
-  /* go through all threads, search the SRCP server connections ("cmdrSRCP") and send the data to the info channel */
-  {
-    iOList thList = ThreadOp.getAll();
-    int cnt = ListOp.size( thList );
-
-    TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "%d active threads.", cnt );
-
-    for( j = 0; j < cnt; j++ ) {
-      iOThread th = (iOThread)ListOp.get( thList, j );
-      const char* tname = ThreadOp.getName( th );
-
-      iOSrcpCon srcpcon = (iOSrcpCon)ThreadOp.getParm(th);
-      iOSrcpConData data = Data(srcpcon);
-      __iOSrcpService   oI = (__iOSrcpService)ThreadOp.getParm(th);
-
-      if( StrOp.startsWithi( tname, "cmdrSRCP" ) ) {
-        if ( oI->infomode ) {
-          TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "SRCP SEND: %p [%p] %d : %s", oI, oI->clntSocket, oI->id, str ) ;
-          __writeRsp(oI, str);
-          ThreadOp.sleep( 10 );
-        }
-      }
-    }
-    ListOp.base.del(thList);
-  }
-
-
+  sendRsp2AllInfoChannels( data, str );
 }
 
 
 /** ----- OSrcpCon ----- */
 
-static char* __rr2srcp(iOSrcpCon srcpcon, __iOSrcpService o, iONode evt, char* str ) {
-  iOSrcpConData data = Data(srcpcon);
-  struct timeval time;
-  gettimeofday(&time, NULL);
+static char* __rr2srcpSwitch( iOSrcpConData data, iONode evt, char* str, struct timeval time ) {
   iOModel model = AppOp.getModel();
+  iOSwitch sw = ModelOp.getSwitch(model, wSwitch.getid(evt));
+  if( sw != NULL ) {
+    iONode swProps = SwitchOp.base.properties(sw);
+    int addr  = AddrOp.toPADA( wSwitch.getaddr1(swProps), wSwitch.getport1(swProps) );
+    int addr2 = AddrOp.toPADA( wSwitch.getaddr2(swProps), wSwitch.getport2(swProps) );
+    int gate1 = wSwitch.getgate1(swProps);
+    int gate2 = wSwitch.getgate2(swProps);
+    Boolean singlegate = wSwitch.issinglegate(swProps);
+    const char* state = wSwitch.getstate(evt);
+    const char* swstate = wSwitch.getstate(swProps);
+    int srcpBus = getSrcpBus( data, wSwitch.getiid(swProps));
 
-  TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "[%s] broadcast event", NodeOp.getName(evt) );
+    TraceOp.trc( name, TRCLEVEL_BYTE, __LINE__, 9999, "__rr2srcp: id[%s] state[%s] swstate[%s]",
+        wSwitch.getid(swProps), state, swstate );
 
-  if( StrOp.equals( wSwitch.name(), NodeOp.getName(evt))) {
-    iOSwitch sw = ModelOp.getSwitch(model, wSwitch.getid(evt));
-    if( sw != NULL ) {
-      iONode swProps = SwitchOp.base.properties(sw);
-      int addr  = AddrOp.toPADA( wSwitch.getaddr1(swProps), wSwitch.getport1(swProps) );
-      int addr2 = AddrOp.toPADA( wSwitch.getaddr2(swProps), wSwitch.getport2(swProps) );
-      int gate1 = wSwitch.getgate1(swProps);
-      int gate2 = wSwitch.getgate2(swProps);
-      Boolean singlegate = wSwitch.issinglegate(swProps);
-      const char* state = wSwitch.getstate(evt);
-      const char* swstate = wSwitch.getstate(swProps);
-      int srcpBus = getSrcpBus( data, wSwitch.getiid(swProps));
-
-      TraceOp.trc( name, TRCLEVEL_BYTE, __LINE__, 9999, "__rr2srcp: id[%s] state[%s] swstate[%s]",
+    if( ! StrOp.equals( state, swstate ) ) {
+      TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "__rr2srcp: id[%s] state[%s] swstate[%s]",
           wSwitch.getid(swProps), state, swstate );
+      return str;
+    }
 
-      if( ! StrOp.equals( state, swstate ) ) {
-        TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "__rr2srcp: id[%s] state[%s] swstate[%s]",
-            wSwitch.getid(swProps), state, swstate );
-        return str;
-      }
-
-      if(  StrOp.equals( wSwitch.gettype(swProps), wSwitch.left)
-        || StrOp.equals( wSwitch.gettype(swProps), wSwitch.right)
-        || StrOp.equals( wSwitch.gettype(swProps), wSwitch.twoway)
-        || StrOp.equals( wSwitch.gettype(swProps), wSwitch.crossing) 
-        || StrOp.equals( wSwitch.gettype(swProps), wSwitch.ccrossing)
-        || StrOp.equals( wSwitch.gettype(swProps), wSwitch.accessory)
-        ) {
-        /* 100 INFO <bus> GA <addr> <port> <value> */
-        if( singlegate ) {
-          int action = 1;
-          if( StrOp.equals( state, wSwitch.straight ) )
-            action = 0;
-          StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d %d\n",
-            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, gate1, action );
-          TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "__rr2srcp: str[%s]", str ) ;
-        }else {
-          StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, StrOp.equals( state, wSwitch.straight)? 1:0,
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, StrOp.equals( state, wSwitch.straight)? 1:0);
-        }
+    if(  StrOp.equals( wSwitch.gettype(swProps), wSwitch.left)
+      || StrOp.equals( wSwitch.gettype(swProps), wSwitch.right)
+      || StrOp.equals( wSwitch.gettype(swProps), wSwitch.twoway)
+      || StrOp.equals( wSwitch.gettype(swProps), wSwitch.crossing) 
+      || StrOp.equals( wSwitch.gettype(swProps), wSwitch.ccrossing)
+      || StrOp.equals( wSwitch.gettype(swProps), wSwitch.accessory)
+      ) {
+      /* 100 INFO <bus> GA <addr> <port> <value> */
+      if( singlegate ) {
+        int action = 1;
+        if( StrOp.equals( state, wSwitch.straight ) )
+          action = 0;
+        StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d %d\n",
+          time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, gate1, action );
+        TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "__rr2srcp: str[%s]", str ) ;
+      }else {
+        StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
+            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, StrOp.equals( state, wSwitch.straight)? 1:0,
+            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, StrOp.equals( state, wSwitch.straight)? 1:0);
       }
-      else if( StrOp.equals( wSwitch.gettype(swProps), wSwitch.threeway) 
-            || StrOp.equals( wSwitch.gettype(swProps), wSwitch.dcrossing)) {
-        if( StrOp.equals( state, wSwitch.straight)) {
-          if( singlegate ) {
-            StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 0\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, gate1, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, gate2);
-            TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "__rr2srcp: 3wDx straight str[%s]", str ) ;
-          }else {
-            StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, 0, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, 0,
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, 0, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, 0);
-          }
-        }
-        else if( StrOp.equals( state, wSwitch.left)) {
-          if( singlegate ) {
-            StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
-                time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, gate1, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, gate2);
-            TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "__rr2srcp: 3wDx left str[%s]", str ) ;
-          }else {
-            StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
-                time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, 1, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, 0,
-                time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, 1, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, 0);
-          }
-        }
-        else if( StrOp.equals( state, wSwitch.right)) {
-          if( singlegate ) {
-            StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 0\n%lu.%.3lu %d INFO %d GA %d %d 1\n",
-                time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, gate1, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, gate2);
-            TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "__rr2srcp: 3wDx right str[%s]", str ) ;
-          }else {
-            StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
-                time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, 0, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, 1,
-                time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, 0, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, 1);
-          }
-        }
-        else if( StrOp.equals( state, wSwitch.turnout)) {
-          if( singlegate ) {
-            StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 1\n",
-                time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, gate1, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, gate2);
-            TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "__rr2srcp: 3wDx turnout str[%s]", str ) ;
-          }else {
-            StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
-                time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, 1, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, 1,
-                time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, 1, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, 1);
-          }
-        }
-        else {
-          TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "UNHANDLED swEvent type %s, SWaddr1 %d, SWaddr2 %d, stateE %s, stateP %s", wSwitch.gettype(swProps) , addr, addr2, wSwitch.getstate(evt), wSwitch.getstate(swProps));
-        }
-        TraceOp.trc( name, TRCLEVEL_BYTE, __LINE__, 9999, "DCROSSING rr2srcp sends %s", str );
+    }
+    else if( StrOp.equals( wSwitch.gettype(swProps), wSwitch.threeway) 
+          || StrOp.equals( wSwitch.gettype(swProps), wSwitch.dcrossing)) {
+      /* the state index bits are the port values of the first and the second address */
+      const char* states[4] = { wSwitch.straight, wSwitch.left, wSwitch.right, wSwitch.turnout };
+      int i = 0;
+      while( i < 4 && !StrOp.equals( state, states[i] ) )
+        i++;
+
+      if( i == 4 ) {
+        TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "UNHANDLED swEvent type %s, SWaddr1 %d, SWaddr2 %d, stateE %s, stateP %s", wSwitch.gettype(swProps) , addr, addr2, wSwitch.getstate(evt), wSwitch.getstate(swProps));
       }
-      else if( StrOp.equals( wSwitch.gettype(swProps), wSwitch.decoupler )) {
-        TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "TYPE %s # %d set to %d", wSwitch.gettype(swProps), addr, StrOp.equals( state, wSwitch.straight)? 1:0 );
-        if( ! wSwitch.issinglegate(evt)){
-          StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, StrOp.equals( state, wSwitch.straight)? 1:0,
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, StrOp.equals( state, wSwitch.straight)? 1:0);
-        }else {
-          StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, wSwitch.getgate1(evt),
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, wSwitch.getgate1(evt));
-        }
+      else if( singlegate ) {
+        StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d %d\n%lu.%.3lu %d INFO %d GA %d %d %d\n",
+            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, gate1, i & 1,
+            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, gate2, (i >> 1) & 1);
+        TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "__rr2srcp: 3wDx %s str[%s]", state, str ) ;
       }
       else {
-        TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "UNHANDLED swDevice typeP %s, SWaddr1 %d, SWaddr2 %d, stateE %s, stateP %s", wSwitch.gettype(swProps) , addr, addr2, wSwitch.getstate(evt), wSwitch.getstate(swProps));
+        StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
+            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, i & 1, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, (i >> 1) & 1,
+            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, i & 1, time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, (i >> 1) & 1);
+      }
+      TraceOp.trc( name, TRCLEVEL_BYTE, __LINE__, 9999, "DCROSSING rr2srcp sends %s", str );
+    }
+    else if( StrOp.equals( wSwitch.gettype(swProps), wSwitch.decoupler )) {
+      TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "TYPE %s # %d set to %d", wSwitch.gettype(swProps), addr, StrOp.equals( state, wSwitch.straight)? 1:0 );
+      if( ! wSwitch.issinglegate(evt)){
+        StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
+            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, StrOp.equals( state, wSwitch.straight)? 1:0,
+            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, StrOp.equals( state, wSwitch.straight)? 1:0);
+      }else {
+        StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
+            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, wSwitch.getgate1(evt),
+            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr, wSwitch.getgate1(evt));
       }
     }
+    else {
+      TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "UNHANDLED swDevice typeP %s, SWaddr1 %d, SWaddr2 %d, stateE %s, stateP %s", wSwitch.gettype(swProps) , addr, addr2, wSwitch.getstate(evt), wSwitch.getstate(swProps));
+    }
   }
+  return str;
+}
 
-  else if( StrOp.equals( wSignal.name(), NodeOp.getName(evt))) {
-    iOSignal sg = ModelOp.getSignal(model, wSignal.getid(evt));
-    if( sg != NULL ) {
-      iONode sgProps = SignalOp.base.properties(sg);
-      int patternMode = wSignal.getusepatterns(sgProps);
-      int aspects = wSignal.getaspects( sgProps );
-      int addr1 = AddrOp.toPADA( wSignal.getaddr (sgProps), wSignal.getport1(sgProps) );
-      int gate1 = wSignal.getgate1(sgProps);
-      int addr2 = AddrOp.toPADA( wSignal.getaddr2(sgProps), wSignal.getport2(sgProps) );
-      int gate2 = wSignal.getgate2(sgProps);
-      int addr3 = AddrOp.toPADA( wSignal.getaddr3(sgProps), wSignal.getport3(sgProps) );
-      int gate3 = wSignal.getgate3(sgProps);
-      int addr4 = AddrOp.toPADA( wSignal.getaddr4(sgProps), wSignal.getport4(sgProps) );
-      int gate4 = wSignal.getgate4(sgProps);
-
-      if( (patternMode == 0) && (aspects <= 4) ) {
-        /* signal in standard mode with maximum of 4 aspects */
-        int srcpBus = getSrcpBus( data, wSignal.getiid(sgProps));
-
-        TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "sgEvent typeP[%s] signal[%s] aspects[%d] a1[%d] g1[%d] a2[%d] g2[%d] a3[%d] g3[%d] a4[%d] g4[%d], stateE %s, stateP %s",
-            wSignal.gettype(sgProps), wSignal.getid(sgProps), aspects, addr1, gate1, addr2, gate2, addr3, gate3, addr4, gate4, wSignal.getstate(evt), wSignal.getstate(sgProps));
-
-        /* 100 INFO <bus> GA <addr> <port> <value> */
-        if( StrOp.equals( wSignal.getstate(evt), wSignal.red)) {
+
+static char* __rr2srcpSignal( iOSrcpConData data, iONode evt, char* str, struct timeval time ) {
+  iOModel model = AppOp.getModel();
+  iOSignal sg = ModelOp.getSignal(model, wSignal.getid(evt));
+  if( sg != NULL ) {
+    iONode sgProps = SignalOp.base.properties(sg);
+    int patternMode = wSignal.getusepatterns(sgProps);
+    int aspects = wSignal.getaspects( sgProps );
+    int addr1 = AddrOp.toPADA( wSignal.getaddr (sgProps), wSignal.getport1(sgProps) );
+    int gate1 = wSignal.getgate1(sgProps);
+    int addr2 = AddrOp.toPADA( wSignal.getaddr2(sgProps), wSignal.getport2(sgProps) );
+    int gate2 = wSignal.getgate2(sgProps);
+    int addr3 = AddrOp.toPADA( wSignal.getaddr3(sgProps), wSignal.getport3(sgProps) );
+    int gate3 = wSignal.getgate3(sgProps);
+    int addr4 = AddrOp.toPADA( wSignal.getaddr4(sgProps), wSignal.getport4(sgProps) );
+    int gate4 = wSignal.getgate4(sgProps);
+
+    if( (patternMode == 0) && (aspects <= 4) ) {
+      /* signal in standard mode with maximum of 4 aspects */
+      int srcpBus = getSrcpBus( data, wSignal.getiid(sgProps));
+      const char* states[4] = { wSignal.red, wSignal.green, wSignal.yellow, wSignal.white };
+      int addrs[4] = { addr1, addr2, addr3, addr4 };
+      int gates[4] = { gate1, gate2, gate3, gate4 };
+      int i = 0;
+
+      TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "sgEvent typeP[%s] signal[%s] aspects[%d] a1[%d] g1[%d] a2[%d] g2[%d] a3[%d] g3[%d] a4[%d] g4[%d], stateE %s, stateP %s",
+          wSignal.gettype(sgProps), wSignal.getid(sgProps), aspects, addr1, gate1, addr2, gate2, addr3, gate3, addr4, gate4, wSignal.getstate(evt), wSignal.getstate(sgProps));
+
+      while( i < 4 && !StrOp.equals( wSignal.getstate(evt), states[i] ) )
+        i++;
+
+      /* 100 INFO <bus> GA <addr> <port> <value> */
+      if( i < 4 ) {
         StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
-            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr1, gate1,
-            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr1, gate1);
-        }
-        else if( StrOp.equals( wSignal.getstate(evt), wSignal.green)) {
-          StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, gate2,
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr2, gate2);
-        }
-        else if( StrOp.equals( wSignal.getstate(evt), wSignal.yellow)) {
-          StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr3, gate3,
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr3, gate3);
-        }
-        else if( StrOp.equals( wSignal.getstate(evt), wSignal.white)) {
-          StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GA %d %d 1\n%lu.%.3lu %d INFO %d GA %d %d 0\n",
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr4, gate4,
-              time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addr4, gate4);
-        }
-        else {
-          TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "UNHANDLED sgEvent unknown state[%s] signal[%s] aspects[%d] a1[%d] g1[%d] a2[%d] g2[%d] a3[%d] g3[%d] a4[%d] g4[%d]",
-              wSignal.getid(sgProps), wSignal.getstate(evt), aspects, addr1, gate1, addr2, gate2, addr3, gate3, addr4, gate4 );
-        }
+            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addrs[i], gates[i],
+            time.tv_sec, time.tv_usec / 1000L, 100, srcpBus, addrs[i], gates[i]);
       }
       else {
-        TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "IGNORED sgEvent: signal[%s] not in standard mode[%d] or too many aspects[%d]",
-            wSignal.getid(sgProps), patternMode, aspects );
-        TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "IGNORED sgEvent: signal[%s] not in standard mode[%d] or too many aspects[%d] a1[%d] g1[%d] a2[%d] g2[%d] a3[%d] g3[%d] a4[%d] g4[%d] stateE[%s] stateP[%s]",
-            wSignal.getid(sgProps), patternMode, aspects, addr1, gate1, addr2, gate2, addr3, gate3, addr4, gate4, wSignal.getstate(evt), wSignal.getstate(sgProps) );
+        TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "UNHANDLED sgEvent unknown state[%s] signal[%s] aspects[%d] a1[%d] g1[%d] a2[%d] g2[%d] a3[%d] g3[%d] a4[%d] g4[%d]",
+            wSignal.getid(sgProps), wSignal.getstate(evt), aspects, addr1, gate1, addr2, gate2, addr3, gate3, addr4, gate4 );
       }
     }
+    else {
+      TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "IGNORED sgEvent: signal[%s] not in standard mode[%d] or too many aspects[%d]",
+          wSignal.getid(sgProps), patternMode, aspects );
+      TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "IGNORED sgEvent: signal[%s] not in standard mode[%d] or too many aspects[%d] a1[%d] g1[%d] a2[%d] g2[%d] a3[%d] g3[%d] a4[%d] g4[%d] stateE[%s] stateP[%s]",
+          wSignal.getid(sgProps), patternMode, aspects, addr1, gate1, addr2, gate2, addr3, gate3, addr4, gate4, wSignal.getstate(evt), wSignal.getstate(sgProps) );
+    }
   }
+  return str;
+}
 
-  else if( StrOp.equals( wState.name(), NodeOp.getName(evt))) {
-    const char *iid = wState.getiid(evt);
-    if( iid != NULL ) {
 
-      int srcpBus = getSrcpBus( data, iid );
+static char* __rr2srcpState( iOSrcpConData data, iONode evt, char* str, struct timeval time ) {
+  const char *iid = wState.getiid(evt);
+  if( iid != NULL ) {
 
-      TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "StateName %s EvtName %s srcpBus %d PW %s", wState.name(), NodeOp.getName(evt), srcpBus, wState.ispower(evt)?"ON":"OFF" );
+    int srcpBus = getSrcpBus( data, iid );
 
-      if( ! srcpPwCmdInProgress )
-        __setSrcpPwFreetext( " by Rocrail" );
+    TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "StateName %s EvtName %s srcpBus %d PW %s", wState.name(), NodeOp.getName(evt), srcpBus, wState.ispower(evt)?"ON":"OFF" );
 
-      /* 100 INFO <bus> POWER ON/OFF <freetext> */
-      StrOp.fmtb(str, "%lu.%.3lu %d INFO %d POWER %s%s\n",
-            time.tv_sec, time.tv_usec / 1000L, 100, 
-            srcpBus, wState.ispower(evt)?"ON":"OFF", __getSrcpPwFreetext() );
-    }
+    if( ! srcpPwCmdInProgress )
+      __setSrcpPwFreetext( " by Rocrail" );
+
+    /* 100 INFO <bus> POWER ON/OFF <freetext> */
+    StrOp.fmtb(str, "%lu.%.3lu %d INFO %d POWER %s%s\n",
+          time.tv_sec, time.tv_usec / 1000L, 100, 
+          srcpBus, wState.ispower(evt)?"ON":"OFF", __getSrcpPwFreetext() );
   }
+  return str;
+}
 
-  else if( StrOp.equals( wClock.name(), NodeOp.getName(evt)) ) {
-    if( StrOp.equals( wClock.getcmd(evt), wClock.go ) ) {
-      /* GO */
-      __setClockRunning( True );
-      /* 101 INFO 0 TIME fx fy */
-       StrOp.fmtb(str, "%lu.%.3lu 101 INFO 0 TIME %d %d\n", time.tv_sec, time.tv_usec / 1000L, divider, 1 );
-       __writeRsp(o, str);
 
-      /* 100 INFO 0 TIME <JulDay> <Hour> <Minute> <Second> */
-      time_t evt_time = wClock.gettime(evt);
-      StrOp.fmtb(str, "%lu.%.3lu 100 INFO 0 TIME %s\n",
-          time.tv_sec, time.tv_usec / 1000L, convModelTimeToSRCP(evt_time) );
-    }
-    else if( StrOp.equals( wClock.getcmd(evt), wClock.freeze ) ) {
-      /* FREEZE */
-      __setClockRunning( False );
-      /* 102 INFO 0 TIME */
-      StrOp.fmtb(str, "%lu.%.3lu 102 INFO 0 TIME\n", time.tv_sec, time.tv_usec / 1000L );
-    }
-    else if( StrOp.equals( wClock.getcmd(evt), wClock.set ) ) {
-      /* SET */
-      /* divider changed -> 101 INFO 0 TIME fx fy */
-      int mt_divider = wClock.getdivider(evt);
-      if( divider != mt_divider ) {
-        /* time divider changed -> first send current time divider */
-        divider = mt_divider;
-        if( __isClockRunning() ) {
-          TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "__rr2srcp: new time divider[%d]", divider );
-          StrOp.fmtb(str, "%lu.%.3lu 101 INFO 0 TIME %d %d\n", time.tv_sec, time.tv_usec / 1000L, divider, 1 );
-          __writeRsp(o, str);
-        }
-      }
+static char* __rr2srcpClock( iOSrcpConData data, iONode evt, char* str, struct timeval time ) {
+  if( StrOp.equals( wClock.getcmd(evt), wClock.go ) ) {
+    /* GO */
+    __setClockRunning( True );
+    /* 101 INFO 0 TIME fx fy */
+    StrOp.fmtb(str, "%lu.%.3lu 101 INFO 0 TIME %d %d\n", time.tv_sec, time.tv_usec / 1000L, divider, 1 );
+
+    /* 100 INFO 0 TIME <JulDay> <Hour> <Minute> <Second> */
+    time_t evt_time = wClock.gettime(evt);
+    StrOp.fmtb(str + StrOp.len(str), "%lu.%.3lu 100 INFO 0 TIME %s\n",
+        time.tv_sec, time.tv_usec / 1000L, convModelTimeToSRCP(evt_time) );
+  }
+  else if( StrOp.equals( wClock.getcmd(evt), wClock.freeze ) ) {
+    /* FREEZE */
+    __setClockRunning( False );
+    /* 102 INFO 0 TIME */
+    StrOp.fmtb(str, "%lu.%.3lu 102 INFO 0 TIME\n", time.tv_sec, time.tv_usec / 1000L );
+  }
+  else if( StrOp.equals( wClock.getcmd(evt), wClock.set ) ) {
+    /* SET */
+    /* divider changed -> 101 INFO 0 TIME fx fy */
+    int mt_divider = wClock.getdivider(evt);
+    if( divider != mt_divider ) {
+      /* time divider changed -> first send current time divider */
+      divider = mt_divider;
       if( __isClockRunning() ) {
-        /* 100 INFO 0 TIME <JulDay> <Hour> <Minute> <Second> */
-        time_t evt_time = wClock.gettime(evt);
-        StrOp.fmtb(str, "%lu.%.3lu 100 INFO 0 TIME %s\n",
-            time.tv_sec, time.tv_usec / 1000L, convModelTimeToSRCP(evt_time) );
+        TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "__rr2srcp: new time divider[%d]", divider );
+        StrOp.fmtb(str, "%lu.%.3lu 101 INFO 0 TIME %d %d\n", time.tv_sec, time.tv_usec / 1000L, divider, 1 );
       }
     }
-    else if( StrOp.equals( wClock.getcmd(evt), wClock.sync ) ) {
-      /* SYNC */
-      int mt_divider = wClock.getdivider(evt);
-      if( divider != mt_divider ) {
-        /* time divider changed -> first send current time divider */
-        TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "__rr2srcp: SYNC divider change detected old[%d] new[%s]", divider, mt_divider );
-        divider = mt_divider;
-        if( __isClockRunning() ) {
-          TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "__rr2srcp: new time divider[%d]", divider );
-          StrOp.fmtb(str, "%lu.%.3lu 101 INFO 0 TIME %d %d\n", time.tv_sec, time.tv_usec / 1000L, divider, 1 );
-          __writeRsp(o, str);
-        }
-      }
+    if( __isClockRunning() ) {
       /* 100 INFO 0 TIME <JulDay> <Hour> <Minute> <Second> */
       time_t evt_time = wClock.gettime(evt);
-      StrOp.fmtb(str, "%lu.%.3lu 100 INFO 0 TIME %s\n",
+      StrOp.fmtb(str + StrOp.len(str), "%lu.%.3lu 100 INFO 0 TIME %s\n",
           time.tv_sec, time.tv_usec / 1000L, convModelTimeToSRCP(evt_time) );
     }
-    else {
-      TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Unknown/unsupported clock command", wClock.getcmd(evt) );
-    }
-  } /* CLOCK / TIME */
-
-  else if( StrOp.equals( wFeedback.name(), NodeOp.getName(evt))) {
-    iOFBack fb = ModelOp.getFBack(model, wFeedback.getid(evt));
-    if( fb != NULL ) {
-      iONode fbProps = FBackOp.base.properties(fb);
-      int srcpBus = getSrcpBus( data, wFeedback.getiid(fbProps));
-
-      /*100 INFO <bus> FB <addr> <value>*/
-      StrOp.fmtb(str, "%lu.%.3lu %d INFO %d FB %d %d\n",
-          time.tv_sec, time.tv_usec / 1000L,
-          100, srcpBus, wFeedback.getaddr(evt), wFeedback.isstate(evt));
-      TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "FBcmd [%s]", str );
+  }
+  else if( StrOp.equals( wClock.getcmd(evt), wClock.sync ) ) {
+    /* SYNC */
+    int mt_divider = wClock.getdivider(evt);
+    if( divider != mt_divider ) {
+      /* time divider changed -> first send current time divider */
+      TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "__rr2srcp: SYNC divider change detected old[%d] new[%d]", divider, mt_divider );
+      divider = mt_divider;
+      if( __isClockRunning() ) {
+        TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "__rr2srcp: new time divider[%d]", divider );
+        StrOp.fmtb(str, "%lu.%.3lu 101 INFO 0 TIME %d %d\n", time.tv_sec, time.tv_usec / 1000L, divider, 1 );
+      }
     }
-  } /* FB */
+    /* 100 INFO 0 TIME <JulDay> <Hour> <Minute> <Second> */
+    time_t evt_time = wClock.gettime(evt);
+    StrOp.fmtb(str + StrOp.len(str), "%lu.%.3lu 100 INFO 0 TIME %s\n",
+        time.tv_sec, time.tv_usec / 1000L, convModelTimeToSRCP(evt_time) );
+  }
+  else {
+    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "Unknown/unsupported clock command [%s]", wClock.getcmd(evt) );
+  }
+  return str;
+}
 
-  else if( StrOp.equals( wLoc.name(), NodeOp.getName(evt)) 
-        || StrOp.equals( wFunCmd.name(), NodeOp.getName(evt))) {
-    /* 100 INFO <bus> GL <addr>  <drivemode> <V>  <V_max> <f1> . . <fn> */
-    TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "[%s] wLoc or wFunCmd detected", NodeOp.getName(evt) ); 
 
-    iOLoc lo = ModelOp.getLoc(model, wLoc.getid(evt), NULL, False);
-    if( lo != NULL ) {
-      iONode loProps = LocOp.base.properties(lo);
+static char* __rr2srcpFeedback( iOSrcpConData data, iONode evt, char* str, struct timeval time ) {
+  iOModel model = AppOp.getModel();
+  iOFBack fb = ModelOp.getFBack(model, wFeedback.getid(evt));
+  if( fb != NULL ) {
+    iONode fbProps = FBackOp.base.properties(fb);
+    int srcpBus = getSrcpBus( data, wFeedback.getiid(fbProps));
 
-      int   loAddr = wLoc.getaddr(loProps);
-      
-      Boolean loDir = wLoc.isdir(loProps);
-      Boolean loPlacing = wLoc.isplacing(loProps);
-      int   loV = wLoc.getV(loProps);
-      int   loVmax = wLoc.getV_max(loProps);
-      const char *loVmode = wLoc.getV_mode(loProps);
-      int   loSpcnt = wLoc.getspcnt(loProps);
-      Boolean loFn = wLoc.isfn( loProps );    
-
-      const char *loCmd = wLoc.getcmd(loProps);
-      const char *loDecType = wLoc.getdectype(loProps);
-      const char *loDesc = wLoc.getdesc(loProps);
-      int   loFnCnt = wLoc.getfncnt(loProps);
-      int   loFx = wLoc.getfx(loProps);
-      const char *loId = wLoc.getid(loProps);
-      const char *loIid = wLoc.getiid(loProps);
-      const char *loOid = wLoc.getoid(loProps);
-
-      iOLoc loco = SRCPgetLocByAddressAndIid(model, loAddr, loIid);
-      int i, mask ;
-
-      int decStep = (wLoc.getV( loProps ) * loSpcnt) / wLoc.getV_max( loProps );
-      char funcString[1023];
-      funcString[0] = '\0';
+    /*100 INFO <bus> FB <addr> <value>*/
+    StrOp.fmtb(str, "%lu.%.3lu %d INFO %d FB %d %d\n",
+        time.tv_sec, time.tv_usec / 1000L,
+        100, srcpBus, wFeedback.getaddr(evt), wFeedback.isstate(evt));
+    TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "FBcmd [%s]", str );
+  }
+  return str;
+}
 
-      for( i=0 ; i < loFnCnt ; i++ ) {
-        mask = 1 << i ;
-        funcString[2*i] = ' ';
-        funcString[2*i+1] = loFx&mask?'1':'0';
-      }
-      funcString[2*loFnCnt] = '\0';
-      
-      int srcpBus = getSrcpBus( data, wLoc.getiid(loProps));
 
-      Boolean drivemode ;
-      if( loPlacing )
-        drivemode = loDir ;
-      else
-        drivemode = ! loDir ;
+static char* __rr2srcpLoc( iOSrcpConData data, iONode evt, char* str, struct timeval time ) {
+  iOModel model = AppOp.getModel();
+  /* 100 INFO <bus> GL <addr>  <drivemode> <V>  <V_max> <f1> . . <fn> */
+  TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "[%s] wLoc or wFunCmd detected", NodeOp.getName(evt) ); 
 
-      TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "addr %d dir %d placing %d drivemode %d V %d Vmode %s decStep %d spcnt %d loFx %d loId %s loFnCnt %d functions %s", 
-              loAddr, loDir, loPlacing, drivemode, loV, loVmode, decStep, loSpcnt, loFx, loId, loFnCnt, funcString );
+  iOLoc lo = ModelOp.getLoc(model, wLoc.getid(evt), NULL, False);
+  if( lo != NULL ) {
+    iONode loProps = LocOp.base.properties(lo);
 
-      StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GL %d %d %d %d %d%s\n",
-          time.tv_sec, time.tv_usec / 1000L,
-          100, srcpBus, loAddr,  drivemode?1:0, decStep, loSpcnt, loFn?1:0, funcString );
+    int   loAddr = wLoc.getaddr(loProps);
+    
+    Boolean loDir = wLoc.isdir(loProps);
+    Boolean loPlacing = wLoc.isplacing(loProps);
+    int   loV = wLoc.getV(loProps);
+    int   loVmax = wLoc.getV_max(loProps);
+    const char *loVmode = wLoc.getV_mode(loProps);
+    int   loSpcnt = wLoc.getspcnt(loProps);
+    Boolean loFn = wLoc.isfn( loProps );    
+
+    const char *loCmd = wLoc.getcmd(loProps);
+    const char *loDecType = wLoc.getdectype(loProps);
+    const char *loDesc = wLoc.getdesc(loProps);
+    int   loFnCnt = wLoc.getfncnt(loProps);
+    int   loFx = wLoc.getfx(loProps);
+    const char *loId = wLoc.getid(loProps);
+    const char *loIid = wLoc.getiid(loProps);
+    const char *loOid = wLoc.getoid(loProps);
+
+    iOLoc loco = SRCPgetLocByAddressAndIid(model, loAddr, loIid);
+    int i, mask ;
+
+    int decStep = (wLoc.getV( loProps ) * loSpcnt) / wLoc.getV_max( loProps );
+    char funcString[1023];
+    funcString[0] = '\0';
+
+    for( i=0 ; i < loFnCnt ; i++ ) {
+      mask = 1 << i ;
+      funcString[2*i] = ' ';
+      funcString[2*i+1] = loFx&mask?'1':'0';
     }
-  }
+    funcString[2*loFnCnt] = '\0';
+    
+    int srcpBus = getSrcpBus( data, wLoc.getiid(loProps));
 
-  else if( StrOp.equals( wFunDef.name(), NodeOp.getName(evt))) {
-    /* */
-    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "[%s] wFunDef detected", NodeOp.getName(evt) ); 
-  }
+    Boolean drivemode ;
+    if( loPlacing )
+      drivemode = loDir ;
+    else
+      drivemode = ! loDir ;
 
-  else if( StrOp.equals( wException.name(), NodeOp.getName(evt))){
-    const char* text = wException.gettext( evt );
-    int        level = wException.getlevel( evt );
-      
-    /* 
-      TODO: Do we need an exception handling? 
-      Not now. Currently we don't miss any commands or infos
-    */
-    TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "rr2srcp %s lvl %d text [%s]", NodeOp.getName(evt), level, text );
+    TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "addr %d dir %d placing %d drivemode %d V %d Vmode %s decStep %d spcnt %d loFx %d loId %s loFnCnt %d functions %s", 
+            loAddr, loDir, loPlacing, drivemode, loV, loVmode, decStep, loSpcnt, loFx, loId, loFnCnt, funcString );
+
+    StrOp.fmtb(str, "%lu.%.3lu %d INFO %d GL %d %d %d %d %d%s\n",
+        time.tv_sec, time.tv_usec / 1000L,
+        100, srcpBus, loAddr,  drivemode?1:0, decStep, loSpcnt, loFn?1:0, funcString );
   }
+  return str;
+}
 
-  else if( StrOp.equals( wBlock.name(), NodeOp.getName(evt))){
-    const char*   cmd = wBlock.getcmd( evt );
-    const char*    id = wBlock.getid( evt );
-    int          addr = wBlock.getaddr( evt );
-    const char* locId = wBlock.getlocid( evt );
-    int	         port = wBlock.getport( evt );
-    Boolean       pow = wBlock.ispower( evt );
 
-    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "rr2srcp %s id[%s] addr %d cmd [%s] locId [%s] port %d power %s",
-        NodeOp.getName(evt), id, addr, cmd, locId, port, pow?"yes":"no" );
-  }
+static char* __rr2srcpFunDef( iOSrcpConData data, iONode evt, char* str, struct timeval time ) {
+  /* */
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "[%s] wFunDef detected", NodeOp.getName(evt) ); 
+  return str;
+}
 
-  else if( StrOp.equals( wRoute.name(), NodeOp.getName(evt))){
-    const char*    id = wRoute.getid( evt );
-    iORoute route = ModelOp.getRoute( model, id );
-    const char* fb  = RouteOp.getFromBlock(route);
-    const char* fbs = RouteOp.getFromBlockSide(route)?"-":"+";
-    const char* tb  = RouteOp.getToBlock(route);
-    const char* tbs = RouteOp.getToBlockSide(route)?"-":"+";
-    Boolean locked = RouteOp.isLocked(route);
+
+static char* __rr2srcpException( iOSrcpConData data, iONode evt, char* str, struct timeval time ) {
+  const char* text = wException.gettext( evt );
+  int        level = wException.getlevel( evt );
     
-    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "rr2srcp %s id[%s] from [%s%s] to [%s%s] locked[%s]",
-        NodeOp.getName(evt), id, fb, fbs, tb, tbs, locked?"yes":"no" );
-  }
+  /* 
+    TODO: Do we need an exception handling? 
+    Not now. Currently we don't miss any commands or infos
+  */
+  TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "rr2srcp %s lvl %d text [%s]", NodeOp.getName(evt), level, text );
+  return str;
+}
 
-  else if( StrOp.equals( wAutoCmd.name(), NodeOp.getName(evt))){
-    Boolean autoMode = StrOp.equals( wAutoCmd.on, wAutoCmd.getcmd(evt) );
-    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "rr2srcp type[%s] autoMode[%d][%s]",
-        NodeOp.getName(evt), autoMode, wAutoCmd.getcmd(evt) );
-  }
 
-  else {
-    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "rr2srcp unhandled event [%s] returns [%s]",
-        NodeOp.getName(evt), str );
-  }
+static char* __rr2srcpBlock( iOSrcpConData data, iONode evt, char* str, struct timeval time ) {
+  const char*   cmd = wBlock.getcmd( evt );
+  const char*    id = wBlock.getid( evt );
+  int          addr = wBlock.getaddr( evt );
+  const char* locId = wBlock.getlocid( evt );
+  int	         port = wBlock.getport( evt );
+  Boolean       pow = wBlock.ispower( evt );
+
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "rr2srcp %s id[%s] addr %d cmd [%s] locId [%s] port %d power %s",
+      NodeOp.getName(evt), id, addr, cmd, locId, port, pow?"yes":"no" );
+  return str;
+}
+
+
+static char* __rr2srcpRoute( iOSrcpConData data, iONode evt, char* str, struct timeval time ) {
+  iOModel model = AppOp.getModel();
+  const char*    id = wRoute.getid( evt );
+  iORoute route = ModelOp.getRoute( model, id );
+  const char* fb  = RouteOp.getFromBlock(route);
+  const char* fbs = RouteOp.getFromBlockSide(route)?"-":"+";
+  const char* tb  = RouteOp.getToBlock(route);
+  const char* tbs = RouteOp.getToBlockSide(route)?"-":"+";
+  Boolean locked = RouteOp.isLocked(route);
+  
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "rr2srcp %s id[%s] from [%s%s] to [%s%s] locked[%s]",
+      NodeOp.getName(evt), id, fb, fbs, tb, tbs, locked?"yes":"no" );
+  return str;
+}
+
+
+static char* __rr2srcpAuto( iOSrcpConData data, iONode evt, char* str, struct timeval time ) {
+  Boolean autoMode = StrOp.equals( wAutoCmd.on, wAutoCmd.getcmd(evt) );
+  TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "rr2srcp type[%s] autoMode[%d][%s]",
+      NodeOp.getName(evt), autoMode, wAutoCmd.getcmd(evt) );
+  return str;
+}
+
+
+static void __addRR2SRCP( iOSrcpConData data, const char* evtname, rr2srcp_fun fun ) {
+  struct __rr2srcpdef* def = allocMem( sizeof( struct __rr2srcpdef ) );
+  def->fun = fun;
+  MapOp.put( data->rr2srcp, evtname, (obj)def );
+}
+
+
+static void __initRR2SRCP( iOSrcpConData data ) {
+  data->rr2srcp = MapOp.inst();
+  __addRR2SRCP( data, wSwitch.name(), __rr2srcpSwitch );
+  __addRR2SRCP( data, wSignal.name(), __rr2srcpSignal );
+  __addRR2SRCP( data, wState.name(), __rr2srcpState );
+  __addRR2SRCP( data, wClock.name(), __rr2srcpClock );
+  __addRR2SRCP( data, wFeedback.name(), __rr2srcpFeedback );
+  __addRR2SRCP( data, wLoc.name(), __rr2srcpLoc );
+  __addRR2SRCP( data, wFunCmd.name(), __rr2srcpLoc );
+  __addRR2SRCP( data, wFunDef.name(), __rr2srcpFunDef );
+  __addRR2SRCP( data, wException.name(), __rr2srcpException );
+  __addRR2SRCP( data, wBlock.name(), __rr2srcpBlock );
+  __addRR2SRCP( data, wRoute.name(), __rr2srcpRoute );
+  __addRR2SRCP( data, wAutoCmd.name(), __rr2srcpAuto );
+}
+
+
+/* Converts a Rocrail event into SRCP info lines; str is empty if there is nothing to report. */
+static char* __rr2srcp(iOSrcpCon srcpcon, iONode evt, char* str ) {
+  iOSrcpConData data = Data(srcpcon);
+  struct __rr2srcpdef* def = (struct __rr2srcpdef*)MapOp.get( data->rr2srcp, NodeOp.getName(evt) );
+  struct timeval time;
+  gettimeofday(&time, NULL);
+
+  str[0] = '\0';
+  TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "[%s] broadcast event", NodeOp.getName(evt) );
+
+  if( def != NULL )
+    def->fun( data, evt, str, time );
+  else
+    TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "rr2srcp unhandled event [%s]", NodeOp.getName(evt) );
 
   return str;
 }
@@ -2880,7 +2925,7 @@ static iONode __srcp2rr(iOSrcpCon srcpcon, __iOSrcpService o, const char* req, i
         ThreadOp.sleep( 100 );
         /* inform all info sessions about closing a session */
         /* -> this will be automatically invoked for all sessions when closing the socket ! */
-        /* sendSessionstate2InfoChannels( 0, sessId, 102, o->infomode ); */
+        /* sendSessionstate2InfoChannels( data, 0, sessId, 102, o->infomode ); */
         *reqRespCode = (int) 0 ;
       }
       else {
@@ -3161,16 +3206,25 @@ static int _getClientPort( struct OSrcpCon* inst ) {
 
 static void __doBroadcast( iOSrcpCon inst, iONode nodeDF ) {
   TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "Broadcast received." );
-  if( inst != NULL && MutexOp.trywait( Data(inst)->muxMap, 100 ) ) {
+  if( inst != NULL ) {
     iOSrcpConData data = Data(inst);
+    Boolean hasInfo = False;
+
+    MutexOp.wait( data->muxMap );
 
     iOThread iw = (iOThread)MapOp.first( data->infoWriters );
-    while( iw != NULL ) {
-      iONode clone = (iONode)nodeDF->base.clone( nodeDF );
-      ThreadOp.post( iw, (obj)clone );
-      ThreadOp.sleep( 0 );
+    while( iw != NULL && !hasInfo ) {
+      hasInfo = ((__iOSrcpService)ThreadOp.getParm( iw ))->infomode;
       iw = (iOThread)MapOp.next( data->infoWriters );
     }
+
+    /* render the event once for all info sessions */
+    if( hasInfo ) {
+      char str[1025];
+      __rr2srcp( inst, nodeDF, str );
+      if( str[0] != '\0' )
+        __postInfoFrame( data, str );
+    }
     /* Unlock the semaphore: */
     MutexOp.post( data->muxMap );
   }
@@ -3867,7 +3921,7 @@ static void __evalRequest(iOSrcpCon srcpcon, __iOSrcpService o, const char* req)
         */
       }
       /* inform all info sessions about a new session */
-      sendSessionstate2InfoChannels( 0, o->id, 101, o->infomode );
+      sendSessionstate2InfoChannels( Data(srcpcon), 0, o->id, 101, o->infomode );
     }
     else {
       TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "unexpected request in handshake phase. SRCP REQUEST: %s", req ) ;
@@ -3918,6 +3972,47 @@ static void __evalRequest(iOSrcpCon srcpcon, __iOSrcpService o, const char* req)
   }
 }
 
+/* Drain the queued info frames into one socket write; returns False if there was nothing to write. */
+static Boolean __writeInfoFrames( iOSrcpCon srcpcon, __iOSrcpService o, iOThread th ) {
+  iOSrcpConData data = Data(srcpcon);
+  char buf[SRCP_WRITEBUF];
+  int len = 0;
+  int cnt = 0;
+  __iOSrcpFrame frame = (__iOSrcpFrame)ThreadOp.getPost( th );
+
+  if( frame == NULL )
+    return False;
+
+  while( frame != NULL ) {
+    if( len + frame->len > SRCP_WRITEBUF ) {
+      __writeInfo( o, buf, len );
+      len = 0;
+    }
+    if( frame->len > SRCP_WRITEBUF )
+      __writeInfo( o, frame->text, frame->len );
+    else {
+      MemOp.copy( buf + len, frame->text, frame->len );
+      len += frame->len;
+    }
+
+    cnt++;
+    MutexOp.wait( data->muxMap );
+    __releaseInfoFrame( frame );
+    o->pending--;
+    o->overflow = False;
+    MutexOp.post( data->muxMap );
+
+    frame = (__iOSrcpFrame)ThreadOp.getPost( th );
+  }
+
+  if( len > 0 )
+    __writeInfo( o, buf, len );
+
+  TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "%d info frames written to session %d", cnt, o->id );
+  return True;
+}
+
+
 static void __SrcpService( void* threadinst ) {
   iOThread         th = (iOThread)threadinst;
   __iOSrcpService   o = (__iOSrcpService)ThreadOp.getParm(th);
@@ -3927,6 +4022,7 @@ static void __SrcpService( void* threadinst ) {
   Boolean          ok = False;
   iOThread infoWriter = NULL;
   char str[1025] = {'\0'};
+  obj post = NULL;
   int sessId;
 
   ThreadOp.setDescription( th, "SRCP Client command reader" );
@@ -3945,32 +4041,17 @@ static void __SrcpService( void* threadinst ) {
   sname = StrOp.fmt( "srcp%08X", o->clntSocket );
 
   /* Lock the semaphore: */
-  if( MutexOp.trywait( Data(srcpcon)->muxMap, 100 ) ) {
-    MapOp.put( Data(srcpcon)->infoWriters, sname, (obj)threadinst );
-    /* Unlock the semaphore: */
-    MutexOp.post( Data(srcpcon)->muxMap );
-  }
+  MutexOp.wait( Data(srcpcon)->muxMap );
+  MapOp.put( Data(srcpcon)->infoWriters, sname, (obj)threadinst );
+  /* Unlock the semaphore: */
+  MutexOp.post( Data(srcpcon)->muxMap );
 
   do {
     char str[1025] = {'\0'};
     int strLen;
 
-    obj post = ThreadOp.getPost( th );
-    if( post != NULL ) {
-      iONode node = (iONode)post;
-      if( node != NULL ) {
-        if( o->infomode ) {
-          __rr2srcp(srcpcon, o, node, str);
-          if( o->clntSocket != NULL )
-            SocketOp.write( o->clntSocket, str, StrOp.len(str) );
-          else
-            SerialOp.write( o->clntSerial, str, StrOp.len(str) );
-
-          TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "__SrcpService __rr2srcp() returned with %s %p [%p] ID: %d", str, o, o->clntSocket, o->id );
-        }
-        NodeOp.base.del(node);
-      }
-    }
+    /* write all pending info frames in one go */
+    Boolean idle = !__writeInfoFrames( srcpcon, o, th );
 
     if( o->clntSocket != NULL ) {
       if( !SocketOp.peek( o->clntSocket, str, 1 ) ) {
@@ -3979,14 +4060,16 @@ static void __SrcpService( void* threadinst ) {
                       "SRCP Service: Socket errno=%d", SocketOp.getRc( o->clntSocket ) );
           break;
         }
-        ThreadOp.sleep( 10 );
+        if( idle )
+          ThreadOp.sleep( 10 );
         continue;
       }
       SocketOp.readln(o->clntSocket, str);
     }
     else {
       if( !SerialOp.available(data->serial) ) {
-        ThreadOp.sleep( 10 );
+        if( idle )
+          ThreadOp.sleep( 10 );
         continue;
       }
       else {
@@ -4027,19 +4110,21 @@ static void __SrcpService( void* threadinst ) {
 
     TraceOp.trc( name, TRCLEVEL_DEBUG, __LINE__, 9999, "__evalRequest %s for ID: %d", str, o->id );
     __evalRequest( srcpcon, o, str);
-    ThreadOp.sleep(10);
 
   } while( !o->quit );
 
   TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999, "SRCP service ended for session [%d]", o->id );
   sessId = o->id;
 
-  /* Lock the semaphore: */
-  if( MutexOp.trywait( Data(srcpcon)->muxMap, 100 ) ) {
-    MapOp.remove( Data(srcpcon)->infoWriters, sname );
-    /* Unlock the semaphore: */
-    MutexOp.post( Data(srcpcon)->muxMap );
-  }
+  /* Lock the semaphore; the session must leave the map before its thread is freed. */
+  MutexOp.wait( Data(srcpcon)->muxMap );
+  MapOp.remove( Data(srcpcon)->infoWriters, sname );
+  /* release the frames which are not written */
+  while( (post = ThreadOp.getPost( th )) != NULL )
+    __releaseInfoFrame( (__iOSrcpFrame)post );
+  /* Unlock the semaphore: */
+  MutexOp.post( Data(srcpcon)->muxMap );
+  StrOp.free( sname );
 
   if( o->clntSocket != NULL ) {
     SocketOp.base.del(o->clntSocket);
@@ -4047,7 +4132,7 @@ static void __SrcpService( void* threadinst ) {
   ThreadOp.base.del( th );
   freeMem(o);
 
-  sendSessionstate2InfoChannels( 0, sessId, 102, False );
+  sendSessionstate2InfoChannels( data, 0, sessId, 102, False );
 }
 
 
@@ -4131,6 +4216,7 @@ static struct OSrcpCon* _inst( iONode ini, srcpcon_callback callbackfun, obj cal
 
   data->infoWriters = MapOp.inst();
   data->muxMap      = MutexOp.inst( NULL, True );
+  __initRR2SRCP( data );
 
   if( wSrcpCon.getdevice(ini) != NULL && StrOp.len(wSrcpCon.getdevice(ini)) > 0 ) {
     data->serial = SerialOp.inst( wDigInt.getdevice( data->ini ) );
@@ -696,6 +696,11 @@ static Boolean _unLock( iOSwitch inst, const char* id, iORoute route, Boolean fo
   return False;
 }
 
+static const char* _getLockedId( iOSwitch inst ) {
+  iOSwitchData data = Data(inst);
+  return data->lockedId;
+}
+
 static Boolean _isLocked( iOSwitch inst, const char* id, Boolean manual ) {
   iOSwitchData data = Data(inst);
   const char* blockid = wSwitch.getblockid(data->props);
@@ -0,0 +1,393 @@
+/*
+ Copyright (C) 2002-2014 Rob Versluis, Rocrail.net
+
+
+
+ */
+
+
+/* ------------------------------------------------------------
+ * libc interfaces.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* ------------------------------------------------------------
+ * rocs interfaces.
+ */
+#include "rocs/public/mem.h"
+#include "rocs/public/trace.h"
+#include "rocs/public/str.h"
+#include "rocs/public/map.h"
+#include "rocs/public/mutex.h"
+#include "rocs/public/thread.h"
+#include "rocs/public/metrics.h"
+#include "rocs/public/rcumap.h"
+
+/*
+ RcuMap stress test and read throughput benchmark.
+
+ Stress: readers look up items inside enter/leave and check them twice
+ while writers replace and remove items of their own key partition; a
+ retired item is poisoned and freed after synchronize, so a reader that
+ sees a poisoned or foreign item found a grace period bug. The key range
+ is four times the preloaded items, so removed keys pile up and the table
+ is rebuilt regularly.
+
+ Bench: lookups per second for 1..n readers, without a writer, for the
+ RcuMap and for a MapOp guarded by a MutexOp as the model used before.
+
+ Build with "make rcutest" or, for ThreadSanitizer, "make rcutest-tsan" and
+ run it with the suppressions in gen/rcutest.supp.
+*/
+
+#define ITEM_MAGIC 0x52435531L
+#define ITEM_DEAD  0x44454144L
+#define CHECKMASK  1023
+
+static const char* name = "rcutest";
+
+struct RcuItem {
+  long magic;
+  int  key;
+};
+
+/* State shared by all threads; stop, done and the counters are read under mux. */
+struct RcuTest {
+  iORcuMap rcumap;
+  iOMap    map;
+  iOMutex  mapmux;
+  iOMutex  mux;
+  int      keys;
+  int      writers;
+  Boolean  yield;
+  Boolean  stop;
+  int      running;
+};
+
+struct RcuWorker {
+  struct RcuTest* test;
+  int           index;
+  unsigned long seed;
+  unsigned long reads;
+  unsigned long hits;
+  unsigned long writes;
+  unsigned long failures;
+};
+
+
+static unsigned long __random( unsigned long* seed ) {
+  *seed = *seed * 1103515245UL + 12345UL;
+  return ( *seed >> 16 ) & 0x7FFF;
+}
+
+
+static struct RcuItem* __newItem( int key ) {
+  struct RcuItem* item = allocMem( sizeof( struct RcuItem ) );
+  item->magic = ITEM_MAGIC;
+  item->key   = key;
+  return item;
+}
+
+
+static void __retire( iORcuMap map, struct RcuItem* item ) {
+  if( item != NULL ) {
+    RcuMapOp.synchronize( map );
+    item->magic = ITEM_DEAD;
+    freeMem( item );
+  }
+}
+
+
+static Boolean __stopped( struct RcuTest* test ) {
+  Boolean stop = False;
+  MutexOp.wait( test->mux );
+  stop = test->stop;
+  MutexOp.post( test->mux );
+  return stop;
+}
+
+
+static void __finished( struct RcuTest* test ) {
+  MutexOp.wait( test->mux );
+  test->running--;
+  MutexOp.post( test->mux );
+}
+
+
+static Boolean __check( struct RcuItem* item, int key ) {
+  return item->magic == ITEM_MAGIC && item->key == key;
+}
+
+
+/* Looks up random keys and checks the item before and after yielding, if set. */
+static void __reader( void* threadinst ) {
+  iOThread th = (iOThread)threadinst;
+  struct RcuWorker* w = (struct RcuWorker*)ThreadOp.getParm( th );
+  struct RcuTest* test = w->test;
+  char key[32];
+
+  do {
+    int i = 0;
+    for( i = 0; i <= CHECKMASK; i++ ) {
+      int k = __random( &w->seed ) % ( test->keys * 4 );
+      int token = 0;
+      struct RcuItem* item = NULL;
+
+      sprintf( key, "k%d", k );
+      token = RcuMapOp.enter( test->rcumap );
+      item = (struct RcuItem*)RcuMapOp.get( test->rcumap, key );
+      if( item != NULL ) {
+        w->hits++;
+        if( !__check( item, k ) )
+          w->failures++;
+        if( test->yield ) {
+          ThreadOp.sleep( 0 );
+          if( !__check( item, k ) )
+            w->failures++;
+        }
+      }
+      RcuMapOp.leave( test->rcumap, token );
+      w->reads++;
+    }
+  } while( !__stopped( test ) );
+
+  ThreadOp.base.del( th );
+  __finished( test );
+}
+
+
+/* Replaces, removes and inserts keys k where k % writers == index. */
+static void __writer( void* threadinst ) {
+  iOThread th = (iOThread)threadinst;
+  struct RcuWorker* w = (struct RcuWorker*)ThreadOp.getParm( th );
+  struct RcuTest* test = w->test;
+  int range = test->keys * 4 / test->writers;
+  char key[32];
+
+  do {
+    int k = ( __random( &w->seed ) % range ) * test->writers + w->index;
+    struct RcuItem* old = NULL;
+
+    sprintf( key, "k%d", k );
+    old = (struct RcuItem*)RcuMapOp.get( test->rcumap, key );
+    if( old != NULL && __random( &w->seed ) % 2 == 0 )
+      old = (struct RcuItem*)RcuMapOp.remove( test->rcumap, key );
+    else
+      RcuMapOp.put( test->rcumap, key, (obj)__newItem( k ) );
+    __retire( test->rcumap, old );
+    w->writes++;
+  } while( !__stopped( test ) );
+
+  ThreadOp.base.del( th );
+  __finished( test );
+}
+
+
+/* Lookups through the map and mutex the RcuMap replaced. */
+static void __mapReader( void* threadinst ) {
+  iOThread th = (iOThread)threadinst;
+  struct RcuWorker* w = (struct RcuWorker*)ThreadOp.getParm( th );
+  struct RcuTest* test = w->test;
+  char key[32];
+
+  do {
+    int i = 0;
+    for( i = 0; i <= CHECKMASK; i++ ) {
+      int k = __random( &w->seed ) % ( test->keys * 4 );
+      struct RcuItem* item = NULL;
+
+      sprintf( key, "k%d", k );
+      MutexOp.wait( test->mapmux );
+      item = (struct RcuItem*)MapOp.get( test->map, key );
+      if( item != NULL ) {
+        w->hits++;
+        if( !__check( item, k ) )
+          w->failures++;
+      }
+      MutexOp.post( test->mapmux );
+      w->reads++;
+    }
+  } while( !__stopped( test ) );
+
+  ThreadOp.base.del( th );
+  __finished( test );
+}
+
+
+/* Starts the workers, lets them run for ms and waits until all have stopped. */
+static unsigned long __run( struct RcuTest* test, struct RcuWorker* workers, int readers, int writers,
+                            thread_run reader, int ms ) {
+  unsigned long t0 = 0;
+  unsigned long t1 = 0;
+  int i = 0;
+
+  test->stop    = False;
+  test->running = readers + writers;
+  for( i = 0; i < readers + writers; i++ ) {
+    char tname[32];
+    MemOp.set( &workers[i], 0, sizeof( struct RcuWorker ) );
+    workers[i].test  = test;
+    workers[i].index = i < readers ? i : i - readers;
+    workers[i].seed  = 7 + i;
+    sprintf( tname, "%s%d", i < readers ? "rd" : "wr", i );
+    ThreadOp.start( ThreadOp.inst( tname, i < readers ? reader : &__writer, &workers[i] ) );
+  }
+
+  t0 = MetricsOp.now();
+  ThreadOp.sleep( ms );
+  MutexOp.wait( test->mux );
+  test->stop = True;
+  MutexOp.post( test->mux );
+
+  for(;;) {
+    int running = 0;
+    MutexOp.wait( test->mux );
+    running = test->running;
+    MutexOp.post( test->mux );
+    if( running == 0 )
+      break;
+    ThreadOp.sleep( 1 );
+  }
+  t1 = MetricsOp.now();
+  return t1 > t0 ? t1 - t0 : 1;
+}
+
+
+static void __sum( struct RcuWorker* workers, int from, int to, struct RcuWorker* sum ) {
+  int i = 0;
+  MemOp.set( sum, 0, sizeof( struct RcuWorker ) );
+  for( i = from; i < to; i++ ) {
+    sum->reads    += workers[i].reads;
+    sum->hits     += workers[i].hits;
+    sum->writes   += workers[i].writes;
+    sum->failures += workers[i].failures;
+  }
+}
+
+
+static int __usage( void ) {
+  TraceOp.println( "usage: rcutest [-readers n] [-writers n] [-keys n] [-ms n] [-stress|-bench]" );
+  return 2;
+}
+
+
+/** ------------------------------------------------------------
+  * public main()
+  *
+  * @param  argc Number of commanline arguments.
+  * @param  argv Commanline arguments.
+  * @return      0 if no failures, 1 on failures, 2 on a usage error.
+  */
+int main( int argc, const char* argv[] ) {
+  struct RcuTest test;
+  struct RcuWorker* workers = NULL;
+  struct RcuWorker sum;
+  unsigned long failures = 0;
+  Boolean stress = True;
+  Boolean bench  = True;
+  int readers = 4;
+  int ms = 2000;
+  int i = 0;
+
+  iOTrace trc = TraceOp.inst( TRCLEVEL_INFO, name, True );
+  TraceOp.setAppID( trc, "t" );
+
+  /* Resets memory statistics; init locks them, the threads allocate concurrently. */
+  MemOp.resetDump();
+  MemOp.init();
+
+  MemOp.set( &test, 0, sizeof( struct RcuTest ) );
+  test.keys    = 1000;
+  test.writers = 2;
+
+  for( i = 1; i < argc; i++ ) {
+    if( StrOp.equals( argv[i], "-stress" ) )
+      bench = False;
+    else if( StrOp.equals( argv[i], "-bench" ) )
+      stress = False;
+    else if( i + 1 < argc && StrOp.equals( argv[i], "-readers" ) )
+      readers = atoi( argv[++i] );
+    else if( i + 1 < argc && StrOp.equals( argv[i], "-writers" ) )
+      test.writers = atoi( argv[++i] );
+    else if( i + 1 < argc && StrOp.equals( argv[i], "-keys" ) )
+      test.keys = atoi( argv[++i] );
+    else if( i + 1 < argc && StrOp.equals( argv[i], "-ms" ) )
+      ms = atoi( argv[++i] );
+    else
+      return __usage();
+  }
+  if( readers < 1 || test.writers < 1 || test.keys < test.writers || ms < 1 )
+    return __usage();
+
+  test.rcumap  = RcuMapOp.inst();
+  test.map     = MapOp.inst();
+  test.mapmux  = MutexOp.inst( NULL, True );
+  test.mux     = MutexOp.inst( NULL, True );
+  workers = allocMem( ( readers + test.writers ) * sizeof( struct RcuWorker ) );
+
+  /* preload every other key */
+  for( i = 0; i < test.keys * 4; i += 2 ) {
+    char key[32];
+    sprintf( key, "k%d", i );
+    RcuMapOp.put( test.rcumap, key, (obj)__newItem( i ) );
+    MapOp.put( test.map, key, (obj)__newItem( i ) );
+  }
+
+  if( stress ) {
+    unsigned long us = 0;
+    struct RcuWorker w;
+    test.yield = True;
+    us = __run( &test, workers, readers, test.writers, &__reader, ms );
+    __sum( workers, 0, readers, &sum );
+    __sum( workers, readers, readers + test.writers, &w );
+    TraceOp.println( "stress: readers=%d writers=%d keys=%d items=%d reads=%lu hits=%lu writes=%lu reads/s=%.0f failures=%lu",
+        readers, test.writers, test.keys * 4, RcuMapOp.size( test.rcumap ), sum.reads, sum.hits, w.writes,
+        sum.reads * 1000000.0 / us, sum.failures );
+    failures += sum.failures;
+    test.yield = False;
+  }
+
+  if( bench ) {
+    int n = 1;
+    for(;;) {
+      unsigned long rus = __run( &test, workers, n, 0, &__reader, ms );
+      double rcu = 0.0;
+      unsigned long mus = 0;
+      __sum( workers, 0, n, &sum );
+      rcu = sum.reads * 1000000.0 / rus;
+      failures += sum.failures;
+
+      mus = __run( &test, workers, n, 0, &__mapReader, ms );
+      __sum( workers, 0, n, &sum );
+      failures += sum.failures;
+
+      TraceOp.println( "bench: readers=%d rcumap reads/s=%.0f mutexmap reads/s=%.0f",
+          n, rcu, sum.reads * 1000000.0 / mus );
+      if( n == readers )
+        break;
+      n = n * 2 > readers ? readers : n * 2;
+    }
+  }
+
+  /* free the items; no reader is left */
+  for( i = 0; i < test.keys * 4; i++ ) {
+    char key[32];
+    sprintf( key, "k%d", i );
+    struct RcuItem* item = (struct RcuItem*)RcuMapOp.remove( test.rcumap, key );
+    if( item != NULL )
+      freeMem( item );
+    item = (struct RcuItem*)MapOp.remove( test.map, key );
+    if( item != NULL )
+      freeMem( item );
+  }
+  RcuMapOp.base.del( test.rcumap );
+  MapOp.base.del( test.map );
+  MutexOp.base.del( test.mapmux );
+  MutexOp.base.del( test.mux );
+  freeMem( workers );
+
+  TraceOp.println( "%s: %lu failures", name, failures );
+  return failures > 0 ? 1 : 0;
+}
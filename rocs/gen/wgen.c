@@ -842,8 +842,24 @@ static void __wrpCreate( iONode node, const char* modulename ) {
     }
 
 
+    FileOp.fmt( fPublH, "  struct __attrdef** (*schema)(void);\n" );
     FileOp.fmt( fPublH, "  Boolean (*dump)(iONode node);\n" );
 
+    /* The sorted attribute table; the index is the field id used by binary codecs. */
+    FileOp.fmt( fImplC, "\n/* -s-c-h-e-m-a-------------------------------------------------\n" );
+    FileOp.fmt( fImplC, " * attributes sorted by name; index = field id\n" );
+    FileOp.fmt( fImplC, " */\n" );
+    FileOp.fmt( fImplC, "static struct __attrdef* attrSchema[%d] = {\n", ListOp.size( attrList ) + 1 );
+    for( i = 0; i < ListOp.size( attrList ); i++ ) {
+      FileOp.fmt( fImplC, "  &%s,\n", (const char*)ListOp.get( attrList, i ) );
+    }
+    FileOp.fmt( fImplC, "  NULL\n" );
+    FileOp.fmt( fImplC, "};\n" );
+    FileOp.fmt( fImplC, "static struct __attrdef** _node_schema(void) {\n" );
+    FileOp.fmt( fImplC, "  return attrSchema;\n" );
+    FileOp.fmt( fImplC, "}\n" );
+    ListOp.add( opList, (obj)"_node_schema" );
+
 
 
     FileOp.fmt( fImplC, "\n/* -a-t-t-r-i-b-u-t-e-t-e-s-t----------------------------------\n" );
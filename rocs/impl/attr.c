@@ -29,6 +29,8 @@
 #include "rocs/public/trace.h"
 #include "rocs/public/doc.h"
 #include "rocs/public/system.h"
+#include "rocs/public/node.h"
+#include "rocs/public/mutex.h"
 
 
 static int instCnt = 0;
@@ -895,7 +897,10 @@ static const char* _getEscVal( iOAttr inst ) {
  */
 static void _setVal( iOAttr inst, const char* val ) {
   iOAttrData data = Data(inst);
+  iOMutex guard = NodeOp.getGuard();
+  if( guard != NULL ) MutexOp.wait( guard );
   __escapeStr( inst, val );
+  if( guard != NULL ) MutexOp.post( guard );
 }
 
 
@@ -916,10 +921,13 @@ static int _getInt( iOAttr inst ) {
 static void _setInt( iOAttr inst, int val ) {
   iOAttrData data = Data(inst);
   char ival[256];
+  iOMutex guard = NodeOp.getGuard();
   sprintf( ival, "%d", val );
+  if( guard != NULL ) MutexOp.wait( guard );
   if( data->val != NULL )
     StrOp.freeID( data->val, RocsAttrID );
   data->val = StrOp.dupID( ival, RocsAttrID );
+  if( guard != NULL ) MutexOp.post( guard );
 }
 
 
@@ -940,10 +948,13 @@ static long _getLong( iOAttr inst ) {
 static void _setLong( iOAttr inst, long val ) {
   iOAttrData data = Data(inst);
   char ival[256];
+  iOMutex guard = NodeOp.getGuard();
   sprintf( ival, "%ld", val );
+  if( guard != NULL ) MutexOp.wait( guard );
   if( data->val != NULL )
     StrOp.freeID( data->val, RocsAttrID );
   data->val = StrOp.dupID( ival, RocsAttrID );
+  if( guard != NULL ) MutexOp.post( guard );
 }
 
 
@@ -971,9 +982,12 @@ static Boolean _getBoolean( iOAttr inst ) {
 static void _setBoolean( iOAttr inst, Boolean val ) {
   iOAttrData data = Data(inst);
   char* bval = val==True ? "true":"false";
+  iOMutex guard = NodeOp.getGuard();
+  if( guard != NULL ) MutexOp.wait( guard );
   if( data->val != NULL )
     StrOp.freeID( data->val, RocsAttrID );
   data->val = StrOp.dupID( bval, RocsAttrID );
+  if( guard != NULL ) MutexOp.post( guard );
 }
 
 
@@ -994,10 +1008,13 @@ static double _getFloat( iOAttr inst ) {
 static void _setFloat( iOAttr inst, double val ) {
   iOAttrData data = Data(inst);
   char ival[256];
+  iOMutex guard = NodeOp.getGuard();
   sprintf( ival, "%f", val );
+  if( guard != NULL ) MutexOp.wait( guard );
   if( data->val != NULL )
     StrOp.freeID( data->val, RocsAttrID );
   data->val = StrOp.dupID( ival, RocsAttrID );
+  if( guard != NULL ) MutexOp.post( guard );
 }
 
 
@@ -27,6 +27,10 @@
 #include "rocs/public/mem.h"
 #include "rocs/public/str.h"
 
+#ifdef __ZLIB__
+#include <zlib.h>
+#endif
+
 
 static int instCnt = 0;
 
@@ -67,6 +71,17 @@ static char* __toString(void* inst) {
 static void __del(void* inst) {
   iOGZip     attr = inst;
   iOGZipData data = Data(inst);
+#ifdef __ZLIB__
+  if( data->deflater != NULL ) {
+    deflateEnd( (z_stream*)data->deflater );
+    freeMem( data->deflater );
+  }
+  if( data->inflater != NULL ) {
+    inflateEnd( (z_stream*)data->inflater );
+    freeMem( data->inflater );
+  }
+#endif
+  StrOp.free( data->dictionary );
   freeMem( data );
   freeMem( attr );
   instCnt--;
@@ -85,26 +100,120 @@ static int _getRc( iOGZip inst ) {
 }
 
 
-static Boolean _compress( iOGZip inst ) {
-  iOGZipData data = Data(inst);
-  if( data == NULL )
-    return False;
+static Boolean _isAvailable( void ) {
+#ifdef __ZLIB__
+  return True;
+#else
   return False;
+#endif
 }
 
-static Boolean _deCompress( iOGZip inst ) {
+
+/* The streams are kept and only reset per block; a fresh deflateInit
+   would cost more than compressing a typical event. */
+static byte* _compress( iOGZip inst, const byte* in, int len, int* outlen ) {
+#ifdef __ZLIB__
   iOGZipData data = Data(inst);
-  if( data == NULL )
-    return False;
-  return False;
+  z_stream*    zs = (z_stream*)data->deflater;
+  byte*       out = NULL;
+  int       bound = 0;
+
+  if( zs == NULL ) {
+    zs = allocMem( sizeof( z_stream ) );
+    data->rc = deflateInit( zs, data->level );
+    if( data->rc != Z_OK ) {
+      freeMem( zs );
+      return NULL;
+    }
+    data->deflater = zs;
+  }
+  else {
+    deflateReset( zs );
+  }
+
+  if( data->dictlen > 0 )
+    deflateSetDictionary( zs, (const Bytef*)data->dictionary, data->dictlen );
+
+  bound = deflateBound( zs, len );
+  out = allocMem( bound );
+  zs->next_in   = (Bytef*)in;
+  zs->avail_in  = len;
+  zs->next_out  = out;
+  zs->avail_out = bound;
+
+  data->rc = deflate( zs, Z_FINISH );
+  if( data->rc != Z_STREAM_END ) {
+    freeMem( out );
+    return NULL;
+  }
+
+  *outlen = bound - zs->avail_out;
+  return out;
+#else
+  return NULL;
+#endif
 }
 
-static iOGZip _inst( const char* name ) {
+
+static byte* _deCompress( iOGZip inst, const byte* in, int len, int rawlen ) {
+#ifdef __ZLIB__
+  iOGZipData data = Data(inst);
+  z_stream*    zs = (z_stream*)data->inflater;
+  byte*       out = NULL;
+
+  if( rawlen <= 0 )
+    return NULL;
+
+  if( zs == NULL ) {
+    zs = allocMem( sizeof( z_stream ) );
+    data->rc = inflateInit( zs );
+    if( data->rc != Z_OK ) {
+      freeMem( zs );
+      return NULL;
+    }
+    data->inflater = zs;
+  }
+  else {
+    inflateReset( zs );
+  }
+
+  out = allocMem( rawlen + 1 );
+  zs->next_in   = (Bytef*)in;
+  zs->avail_in  = len;
+  zs->next_out  = out;
+  zs->avail_out = rawlen;
+
+  data->rc = inflate( zs, Z_FINISH );
+  if( data->rc == Z_NEED_DICT && data->dictlen > 0 ) {
+    /* fails with Z_DATA_ERROR if the peer used another dictionary */
+    data->rc = inflateSetDictionary( zs, (const Bytef*)data->dictionary, data->dictlen );
+    if( data->rc == Z_OK )
+      data->rc = inflate( zs, Z_FINISH );
+  }
+
+  if( data->rc != Z_STREAM_END || zs->total_out != (uLong)rawlen ) {
+    freeMem( out );
+    return NULL;
+  }
+
+  out[rawlen] = '\0';
+  return out;
+#else
+  return NULL;
+#endif
+}
+
+
+static iOGZip _inst( const char* dictionary, int level ) {
   iOGZip     obj  = allocMem( sizeof( struct OGZip     ) );
   iOGZipData data = allocMem( sizeof( struct OGZipData ) );
 
   /* OGZipData */
-  data->name = StrOp.dup( name );
+  if( dictionary != NULL ) {
+    data->dictionary = StrOp.dup( dictionary );
+    data->dictlen    = StrOp.len( dictionary );
+  }
+  data->level = level;
 
   /* OBase operations */
   MemOp.basecpy( obj, &GZipOp, 0, sizeof( struct OGZip ), data );
@@ -0,0 +1,331 @@
+/*
+ Rocs - OS independent C library
+
+ Copyright (C) 2002-2014 Rob Versluis, Rocrail.net
+
+
+
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public License
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rocs/impl/metrics_impl.h"
+#include "rocs/public/mem.h"
+#include "rocs/public/str.h"
+#include "rocs/public/trace.h"
+
+/* OS dependent: (unix)usystem.c uthread.c (windows)wsystem.c wthread.c */
+unsigned long rocs_system_getMicros( void );
+unsigned long rocs_thread_id( void );
+
+#ifdef __GNUC__
+  #define METRIC_ADD(p,v)   __sync_fetch_and_add( (p), (v) )
+  #define METRIC_CAS(p,o,n) __sync_bool_compare_and_swap( (p), (o), (n) )
+  #define METRIC_SYNC()     __sync_synchronize()
+#else
+  #define METRIC_ADD(p,v)   ( *(p) += (v) )
+  #define METRIC_CAS(p,o,n) ( *(p) = (n), 1 )
+  #define METRIC_SYNC()
+#endif
+
+/* One cache line per shard so threads do not share it. */
+typedef struct {
+  long count;
+  long sum;
+  long max;
+  long pad[5];
+} __metricShard;
+
+typedef struct {
+  char* name;
+  char* desc;
+  int   type;
+  __metricShard shard[METRICS_SHARDS];
+  /* histograms only: a row of METRICS_BUCKETS per shard */
+  long* buckets;
+} __metric;
+
+static __metric* __metrics[METRICS_MAX];
+static int       __metricCnt = 0;
+static iOMutex   __mux = NULL;
+
+
+static __metric* __get( int id ) {
+  if( id < 0 || id >= __metricCnt )
+    return NULL;
+  return __metrics[id];
+}
+
+/* pthread ids are far apart but share the low bits; mix them before picking a shard. */
+static int __shardIdx( void ) {
+  unsigned long tid = rocs_thread_id();
+  unsigned int h = (unsigned int)( tid ^ ( ( tid >> 16 ) >> 16 ) );
+  h ^= h >> 16;
+  h *= 0x45d9f3b;
+  h ^= h >> 16;
+  return h % METRICS_SHARDS;
+}
+
+/* 0 for v <= 0, else the number of significant bits: bucket b holds 2^(b-1)...2^b-1. */
+static int __bucket( long v ) {
+  int b = 0;
+  if( v <= 0 )
+    return 0;
+#ifdef __GNUC__
+  b = (int)( sizeof(long) * 8 ) - __builtin_clzl( (unsigned long)v );
+#else
+  while( v > 0 ) {
+    b++;
+    v >>= 1;
+  }
+#endif
+  return b < METRICS_BUCKETS ? b:METRICS_BUCKETS - 1;
+}
+
+static void __max( long* p, long v ) {
+  long cur = *p;
+  while( v > cur && !METRIC_CAS( p, cur, v ) )
+    cur = *p;
+}
+
+static void _init( void );
+
+static int __register( const char* metric, const char* desc, int type ) {
+  int id = -1;
+  int i = 0;
+  Boolean full = False;
+
+  /* for programs not calling init */
+  _init();
+
+  MutexOp.wait( __mux );
+  for( i = 0; i < __metricCnt; i++ ) {
+    if( StrOp.equals( __metrics[i]->name, metric ) ) {
+      id = i;
+      break;
+    }
+  }
+
+  if( id == -1 && __metricCnt < METRICS_MAX ) {
+    __metric* m = allocMem( sizeof( __metric ) );
+    m->name = StrOp.dup( metric );
+    m->desc = StrOp.dup( desc );
+    m->type = type;
+    if( type == METRIC_HISTOGRAM )
+      m->buckets = allocMem( METRICS_SHARDS * METRICS_BUCKETS * sizeof( long ) );
+    __metrics[__metricCnt] = m;
+    /* readers do not lock; publish the slot before the count */
+    METRIC_SYNC();
+    id = __metricCnt;
+    __metricCnt++;
+  }
+  else if( id == -1 )
+    full = True;
+  MutexOp.post( __mux );
+
+  if( full )
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "registry full; metric [%s] not recorded", metric );
+  return id;
+}
+
+
+/*
+ ***** _Public functions.
+ */
+static void _init( void ) {
+  if( __mux == NULL ) {
+    iOMutex mux = MutexOp.inst( NULL, True );
+    /* a racing second caller drops its lock */
+    if( !METRIC_CAS( &__mux, NULL, mux ) )
+      MutexOp.base.del( mux );
+  }
+}
+
+static int _counter( const char* name, const char* desc ) {
+  return __register( name, desc, METRIC_COUNTER );
+}
+
+static int _gauge( const char* name, const char* desc ) {
+  return __register( name, desc, METRIC_GAUGE );
+}
+
+static int _histogram( const char* name, const char* desc ) {
+  return __register( name, desc, METRIC_HISTOGRAM );
+}
+
+static void _add( int id, long val ) {
+  __metric* m = __get( id );
+  if( m != NULL )
+    METRIC_ADD( &m->shard[__shardIdx()].count, val );
+}
+
+static void _set( int id, long val ) {
+  __metric* m = __get( id );
+  if( m != NULL ) {
+    m->shard[0].count = val;
+    __max( &m->shard[0].max, val );
+  }
+}
+
+static void _observe( int id, long val ) {
+  __metric* m = __get( id );
+  if( m != NULL && m->buckets != NULL ) {
+    int idx = __shardIdx();
+    __metricShard* s = &m->shard[idx];
+    METRIC_ADD( &s->count, 1 );
+    METRIC_ADD( &s->sum, val );
+    __max( &s->max, val );
+    METRIC_ADD( &m->buckets[idx * METRICS_BUCKETS + __bucket( val )], 1 );
+  }
+}
+
+static unsigned long _now( void ) {
+  return rocs_system_getMicros();
+}
+
+static void _since( int id, unsigned long t0 ) {
+  if( id != -1 )
+    _observe( id, (long)( rocs_system_getMicros() - t0 ) );
+}
+
+static int _getCount( void ) {
+  return __metricCnt;
+}
+
+static const char* _getName( int id ) {
+  __metric* m = __get( id );
+  return m != NULL ? m->name:NULL;
+}
+
+static const char* _getDesc( int id ) {
+  __metric* m = __get( id );
+  return m != NULL ? m->desc:NULL;
+}
+
+static int _getType( int id ) {
+  __metric* m = __get( id );
+  return m != NULL ? m->type:-1;
+}
+
+/* Upper bound of the bucket holding the q per mille sample, clipped to the maximum. */
+static long __percentile( __metric* m, int q, long max ) {
+  long buckets[METRICS_BUCKETS];
+  long total = 0;
+  long cum = 0;
+  int i = 0;
+  int b = 0;
+
+  MemOp.set( buckets, 0, sizeof( buckets ) );
+  for( i = 0; i < METRICS_SHARDS; i++ ) {
+    for( b = 0; b < METRICS_BUCKETS; b++ )
+      buckets[b] += m->buckets[i * METRICS_BUCKETS + b];
+  }
+  for( b = 0; b < METRICS_BUCKETS; b++ )
+    total += buckets[b];
+  if( total == 0 )
+    return 0;
+
+  for( b = 0; b < METRICS_BUCKETS; b++ ) {
+    cum += buckets[b];
+    if( cum * 1000 >= total * q ) {
+      long upper = b == 0 ? 0:( 1L << b ) - 1;
+      return upper < max ? upper:max;
+    }
+  }
+  return max;
+}
+
+static long _getValue( int id, int field ) {
+  __metric* m = __get( id );
+  long val = 0;
+  long max = 0;
+  int i = 0;
+
+  if( m == NULL )
+    return 0;
+
+  if( m->type == METRIC_GAUGE )
+    return field == METRIC_MAX ? m->shard[0].max:m->shard[0].count;
+
+  for( i = 0; i < METRICS_SHARDS; i++ ) {
+    if( field == METRIC_SUM && m->type == METRIC_HISTOGRAM )
+      val += m->shard[i].sum;
+    else
+      val += m->shard[i].count;
+    if( m->shard[i].max > max )
+      max = m->shard[i].max;
+  }
+
+  if( field == METRIC_VALUE || field == METRIC_SUM )
+    return val;
+  if( m->type == METRIC_COUNTER )
+    return 0;
+  if( field == METRIC_MAX )
+    return max;
+  if( field == METRIC_P50 )
+    return __percentile( m, 500, max );
+  if( field == METRIC_P99 )
+    return __percentile( m, 990, max );
+  return 0;
+}
+
+static char* _toText( const char* prefix ) {
+  static const char* types[] = {"counter","gauge","histogram"};
+  char* text = StrOp.dup( "" );
+  char line[256];
+  int cnt = __metricCnt;
+  int id = 0;
+
+  if( prefix == NULL )
+    prefix = "";
+
+  for( id = 0; id < cnt; id++ ) {
+    __metric* m = __metrics[id];
+    StrOp.fmtb( line, "# HELP %s%s %s\n# TYPE %s%s %s\n",
+        prefix, m->name, m->desc, prefix, m->name, types[m->type] );
+    text = StrOp.cat( text, line );
+
+    if( m->type == METRIC_HISTOGRAM ) {
+      long cum = 0;
+      long count = _getValue( id, METRIC_VALUE );
+      int b = 0;
+      int i = 0;
+      for( b = 0; b < METRICS_BUCKETS - 1 && cum < count; b++ ) {
+        for( i = 0; i < METRICS_SHARDS; i++ )
+          cum += m->buckets[i * METRICS_BUCKETS + b];
+        StrOp.fmtb( line, "%s%s_bucket{le=\"%ld\"} %ld\n", prefix, m->name, b == 0 ? 0:( 1L << b ) - 1, cum );
+        text = StrOp.cat( text, line );
+      }
+      StrOp.fmtb( line, "%s%s_bucket{le=\"+Inf\"} %ld\n%s%s_sum %ld\n%s%s_count %ld\n",
+          prefix, m->name, count, prefix, m->name, _getValue( id, METRIC_SUM ), prefix, m->name, count );
+      text = StrOp.cat( text, line );
+      StrOp.fmtb( line, "# TYPE %s%s_max gauge\n%s%s_max %ld\n",
+          prefix, m->name, prefix, m->name, _getValue( id, METRIC_MAX ) );
+      text = StrOp.cat( text, line );
+    }
+    else {
+      StrOp.fmtb( line, "%s%s %ld\n", prefix, m->name, _getValue( id, METRIC_VALUE ) );
+      text = StrOp.cat( text, line );
+    }
+  }
+  return text;
+}
+
+
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
+#include "rocs/impl/metrics.fm"
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
@@ -28,6 +28,7 @@
 #include "rocs/public/mem.h"
 #include "rocs/public/str.h"
 #include "rocs/public/trace.h"
+#include "rocs/public/mutex.h"
 
 
 static int instCnt = 0;
@@ -149,9 +150,19 @@ static Boolean __equals( void* inst1, void* inst2 ) {
   return False;
 }
 
+static iOMutex __guard = NULL;
+
 /*
  ***** ONode operations.
  */
+static void _setGuard( iOMutex guard ) {
+  __guard = guard;
+}
+
+static iOMutex _getGuard( void ) {
+  return __guard;
+}
+
 static char* _toEscString( iONode inst ) {
   return DocOp.node2String( inst, True );
 }
@@ -163,34 +174,45 @@ static void _setParent( iONode inst, iONode parent ) {
 
 static void _addChild( iONode inst, iONode child ) {
   iONodeData data = Data(inst);
+  iOMutex guard = __guard;
   if( child == NULL )
     return;
+  if( guard != NULL ) MutexOp.wait( guard );
   if( data->childs == NULL )
     data->childs = allocIDMem( (data->childCnt+1) * sizeof( iONode ), RocsNodeID );
   else
     data->childs = reallocMem( data->childs, (data->childCnt+1) * sizeof( iONode ) );
   data->childs[ data->childCnt ] = child;
   data->childCnt++;
+  if( guard != NULL ) MutexOp.post( guard );
 }
 
 static iONode _removeChild( iONode inst, iONode child ) {
   iONodeData data = Data(inst);
+  iOMutex guard = __guard;
   int i = 0;
-  int cnt = data->childCnt;
+  int cnt = 0;
+  iONode removed = NULL;
+  if( guard != NULL ) MutexOp.wait( guard );
+  cnt = data->childCnt;
   for( i = 0; i < cnt; i++ ) {
     if( data->childs[i] == child ) {
       data->childs[i] = 0;
       memmove( &data->childs[i], &data->childs[i+1], ( data->childCnt - (i + 1) )* sizeof( iONode ) );
       data->childCnt--;
       data->childs = reallocMem( data->childs, (data->childCnt+1) * sizeof( iONode ) );
-      return child;
+      removed = child;
+      break;
     }
   }
-  return NULL;
+  if( guard != NULL ) MutexOp.post( guard );
+  return removed;
 }
 
 static void _addAttr( iONode inst, iOAttr attr ) {
   iONodeData data = Data(inst);
+  iOMutex guard = __guard;
+  if( guard != NULL ) MutexOp.wait( guard );
   if( data->attrs == NULL )
     data->attrs = allocIDMem( (data->attrCnt+1) * sizeof( iOAttr ), RocsNodeID );
   else
@@ -198,14 +220,17 @@ static void _addAttr( iONode inst, iOAttr attr ) {
   data->attrs[ data->attrCnt ] = attr;
   data->attrCnt++;
   MapOp.put( data->attrmap, AttrOp.getName( attr ), (obj)attr );
+  if( guard != NULL ) MutexOp.post( guard );
 }
 
 static void _removeAttr( iONode inst, iOAttr attr ) {
   iONodeData data = Data(inst);
+  iOMutex guard = __guard;
   int i;
   if( attr == NULL )
     return;
 
+  if( guard != NULL ) MutexOp.wait( guard );
   for( i = 0; i < data->attrCnt; i++ ) {
     if( data->attrs[i] == attr ) {
       MapOp.remove( data->attrmap, AttrOp.getName( attr ) );
@@ -218,6 +243,7 @@ static void _removeAttr( iONode inst, iOAttr attr ) {
       break;
     }
   }
+  if( guard != NULL ) MutexOp.post( guard );
 }
 
 static iOAttr _findAttr( iONode inst, const char* aname ) {
@@ -29,6 +29,8 @@
 
 
 static int instCnt = 0;
+static int __depthMetric  = -1;
+static int __rejectMetric = -1;
 
 /*
  ***** OBase functions.
@@ -140,12 +142,16 @@ static Boolean _post( iOQueue inst, obj po, q_prio prio ) {
   Boolean rc = False;
 
   if( data->count < data->size ) {
+    int depth = 0;
     MutexOp.wait( data->mux );
     rc = __addMsg( data, __newQMsg( po, prio ) );
+    depth = data->count;
     MutexOp.post( data->mux );
     EventOp.set( data->evt );
+    MetricsOp.observe( __depthMetric, depth );
   }
   else {
+    MetricsOp.add( __rejectMetric, 1 );
     TraceOp.trc( name, TRCLEVEL_INFO, __LINE__, 9999,
         "QueueOp.post: count(%d) is getting bigger than size(%d)! Post rejected for [%s].",
         data->count, data->size, data->desc==NULL?"":data->desc );
@@ -220,6 +226,11 @@ static iOQueue _inst( int size ) {
   EventOp.reset( data->evt );
   data->size = size;
 
+  if( __depthMetric == -1 ) {
+    __depthMetric  = MetricsOp.histogram( "queue_depth", "Queue depth after a post." );
+    __rejectMetric = MetricsOp.counter( "queue_rejected_total", "Posts rejected by a full queue." );
+  }
+
   instCnt++;
 
   return queue;
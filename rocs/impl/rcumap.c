@@ -0,0 +1,369 @@
+/*
+ Rocs - OS independent C library
+
+ Copyright (C) 2002-2014 Rob Versluis, Rocrail.net
+
+
+
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public License
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rocs/impl/rcumap_impl.h"
+#include "rocs/public/mem.h"
+#include "rocs/public/str.h"
+
+/*
+ Readers probe the published table without a lock. A table is never
+ rearranged in place: a new key goes into a free slot and is published
+ last, a removal only clears the value. Growing, purging removed keys and
+ clear() build a new table, publish it and free the old one after a grace
+ period.
+
+ A lookup counts itself in the reader counter of the current epoch parity.
+ synchronize() flips the epoch twice and waits for the counters of the
+ previous parity to drain each time, so every lookup that could still see
+ the old table has finished; new lookups are never held up. enter() and
+ leave() give callers the same protection for data they publish themselves.
+*/
+
+/* OS dependent: (unix)uthread.c (windows)wthread.c */
+unsigned long rocs_thread_id( void );
+
+#ifdef __GNUC__
+  #define RCU_LOAD(p)    __atomic_load_n( (p), __ATOMIC_SEQ_CST )
+  #define RCU_STORE(p,v) __atomic_store_n( (p), (v), __ATOMIC_SEQ_CST )
+  #define RCU_ADD(p,v)   __atomic_fetch_add( (p), (v), __ATOMIC_SEQ_CST )
+#else
+  #define RCU_LOAD(p)    ( *(p) )
+  #define RCU_STORE(p,v) ( *(p) = (v) )
+  #define RCU_ADD(p,v)   ( *(p) += (v) )
+#endif
+
+static int instCnt = 0;
+
+static void __freeTable( iRcuTable t );
+
+/*
+ ***** OBase operations.
+ */
+static void __del( void* inst ) {
+  if( inst != NULL ) {
+    iORcuMapData data = Data(inst);
+    __freeTable( data->table );
+    freeMem( data->readers );
+    MutexOp.base.del( data->mux );
+    freeMem( data );
+    freeMem( inst );
+    instCnt--;
+  }
+}
+
+static const char* __name( void ) {
+  return name;
+}
+
+static unsigned char* __serialize( void* inst, long* size ) {
+  return NULL;
+}
+
+static void __deserialize( void* inst,unsigned char* bytestream ) {
+  return;
+}
+
+static char* __toString( void* inst ) {
+  return NULL;
+}
+
+static int __count( void ) {
+  return instCnt;
+}
+
+static struct OBase* __clone( void* inst ) {
+  return NULL;
+}
+
+static Boolean __equals( void* inst1, void* inst2 ) {
+  return False;
+}
+
+static void* __properties( void* inst ) {
+  return NULL;
+}
+
+static const char* __id( void* inst ) {
+  return NULL;
+}
+
+static void* __event( void* inst, const void* evt ) {
+  return NULL;
+}
+
+
+/* FNV-1a */
+static unsigned int __hash( const char* key ) {
+  unsigned int h = 2166136261U;
+  while( *key != '\0' ) {
+    h ^= (unsigned char)*key++;
+    h *= 16777619U;
+  }
+  return h;
+}
+
+/* Same thread id mixing as the metrics shards. */
+static int __shard( void ) {
+  unsigned long tid = rocs_thread_id();
+  unsigned int h = (unsigned int)( tid ^ ( ( tid >> 16 ) >> 16 ) );
+  h ^= h >> 16;
+  h *= 0x45d9f3b;
+  h ^= h >> 16;
+  return h % RCUMAP_SHARDS;
+}
+
+static iRcuTable __newTable( int size ) {
+  iRcuTable t = allocMem( sizeof( struct RcuTable ) );
+  t->mask  = size - 1;
+  t->slots = allocMem( size * sizeof( struct RcuSlot ) );
+  return t;
+}
+
+static void __freeTable( iRcuTable t ) {
+  unsigned int i = 0;
+  if( t == NULL )
+    return;
+  for( i = 0; i <= t->mask; i++ ) {
+    if( t->slots[i].key != NULL )
+      StrOp.free( t->slots[i].key );
+  }
+  freeMem( t->slots );
+  freeMem( t );
+}
+
+/* Slot holding the key, or the free slot where it belongs. */
+static iRcuSlot __probe( iRcuTable t, const char* key, unsigned int h ) {
+  unsigned int i = h & t->mask;
+  while( t->slots[i].key != NULL ) {
+    if( t->slots[i].hash == h && StrOp.equals( t->slots[i].key, key ) )
+      break;
+    i = ( i + 1 ) & t->mask;
+  }
+  return &t->slots[i];
+}
+
+static void __grace( iORcuMapData data ) {
+  int round = 0;
+  for( round = 0; round < 2; round++ ) {
+    long prev = data->epoch;
+    int i = 0;
+    RCU_STORE( &data->epoch, prev + 1 );
+    for( i = 0; i < RCUMAP_SHARDS; i++ ) {
+      while( RCU_LOAD( &data->readers[( prev & 1 ) * RCUMAP_SHARDS + i].cnt ) != 0 )
+        ThreadOp.sleep( 0 );
+    }
+  }
+}
+
+/* Publish a new table and free the old one once no lookup can use it;
+   called with the writer lock. */
+static void __replace( iORcuMapData data, iRcuTable t ) {
+  iRcuTable old = data->table;
+  RCU_STORE( &data->table, t );
+  __grace( data );
+  __freeTable( old );
+}
+
+/* Copy the live items into a table of at least four times their number. */
+static iRcuTable __rebuild( iRcuTable old, int live ) {
+  int size = RCUMAP_MINSIZE;
+  iRcuTable t = NULL;
+  unsigned int i = 0;
+
+  while( size < live * 4 )
+    size *= 2;
+  t = __newTable( size );
+
+  for( i = 0; i <= old->mask; i++ ) {
+    iRcuSlot s = &old->slots[i];
+    if( s->key != NULL && s->o != NULL ) {
+      iRcuSlot n = __probe( t, s->key, s->hash );
+      n->key  = StrOp.dup( s->key );
+      n->hash = s->hash;
+      n->o    = s->o;
+      t->used++;
+      t->live++;
+    }
+  }
+  return t;
+}
+
+
+/*
+ ***** _Public functions.
+ */
+static int _enter( iORcuMap inst ) {
+  iORcuMapData data = Data(inst);
+  int token = ( RCU_LOAD( &data->epoch ) & 1 ) * RCUMAP_SHARDS + __shard();
+  RCU_ADD( &data->readers[token].cnt, 1 );
+  return token;
+}
+
+
+static void _leave( iORcuMap inst, int token ) {
+  iORcuMapData data = Data(inst);
+  RCU_ADD( &data->readers[token].cnt, -1 );
+}
+
+
+static obj _get( iORcuMap inst, const char* key ) {
+  iORcuMapData data = Data(inst);
+  iRcuTable t = NULL;
+  unsigned int h = 0;
+  unsigned int i = 0;
+  int token = 0;
+  obj o = NULL;
+
+  if( key == NULL || *key == '\0' )
+    return NULL;
+
+  h = __hash( key );
+  token = _enter( inst );
+
+  t = RCU_LOAD( &data->table );
+  i = h & t->mask;
+  for(;;) {
+    const char* k = RCU_LOAD( &t->slots[i].key );
+    if( k == NULL )
+      break;
+    if( t->slots[i].hash == h && StrOp.equals( k, key ) ) {
+      o = RCU_LOAD( &t->slots[i].o );
+      break;
+    }
+    i = ( i + 1 ) & t->mask;
+  }
+
+  _leave( inst, token );
+  return o;
+}
+
+
+static obj _remove( iORcuMap inst, const char* key ) {
+  iORcuMapData data = Data(inst);
+  obj o = NULL;
+
+  if( key == NULL )
+    return NULL;
+
+  MutexOp.wait( data->mux );
+  {
+    iRcuTable t = data->table;
+    iRcuSlot s = __probe( t, key, __hash( key ) );
+    if( s->key != NULL && s->o != NULL ) {
+      o = s->o;
+      RCU_STORE( &s->o, NULL );
+      t->live--;
+    }
+  }
+  MutexOp.post( data->mux );
+
+  return o;
+}
+
+
+static void _put( iORcuMap inst, const char* key, obj val ) {
+  iORcuMapData data = Data(inst);
+  unsigned int h = 0;
+  iRcuTable t = NULL;
+  iRcuSlot s = NULL;
+
+  if( key == NULL || *key == '\0' )
+    return;
+  if( val == NULL ) {
+    _remove( inst, key );
+    return;
+  }
+
+  h = __hash( key );
+  MutexOp.wait( data->mux );
+  t = data->table;
+  s = __probe( t, key, h );
+
+  if( s->key != NULL ) {
+    if( s->o == NULL )
+      t->live++;
+    RCU_STORE( &s->o, val );
+  }
+  else {
+    /* keep at least half of the slots free; removed keys are dropped when rebuilding */
+    if( ( t->used + 1 ) * 2 > (int)( t->mask + 1 ) ) {
+      t = __rebuild( t, t->live + 1 );
+      __replace( data, t );
+      s = __probe( t, key, h );
+    }
+    s->hash = h;
+    RCU_STORE( &s->o, val );
+    RCU_STORE( &s->key, StrOp.dup( key ) );
+    t->used++;
+    t->live++;
+  }
+
+  MutexOp.post( data->mux );
+}
+
+
+static int _size( iORcuMap inst ) {
+  iORcuMapData data = Data(inst);
+  int size = 0;
+  MutexOp.wait( data->mux );
+  size = data->table->live;
+  MutexOp.post( data->mux );
+  return size;
+}
+
+
+static void _clear( iORcuMap inst ) {
+  iORcuMapData data = Data(inst);
+  MutexOp.wait( data->mux );
+  __replace( data, __newTable( RCUMAP_MINSIZE ) );
+  MutexOp.post( data->mux );
+}
+
+
+static void _synchronize( iORcuMap inst ) {
+  iORcuMapData data = Data(inst);
+  MutexOp.wait( data->mux );
+  __grace( data );
+  MutexOp.post( data->mux );
+}
+
+
+static iORcuMap _inst( void ) {
+  iORcuMap __RcuMap = allocMem( sizeof( struct ORcuMap ) );
+  iORcuMapData data = allocMem( sizeof( struct ORcuMapData ) );
+  MemOp.basecpy( __RcuMap, &RcuMapOp, 0, sizeof( struct ORcuMap ), data );
+
+  data->table   = __newTable( RCUMAP_MINSIZE );
+  data->readers = allocMem( 2 * RCUMAP_SHARDS * sizeof( struct RcuReaders ) );
+  data->mux     = MutexOp.inst( NULL, True );
+
+  instCnt++;
+  return __RcuMap;
+}
+
+
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
+#include "rocs/impl/rcumap.fm"
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
@@ -65,6 +65,7 @@ Boolean rocs_socket_listen( iOSocketData o );
 Boolean rocs_socket_write( iOSocket inst, const char* buf, int size );
 Boolean rocs_socket_read( iOSocket inst, char* buf, int size );
 int rocs_socket_recvfrom( iOSocket inst, char* buf, int size, char* client, int* port );
+int rocs_socket_recvBatch( iOSocket inst, char* frames, int framesize, int maxframes, int* sizes );
 Boolean rocs_socket_sendto( iOSocket inst, char* buf, int size, char* client, int port );
 int rocs_socket_accept( iOSocket inst );
 Boolean rocs_socket_setSndTimeout( iOSocket inst, int timeout );
@@ -116,6 +117,9 @@ static void __del(void* inst) {
   if( data->hostaddr != NULL )
     freeIDMem( data->hostaddr, RocsSocketID );
 
+  if( data->batch != NULL )
+    freeIDMem( data->batch, RocsSocketID );
+
   StrOp.freeID( data->host, RocsSocketID );
   freeIDMem( data, RocsSocketID );
   freeIDMem( inst, RocsSocketID );
@@ -262,6 +266,11 @@ static int _getRc( iOSocket inst ) {
   return data->rc;
 }
 
+static int _getSh( iOSocket inst ) {
+  iOSocketData data = Data(inst);
+  return data->sh;
+}
+
 static Boolean _isTimedOut( iOSocket inst ) {
   iOSocketData data = Data(inst);
   return data->rc == ETIMEDOUT ? True:False;
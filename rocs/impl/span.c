@@ -0,0 +1,313 @@
+/*
+ Rocs - OS independent C library
+
+ Copyright (C) 2002-2014 Rob Versluis, Rocrail.net
+
+
+
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public License
+ as published by the Free Software Foundation.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rocs/impl/span_impl.h"
+#include "rocs/public/mem.h"
+#include "rocs/public/str.h"
+#include "rocs/public/trace.h"
+
+/*
+ A mark claims the next ring slot with an atomic increment and publishes it
+ by writing the slot sequence last; toJson() skips slots which are being
+ written or were overwritten while copying. The previous mark of a span is
+ looked up in a small table indexed by the span id, so every mark can be
+ drawn as a slice from the previous stage and observed in the histogram of
+ its stage. Nothing is locked on the recording path and nothing is done at
+ all while recording is off.
+*/
+
+/* OS dependent: (unix)uthread.c (windows)wthread.c */
+unsigned long rocs_thread_id( void );
+
+#ifdef __GNUC__
+  #define SPAN_LOAD(p)    __atomic_load_n( (p), __ATOMIC_ACQUIRE )
+  #define SPAN_STORE(p,v) __atomic_store_n( (p), (v), __ATOMIC_RELEASE )
+  #define SPAN_ADD(p,v)   __atomic_fetch_add( (p), (v), __ATOMIC_RELAXED )
+  #define SPAN_CAS(p,o,n) __sync_bool_compare_and_swap( (p), (o), (n) )
+#else
+  #define SPAN_LOAD(p)    ( *(p) )
+  #define SPAN_STORE(p,v) ( *(p) = (v) )
+  #define SPAN_ADD(p,v)   ( ( *(p) += (v) ) - (v) )
+  #define SPAN_CAS(p,o,n) ( *(p) = (n), 1 )
+#endif
+
+typedef struct {
+  long seq;             /* ring index + 1 once published, 0 while written */
+  long span;
+  int  stage;
+  unsigned long tid;
+  unsigned long ts;
+  unsigned long prev;   /* time of the previous mark of the span; 0 if unknown */
+} __spanMark;
+
+typedef struct {
+  long span;
+  unsigned long ts;
+} __spanLast;
+
+typedef struct {
+  unsigned long tid;
+  long span;
+} __spanThread;
+
+static int          __enabled = 0;
+static __spanMark*  __ring = NULL;
+static long         __head = 0;
+static long         __nextId = 0;
+static __spanLast   __last[SPAN_OPEN];
+static __spanThread __threads[SPAN_THREADS];
+static char*        __stages[SPAN_STAGES];
+static int          __histo[SPAN_STAGES];
+static int          __stageCnt = 0;
+static int          __readStage = -1;
+static iOMutex      __mux = NULL;
+static int          __threadsFull = 0;
+
+
+static unsigned int __mix( unsigned long tid ) {
+  unsigned int h = (unsigned int)( tid ^ ( ( tid >> 16 ) >> 16 ) );
+  h ^= h >> 16;
+  h *= 0x45d9f3b;
+  h ^= h >> 16;
+  return h;
+}
+
+static void __initMux( void ) {
+  if( __mux == NULL ) {
+    iOMutex mux = MutexOp.inst( NULL, True );
+    /* a racing second caller drops its lock */
+    if( !SPAN_CAS( &__mux, NULL, mux ) )
+      MutexOp.base.del( mux );
+  }
+}
+
+static void __record( long span, int stage, unsigned long ts ) {
+  __spanLast* last = &__last[span & ( SPAN_OPEN - 1 )];
+  unsigned long prev = 0;
+  long i = SPAN_ADD( &__head, 1 );
+  __spanMark* m = &__ring[i & ( SPAN_RING - 1 )];
+
+  /* another span may share the entry; only trust it if it is still ours after reading */
+  if( SPAN_LOAD( &last->span ) == span ) {
+    prev = SPAN_LOAD( &last->ts );
+    if( SPAN_LOAD( &last->span ) != span )
+      prev = 0;
+  }
+  SPAN_STORE( &last->span, 0 );
+  SPAN_STORE( &last->ts, ts );
+  SPAN_STORE( &last->span, span );
+
+  SPAN_STORE( &m->seq, 0 );
+  m->span  = span;
+  m->stage = stage;
+  m->tid   = rocs_thread_id();
+  m->ts    = ts;
+  m->prev  = prev;
+  SPAN_STORE( &m->seq, i + 1 );
+
+  if( prev != 0 && ts >= prev )
+    MetricsOp.observe( __histo[stage], (long)( ts - prev ) );
+}
+
+static int __register( const char* stage ) {
+  int id = -1;
+  int i = 0;
+  Boolean full = False;
+
+  __initMux();
+  MutexOp.wait( __mux );
+  for( i = 0; i < __stageCnt; i++ ) {
+    if( StrOp.equals( __stages[i], stage ) ) {
+      id = i;
+      break;
+    }
+  }
+
+  if( id == -1 && __stageCnt < SPAN_STAGES ) {
+    char* hname = StrOp.fmt( "span_%s_us", stage );
+    char* hdesc = StrOp.fmt( "Sensor event latency from the previous stage to %s in microseconds.", stage );
+    __histo[__stageCnt]  = MetricsOp.histogram( hname, hdesc );
+    __stages[__stageCnt] = StrOp.dup( stage );
+    StrOp.free( hname );
+    StrOp.free( hdesc );
+    id = __stageCnt;
+    SPAN_STORE( &__stageCnt, __stageCnt + 1 );
+  }
+  else if( id == -1 )
+    full = True;
+  MutexOp.post( __mux );
+
+  if( full )
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "registry full; stage [%s] not recorded", stage );
+
+  return id;
+}
+
+
+/*
+ ***** _Public functions.
+ */
+static void _enable( Boolean on ) {
+  if( on && __ring == NULL ) {
+    __initMux();
+    MutexOp.wait( __mux );
+    if( __ring == NULL )
+      SPAN_STORE( &__ring, (__spanMark*)allocMem( SPAN_RING * sizeof( __spanMark ) ) );
+    MutexOp.post( __mux );
+  }
+  if( on && __readStage == -1 )
+    __readStage = SpanOp.stage( "read" );
+  SPAN_STORE( &__enabled, on ? 1:0 );
+}
+
+static Boolean _isEnabled( void ) {
+  return SPAN_LOAD( &__enabled ) ? True:False;
+}
+
+static int _stage( const char* name ) {
+  return __register( name );
+}
+
+static long _begin( unsigned long t0 ) {
+  long span = 0;
+  if( !SPAN_LOAD( &__enabled ) )
+    return 0;
+  span = SPAN_ADD( &__nextId, 1 ) + 1;
+  if( t0 != 0 && __readStage != -1 )
+    __record( span, __readStage, t0 );
+  return span;
+}
+
+static void _mark( long span, int stage ) {
+  if( span == 0 || stage < 0 || stage >= SPAN_LOAD( &__stageCnt ) || !SPAN_LOAD( &__enabled ) )
+    return;
+  __record( span, stage, MetricsOp.now() );
+}
+
+static void _setCurrent( long span ) {
+  unsigned long tid = 0;
+  unsigned int h = 0;
+  int i = 0;
+
+  if( span != 0 && !SPAN_LOAD( &__enabled ) )
+    return;
+
+  tid = rocs_thread_id();
+  h = __mix( tid );
+  for( i = 0; i < SPAN_THREADS; i++ ) {
+    __spanThread* t = &__threads[( h + i ) & ( SPAN_THREADS - 1 )];
+    unsigned long owner = SPAN_LOAD( &t->tid );
+    /* a free slot is claimed until it has an owner; a thread that won it first is skipped */
+    while( owner == 0 && span != 0 ) {
+      if( SPAN_CAS( &t->tid, 0, tid ) )
+        owner = tid;
+      else
+        owner = SPAN_LOAD( &t->tid );
+    }
+    if( owner == tid ) {
+      SPAN_STORE( &t->span, span );
+      return;
+    }
+    /* clearing: this thread never had a slot */
+    if( owner == 0 )
+      return;
+  }
+
+  if( SPAN_CAS( &__threadsFull, 0, 1 ) )
+    TraceOp.trc( name, TRCLEVEL_WARNING, __LINE__, 9999, "%d threads with a span; no more are tracked", SPAN_THREADS );
+}
+
+static long _getCurrent( void ) {
+  unsigned long tid = 0;
+  unsigned int h = 0;
+  int i = 0;
+
+  if( !SPAN_LOAD( &__enabled ) )
+    return 0;
+
+  tid = rocs_thread_id();
+  h = __mix( tid );
+  for( i = 0; i < SPAN_THREADS; i++ ) {
+    __spanThread* t = &__threads[( h + i ) & ( SPAN_THREADS - 1 )];
+    unsigned long owner = SPAN_LOAD( &t->tid );
+    if( owner == tid )
+      return SPAN_LOAD( &t->span );
+    if( owner == 0 )
+      break;
+  }
+  return 0;
+}
+
+/* Marks with a known previous mark are complete events from that time on;
+   the first mark of a span is an instant event. */
+static char* _toJson( void ) {
+  __spanMark* ring = SPAN_LOAD( &__ring );
+  long head = SPAN_LOAD( &__head );
+  long k = head > SPAN_RING ? head - SPAN_RING:0;
+  int size = 4096;
+  int len = 0;
+  char* json = allocMem( size );
+  char line[256];
+  Boolean first = True;
+
+  StrOp.copy( json, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" );
+  len = StrOp.len( json );
+
+  for( ; ring != NULL && k < head; k++ ) {
+    __spanMark* m = &ring[k & ( SPAN_RING - 1 )];
+    __spanMark c;
+    int n = 0;
+
+    if( SPAN_LOAD( &m->seq ) != k + 1 )
+      continue;
+    c = *m;
+    if( SPAN_LOAD( &m->seq ) != k + 1 || c.stage < 0 || c.stage >= __stageCnt )
+      continue;
+
+    if( c.prev != 0 && c.ts >= c.prev )
+      StrOp.fmtb( line, "%s\n{\"name\":\"%s\",\"cat\":\"span\",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,\"pid\":1,\"tid\":%lu,\"args\":{\"span\":%ld}}",
+          first ? "":",", __stages[c.stage], c.prev, c.ts - c.prev, c.tid, c.span );
+    else
+      StrOp.fmtb( line, "%s\n{\"name\":\"%s\",\"cat\":\"span\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lu,\"pid\":1,\"tid\":%lu,\"args\":{\"span\":%ld}}",
+          first ? "":",", __stages[c.stage], c.ts, c.tid, c.span );
+    n = StrOp.len( line );
+    first = False;
+
+    if( len + n + 8 > size ) {
+      size *= 2;
+      json = reallocMem( json, size );
+    }
+    MemOp.copy( json + len, line, n );
+    len += n;
+  }
+
+  MemOp.copy( json + len, "\n]}\n", 5 );
+  return json;
+}
+
+
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
+#include "rocs/impl/span.fm"
+/* ----- DO NOT REMOVE OR EDIT THIS INCLUDE LINE! -----*/
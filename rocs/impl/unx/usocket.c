@@ -21,6 +21,11 @@
 */
 #if defined __linux__ || defined _AIX || defined __unix__ || defined __APPLE__
 
+#if defined __linux__ && !defined _GNU_SOURCE
+  /* recvmmsg() */
+  #define _GNU_SOURCE
+#endif
+
 #ifdef __OPENSSL__
   #include <openssl/crypto.h>
   #include <openssl/x509.h>
@@ -756,6 +761,57 @@ int rocs_socket_recvfrom( iOSocket inst, char* buf, int size, char* client, int*
 
 
 
+/* Fills the frames ring with as many pending datagrams as available, blocking only for the first one. */
+int rocs_socket_recvBatch( iOSocket inst, char* frames, int framesize, int maxframes, int* sizes ) {
+  iOSocketData o = Data(inst);
+#if defined __linux__ && defined MSG_WAITFORONE
+  struct mmsghdr* msgs = NULL;
+  struct iovec*   iovs = NULL;
+  int i  = 0;
+  int rc = 0;
+
+  if( o->batch == NULL || o->batchsize < maxframes ) {
+    if( o->batch != NULL )
+      freeIDMem( o->batch, RocsSocketID );
+    o->batch = allocIDMem( maxframes * ( sizeof(struct mmsghdr) + sizeof(struct iovec) ), RocsSocketID );
+    o->batchsize = maxframes;
+  }
+
+  msgs = (struct mmsghdr*)o->batch;
+  iovs = (struct iovec*)(msgs + o->batchsize);
+
+  for( i = 0; i < maxframes; i++ ) {
+    iovs[i].iov_base = frames + i * framesize;
+    iovs[i].iov_len  = framesize;
+    msgs[i].msg_hdr.msg_name       = NULL;
+    msgs[i].msg_hdr.msg_namelen    = 0;
+    msgs[i].msg_hdr.msg_iov        = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen     = 1;
+    msgs[i].msg_hdr.msg_control    = NULL;
+    msgs[i].msg_hdr.msg_controllen = 0;
+    msgs[i].msg_hdr.msg_flags      = 0;
+    msgs[i].msg_len = 0;
+  }
+
+  rc = recvmmsg( o->sh, msgs, maxframes, MSG_WAITFORONE, NULL );
+  o->rc = errno;
+  if( rc < 0 ) {
+    TraceOp.terrno( name, TRCLEVEL_EXCEPTION, __LINE__, 9999, o->rc, "recvmmsg() failed" );
+    return 0;
+  }
+
+  o->readed = 0;
+  for( i = 0; i < rc; i++ ) {
+    sizes[i] = msgs[i].msg_len;
+    o->readed += msgs[i].msg_len;
+  }
+  return rc;
+#else
+  sizes[0] = rocs_socket_recvfrom( inst, frames, framesize, NULL, NULL );
+  return sizes[0] > 0 ? 1:0;
+#endif
+}
+
 Boolean rocs_socket_sendto( iOSocket inst, char* buf, int size, char* client, int port ) {
   iOSocketData o = Data(inst);
   struct sockaddr_in address;
@@ -62,6 +62,17 @@ int rocs_system_getMillis( void ) {
 #endif
 }
 
+/* Monotonic microseconds; only for measuring intervals. */
+unsigned long rocs_system_getMicros( void ) {
+#ifdef __ROCS_SYSTEM__
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return (unsigned long)ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+#else
+  return 0;
+#endif
+}
+
 Boolean rocs_system_uBusyWait( int us) {
 #ifdef __ROCS_SYSTEM__
 //   struct   timeval start_tv, stop_tv;
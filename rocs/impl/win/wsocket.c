@@ -674,6 +674,12 @@ int rocs_socket_recvfrom( iOSocket inst, char* buf, int size, char* client, int*
 
 
 
+/* No recvmmsg() on Windows: one datagram per call. */
+int rocs_socket_recvBatch( iOSocket inst, char* frames, int framesize, int maxframes, int* sizes ) {
+  sizes[0] = rocs_socket_recvfrom( inst, frames, framesize, NULL, NULL );
+  return sizes[0] > 0 ? 1:0;
+}
+
 Boolean rocs_socket_sendto( iOSocket inst, char* buf, int size, char* client, int port ) {
   iOSocketData o = Data(inst);
   int rc = 0;
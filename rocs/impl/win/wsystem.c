@@ -86,6 +86,19 @@ int rocs_system_getMillis( void ) {
 #endif
 }
 
+/* Monotonic microseconds; only for measuring intervals. */
+unsigned long rocs_system_getMicros( void ) {
+#ifdef __ROCS_SYSTEM__
+  LARGE_INTEGER freq, ticks;
+  QueryPerformanceFrequency( &freq );
+  QueryPerformanceCounter( &ticks );
+  return (unsigned long)( ( ticks.QuadPart / freq.QuadPart ) * 1000000 +
+                          ( ticks.QuadPart % freq.QuadPart ) * 1000000 / freq.QuadPart );
+#else
+  return 0;
+#endif
+}
+
 Boolean rocs_system_uBusyWait( int us) {
 #ifdef __ROCS_SYSTEM__
 	LARGE_INTEGER ticksPerSecond;
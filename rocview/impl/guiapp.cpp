@@ -210,6 +210,30 @@ bool RocGui::isModelSet() {
   return m_Model != NULL ? true:false;
 }
 
+/* The version of the server plan to resume from; 0 if there is none to keep. */
+long RocGui::getResumeVersion() {
+  if( m_Model == NULL || m_bOffline || NodeOp.getChildCnt(m_Model) == 0 )
+    return 0;
+  return m_PlanVersion;
+}
+
+/* Request the plan; a held plan of a known version only needs the changes since. */
+void RocGui::requestPlan() {
+  iONode cmd = NodeOp.inst( wModelCmd.name(), NULL, ELEMENT_NODE );
+  wModelCmd.setcmd( cmd, wModelCmd.plan );
+  wModelCmd.setcontrolcode( cmd, m_Frame->m_ControlCode );
+  wModelCmd.setdisablemonitor(cmd, wGui.ismonitoring(m_Ini) ? False:True);
+  char* guiid = StrOp.fmt( "%s,%d,%d", wGui.getid(m_Ini),
+      SocketOp.getMAC(NULL)!=NULL?SocketOp.getMAC(NULL):0, SystemOp.getpid() );
+  wModelCmd.setcmdfrom( cmd, guiid );
+  m_ResumeVersion = getResumeVersion();
+  wModelCmd.setplanversion( cmd, m_ResumeVersion );
+  TraceOp.trc( "app", TRCLEVEL_INFO, __LINE__, 9999, "request plan; resume from version %ld", m_ResumeVersion );
+  sendToRocrail( cmd );
+  StrOp.free(guiid);
+  cmd->base.del( cmd );
+}
+
 void RocGui::disConnect() {
   if( m_RCon != NULL ) {
     RConOp.close( m_RCon );
@@ -509,16 +533,7 @@ static void conThread( void* threadinst ) {
     o->m_bOffline = false;
 
     // Initial connection.
-    iONode cmd = NodeOp.inst( wModelCmd.name(), NULL, ELEMENT_NODE );
-    wModelCmd.setcmd( cmd, wModelCmd.plan );
-    wModelCmd.setcontrolcode( cmd, o->m_Frame->m_ControlCode );
-    wModelCmd.setdisablemonitor(cmd, wGui.ismonitoring(o->m_Ini) ? False:True);
-    char* guiid = StrOp.fmt( "%s,%d,%d", wGui.getid(o->m_Ini),
-        SocketOp.getMAC(NULL)!=NULL?SocketOp.getMAC(NULL):0, SystemOp.getpid() );
-    wModelCmd.setcmdfrom( cmd, guiid );
-    o->sendToRocrail( cmd );
-    StrOp.free(guiid);
-    cmd->base.del( cmd );
+    o->requestPlan();
   }
   else {
     wxCommandEvent* evt = new wxCommandEvent( wxEVT_COMMAND_MENU_SELECTED, ME_SetStatusText );
@@ -624,6 +639,8 @@ bool RocGui::OnInit() {
   m_LocalModelModified = false;
   m_LocalPlan = _T("");
   m_Model = NULL;
+  m_PlanVersion = 0;
+  m_ResumeVersion = 0;
   m_OldModel = NULL;
   m_UndoItems = ListOp.inst();
   m_InitialRocrailIni = false;
@@ -938,10 +955,14 @@ static void rocrailCallback( obj me, iONode node ) {
     wxGetApp().getFrame()->setEditMode(false);
 
     if( guiApp->getFrame()->getNotebook() != NULL ) {
-      if( !guiApp->isModelSet() || guiApp->isOffline() || (guiApp->getModel(false) != NULL && NodeOp.getChildCnt(guiApp->getModel(false)) == 0) ) {
+      /* a full plan also replaces the held one if the server could not resume it */
+      if( !guiApp->isModelSet() || guiApp->isOffline() || guiApp->m_ResumeVersion > 0 ||
+          (guiApp->getModel(false) != NULL && NodeOp.getChildCnt(guiApp->getModel(false)) == 0) ) {
         TraceOp.trc( "app", TRCLEVEL_INFO, __LINE__, 9999,
             "isModelSet=%d stayOffline=%d", guiApp->isModelSet(), guiApp->isStayOffline() );
         guiApp->setModel( node );
+        guiApp->m_PlanVersion = wPlan.getplanversion( node );
+        guiApp->m_ResumeVersion = 0;
         wxCommandEvent event( wxEVT_COMMAND_MENU_SELECTED, INIT_NOTEBOOK );
         wxPostEvent( guiApp->getFrame(), event );
       }
@@ -970,6 +991,45 @@ static void rocrailCallback( obj me, iONode node ) {
     return;
   }
 
+  /* Plan versions: */
+  if( StrOp.equals( wModelCmd.name(), NodeOp.getName( node ) ) ) {
+    const char* cmd = wModelCmd.getcmd( node );
+    long version = wModelCmd.getplanversion( node );
+
+    if( StrOp.equals( wModelCmd.reconnected, cmd ) ) {
+      /* events of the lost connection are missing; resume the held plan */
+      guiApp->requestPlan();
+      return;
+    }
+    if( StrOp.equals( wModelCmd.resumed, cmd ) ) {
+      TraceOp.trc( "app", TRCLEVEL_INFO, __LINE__, 9999, "plan resumed from version %ld to %ld", guiApp->m_ResumeVersion, version );
+      guiApp->m_PlanVersion = version;
+      guiApp->m_ResumeVersion = 0;
+      return;
+    }
+    if( StrOp.equals( wModelCmd.version, cmd ) ) {
+      if( guiApp->m_ResumeVersion == 0 )
+        guiApp->m_PlanVersion = version;
+      return;
+    }
+    if( StrOp.equals( wModelCmd.add, cmd ) || StrOp.equals( wModelCmd.modify, cmd ) || StrOp.equals( wModelCmd.remove, cmd ) ) {
+      /* broadcasts queued before the replay are part of it */
+      if( guiApp->m_ResumeVersion > 0 && version == 0 )
+        return;
+      if( version > 0 && version <= guiApp->m_PlanVersion ) {
+        TraceOp.trc( "app", TRCLEVEL_DEBUG, __LINE__, 9999, "skip plan change %ld; have version %ld", version, guiApp->m_PlanVersion );
+        return;
+      }
+      /* a replayed modify applies its items as the server broadcasts them */
+      if( version > 0 && StrOp.equals( wModelCmd.modify, cmd ) ) {
+        int i = 0;
+        for( i = 0; i < NodeOp.getChildCnt( node ); i++ )
+          rocrailCallback( me, NodeOp.getChild( node, i ) );
+        return;
+      }
+    }
+  }
+
   /* Capture all feedback events for visualisation. */
   if( (!wxGetApp().getFrame()->isAutoMode() || wGui.issensormonitorauto(guiApp->getIni()) ) && StrOp.equals( wFeedback.name(), NodeOp.getName( node ) ) ) {
     bool FoundEvent = false;
@@ -1473,6 +1533,8 @@ void RocGui::sensorEvent(iONode event) {
 
 
 void RocGui::setModel( iONode node ) {
+  // The version is only known for a plan received from the server.
+  m_PlanVersion = 0;
   if( m_Model != NULL && !isOffline() ) {
     // Delete the old model node:
     m_Model->base.del( m_Model );
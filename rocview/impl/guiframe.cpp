@@ -1554,6 +1554,18 @@ void RocGuiFrame::UpdateActiveLocs( wxCommandEvent& event ) {
   }
   else if( StrOp.equals( wLoc.name(), NodeOp.getName( node ) ) )
   {
+    if( wLoc.isdelta( node ) ) {
+      // Only the changed attributes are sent; complete them with the known loco state.
+      iONode lc = findLoc( wLoc.getid( node ) );
+      if( lc != NULL ) {
+        iONode full = (iONode)NodeOp.base.clone( lc );
+        NodeOp.mergeNode( full, node, True, False, False );
+        wLoc.setdelta( full, False );
+        node->base.del( node );
+        node = full;
+      }
+    }
+
     TraceOp.trc( "frame", TRCLEVEL_INFO, __LINE__, 9999, "Loc event: [%s][%d] block=[%s] destblock=[%s] throttleID=%s",
         wLoc.getid( node ), wLoc.getaddr( node ), (wLoc.getblockid( node ) != NULL ? wLoc.getblockid( node ):"-"),
         (wLoc.getdestblockid( node ) != NULL ? wLoc.getdestblockid( node ):"-") , wLoc.getthrottleid(node) );
@@ -2900,14 +2912,9 @@ bool RocGuiFrame::Connect( const char* host, int port, bool wait4rr, bool showpo
     cmd->base.del( cmd );
 
     // Initial connection.
-    cmd = NodeOp.inst( wModelCmd.name(), NULL, ELEMENT_NODE );
-    wModelCmd.setcmd( cmd, wModelCmd.plan );
-    wModelCmd.setcontrolcode( cmd, m_ControlCode );
     TraceOp.trc( "frame", TRCLEVEL_INFO, __LINE__, 9999,"control code %s", m_ControlCode );
-    wModelCmd.setdisablemonitor(cmd, wGui.ismonitoring(wxGetApp().getIni()) ? False:True);
-    TraceOp.trc( "frame", TRCLEVEL_INFO, __LINE__, 9999, "monitoring is %s", wModelCmd.isdisablemonitor(cmd)?"off":"on" );
-    wxGetApp().sendToRocrail( cmd );
-    cmd->base.del( cmd );
+    TraceOp.trc( "frame", TRCLEVEL_INFO, __LINE__, 9999, "monitoring is %s", wGui.ismonitoring(wxGetApp().getIni())?"on":"off" );
+    wxGetApp().requestPlan();
 
     this->setOnline( true );
     return true;
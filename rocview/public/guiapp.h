@@ -59,6 +59,8 @@ public:
   void setModel( iONode node );
   iONode getModel(bool create=true);
   bool isModelSet();
+  void requestPlan();
+  long getResumeVersion();
   iONode getIni() { return m_Ini; }
   bool hasUndoItems() { return ListOp.size(m_UndoItems) > 0; }
   iOList getUndoItems() { return m_UndoItems; }
@@ -112,6 +114,8 @@ public:
   const char*   m_donkey;
   const char*   m_doneml;
   iOScript       m_Script;
+  long          m_PlanVersion;   // version of the server plan held in m_Model
+  long          m_ResumeVersion; // version resumed from until the replay ends
 
 private:
   void saveSizePos();